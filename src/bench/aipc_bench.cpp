@@ -0,0 +1,527 @@
+/**
+ * @file aipc_bench.cpp
+ * @brief AI 流水线分阶段基准测试工具
+ *
+ * 在设备上对 AI 模式的各阶段逐一计时，用于刷机前发现性能回退：
+ * - preprocess:      ImageProcessor::ConvertNV12ToModelInput（NV12 -> letterbox RGB）
+ * - yolo_run:        YoloV5Model::Run（NPU 推理）
+ * - yolo_post:       YoloV5Model::GetResults（解码 + NMS，真实推理输出）
+ * - yolo_post_dense: YoloV5Model::GetResults（合成的高密度输出，NMS 主导）
+ * - retina_run:      RetinaFaceModel::Run
+ * - retina_post:     RetinaFaceModel::GetResults（解码 + NMS）
+ * - draw:            ImageProcessor::DrawDetections（CPU 叠框）
+ *
+ * 每个阶段输出 p50/p99/max 延迟与每帧堆分配次数。输入可以是录制的 NV12
+ * 原始帧文件（连续多帧），也可以是合成图像；迭代次数固定，结果可复现。
+ *
+ * 用法：
+ * @code
+ * ./aipc_bench --iterations 200 --nv12 /root/frames_1080p.nv12 --width 1920 --height 1080
+ * ./aipc_bench --rga --yolo ../model/yolov5.rknn --retinaface ''
+ * @endcode
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-12
+ */
+
+#define LOG_TAG "Bench"
+
+#include "common/logger.h"
+#include "common/image_utils.h"
+#include "yolov5/yolov5_model.h"
+#include "retainface/retinaface_model.h"
+
+#include "rk_mpi_sys.h"
+#include "rk_mpi_mb.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// 堆分配计数（替换全局 operator new，仅本工具生效）
+// ============================================================================
+
+namespace {
+std::atomic<uint64_t> g_alloc_count{0};
+}  // namespace
+
+void* operator new(size_t size) {
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size) {
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+// ============================================================================
+// 命令行参数
+// ============================================================================
+
+struct BenchOptions {
+    int iterations = 200;
+    int warmup = 10;
+    int width = 1920;
+    int height = 1080;
+    int model_width = 640;
+    int model_height = 640;
+    std::string nv12_path;                                  ///< 录制的 NV12 帧文件（空 = 合成输入）
+    std::string yolo_path = "../model/yolov5.rknn";         ///< 空字符串跳过 YOLO 阶段
+    std::string labels_path = "../model/coco_80_labels_list.txt";
+    std::string retina_path = "../model/retinaface.rknn";   ///< 空字符串跳过 RetinaFace 阶段
+    bool rga = false;                                       ///< 预处理走 RGA（输入放入 DMA 缓冲区）
+};
+
+void PrintUsage(const char* prog) {
+    printf("Usage: %s [options]\n", prog);
+    printf("Options:\n");
+    printf("  --iterations N      Timed iterations per stage (default: 200)\n");
+    printf("  --warmup N          Untimed warmup iterations per stage (default: 10)\n");
+    printf("  --width W           Source frame width (default: 1920)\n");
+    printf("  --height H          Source frame height (default: 1080)\n");
+    printf("  --nv12 PATH         Raw NV12 file with one or more WxH frames (default: synthetic)\n");
+    printf("  --yolo PATH         YOLOv5 model, '' to skip (default: ../model/yolov5.rknn)\n");
+    printf("  --labels PATH       YOLOv5 labels file\n");
+    printf("  --retinaface PATH   RetinaFace model, '' to skip (default: ../model/retinaface.rknn)\n");
+    printf("  --rga               Preprocess with RGA (frames copied into DMA buffers)\n");
+    printf("  --help, -h          Show this help\n");
+}
+
+bool ParseOptions(int argc, char* argv[], BenchOptions& opt) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--iterations" && has_value) {
+            opt.iterations = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--warmup" && has_value) {
+            opt.warmup = std::max(0, std::atoi(argv[++i]));
+        } else if (arg == "--width" && has_value) {
+            opt.width = std::atoi(argv[++i]);
+        } else if (arg == "--height" && has_value) {
+            opt.height = std::atoi(argv[++i]);
+        } else if (arg == "--nv12" && has_value) {
+            opt.nv12_path = argv[++i];
+        } else if (arg == "--yolo" && has_value) {
+            opt.yolo_path = argv[++i];
+        } else if (arg == "--labels" && has_value) {
+            opt.labels_path = argv[++i];
+        } else if (arg == "--retinaface" && has_value) {
+            opt.retina_path = argv[++i];
+        } else if (arg == "--rga") {
+            opt.rga = true;
+        } else {
+            PrintUsage(argv[0]);
+            return false;
+        }
+    }
+    if (opt.width <= 0 || opt.height <= 0 || (opt.width & 1) || (opt.height & 1)) {
+        printf("Invalid frame size %dx%d (must be positive and even)\n", opt.width, opt.height);
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// 输入帧
+// ============================================================================
+
+/**
+ * @brief NV12 输入帧集合（录制文件或合成图像）
+ *
+ * --rga 时帧数据放在 MB DMA 缓冲区中，ImageBuffer 带 fd，走 RGA 路径。
+ */
+class FrameSource {
+public:
+    ~FrameSource() {
+        for (auto blk : blocks_) RK_MPI_MB_ReleaseMB(blk);
+        if (pool_ != MB_INVALID_POOLID) RK_MPI_MB_DestroyPool(pool_);
+        if (sys_initialized_) RK_MPI_SYS_Exit();
+    }
+
+    bool Load(const BenchOptions& opt) {
+        width_ = opt.width;
+        height_ = opt.height;
+        frame_size_ = static_cast<size_t>(width_) * height_ * 3 / 2;
+
+        if (!opt.nv12_path.empty()) {
+            std::ifstream file(opt.nv12_path, std::ios::binary);
+            if (!file.is_open()) {
+                LOG_ERROR("Failed to open NV12 file: {}", opt.nv12_path);
+                return false;
+            }
+            std::vector<uint8_t> frame(frame_size_);
+            while (file.read(reinterpret_cast<char*>(frame.data()), frame_size_)) {
+                host_frames_.push_back(frame);
+            }
+            if (host_frames_.empty()) {
+                LOG_ERROR("NV12 file holds no complete {}x{} frame", width_, height_);
+                return false;
+            }
+            LOG_INFO("Loaded {} NV12 frame(s) from {}", host_frames_.size(), opt.nv12_path);
+        } else {
+            GenerateSynthetic(4);
+            LOG_INFO("Using {} synthetic {}x{} NV12 frame(s)", host_frames_.size(),
+                     width_, height_);
+        }
+
+        return opt.rga ? UploadToDma() : true;
+    }
+
+    size_t Count() const { return host_frames_.size(); }
+
+    rknn::ImageBuffer Get(size_t index) const {
+        index %= host_frames_.size();
+        rknn::ImageBuffer buf;
+        buf.width = width_;
+        buf.height = height_;
+        buf.stride = width_;
+        buf.vir_height = height_;
+        if (!blocks_.empty()) {
+            buf.data = RK_MPI_MB_Handle2VirAddr(blocks_[index]);
+            buf.fd = RK_MPI_MB_Handle2Fd(blocks_[index]);
+        } else {
+            buf.data = const_cast<uint8_t*>(host_frames_[index].data());
+        }
+        return buf;
+    }
+
+private:
+    /// 渐变 + 移动方块，保证帧间内容不同
+    void GenerateSynthetic(int count) {
+        for (int f = 0; f < count; ++f) {
+            std::vector<uint8_t> frame(frame_size_);
+            uint8_t* y = frame.data();
+            for (int r = 0; r < height_; ++r) {
+                for (int c = 0; c < width_; ++c) {
+                    bool in_box = (c / 128 + r / 128 + f) % 5 == 0;
+                    uint8_t ramp = static_cast<uint8_t>((c + r + f * 16) & 0xFF);
+                    y[r * width_ + c] = in_box ? 235 : ramp;
+                }
+            }
+            uint8_t* uv = y + static_cast<size_t>(width_) * height_;
+            for (int r = 0; r < height_ / 2; ++r) {
+                for (int c = 0; c < width_; c += 2) {
+                    uv[r * width_ + c] = static_cast<uint8_t>(64 + (c * 128 / width_));
+                    uv[r * width_ + c + 1] = static_cast<uint8_t>(64 + (r * 256 / height_));
+                }
+            }
+            host_frames_.push_back(std::move(frame));
+        }
+    }
+
+    bool UploadToDma() {
+        if (RK_MPI_SYS_Init() != RK_SUCCESS) {
+            LOG_ERROR("RK_MPI_SYS_Init failed, RGA input unavailable");
+            return false;
+        }
+        sys_initialized_ = true;
+
+        MB_POOL_CONFIG_S cfg;
+        memset(&cfg, 0, sizeof(cfg));
+        cfg.u64MBSize = frame_size_;
+        cfg.u32MBCnt = static_cast<RK_U32>(host_frames_.size());
+        cfg.enAllocType = MB_ALLOC_TYPE_DMA;
+        pool_ = RK_MPI_MB_CreatePool(&cfg);
+        if (pool_ == MB_INVALID_POOLID) {
+            LOG_ERROR("Failed to create MB pool for RGA input");
+            return false;
+        }
+
+        for (const auto& frame : host_frames_) {
+            MB_BLK blk = RK_MPI_MB_GetMB(pool_, frame_size_, RK_TRUE);
+            if (blk == MB_INVALID_HANDLE) {
+                LOG_ERROR("Failed to get MB block");
+                return false;
+            }
+            memcpy(RK_MPI_MB_Handle2VirAddr(blk), frame.data(), frame_size_);
+            RK_MPI_SYS_MmzFlushCache(blk, RK_FALSE);
+            blocks_.push_back(blk);
+        }
+        return true;
+    }
+
+    int width_ = 0;
+    int height_ = 0;
+    size_t frame_size_ = 0;
+    std::vector<std::vector<uint8_t>> host_frames_;
+    bool sys_initialized_ = false;
+    MB_POOL pool_ = MB_INVALID_POOLID;
+    std::vector<MB_BLK> blocks_;
+};
+
+// ============================================================================
+// 分阶段计时
+// ============================================================================
+
+struct StageResult {
+    std::string name;
+    std::vector<double> samples_us;
+    uint64_t allocs = 0;
+    int failures = 0;
+    std::string note;
+};
+
+/**
+ * @brief 执行一个阶段：warmup 次不计时，随后 iterations 次逐次计时
+ *
+ * @param fn bool(int iteration)，返回 false 计为失败
+ */
+template <typename Fn>
+StageResult RunStage(const std::string& name, const BenchOptions& opt, Fn&& fn) {
+    StageResult result;
+    result.name = name;
+    result.samples_us.reserve(opt.iterations);
+
+    for (int i = 0; i < opt.warmup; ++i) {
+        fn(i);
+    }
+
+    for (int i = 0; i < opt.iterations; ++i) {
+        uint64_t allocs_before = g_alloc_count.load(std::memory_order_relaxed);
+        auto start = std::chrono::steady_clock::now();
+        bool ok = fn(opt.warmup + i);
+        auto end = std::chrono::steady_clock::now();
+        result.allocs += g_alloc_count.load(std::memory_order_relaxed) - allocs_before;
+        if (!ok) result.failures++;
+        result.samples_us.push_back(
+            std::chrono::duration<double, std::micro>(end - start).count());
+    }
+    return result;
+}
+
+double Percentile(std::vector<double> sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    std::sort(sorted.begin(), sorted.end());
+    size_t idx = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(idx, sorted.size() - 1)];
+}
+
+void PrintReport(const std::vector<StageResult>& stages, const BenchOptions& opt) {
+    printf("\n");
+    printf("aipc_bench: %dx%d source, %dx%d model input, %d iterations (%d warmup)\n",
+           opt.width, opt.height, opt.model_width, opt.model_height,
+           opt.iterations, opt.warmup);
+    printf("%-16s %10s %10s %10s %10s %12s %6s  %s\n",
+           "stage", "p50(ms)", "p99(ms)", "max(ms)", "mean(ms)", "allocs/frame", "fail", "note");
+    for (const auto& s : stages) {
+        double sum = 0.0;
+        double max_us = 0.0;
+        for (double v : s.samples_us) {
+            sum += v;
+            max_us = std::max(max_us, v);
+        }
+        size_t n = s.samples_us.size();
+        double mean_us = n ? sum / n : 0.0;
+        printf("%-16s %10.3f %10.3f %10.3f %10.3f %12.2f %6d  %s\n",
+               s.name.c_str(),
+               Percentile(s.samples_us, 0.50) / 1000.0,
+               Percentile(s.samples_us, 0.99) / 1000.0,
+               max_us / 1000.0, mean_us / 1000.0,
+               n ? static_cast<double>(s.allocs) / n : 0.0,
+               s.failures, s.note.c_str());
+    }
+    printf("\n");
+}
+
+/**
+ * @brief 用合成数据填充 YOLOv5 输出张量：大量重叠的高置信度框，使 NMS 成为主要开销
+ */
+void FillDenseYoloOutputs(rknn::YoloV5Model& model) {
+    uint32_t seed = 12345;
+    auto next = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return seed >> 24;
+    };
+    for (int i = 0; i < model.GetOutputNum(); ++i) {
+        auto* out = static_cast<int8_t*>(model.GetOutputVirtAddr(i));
+        int size = model.GetOutputMemSize(i);
+        if (!out) continue;
+        for (int k = 0; k < size; ++k) {
+            // 约 1/4 的字节取高值，其余为低值，obj/class 通过阈值的比例可观
+            out[k] = static_cast<int8_t>((next() & 3) == 0 ? 100 + (next() & 0x1F) : -100);
+        }
+    }
+}
+
+}  // namespace
+
+// ============================================================================
+// main
+// ============================================================================
+
+int main(int argc, char* argv[]) {
+    LogManager::Init();
+
+    BenchOptions opt;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--help" || std::string(argv[i]) == "-h") {
+            PrintUsage(argv[0]);
+            return 0;
+        }
+    }
+    if (!ParseOptions(argc, argv, opt)) {
+        return 1;
+    }
+
+    FrameSource frames;
+    if (!frames.Load(opt)) {
+        return 1;
+    }
+
+    // ---------------------------------------------------------------------
+    // 模型加载（失败的模型对应阶段跳过）
+    // ---------------------------------------------------------------------
+    std::unique_ptr<rknn::YoloV5Model> yolo;
+    if (!opt.yolo_path.empty()) {
+        yolo = std::make_unique<rknn::YoloV5Model>();
+        rknn::ModelConfig cfg;
+        cfg.model_path = opt.yolo_path;
+        cfg.labels_path = opt.labels_path;
+        if (yolo->Init(cfg) != 0) {
+            LOG_WARN("YOLOv5 model unavailable, skipping YOLO stages");
+            yolo.reset();
+        } else {
+            yolo->GetInputSize(opt.model_width, opt.model_height);
+        }
+    }
+
+    std::unique_ptr<rknn::RetinaFaceModel> retina;
+    if (!opt.retina_path.empty()) {
+        retina = std::make_unique<rknn::RetinaFaceModel>();
+        rknn::ModelConfig cfg;
+        cfg.model_path = opt.retina_path;
+        cfg.conf_threshold = 0.5f;
+        cfg.nms_threshold = 0.4f;
+        if (retina->Init(cfg) != 0) {
+            LOG_WARN("RetinaFace model unavailable, skipping RetinaFace stages");
+            retina.reset();
+        }
+    }
+
+    rknn::ImageProcessor processor;
+    auto backend = opt.rga ? rknn::PreprocessBackend::kRga : rknn::PreprocessBackend::kOpenCV;
+    if (!processor.Init(opt.model_width, opt.model_height, backend)) {
+        LOG_ERROR("Failed to init image processor");
+        return 1;
+    }
+
+    // 预处理目标：有模型时直接写 rknn 输入内存（与产线一致），否则用主机缓冲区
+    std::vector<uint8_t> host_input;
+    rknn::ImageBuffer dst;
+    dst.width = opt.model_width;
+    dst.height = opt.model_height;
+    if (yolo) {
+        dst.data = yolo->GetInputVirtAddr();
+        dst.fd = yolo->GetInputFd();
+    } else {
+        host_input.resize(static_cast<size_t>(opt.model_width) * opt.model_height * 3);
+        dst.data = host_input.data();
+    }
+
+    std::vector<StageResult> stages;
+    rknn::LetterboxInfo letterbox;
+    rknn::DetectionResultList results;
+
+    // ---------------------------------------------------------------------
+    // 1. 预处理
+    // ---------------------------------------------------------------------
+    stages.push_back(RunStage("preprocess", opt, [&](int i) {
+        return processor.ConvertNV12ToModelInput(frames.Get(i), dst, letterbox) == 0;
+    }));
+    stages.back().note = rknn::PreprocessBackendToString(processor.GetBackend());
+    if (opt.rga && dst.fd < 0) {
+        stages.back().note += " (no DMA dst, OpenCV fallback)";
+    }
+
+    // ---------------------------------------------------------------------
+    // 2. YOLOv5 推理与后处理
+    // ---------------------------------------------------------------------
+    if (yolo) {
+        stages.push_back(RunStage("yolo_run", opt, [&](int) { return yolo->Run() == 0; }));
+
+        stages.push_back(RunStage("yolo_post", opt, [&](int) {
+            return yolo->GetResults(results) == 0;
+        }));
+        stages.back().note = std::to_string(results.Count()) + " detections";
+
+        FillDenseYoloOutputs(*yolo);
+        stages.push_back(RunStage("yolo_post_dense", opt, [&](int) {
+            return yolo->GetResults(results) == 0;
+        }));
+        stages.back().note = std::to_string(results.Count()) + " detections (synthetic)";
+    }
+
+    // ---------------------------------------------------------------------
+    // 3. RetinaFace 推理与后处理
+    // ---------------------------------------------------------------------
+    if (retina) {
+        int rw = 0;
+        int rh = 0;
+        retina->GetInputSize(rw, rh);
+        if (rw == opt.model_width && rh == opt.model_height && dst.data) {
+            memcpy(retina->GetInputVirtAddr(), dst.data,
+                   std::min<size_t>(retina->GetInputMemSize(), static_cast<size_t>(rw) * rh * 3));
+        }
+        stages.push_back(RunStage("retina_run", opt, [&](int) { return retina->Run() == 0; }));
+
+        rknn::DetectionResultList faces;
+        stages.push_back(RunStage("retina_post", opt, [&](int) {
+            return retina->GetResults(faces) == 0;
+        }));
+        stages.back().note = std::to_string(faces.Count()) + " detections";
+    }
+
+    // ---------------------------------------------------------------------
+    // 4. CPU 叠框（全分辨率 RGB）
+    // ---------------------------------------------------------------------
+    {
+        std::vector<uint8_t> rgb(static_cast<size_t>(opt.width) * opt.height * 3);
+        processor.ConvertNV12ToRGB(frames.Get(0).data, opt.width, opt.height, opt.width,
+                                   rgb.data());
+        if (results.Count() == 0) {
+            // 无模型时合成若干检测框
+            for (int k = 0; k < 8; ++k) {
+                rknn::DetectionResult det;
+                det.class_id = k;
+                det.confidence = 0.9f;
+                det.box = {40 + k * 60, 60 + k * 40, 120, 160};
+                det.label = "obj";
+                results.Add(det);
+            }
+            letterbox.scale = static_cast<float>(opt.model_width) / opt.width;
+        }
+        stages.push_back(RunStage("draw", opt, [&](int) {
+            return processor.DrawDetections(rgb.data(), opt.width, opt.height,
+                                            results, letterbox) == 0;
+        }));
+        stages.back().note = std::to_string(results.Count()) + " boxes";
+    }
+
+    PrintReport(stages, opt);
+
+    processor.Deinit();
+    retina.reset();
+    yolo.reset();
+    return 0;
+}
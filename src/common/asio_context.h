@@ -5,15 +5,22 @@
  * 为单核 CPU (RV1106) 优化的事件驱动架构核心组件。
  * 
  * 设计原则：
- * - 单线程事件循环：所有网络 I/O 在同一个 io_context 中处理
- * - 最小化上下文切换：避免多线程带来的调度开销
+ * - 单个 io_context：所有网络 I/O 在同一个事件循环中处理
+ * - 最小化上下文切换：线程数默认等于 CPU 核数（单核时仍是单线程）
  * - 异步优先：所有 I/O 操作使用异步回调模式
  *
  * 线程模型：
- * - 主 IO 线程：运行 io_context::run()，处理所有网络事件
- * - Video Fetch 线程：独立线程，通过 asio::post 投递任务到主 IO 线程
+ * - IO 线程：Run() 的调用线程 + SetThreadCount() 指定的其余线程，共同运行 io_context::run()
+ * - Video Fetch 线程：独立线程，通过 asio::post 投递任务到 IO 线程
  * - File I/O 线程：独立线程，处理磁盘写入（因为文件 I/O 延迟不可控）
  *
+ * Strand：每个分发服务（rtsp / ws_preview / webrtc / hls）一个命名 strand，
+ * 服务内部的任务与异步回调严格串行（服务代码无需额外加锁），
+ * 不同服务之间在多核上并行，不会排在彼此后面。服务的 socket / 定时器用 Strand(name)
+ * 构造，其完成回调即在该 strand 上执行。
+ *
+ * 投递的任务经 PooledHandler 从预分配的内存池（handler_pool.h）分配，每帧不再堆分配。
+ *
  * @author 好软，好温暖
  * @date 2026-02-04
  */
@@ -36,6 +43,15 @@
 #include <thread>
 #include <atomic>
 #include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "common/handler_pool.h"
+
+/// 服务专属的串行执行器
+using IoStrand = asio::strand<asio::io_context::executor_type>;
 
 /**
  * @brief 全局 IO Context 单例
@@ -75,9 +91,50 @@ public:
      */
     template<typename Handler>
     void Post(Handler&& handler) {
-        asio::post(io_context_, std::forward<Handler>(handler));
+        asio::post(io_context_, MakePooledHandler(handler_pool_, std::forward<Handler>(handler)));
+    }
+
+    /**
+     * @brief 投递任务到指定 strand（与该 strand 上的其他任务串行）
+     */
+    template<typename Handler>
+    void PostTo(IoStrand& strand, Handler&& handler) {
+        asio::post(strand, MakePooledHandler(handler_pool_, std::forward<Handler>(handler)));
+    }
+
+    /**
+     * @brief 获取命名 strand（首次调用时创建，引用在进程内一直有效）
+     *
+     * 同名共享：同一服务的多个消费者（如 RTSP 主 / 子码流）与其 socket 使用同一个 strand
+     */
+    IoStrand& Strand(const std::string& name) {
+        std::lock_guard<std::mutex> lock(strand_mutex_);
+        auto& strand = strands_[name];
+        if (!strand) {
+            strand = std::make_unique<IoStrand>(asio::make_strand(io_context_));
+        }
+        return *strand;
     }
 
+    /**
+     * @brief 设置 IO 线程数（Run() 之前调用）
+     *
+     * @param threads <= 0 时等于 CPU 核数
+     */
+    void SetThreadCount(int threads) {
+        if (threads <= 0) {
+            threads = static_cast<int>(std::thread::hardware_concurrency());
+        }
+        thread_count_ = threads > 0 ? threads : 1;
+    }
+
+    int GetThreadCount() const { return thread_count_; }
+
+    /**
+     * @brief 任务内存池统计
+     */
+    HandlerMemoryPool::Stats GetHandlerPoolStats() const { return handler_pool_.GetStats(); }
+
     /**
      * @brief 在 IO 线程中延迟执行任务
      * 
@@ -98,15 +155,22 @@ public:
     }
 
     /**
-     * @brief 启动 IO 事件循环（在调用线程中运行）
+     * @brief 启动 IO 事件循环（在调用线程中运行，另起 GetThreadCount() - 1 个线程）
      * 
-     * 此函数会阻塞，直到调用 Stop()
+     * 此函数会阻塞，直到调用 Stop()；返回前回收其余 IO 线程
      */
     void Run() {
         if (running_.exchange(true)) {
             return;  // 已经在运行
         }
+        std::vector<std::thread> workers;
+        for (int i = 1; i < thread_count_; ++i) {
+            workers.emplace_back([this]() { io_context_.run(); });
+        }
         io_context_.run();
+        for (auto& worker : workers) {
+            worker.join();
+        }
         running_ = false;
     }
 
@@ -176,10 +240,16 @@ private:
     IoContext(const IoContext&) = delete;
     IoContext& operator=(const IoContext&) = delete;
 
+    // 先于 io_context_ 构造、后于其析构：io_context 销毁未执行的任务时仍要归还到池
+    HandlerMemoryPool handler_pool_;
     asio::io_context io_context_;
     std::unique_ptr<asio::executor_work_guard<asio::io_context::executor_type>> work_guard_;
     std::thread io_thread_;
     std::atomic<bool> running_{false};
+    int thread_count_ = 1;
+
+    std::mutex strand_mutex_;
+    std::map<std::string, std::unique_ptr<IoStrand>> strands_;
 };
 
 /**
@@ -0,0 +1,144 @@
+/**
+ * @file block_pool.h
+ * @brief 定长块内存池 - 高频小对象（任务闭包、帧句柄、控制块）不逐次堆分配
+ *
+ * FixedBlockPool 构造时一次性分配 SlotCount 个 SlotSize 字节的槽位：
+ * - 分配 / 归还只做空闲链表操作，由互斥锁保护（分配与归还可在不同线程）
+ * - 请求超过槽位大小或槽位用尽时退回 operator new，计入 fallback（池容量不足的信号）
+ * - 归还时按地址判断来源，调用方无需区分
+ *
+ * BlockPoolAllocator 把池包装为标准分配器，供 asio 任务、shared_ptr 控制块按需 rebind。
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-14
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+
+// ============================================================================
+// 内存池
+// ============================================================================
+
+template <size_t SlotSize, size_t SlotCount>
+class FixedBlockPool {
+public:
+    static constexpr size_t kSlotSize = SlotSize;
+    static constexpr size_t kSlotCount = SlotCount;
+
+    struct Stats {
+        uint64_t pooled = 0;        ///< 从池中分配的次数
+        uint64_t fallback = 0;      ///< 退回 operator new 的次数
+        size_t inUse = 0;           ///< 当前占用的槽位
+    };
+
+    FixedBlockPool() : slots_(new Slot[kSlotCount]) {
+        for (size_t i = 0; i < kSlotCount; ++i) {
+            slots_[i].next = free_;
+            free_ = &slots_[i];
+        }
+    }
+
+    FixedBlockPool(const FixedBlockPool&) = delete;
+    FixedBlockPool& operator=(const FixedBlockPool&) = delete;
+
+    void* Allocate(size_t size) {
+        if (size <= kSlotSize) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (free_) {
+                Slot* slot = free_;
+                free_ = slot->next;
+                in_use_++;
+                pooled_.fetch_add(1, std::memory_order_relaxed);
+                return slot;
+            }
+        }
+        fallback_.fetch_add(1, std::memory_order_relaxed);
+        return ::operator new(size);
+    }
+
+    void Deallocate(void* p) {
+        if (!Owns(p)) {
+            ::operator delete(p);
+            return;
+        }
+        Slot* slot = static_cast<Slot*>(p);
+        std::lock_guard<std::mutex> lock(mutex_);
+        slot->next = free_;
+        free_ = slot;
+        in_use_--;
+    }
+
+    Stats GetStats() const {
+        Stats stats;
+        stats.pooled = pooled_.load(std::memory_order_relaxed);
+        stats.fallback = fallback_.load(std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats.inUse = in_use_;
+        return stats;
+    }
+
+private:
+    union Slot {
+        Slot* next;
+        alignas(std::max_align_t) unsigned char storage[kSlotSize];
+    };
+
+    bool Owns(const void* p) const {
+        const auto* slot = static_cast<const Slot*>(p);
+        return slot >= slots_.get() && slot < slots_.get() + kSlotCount;
+    }
+
+    std::unique_ptr<Slot[]> slots_;
+    mutable std::mutex mutex_;
+    Slot* free_ = nullptr;
+    size_t in_use_ = 0;
+    std::atomic<uint64_t> pooled_{0};
+    std::atomic<uint64_t> fallback_{0};
+};
+
+// ============================================================================
+// 分配器
+// ============================================================================
+
+/**
+ * @brief 从 FixedBlockPool 分配的标准分配器（按需 rebind，池须比所有分配活得久）
+ */
+template <typename T, typename Pool>
+class BlockPoolAllocator {
+public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = BlockPoolAllocator<U, Pool>;
+    };
+
+    explicit BlockPoolAllocator(Pool& pool) noexcept : pool_(&pool) {}
+
+    template <typename U>
+    BlockPoolAllocator(const BlockPoolAllocator<U, Pool>& other) noexcept : pool_(other.pool()) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(pool_->Allocate(sizeof(T) * n)); }
+    void deallocate(T* p, size_t /*n*/) noexcept { pool_->Deallocate(p); }
+
+    Pool* pool() const noexcept { return pool_; }
+
+    template <typename U>
+    bool operator==(const BlockPoolAllocator<U, Pool>& other) const noexcept {
+        return pool_ == other.pool();
+    }
+    template <typename U>
+    bool operator!=(const BlockPoolAllocator<U, Pool>& other) const noexcept {
+        return pool_ != other.pool();
+    }
+
+private:
+    Pool* pool_;
+};
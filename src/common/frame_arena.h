@@ -0,0 +1,311 @@
+/**
+ * @file frame_arena.h
+ * @brief 编码帧内存池 - 脱离 VENC buffer 的帧拷贝不再逐帧 malloc
+ *
+ * 需要脱离 VENC buffer 保存的帧（GOP 缓存、acquire_encoded_frame）拷贝到池中的定长 slab：
+ * - slab 按尺寸分级（4KB 起，每级约 1.5 倍），请求向上取最小的满足级别
+ * - 构造时预留若干关键帧大小的 slab；其余 slab 首次用到时分配，释放后留在空闲链表复用，
+ *   稳态下不再向堆申请
+ * - slab 总量不超过 capacity_bytes：本级没有空闲且总量已满时，先借用更大级别的空闲 slab，
+ *   再归还其他级别的空闲 slab 腾出空间，仍不够则分配失败（由调用方按溢出处理）
+ * - shared_ptr 控制块经 HeaderAllocator() 从同一个池的定长头部块分配
+ *
+ * 生命周期：HeaderAllocator 持有池的 shared_ptr，控制块在池内的帧释放之前池不会销毁，
+ * 因此帧的删除器只需保存裸指针。
+ *
+ * @note header-only，线程安全（一把互斥锁，临界区内只做链表操作）
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-14
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace media {
+
+/**
+ * @brief 编码帧内存池统计
+ */
+struct FrameArenaStats {
+    size_t capacity_bytes = 0;      ///< slab 总量上限
+    size_t reserved_bytes = 0;      ///< 已向堆申请的 slab 合计（含空闲）
+    size_t in_use_bytes = 0;        ///< 正被帧占用的 slab 合计
+    size_t peak_in_use_bytes = 0;
+    uint64_t allocations = 0;       ///< 成功分配次数
+    uint64_t grows = 0;             ///< 新申请 slab 的次数（稳态下不再增长）
+    uint64_t spills = 0;            ///< 借用更大级别 slab 的次数
+    uint64_t trims = 0;             ///< 为腾出空间归还的空闲 slab 数
+    uint64_t failures = 0;          ///< 池满或单帧超过最大级别导致的失败次数
+    size_t headers_in_use = 0;      ///< 正在使用的控制块头部块
+    uint64_t header_fallbacks = 0;  ///< 控制块超出头部块大小或数量、改用堆分配的次数
+};
+
+class FrameArena : public std::enable_shared_from_this<FrameArena> {
+public:
+    static constexpr size_t kMinSlabBytes = 4 * 1024;
+    static constexpr size_t kMaxSlabBytes = 4 * 1024 * 1024;   ///< 单帧上限
+    static constexpr size_t kHeaderBlockBytes = 512;            ///< 单个控制块上限
+    static constexpr size_t kHeaderChunk = 64;                  ///< 头部块每次申请的数量
+    static constexpr size_t kMaxHeaderBlocks = 1024;
+
+    /// 一块 slab（data 可写入 capacity 字节）
+    struct Block {
+        uint8_t* data = nullptr;
+        size_t capacity = 0;
+        uint8_t size_class = 0;
+    };
+
+    /**
+     * @param capacity_bytes slab 总量上限
+     * @param keyframe_bytes 预留 slab 的大小（按关键帧估算，0 = 不预留）
+     * @param keyframe_slabs 预留数量
+     */
+    static std::shared_ptr<FrameArena> Create(size_t capacity_bytes, size_t keyframe_bytes,
+                                              size_t keyframe_slabs = 2) {
+        return std::shared_ptr<FrameArena>(
+            new FrameArena(capacity_bytes, keyframe_bytes, keyframe_slabs));
+    }
+
+    ~FrameArena() {
+        for (auto& list : free_) {
+            for (uint8_t* p : list) ::operator delete(p);
+        }
+        for (void* chunk : header_chunks_) ::operator delete(chunk);
+    }
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    /**
+     * @brief 分配不小于 size 字节的 slab
+     * @return false 池已满或 size 超过 kMaxSlabBytes
+     */
+    bool Allocate(size_t size, Block* out) {
+        const size_t cls = ClassFor(size);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (cls >= class_bytes_.size()) {
+            failures_++;
+            return false;
+        }
+
+        size_t use = cls;
+        uint8_t* p = PopFree(cls);
+        if (!p && reserved_bytes_ + class_bytes_[cls] > capacity_bytes_) {
+            for (size_t c = cls + 1; c < class_bytes_.size() && !p; ++c) {
+                if ((p = PopFree(c)) != nullptr) {
+                    use = c;
+                    spills_++;
+                }
+            }
+            if (!p) {
+                TrimFor(class_bytes_[cls]);
+            }
+        }
+        if (!p) {
+            if (reserved_bytes_ + class_bytes_[cls] > capacity_bytes_) {
+                failures_++;
+                return false;
+            }
+            p = static_cast<uint8_t*>(::operator new(class_bytes_[cls]));
+            reserved_bytes_ += class_bytes_[cls];
+            grows_++;
+        }
+
+        in_use_bytes_ += class_bytes_[use];
+        peak_in_use_bytes_ = std::max(peak_in_use_bytes_, in_use_bytes_);
+        allocations_++;
+        out->data = p;
+        out->capacity = class_bytes_[use];
+        out->size_class = static_cast<uint8_t>(use);
+        return true;
+    }
+
+    /// 归还 slab（留在空闲链表复用）
+    void Release(const Block& block) {
+        if (!block.data) return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_[block.size_class].push_back(block.data);
+        in_use_bytes_ -= block.capacity;
+    }
+
+    FrameArenaStats GetStats() const {
+        FrameArenaStats s;
+        std::lock_guard<std::mutex> lock(mutex_);
+        s.capacity_bytes = capacity_bytes_;
+        s.reserved_bytes = reserved_bytes_;
+        s.in_use_bytes = in_use_bytes_;
+        s.peak_in_use_bytes = peak_in_use_bytes_;
+        s.allocations = allocations_;
+        s.grows = grows_;
+        s.spills = spills_;
+        s.trims = trims_;
+        s.failures = failures_;
+        s.headers_in_use = headers_in_use_;
+        s.header_fallbacks = header_fallbacks_;
+        return s;
+    }
+
+    // ========================================================================
+    // 控制块分配器
+    // ========================================================================
+
+    /**
+     * @brief 从头部块分配的标准分配器（供 allocate_shared / shared_ptr(p, d, a)）
+     */
+    template <typename T>
+    class Allocator {
+    public:
+        using value_type = T;
+
+        explicit Allocator(std::shared_ptr<FrameArena> arena) noexcept
+            : arena_(std::move(arena)) {}
+
+        template <typename U>
+        Allocator(const Allocator<U>& other) noexcept : arena_(other.arena()) {}
+
+        T* allocate(size_t n) { return static_cast<T*>(arena_->AllocateHeader(sizeof(T) * n)); }
+        void deallocate(T* p, size_t /*n*/) noexcept { arena_->DeallocateHeader(p); }
+
+        const std::shared_ptr<FrameArena>& arena() const noexcept { return arena_; }
+
+        template <typename U>
+        bool operator==(const Allocator<U>& other) const noexcept {
+            return arena_ == other.arena();
+        }
+        template <typename U>
+        bool operator!=(const Allocator<U>& other) const noexcept {
+            return arena_ != other.arena();
+        }
+
+    private:
+        std::shared_ptr<FrameArena> arena_;
+    };
+
+    template <typename T>
+    Allocator<T> HeaderAllocator() {
+        return Allocator<T>(shared_from_this());
+    }
+
+private:
+    FrameArena(size_t capacity_bytes, size_t keyframe_bytes, size_t keyframe_slabs)
+        : capacity_bytes_(capacity_bytes) {
+        // 4K, 6K, 8K, 12K, 16K ... 每级约 1.5 倍，浪费不超过三分之一
+        for (size_t base = kMinSlabBytes; base <= kMaxSlabBytes; base *= 2) {
+            class_bytes_.push_back(base);
+            if (base + base / 2 <= kMaxSlabBytes) {
+                class_bytes_.push_back(base + base / 2);
+            }
+        }
+        free_.resize(class_bytes_.size());
+
+        if (keyframe_bytes > 0) {
+            const size_t cls = ClassFor(keyframe_bytes);
+            for (size_t i = 0; i < keyframe_slabs && cls < class_bytes_.size() &&
+                               reserved_bytes_ + class_bytes_[cls] <= capacity_bytes_; ++i) {
+                free_[cls].push_back(static_cast<uint8_t*>(::operator new(class_bytes_[cls])));
+                reserved_bytes_ += class_bytes_[cls];
+            }
+        }
+    }
+
+    size_t ClassFor(size_t size) const {
+        auto it = std::lower_bound(class_bytes_.begin(), class_bytes_.end(), size);
+        return static_cast<size_t>(it - class_bytes_.begin());
+    }
+
+    uint8_t* PopFree(size_t cls) {
+        auto& list = free_[cls];
+        if (list.empty()) return nullptr;
+        uint8_t* p = list.back();
+        list.pop_back();
+        return p;
+    }
+
+    /// 归还其他级别的空闲 slab，直到能再申请 need 字节（持有 mutex_）
+    void TrimFor(size_t need) {
+        for (size_t c = class_bytes_.size(); c-- > 0 && reserved_bytes_ + need > capacity_bytes_;) {
+            auto& list = free_[c];
+            while (!list.empty() && reserved_bytes_ + need > capacity_bytes_) {
+                ::operator delete(list.back());
+                list.pop_back();
+                reserved_bytes_ -= class_bytes_[c];
+                trims_++;
+            }
+        }
+    }
+
+    union HeaderBlock {
+        HeaderBlock* next;
+        alignas(std::max_align_t) unsigned char storage[kHeaderBlockBytes];
+    };
+
+    void* AllocateHeader(size_t size) {
+        if (size <= kHeaderBlockBytes) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!free_headers_ && header_blocks_ < kMaxHeaderBlocks) {
+                auto* chunk = static_cast<HeaderBlock*>(
+                    ::operator new(sizeof(HeaderBlock) * kHeaderChunk));
+                header_chunks_.push_back(chunk);
+                header_blocks_ += kHeaderChunk;
+                for (size_t i = 0; i < kHeaderChunk; ++i) {
+                    chunk[i].next = free_headers_;
+                    free_headers_ = &chunk[i];
+                }
+            }
+            if (free_headers_) {
+                HeaderBlock* block = free_headers_;
+                free_headers_ = block->next;
+                headers_in_use_++;
+                return block;
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        header_fallbacks_++;
+        return ::operator new(size);
+    }
+
+    void DeallocateHeader(void* p) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (void* chunk : header_chunks_) {
+            auto* begin = static_cast<HeaderBlock*>(chunk);
+            if (p >= begin && p < begin + kHeaderChunk) {
+                auto* block = static_cast<HeaderBlock*>(p);
+                block->next = free_headers_;
+                free_headers_ = block;
+                headers_in_use_--;
+                return;
+            }
+        }
+        ::operator delete(p);
+    }
+
+    mutable std::mutex mutex_;
+    const size_t capacity_bytes_;
+    std::vector<size_t> class_bytes_;               ///< 各级 slab 大小（升序）
+    std::vector<std::vector<uint8_t*>> free_;       ///< 各级空闲 slab
+    size_t reserved_bytes_ = 0;
+    size_t in_use_bytes_ = 0;
+    size_t peak_in_use_bytes_ = 0;
+
+    std::vector<void*> header_chunks_;
+    HeaderBlock* free_headers_ = nullptr;
+    size_t header_blocks_ = 0;
+    size_t headers_in_use_ = 0;
+
+    uint64_t allocations_ = 0;
+    uint64_t grows_ = 0;
+    uint64_t spills_ = 0;
+    uint64_t trims_ = 0;
+    uint64_t failures_ = 0;
+    uint64_t header_fallbacks_ = 0;
+};
+
+}  // namespace media
@@ -0,0 +1,206 @@
+/**
+ * @file gop_cache.h
+ * @brief GOP 缓存 - 保存最近一个关键帧起的完整 GOP，供新客户端秒开
+ *
+ * 新连接的 WebSocket 预览客户端 / WebRTC 观看者先收到缓存的 GOP（关键帧 + 其后的 P 帧），
+ * 再无缝衔接实时帧，不必等待下一个 IDR。
+ *
+ * 缓存帧不持有 VENC buffer：各 VENC 通道 u32StreamBufCnt 只有 2，持有一整个 GOP
+ * 会让编码器阻塞。因此每帧派发时拷贝到编码帧内存池（FrameArena，见 frame_arena.h），
+ * 以 copy_encoded_stream() 包装为独立的 EncodedStreamPtr，消费者无需区分来源。
+ *
+ * 内存有界：
+ * - budget_bytes：缓存 GOP 的字节上限，超出时丢弃整段缓存，直到下一个关键帧重新开始
+ * - max_frames：缓存帧数上限（GOP 很长时同样按溢出处理）
+ * - 内存池上限为 2 × budget_bytes（当前 GOP + 仍被快照引用的上一个 GOP），
+ *   启动时按 budget_bytes / 4（不超过 kMaxKeyframeReserve）预留两块关键帧 slab；
+ *   池满导致拷贝失败时同样按溢出处理
+ *
+ * @note 快照中的帧被客户端引用期间不计入 budget（发送完成即归还缓冲池）
+ * @note header-only，日志使用包含方 .cpp 定义的 LOG_TAG
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-14
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "common/logger.h"
+#include "common/media_buffer.h"
+
+namespace media {
+
+/**
+ * @brief GOP 缓存占用统计
+ */
+struct GopCacheStats {
+    bool enabled = false;
+    size_t budget_bytes = 0;        ///< 内存上限
+    size_t frames = 0;              ///< 当前缓存帧数
+    size_t bytes = 0;               ///< 当前缓存字节数
+    size_t peak_bytes = 0;          ///< 历史最大缓存字节数
+    uint64_t gops = 0;              ///< 已开始缓存的 GOP 数
+    uint64_t overflows = 0;         ///< GOP 超出上限被丢弃的次数
+    uint64_t snapshots = 0;         ///< 提供给新客户端的非空快照次数
+    FrameArenaStats arena;          ///< 帧拷贝内存池
+};
+
+// ============================================================================
+// GOP 缓存
+// ============================================================================
+
+/**
+ * @class GopCache
+ * @brief 单路码流的 GOP 缓存（线程安全）
+ *
+ * 由 StreamDispatcher 在派发线程逐帧调用 OnFrame()，任意线程通过 Snapshot() 读取。
+ */
+class GopCache {
+public:
+    static constexpr size_t kDefaultMaxFrames = 300;
+    static constexpr size_t kMaxKeyframeReserve = 1024 * 1024;
+
+    GopCache() = default;
+
+    GopCache(const GopCache&) = delete;
+    GopCache& operator=(const GopCache&) = delete;
+
+    /**
+     * @brief 设置内存上限（0 = 关闭缓存），会清空已缓存的帧
+     */
+    void Configure(size_t budget_bytes, size_t max_frames = kDefaultMaxFrames) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        frames_.clear();
+        bytes_ = 0;
+        overflowed_ = false;
+        generation_++;
+        budget_bytes_ = budget_bytes;
+        max_frames_ = max_frames > 0 ? max_frames : kDefaultMaxFrames;
+        arena_ = budget_bytes > 0
+            ? FrameArena::Create(2 * budget_bytes, std::min(budget_bytes / 4, kMaxKeyframeReserve))
+            : nullptr;
+        if (budget_bytes > 0) {
+            LOG_INFO("GOP cache enabled: budget={}KB, max_frames={}",
+                     budget_bytes / 1024, max_frames_);
+        }
+    }
+
+    bool IsEnabled() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return budget_bytes_ > 0;
+    }
+
+    /**
+     * @brief 清空缓存（编码器重建、码流格式变化时调用）
+     */
+    void Clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        frames_.clear();
+        bytes_ = 0;
+        overflowed_ = false;
+        generation_++;
+    }
+
+    /**
+     * @brief 缓存一帧（派发线程调用，帧须已建立 NAL 索引）
+     *
+     * 关键帧开启新的 GOP 并丢弃旧缓存；尚未出现关键帧或已溢出时忽略非关键帧。
+     */
+    void OnFrame(const EncodedStreamPtr& stream, bool is_keyframe) {
+        std::shared_ptr<FrameArena> arena;
+        uint64_t generation = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!arena_) return;
+            if (is_keyframe) {
+                frames_.clear();
+                bytes_ = 0;
+                overflowed_ = false;
+                gops_++;
+            } else if (frames_.empty() || overflowed_) {
+                return;
+            }
+            arena = arena_;
+            generation = generation_;
+        }
+
+        // 拷贝在锁外进行，Snapshot() 不会被 memcpy 阻塞
+        size_t len = get_stream_length(stream);
+        if (len == 0) return;
+        auto copy = copy_encoded_stream(stream, arena);   // 为空表示内存池已满
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (generation != generation_) {
+            return;  // 拷贝期间被 Configure() / Clear()
+        }
+        if (!copy || bytes_ + len > budget_bytes_ || frames_.size() >= max_frames_) {
+            LOG_WARN("GOP cache overflow ({} frames, {}KB > {}KB), disabled until next keyframe",
+                     frames_.size() + 1, (bytes_ + len) / 1024, budget_bytes_ / 1024);
+            frames_.clear();
+            bytes_ = 0;
+            overflowed_ = true;
+            overflows_++;
+            return;
+        }
+        frames_.push_back(std::move(copy));
+        bytes_ += len;
+        peak_bytes_ = std::max(peak_bytes_, bytes_);
+    }
+
+    /**
+     * @brief 获取当前 GOP（首帧为关键帧；尚未缓存到关键帧或已溢出时为空）
+     */
+    std::vector<EncodedStreamPtr> Snapshot() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!frames_.empty()) {
+            snapshots_++;
+        }
+        return frames_;
+    }
+
+    GopCacheStats GetStats() const {
+        GopCacheStats s;
+        std::shared_ptr<FrameArena> arena;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            s.enabled = budget_bytes_ > 0;
+            s.budget_bytes = budget_bytes_;
+            s.frames = frames_.size();
+            s.bytes = bytes_;
+            s.peak_bytes = peak_bytes_;
+            s.gops = gops_;
+            s.overflows = overflows_;
+            s.snapshots = snapshots_;
+            arena = arena_;
+        }
+        if (arena) {
+            s.arena = arena->GetStats();
+        }
+        return s;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    size_t budget_bytes_ = 0;
+    size_t max_frames_ = kDefaultMaxFrames;
+    std::shared_ptr<FrameArena> arena_;
+
+    std::vector<EncodedStreamPtr> frames_;
+    size_t bytes_ = 0;
+    bool overflowed_ = false;
+    uint64_t generation_ = 0;
+
+    size_t peak_bytes_ = 0;
+    uint64_t gops_ = 0;
+    uint64_t overflows_ = 0;
+    uint64_t snapshots_ = 0;
+};
+
+}  // namespace media
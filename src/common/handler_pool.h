@@ -0,0 +1,62 @@
+/**
+ * @file handler_pool.h
+ * @brief 异步任务内存池 - 投递到 IO 线程的任务不再逐帧堆分配
+ *
+ * asio::post 为每个任务分配一个操作对象（内含任务闭包），分配器取自任务的
+ * associated_allocator。分发线程每帧为每个 AsyncIO 消费者投递一次，默认走
+ * operator new（asio 的线程缓存只对 IO 线程内的投递生效）。
+ *
+ * HandlerMemoryPool（block_pool.h 的定长块池）预分配固定数量的槽位，PooledHandler
+ * 包装任务并声明 HandlerAllocator，asio 经此从池中分配 / 归还操作对象：
+ * - 分配在投递线程，归还在 IO 线程（任务执行前），空闲链表由互斥锁保护
+ * - 超过槽位大小或槽位用尽时退回 operator new，并计入统计
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-14
+ */
+
+#pragma once
+
+#include <type_traits>
+#include <utility>
+
+#include "common/block_pool.h"
+
+// ============================================================================
+// 任务内存池与包装
+// ============================================================================
+
+/// 单个操作对象上限 256 字节（闭包 + asio 操作头），同时在途的任务最多 128 个
+using HandlerMemoryPool = FixedBlockPool<256, 128>;
+
+template <typename T>
+using HandlerAllocator = BlockPoolAllocator<T, HandlerMemoryPool>;
+
+/**
+ * @brief 声明池分配器的任务包装（asio 经 get_allocator() 取得分配器）
+ */
+template <typename Handler>
+class PooledHandler {
+public:
+    using allocator_type = HandlerAllocator<void>;
+
+    PooledHandler(HandlerMemoryPool& pool, Handler handler)
+        : pool_(&pool), handler_(std::move(handler)) {}
+
+    allocator_type get_allocator() const noexcept { return allocator_type(*pool_); }
+
+    template <typename... Args>
+    void operator()(Args&&... args) {
+        handler_(std::forward<Args>(args)...);
+    }
+
+private:
+    HandlerMemoryPool* pool_;
+    Handler handler_;
+};
+
+template <typename Handler>
+inline PooledHandler<std::decay_t<Handler>> MakePooledHandler(HandlerMemoryPool& pool,
+                                                               Handler&& handler) {
+    return PooledHandler<std::decay_t<Handler>>(pool, std::forward<Handler>(handler));
+}
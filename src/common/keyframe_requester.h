@@ -0,0 +1,135 @@
+/**
+ * @file keyframe_requester.h
+ * @brief 关键帧按需请求 - 对 RK_MPI_VENC_RequestIDR 做限频与合并
+ *
+ * 新加入的 WebRTC 观看者、WebSocket 预览客户端和开始录制的 MP4 文件都需要从 IDR
+ * 开始解码，否则要等满一个 GOP。各消费者在需要时调用 Request()，这里保证：
+ * - 合并：已发出的 IDR 尚未出现在码流中时，新的请求直接复用它
+ * - 限频：两次强制 IDR 之间至少间隔 min_interval_ms，冷却期内的请求挂起，
+ *   冷却结束后由下一帧补发一次（期间若自然出现关键帧则直接满足）
+ *
+ * 由 StreamDispatcher 在每帧派发时调用 OnFrame() 驱动挂起请求，无需额外线程。
+ *
+ * @note header-only，日志使用包含方 .cpp 定义的 LOG_TAG
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-14
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+#include "common/logger.h"
+
+#include "rk_mpi_venc.h"
+
+namespace media {
+
+/**
+ * @brief 关键帧请求统计
+ */
+struct KeyframeRequestStats {
+    uint64_t requests = 0;      ///< 消费者发起的请求次数
+    uint64_t issued = 0;        ///< 实际调用 RequestIDR 的次数
+    uint64_t coalesced = 0;     ///< 被在途 IDR / 冷却期合并的请求次数
+};
+
+/**
+ * @class KeyframeRequester
+ * @brief 单个 VENC 通道的关键帧请求器（线程安全）
+ */
+class KeyframeRequester {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit KeyframeRequester(int min_interval_ms = 500)
+        : min_interval_(std::chrono::milliseconds(min_interval_ms)) {}
+
+    /**
+     * @brief 绑定 VENC 通道（-1 表示未绑定，请求只计数不下发）
+     */
+    void SetChannel(int venc_chn) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        venc_chn_ = venc_chn;
+        in_flight_ = false;
+        pending_ = false;
+    }
+
+    /**
+     * @brief 请求尽快输出关键帧
+     * @param reason 请求来源（用于日志）
+     * @return true 已下发或已合并到在途 / 挂起的请求，false 通道未绑定或下发失败
+     */
+    bool Request(const char* reason) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.requests++;
+        if (venc_chn_ < 0) {
+            return false;
+        }
+
+        auto now = Clock::now();
+        if (in_flight_ && now - last_issue_ < kInFlightTimeout) {
+            stats_.coalesced++;
+            return true;
+        }
+        if (last_issue_ != Clock::time_point{} && now - last_issue_ < min_interval_) {
+            pending_ = true;
+            stats_.coalesced++;
+            return true;
+        }
+
+        LOG_DEBUG("Request IDR on VENC chn{} ({})", venc_chn_, reason ? reason : "");
+        return IssueLocked(now);
+    }
+
+    /**
+     * @brief 每帧派发时调用：关键帧满足所有在途 / 挂起请求，冷却结束后补发挂起请求
+     */
+    void OnFrame(bool is_keyframe) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (is_keyframe) {
+            in_flight_ = false;
+            pending_ = false;
+            return;
+        }
+        if (pending_ && Clock::now() - last_issue_ >= min_interval_) {
+            pending_ = false;
+            IssueLocked(Clock::now());
+        }
+    }
+
+    KeyframeRequestStats GetStats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+private:
+    // 在途 IDR 超过该时间仍未出现在码流中，视为丢失，允许重新下发
+    static constexpr std::chrono::milliseconds kInFlightTimeout{1000};
+
+    bool IssueLocked(Clock::time_point now) {
+        last_issue_ = now;
+        RK_S32 ret = RK_MPI_VENC_RequestIDR(venc_chn_, RK_TRUE);
+        if (ret != RK_SUCCESS) {
+            LOG_WARN("VENC chn{} request IDR failed: {:#x}", venc_chn_, ret);
+            in_flight_ = false;
+            return false;
+        }
+        in_flight_ = true;
+        stats_.issued++;
+        return true;
+    }
+
+    mutable std::mutex mutex_;
+    const Clock::duration min_interval_;
+    int venc_chn_ = -1;
+    bool in_flight_ = false;
+    bool pending_ = false;
+    Clock::time_point last_issue_;
+    KeyframeRequestStats stats_;
+};
+
+}  // namespace media
@@ -0,0 +1,305 @@
+/**
+ * @file latency_trace.h
+ * @brief 端到端延迟追踪 - 以采集 PTS 为基准记录每帧经过各阶段的时刻
+ *
+ * VI 出帧时打上的 u64PTS 经 VPSS、VENC 原样传到 VENC_PACK_S::u64PTS，消费者拿到的
+ * EncodedStreamPtr 已带有采集时刻。各阶段用同一时基（RK_MPI_SYS_GetCurPTS）取当前时间，
+ * 差值即“采集 -> 该阶段”的延迟：
+ * - vpss:      生产者从 VPSS 取到原始帧（AI 模式）
+ * - inference: 该帧的检测结果发布
+ * - venc:      从 VENC 取到码流（按通道）
+ * - queued:    消费者开始处理（含 IO 队列等待，按消费者）
+ * - sent:      消费者处理结束（发送 / 写入完成，按消费者）
+ *
+ * 每个事件同时记入：
+ * - aipc_capture_latency_seconds 直方图（/api/metrics 汇总）
+ * - 定长事件环（最近 kRingSize 个事件，/api/latency/trace 按帧归组导出），
+ *   多线程写入，每个槽位带序号，读取方丢弃正在改写的槽位
+ *
+ * 调试模式（SetSeiEnabled）把采集时刻以 H.264/H.265 SEI user data 写入码流
+ * （RK_MPI_VENC_InsertUserData，载荷格式见 FormatSeiPayload），浏览器 / VLC 侧工具
+ * 解析后与本地时钟比对即得端到端延迟：
+ * - 送帧模式（AI 串行）在 SendFrame 前写入，时刻精确
+ * - 硬件绑定模式无法在送帧前介入，取到一帧后按帧间隔预测下一帧的 PTS 写入
+ *   （SeiStamper），误差为帧间隔抖动
+ *
+ * @note header-only，线程安全
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-14
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "rk_mpi_sys.h"
+#include "rk_mpi_venc.h"
+
+#include "common/metrics.h"
+
+namespace media {
+
+class LatencyTracer {
+public:
+    enum class Stage : uint8_t {
+        kVpss = 0,
+        kInference,
+        kVenc,
+        kQueued,
+        kSent,
+    };
+
+    static constexpr size_t kRingSize = 2048;       ///< 事件环容量（约 5 秒，双码流 30fps）
+    static constexpr size_t kMaxTags = 64;           ///< 消费者 ID 上限（超出的共用最后一个）
+
+    /// 事件环中的一条记录
+    struct Event {
+        uint64_t pts = 0;           ///< 采集 PTS（微秒）
+        uint32_t latency_us = 0;    ///< 采集 -> 该阶段
+        Stage stage = Stage::kVpss;
+        uint16_t tag = 0;           ///< kVenc 为通道号，kQueued / kSent 为消费者 ID
+    };
+
+    /// 消费者的追踪句柄（注册时取得，热路径不查表）
+    struct ConsumerTrace {
+        uint16_t id = 0;
+        LatencyHistogram* queued = nullptr;
+        LatencyHistogram* sent = nullptr;
+    };
+
+    /// 有意不析构：静态析构阶段仍可能有线程在记录
+    static LatencyTracer& Instance() {
+        static auto* tracer = new LatencyTracer();
+        return *tracer;
+    }
+
+    LatencyTracer(const LatencyTracer&) = delete;
+    LatencyTracer& operator=(const LatencyTracer&) = delete;
+
+    static const char* StageToString(Stage stage) {
+        switch (stage) {
+            case Stage::kVpss:      return "vpss";
+            case Stage::kInference: return "inference";
+            case Stage::kVenc:      return "venc";
+            case Stage::kQueued:    return "queued";
+            case Stage::kSent:      return "sent";
+            default:                return "unknown";
+        }
+    }
+
+    /// 采集到 vpss / inference 阶段的捕获延迟直方图（负载调度按窗口取均值）
+    const LatencyHistogram& CaptureHistogram(Stage stage) const {
+        return stage == Stage::kVpss ? *vpss_ : *inference_;
+    }
+
+    /// 与 u64PTS 同一时基的当前时刻（微秒）
+    static uint64_t NowPts() {
+        RK_U64 now = 0;
+        RK_MPI_SYS_GetCurPTS(&now);
+        return now;
+    }
+
+    // ------------------------------------------------------------------------
+    // 记录
+    // ------------------------------------------------------------------------
+
+    /// 原始帧 / 推理结果阶段（tag 固定为 0）
+    void Record(Stage stage, uint64_t pts) {
+        RecordAt(stage, 0, pts, NowPts(), stage == Stage::kVpss ? *vpss_ : *inference_);
+    }
+
+    /// VENC 取流阶段
+    void RecordVenc(int chn, uint64_t pts) {
+        const size_t slot = chn >= 0 && static_cast<size_t>(chn) < venc_.size()
+                                ? static_cast<size_t>(chn) : venc_.size() - 1;
+        LatencyHistogram* h = venc_[slot].load(std::memory_order_acquire);
+        if (!h) {
+            h = &Histogram({{"stage", "venc"}, {"chn", std::to_string(chn)}});
+            venc_[slot].store(h, std::memory_order_release);
+        }
+        RecordAt(Stage::kVenc, static_cast<uint16_t>(chn), pts, NowPts(), *h);
+    }
+
+    /**
+     * @brief 消费者阶段：回调结束时调用，一次记录 queued 与 sent
+     * @param busy_us 回调自身耗时（queued 时刻 = 当前 - busy_us）
+     */
+    void RecordConsumer(const ConsumerTrace& trace, uint64_t pts, uint64_t busy_us) {
+        const uint64_t now = NowPts();
+        RecordAt(Stage::kQueued, trace.id, pts, now > busy_us ? now - busy_us : 0, *trace.queued);
+        RecordAt(Stage::kSent, trace.id, pts, now, *trace.sent);
+    }
+
+    /// 注册消费者（同名返回同一 ID）
+    ConsumerTrace RegisterConsumer(const std::string& name) {
+        ConsumerTrace trace;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            size_t id = 0;
+            while (id < consumer_names_.size() && consumer_names_[id] != name) ++id;
+            if (id == consumer_names_.size() && id < kMaxTags) {
+                consumer_names_.push_back(name);
+            }
+            trace.id = static_cast<uint16_t>(id < kMaxTags ? id : kMaxTags - 1);
+        }
+        trace.queued = &Histogram({{"stage", "queued"}, {"consumer", name}});
+        trace.sent = &Histogram({{"stage", "sent"}, {"consumer", name}});
+        return trace;
+    }
+
+    // ------------------------------------------------------------------------
+    // 读取
+    // ------------------------------------------------------------------------
+
+    /// 最近 max_events 个事件（旧 -> 新），跳过正在改写的槽位
+    std::vector<Event> Recent(size_t max_events) const {
+        const uint64_t head = head_.load(std::memory_order_acquire);
+        const uint64_t count = std::min<uint64_t>({head, kRingSize, max_events});
+        std::vector<Event> events;
+        events.reserve(count);
+        for (uint64_t idx = head - count; idx < head; ++idx) {
+            const Slot& slot = ring_[idx % kRingSize];
+            const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+            Event e;
+            e.pts = slot.pts.load(std::memory_order_relaxed);
+            const uint64_t packed = slot.packed.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq != Committed(idx) || slot.seq.load(std::memory_order_relaxed) != seq) {
+                continue;
+            }
+            e.latency_us = static_cast<uint32_t>(packed);
+            e.stage = static_cast<Stage>((packed >> 32) & 0xff);
+            e.tag = static_cast<uint16_t>(packed >> 40);
+            events.push_back(e);
+        }
+        return events;
+    }
+
+    /// 事件 tag 的可读名（通道号或消费者名）
+    std::string TagName(const Event& e) const {
+        if (e.stage == Stage::kVenc) {
+            return "chn" + std::to_string(e.tag);
+        }
+        if (e.stage == Stage::kQueued || e.stage == Stage::kSent) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return e.tag < consumer_names_.size() ? consumer_names_[e.tag] : "";
+        }
+        return "";
+    }
+
+    // ------------------------------------------------------------------------
+    // SEI 时间戳（调试）
+    // ------------------------------------------------------------------------
+
+    void SetSeiEnabled(bool enabled) { sei_enabled_.store(enabled, std::memory_order_relaxed); }
+    bool SeiEnabled() const { return sei_enabled_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief SEI user data 载荷（ASCII，便于在码流中直接检索）
+     *
+     * "aipc_ts:<采集时刻 UTC 微秒>:<采集 PTS>"，UTC 时刻由 PTS 与当前墙钟推算
+     */
+    static int FormatSeiPayload(uint64_t pts, char* buf, size_t size) {
+        const uint64_t now_pts = NowPts();
+        const int64_t wall_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+        const int64_t capture_us = wall_us - static_cast<int64_t>(now_pts > pts ? now_pts - pts : 0);
+        return std::snprintf(buf, size, "aipc_ts:%lld:%llu", static_cast<long long>(capture_us),
+                             static_cast<unsigned long long>(pts));
+    }
+
+    /// 把 pts 对应的采集时刻写入 VENC 通道的下一帧（未开启时不做任何事）
+    void StampSei(int venc_chn, uint64_t pts) const {
+        if (!SeiEnabled() || pts == 0) return;
+        char payload[64];
+        const int len = FormatSeiPayload(pts, payload, sizeof(payload));
+        if (len > 0) {
+            RK_MPI_VENC_InsertUserData(venc_chn, reinterpret_cast<RK_U8*>(payload),
+                                       static_cast<RK_U32>(len));
+        }
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> seq{0};       // 2*idx+1 写入中，2*idx+2 已提交
+        std::atomic<uint64_t> pts{0};
+        std::atomic<uint64_t> packed{0};    // latency_us | stage << 32 | tag << 40
+    };
+
+    LatencyTracer()
+        : ring_(new Slot[kRingSize]),
+          vpss_(&Histogram({{"stage", "vpss"}})),
+          inference_(&Histogram({{"stage", "inference"}})) {}
+
+    static uint64_t Committed(uint64_t idx) { return 2 * idx + 2; }
+
+    static LatencyHistogram& Histogram(const MetricsRegistry::Labels& labels) {
+        return MetricsRegistry::Instance().Histogram(
+            "aipc_capture_latency_seconds", "Time from VI capture (frame PTS) to a pipeline stage",
+            labels);
+    }
+
+    void RecordAt(Stage stage, uint16_t tag, uint64_t pts, uint64_t now, LatencyHistogram& h) {
+        if (pts == 0) return;
+        const uint64_t latency = now > pts ? now - pts : 0;
+        h.Observe(latency);
+
+        const uint64_t idx = head_.fetch_add(1, std::memory_order_relaxed);
+        Slot& slot = ring_[idx % kRingSize];
+        slot.seq.store(2 * idx + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.pts.store(pts, std::memory_order_relaxed);
+        slot.packed.store(std::min<uint64_t>(latency, UINT32_MAX) |
+                              (static_cast<uint64_t>(stage) << 32) |
+                              (static_cast<uint64_t>(tag) << 40),
+                          std::memory_order_relaxed);
+        slot.seq.store(Committed(idx), std::memory_order_release);
+    }
+
+    std::unique_ptr<Slot[]> ring_;
+    std::atomic<uint64_t> head_{0};
+
+    LatencyHistogram* vpss_;
+    LatencyHistogram* inference_;
+    std::array<std::atomic<LatencyHistogram*>, 16> venc_{};   // 按通道缓存，最后一个兼作溢出
+
+    mutable std::mutex mutex_;
+    std::vector<std::string> consumer_names_;
+
+    std::atomic<bool> sei_enabled_{false};
+};
+
+/**
+ * @brief 硬件绑定模式的 SEI 时间戳：取到一帧后按帧间隔预测下一帧 PTS 写入
+ *
+ * 每个取流循环持有一个，仅在取流线程使用
+ */
+class SeiStamper {
+public:
+    void OnFetched(int venc_chn, uint64_t pts) {
+        auto& tracer = LatencyTracer::Instance();
+        if (!tracer.SeiEnabled()) {
+            last_pts_ = 0;
+            return;
+        }
+        if (last_pts_ != 0 && pts > last_pts_) {
+            tracer.StampSei(venc_chn, pts + (pts - last_pts_));
+        }
+        last_pts_ = pts;
+    }
+
+private:
+    uint64_t last_pts_ = 0;
+};
+
+}  // namespace media
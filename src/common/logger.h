@@ -3,15 +3,21 @@
  * @brief 日志管理器 - 基于 spdlog 的模块化日志系统
  *
  * 提供模块级别的日志管理，支持：
- * - 编译时日志级别控制（通过 SPDLOG_ACTIVE_LEVEL）
- * - 模块独立的 logger 实例
+ * - 编译时日志级别控制（通过 SPDLOG_ACTIVE_LEVEL，非 Debug 构建下限为 INFO）
+ * - 模块独立的 logger 实例，共用一个控制台 sink
  * - 统一的日志格式
- * 
+ * - 异步输出（默认）：调用线程只做格式化和入队，后台线程写 stdout；
+ *   队列有界，满时覆盖最旧的日志，串口控制台阻塞不会拖慢采集线程
+ * - 按调用点限频（LOG_WARN_THROTTLED 等），用于“连续错误”类告警
+ *
  * 使用方式：
  * 1. 在模块的 .cpp 文件顶部定义 LOG_TAG
  *    #define LOG_TAG "ModuleName"
  * 2. 使用 LOG_INFO, LOG_ERROR 等宏进行日志输出
  *
+ * 环境变量：AIPC_LOG_MODE=sync 切回同步输出（调试崩溃时保证日志不丢），
+ * AIPC_LOG_QUEUE=N 设置异步队列条数
+ *
  * @author 好软，好温暖
  * @date 2026-01-30
  */
@@ -19,15 +25,42 @@
 #pragma once
 
 #include <spdlog/spdlog.h>
+#include <spdlog/async.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <memory>
 #include <string>
 #include <mutex>
 
+/**
+ * @brief 日志系统配置
+ */
+struct LogConfig {
+    bool async = true;              ///< 异步输出（false 时调用线程直接写 stdout）
+    size_t queue_size = 8192;       ///< 异步队列条数上限（满时覆盖最旧的日志）
+
+    /// 默认配置叠加环境变量 AIPC_LOG_MODE / AIPC_LOG_QUEUE
+    static LogConfig FromEnv() {
+        LogConfig config;
+        if (const char* mode = std::getenv("AIPC_LOG_MODE")) {
+            config.async = std::strcmp(mode, "sync") != 0;
+        }
+        if (const char* queue = std::getenv("AIPC_LOG_QUEUE")) {
+            long n = std::strtol(queue, nullptr, 10);
+            if (n > 0) config.queue_size = static_cast<size_t>(n);
+        }
+        return config;
+    }
+};
+
 /**
  * @class LogManager
  * @brief 日志管理器单例类
- * 
+ *
  * 管理所有模块的 logger 实例，提供统一的日志配置
  */
 class LogManager {
@@ -36,58 +69,130 @@ public:
      * @brief 获取指定模块的 logger 实例
      * @param name 模块名称
      * @return logger 智能指针
-     * 
-     * 如果 logger 不存在则创建新的实例并注册
+     *
+     * 如果 logger 不存在则创建新的实例并注册（Init 之前创建的为同步 logger）
      */
     static std::shared_ptr<spdlog::logger> GetLogger(const std::string& name) {
         auto logger = spdlog::get(name);
-        if (!logger) {
-            // 创建带颜色的控制台输出 logger
-            logger = spdlog::stdout_color_mt(name);
-            
-            // 设置日志格式：[时间] [线程ID] [模块名] [等级] [源文件:行号] 内容
-            // %Y-%m-%d %H:%M:%S.%e : 时间戳（精确到毫秒）
-            // %t : 线程ID
-            // %n : logger 名称（模块名）
-            // %^%l%$ : 带颜色的日志等级
-            // %s:%# : 源文件名:行号
-            // %v : 日志内容
-            logger->set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%t] [%n] [%^%l%$] [%s:%#] %v");
-            
-            // 设置该 logger 的运行时等级为 trace，实际输出受 SPDLOG_ACTIVE_LEVEL 限制
-            logger->set_level(spdlog::level::trace);
+        if (logger) {
+            return logger;
+        }
+
+        State& state = GetState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        logger = spdlog::get(name);    // 其他线程可能已创建
+        if (logger) {
+            return logger;
+        }
+
+        if (!state.sink) {
+            state.sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
         }
+        if (state.async) {
+            logger = std::make_shared<spdlog::async_logger>(
+                name, state.sink, spdlog::thread_pool(),
+                spdlog::async_overflow_policy::overrun_oldest);
+        } else {
+            logger = std::make_shared<spdlog::logger>(name, state.sink);
+        }
+
+        // 设置日志格式：[时间] [线程ID] [模块名] [等级] [源文件:行号] 内容
+        // %Y-%m-%d %H:%M:%S.%e : 时间戳（精确到毫秒）
+        // %t : 线程ID
+        // %n : logger 名称（模块名）
+        // %^%l%$ : 带颜色的日志等级
+        // %s:%# : 源文件名:行号
+        // %v : 日志内容
+        logger->set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%t] [%n] [%^%l%$] [%s:%#] %v");
+
+        // 设置该 logger 的运行时等级为 trace，实际输出受 SPDLOG_ACTIVE_LEVEL 限制
+        logger->set_level(spdlog::level::trace);
+        logger->flush_on(spdlog::level::err);
+        spdlog::register_logger(logger);
         return logger;
     }
 
     /**
      * @brief 全局日志系统初始化
-     * 
-     * 在 main 函数开始时调用，用于配置全局日志设置
-     * 对于嵌入式环境，可以考虑开启异步日志以减少对实时性的影响
+     *
+     * 在 main 函数开始时、创建任何 logger 之前调用
+     * 异步模式下所有 logger 共用一个后台线程，队列满时覆盖最旧的日志（不阻塞调用线程）
      */
-    static void Init() {
+    static void Init(const LogConfig& config = LogConfig::FromEnv()) {
         // 设置全局日志等级（受限于 SPDLOG_ACTIVE_LEVEL）
         spdlog::set_level(spdlog::level::trace);
-        
+
         // 设置全局日志格式
         spdlog::set_pattern("[%Y-%m-%d %H:%M:%S.%e] [%t] [%n] [%^%l%$] [%s:%#] %v");
-        
-        // 异步日志配置（可选，用于高性能场景）
-        // spdlog::init_thread_pool(8192, 1);
-        
+
+        {
+            State& state = GetState();
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (config.async) {
+                spdlog::init_thread_pool(config.queue_size, 1);
+            }
+            state.async = config.async;
+        }
+
         // 创建默认 logger
-        GetLogger("main");
+        auto logger = GetLogger("main");
+        if (config.async) {
+            SPDLOG_LOGGER_INFO(logger, "Async logging enabled (queue={})", config.queue_size);
+        }
     }
 
     /**
      * @brief 关闭日志系统
-     * 
-     * 在程序退出前调用，确保所有日志都被刷新
+     *
+     * 在程序退出前调用，确保所有日志都被刷新（异步模式下等待队列排空）
      */
     static void Shutdown() {
         spdlog::shutdown();
     }
+
+private:
+    struct State {
+        std::mutex mutex;
+        bool async = false;
+        std::shared_ptr<spdlog::sinks::stdout_color_sink_mt> sink;
+    };
+
+    static State& GetState() {
+        static State state;
+        return state;
+    }
+};
+
+/**
+ * @brief 调用点限频器：每个时间窗口最多放行一条，其余计数
+ *
+ * 由 LOG_*_THROTTLED 宏在调用点以静态对象持有，多线程调用安全
+ */
+class LogThrottle {
+public:
+    explicit LogThrottle(uint32_t interval_ms) : interval_ms_(interval_ms) {}
+
+    /**
+     * @brief 是否放行本条日志
+     * @param suppressed 放行时返回上次放行以来被抑制的条数
+     */
+    bool Allow(uint64_t* suppressed) {
+        const int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        int64_t last = last_ms_.load(std::memory_order_relaxed);
+        if ((last != 0 && now - last < static_cast<int64_t>(interval_ms_)) ||
+            !last_ms_.compare_exchange_strong(last, now, std::memory_order_relaxed)) {
+            suppressed_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        *suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+
+private:
+    const uint32_t interval_ms_;
+    std::atomic<int64_t> last_ms_{0};
+    std::atomic<uint64_t> suppressed_{0};
 };
 
 // ========================================
@@ -111,3 +216,22 @@ public:
 #define LOG_WARN(...)     SPDLOG_LOGGER_WARN(GET_LOGGER(), __VA_ARGS__)
 #define LOG_ERROR(...)    SPDLOG_LOGGER_ERROR(GET_LOGGER(), __VA_ARGS__)
 #define LOG_CRITICAL(...) SPDLOG_LOGGER_CRITICAL(GET_LOGGER(), __VA_ARGS__)
+
+// 限频日志宏 - 每个调用点每 interval_ms 最多输出一条，附带期间被抑制的条数
+// 用于热路径上可能逐帧触发的告警（连续取流失败、队列溢出等）
+#define LOG_THROTTLED(LOG_MACRO, interval_ms, ...)                                       \
+    do {                                                                                  \
+        static LogThrottle log_throttle_(interval_ms);                                    \
+        uint64_t log_suppressed_ = 0;                                                     \
+        if (log_throttle_.Allow(&log_suppressed_)) {                                      \
+            if (log_suppressed_ > 0) {                                                    \
+                LOG_MACRO("{} ({} similar suppressed)", fmt::format(__VA_ARGS__),         \
+                          log_suppressed_);                                               \
+            } else {                                                                      \
+                LOG_MACRO(__VA_ARGS__);                                                   \
+            }                                                                             \
+        }                                                                                 \
+    } while (0)
+
+#define LOG_WARN_THROTTLED(interval_ms, ...)  LOG_THROTTLED(LOG_WARN, interval_ms, __VA_ARGS__)
+#define LOG_ERROR_THROTTLED(interval_ms, ...) LOG_THROTTLED(LOG_ERROR, interval_ms, __VA_ARGS__)
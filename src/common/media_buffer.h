@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <memory>
 #include <functional>
 #include <queue>
@@ -23,6 +25,11 @@
 #include <condition_variable>
 #include <cstring>
 #include <cstdio>
+#include <chrono>
+#include <cstddef>
+#include <new>
+#include <string>
+#include <vector>
 
 // RKMPI 头文件
 #include "rk_mpi_sys.h"
@@ -31,6 +38,12 @@
 #include "rk_mpi_venc.h"
 #include "rk_mpi_mb.h"
 
+#include "common/block_pool.h"
+#include "common/frame_arena.h"
+#include "common/latency_trace.h"
+#include "common/metrics.h"
+#include "common/nal_index.h"
+
 // ============================================================================
 // 类型别名定义
 // ============================================================================
@@ -51,6 +64,98 @@ using VideoFramePtr = std::shared_ptr<VIDEO_FRAME_INFO_S>;
  */
 using EncodedStreamPtr = std::shared_ptr<VENC_STREAM_S>;
 
+// ============================================================================
+// 帧句柄内存池 - 取帧时的句柄结构体与 shared_ptr 控制块
+// ============================================================================
+
+namespace media {
+
+/// 同时在途的 VENC 码流句柄上限（各通道 u32StreamBufCnt 之和，留出队列过渡余量）
+constexpr size_t kEncodedStreamHandleSlots = 32;
+/// 同时在途的 VI / VPSS 原始帧句柄上限（各通道 u32Depth 之和，留出推理流水线余量）
+constexpr size_t kVideoFrameHandleSlots = 32;
+/// 单个控制块上限（EncodedStreamDeleter 携带 NAL 索引，约 300 字节）
+constexpr size_t kFrameControlBlockBytes = 512;
+
+/// VENC 码流句柄：包描述与码流描述放在同一个槽位，pstPack 指向内部的 pack
+struct EncodedStreamHandle {
+    VENC_STREAM_S stream;       // 须为首个成员（删除器由 stream 地址归还槽位）
+    VENC_PACK_S pack;
+};
+
+using EncodedStreamHandlePool = FixedBlockPool<sizeof(EncodedStreamHandle), kEncodedStreamHandleSlots>;
+using VideoFrameHandlePool = FixedBlockPool<sizeof(VIDEO_FRAME_INFO_S), kVideoFrameHandleSlots>;
+using FrameControlBlockPool =
+    FixedBlockPool<kFrameControlBlockBytes, kEncodedStreamHandleSlots + kVideoFrameHandleSlots>;
+
+template <typename T>
+using FrameControlBlockAllocator = BlockPoolAllocator<T, FrameControlBlockPool>;
+
+struct FrameHandlePools {
+    EncodedStreamHandlePool streams;
+    VideoFrameHandlePool frames;
+    FrameControlBlockPool control_blocks;
+};
+
+/**
+ * @brief 进程级帧句柄内存池
+ *
+ * 有意不析构：静态对象（如单例中缓存的帧）可能在静态析构阶段才归还句柄
+ */
+inline FrameHandlePools& frame_handle_pools() {
+    static auto* pools = new FrameHandlePools();
+    return *pools;
+}
+
+/**
+ * @brief 帧句柄内存池统计（fallback 非零说明池容量不足，句柄退回堆分配）
+ */
+struct FrameHandlePoolStats {
+    EncodedStreamHandlePool::Stats streams;
+    VideoFrameHandlePool::Stats frames;
+    FrameControlBlockPool::Stats control_blocks;
+};
+
+inline FrameHandlePoolStats get_frame_handle_pool_stats() {
+    auto& pools = frame_handle_pools();
+    return {pools.streams.GetStats(), pools.frames.GetStats(), pools.control_blocks.GetStats()};
+}
+
+/// 从句柄池取一个清零的 VIDEO_FRAME_INFO_S
+inline VIDEO_FRAME_INFO_S* allocate_video_frame_handle() {
+    void* slot = frame_handle_pools().frames.Allocate(sizeof(VIDEO_FRAME_INFO_S));
+    return new (slot) VIDEO_FRAME_INFO_S();
+}
+
+inline void free_video_frame_handle(VIDEO_FRAME_INFO_S* p) {
+    frame_handle_pools().frames.Deallocate(p);
+}
+
+/**
+ * @brief VENC 取流耗时直方图（GetStream 阻塞到拿到码流的时间，按通道）
+ *
+ * 常用通道的直方图引用缓存在数组中，取流时不查注册表
+ */
+inline LatencyHistogram& venc_fetch_histogram(RK_S32 chn_id) {
+    static std::array<std::atomic<LatencyHistogram*>, 16> cache{};
+    auto lookup = [chn_id]() -> LatencyHistogram& {
+        return MetricsRegistry::Instance().Histogram(
+            "aipc_venc_fetch_seconds", "Time blocked in VENC GetStream until a frame is ready",
+            {{"chn", std::to_string(chn_id)}});
+    };
+    if (chn_id < 0 || static_cast<size_t>(chn_id) >= cache.size()) {
+        return lookup();
+    }
+    LatencyHistogram* h = cache[chn_id].load(std::memory_order_acquire);
+    if (!h) {
+        h = &lookup();
+        cache[chn_id].store(h, std::memory_order_release);
+    }
+    return *h;
+}
+
+}  // namespace media
+
 // ============================================================================
 // 工厂函数 - 创建带自动释放功能的智能指针
 // ============================================================================
@@ -66,22 +171,23 @@ using EncodedStreamPtr = std::shared_ptr<VENC_STREAM_S>;
  * @note 返回的智能指针在所有引用释放后会自动调用 RK_MPI_VI_ReleaseChnFrame
  */
 inline VideoFramePtr acquire_video_frame(RK_S32 dev_id, RK_S32 chn_id, RK_S32 timeout_ms = -1) {
-    auto frame = new VIDEO_FRAME_INFO_S();
+    auto frame = media::allocate_video_frame_handle();
     
     RK_S32 ret = RK_MPI_VI_GetChnFrame(dev_id, chn_id, frame, timeout_ms);
     if (ret != RK_SUCCESS) {
-        delete frame;
+        media::free_video_frame_handle(frame);
         return nullptr;
     }
     
-    // 创建带自定义删除器的 shared_ptr
+    // 创建带自定义删除器的 shared_ptr（句柄与控制块都来自帧句柄内存池）
     // 当引用计数归零时，自动释放 MPI 资源
     return VideoFramePtr(frame, [dev_id, chn_id](VIDEO_FRAME_INFO_S* p) {
         if (p) {
             RK_MPI_VI_ReleaseChnFrame(dev_id, chn_id, p);
-            delete p;
+            media::free_video_frame_handle(p);
         }
-    });
+    }, media::FrameControlBlockAllocator<VIDEO_FRAME_INFO_S>(
+        media::frame_handle_pools().control_blocks));
 }
 
 /**
@@ -95,54 +201,72 @@ inline VideoFramePtr acquire_video_frame(RK_S32 dev_id, RK_S32 chn_id, RK_S32 ti
  * @note 返回的智能指针在所有引用释放后会自动调用 RK_MPI_VPSS_ReleaseChnFrame
  */
 inline VideoFramePtr acquire_vpss_frame(RK_S32 grp_id, RK_S32 chn_id, RK_S32 timeout_ms = -1) {
-    auto frame = new VIDEO_FRAME_INFO_S();
+    auto frame = media::allocate_video_frame_handle();
     
     RK_S32 ret = RK_MPI_VPSS_GetChnFrame(grp_id, chn_id, frame, timeout_ms);
     if (ret != RK_SUCCESS) {
-        delete frame;
+        media::free_video_frame_handle(frame);
         return nullptr;
     }
+    media::LatencyTracer::Instance().Record(media::LatencyTracer::Stage::kVpss,
+                                            frame->stVFrame.u64PTS);
     
-    // 创建带自定义删除器的 shared_ptr
+    // 创建带自定义删除器的 shared_ptr（句柄与控制块都来自帧句柄内存池）
     // 当引用计数归零时，自动释放 MPI 资源
     return VideoFramePtr(frame, [grp_id, chn_id](VIDEO_FRAME_INFO_S* p) {
         if (p) {
             RK_MPI_VPSS_ReleaseChnFrame(grp_id, chn_id, p);
-            delete p;
+            media::free_video_frame_handle(p);
         }
-    });
+    }, media::FrameControlBlockAllocator<VIDEO_FRAME_INFO_S>(
+        media::frame_handle_pools().control_blocks));
 }
 
 /**
  * @brief 编码数据的拷贝版本（用于跨线程安全传递）
  * 
  * VENC 的 GetStream/ReleaseStream 必须在同一线程中调用，
- * 因此需要拷贝数据后立即释放 VENC buffer
+ * 因此需要拷贝数据后立即释放 VENC buffer。
+ * 数据与控制块都来自 FrameArena（见 frame_arena.h），析构时 slab 归还池中。
  */
 struct EncodedFrame {
-    std::vector<uint8_t> data;  // 编码数据拷贝
-    uint64_t pts;               // 时间戳
-    uint32_t seq;               // 序列号
-    bool isKeyFrame;            // 是否为关键帧
-    
-    EncodedFrame() : pts(0), seq(0), isKeyFrame(false) {}
-    EncodedFrame(const uint8_t* d, size_t len, uint64_t p, uint32_t s, bool key)
-        : data(d, d + len), pts(p), seq(s), isKeyFrame(key) {}
+    uint64_t pts = 0;           // 时间戳
+    uint32_t seq = 0;           // 序列号
+    bool isKeyFrame = false;    // 是否为关键帧
+
+    EncodedFrame(media::FrameArena* arena, const media::FrameArena::Block& block, size_t len,
+                 uint64_t p, uint32_t s, bool key)
+        : pts(p), seq(s), isKeyFrame(key), arena_(arena), block_(block), size_(len) {}
+    ~EncodedFrame() { arena_->Release(block_); }
+
+    EncodedFrame(const EncodedFrame&) = delete;
+    EncodedFrame& operator=(const EncodedFrame&) = delete;
+
+    const uint8_t* data() const { return block_.data; }   // 编码数据拷贝
+    size_t size() const { return size_; }
+
+private:
+    media::FrameArena* arena_;  // 控制块的分配器持有池的引用，裸指针即可
+    media::FrameArena::Block block_;
+    size_t size_;
 };
 
 using EncodedFramePtr = std::shared_ptr<EncodedFrame>;
 
 /**
- * @brief 从 VENC 通道获取编码流，拷贝数据后立即释放
+ * @brief 从 VENC 通道获取编码流，拷贝到内存池后立即释放
  * 
  * @param chn_id VENC 通道 ID
+ * @param arena 帧拷贝所在的内存池
  * @param timeout_ms 超时时间（毫秒），-1 表示阻塞等待
- * @return EncodedFramePtr 成功返回帧指针，失败返回 nullptr
+ * @return EncodedFramePtr 成功返回帧指针，失败（含内存池已满）返回 nullptr
  * 
  * @note 此函数会拷贝编码数据，然后立即调用 ReleaseStream
  * @note 这样可以避免 GetStream/ReleaseStream 在不同线程调用导致的死锁
  */
-inline EncodedFramePtr acquire_encoded_frame(RK_S32 chn_id, RK_S32 timeout_ms = -1) {
+inline EncodedFramePtr acquire_encoded_frame(RK_S32 chn_id,
+                                             const std::shared_ptr<media::FrameArena>& arena,
+                                             RK_S32 timeout_ms = -1) {
     VENC_STREAM_S stream;
     VENC_PACK_S pack;
     memset(&stream, 0, sizeof(stream));
@@ -167,31 +291,74 @@ inline EncodedFramePtr acquire_encoded_frame(RK_S32 chn_id, RK_S32 timeout_ms =
                        pack.DataType.enH265EType == H265E_NALU_ISLICE ||
                        pack.DataType.enH265EType == H265E_NALU_IDRSLICE);
     
-    // 拷贝数据
-    auto frame = std::make_shared<EncodedFrame>(
-        static_cast<const uint8_t*>(data),
-        pack.u32Len,
-        pack.u64PTS,
-        stream.u32Seq,
-        isKeyFrame
-    );
+    // 拷贝数据到内存池（池满时丢弃本帧）
+    media::FrameArena::Block block;
+    if (!arena->Allocate(pack.u32Len, &block)) {
+        RK_MPI_VENC_ReleaseStream(chn_id, &stream);
+        return nullptr;
+    }
+    memcpy(block.data, data, pack.u32Len);
     
     // 立即释放 VENC buffer（在同一线程中）
     RK_MPI_VENC_ReleaseStream(chn_id, &stream);
     
-    return frame;
+    return std::allocate_shared<EncodedFrame>(
+        arena->HeaderAllocator<EncodedFrame>(),
+        arena.get(), block, pack.u32Len, pack.u64PTS, stream.u32Seq, isKeyFrame);
 }
 
 // ============================================================================
 // 零拷贝编码流接口 - 用于 VENC 输出的跨线程共享
 // ============================================================================
 
+/**
+ * @brief 编码流删除器（同时承载该帧的 NAL 索引）
+ *
+ * NAL 索引存放在 shared_ptr 控制块内的删除器中，不改变 EncodedStreamPtr 类型，
+ * 通过 std::get_deleter 取回。索引由分发器在派发前填充一次，之后只读。
+ *
+ * arena 非空时为脱离 VENC 的拷贝帧（GOP 缓存）：包信息与数据都在 copy slab 中
+ * （布局见 kCopyHeaderBytes），释放时归还 slab，不归还 VENC。
+ *
+ * external 非空时为外部内存中的帧（文件回放）：数据由 owner 持有，只归还句柄槽位。
+ */
+struct EncodedStreamDeleter {
+    /// 拷贝帧 slab 中数据之前的包信息（VENC_STREAM_S + VENC_PACK_S）
+    static constexpr size_t kCopyPackOffset =
+        (sizeof(VENC_STREAM_S) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+    static constexpr size_t kCopyHeaderBytes =
+        (kCopyPackOffset + sizeof(VENC_PACK_S) + alignof(std::max_align_t) - 1) &
+        ~(alignof(std::max_align_t) - 1);
+
+    RK_S32 chn_id = 0;
+    bool indexed = false;
+    media::NalIndex nal;
+    media::FrameArena* arena = nullptr;     // 控制块的分配器持有池的引用
+    media::FrameArena::Block copy;
+    const uint8_t* external = nullptr;      // 外部帧数据（owner 释放前有效）
+    std::shared_ptr<const void> owner;
+
+    void operator()(VENC_STREAM_S* p) const {
+        if (p) {
+            if (arena) {
+                arena->Release(copy);
+                return;
+            }
+            if (!external) {
+                RK_MPI_VENC_ReleaseStream(chn_id, p);
+            }
+            media::frame_handle_pools().streams.Deallocate(p);   // 句柄槽位（见 EncodedStreamHandle）
+        }
+    }
+};
+
 /**
  * @brief 从 VENC 通道获取编码流并包装为智能指针
  * 
  * 使用 shared_ptr 的引用计数管理 VENC buffer 生命周期：
  * - 获取时调用 GetStream
  * - 最后一个使用者释放时自动调用 ReleaseStream
+ * - 码流 / 包描述共用一个句柄槽位，控制块来自控制块池，取帧不做堆分配
  * 
  * @param chn_id VENC 通道 ID
  * @param timeout_ms 超时时间（毫秒），-1 表示阻塞等待
@@ -199,27 +366,27 @@ inline EncodedFramePtr acquire_encoded_frame(RK_S32 chn_id, RK_S32 timeout_ms =
  * @return EncodedStreamPtr 成功返回流指针，失败返回 nullptr
  */
 inline EncodedStreamPtr acquire_encoded_stream(RK_S32 chn_id, RK_S32 timeout_ms = -1, RK_S32* lastError = nullptr) {
-    auto stream = new VENC_STREAM_S();
-    memset(stream, 0, sizeof(VENC_STREAM_S));
-    stream->pstPack = new VENC_PACK_S();
-    memset(stream->pstPack, 0, sizeof(VENC_PACK_S));
+    auto& pools = media::frame_handle_pools();
+    auto* handle = new (pools.streams.Allocate(sizeof(media::EncodedStreamHandle)))
+        media::EncodedStreamHandle();
+    VENC_STREAM_S* stream = &handle->stream;
+    stream->pstPack = &handle->pack;
     
+    const auto start = std::chrono::steady_clock::now();
     RK_S32 ret = RK_MPI_VENC_GetStream(chn_id, stream, timeout_ms);
     if (ret != RK_SUCCESS) {
         if (lastError) *lastError = ret;
-        delete stream->pstPack;
-        delete stream;
+        pools.streams.Deallocate(handle);
         return nullptr;
     }
+    media::venc_fetch_histogram(chn_id).ObserveSince(start);
+    media::LatencyTracer::Instance().RecordVenc(chn_id, handle->pack.u64PTS);
     
     // 创建带自定义删除器的 shared_ptr
-    return EncodedStreamPtr(stream, [chn_id](VENC_STREAM_S* p) {
-        if (p) {
-            RK_MPI_VENC_ReleaseStream(chn_id, p);
-            delete p->pstPack;
-            delete p;
-        }
-    });
+    EncodedStreamDeleter deleter;
+    deleter.chn_id = chn_id;
+    return EncodedStreamPtr(stream, std::move(deleter),
+                            media::FrameControlBlockAllocator<VENC_STREAM_S>(pools.control_blocks));
 }
 
 // ============================================================================
@@ -248,6 +415,17 @@ inline RK_U64 get_frame_phy_addr(const VideoFramePtr& frame) {
     return RK_MPI_MB_Handle2PhysAddr(frame->stVFrame.pMbBlk);
 }
 
+/**
+ * @brief 从视频帧获取 DMA-BUF fd（供 RGA/NPU 零拷贝导入）
+ * 
+ * @param frame 视频帧智能指针
+ * @return int fd，失败返回 -1
+ */
+inline int get_frame_fd(const VideoFramePtr& frame) {
+    if (!frame) return -1;
+    return RK_MPI_MB_Handle2Fd(frame->stVFrame.pMbBlk);
+}
+
 /**
  * @brief 从编码流获取数据虚拟地址
  * 
@@ -256,6 +434,9 @@ inline RK_U64 get_frame_phy_addr(const VideoFramePtr& frame) {
  */
 inline void* get_stream_vir_addr(const EncodedStreamPtr& stream) {
     if (!stream || !stream->pstPack) return nullptr;
+    auto* deleter = std::get_deleter<EncodedStreamDeleter>(stream);
+    if (deleter && deleter->arena) return deleter->copy.data + EncodedStreamDeleter::kCopyHeaderBytes;
+    if (deleter && deleter->external) return const_cast<uint8_t*>(deleter->external);
     return RK_MPI_MB_Handle2VirAddr(stream->pstPack->pMbBlk);
 }
 
@@ -281,6 +462,142 @@ inline RK_U64 get_stream_pts(const EncodedStreamPtr& stream) {
     return stream->pstPack->u64PTS;
 }
 
+/**
+ * @brief 判断编码流是否为关键帧（I 帧 / IDR 帧）
+ * 
+ * @param stream 编码流智能指针
+ * @return true 关键帧
+ */
+inline bool is_stream_keyframe(const EncodedStreamPtr& stream) {
+    if (!stream || !stream->pstPack) return false;
+    const auto& type = stream->pstPack->DataType;
+    return type.enH264EType == H264E_NALU_ISLICE ||
+           type.enH264EType == H264E_NALU_IDRSLICE ||
+           type.enH265EType == H265E_NALU_ISLICE ||
+           type.enH265EType == H265E_NALU_IDRSLICE;
+}
+
+/**
+ * @brief 为编码流建立 NAL 索引（分发器在派发前调用一次）
+ *
+ * @param stream 编码流智能指针（须由 acquire_encoded_stream 创建）
+ * @param codec 编码格式
+ * @param params 跨帧参数集缓存，本帧携带新参数集时被更新
+ * @return 索引指针，stream 无效时返回 nullptr
+ */
+inline const media::NalIndex* index_stream_nals(const EncodedStreamPtr& stream,
+                                                 media::VideoCodec codec,
+                                                 media::ParameterSetsPtr* params = nullptr) {
+    auto* deleter = std::get_deleter<EncodedStreamDeleter>(stream);
+    if (!deleter) return nullptr;
+    if (deleter->indexed) return &deleter->nal;
+
+    const auto* data = static_cast<const uint8_t*>(get_stream_vir_addr(stream));
+    media::build_nal_index(data, get_stream_length(stream), codec, &deleter->nal);
+    // 码流中未找到 IDR 时以 VENC 给出的帧类型为准
+    deleter->nal.is_keyframe = deleter->nal.is_keyframe || is_stream_keyframe(stream);
+    if (params) {
+        *params = media::update_parameter_sets(data, deleter->nal, *params);
+        deleter->nal.params = *params;
+    }
+    deleter->indexed = true;
+    return &deleter->nal;
+}
+
+/**
+ * @brief 获取编码流已建立的 NAL 索引
+ *
+ * @param stream 编码流智能指针
+ * @return 索引指针，未经分发器索引时返回 nullptr（调用方需自行 build_nal_index）
+ */
+inline const media::NalIndex* get_stream_nal_index(const EncodedStreamPtr& stream) {
+    auto* deleter = std::get_deleter<EncodedStreamDeleter>(stream);
+    return (deleter && deleter->indexed) ? &deleter->nal : nullptr;
+}
+
+/**
+ * @brief 把编码流拷贝到内存池，得到不占用 VENC buffer 的独立帧
+ *
+ * 拷贝帧保留原帧的包信息与 NAL 索引（偏移相对帧首，拷贝后仍然有效），
+ * 可直接交给任意消费者；数据地址须经 get_stream_vir_addr() 获取。
+ * 包信息、数据共用一块 slab，控制块来自同一个池的头部块，稳态下不做堆分配。
+ *
+ * @param stream 源编码流
+ * @param arena 目标内存池
+ * @return EncodedStreamPtr 拷贝帧，源帧无效或内存池已满时返回 nullptr
+ */
+inline EncodedStreamPtr copy_encoded_stream(const EncodedStreamPtr& stream,
+                                            const std::shared_ptr<media::FrameArena>& arena) {
+    const auto* data = static_cast<const uint8_t*>(get_stream_vir_addr(stream));
+    RK_U32 len = get_stream_length(stream);
+    if (!data || len == 0 || !arena) return nullptr;
+
+    media::FrameArena::Block block;
+    if (!arena->Allocate(EncodedStreamDeleter::kCopyHeaderBytes + len, &block)) {
+        return nullptr;
+    }
+
+    auto* copy = new (block.data) VENC_STREAM_S(*stream);
+    copy->pstPack = new (block.data + EncodedStreamDeleter::kCopyPackOffset)
+        VENC_PACK_S(*stream->pstPack);
+    copy->pstPack->pMbBlk = nullptr;
+    copy->u32PackCount = 1;
+    memcpy(block.data + EncodedStreamDeleter::kCopyHeaderBytes, data, len);
+
+    EncodedStreamDeleter deleter;
+    auto* src = std::get_deleter<EncodedStreamDeleter>(stream);
+    if (src) {
+        deleter.chn_id = src->chn_id;
+        deleter.indexed = src->indexed;
+        deleter.nal = src->nal;
+    }
+    deleter.arena = arena.get();
+    deleter.copy = block;
+    return EncodedStreamPtr(copy, std::move(deleter),
+                            arena->HeaderAllocator<VENC_STREAM_S>());
+}
+
+/**
+ * @brief 把外部内存中的一帧 Annex-B 数据包装为编码流（文件回放等不经过 VENC 的来源）
+ *
+ * 不拷贝数据：帧持有 owner 的引用（如文件映射），所有引用释放后 owner 才会析构。
+ * 句柄与控制块来自与 acquire_encoded_stream 相同的池，消费者无需区分来源。
+ *
+ * @param data 帧数据（含起始码）
+ * @param len 数据长度
+ * @param pts 时间戳（微秒）
+ * @param keyframe 是否为关键帧（含 IDR）
+ * @param codec 编码格式（决定包类型字段）
+ * @param owner 数据所有者
+ * @return EncodedStreamPtr 编码流，data 为空时返回 nullptr
+ */
+inline EncodedStreamPtr wrap_external_stream(const uint8_t* data, RK_U32 len, RK_U64 pts,
+                                             bool keyframe, media::VideoCodec codec,
+                                             std::shared_ptr<const void> owner) {
+    if (!data || len == 0) return nullptr;
+
+    auto& pools = media::frame_handle_pools();
+    auto* handle = new (pools.streams.Allocate(sizeof(media::EncodedStreamHandle)))
+        media::EncodedStreamHandle();
+    VENC_STREAM_S* stream = &handle->stream;
+    stream->pstPack = &handle->pack;
+    stream->u32PackCount = 1;
+    handle->pack.u32Len = len;
+    handle->pack.u64PTS = pts;
+    if (codec == media::VideoCodec::kH265) {
+        handle->pack.DataType.enH265EType = keyframe ? H265E_NALU_IDRSLICE : H265E_NALU_PSLICE;
+    } else {
+        handle->pack.DataType.enH264EType = keyframe ? H264E_NALU_IDRSLICE : H264E_NALU_PSLICE;
+    }
+
+    EncodedStreamDeleter deleter;
+    deleter.chn_id = -1;
+    deleter.external = data;
+    deleter.owner = std::move(owner);
+    return EncodedStreamPtr(stream, std::move(deleter),
+                            media::FrameControlBlockAllocator<VENC_STREAM_S>(pools.control_blocks));
+}
+
 // ============================================================================
 // 线程安全的媒体队列 - 用于模块间数据分发
 // ============================================================================
@@ -386,11 +703,14 @@ public:
     
     /**
      * @brief 清空队列
+     * @return 被清除的元素数量
      */
-    void clear() {
+    size_t clear() {
         std::lock_guard<std::mutex> lock(mutex_);
+        size_t count = queue_.size();
         std::queue<T> empty;
         std::swap(queue_, empty);
+        return count;
     }
     
     /**
@@ -409,6 +729,11 @@ public:
         return queue_.empty();
     }
 
+    /**
+     * @brief 获取队列最大容量（0 表示无限制）
+     */
+    size_t capacity() const { return max_size_; }
+
 private:
     std::queue<T> queue_;
     mutable std::mutex mutex_;
@@ -0,0 +1,315 @@
+/**
+ * @file metrics.h
+ * @brief 流水线指标注册表 - 原子计数器 + 定长分桶延迟直方图，Prometheus 文本格式导出
+ *
+ * 热路径只做 relaxed 原子加，不加锁、不分配：
+ * - 指标在注册时（初始化阶段，持锁）创建，调用方缓存返回的引用，地址在进程内不变
+ * - 同名同标签重复注册返回同一个指标（模式切换重建生产者时统计连续）
+ * - 直方图按微秒分桶，导出时换算为秒并累加为 Prometheus 的累计桶
+ *
+ * 采集时才计算的状态（队列深度、丢帧数等）由导出方经 PrometheusWriter 追加。
+ *
+ * @note header-only，线程安全；指标不注销（数量在启动后固定）
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-14
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace media {
+
+// ============================================================================
+// 指标类型
+// ============================================================================
+
+/**
+ * @brief 单调递增计数器
+ */
+class MetricCounter {
+public:
+    void Add(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t Value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value_{0};
+};
+
+/**
+ * @brief 定长分桶延迟直方图（微秒）
+ *
+ * 桶边界覆盖 100us ~ 1s，超出最后一个边界的样本计入 +Inf 桶
+ */
+class LatencyHistogram {
+public:
+    static constexpr std::array<uint64_t, 13> kBoundsUs = {
+        100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000,
+        100000, 250000, 500000, 1000000};
+    static constexpr size_t kBuckets = kBoundsUs.size() + 1;   ///< 含 +Inf
+
+    struct Snapshot {
+        std::array<uint64_t, kBuckets> buckets{};   ///< 各桶（非累计）样本数
+        uint64_t count = 0;
+        uint64_t sum_us = 0;
+    };
+
+    void Observe(uint64_t us) {
+        size_t i = 0;
+        while (i < kBoundsUs.size() && us > kBoundsUs[i]) ++i;
+        buckets_[i].fetch_add(1, std::memory_order_relaxed);
+        sum_us_.fetch_add(us, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// 记录从 start 到现在的耗时
+    void ObserveSince(std::chrono::steady_clock::time_point start) {
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        Observe(us > 0 ? static_cast<uint64_t>(us) : 0);
+    }
+
+    Snapshot Read() const {
+        Snapshot s;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            s.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+        }
+        s.count = count_.load(std::memory_order_relaxed);
+        s.sum_us = sum_us_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_us_{0};
+};
+
+/**
+ * @brief 作用域计时：析构时把经过的时间记入直方图（histogram 为空时不计时）
+ */
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyHistogram* histogram)
+        : histogram_(histogram),
+          start_(histogram ? std::chrono::steady_clock::now()
+                           : std::chrono::steady_clock::time_point()) {}
+    ~ScopedLatency() {
+        if (histogram_) histogram_->ObserveSince(start_);
+    }
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    LatencyHistogram* histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// ============================================================================
+// Prometheus 文本格式
+// ============================================================================
+
+/**
+ * @brief Prometheus 文本格式（0.0.4）写入器
+ *
+ * 标签以 {{"key", "value"}, ...} 传入，值中的 \ " 换行按格式转义
+ */
+class PrometheusWriter {
+public:
+    using Labels = std::vector<std::pair<std::string, std::string>>;
+
+    /// 写入指标族的 HELP / TYPE 行（每个指标族一次）
+    void Family(const std::string& name, const char* type, const std::string& help) {
+        out_ += "# HELP " + name + " " + help + "\n";
+        out_ += "# TYPE " + name + " " + type + "\n";
+    }
+
+    void Sample(const std::string& name, const Labels& labels, double value) {
+        out_ += name;
+        AppendLabels(labels);
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), " %.9g\n", value);
+        out_ += buf;
+    }
+
+    void Sample(const std::string& name, const Labels& labels, uint64_t value) {
+        out_ += name;
+        AppendLabels(labels);
+        out_ += " " + std::to_string(value) + "\n";
+    }
+
+    /// 写入一个直方图序列（_bucket 为累计值，单位秒）
+    void Histogram(const std::string& name, const Labels& labels,
+                   const LatencyHistogram::Snapshot& s) {
+        Labels bucket_labels = labels;
+        bucket_labels.emplace_back("le", "");
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < LatencyHistogram::kBuckets; ++i) {
+            cumulative += s.buckets[i];
+            if (i < LatencyHistogram::kBoundsUs.size()) {
+                char le[24];
+                std::snprintf(le, sizeof(le), "%g", LatencyHistogram::kBoundsUs[i] / 1e6);
+                bucket_labels.back().second = le;
+            } else {
+                bucket_labels.back().second = "+Inf";
+            }
+            Sample(name + "_bucket", bucket_labels, cumulative);
+        }
+        Sample(name + "_sum", labels, static_cast<double>(s.sum_us) / 1e6);
+        Sample(name + "_count", labels, s.count);
+    }
+
+    const std::string& str() const { return out_; }
+    std::string Take() { return std::move(out_); }
+
+private:
+    void AppendLabels(const Labels& labels) {
+        if (labels.empty()) return;
+        out_ += '{';
+        for (size_t i = 0; i < labels.size(); ++i) {
+            if (i > 0) out_ += ',';
+            out_ += labels[i].first;
+            out_ += "=\"";
+            for (char ch : labels[i].second) {
+                if (ch == '\\' || ch == '"') {
+                    out_ += '\\';
+                    out_ += ch;
+                } else if (ch == '\n') {
+                    out_ += "\\n";
+                } else {
+                    out_ += ch;
+                }
+            }
+            out_ += '"';
+        }
+        out_ += '}';
+    }
+
+    std::string out_;
+};
+
+// ============================================================================
+// 注册表
+// ============================================================================
+
+/**
+ * @brief 进程级指标注册表
+ *
+ * 使用方式：
+ * @code
+ * auto& h = MetricsRegistry::Instance().Histogram(
+ *     "aipc_inference_seconds", "NPU inference time", {{"model", "yolov5"}});
+ * ...
+ * h.ObserveSince(start);   // 热路径：仅原子操作
+ * @endcode
+ */
+class MetricsRegistry {
+public:
+    using Labels = PrometheusWriter::Labels;
+
+    /// 有意不析构：静态析构阶段仍可能有线程在记录指标
+    static MetricsRegistry& Instance() {
+        static auto* registry = new MetricsRegistry();
+        return *registry;
+    }
+
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    /// 注册（或取回已注册的）直方图；help 以首次注册为准
+    LatencyHistogram& Histogram(const std::string& name, const std::string& help,
+                                const Labels& labels = {}) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return Find(histograms_, name, help, labels);
+    }
+
+    /// 注册（或取回已注册的）计数器；name 按惯例以 _total 结尾
+    MetricCounter& Counter(const std::string& name, const std::string& help,
+                           const Labels& labels = {}) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return Find(counters_, name, help, labels);
+    }
+
+    /// 导出所有已注册指标
+    void Render(PrometheusWriter& out) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& [name, family] : counters_) {
+            out.Family(name, "counter", family.help);
+            for (const auto& series : family.series) {
+                out.Sample(name, series.labels, series.metric->Value());
+            }
+        }
+        for (const auto& [name, family] : histograms_) {
+            out.Family(name, "histogram", family.help);
+            for (const auto& series : family.series) {
+                out.Histogram(name, series.labels, series.metric->Read());
+            }
+        }
+    }
+
+private:
+    MetricsRegistry() = default;
+
+    template <typename T>
+    struct Family {
+        struct Series {
+            Labels labels;
+            std::unique_ptr<T> metric;
+        };
+        std::string help;
+        std::vector<Series> series;
+    };
+
+    template <typename T>
+    static T& Find(std::map<std::string, Family<T>>& families, const std::string& name,
+                   const std::string& help, const Labels& labels) {
+        auto& family = families[name];
+        if (family.help.empty()) family.help = help;
+        for (auto& series : family.series) {
+            if (series.labels == labels) return *series.metric;
+        }
+        family.series.push_back({labels, std::make_unique<T>()});
+        return *family.series.back().metric;
+    }
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Family<MetricCounter>> counters_;
+    std::map<std::string, Family<LatencyHistogram>> histograms_;
+};
+
+// ============================================================================
+// 流水线阶段
+// ============================================================================
+
+/**
+ * @brief AI 推理各阶段耗时（按模型区分，生产者缓存一份）
+ */
+struct InferenceStageMetrics {
+    LatencyHistogram& preprocess;   ///< NV12/RGB -> 模型输入（letterbox）
+    LatencyHistogram& inference;    ///< NPU 推理
+    LatencyHistogram& postprocess;  ///< 取结果 + 坐标映射 + 叠框 / 事件
+
+    static InferenceStageMetrics ForModel(const std::string& model) {
+        auto stage = [&model](const char* name) -> LatencyHistogram& {
+            return MetricsRegistry::Instance().Histogram(
+                "aipc_ai_stage_seconds", "Time spent in each AI pipeline stage",
+                {{"model", model}, {"stage", name}});
+        };
+        return {stage("preprocess"), stage("inference"), stage("postprocess")};
+    }
+};
+
+}  // namespace media
@@ -0,0 +1,232 @@
+/**
+ * @file nal_index.h
+ * @brief NAL 单元索引 - 编码帧的一次性 Annex-B 解析结果
+ *
+ * VENC 输出的每一帧都是 Annex-B 码流（起始码 + NAL），WebRTC、WebSocket 预览、
+ * MP4 录制都需要知道帧内 NAL 的边界、类型、是否为关键帧以及 SPS/PPS/VPS。
+ * 分发器在派发前解析一次并把结果附着在 EncodedStreamPtr 上，消费者直接读取，
+ * 不再各自逐字节扫描。
+ *
+ * 解析方式：
+ * - 用 memchr 定位 0x01，再回看前导零确认起始码（3 字节或 4 字节）
+ * - NAL 数量上限为 kMaxUnits，超出部分只标记 truncated，不影响已记录的单元
+ * - 参数集（SPS/PPS/VPS）跨帧缓存在 ParameterSets 中，所有帧共享同一份快照
+ *
+ * @note header-only，不依赖 RKMPI，可在任意模块中使用
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-12
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "common/video_codec.h"
+
+namespace media {
+
+// ============================================================================
+// 类型定义
+// ============================================================================
+
+/**
+ * @brief 单个 NAL 单元在帧内的位置
+ */
+struct NalUnit {
+    uint32_t offset = 0;            ///< 起始码在帧内的偏移
+    uint32_t size = 0;              ///< 含起始码的总长度
+    uint8_t start_code_len = 0;     ///< 起始码长度（3 或 4）
+    uint8_t type = 0;               ///< NAL 类型（H.264: 5 bit，H.265: 6 bit）
+
+    /// 去掉起始码后的 NAL 偏移
+    uint32_t PayloadOffset() const { return offset + start_code_len; }
+    /// 去掉起始码后的 NAL 长度
+    uint32_t PayloadSize() const { return size - start_code_len; }
+};
+
+/**
+ * @brief 跨帧缓存的参数集（不含起始码的原始 NAL）
+ *
+ * 只在参数集内容变化时重新分配，未变化的帧共享同一个 shared_ptr
+ */
+struct ParameterSets {
+    VideoCodec codec = VideoCodec::kH264;
+    std::vector<uint8_t> vps;       ///< 仅 H.265
+    std::vector<uint8_t> sps;
+    std::vector<uint8_t> pps;
+
+    bool IsComplete() const {
+        return !sps.empty() && !pps.empty() && (codec != VideoCodec::kH265 || !vps.empty());
+    }
+};
+
+using ParameterSetsPtr = std::shared_ptr<const ParameterSets>;
+
+/**
+ * @brief 一帧编码数据的 NAL 索引
+ */
+struct NalIndex {
+    static constexpr size_t kMaxUnits = 16;
+
+    VideoCodec codec = VideoCodec::kH264;
+    NalUnit units[kMaxUnits];
+    uint8_t count = 0;              ///< 已记录的 NAL 数量
+    bool truncated = false;         ///< NAL 数量超过 kMaxUnits
+    bool is_keyframe = false;       ///< 含 IDR/IRAP 帧或参数集
+    int8_t vps = -1;                ///< 本帧 VPS 在 units 中的下标（-1 = 无）
+    int8_t sps = -1;                ///< 本帧 SPS 下标
+    int8_t pps = -1;                ///< 本帧 PPS 下标
+    int8_t idr = -1;                ///< 本帧首个 IDR/IRAP 下标
+
+    ParameterSetsPtr params;        ///< 截至本帧的最新参数集（分发器填充，可能为空）
+
+    const NalUnit* Unit(int8_t i) const { return i >= 0 ? &units[i] : nullptr; }
+};
+
+// ============================================================================
+// NAL 类型判断
+// ============================================================================
+
+inline uint8_t nal_header_type(VideoCodec codec, uint8_t header) {
+    return codec == VideoCodec::kH265 ? static_cast<uint8_t>((header >> 1) & 0x3F)
+                                      : static_cast<uint8_t>(header & 0x1F);
+}
+
+inline bool nal_is_idr(VideoCodec codec, uint8_t type) {
+    // H.264: 5 = IDR；H.265: 16~21 = IRAP（BLA/IDR/CRA）
+    return codec == VideoCodec::kH265 ? (type >= 16 && type <= 21) : type == 5;
+}
+
+inline bool nal_is_vps(VideoCodec codec, uint8_t type) {
+    return codec == VideoCodec::kH265 && type == 32;
+}
+
+inline bool nal_is_sps(VideoCodec codec, uint8_t type) {
+    return codec == VideoCodec::kH265 ? type == 33 : type == 7;
+}
+
+inline bool nal_is_pps(VideoCodec codec, uint8_t type) {
+    return codec == VideoCodec::kH265 ? type == 34 : type == 8;
+}
+
+// ============================================================================
+// 解析
+// ============================================================================
+
+/**
+ * @brief 单次扫描 Annex-B 数据，建立 NAL 索引
+ *
+ * @param data 帧数据（Annex-B，带起始码）
+ * @param size 数据长度
+ * @param codec 编码格式
+ * @param index 输出索引（params 字段保持不变）
+ * @return 找到的 NAL 数量
+ */
+inline size_t build_nal_index(const uint8_t* data, size_t size, VideoCodec codec,
+                              NalIndex* index) {
+    index->codec = codec;
+    index->count = 0;
+    index->truncated = false;
+    index->is_keyframe = false;
+    index->vps = index->sps = index->pps = index->idr = -1;
+    if (!data || size < 4) return 0;
+
+    NalUnit* prev = nullptr;
+    size_t pos = 2;
+    while (pos < size) {
+        const void* hit = memchr(data + pos, 0x01, size - pos);
+        if (!hit) break;
+        size_t one = static_cast<size_t>(static_cast<const uint8_t*>(hit) - data);
+        pos = one + 1;
+        if (data[one - 1] != 0 || data[one - 2] != 0 || one + 1 >= size) continue;
+
+        size_t sc_len = (one >= 3 && data[one - 3] == 0) ? 4 : 3;
+        size_t sc_offset = one + 1 - sc_len;
+        if (prev) {
+            prev->size = static_cast<uint32_t>(sc_offset - prev->offset);
+        }
+
+        if (index->count >= NalIndex::kMaxUnits) {
+            index->truncated = true;
+            prev = nullptr;
+            break;
+        }
+
+        int8_t slot = static_cast<int8_t>(index->count++);
+        NalUnit& unit = index->units[slot];
+        unit.offset = static_cast<uint32_t>(sc_offset);
+        unit.start_code_len = static_cast<uint8_t>(sc_len);
+        unit.type = nal_header_type(codec, data[one + 1]);
+        prev = &unit;
+
+        if (nal_is_idr(codec, unit.type)) {
+            if (index->idr < 0) index->idr = slot;
+            index->is_keyframe = true;
+        } else if (nal_is_sps(codec, unit.type)) {
+            if (index->sps < 0) index->sps = slot;
+            index->is_keyframe = true;
+        } else if (nal_is_pps(codec, unit.type)) {
+            if (index->pps < 0) index->pps = slot;
+        } else if (nal_is_vps(codec, unit.type)) {
+            if (index->vps < 0) index->vps = slot;
+        }
+
+        // 跳过 NAL 头，避免把头字节误判为起始码
+        pos = one + 2;
+    }
+
+    if (prev) {
+        prev->size = static_cast<uint32_t>(size - prev->offset);
+    }
+    return index->count;
+}
+
+/**
+ * @brief 用本帧的参数集更新跨帧缓存
+ *
+ * 本帧未携带参数集或内容与缓存一致时返回原指针（不分配）
+ *
+ * @param data 帧数据
+ * @param index 本帧 NAL 索引
+ * @param current 当前缓存（可为空）
+ * @return 更新后的参数集快照
+ */
+inline ParameterSetsPtr update_parameter_sets(const uint8_t* data, const NalIndex& index,
+                                              const ParameterSetsPtr& current) {
+    if (index.sps < 0 && index.pps < 0 && index.vps < 0) return current;
+
+    auto same = [data](const NalUnit* unit, const std::vector<uint8_t>& cached) {
+        return !unit || (cached.size() == unit->PayloadSize() &&
+                         memcmp(cached.data(), data + unit->PayloadOffset(),
+                                cached.size()) == 0);
+    };
+    if (current && current->codec == index.codec &&
+        same(index.Unit(index.vps), current->vps) &&
+        same(index.Unit(index.sps), current->sps) &&
+        same(index.Unit(index.pps), current->pps)) {
+        return current;
+    }
+
+    auto fresh = current ? std::make_shared<ParameterSets>(*current)
+                         : std::make_shared<ParameterSets>();
+    if (fresh->codec != index.codec) {
+        *fresh = ParameterSets{};
+        fresh->codec = index.codec;
+    }
+    auto assign = [data](const NalUnit* unit, std::vector<uint8_t>& out) {
+        if (unit) {
+            out.assign(data + unit->PayloadOffset(),
+                       data + unit->PayloadOffset() + unit->PayloadSize());
+        }
+    };
+    assign(index.Unit(index.vps), fresh->vps);
+    assign(index.Unit(index.sps), fresh->sps);
+    assign(index.Unit(index.pps), fresh->pps);
+    return fresh;
+}
+
+}  // namespace media
@@ -0,0 +1,99 @@
+/**
+ * @file spsc_ring.h
+ * @brief 无锁单生产者 / 单消费者环形队列
+ *
+ * 用于分发线程 -> IO strand 的逐帧交接（见 stream_dispatcher.h）：
+ * - 槽位在构造时一次分配，TryPush / TryPop 只做一次原子读写，不加锁、不分配
+ * - 容量向上取整为 2 的幂，下标用掩码回绕
+ * - 满时 TryPush 返回 false，溢出策略由调用方决定（环形队列本身从不覆盖）
+ * - 生产者与消费者的下标各占一个缓存行，避免伪共享
+ *
+ * 线程约束：同一时刻只能有一个生产者线程、一个消费者线程。
+ * 生产者（或消费者）在不同线程间切换时，须由外部同步保证先后（如互斥锁或 strand）。
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-14
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+template <typename T>
+class SpscRing {
+public:
+    /**
+     * @param capacity 最少容纳的元素数（向上取整为 2 的幂，至少为 2）
+     */
+    explicit SpscRing(size_t capacity)
+        : capacity_(RoundUpPow2(capacity < 2 ? 2 : capacity)),
+          mask_(capacity_ - 1),
+          slots_(new T[capacity_]) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    /**
+     * @brief 入队（仅生产者线程）
+     * @return false 队列已满，item 保持不变
+     */
+    bool TryPush(T&& item) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) >= capacity_) {
+            return false;
+        }
+        slots_[head & mask_] = std::move(item);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool TryPush(const T& item) {
+        T copy(item);
+        return TryPush(std::move(copy));
+    }
+
+    /**
+     * @brief 出队（仅消费者线程），槽位被移走后不再持有元素
+     * @return false 队列为空
+     */
+    bool TryPop(T& out) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        out = std::move(slots_[tail & mask_]);
+        slots_[tail & mask_] = T();
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// 近似元素数（任意线程，仅供统计）
+    size_t Size() const {
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        const size_t head = head_.load(std::memory_order_acquire);
+        return head >= tail ? head - tail : 0;
+    }
+
+    bool Empty() const { return Size() == 0; }
+
+    size_t capacity() const { return capacity_; }
+
+private:
+    static size_t RoundUpPow2(size_t n) {
+        size_t v = 1;
+        while (v < n) v <<= 1;
+        return v;
+    }
+
+    static constexpr size_t kCacheLine = 64;
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<T[]> slots_;
+
+    alignas(kCacheLine) std::atomic<size_t> head_{0};   ///< 下一个写入位置（生产者）
+    alignas(kCacheLine) std::atomic<size_t> tail_{0};   ///< 下一个读取位置（消费者）
+};
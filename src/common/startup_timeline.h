@@ -0,0 +1,169 @@
+/**
+ * @file startup_timeline.h
+ * @brief 启动时间线 - 记录各启动阶段的起止时刻，首帧出流时打印汇总
+ *
+ * 启动按依赖关系并行：媒体链路（ISP/VI/VPSS/VENC）在独立线程初始化，
+ * 网络服务（流管理器、RTSP 监听、HTTP API）在主线程同时创建，模型预加载在后台进行，
+ * 不阻塞出流。各阶段用 Scope 记录起止，时间以 main() 开始为零点：
+ *
+ *   Startup timeline (first_frame at 812ms, process launched at uptime 3.41s):
+ *     +    3ms ..   641ms ( 638ms)  capture_core
+ *     +    3ms ..    36ms (  33ms)  stream_manager
+ *     ...
+ *     +  812ms                     first_frame
+ *
+ * 首帧之后时间线冻结（Complete），后续模式切换等冷启动路径的 Scope 直接返回。
+ *
+ * @note header-only，线程安全
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-18
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "common/logger.h"
+
+namespace media {
+
+class StartupTimeline {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /// 首帧目标耗时（看门狗复位后需尽快恢复出流），超出时告警
+    static constexpr int64_t kBudgetMs = 2000;
+
+    /// 一个阶段（end_ms < 0 表示瞬时事件或尚未结束）
+    struct Entry {
+        std::string name;
+        int64_t start_ms = 0;
+        int64_t end_ms = -1;
+    };
+
+    /// 有意不析构：后台线程可能在静态析构阶段仍持有 Scope
+    static StartupTimeline& Instance() {
+        static auto* timeline = new StartupTimeline();
+        return *timeline;
+    }
+
+    /**
+     * @brief 阶段计时（构造时开始，析构时结束）
+     */
+    class Scope {
+    public:
+        explicit Scope(const char* name) : index_(Instance().Begin(name)) {}
+        ~Scope() { Instance().End(index_); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        int index_;
+    };
+
+    /**
+     * @brief 开始一个阶段
+     * @return 阶段序号（传给 End；时间线已冻结时为 -1）
+     */
+    int Begin(const char* name) {
+        if (completed_.load(std::memory_order_acquire)) {
+            return -1;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.push_back(Entry{name, ElapsedMs(), -1});
+        return static_cast<int>(entries_.size()) - 1;
+    }
+
+    void End(int index) {
+        if (index < 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (index < static_cast<int>(entries_.size())) {
+            entries_[index].end_ms = ElapsedMs();
+        }
+    }
+
+    /**
+     * @brief 记录瞬时事件（同名只记第一次）
+     */
+    void Mark(const char* name) {
+        if (completed_.load(std::memory_order_acquire)) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& e : entries_) {
+            if (e.end_ms < 0 && e.name == name) {
+                return;
+            }
+        }
+        entries_.push_back(Entry{name, ElapsedMs(), -1});
+    }
+
+    /**
+     * @brief 记录终止事件（如首帧），打印时间线并冻结；只有第一次调用生效
+     */
+    void Complete(const char* name) {
+        if (completed_.exchange(true, std::memory_order_acq_rel)) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        const int64_t total_ms = ElapsedMs();
+        entries_.push_back(Entry{name, total_ms, -1});
+
+        LOG_INFO("Startup timeline ({} at {}ms, process launched at uptime {:.2f}s):",
+                 name, total_ms, launch_uptime_sec_);
+        for (const auto& e : entries_) {
+            if (e.end_ms >= 0) {
+                LOG_INFO("  +{:5d}ms .. {:5d}ms ({:4d}ms)  {}", e.start_ms, e.end_ms,
+                         e.end_ms - e.start_ms, e.name);
+            } else {
+                LOG_INFO("  +{:5d}ms                     {}", e.start_ms, e.name);
+            }
+        }
+        if (total_ms > kBudgetMs) {
+            LOG_WARN("Startup exceeded {}ms budget: {} at {}ms", kBudgetMs, name, total_ms);
+        }
+    }
+
+    bool Completed() const { return completed_.load(std::memory_order_acquire); }
+
+    /// 自 main() 开始（首次调用 Instance()）的毫秒数
+    int64_t ElapsedMs() const {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - origin_)
+            .count();
+    }
+
+    std::vector<Entry> Entries() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entries_;
+    }
+
+private:
+    StartupTimeline() : origin_(Clock::now()) {
+        // 系统开机到进程启动的时间（看门狗复位后区分内核启动与应用启动耗时）
+        if (FILE* f = fopen("/proc/uptime", "r")) {
+            if (fscanf(f, "%lf", &launch_uptime_sec_) != 1) {
+                launch_uptime_sec_ = 0.0;
+            }
+            fclose(f);
+        }
+    }
+
+    const Clock::time_point origin_;
+    double launch_uptime_sec_ = 0.0;
+
+    mutable std::mutex mutex_;
+    std::vector<Entry> entries_;
+    std::atomic<bool> completed_{false};
+};
+
+}  // namespace media
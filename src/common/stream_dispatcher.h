@@ -0,0 +1,674 @@
+/**
+ * @file stream_dispatcher.h
+ * @brief 编码流分发器 - 所有 Producer 共用的 VENC 输出分发逻辑
+ *
+ * 将 VENC 编码流分发给多个消费者，三种消费者类型：
+ * - Direct:  在分发线程中直接执行（仅用于极快的操作）
+ * - AsyncIO: 经无锁环形队列交给所属服务的 IO strand 执行（网络发送；不同服务在多个 IO 线程上并行）
+ * - Queued:  每个消费者独占一个工作线程 + 有界队列（文件写入等阻塞操作）
+ *
+ * AsyncIO 消费者的交接（见 spsc_ring.h）：
+ * - 每个消费者一个 SPSC 环形队列，分发线程只做一次入队（定长、无锁、不分配）
+ * - 只有消费者空闲时才向 strand 投递一次排空任务，积压期间入队不再投递；
+ *   排空任务一次处理完环中所有帧
+ * - 出队由消费者的 pop_mutex 串行：Stop() / 注销时在调用线程上直接丢弃环中积压的帧，
+ *   并等待正在执行的回调返回；注销后已投递的排空任务不再调用回调
+ *
+ * 背压处理（Queued 与 AsyncIO）：
+ * - 队列满时按丢帧策略处理，慢消费者永远不会阻塞分发线程
+ * - DropToKeyframe 策略丢弃整段积压并跳到下一个关键帧，保证消费者收到的码流可解码
+ *   （AsyncIO 的环由 IO strand 出队，分发线程无法清空，改为丢弃新帧直到下一个关键帧）
+ * - 每个消费者独立统计投递/丢弃帧数和分发延迟
+ *
+ * 两种驱动方式：
+ * - Start(venc_chn): 内部 Fetch 线程循环 GetStream 并分发（SimpleIPC 硬件绑定模式）
+ * - DispatchFrame(stream): 由调用方在自己的帧循环中驱动（AI 串行模式）
+ *
+ * 派发前对每帧做一次 NAL 索引（见 nal_index.h），消费者通过 get_stream_nal_index()
+ * 读取 NAL 边界、关键帧标志和最新 SPS/PPS/VPS，无需重复扫描码流。
+ *
+ * 每个分发器附带一个 KeyframeRequester（见 keyframe_requester.h），新消费者加入时
+ * 经 Keyframes().Request() 请求 IDR，限频与合并由分发循环逐帧驱动。
+ *
+ * 可选的 GOP 缓存（见 gop_cache.h，Gop().Configure() 开启）在派发时拷贝最近一个 GOP，
+ * 新客户端经 Gop().Snapshot() 取得后先补发缓存帧再接实时帧。
+ *
+ * 指标（见 metrics.h）：每帧派发耗时记入 aipc_dispatch_seconds；每个消费者的回调耗时
+ * （即 RTSP / WebRTC / WS 等的发送耗时）与入队到回调结束的延迟按消费者名分别记录。
+ * 回调结束时按码流的采集 PTS 记录端到端延迟（见 latency_trace.h）。
+ *
+ * @note header-only，日志使用包含方 .cpp 定义的 LOG_TAG
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-14
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/asio_context.h"
+#include "common/gop_cache.h"
+#include "common/keyframe_requester.h"
+#include "common/latency_trace.h"
+#include "common/logger.h"
+#include "common/media_buffer.h"
+#include "common/metrics.h"
+#include "common/spsc_ring.h"
+#include "common/startup_timeline.h"
+
+namespace media {
+
+// ============================================================================
+// 消费者类型定义
+// ============================================================================
+
+/**
+ * @brief 流消费者类型
+ */
+enum class StreamConsumerType {
+    Direct,     ///< 直接在 Fetch 线程中执行（仅用于极快的操作）
+    AsyncIO,    ///< 通过 asio::post 投递到 IO strand 执行（网络发送）
+    Queued      ///< 通过队列投递到独立线程（文件写入等阻塞操作）
+};
+
+/**
+ * @brief Queued 消费者队列满时的丢帧策略
+ */
+enum class QueueDropPolicy {
+    DropOldest,     ///< 丢弃最旧的一帧（适合可容忍花屏的消费者；AsyncIO 丢弃新帧）
+    DropToKeyframe  ///< 清空积压并等待下一个关键帧（保证码流完整，适合录制）
+};
+
+/**
+ * @brief 消费者订阅的码流（双码流模式）
+ */
+enum class StreamSelector {
+    kMain,      ///< 主码流（全分辨率，录制/RTSP）
+    kSub        ///< 子码流（低分辨率低码率，预览）
+};
+
+/**
+ * @brief 编码流回调类型
+ */
+using StreamCallback = std::function<void(EncodedStreamPtr)>;
+
+inline const char* StreamConsumerTypeToString(StreamConsumerType type) {
+    switch (type) {
+        case StreamConsumerType::Direct:  return "Direct";
+        case StreamConsumerType::AsyncIO: return "AsyncIO";
+        case StreamConsumerType::Queued:  return "Queued";
+        default:                          return "Unknown";
+    }
+}
+
+inline const char* StreamSelectorToString(StreamSelector stream) {
+    return stream == StreamSelector::kSub ? "sub" : "main";
+}
+
+/**
+ * @brief 单个消费者的统计信息
+ */
+struct StreamConsumerStats {
+    std::string name;
+    StreamConsumerType type = StreamConsumerType::AsyncIO;
+    StreamSelector stream = StreamSelector::kMain;  ///< 所属码流（由生产者汇总时填写）
+    uint64_t delivered = 0;        ///< 已交付给回调的帧数
+    uint64_t dropped = 0;          ///< 因背压丢弃的帧数
+    uint64_t avg_latency_us = 0;   ///< 平均分发延迟（入队 -> 回调结束）
+    uint64_t max_latency_us = 0;   ///< 最大分发延迟
+    size_t queue_depth = 0;        ///< 当前队列深度（Queued / AsyncIO）
+    size_t queue_capacity = 0;     ///< 队列容量（Queued / AsyncIO）
+    uint64_t wakeups = 0;          ///< 排空任务投递次数（仅 AsyncIO，远小于 delivered 时为批量消费）
+};
+
+// ============================================================================
+// 流分发器
+// ============================================================================
+
+class StreamDispatcher {
+public:
+    StreamDispatcher()
+        : dispatch_time_(MetricsRegistry::Instance().Histogram(
+              "aipc_dispatch_seconds",
+              "Time to index, cache and fan out one encoded frame to all consumers")) {}
+
+    ~StreamDispatcher() {
+        Stop();
+        ClearConsumers();
+    }
+
+    // 禁用拷贝
+    StreamDispatcher(const StreamDispatcher&) = delete;
+    StreamDispatcher& operator=(const StreamDispatcher&) = delete;
+
+    /**
+     * @brief 注册消费者
+     *
+     * @param name 消费者名称（用于日志和统计）
+     * @param callback 回调函数
+     * @param type 消费者类型
+     * @param queue_size 队列容量（<=0 时使用默认值 3；AsyncIO 的环形队列向上取整为 2 的幂）
+     * @param drop_policy 队列满时的丢帧策略（Direct 无效）
+     * @param strand 回调所在的 IO strand 名（仅 AsyncIO 有效，为空时使用消费者名）
+     */
+    void RegisterConsumer(const std::string& name, StreamCallback callback,
+                          StreamConsumerType type, int queue_size = 3,
+                          QueueDropPolicy drop_policy = QueueDropPolicy::DropToKeyframe,
+                          const std::string& strand = {}) {
+        auto consumer = std::make_shared<Consumer>();
+        consumer->name = name;
+        consumer->callback = std::move(callback);
+        consumer->type = type;
+        consumer->drop_policy = drop_policy;
+        // 从关键帧开始接收：运行中注册（如切换订阅的码流）时不会先收到半个 GOP
+        consumer->waiting_keyframe = (drop_policy == QueueDropPolicy::DropToKeyframe);
+        auto& metrics = MetricsRegistry::Instance();
+        consumer->callback_time = &metrics.Histogram(
+            "aipc_consumer_callback_seconds",
+            "Time spent in a stream consumer callback (send / write)", {{"consumer", name}});
+        consumer->delivery_latency = &metrics.Histogram(
+            "aipc_consumer_latency_seconds",
+            "Time from dispatch to the end of a stream consumer callback", {{"consumer", name}});
+        consumer->trace = LatencyTracer::Instance().RegisterConsumer(name);
+        const size_t capacity = queue_size > 0 ? static_cast<size_t>(queue_size) : 3;
+        if (type == StreamConsumerType::AsyncIO) {
+            consumer->strand_name = strand.empty() ? name : strand;
+            consumer->strand = &IoContext::Instance().Strand(consumer->strand_name);
+            consumer->ring = std::make_unique<SpscRing<QueuedStream>>(capacity);
+        }
+
+        if (type == StreamConsumerType::Queued) {
+            consumer->queue = std::make_unique<MediaQueue<QueuedStream>>(capacity);
+            consumer->worker = std::thread(&StreamDispatcher::WorkerLoop, consumer.get());
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            consumers_.push_back(consumer);
+        }
+
+        if (type == StreamConsumerType::Queued) {
+            LOG_INFO("Registered stream consumer: {} (type=Queued, queue={}, policy={})",
+                     name, consumer->queue->capacity(),
+                     drop_policy == QueueDropPolicy::DropOldest ? "DropOldest"
+                                                                : "DropToKeyframe");
+        } else if (type == StreamConsumerType::AsyncIO) {
+            LOG_INFO("Registered stream consumer: {} (type=AsyncIO, strand={}, ring={})",
+                     name, consumer->strand_name, consumer->ring->capacity());
+        } else {
+            LOG_INFO("Registered stream consumer: {} (type={})",
+                     name, StreamConsumerTypeToString(type));
+        }
+    }
+
+    /**
+     * @brief 移除指定名称的消费者（停止并回收其 Queued 工作线程）
+     * @return true 找到并移除
+     */
+    bool RemoveConsumer(const std::string& name) {
+        std::shared_ptr<Consumer> removed;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = std::find_if(consumers_.begin(), consumers_.end(),
+                                   [&name](const auto& c) { return c->name == name; });
+            if (it == consumers_.end()) {
+                return false;
+            }
+            removed = *it;
+            consumers_.erase(it);
+        }
+
+        Retire(*removed);
+        LOG_INFO("Removed stream consumer: {}", name);
+        return true;
+    }
+
+    /**
+     * @brief 清除所有消费者（停止并回收 Queued 工作线程）
+     */
+    void ClearConsumers() {
+        std::vector<std::shared_ptr<Consumer>> removed;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            removed.swap(consumers_);
+        }
+
+        for (auto& c : removed) {
+            Retire(*c);
+            if (c->delivered.load() > 0 || c->dropped.load() > 0) {
+                auto stats = c->Snapshot();
+                LOG_INFO("Consumer {} removed: delivered={}, dropped={}, "
+                         "latency avg={}us max={}us",
+                         stats.name, stats.delivered, stats.dropped,
+                         stats.avg_latency_us, stats.max_latency_us);
+            }
+        }
+    }
+
+    /**
+     * @brief 将一帧编码流分发给所有消费者
+     *
+     * 只会在 Direct 消费者上阻塞，其余类型都是立即返回
+     */
+    void DispatchFrame(const EncodedStreamPtr& stream) {
+        if (!stream) return;
+
+        const auto now = std::chrono::steady_clock::now();
+        ScopedLatency timing(&dispatch_time_);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        const auto* nal = index_stream_nals(stream, codec_, &params_);
+        const bool is_keyframe = nal ? nal->is_keyframe : is_stream_keyframe(stream);
+        keyframes_.OnFrame(is_keyframe);
+        gop_cache_.OnFrame(stream, is_keyframe);
+        if (!first_frame_) {
+            // 首帧出流：结束启动时间线（全局只生效一次，此后每个分发器也只调用一次）
+            first_frame_ = true;
+            StartupTimeline::Instance().Complete("first_frame");
+        }
+
+        for (auto& c : consumers_) {
+            if (!c->callback) continue;
+
+            switch (c->type) {
+                case StreamConsumerType::AsyncIO:
+                    EnqueueAsync(c, stream, is_keyframe, now);
+                    break;
+                case StreamConsumerType::Queued:
+                    Enqueue(*c, stream, is_keyframe, now);
+                    break;
+                case StreamConsumerType::Direct:
+                default:
+                    c->Deliver(stream, now);
+                    break;
+            }
+        }
+    }
+
+    /**
+     * @brief 启动内部 Fetch 线程（从 VENC 通道拉流并分发）
+     * @param venc_chn VENC 通道号
+     */
+    void Start(int venc_chn) {
+        if (running_) return;
+        venc_chn_ = venc_chn;
+        keyframes_.SetChannel(venc_chn);
+        running_ = true;
+        fetch_thread_ = std::thread(&StreamDispatcher::FetchLoop, this);
+        LOG_INFO("Stream dispatcher started for VENC channel {}", venc_chn);
+    }
+
+    /**
+     * @brief 停止 Fetch 线程，丢弃队列与 AsyncIO 环中积压的帧并清空 GOP 缓存
+     *
+     * 积压帧持有 VENC buffer，必须在 VENC 销毁前归还；返回后 IO strand 上不再持有本路的帧，
+     * 调用方无需先排空 IoContext
+     */
+    void Stop() {
+        if (running_) {
+            running_ = false;
+            if (fetch_thread_.joinable()) {
+                fetch_thread_.join();
+            }
+            LOG_INFO("Stream dispatcher stopped");
+        }
+        FlushQueues();
+        gop_cache_.Clear();
+    }
+
+    bool IsRunning() const { return running_; }
+
+    /**
+     * @brief 设置码流编码格式（决定 NAL 索引的解析方式）
+     */
+    void SetCodec(VideoCodec codec) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (codec != codec_) {
+            codec_ = codec;
+            params_.reset();
+            gop_cache_.Clear();
+        }
+    }
+
+    /**
+     * @brief 获取最近一次关键帧携带的参数集（尚未收到时为空）
+     */
+    ParameterSetsPtr GetParameterSets() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return params_;
+    }
+
+    /**
+     * @brief 本路码流的关键帧请求器
+     *
+     * Start() 时自动绑定 VENC 通道；由调用方驱动 DispatchFrame() 的生产者需自行 SetChannel()
+     */
+    KeyframeRequester& Keyframes() { return keyframes_; }
+    const KeyframeRequester& Keyframes() const { return keyframes_; }
+
+    /**
+     * @brief 本路码流的 GOP 缓存（默认关闭，Stop() 时清空）
+     */
+    GopCache& Gop() { return gop_cache_; }
+    const GopCache& Gop() const { return gop_cache_; }
+
+    /**
+     * @brief 丢弃所有消费者中尚未处理的帧（Queued 队列与 AsyncIO 环形队列）
+     *
+     * AsyncIO 的积压帧在调用线程上直接释放，并等待正在执行的回调返回，
+     * 返回后不再有本分发器的帧被 IO strand 持有
+     */
+    void FlushQueues() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& c : consumers_) {
+            if (c->queue) {
+                c->queue->clear();
+                c->waiting_keyframe = true;
+            }
+            if (c->ring) {
+                DiscardRing(*c);
+                c->waiting_keyframe = true;
+            }
+        }
+    }
+
+    /**
+     * @brief 获取所有消费者的统计信息
+     */
+    std::vector<StreamConsumerStats> GetConsumerStats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<StreamConsumerStats> result;
+        result.reserve(consumers_.size());
+        for (const auto& c : consumers_) {
+            result.push_back(c->Snapshot());
+        }
+        return result;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct QueuedStream {
+        EncodedStreamPtr stream;
+        Clock::time_point enqueue_time;
+    };
+
+    struct Consumer {
+        std::string name;
+        StreamCallback callback;
+        StreamConsumerType type = StreamConsumerType::AsyncIO;
+        QueueDropPolicy drop_policy = QueueDropPolicy::DropToKeyframe;
+
+        std::string strand_name;            // 仅 AsyncIO
+        IoStrand* strand = nullptr;
+        std::unique_ptr<SpscRing<QueuedStream>> ring;   // 分发线程入队，strand 出队
+        std::mutex pop_mutex;               // 串行化出队与回调：strand 排空 / Flush / 注销时丢弃
+        std::atomic<bool> drain_scheduled{false};      // 已投递排空任务且尚未结束
+        std::atomic<bool> removed{false};   // 已注销：排空任务只释放帧，不再调用回调
+        std::atomic<uint64_t> wakeups{0};
+
+        std::unique_ptr<MediaQueue<QueuedStream>> queue;
+        std::thread worker;
+        bool waiting_keyframe = false;  // 仅分发线程访问（Queued / AsyncIO）
+
+        std::atomic<uint64_t> delivered{0};
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<uint64_t> total_latency_us{0};
+        std::atomic<uint64_t> max_latency_us{0};
+        LatencyHistogram* callback_time = nullptr;      // 注册表中的指标，进程内有效
+        LatencyHistogram* delivery_latency = nullptr;
+        LatencyTracer::ConsumerTrace trace;
+
+        /// 执行回调并记录回调耗时与分发延迟
+        void Deliver(const EncodedStreamPtr& stream, Clock::time_point dispatch_time) {
+            const auto start = Clock::now();
+            callback(stream);
+            const auto end = Clock::now();
+            const uint64_t busy_us = ElapsedUs(start, end);
+            callback_time->Observe(busy_us);
+            RecordDelivery(ElapsedUs(dispatch_time, end));
+            if (stream->pstPack) {
+                LatencyTracer::Instance().RecordConsumer(trace, stream->pstPack->u64PTS, busy_us);
+            }
+        }
+
+        static uint64_t ElapsedUs(Clock::time_point from, Clock::time_point to) {
+            auto us = std::chrono::duration_cast<std::chrono::microseconds>(to - from).count();
+            return us > 0 ? static_cast<uint64_t>(us) : 0;
+        }
+
+        void RecordDelivery(uint64_t us) {
+            delivery_latency->Observe(us);
+            delivered.fetch_add(1, std::memory_order_relaxed);
+            total_latency_us.fetch_add(us, std::memory_order_relaxed);
+            uint64_t prev = max_latency_us.load(std::memory_order_relaxed);
+            while (us > prev &&
+                   !max_latency_us.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {
+            }
+        }
+
+        StreamConsumerStats Snapshot() const {
+            StreamConsumerStats s;
+            s.name = name;
+            s.type = type;
+            s.delivered = delivered.load(std::memory_order_relaxed);
+            s.dropped = dropped.load(std::memory_order_relaxed);
+            s.avg_latency_us = s.delivered > 0
+                ? total_latency_us.load(std::memory_order_relaxed) / s.delivered : 0;
+            s.max_latency_us = max_latency_us.load(std::memory_order_relaxed);
+            if (queue) {
+                s.queue_depth = queue->size();
+                s.queue_capacity = queue->capacity();
+            }
+            if (ring) {
+                s.queue_depth = ring->Size();
+                s.queue_capacity = ring->capacity();
+                s.wakeups = wakeups.load(std::memory_order_relaxed);
+            }
+            return s;
+        }
+    };
+
+    /**
+     * @brief Queued 消费者入队（带背压处理）
+     */
+    void Enqueue(Consumer& c, const EncodedStreamPtr& stream, bool is_keyframe,
+                 Clock::time_point now) {
+        // 上一次溢出后，跳过直到关键帧
+        if (c.waiting_keyframe) {
+            if (!is_keyframe) {
+                c.dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            c.waiting_keyframe = false;
+        }
+
+        if (c.queue->size() >= c.queue->capacity()) {
+            if (c.drop_policy == QueueDropPolicy::DropToKeyframe) {
+                // 积压的帧依赖链完整，整段丢弃后从关键帧恢复
+                size_t flushed = c.queue->clear();
+                c.dropped.fetch_add(flushed, std::memory_order_relaxed);
+                if (!is_keyframe) {
+                    c.waiting_keyframe = true;
+                    c.dropped.fetch_add(1, std::memory_order_relaxed);
+                    LOG_WARN_THROTTLED(1000,
+                                       "Consumer {} overflow, dropped {} frames, waiting for keyframe",
+                                       c.name, flushed + 1);
+                    return;
+                }
+                LOG_WARN_THROTTLED(1000, "Consumer {} overflow, dropped {} frames", c.name, flushed);
+            } else {
+                // MediaQueue 满时自动丢弃最旧的一帧
+                c.dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        c.queue->push(QueuedStream{stream, now});
+    }
+
+    /**
+     * @brief AsyncIO 消费者入环（分发线程，持有 mutex_，因此始终只有一个生产者）
+     *
+     * 只在消费者空闲时投递排空任务：积压期间每帧只有一次无锁入队
+     */
+    void EnqueueAsync(const std::shared_ptr<Consumer>& c, const EncodedStreamPtr& stream,
+                      bool is_keyframe, Clock::time_point now) {
+        if (c->waiting_keyframe) {
+            if (!is_keyframe) {
+                c->dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            c->waiting_keyframe = false;
+        }
+
+        if (!c->ring->TryPush(QueuedStream{stream, now})) {
+            // 环满时排空任务必然已在途，无需唤醒
+            c->dropped.fetch_add(1, std::memory_order_relaxed);
+            if (c->drop_policy == QueueDropPolicy::DropToKeyframe) {
+                c->waiting_keyframe = true;
+                LOG_WARN_THROTTLED(1000, "Consumer {} ring full ({}), waiting for keyframe",
+                                   c->name, c->ring->capacity());
+            }
+            return;
+        }
+
+        // 与 DrainRing 清除标志后的复查配对，保证入队的帧不会无人排空
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!c->drain_scheduled.exchange(true)) {
+            c->wakeups.fetch_add(1, std::memory_order_relaxed);
+            // 任务从 IoContext 的内存池分配；持有 Consumer 引用，注销后仍可安全排空
+            IoContext::Instance().PostTo(*c->strand, [c]() { DrainRing(*c); });
+        }
+    }
+
+    /**
+     * @brief AsyncIO 排空任务（IO strand）：依次交付环中所有帧
+     *
+     * 每帧的出队与回调在 pop_mutex 内完成，Flush / 注销可以等到回调返回；
+     * 回调中不能注销自身或调用 FlushQueues()
+     */
+    static void DrainRing(Consumer& c) {
+        QueuedStream item;
+        for (;;) {
+            for (;;) {
+                std::lock_guard<std::mutex> lock(c.pop_mutex);
+                if (!c.ring->TryPop(item)) {
+                    break;
+                }
+                if (!c.removed.load(std::memory_order_acquire)) {
+                    c.Deliver(item.stream, item.enqueue_time);
+                }
+                item.stream.reset();  // 尽早归还 VENC buffer
+            }
+            c.drain_scheduled.store(false);
+            // 清除标志前入队的帧：生产者看到标志仍为 true 而未投递，这里接着处理
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (c.ring->Empty() || c.drain_scheduled.exchange(true)) {
+                break;
+            }
+        }
+    }
+
+    /**
+     * @brief 丢弃 AsyncIO 环中积压的帧（调用线程上释放，等待进行中的回调返回）
+     */
+    static void DiscardRing(Consumer& c) {
+        std::lock_guard<std::mutex> lock(c.pop_mutex);
+        QueuedStream item;
+        size_t discarded = 0;
+        while (c.ring->TryPop(item)) {
+            item.stream.reset();
+            discarded++;
+        }
+        c.dropped.fetch_add(discarded, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 注销后的收尾：停止 Queued 工作线程，AsyncIO 标记注销并丢弃积压帧
+     */
+    static void Retire(Consumer& c) {
+        c.removed.store(true, std::memory_order_release);
+        if (c.ring) {
+            DiscardRing(c);
+        }
+        if (c.queue) {
+            c.queue->stop();
+            c.queue->clear();
+        }
+        if (c.worker.joinable()) {
+            c.worker.join();
+        }
+    }
+
+    /**
+     * @brief Queued 消费者工作线程
+     */
+    static void WorkerLoop(Consumer* c) {
+        QueuedStream item;
+        while (c->queue->pop(item)) {
+            c->Deliver(item.stream, item.enqueue_time);
+            item.stream.reset();  // 尽早归还 VENC buffer
+        }
+    }
+
+    /**
+     * @brief Fetch 线程：从 VENC 拉流并分发
+     */
+    void FetchLoop() {
+        uint64_t frame_count = 0;
+        uint64_t consecutive_errors = 0;
+
+        while (running_) {
+            RK_S32 last_error = 0;
+            auto stream = acquire_encoded_stream(venc_chn_, 1000, &last_error);
+
+            if (!stream) {
+                consecutive_errors++;
+                if (consecutive_errors > 3) {
+                    LOG_WARN_THROTTLED(5000, "VENC chn{} consecutive errors: {}, last: {:#x}",
+                                       venc_chn_, consecutive_errors, last_error);
+                }
+                continue;
+            }
+
+            frame_count++;
+            consecutive_errors = 0;
+            sei_.OnFetched(venc_chn_, stream->pstPack->u64PTS);
+
+            if (frame_count <= 5 || frame_count % 300 == 0) {
+                LOG_DEBUG("Frame #{}, size={} bytes", frame_count,
+                          stream->pstPack ? stream->pstPack->u32Len : 0);
+            }
+
+            DispatchFrame(stream);
+        }
+
+        LOG_DEBUG("Fetch loop exited, total frames: {}", frame_count);
+    }
+
+    mutable std::mutex mutex_;
+    std::vector<std::shared_ptr<Consumer>> consumers_;
+    VideoCodec codec_ = VideoCodec::kH264;
+    ParameterSetsPtr params_;           // 跨帧参数集缓存（mutex_ 保护）
+    bool first_frame_ = false;          // 已上报首帧（mutex_ 保护）
+
+    std::atomic<bool> running_{false};
+    std::thread fetch_thread_;
+    int venc_chn_ = 0;
+    SeiStamper sei_;                    // 仅 Fetch 线程访问
+
+    KeyframeRequester keyframes_;
+    GopCache gop_cache_;
+    LatencyHistogram& dispatch_time_;
+};
+
+}  // namespace media
@@ -0,0 +1,48 @@
+/**
+ * @file video_codec.h
+ * @brief 视频编码格式定义 - 生产者与各分发路径共用
+ *
+ * 编码格式由 ProducerConfig 决定（VENC 输出），分发侧（RTSP/WebRTC/WS/MP4）
+ * 通过 StreamConfig 获得同一取值，分别选择打包方式与参数集格式。
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-12
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace media {
+
+/**
+ * @brief 视频编码格式
+ */
+enum class VideoCodec : uint8_t {
+    kH264,      ///< H.264 / AVC（默认，浏览器兼容性最好）
+    kH265       ///< H.265 / HEVC（同画质码率约为 H.264 的一半）
+};
+
+inline const char* VideoCodecToString(VideoCodec codec) {
+    return codec == VideoCodec::kH265 ? "h265" : "h264";
+}
+
+/**
+ * @brief 从字符串解析编码格式（"h264"/"avc"、"h265"/"hevc"）
+ *
+ * @return true 解析成功
+ */
+inline bool ParseVideoCodec(const std::string& name, VideoCodec* codec) {
+    if (name == "h264" || name == "avc") {
+        *codec = VideoCodec::kH264;
+        return true;
+    }
+    if (name == "h265" || name == "hevc") {
+        *codec = VideoCodec::kH265;
+        return true;
+    }
+    return false;
+}
+
+}  // namespace media
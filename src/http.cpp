@@ -11,13 +11,27 @@
 #define LOG_TAG "http"
 
 #include "http.h"
+#include "load_governor.h"
+#include "common/asio_context.h"
+#include "common/latency_trace.h"
 #include "common/logger.h"
+#include "common/metrics.h"
 #include "media_distribution/rtsp/rtsp_service.h"
 #include "media_distribution/file/file_service.h"
 #include "media_distribution/webrtc/webrtc_service.h"
+#include "media_distribution/hls/hls_packager.h"
 #include "media_producer/media_manager.h"
+#include "media_producer/common/model_cache.h"
 #include <httplib.h>
 #include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <vector>
 
 using json = nlohmann::json;
 
@@ -39,6 +53,150 @@ static std::string json_response(bool success, const std::string& message,
     return response.dump();
 }
 
+/**
+ * @brief 以打包器的共享缓冲作为响应体
+ *
+ * 直接从不可变的 part 缓冲写出，不拷贝到响应；写完后资源引用随之释放
+ */
+static void set_hls_content(HttpResponse& res, HlsPackager* packager, HlsResource resource,
+                            const char* content_type) {
+    auto shared = std::make_shared<HlsResource>(std::move(resource));
+    const size_t size = shared->size;
+    res.set_header("Cache-Control", "max-age=60");
+    res.set_content_provider(
+        size, content_type,
+        [shared](size_t offset, size_t length, httplib::DataSink& sink) {
+            size_t pos = 0;
+            for (const auto& chunk : shared->chunks) {
+                const size_t n = chunk->size();
+                if (offset < pos + n) {
+                    const size_t skip = offset - pos;
+                    return sink.write(reinterpret_cast<const char*>(chunk->data()) + skip,
+                                      std::min(n - skip, length));
+                }
+                pos += n;
+            }
+            return false;
+        },
+        [packager, size](bool success) {
+            if (success) {
+                packager->AddBytesServed(size);
+            }
+        });
+}
+
+/**
+ * @brief HLS 请求结果转换为 HTTP 状态码
+ */
+static bool hls_status(HttpResponse& res, HlsPackager::Result result) {
+    if (result == HlsPackager::Result::kOk) {
+        return true;
+    }
+    res.status = result == HlsPackager::Result::kNotFound ? 404 : 503;
+    return false;
+}
+
+// ============================================================================
+// 状态快照
+// ============================================================================
+
+/**
+ * @brief 状态快照：轮询接口与事件流共用，最多每秒重建一次
+ *
+ * 多个看板以 1~2Hz 轮询时，请求只拷贝缓存的 JSON 文本，不再逐个查询各服务；
+ * 有事件流订阅者时由 "http" strand 上的定时器每秒刷新，内容变化才推送。
+ * 非 GET 请求（启停服务、切换模式等）返回后作废缓存，下一次读取立即重建。
+ */
+class StatusPublisher : public std::enable_shared_from_this<StatusPublisher> {
+public:
+    using Builder = std::function<std::string()>;
+
+    static constexpr std::chrono::milliseconds kMaxAge{1000};
+
+    explicit StatusPublisher(std::shared_ptr<HttpEventChannel> events)
+        : events_(std::move(events)),
+          timer_(IoContext::Instance().Strand("http")) {}
+
+    /**
+     * @brief 注册一项快照（初始化阶段调用）
+     *
+     * @param event 事件流中的事件名
+     * @param build 生成响应体
+     */
+    void Add(const std::string& event, Builder build) {
+        auto entry = std::make_unique<Entry>();
+        entry->event = event;
+        entry->build = std::move(build);
+        entries_.push_back(std::move(entry));
+    }
+
+    /**
+     * @brief 读取快照（过期或已作废时重建，并发请求只重建一次）
+     */
+    std::shared_ptr<const std::string> Get(const std::string& event) {
+        for (auto& entry : entries_) {
+            if (entry->event == event) {
+                return Snapshot(*entry);
+            }
+        }
+        return nullptr;
+    }
+
+    void Invalidate() { generation_.fetch_add(1, std::memory_order_relaxed); }
+
+    void Start() {
+        std::weak_ptr<StatusPublisher> weak = shared_from_this();
+        timer_.expires_after(kMaxAge);
+        timer_.async_wait([weak](const asio::error_code& ec) {
+            auto self = weak.lock();
+            if (ec || !self) {
+                return;
+            }
+            self->Publish();
+            self->Start();
+        });
+    }
+
+    void Stop() { timer_.cancel(); }
+
+private:
+    struct Entry {
+        std::string event;
+        Builder build;
+        std::mutex mutex;
+        std::shared_ptr<const std::string> body;
+        std::chrono::steady_clock::time_point built_at;
+        uint64_t generation = 0;
+    };
+
+    std::shared_ptr<const std::string> Snapshot(Entry& entry) {
+        const auto now = std::chrono::steady_clock::now();
+        const uint64_t generation = generation_.load(std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(entry.mutex);
+        if (!entry.body || entry.generation != generation || now - entry.built_at >= kMaxAge) {
+            entry.body = std::make_shared<const std::string>(entry.build());
+            entry.built_at = now;
+            entry.generation = generation;
+        }
+        return entry.body;
+    }
+
+    /// 无订阅者时不刷新；通道对未变化的内容不推送
+    void Publish() {
+        if (!events_ || events_->SubscriberCount() == 0) {
+            return;
+        }
+        for (auto& entry : entries_) {
+            events_->Publish(entry->event, *Snapshot(*entry));
+        }
+    }
+
+    std::shared_ptr<HttpEventChannel> events_;
+    asio::steady_timer timer_;
+    std::vector<std::unique_ptr<Entry>> entries_;
+    std::atomic<uint64_t> generation_{0};
+};
+
 // ============================================================================
 // HttpApi 实现
 // ============================================================================
@@ -64,6 +222,8 @@ bool HttpApi::Init(const HttpApiConfig& config, const StreamConfig& stream_confi
     http_config.static_dir = config.static_dir;
     http_config.static_mount = "/";
     http_config.thread_pool_size = config.thread_pool_size;
+    http_config.blocking_pool_size = config.blocking_pool_size;
+    http_config.mode = config.mode;
 
     if (!server_->Init(http_config)) {
         LOG_ERROR("HTTP 服务器初始化失败");
@@ -87,12 +247,16 @@ bool HttpApi::Start() {
         LOG_ERROR("HTTP 服务器启动失败");
         return false;
     }
+    status_->Start();
 
     LOG_INFO("HTTP API 服务已启动: {}:{}", config_.host, config_.port);
     return true;
 }
 
 void HttpApi::Stop() {
+    if (status_) {
+        status_->Stop();
+    }
     if (server_) {
         server_->Stop();
         LOG_INFO("HTTP API 服务已停止");
@@ -108,10 +272,23 @@ void HttpApi::SetupRoutes() {
         return;
     }
 
+    // ========================================================================
+    // 状态快照与事件流
+    // ========================================================================
+    // GET /api/events: text/event-stream，事件 status / ai 与同名轮询接口的响应体相同
+    status_ = std::make_shared<StatusPublisher>(server_->EventStream("/api/events"));
+
+    // 状态可能被非 GET 请求改变，作废快照使随后的轮询立即看到结果
+    server_->SetPostRoutingHandler([this](const HttpRequest& req, HttpResponse& /*res*/) {
+        if (req.method != "GET" && req.method != "HEAD") {
+            status_->Invalidate();
+        }
+    });
+
     // ========================================================================
     // 系统状态 API
     // ========================================================================
-    server_->Get("/api/status", [this](const HttpRequest& /*req*/, HttpResponse& res) {
+    status_->Add("status", [this]() {
         auto* mgr = GetStreamManager();
         json data;
         
@@ -141,7 +318,10 @@ void HttpApi::SetupRoutes() {
         data["producer"]["mode"] = media::ProducerModeToString(media_mgr.GetCurrentMode());
         data["producer"]["running"] = media_mgr.IsRunning();
         
-        res.set_content(json_response(true, "ok", data), "application/json");
+        return json_response(true, "ok", data);
+    });
+    server_->Get("/api/status", [this](const HttpRequest& /*req*/, HttpResponse& res) {
+        res.set_content(*status_->Get("status"), "application/json");
     });
 
     // ========================================================================
@@ -160,8 +340,59 @@ void HttpApi::SetupRoutes() {
         data["valid"] = rtsp->IsValid();
         data["running"] = rtsp->IsRunning();
         data["url"] = rtsp->GetUrl();
+        json mounts = json::array();
+        for (size_t i = 0; i < stats.mounts.size(); ++i) {
+            const auto& m = stats.mounts[i];
+            json mount;
+            mount["path"] = m.path;
+            mount["url"] = rtsp->GetUrl(i);
+            mount["codec"] = m.codecType == 2 ? "h265" : "h264";
+            mount["frames_sent"] = m.framesSent;
+            mount["bytes_sent"] = m.bytesSent;
+            mount["playing"] = m.playing;
+            if (!m.multicastAddress.empty()) {
+                json multicast;
+                multicast["address"] = m.multicastAddress;
+                multicast["port"] = m.multicastPort;
+                multicast["subscribers"] = m.multicastSubscribers;
+                multicast["packets_sent"] = m.multicastPackets;
+                multicast["bytes_sent"] = m.multicastBytes;
+                multicast["packets_dropped"] = m.multicastDropped;
+                mount["multicast"] = multicast;
+            }
+            mounts.push_back(mount);
+        }
+        data["mounts"] = mounts;
+        data["transports"]["udp"] = true;
+        data["transports"]["tcp"] = stats.tcpEnabled;
+        data["transports"]["multicast"] = stats.multicastEnabled;
         data["frames_sent"] = stats.framesSent;
         data["bytes_sent"] = stats.bytesSent;
+        data["errors"] = stats.errors;
+        data["packets_sent"] = stats.packetsSent;
+        data["packets_dropped"] = stats.packetsDropped;
+        data["sessions"] = stats.sessions;
+        data["playing"] = stats.playing;
+        json clients = json::array();
+        for (const auto& c : stats.clients) {
+            json client;
+            client["session_id"] = c.session_id;
+            client["address"] = c.address;
+            client["path"] = c.path;
+            client["transport"] = c.transport;
+            client["rtp_port"] = c.rtpPort;
+            client["playing"] = c.playing;
+            client["frames_sent"] = c.framesSent;
+            client["packets_sent"] = c.packetsSent;
+            client["bytes_sent"] = c.bytesSent;
+            client["packets_dropped"] = c.packetsDropped;
+            client["send_queue_bytes"] = c.sendQueueBytes;
+            client["send_queue_peak_bytes"] = c.sendQueuePeakBytes;
+            client["rtcp_received"] = c.rtcpReceived;
+            client["duration_ms"] = c.durationMs;
+            clients.push_back(client);
+        }
+        data["clients"] = clients;
         res.set_content(json_response(true, "ok", data), "application/json");
     });
 
@@ -218,6 +449,52 @@ void HttpApi::SetupRoutes() {
         auto* webrtc = mgr->GetWebRTCService();
         json data;
         data["running"] = webrtc->IsRunning();
+        
+        // 观看者与逐个观看者的发送码率
+        auto stats = webrtc->GetStats();
+        data["viewers"] = stats.viewer_count;
+        data["frames_packetized"] = stats.video_frames_packetized;
+        json peers = json::array();
+        for (const auto& p : stats.peers) {
+            json peer;
+            peer["session_id"] = p.session_id;
+            peer["ssrc"] = p.ssrc;
+            peer["packets_sent"] = p.packets_sent;
+            peer["bytes_sent"] = p.bytes_sent;
+            peer["bitrate_kbps"] = p.bitrate_kbps;
+            peer["duration_ms"] = p.connection_duration_ms;
+            peer["receiving"] = p.receiving;
+            peer["fraction_lost"] = p.fraction_lost;
+            peer["rtt_ms"] = p.rtt_ms;
+            peer["nack_packets"] = p.nack_packets;
+            peer["pli_count"] = p.pli_count;
+            peer["remb_kbps"] = p.remb_kbps;
+            peer["estimate_kbps"] = p.estimate_kbps;
+            peers.push_back(peer);
+        }
+        data["peers"] = peers;
+        
+        // 自适应码率
+        json abr;
+        abr["enabled"] = stats.abr_enabled;
+        abr["target_kbps"] = stats.abr_target_kbps;
+        abr["adjustments"] = stats.abr_adjustments;
+        abr["keyframe_requests"] = stats.keyframe_requests;
+        data["abr"] = abr;
+        data["gop_bursts"] = stats.gop_bursts;
+        data["metadata_sent"] = stats.metadata_sent;
+        data["metadata_dropped"] = stats.metadata_dropped;
+
+        // 建连耗时与预热会话
+        json connect;
+        connect["count"] = stats.connects;
+        connect["last_ms"] = stats.last_connect_ms;
+        connect["avg_ms"] = stats.avg_connect_ms;
+        connect["standby_enabled"] = stats.standby_enabled;
+        connect["standby_ready"] = stats.standby_ready;
+        connect["standby_hits"] = stats.standby_hits;
+        connect["standby_misses"] = stats.standby_misses;
+        data["connect"] = connect;
         res.set_content(json_response(true, "ok", data), "application/json");
     });
 
@@ -275,15 +552,18 @@ void HttpApi::SetupRoutes() {
         }
         
         try {
-            std::string offer = webrtc->CreateOfferForHttp();
+            std::string session_id;
+            std::string offer = webrtc->CreateOfferForHttp(&session_id);
             if (offer.empty()) {
-                res.set_content(json_response(false, "Failed to create offer"), "application/json");
+                res.set_content(json_response(false, "Failed to create offer (viewer limit reached?)"),
+                                "application/json");
                 return;
             }
             
             json data;
             data["sdp"] = offer;
             data["type"] = "offer";
+            data["session_id"] = session_id;
             res.set_content(json_response(true, "ok", data), "application/json");
         } catch (const std::exception& e) {
             res.set_content(json_response(false, std::string("Error: ") + e.what()), "application/json");
@@ -302,13 +582,21 @@ void HttpApi::SetupRoutes() {
         try {
             json body = json::parse(req.body);
             std::string sdp = body.value("sdp", "");
+            std::string session_id = body.value("session_id", "");
             
             if (sdp.empty()) {
                 res.set_content(json_response(false, "Missing SDP"), "application/json");
                 return;
             }
             
-            if (webrtc->SetAnswerFromHttp(sdp)) {
+            if (webrtc->SetAnswerFromHttp(sdp, session_id)) {
+                // 浏览器可随 Answer 一并提交已收集的候选，省去逐个 /api/webrtc/ice
+                for (const auto& c : body.value("candidates", json::array())) {
+                    std::string candidate = c.value("candidate", "");
+                    if (!candidate.empty()) {
+                        webrtc->AddIceCandidateFromHttp(candidate, c.value("sdpMid", "0"), session_id);
+                    }
+                }
                 res.set_content(json_response(true, "Answer set"), "application/json");
             } else {
                 res.set_content(json_response(false, "Failed to set answer"), "application/json");
@@ -331,6 +619,23 @@ void HttpApi::SetupRoutes() {
             json body = json::parse(req.body);
             std::string candidate = body.value("candidate", "");
             std::string mid = body.value("sdpMid", "0");
+            std::string session_id = body.value("session_id", "");
+
+            // 批量提交：{"candidates": [{candidate, sdpMid}, ...], "session_id"}
+            if (body.contains("candidates")) {
+                size_t added = 0;
+                for (const auto& c : body.value("candidates", json::array())) {
+                    std::string cand = c.value("candidate", "");
+                    if (!cand.empty() &&
+                        webrtc->AddIceCandidateFromHttp(cand, c.value("sdpMid", "0"), session_id)) {
+                        ++added;
+                    }
+                }
+                json data;
+                data["added"] = added;
+                res.set_content(json_response(true, "ICE candidates added", data), "application/json");
+                return;
+            }
             
             if (candidate.empty()) {
                 // 空候选表示 ICE 收集完成
@@ -338,7 +643,7 @@ void HttpApi::SetupRoutes() {
                 return;
             }
             
-            if (webrtc->AddIceCandidateFromHttp(candidate, mid)) {
+            if (webrtc->AddIceCandidateFromHttp(candidate, mid, session_id)) {
                 res.set_content(json_response(true, "ICE candidate added"), "application/json");
             } else {
                 res.set_content(json_response(false, "Failed to add ICE candidate"), "application/json");
@@ -348,7 +653,32 @@ void HttpApi::SetupRoutes() {
         }
     });
     
-    server_->Get("/api/webrtc/candidates", [](const HttpRequest& /*req*/, HttpResponse& res) {
+    server_->Post("/api/webrtc/close", [](const HttpRequest& req, HttpResponse& res) {
+        auto* mgr = GetStreamManager();
+        if (!mgr || !mgr->GetWebRTCService()) {
+            res.set_content(json_response(false, "WebRTC not available"), "application/json");
+            return;
+        }
+        
+        try {
+            json body = json::parse(req.body);
+            std::string session_id = body.value("session_id", "");
+            if (session_id.empty()) {
+                res.set_content(json_response(false, "Missing session_id"), "application/json");
+                return;
+            }
+            
+            if (mgr->GetWebRTCService()->CloseHttpSession(session_id)) {
+                res.set_content(json_response(true, "Session closed"), "application/json");
+            } else {
+                res.set_content(json_response(false, "Unknown session"), "application/json");
+            }
+        } catch (const json::exception& e) {
+            res.set_content(json_response(false, std::string("Invalid JSON: ") + e.what()), "application/json");
+        }
+    });
+    
+    server_->Get("/api/webrtc/candidates", [](const HttpRequest& req, HttpResponse& res) {
         auto* mgr = GetStreamManager();
         if (!mgr || !mgr->GetWebRTCService()) {
             res.set_content(json_response(false, "WebRTC not available"), "application/json");
@@ -356,7 +686,7 @@ void HttpApi::SetupRoutes() {
         }
         
         auto* webrtc = mgr->GetWebRTCService();
-        auto candidates = webrtc->GetLocalIceCandidates();
+        auto candidates = webrtc->GetLocalIceCandidates(req.get_param_value("session_id"));
         
         json data = json::array();
         for (const auto& [candidate, mid] : candidates) {
@@ -384,14 +714,75 @@ void HttpApi::SetupRoutes() {
         data["enabled"] = stream_config_.enable_file;
         data["active"] = fs->IsRecording();
         data["output_dir"] = stream_config_.mp4_config.outputDir;
+        data["fragmented"] = stream_config_.mp4_config.fragmented;
         
         if (fs->IsRecording()) {
             auto stats = fs->GetRecordStats();
             data["stats"]["frames_written"] = stats.frames_written;
             data["stats"]["bytes_written"] = stats.bytes_written;
             data["stats"]["duration_sec"] = stats.duration_sec;
+            data["stats"]["segments"] = stats.segments;
+            data["stats"]["segment_duration_sec"] = stats.segment_duration_sec;
+            data["stats"]["segment_bytes"] = stats.segment_bytes;
+            data["stats"]["fragments"] = stats.fragments;
+            data["current_file"] = fs->GetCurrentRecordPath();
         }
         
+        // 分段收尾与保留策略（跨录制累计）
+        auto rs = fs->GetRecordStats();
+        data["finalize"]["pending"] = rs.finalize_pending;
+        data["finalize"]["segments"] = rs.segments_finalized;
+        data["finalize"]["last_ms"] = rs.last_finalize_ms;
+        data["finalize"]["max_ms"] = rs.max_finalize_ms;
+        data["retention"]["max_usage_pct"] = stream_config_.mp4_config.retentionMaxUsagePct;
+        data["retention"]["max_bytes"] = stream_config_.mp4_config.retentionMaxBytes;
+        data["retention"]["deleted_files"] = rs.retention_deleted_files;
+        data["retention"]["deleted_bytes"] = rs.retention_deleted_bytes;
+        
+        // 写盘统计：直方图各桶上限依次为 buckets_ms，最后一桶为超出上限的次数
+        auto histogram = [](const LatencyHistogram& h) {
+            json j;
+            j["buckets_ms"] = std::vector<double>(std::begin(LatencyHistogram::kBoundsMs),
+                                                  std::end(LatencyHistogram::kBoundsMs));
+            j["counts"] = std::vector<uint64_t>(std::begin(h.counts), std::end(h.counts));
+            j["max_ms"] = h.max_ms;
+            j["avg_ms"] = h.total > 0 ? h.sum_ms / h.total : 0.0;
+            return j;
+        };
+        data["io"]["chunks"] = rs.io.chunks;
+        data["io"]["bytes"] = rs.io.bytes;
+        data["io"]["patches"] = rs.io.patches;
+        data["io"]["syncs"] = rs.io.syncs;
+        data["io"]["stalls"] = rs.io.stalls;
+        data["io"]["errors"] = rs.io.errors;
+        data["io"]["write_latency"] = histogram(rs.io.write_latency);
+        data["io"]["stall_latency"] = histogram(rs.io.stall_latency);
+        
+        auto ev = fs->GetEventStats();
+        data["event"]["active"] = ev.active;
+        data["event"]["triggers"] = ev.triggers;
+        data["event"]["recordings"] = ev.recordings;
+        data["event"]["prerecord_frames"] = ev.prerecord_frames;
+        data["event"]["prerecord_gaps"] = ev.prerecord_gaps;
+        data["event"]["buffer"]["enabled"] = ev.buffer.enabled;
+        data["event"]["buffer"]["capacity_bytes"] = ev.buffer.capacity_bytes;
+        data["event"]["buffer"]["frames"] = ev.buffer.frames;
+        data["event"]["buffer"]["bytes"] = ev.buffer.bytes;
+        data["event"]["buffer"]["duration_sec"] = ev.buffer.duration_sec;
+        data["event"]["buffer"]["space_evictions"] = ev.buffer.space_evictions;
+        data["event"]["buffer"]["oversized"] = ev.buffer.oversized;
+        
+        auto det = media::MediaManager::Instance().DetectionEvents().GetStats();
+        data["detection"]["enabled"] = det.enabled;
+        data["detection"]["state"] = media::DetectionEventStateToString(det.state);
+        data["detection"]["evaluations"] = det.evaluations;
+        data["detection"]["matched"] = det.matched;
+        data["detection"]["events"] = det.events;
+        data["detection"]["triggers"] = det.triggers;
+        data["detection"]["suppressed"] = det.suppressed;
+        data["detection"]["last_label"] = det.last_label;
+        data["detection"]["last_confidence"] = det.last_confidence;
+        
         res.set_content(json_response(true, "ok", data), "application/json");
     });
 
@@ -415,6 +806,56 @@ void HttpApi::SetupRoutes() {
         }
     });
 
+    // 事件触发录制：包含预录缓冲中的事件前画面，最后一次触发后继续录制 post_seconds
+    server_->Post("/api/record/event", [](const HttpRequest& /*req*/, HttpResponse& res) {
+        auto* mgr = GetStreamManager();
+        if (!mgr || !mgr->GetFileService()) {
+            res.set_content(json_response(false, "Recording not available"), "application/json");
+            return;
+        }
+        
+        if (mgr->GetFileService()->TriggerEventRecording("http")) {
+            res.set_content(json_response(true, "Event recording triggered"), "application/json");
+        } else {
+            res.set_content(json_response(false, "Failed to trigger recording"), "application/json");
+        }
+    });
+
+    // 检测事件规则：未给出的字段保持原值
+    server_->Post("/api/record/rules", [](const HttpRequest& req, HttpResponse& res) {
+        try {
+            json body = json::parse(req.body);
+            auto& engine = media::MediaManager::Instance().DetectionEvents();
+            media::DetectionEventConfig cfg = engine.GetConfig();
+            
+            cfg.enabled = body.value("enabled", cfg.enabled);
+            if (body.contains("classes")) {
+                cfg.classes = body["classes"].get<std::vector<std::string>>();
+            }
+            cfg.min_confidence = body.value("min_confidence", cfg.min_confidence);
+            cfg.min_area = body.value("min_area", cfg.min_area);
+            cfg.dwell_ms = body.value("dwell_ms", cfg.dwell_ms);
+            cfg.gap_ms = body.value("gap_ms", cfg.gap_ms);
+            cfg.cooldown_ms = body.value("cooldown_ms", cfg.cooldown_ms);
+            cfg.retrigger_ms = body.value("retrigger_ms", cfg.retrigger_ms);
+            engine.Configure(cfg);
+            
+            json data;
+            data["enabled"] = cfg.enabled;
+            data["classes"] = cfg.classes;
+            data["min_confidence"] = cfg.min_confidence;
+            data["min_area"] = cfg.min_area;
+            data["dwell_ms"] = cfg.dwell_ms;
+            data["gap_ms"] = cfg.gap_ms;
+            data["cooldown_ms"] = cfg.cooldown_ms;
+            data["retrigger_ms"] = cfg.retrigger_ms;
+            res.set_content(json_response(true, "Event rules updated", data), "application/json");
+            
+        } catch (const json::exception& e) {
+            res.set_content(json_response(false, std::string("Invalid JSON: ") + e.what()), "application/json");
+        }
+    });
+
     server_->Post("/api/record/stop", [](const HttpRequest& /*req*/, HttpResponse& res) {
         auto* mgr = GetStreamManager();
         if (!mgr || !mgr->GetFileService()) {
@@ -441,7 +882,130 @@ void HttpApi::SetupRoutes() {
         json data;
         data["mode"] = media::ProducerModeToString(mgr.GetCurrentMode());
         data["running"] = mgr.IsRunning();
-        data["available_modes"] = json::array({"simple_ipc", "yolov5", "retinaface"});
+        data["codec"] = media::VideoCodecToString(mgr.GetConfig().codec);
+        if (mgr.GetConfig().sub_stream) {
+            const auto& cfg = mgr.GetConfig();
+            data["sub_stream"] = {{"width", cfg.sub_width}, {"height", cfg.sub_height},
+                                  {"bitrate_kbps", cfg.sub_bitrate_kbps}};
+        }
+        data["available_modes"] = json::array({"simple_ipc", "yolov5", "retinaface", "yolo_face"});
+        
+        // 各流消费者的投递/丢帧/延迟统计
+        json consumers = json::array();
+        for (const auto& s : mgr.GetStreamConsumerStats()) {
+            json c;
+            c["name"] = s.name;
+            c["type"] = media::StreamConsumerTypeToString(s.type);
+            c["stream"] = media::StreamSelectorToString(s.stream);
+            c["delivered"] = s.delivered;
+            c["dropped"] = s.dropped;
+            c["avg_latency_us"] = s.avg_latency_us;
+            c["max_latency_us"] = s.max_latency_us;
+            if (s.type != media::StreamConsumerType::Direct) {
+                c["queue_depth"] = s.queue_depth;
+                c["queue_capacity"] = s.queue_capacity;
+            }
+            if (s.type == media::StreamConsumerType::AsyncIO) {
+                c["wakeups"] = s.wakeups;
+            }
+            consumers.push_back(c);
+        }
+        data["consumers"] = consumers;
+        
+        // 视频输出帧率与推理帧率（异步推理模式下相互独立）
+        auto ps = mgr.GetProducerStats();
+        json stats;
+        stats["video_frames"] = ps.video_frames;
+        stats["video_fps"] = ps.video_fps;
+        stats["inference_frames"] = ps.inference_frames;
+        stats["inference_fps"] = ps.inference_fps;
+        stats["async_inference"] = ps.async_inference;
+        stats["inference_interval"] = ps.inference_interval;
+        stats["predicted_frames"] = ps.predicted_frames;
+        stats["inference_divisor"] = ps.inference_divisor;
+        stats["keyframe_requests"] = ps.keyframe_requests;
+        stats["keyframes_forced"] = ps.keyframes_forced;
+        stats["keyframe_coalesced"] = ps.keyframe_coalesced;
+        data["stats"] = stats;
+        
+        // NPU 调度（组合模式：各模型的目标速率、实际速率与错过截止时间次数）
+        if (!ps.npu_tasks.empty()) {
+            json tasks = json::array();
+            for (const auto& t : ps.npu_tasks) {
+                tasks.push_back({{"name", t.name},
+                                 {"target_hz", t.target_hz},
+                                 {"rate_hz", t.rate_hz},
+                                 {"priority", t.priority},
+                                 {"runs", t.runs},
+                                 {"deadline_misses", t.deadline_misses},
+                                 {"avg_run_ms", t.avg_run_ms}});
+            }
+            data["npu_tasks"] = tasks;
+        }
+        
+        // GOP 缓存占用（新客户端秒开，帧已拷贝出 VENC buffer）
+        auto gop_json = [](const media::GopCacheStats& g) {
+            json j;
+            j["enabled"] = g.enabled;
+            j["budget_bytes"] = g.budget_bytes;
+            j["frames"] = g.frames;
+            j["bytes"] = g.bytes;
+            j["peak_bytes"] = g.peak_bytes;
+            j["gops"] = g.gops;
+            j["overflows"] = g.overflows;
+            j["snapshots"] = g.snapshots;
+            j["arena"] = {{"capacity_bytes", g.arena.capacity_bytes},
+                          {"reserved_bytes", g.arena.reserved_bytes},
+                          {"in_use_bytes", g.arena.in_use_bytes},
+                          {"peak_in_use_bytes", g.arena.peak_in_use_bytes},
+                          {"allocations", g.arena.allocations},
+                          {"grows", g.arena.grows},
+                          {"spills", g.arena.spills},
+                          {"trims", g.arena.trims},
+                          {"failures", g.arena.failures},
+                          {"header_fallbacks", g.arena.header_fallbacks}};
+            return j;
+        };
+        json gop;
+        gop["main"] = gop_json(ps.main_gop_cache);
+        gop["sub"] = gop_json(ps.sub_gop_cache);
+        data["gop_cache"] = gop;
+        
+        // 帧句柄内存池（fallback 非零说明在途帧超过池容量，句柄退回堆分配）
+        auto pool_json = [](uint64_t pooled, uint64_t fallback, size_t in_use) {
+            return json{{"pooled", pooled}, {"fallback", fallback}, {"in_use", in_use}};
+        };
+        auto hs = media::get_frame_handle_pool_stats();
+        data["frame_handles"] = {
+            {"streams", pool_json(hs.streams.pooled, hs.streams.fallback, hs.streams.inUse)},
+            {"frames", pool_json(hs.frames.pooled, hs.frames.fallback, hs.frames.inUse)},
+            {"control_blocks", pool_json(hs.control_blocks.pooled, hs.control_blocks.fallback,
+                                         hs.control_blocks.inUse)}};
+        
+        // 模式切换耗时（暖切换：ISP/VI 保持运行，仅重建 VPSS/VENC 与推理引擎）
+        auto ss = mgr.GetModeSwitchStats();
+        json sw;
+        sw["count"] = ss.count;
+        sw["last_ms"] = ss.last_ms;
+        sw["last_teardown_ms"] = ss.last_teardown_ms;
+        sw["last_init_ms"] = ss.last_init_ms;
+        sw["avg_ms"] = ss.avg_ms;
+        sw["max_ms"] = ss.max_ms;
+        sw["warm"] = ss.warm;
+        if (ss.count > 0) {
+            sw["last_from"] = media::ProducerModeToString(ss.last_from);
+            sw["last_to"] = media::ProducerModeToString(ss.last_to);
+        }
+        data["switch"] = sw;
+        
+        // JPEG 抓拍（encodes 远小于 requests 说明缓存在合并突发请求）
+        const auto& snap = ps.snapshot;
+        data["snapshot"] = {{"enabled", snap.enabled},
+                            {"requests", snap.requests},
+                            {"encodes", snap.encodes},
+                            {"cache_hits", snap.cache_hits},
+                            {"failures", snap.failures},
+                            {"last_encode_ms", snap.last_encode_ms}};
         
         res.set_content(json_response(true, "ok", data), "application/json");
     });
@@ -457,6 +1021,8 @@ void HttpApi::SetupRoutes() {
             media::ProducerMode target_mode;
             if (mode_str == "yolov5" || mode_str == "yolo") {
                 target_mode = media::ProducerMode::YoloV5;
+            } else if (mode_str == "yolo_face" || mode_str == "yoloface") {
+                target_mode = media::ProducerMode::YoloFace;
             } else if (mode_str == "retinaface" || mode_str == "face") {
                 target_mode = media::ProducerMode::RetinaFace;
             } else {
@@ -472,7 +1038,7 @@ void HttpApi::SetupRoutes() {
                 return;
             }
             
-            // 切换模式（冷切换）
+            // 切换模式（暖切换）
             if (mgr.SwitchMode(target_mode) != 0) {
                 res.set_content(json_response(false, "Failed to switch producer mode"), "application/json");
                 return;
@@ -487,17 +1053,80 @@ void HttpApi::SetupRoutes() {
         }
     });
 
+    // ========================================================================
+    // JPEG 抓拍
+    // ========================================================================
+    // ?width=W&height=H 缩略图尺寸（只给一边时等比，VPSS 硬件缩放）；
+    // ?detections=1 以 X-Detections 头附带最近一次检测结果（坐标为主码流画面像素）
+    server_->Get("/api/snapshot", [](const HttpRequest& req, HttpResponse& res) {
+        media::SnapshotRequest request;
+        if (req.has_param("width")) {
+            request.width = std::atoi(req.get_param_value("width").c_str());
+        }
+        if (req.has_param("height")) {
+            request.height = std::atoi(req.get_param_value("height").c_str());
+        }
+
+        auto& mgr = media::MediaManager::Instance();
+        media::Snapshot snap;
+        if (mgr.CaptureSnapshot(request, &snap) != 0 || !snap.jpeg) {
+            res.status = 503;
+            res.set_content(json_response(false, "Snapshot unavailable"), "application/json");
+            return;
+        }
+
+        res.set_header("Cache-Control", "no-cache");
+        res.set_header("X-Frame-Pts", std::to_string(snap.pts));
+        if (req.get_param_value("detections") == "1") {
+            constexpr size_t kMaxHeaderDetections = 32;
+            json dets = json::array();
+            json meta = {{"pts", 0}, {"frame_width", 0}, {"frame_height", 0}};
+            if (auto latest = mgr.GetLatestDetections()) {
+                meta["pts"] = latest->results.pts;
+                meta["frame_width"] = latest->frame_width;
+                meta["frame_height"] = latest->frame_height;
+                for (const auto& d : latest->results.results) {
+                    if (dets.size() >= kMaxHeaderDetections) {
+                        break;
+                    }
+                    json det = {{"class_id", d.class_id},
+                                {"label", d.label},
+                                {"score", d.confidence},
+                                {"box", {d.box.x, d.box.y, d.box.width, d.box.height}}};
+                    if (d.track_id >= 0) {
+                        det["track_id"] = d.track_id;
+                    }
+                    dets.push_back(std::move(det));
+                }
+            }
+            meta["detections"] = std::move(dets);
+            res.set_header("X-Detections", meta.dump(-1, ' ', true));
+        }
+
+        auto jpeg = snap.jpeg;
+        res.set_content_provider(
+            jpeg->size(), "image/jpeg",
+            [jpeg](size_t offset, size_t length, httplib::DataSink& sink) {
+                return sink.write(jpeg->data() + offset, std::min(length, jpeg->size() - offset));
+            });
+    });
+
     // ========================================================================
     // AI API（前端兼容接口）
     // ========================================================================
-    server_->Get("/api/ai/status", [](const HttpRequest& /*req*/, HttpResponse& res) {
+    status_->Add("ai", []() {
         auto& mgr = media::MediaManager::Instance();
         auto mode = mgr.GetCurrentMode();
         
         json data;
         // has_model: 是否加载了 AI 模型
+        // 回放模式：NV12 原始帧回放时加载模型
+        const auto& replay = mgr.GetConfig().replay;
+        const bool replay_model = (mode == media::ProducerMode::Replay &&
+                                   replay.format == media::ReplayFormat::kNV12);
         bool has_model = (mode == media::ProducerMode::YoloV5 || 
-                          mode == media::ProducerMode::RetinaFace);
+                          mode == media::ProducerMode::RetinaFace ||
+                          mode == media::ProducerMode::YoloFace || replay_model);
         data["has_model"] = has_model;
         
         // model_type: 模型类型名称
@@ -505,18 +1134,93 @@ void HttpApi::SetupRoutes() {
             data["model_type"] = "yolov5";
         } else if (mode == media::ProducerMode::RetinaFace) {
             data["model_type"] = "retinaface";
+        } else if (mode == media::ProducerMode::YoloFace) {
+            data["model_type"] = "yolo_face";
+        } else if (replay_model) {
+            data["model_type"] = replay.model;
         } else {
             data["model_type"] = "none";
         }
         
-        // stats: AI 统计信息（当前未实现详细统计，返回占位数据）
+        // stats: AI 统计信息
+        auto ps = mgr.GetProducerStats();
         json stats;
-        stats["frames_processed"] = 0;
-        stats["avg_inference_ms"] = 0;
-        stats["total_detections"] = 0;
+        stats["frames_processed"] = ps.inference_frames;
+        stats["avg_inference_ms"] = ps.avg_inference_ms;
+        stats["total_detections"] = ps.total_detections;
+        stats["video_fps"] = ps.video_fps;
+        stats["inference_fps"] = ps.inference_fps;
+        stats["async_inference"] = ps.async_inference;
+        stats["inference_interval"] = ps.inference_interval;
+        stats["predicted_frames"] = ps.predicted_frames;
+        stats["inference_divisor"] = ps.inference_divisor;
         data["stats"] = stats;
         
-        res.set_content(json_response(true, "ok", data), "application/json");
+        // osd: RGN 叠框的 MPI 调用统计（用于验证增量更新效果）
+        if (ps.osd_enabled) {
+            json osd;
+            osd["updates"] = ps.osd_updates;
+            osd["mpi_calls_total"] = ps.osd_mpi_calls;
+            osd["mpi_calls_last"] = ps.osd_last_mpi_calls;
+            osd["moves_last"] = ps.osd_last_moves;
+            osd["bitmaps_last"] = ps.osd_last_bitmaps;
+            osd["handles_created"] = ps.osd_handles_created;
+            osd["handles_visible"] = ps.osd_handles_visible;
+            data["osd"] = osd;
+        }
+        
+        // motion_gate: 运动门控（gating_ratio = 因画面静止跳过推理的帧占比）
+        if (ps.motion_gate) {
+            json motion;
+            motion["active"] = ps.motion_active;
+            motion["frames"] = ps.motion_frames;
+            motion["gated_frames"] = ps.motion_gated_frames;
+            motion["gating_ratio"] = ps.motion_frames > 0
+                ? static_cast<double>(ps.motion_gated_frames) / ps.motion_frames : 0.0;
+            data["motion_gate"] = motion;
+        }
+        
+        // smart_encode: 检测驱动编码（ROI 区域与静止场景降码率状态）
+        const auto& se = ps.smart_encode;
+        if (se.roi || se.smart_rate) {
+            json smart;
+            smart["roi"] = se.roi;
+            smart["smart_rate"] = se.smart_rate;
+            smart["idle"] = se.idle;
+            smart["bitrate_kbps"] = se.bitrate_kbps;
+            smart["fps"] = se.fps;
+            smart["idle_transitions"] = se.idle_transitions;
+            smart["roi_regions"] = se.roi_regions;
+            smart["roi_updates"] = se.roi_updates;
+            data["smart_encode"] = smart;
+        }
+        
+        // model_cache: 常驻模型与内存占用（AI 模式切换命中缓存时无需重新加载）
+        auto cs = rknn::ModelCache::Instance().GetStats();
+        json cache;
+        cache["total_bytes"] = cs.total_bytes;
+        cache["limit_bytes"] = cs.limit_bytes;
+        cache["hits"] = cs.hits;
+        cache["misses"] = cs.misses;
+        cache["evictions"] = cs.evictions;
+        json models = json::array();
+        for (const auto& e : cs.entries) {
+            json m;
+            m["name"] = e.name;
+            m["memory_bytes"] = e.memory_bytes;
+            m["load_ms"] = e.load_ms;
+            m["hits"] = e.hits;
+            m["warm"] = e.warm;
+            m["in_use"] = e.in_use;
+            models.push_back(m);
+        }
+        cache["models"] = models;
+        data["model_cache"] = cache;
+        
+        return json_response(true, "ok", data);
+    });
+    server_->Get("/api/ai/status", [this](const HttpRequest& /*req*/, HttpResponse& res) {
+        res.set_content(*status_->Get("ai"), "application/json");
     });
     
     server_->Post("/api/ai/switch", [](const HttpRequest& req, HttpResponse& res) {
@@ -530,6 +1234,8 @@ void HttpApi::SetupRoutes() {
             media::ProducerMode target_mode;
             if (model_str == "yolov5" || model_str == "yolo") {
                 target_mode = media::ProducerMode::YoloV5;
+            } else if (model_str == "yolo_face" || model_str == "yoloface") {
+                target_mode = media::ProducerMode::YoloFace;
             } else if (model_str == "retinaface" || model_str == "face") {
                 target_mode = media::ProducerMode::RetinaFace;
             } else {
@@ -545,7 +1251,7 @@ void HttpApi::SetupRoutes() {
                 return;
             }
             
-            // 切换模式（冷切换）
+            // 切换模式（暖切换）
             if (mgr.SwitchMode(target_mode) != 0) {
                 res.set_content(json_response(false, "Failed to switch AI model"), "application/json");
                 return;
@@ -571,9 +1277,11 @@ void HttpApi::SetupRoutes() {
         
         json data;
         
-        // mode: parallel (纯 IPC) / serial (AI 推理)
+        // mode: parallel (纯 IPC) / serial (AI 推理) / replay (文件回放)
         if (mode == media::ProducerMode::SimpleIPC) {
             data["mode"] = "parallel";
+        } else if (mode == media::ProducerMode::Replay) {
+            data["mode"] = "replay";
         } else {
             data["mode"] = "serial";
         }
@@ -663,5 +1371,275 @@ void HttpApi::SetupRoutes() {
         }
     });
 
+    // ========================================================================
+    // WebSocket 预览状态 API
+    // ========================================================================
+    server_->Get("/api/wspreview/status", [](const HttpRequest& /*req*/, HttpResponse& res) {
+        auto* mgr = GetStreamManager();
+        if (!mgr || !mgr->GetWsPreviewServer()) {
+            res.set_content(json_response(false, "WebSocket preview not available"), "application/json");
+            return;
+        }
+
+        auto* ws = mgr->GetWsPreviewServer();
+        auto stats = ws->GetStats();
+        json data;
+        data["running"] = ws->IsRunning();
+        data["port"] = ws->GetPort();
+        data["frames_sent"] = stats.framesSent;
+        data["bytes_sent"] = stats.bytesSent;
+        data["gop_bursts"] = stats.gopBursts;
+        data["frames_dropped"] = stats.framesDropped;
+        data["clients_evicted"] = stats.clientsEvicted;
+        data["metadata_sent"] = stats.metadataSent;
+        data["metadata_dropped"] = stats.metadataDropped;
+        data["keyframe_only"] = stats.keyframeOnly;
+        data["frames_skipped"] = stats.framesSkipped;
+        json clients = json::array();
+        for (const auto& c : stats.clients) {
+            json client;
+            client["address"] = c.address;
+            client["metadata"] = c.metadata;
+            client["lagging"] = c.lagging;
+            client["lag_ms"] = c.lagMs;
+            client["frames_sent"] = c.framesSent;
+            client["frames_dropped"] = c.framesDropped;
+            client["drop_events"] = c.dropEvents;
+            client["bytes_sent"] = c.bytesSent;
+            client["queued_bytes"] = c.queuedBytes;
+            client["peak_queued_bytes"] = c.peakQueuedBytes;
+            client["duration_ms"] = c.durationMs;
+            clients.push_back(client);
+        }
+        data["clients"] = clients;
+        res.set_content(json_response(true, "ok", data), "application/json");
+    });
+
+    // ========================================================================
+    // 负载调度状态 API
+    // ========================================================================
+    server_->Get("/api/governor/status", [](const HttpRequest& /*req*/, HttpResponse& res) {
+        auto status = LoadGovernor::Instance().GetStatus();
+        json data;
+        data["enabled"] = status.enabled;
+        data["running"] = status.running;
+        data["level"] = status.engaged.size();
+        data["ladder"] = status.ladder;
+        data["engaged"] = status.engaged;
+        data["pressure"] = status.pressure;
+        data["degrades"] = status.degrades;
+        data["restores"] = status.restores;
+        json sample;
+        sample["cpu_percent"] = status.sample.cpu_percent;
+        sample["temp_c"] = status.sample.temp_c;
+        sample["inference_latency_ms"] = status.sample.inference_latency_ms;
+        sample["drop_ratio"] = status.sample.drop_ratio;
+        data["sample"] = sample;
+        res.set_content(json_response(true, "ok", data), "application/json");
+    });
+
+    // ========================================================================
+    // LL-HLS
+    // ========================================================================
+    // 阻塞式刷新：?_HLS_msn=N&_HLS_part=M 等到该 part 发布后返回
+    // 可能等待发布的请求在独立线程池上执行（GetBlocking），不占用 /api/* 的工作线程
+    server_->GetBlocking("/hls/live.m3u8", [](const HttpRequest& req, HttpResponse& res) {
+        auto* mgr = GetStreamManager();
+        if (!mgr || !mgr->GetHlsPackager()) {
+            res.status = 404;
+            return;
+        }
+        int64_t msn = -1;
+        int64_t part = -1;
+        if (req.has_param("_HLS_msn")) {
+            msn = std::strtoll(req.get_param_value("_HLS_msn").c_str(), nullptr, 10);
+            if (req.has_param("_HLS_part")) {
+                part = std::strtoll(req.get_param_value("_HLS_part").c_str(), nullptr, 10);
+            }
+        }
+        std::shared_ptr<const std::string> playlist;
+        if (!hls_status(res, mgr->GetHlsPackager()->GetPlaylist(msn, part, &playlist))) {
+            return;
+        }
+        res.set_header("Cache-Control", "no-cache");
+        res.set_content(*playlist, "application/vnd.apple.mpegurl");
+    });
+
+    server_->GetBlocking("/hls/init.mp4", [](const HttpRequest& /*req*/, HttpResponse& res) {
+        auto* mgr = GetStreamManager();
+        HlsPackager* hls = mgr ? mgr->GetHlsPackager() : nullptr;
+        HlsResource resource;
+        if (!hls) {
+            res.status = 404;
+        } else if (hls_status(res, hls->GetInit(&resource))) {
+            set_hls_content(res, hls, std::move(resource), "video/mp4");
+        }
+    });
+
+    server_->GetBlocking(R"(/hls/seg_(\d+)\.m4s)", [](const HttpRequest& req, HttpResponse& res) {
+        auto* mgr = GetStreamManager();
+        HlsPackager* hls = mgr ? mgr->GetHlsPackager() : nullptr;
+        HlsResource resource;
+        if (!hls) {
+            res.status = 404;
+        } else if (hls_status(res, hls->GetSegment(std::stoull(req.matches[1]), &resource))) {
+            set_hls_content(res, hls, std::move(resource), "video/iso.segment");
+        }
+    });
+
+    server_->GetBlocking(R"(/hls/part_(\d+)_(\d+)\.m4s)", [](const HttpRequest& req, HttpResponse& res) {
+        auto* mgr = GetStreamManager();
+        HlsPackager* hls = mgr ? mgr->GetHlsPackager() : nullptr;
+        HlsResource resource;
+        if (!hls) {
+            res.status = 404;
+        } else if (hls_status(res, hls->GetPart(std::stoull(req.matches[1]),
+                                                static_cast<uint32_t>(std::stoul(req.matches[2])),
+                                                &resource))) {
+            set_hls_content(res, hls, std::move(resource), "video/iso.segment");
+        }
+    });
+
+    server_->Get("/api/hls/status", [](const HttpRequest& /*req*/, HttpResponse& res) {
+        auto* mgr = GetStreamManager();
+        if (!mgr || !mgr->GetHlsPackager()) {
+            res.set_content(json_response(false, "HLS not available"), "application/json");
+            return;
+        }
+
+        auto* hls = mgr->GetHlsPackager();
+        auto stats = hls->GetStats();
+        json data;
+        data["url"] = "/hls/live.m3u8";
+        data["active"] = stats.active;
+        data["codec"] = media::VideoCodecToString(hls->config().codec);
+        data["width"] = hls->config().width;
+        data["height"] = hls->config().height;
+        data["part_target_ms"] = hls->config().partTargetMs;
+        data["frames_packaged"] = stats.framesPackaged;
+        data["parts_published"] = stats.partsPublished;
+        data["segments_published"] = stats.segmentsPublished;
+        data["primed_frames"] = stats.primedFrames;
+        data["requests"] = stats.requests;
+        data["blocked_requests"] = stats.blockedRequests;
+        data["bytes_served"] = stats.bytesServed;
+        data["first_msn"] = stats.firstMsn;
+        data["segments"] = stats.segments;
+        data["window_bytes"] = stats.windowBytes;
+        res.set_content(json_response(true, "ok", data), "application/json");
+    });
+
+    // ========================================================================
+    // 指标 API（Prometheus 文本格式，供集中抓取）
+    // ========================================================================
+    server_->Get("/api/metrics", [this](const HttpRequest& /*req*/, HttpResponse& res) {
+        auto& mgr = media::MediaManager::Instance();
+        media::PrometheusWriter out;
+
+        // 热路径记录的计数器与阶段耗时直方图
+        media::MetricsRegistry::Instance().Render(out);
+
+        // 采集时计算的状态：各消费者队列深度与投递 / 丢帧数
+        auto consumers = mgr.GetStreamConsumerStats();
+        auto consumer_labels = [](const media::StreamConsumerStats& s) {
+            return media::PrometheusWriter::Labels{
+                {"consumer", s.name}, {"stream", media::StreamSelectorToString(s.stream)}};
+        };
+        out.Family("aipc_consumer_queue_depth", "gauge", "Frames waiting in a consumer queue");
+        for (const auto& s : consumers) {
+            out.Sample("aipc_consumer_queue_depth", consumer_labels(s),
+                       static_cast<uint64_t>(s.queue_depth));
+        }
+        out.Family("aipc_consumer_queue_capacity", "gauge", "Consumer queue capacity");
+        for (const auto& s : consumers) {
+            out.Sample("aipc_consumer_queue_capacity", consumer_labels(s),
+                       static_cast<uint64_t>(s.queue_capacity));
+        }
+        out.Family("aipc_consumer_delivered_frames_total", "counter",
+                   "Frames delivered to a consumer callback");
+        for (const auto& s : consumers) {
+            out.Sample("aipc_consumer_delivered_frames_total", consumer_labels(s), s.delivered);
+        }
+        out.Family("aipc_consumer_dropped_frames_total", "counter",
+                   "Frames dropped by consumer backpressure");
+        for (const auto& s : consumers) {
+            out.Sample("aipc_consumer_dropped_frames_total", consumer_labels(s), s.dropped);
+        }
+
+        // 生产者帧率（视频与推理）
+        auto ps = mgr.GetProducerStats();
+        const media::PrometheusWriter::Labels mode{
+            {"mode", media::ProducerModeToString(mgr.GetCurrentMode())}};
+        out.Family("aipc_video_fps", "gauge", "Encoded video frame rate");
+        out.Sample("aipc_video_fps", mode, ps.video_fps);
+        out.Family("aipc_inference_fps", "gauge", "AI inference rate");
+        out.Sample("aipc_inference_fps", mode, ps.inference_fps);
+
+        // 帧句柄池退回堆分配的次数（非零说明在途帧超过池容量）
+        auto hs = media::get_frame_handle_pool_stats();
+        out.Family("aipc_frame_handle_fallbacks_total", "counter",
+                   "Frame handle allocations that fell back to the heap");
+        out.Sample("aipc_frame_handle_fallbacks_total", {{"pool", "streams"}}, hs.streams.fallback);
+        out.Sample("aipc_frame_handle_fallbacks_total", {{"pool", "frames"}}, hs.frames.fallback);
+        out.Sample("aipc_frame_handle_fallbacks_total", {{"pool", "control_blocks"}},
+                   hs.control_blocks.fallback);
+
+        // HTTP 连接复用（requests_reused / requests_total 接近 1 说明客户端在复用 keep-alive）
+        auto http = server_->GetStats();
+        const media::PrometheusWriter::Labels http_mode{{"mode", http.mode}};
+        out.Family("aipc_http_requests_total", "counter", "HTTP requests handled");
+        out.Sample("aipc_http_requests_total", http_mode, http.requests_total);
+        out.Family("aipc_http_requests_reused_total", "counter",
+                   "HTTP requests served on a reused keep-alive connection");
+        out.Sample("aipc_http_requests_reused_total", http_mode, http.requests_reused);
+        out.Family("aipc_http_connections", "gauge", "Open HTTP connections");
+        out.Sample("aipc_http_connections", http_mode, http.connections_active);
+        out.Family("aipc_http_event_streams", "gauge", "Open HTTP event stream subscriptions");
+        out.Sample("aipc_http_event_streams", http_mode, http.event_streams);
+
+        res.set_content(out.Take(), "text/plain; version=0.0.4; charset=utf-8");
+    });
+
+    // 最近帧的端到端延迟明细（采集 PTS -> 各阶段，按帧归组，旧 -> 新）
+    server_->Get("/api/latency/trace", [](const HttpRequest& req, HttpResponse& res) {
+        size_t max_frames = 30;
+        if (req.has_param("frames")) {
+            max_frames = std::clamp<size_t>(std::strtoul(req.get_param_value("frames").c_str(),
+                                                         nullptr, 10), 1, 300);
+        }
+
+        auto& tracer = media::LatencyTracer::Instance();
+        auto events = tracer.Recent(media::LatencyTracer::kRingSize);
+
+        // 事件按发生顺序写入，同一帧的各阶段分散在环中；按 PTS 归组后取最新的若干帧
+        std::vector<uint64_t> order;
+        std::map<uint64_t, json> frames;
+        for (const auto& e : events) {
+            auto it = frames.find(e.pts);
+            if (it == frames.end()) {
+                order.push_back(e.pts);
+                it = frames.emplace(e.pts, json{{"pts", e.pts}, {"stages", json::array()}}).first;
+            }
+            json stage{{"stage", media::LatencyTracer::StageToString(e.stage)},
+                       {"latency_us", e.latency_us}};
+            auto tag = tracer.TagName(e);
+            if (!tag.empty()) {
+                stage["tag"] = tag;
+            }
+            it->second["stages"].push_back(std::move(stage));
+        }
+
+        json list = json::array();
+        const size_t first = order.size() > max_frames ? order.size() - max_frames : 0;
+        for (size_t i = first; i < order.size(); ++i) {
+            list.push_back(std::move(frames[order[i]]));
+        }
+
+        json data;
+        data["sei_enabled"] = tracer.SeiEnabled();
+        data["frames"] = list;
+        res.set_content(json_response(true, "ok", data), "application/json");
+    });
+
     LOG_INFO("HTTP API 路由配置完成");
 }
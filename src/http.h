@@ -3,17 +3,29 @@
  * @brief HTTP API 模块 - 提供 REST API 接口控制系统
  *
  * 支持的 API:
- * - GET  /api/status          获取系统状态
+ * - GET  /api/status          获取系统状态（快照，最多每秒重建一次）
+ * - GET  /api/events          状态事件流（SSE，事件 status / ai，内容变化时推送）
  * - GET  /api/rtsp/status     获取 RTSP 状态
  * - POST /api/webrtc/start    启动 WebRTC
  * - POST /api/webrtc/stop     停止 WebRTC
+ * - POST /api/webrtc/close    关闭一个 WebRTC 观看者会话
  * - GET  /api/record/status   获取录制状态
  * - POST /api/record/start    开始录制
  * - POST /api/record/stop     停止录制
- * - GET  /api/ai/status       获取 AI 模型状态
- * - POST /api/ai/switch       切换 AI 模型
+ * - GET  /api/ai/status       获取 AI 模型状态（快照，同 /api/status）
+ * - POST /api/ai/switch       切换 AI 模型（yolov5 / retinaface / yolo_face / none）
  * - GET  /api/pipeline/status 获取管道模式状态（实验性）
  * - POST /api/pipeline/switch 切换管道模式（实验性）
+ * - GET  /api/wspreview/status 获取 WebSocket 预览状态（含每个客户端的排队与丢帧）
+ * - GET  /api/hls/status      获取 LL-HLS 打包状态
+ * - GET  /api/governor/status 获取负载调度状态（采样指标、已启用的降级级别）
+ * - GET  /api/snapshot        JPEG 抓拍（?width=&height= 缩略图，?detections=1 附带检测结果）
+ *
+ * LL-HLS（播放器直接访问）:
+ * - GET  /hls/live.m3u8       播放列表（支持 _HLS_msn / _HLS_part 阻塞式刷新）
+ * - GET  /hls/init.mp4        init 段
+ * - GET  /hls/seg_<n>.m4s     完整分段
+ * - GET  /hls/part_<n>_<i>.m4s  part（预告的下一个 part 会等到发布后返回）
  *
  * @author 好软，好温暖
  * @date 2026-01-31
@@ -26,6 +38,8 @@
 #include "httpserver/http_server.h"
 #include "stream_manager.h"
 
+class StatusPublisher;
+
 // ============================================================================
 // HTTP API 配置
 // ============================================================================
@@ -35,6 +49,8 @@ struct HttpApiConfig {
     int port = 8080;                    ///< 监听端口
     std::string static_dir = "/app/www"; ///< 静态文件目录
     int thread_pool_size = 1;           ///< 线程池大小
+    int blocking_pool_size = 4;         ///< LL-HLS 阻塞请求的独立线程数（仅 asio 模式）
+    HttpServerMode mode = HttpServerMode::kThreaded;  ///< 服务器模式（kAsio 共用 IoContext）
 };
 
 // ============================================================================
@@ -93,4 +109,5 @@ private:
     HttpApiConfig config_;
     StreamConfig stream_config_;
     std::unique_ptr<HttpServer> server_;
+    std::shared_ptr<StatusPublisher> status_;   ///< /api/status 等的快照与事件推送
 };
@@ -0,0 +1,928 @@
+/**
+ * @file asio_http_server.cpp
+ * @brief 事件驱动 HTTP/1.1 服务器实现
+ */
+
+#include "asio_http_server.h"
+#include "common/logger.h"
+
+// cpp-httplib (header-only)：仅使用 Request / Response / DataSink 类型
+#include <httplib.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <deque>
+
+namespace {
+
+constexpr size_t kMaxHeaderSize = 16 * 1024;           ///< 请求行 + 头部上限
+constexpr size_t kMaxBodySize = 1024 * 1024;           ///< 请求体上限（API 只收 JSON）
+constexpr size_t kMaxEventBacklog = 256 * 1024;        ///< 事件流发送队列上限，超出断开
+constexpr size_t kStaticChunkSize = 32 * 1024;         ///< 静态文件每次读出 / 写出的块大小
+
+bool EqualsIgnoreCase(const std::string& a, const char* b) {
+    size_t i = 0;
+    for (; i < a.size() && b[i] != '\0'; ++i) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) !=
+            std::tolower(static_cast<unsigned char>(b[i]))) {
+            return false;
+        }
+    }
+    return i == a.size() && b[i] == '\0';
+}
+
+std::string Trim(const std::string& s) {
+    size_t begin = s.find_first_not_of(" \t");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    size_t end = s.find_last_not_of(" \t\r");
+    return s.substr(begin, end - begin + 1);
+}
+
+int HexValue(char ch) {
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+    return -1;
+}
+
+/// 百分号解码；查询参数中 '+' 表示空格
+std::string DecodeUrl(const std::string& s, bool plus_as_space) {
+    std::string out;
+    out.reserve(s.size());
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == '%' && i + 2 < s.size() && HexValue(s[i + 1]) >= 0 && HexValue(s[i + 2]) >= 0) {
+            out += static_cast<char>(HexValue(s[i + 1]) * 16 + HexValue(s[i + 2]));
+            i += 2;
+        } else if (s[i] == '+' && plus_as_space) {
+            out += ' ';
+        } else {
+            out += s[i];
+        }
+    }
+    return out;
+}
+
+void ParseQuery(const std::string& query, httplib::Params& params) {
+    size_t pos = 0;
+    while (pos <= query.size()) {
+        size_t end = query.find('&', pos);
+        if (end == std::string::npos) end = query.size();
+        if (end > pos) {
+            std::string item = query.substr(pos, end - pos);
+            size_t eq = item.find('=');
+            if (eq == std::string::npos) {
+                params.emplace(DecodeUrl(item, true), "");
+            } else {
+                params.emplace(DecodeUrl(item.substr(0, eq), true),
+                               DecodeUrl(item.substr(eq + 1), true));
+            }
+        }
+        pos = end + 1;
+    }
+}
+
+const char* StatusReason(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 204: return "No Content";
+        case 206: return "Partial Content";
+        case 301: return "Moved Permanently";
+        case 302: return "Found";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 408: return "Request Timeout";
+        case 411: return "Length Required";
+        case 413: return "Payload Too Large";
+        case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
+        case 503: return "Service Unavailable";
+        default:  return "Unknown";
+    }
+}
+
+const char* MimeType(const std::string& path) {
+    static const std::pair<const char*, const char*> kTypes[] = {
+        {".html", "text/html"},         {".htm", "text/html"},
+        {".js", "text/javascript"},     {".mjs", "text/javascript"},
+        {".css", "text/css"},           {".json", "application/json"},
+        {".map", "application/json"},   {".txt", "text/plain"},
+        {".png", "image/png"},          {".jpg", "image/jpeg"},
+        {".jpeg", "image/jpeg"},        {".gif", "image/gif"},
+        {".svg", "image/svg+xml"},      {".ico", "image/x-icon"},
+        {".wasm", "application/wasm"},  {".woff", "font/woff"},
+        {".woff2", "font/woff2"},       {".ttf", "font/ttf"},
+        {".mp4", "video/mp4"},          {".m3u8", "application/vnd.apple.mpegurl"},
+    };
+    size_t dot = path.rfind('.');
+    if (dot != std::string::npos) {
+        std::string ext = path.substr(dot);
+        for (const auto& [suffix, type] : kTypes) {
+            if (EqualsIgnoreCase(ext, suffix)) {
+                return type;
+            }
+        }
+    }
+    return "application/octet-stream";
+}
+
+}  // namespace
+
+struct AsioHttpServer::StaticFile {
+    int fd = -1;
+    size_t remaining = 0;       ///< 尚未读出的字节数
+
+    ~StaticFile() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+};
+
+// ============================================================================
+// 连接
+// ============================================================================
+
+/**
+ * @brief 单个 HTTP 连接（全部成员只在 "http" strand 上访问）
+ *
+ * 请求按顺序处理：一个请求的响应入队后才读下一个请求，流水线请求的响应顺序不变
+ */
+class AsioHttpConnection : public std::enable_shared_from_this<AsioHttpConnection> {
+public:
+    AsioHttpConnection(asio::ip::tcp::socket socket, AsioHttpServer* server)
+        : socket_(std::move(socket)),
+          server_(server),
+          read_buffer_(kMaxHeaderSize + kMaxBodySize),
+          timer_(server->strand_) {
+        asio::error_code ec;
+        auto endpoint = socket_.remote_endpoint(ec);
+        if (!ec) {
+            peer_addr_ = endpoint.address().to_string();
+            peer_port_ = endpoint.port();
+        }
+        socket_.set_option(asio::ip::tcp::no_delay(true), ec);
+    }
+
+    void Start() { ReadRequest(); }
+
+    /**
+     * @brief 关闭连接（可重复调用）
+     */
+    void Close(const char* reason) {
+        if (closed_) {
+            return;
+        }
+        closed_ = true;
+
+        asio::error_code ec;
+        timer_.cancel();
+        socket_.shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+        socket_.close(ec);
+
+        if (channel_) {
+            channel_->Unsubscribe(subscription_);
+            channel_.reset();
+            server_->event_streams_active_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        LOG_DEBUG("HTTP connection {}:{} closed ({}), {} request(s)", peer_addr_, peer_port_,
+                  reason, requests_);
+        server_->RemoveConnection(this);
+    }
+
+    /**
+     * @brief 事件流：写出一条已编码的 SSE 帧
+     */
+    void Push(const HttpEventChannel::Message& message) {
+        if (closed_) {
+            return;
+        }
+        if (queued_bytes_ > kMaxEventBacklog) {
+            Close("event stream backlog");
+            return;
+        }
+        // 事件帧是不可变的共享缓冲，按引用写出
+        AsioHttpServer::Output output;
+        output.body.push_back(asio::buffer(*message));
+        output.holder = message;
+        Write(std::move(output));
+    }
+
+private:
+    // ------------------------------------------------------------------------
+    // 读请求
+    // ------------------------------------------------------------------------
+
+    void ReadRequest() {
+        waiting_request_ = true;
+        ArmIdleTimer();
+
+        auto self = shared_from_this();
+        asio::async_read_until(socket_, read_buffer_, "\r\n\r\n",
+                               [this, self](const asio::error_code& ec, size_t length) {
+            if (closed_) {
+                return;
+            }
+            waiting_request_ = false;
+            timer_.cancel();
+            if (ec) {
+                Close(ec == asio::error::eof ? "closed by peer" : ec.message().c_str());
+                return;
+            }
+
+            std::string head(asio::buffers_begin(read_buffer_.data()),
+                             asio::buffers_begin(read_buffer_.data()) + length);
+            read_buffer_.consume(length);
+
+            auto req = std::make_shared<HttpRequest>();
+            bool keep_alive = false;
+            if (!ParseHead(head, *req, &keep_alive)) {
+                WriteError(400);
+                return;
+            }
+            if (req->has_header("Transfer-Encoding")) {
+                WriteError(411);    // 只支持 Content-Length 请求体
+                return;
+            }
+
+            size_t body = std::strtoul(req->get_header_value("Content-Length").c_str(), nullptr, 10);
+            if (body > kMaxBodySize) {
+                WriteError(413);
+                return;
+            }
+            if (body > read_buffer_.size()) {
+                ReadBody(std::move(req), body, keep_alive);
+                return;
+            }
+            TakeBody(*req, body);
+            Dispatch(std::move(req), keep_alive);
+        });
+    }
+
+    void ReadBody(std::shared_ptr<HttpRequest> req, size_t length, bool keep_alive) {
+        // 与等待请求头共用超时：头部之后迟迟不发完请求体的连接同样关闭
+        waiting_request_ = true;
+        ArmIdleTimer("body timeout");
+
+        auto self = shared_from_this();
+        asio::async_read(socket_, read_buffer_,
+                         asio::transfer_exactly(length - read_buffer_.size()),
+                         [this, self, req, length, keep_alive](const asio::error_code& ec, size_t) {
+            if (closed_) {
+                return;
+            }
+            waiting_request_ = false;
+            timer_.cancel();
+            if (ec) {
+                Close(ec.message().c_str());
+                return;
+            }
+            TakeBody(*req, length);
+            Dispatch(req, keep_alive);
+        });
+    }
+
+    void TakeBody(HttpRequest& req, size_t length) {
+        if (length == 0) {
+            return;
+        }
+        req.body.assign(asio::buffers_begin(read_buffer_.data()),
+                        asio::buffers_begin(read_buffer_.data()) + length);
+        read_buffer_.consume(length);
+    }
+
+    bool ParseHead(const std::string& head, HttpRequest& req, bool* keep_alive) {
+        size_t line_end = head.find("\r\n");
+        std::string line = head.substr(0, line_end);
+        size_t sp1 = line.find(' ');
+        size_t sp2 = line.find(' ', sp1 + 1);
+        if (sp1 == std::string::npos || sp2 == std::string::npos) {
+            return false;
+        }
+        req.method = line.substr(0, sp1);
+        req.target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+        req.version = line.substr(sp2 + 1);
+
+        size_t query = req.target.find('?');
+        req.path = DecodeUrl(req.target.substr(0, query), false);
+        if (query != std::string::npos) {
+            ParseQuery(req.target.substr(query + 1), req.params);
+        }
+
+        size_t pos = line_end + 2;
+        while (pos < head.size()) {
+            size_t end = head.find("\r\n", pos);
+            if (end == std::string::npos || end == pos) break;
+            size_t colon = head.find(':', pos);
+            if (colon != std::string::npos && colon < end) {
+                req.headers.emplace(Trim(head.substr(pos, colon - pos)),
+                                    Trim(head.substr(colon + 1, end - colon - 1)));
+            }
+            pos = end + 2;
+        }
+        req.remote_addr = peer_addr_;
+        req.remote_port = peer_port_;
+
+        // HTTP/1.1 默认保持连接，HTTP/1.0 需显式 keep-alive
+        const std::string connection = req.get_header_value("Connection");
+        if (req.version == "HTTP/1.1") {
+            *keep_alive = !EqualsIgnoreCase(connection, "close");
+        } else {
+            *keep_alive = EqualsIgnoreCase(connection, "keep-alive");
+        }
+        return true;
+    }
+
+    // ------------------------------------------------------------------------
+    // 处理
+    // ------------------------------------------------------------------------
+
+    void Dispatch(std::shared_ptr<HttpRequest> req, bool keep_alive) {
+        ++requests_;
+        server_->requests_total_.fetch_add(1, std::memory_order_relaxed);
+        if (requests_ > 1) {
+            server_->requests_reused_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (req->method == "GET") {
+            if (const auto* stream = server_->FindEventStream(req->path)) {
+                StartEventStream(*stream);
+                return;
+            }
+        }
+
+        const size_t max_requests = static_cast<size_t>(std::max(1, server_->config_.keep_alive_max_count));
+        keep_alive = keep_alive && requests_ < max_requests;
+        const size_t requests_left = keep_alive ? max_requests - requests_ : 0;
+
+        // 处理器可能阻塞，交给工作线程（LL-HLS 阻塞式请求用独立线程池）；响应回到 strand 发送
+        const AsioHttpServer::Route* route = server_->Match(*req);
+        auto& workers = route && route->blocking ? *server_->blocking_workers_ : *server_->workers_;
+        auto self = shared_from_this();
+        asio::post(workers, [this, self, req, route, keep_alive, requests_left]() {
+            AsioHttpServer::Output response =
+                server_->Handle(*req, route, keep_alive, requests_left);
+            asio::post(socket_.get_executor(),
+                       [this, self, keep_alive, response = std::move(response)]() mutable {
+                if (closed_) {
+                    return;
+                }
+                close_after_write_ = !keep_alive;
+                Write(std::move(response));
+                if (keep_alive) {
+                    ReadRequest();
+                }
+            });
+        });
+    }
+
+    void WriteError(int status) {
+        std::string body = "Error: " + std::to_string(status);
+        close_after_write_ = true;
+        Write("HTTP/1.1 " + std::to_string(status) + " " + StatusReason(status) +
+              "\r\nContent-Type: text/plain\r\nContent-Length: " + std::to_string(body.size()) +
+              "\r\nConnection: close\r\n\r\n" + body);
+    }
+
+    // ------------------------------------------------------------------------
+    // 事件流
+    // ------------------------------------------------------------------------
+
+    void StartEventStream(const AsioHttpServer::EventStream& stream) {
+        std::vector<HttpEventChannel::Message> initial;
+        std::weak_ptr<AsioHttpConnection> weak = shared_from_this();
+        auto executor = socket_.get_executor();
+        subscription_ = stream.channel->Subscribe(
+            [weak, executor](const HttpEventChannel::Message& message) {
+                asio::post(executor, [weak, message]() {
+                    if (auto self = weak.lock()) {
+                        self->Push(message);
+                    }
+                });
+            },
+            &initial);
+        if (subscription_ == 0) {
+            Close("event stream closed");
+            return;
+        }
+        channel_ = stream.channel;
+        server_->event_streams_active_.fetch_add(1, std::memory_order_relaxed);
+        LOG_DEBUG("HTTP event stream {} opened by {}:{}", stream.path, peer_addr_, peer_port_);
+
+        // 不带 Content-Length，响应持续到连接关闭
+        Write("HTTP/1.1 200 OK\r\n"
+              "Content-Type: text/event-stream\r\n"
+              "Cache-Control: no-cache\r\n"
+              "Connection: keep-alive\r\n"
+              "X-Accel-Buffering: no\r\n\r\n");
+        for (const auto& message : initial) {
+            Push(message);
+        }
+        ScheduleHeartbeat();
+        WatchPeerClose();
+    }
+
+    void ScheduleHeartbeat() {
+        timer_.expires_after(HttpEventChannel::kHeartbeatInterval);
+        auto self = shared_from_this();
+        timer_.async_wait([this, self](const asio::error_code& ec) {
+            if (ec || closed_) {
+                return;
+            }
+            if (write_queue_.empty() && !writing_) {
+                Push(HttpEventChannel::Heartbeat());
+            }
+            ScheduleHeartbeat();
+        });
+    }
+
+    /// 事件流连接上不再有请求，保持一个读操作以尽快发现对端关闭
+    void WatchPeerClose() {
+        auto self = shared_from_this();
+        socket_.async_read_some(asio::buffer(discard_),
+                                [this, self](const asio::error_code& ec, size_t) {
+            if (closed_) {
+                return;
+            }
+            if (ec) {
+                Close(ec == asio::error::eof ? "closed by peer" : ec.message().c_str());
+                return;
+            }
+            WatchPeerClose();
+        });
+    }
+
+    // ------------------------------------------------------------------------
+    // 写出
+    // ------------------------------------------------------------------------
+
+    void Write(std::string data) {
+        AsioHttpServer::Output output;
+        output.head = std::move(data);
+        Write(std::move(output));
+    }
+
+    void Write(AsioHttpServer::Output output) {
+        if (closed_) {
+            return;
+        }
+        queued_bytes_ += output.size();
+        write_queue_.push_back(std::move(output));
+        Flush();
+    }
+
+    void Flush() {
+        if (closed_ || writing_ || write_queue_.empty()) {
+            return;
+        }
+
+        // 排队的项一次 scatter/gather 写出；deque 追加不移动已有元素，缓冲引用保持有效
+        writing_ = true;
+        write_buffers_.clear();
+        while (!write_queue_.empty()) {
+            auto file = std::move(write_queue_.front().file);
+            write_pending_.push_back(std::move(write_queue_.front()));
+            write_queue_.pop_front();
+            const AsioHttpServer::Output& output = write_pending_.back();
+            queued_bytes_ -= output.size();
+            if (!output.head.empty()) {
+                write_buffers_.push_back(asio::buffer(output.head));
+            }
+            write_buffers_.insert(write_buffers_.end(), output.body.begin(), output.body.end());
+
+            // 静态文件：读出一块随本批写出，未读完的部分放回队首，写完后继续
+            if (file) {
+                const size_t length = ReadFileChunk(*file);
+                if (length == 0) {
+                    Close("static file read failed");
+                    return;
+                }
+                write_buffers_.push_back(asio::buffer(file_chunk_.data(), length));
+                if (file->remaining > 0) {
+                    AsioHttpServer::Output rest;
+                    rest.file = std::move(file);
+                    write_queue_.push_front(std::move(rest));
+                }
+                break;
+            }
+        }
+
+        auto self = shared_from_this();
+        asio::async_write(socket_, write_buffers_,
+                          [this, self](const asio::error_code& ec, size_t) {
+            writing_ = false;
+            write_buffers_.clear();
+            write_pending_.clear();     // 释放响应体引用（LL-HLS 共享缓冲等）
+            if (closed_) {
+                return;
+            }
+            if (ec) {
+                Close(ec.message().c_str());
+                return;
+            }
+            if (!write_queue_.empty()) {
+                Flush();
+            } else if (close_after_write_) {
+                Close("connection: close");
+            }
+        });
+    }
+
+    size_t ReadFileChunk(AsioHttpServer::StaticFile& file) {
+        file_chunk_.resize(kStaticChunkSize);
+        const size_t want = std::min(file.remaining, file_chunk_.size());
+        ssize_t n;
+        do {
+            n = ::read(file.fd, file_chunk_.data(), want);
+        } while (n < 0 && errno == EINTR);
+        if (n <= 0) {
+            return 0;   // 文件在发送期间被截断：Content-Length 已发出，只能断开
+        }
+        file.remaining -= static_cast<size_t>(n);
+        return static_cast<size_t>(n);
+    }
+
+    /// keep-alive 空闲超时：等待下一个请求（或请求体）期间超时未读完则关闭
+    void ArmIdleTimer(const char* reason = "idle timeout") {
+        timer_.expires_after(std::chrono::seconds(std::max(1, server_->config_.keep_alive_timeout_sec)));
+        auto self = shared_from_this();
+        timer_.async_wait([this, self, reason](const asio::error_code& ec) {
+            if (ec || closed_ || !waiting_request_) {
+                return;
+            }
+            Close(reason);
+        });
+    }
+
+    asio::ip::tcp::socket socket_;
+    AsioHttpServer* server_;
+    asio::streambuf read_buffer_;
+    asio::steady_timer timer_;          ///< keep-alive 空闲 / 请求体读取超时，事件流心跳
+    std::string peer_addr_;
+    int peer_port_ = 0;
+
+    std::deque<AsioHttpServer::Output> write_queue_;     ///< 待写出的数据
+    std::deque<AsioHttpServer::Output> write_pending_;   ///< 正在写出的数据（单个 async_write 在途）
+    std::vector<asio::const_buffer> write_buffers_;      ///< write_pending_ 的缓冲序列
+    size_t queued_bytes_ = 0;           ///< write_queue_ 的字节数（事件流积压上限）
+    std::vector<char> file_chunk_;      ///< 静态文件读出缓冲（首次发送文件时分配）
+    bool writing_ = false;
+    bool closed_ = false;
+    bool close_after_write_ = false;
+    bool waiting_request_ = false;
+    size_t requests_ = 0;
+
+    std::shared_ptr<HttpEventChannel> channel_;   ///< 事件流订阅（非事件流连接为空）
+    uint64_t subscription_ = 0;
+    char discard_[256];
+};
+
+// ============================================================================
+// 服务器
+// ============================================================================
+
+AsioHttpServer::AsioHttpServer(const HttpServerConfig& config)
+    : config_(config), strand_(IoContext::Instance().Strand("http")) {}
+
+AsioHttpServer::~AsioHttpServer() {
+    Stop();
+}
+
+bool AsioHttpServer::Start() {
+    if (running_) {
+        return true;
+    }
+
+    asio::error_code ec;
+    auto address = asio::ip::make_address(config_.host, ec);
+    if (ec) {
+        LOG_ERROR("无效的 HTTP 监听地址: {}", config_.host);
+        return false;
+    }
+
+    asio::ip::tcp::endpoint endpoint(address, static_cast<uint16_t>(config_.port));
+    auto acceptor = std::make_unique<asio::ip::tcp::acceptor>(strand_);
+    acceptor->open(endpoint.protocol(), ec);
+    if (!ec) acceptor->set_option(asio::socket_base::reuse_address(true), ec);
+    if (!ec) acceptor->bind(endpoint, ec);
+    if (!ec) acceptor->listen(asio::socket_base::max_listen_connections, ec);
+    if (ec) {
+        LOG_ERROR("HTTP 服务器监听失败: {}:{} ({})", config_.host, config_.port, ec.message());
+        return false;
+    }
+
+    acceptor_ = std::move(acceptor);
+    workers_ = std::make_unique<asio::thread_pool>(std::max(1, config_.thread_pool_size));
+    if (std::any_of(routes_.begin(), routes_.end(), [](const Route& r) { return r.blocking; })) {
+        blocking_workers_ = std::make_unique<asio::thread_pool>(std::max(1, config_.blocking_pool_size));
+    }
+    running_ = true;
+    Accept();
+
+    LOG_INFO("HTTP 服务器 (asio) 监听 {}:{}，{} 个处理线程 + {} 个阻塞处理线程，keep-alive {}s / {} 请求",
+             config_.host, config_.port, std::max(1, config_.thread_pool_size),
+             blocking_workers_ ? std::max(1, config_.blocking_pool_size) : 0,
+             config_.keep_alive_timeout_sec, config_.keep_alive_max_count);
+    return true;
+}
+
+void AsioHttpServer::Stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+
+    asio::error_code ec;
+    if (acceptor_) {
+        acceptor_->close(ec);
+    }
+
+    std::vector<std::shared_ptr<AsioHttpConnection>> connections;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        connections.swap(connections_);
+    }
+    for (auto& connection : connections) {
+        connection->Close("server shutdown");
+    }
+
+    // 丢弃排队的请求，等待正在执行的处理器返回
+    for (auto* pool : {&workers_, &blocking_workers_}) {
+        if (*pool) {
+            (*pool)->stop();
+            (*pool)->join();
+            pool->reset();
+        }
+    }
+}
+
+void AsioHttpServer::AddRoute(const std::string& method, const std::string& pattern,
+                              HttpHandler handler, bool blocking) {
+    routes_.push_back({method, std::regex(pattern), std::move(handler), blocking});
+}
+
+void AsioHttpServer::AddEventStream(const std::string& path,
+                                    std::shared_ptr<HttpEventChannel> channel) {
+    event_streams_.push_back({path, std::move(channel)});
+}
+
+bool AsioHttpServer::AddMountPoint(const std::string& mount_point, const std::string& dir) {
+    struct stat st;
+    if (stat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+        return false;
+    }
+    std::string mount = mount_point;
+    if (mount.empty() || mount.back() != '/') {
+        mount += '/';
+    }
+    mounts_.push_back({mount, dir});
+    return true;
+}
+
+HttpServerStats AsioHttpServer::GetStats() const {
+    HttpServerStats stats;
+    stats.mode = "asio";
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        stats.connections_active = connections_.size();
+    }
+    stats.connections_total = connections_total_.load(std::memory_order_relaxed);
+    stats.requests_total = requests_total_.load(std::memory_order_relaxed);
+    stats.requests_reused = requests_reused_.load(std::memory_order_relaxed);
+    stats.event_streams = event_streams_active_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void AsioHttpServer::Accept() {
+    acceptor_->async_accept([this](const asio::error_code& ec, asio::ip::tcp::socket socket) {
+        if (ec == asio::error::operation_aborted || !running_) {
+            return;
+        }
+        if (ec) {
+            LOG_WARN("HTTP accept failed: {}", ec.message());
+        } else {
+            std::shared_ptr<AsioHttpConnection> connection;
+            {
+                std::lock_guard<std::mutex> lock(connections_mutex_);
+                if (connections_.size() < static_cast<size_t>(config_.max_connections)) {
+                    connection = std::make_shared<AsioHttpConnection>(std::move(socket), this);
+                    connections_.push_back(connection);
+                }
+            }
+            if (connection) {
+                connections_total_.fetch_add(1, std::memory_order_relaxed);
+                connection->Start();
+            } else {
+                asio::error_code ignored;
+                LOG_WARN_THROTTLED(5000, "HTTP connection limit reached ({}), rejecting {}",
+                                   config_.max_connections,
+                                   socket.remote_endpoint(ignored).address().to_string());
+                socket.close(ignored);
+            }
+        }
+        Accept();
+    });
+}
+
+void AsioHttpServer::RemoveConnection(const AsioHttpConnection* connection) {
+    std::lock_guard<std::mutex> lock(connections_mutex_);
+    auto it = std::find_if(connections_.begin(), connections_.end(),
+                           [connection](const auto& c) { return c.get() == connection; });
+    if (it != connections_.end()) {
+        connections_.erase(it);
+    }
+}
+
+const AsioHttpServer::EventStream* AsioHttpServer::FindEventStream(const std::string& path) const {
+    for (const auto& stream : event_streams_) {
+        if (stream.path == path) {
+            return &stream;
+        }
+    }
+    return nullptr;
+}
+
+const AsioHttpServer::Route* AsioHttpServer::Match(HttpRequest& req) const {
+    const std::string method = req.method == "HEAD" ? "GET" : req.method;
+    for (const auto& route : routes_) {
+        if (route.method == method && std::regex_match(req.path, req.matches, route.pattern)) {
+            return &route;
+        }
+    }
+    return nullptr;
+}
+
+AsioHttpServer::Output AsioHttpServer::Handle(HttpRequest& req, const Route* route,
+                                              bool keep_alive, size_t requests_left) {
+    HttpResponse res;
+    std::shared_ptr<StaticFile> file;
+    const bool head_only = req.method == "HEAD";
+
+    bool routed = false;
+    try {
+        if (route) {
+            route->handler(req, res);
+            routed = true;
+        } else if (head_only || req.method == "GET") {
+            routed = ServeStatic(req, res, &file);
+        }
+    } catch (const std::exception& e) {
+        LOG_ERROR("HTTP 异常: {} {} -> {}", req.method, req.path, e.what());
+        res.headers.clear();
+        res.status = 500;
+        res.set_content("Internal Server Error", "text/plain");
+        routed = true;
+    }
+    if (res.status == -1) {
+        res.status = routed ? 200 : 404;
+    }
+
+    // 响应体：res.body 与 content provider 一起保存在 body 中，随写出完成释放
+    struct Body {
+        std::string text;
+        httplib::ContentProvider provider;
+    };
+    auto body = std::make_shared<Body>();
+    std::vector<asio::const_buffer> buffers;
+    size_t content_length = 0;
+
+    // 定长 content provider（如 LL-HLS 的共享 part 缓冲）：在工作线程上读完，
+    // 只记录写入的数据块，由 provider 捕获的对象持有，写出时不拷贝
+    if (res.content_provider_) {
+        bool success = true;
+        bool done = false;
+        httplib::DataSink sink;
+        if (res.is_chunked_content_provider_) {
+            sink.write = [&res](const char* data, size_t length) {
+                res.body.append(data, length);
+                return true;
+            };
+        } else {
+            sink.write = [&buffers, &content_length](const char* data, size_t length) {
+                buffers.push_back(asio::buffer(data, length));
+                content_length += length;
+                return true;
+            };
+        }
+        sink.is_writable = []() { return true; };
+        sink.done = [&done]() { done = true; };
+        if (res.is_chunked_content_provider_) {
+            while (!done && success) {
+                success = res.content_provider_(res.body.size(), 0, sink);
+            }
+        } else {
+            while (success && content_length < res.content_length_) {
+                const size_t before = content_length;
+                success = res.content_provider_(before, res.content_length_ - before, sink) &&
+                          content_length > before;
+            }
+        }
+        if (res.content_provider_resource_releaser_) {
+            res.content_provider_resource_releaser_(success);
+        }
+        body->provider = std::move(res.content_provider_);
+        if (!success) {
+            res.headers.clear();
+            res.body.clear();
+            res.status = 500;
+            buffers.clear();
+            content_length = 0;
+        }
+    }
+
+    if (res.status >= 400 && res.body.empty() && content_length == 0) {
+        LOG_WARN("HTTP 错误: {} {} -> {}", req.method, req.path, res.status);
+        res.set_content("Error: " + std::to_string(res.status), "text/plain");
+    }
+
+    if (post_routing_) {
+        post_routing_(req, res);
+    }
+
+    if (!res.body.empty()) {
+        body->text = std::move(res.body);
+        buffers.insert(buffers.begin(), asio::buffer(body->text));
+        content_length += body->text.size();
+    }
+    if (file) {
+        content_length += file->remaining;
+    }
+
+    Output out;
+    std::string& head = out.head;
+    head.reserve(256);
+    head += "HTTP/1.1 " + std::to_string(res.status) + " " + StatusReason(res.status) + "\r\n";
+    for (const auto& [name, value] : res.headers) {
+        if (EqualsIgnoreCase(name, "Content-Length") || EqualsIgnoreCase(name, "Connection")) {
+            continue;
+        }
+        head += name;
+        head += ": ";
+        head += value;
+        head += "\r\n";
+    }
+    head += "Content-Length: " + std::to_string(content_length) + "\r\n";
+    if (keep_alive) {
+        head += "Connection: keep-alive\r\nKeep-Alive: timeout=" +
+                std::to_string(config_.keep_alive_timeout_sec) +
+                ", max=" + std::to_string(requests_left) + "\r\n";
+    } else {
+        head += "Connection: close\r\n";
+    }
+    head += "\r\n";
+    if (!head_only) {
+        out.body = std::move(buffers);
+        out.holder = std::move(body);
+        if (file && file->remaining > 0) {
+            out.file = std::move(file);
+        }
+    }
+
+    LOG_DEBUG("HTTP: {} {} -> {} ({})", req.method, req.path, res.status, content_length);
+    return out;
+}
+
+bool AsioHttpServer::ServeStatic(const HttpRequest& req, HttpResponse& res,
+                                 std::shared_ptr<StaticFile>* file) const {
+    for (const auto& mount : mounts_) {
+        std::string path = req.path;
+        if (path.size() + 1 == mount.mount_point.size()) {
+            path += '/';
+        }
+        if (path.compare(0, mount.mount_point.size(), mount.mount_point) != 0) {
+            continue;
+        }
+        std::string sub = path.substr(mount.mount_point.size());
+        if (sub.find("..") != std::string::npos) {
+            return false;
+        }
+        if (sub.empty() || sub.back() == '/') {
+            sub += "index.html";
+        }
+
+        std::string name = mount.dir + "/" + sub;
+        auto opened = std::make_shared<StaticFile>();
+        opened->fd = ::open(name.c_str(), O_RDONLY | O_CLOEXEC);
+        if (opened->fd < 0) {
+            continue;
+        }
+        struct stat st;
+        if (fstat(opened->fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+        opened->remaining = static_cast<size_t>(st.st_size);
+        res.set_header("Content-Type", MimeType(name));
+        *file = std::move(opened);
+        return true;
+    }
+    return false;
+}
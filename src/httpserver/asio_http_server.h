@@ -0,0 +1,142 @@
+/**
+ * @file asio_http_server.h
+ * @brief 事件驱动 HTTP/1.1 服务器 - 运行在全局 IoContext 上
+ *
+ * HttpServer 的 asio 模式后端（HttpServerMode::kAsio），与 RTSP / WebSocket 共用 IO 线程：
+ * - 连接：accept / 读请求 / 写响应全部异步，在 "http" strand 上串行；
+ *   空闲的 keep-alive 连接和事件流连接只占一个 socket，不占线程
+ * - 处理器：在 thread_pool_size 个工作线程上执行（模式切换等可能阻塞的处理器不会卡住
+ *   IO 线程），响应序列化后投递回 strand 发送；标记为 blocking 的路由（LL-HLS 阻塞式刷新 /
+ *   预告 part，等待发布最长数秒）在 blocking_pool_size 个独立线程上执行，
+ *   观看者再多也不会占满 API 的工作线程
+ * - 写出：只有状态行与头部序列化为字符串，响应体按引用与头部一起 scatter/gather 写出，
+ *   排队的多个响应 / 事件帧合并为一次 async_write；静态文件按固定大小分块读出、逐块写出
+ * - keep-alive：HTTP/1.1 默认保持连接，单连接最多 keep_alive_max_count 个请求，
+ *   空闲 keep_alive_timeout_sec 秒后关闭
+ * - 事件流（SSE）：订阅 HttpEventChannel，发布时投递到连接上直接写出
+ *
+ * 请求 / 响应沿用 httplib::Request / httplib::Response，路由处理器在两种模式下通用。
+ * 定长 content provider 在工作线程上读完，写入的数据块按引用发送、不拷贝（LL-HLS part /
+ * 分段直接从打包器的共享缓冲写出）：写入的数据须由 provider 捕获的对象持有，
+ * provider 在写完前保持存活。分块 content provider 的数据拷贝后整体发送
+ * （不支持分块流式响应，流式推送用事件流）。
+ *
+ * @note 路由、静态目录、事件流在 Start() 之前注册，之后只读
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-15
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "common/asio_context.h"
+#include "http_event_channel.h"
+#include "http_server.h"
+
+class AsioHttpConnection;
+
+class AsioHttpServer {
+public:
+    explicit AsioHttpServer(const HttpServerConfig& config);
+    ~AsioHttpServer();
+
+    AsioHttpServer(const AsioHttpServer&) = delete;
+    AsioHttpServer& operator=(const AsioHttpServer&) = delete;
+
+    /**
+     * @brief 绑定端口、启动工作线程并开始 accept
+     */
+    bool Start();
+
+    /**
+     * @brief 关闭监听与所有连接，等待工作线程上的处理器返回
+     */
+    void Stop();
+
+    bool IsRunning() const { return running_; }
+
+    /// blocking：处理器可能长时间阻塞，在独立线程池上执行
+    void AddRoute(const std::string& method, const std::string& pattern, HttpHandler handler,
+                  bool blocking = false);
+    void AddEventStream(const std::string& path, std::shared_ptr<HttpEventChannel> channel);
+    bool AddMountPoint(const std::string& mount_point, const std::string& dir);
+    void SetPostRoutingHandler(HttpHandler handler) { post_routing_ = std::move(handler); }
+
+    HttpServerStats GetStats() const;
+
+private:
+    friend class AsioHttpConnection;
+
+    struct Route {
+        std::string method;
+        std::regex pattern;
+        HttpHandler handler;
+        bool blocking = false;
+    };
+
+    struct Mount {
+        std::string mount_point;
+        std::string dir;
+    };
+
+    struct EventStream {
+        std::string path;
+        std::shared_ptr<HttpEventChannel> channel;
+    };
+
+    /// 静态文件：写出时在连接 strand 上每次读出固定大小的一块
+    struct StaticFile;
+
+    /// 待写出的数据：头部 / 事件帧 + 按引用写出的响应体
+    struct Output {
+        std::string head;                       ///< 状态行 + 头部（或完整的小块数据）
+        std::vector<asio::const_buffer> body;   ///< 响应体分块，数据由 holder 持有
+        std::shared_ptr<const void> holder;     ///< 写完前保持 body 引用的数据存活
+        std::shared_ptr<StaticFile> file;       ///< 在 head / body 之后分块写出的文件内容
+
+        size_t size() const { return head.size() + asio::buffer_size(body); }
+    };
+
+    void Accept();
+
+    /// 匹配路由（填写 req.matches），未匹配返回 nullptr（静态文件 / 404）
+    const Route* Match(HttpRequest& req) const;
+
+    /// 在工作线程上执行路由，返回序列化后的头部与按引用的响应体
+    Output Handle(HttpRequest& req, const Route* route, bool keep_alive, size_t requests_left);
+
+    /// 匹配静态目录：设置 Content-Type 并打开文件，内容由连接分块写出
+    bool ServeStatic(const HttpRequest& req, HttpResponse& res,
+                     std::shared_ptr<StaticFile>* file) const;
+    const EventStream* FindEventStream(const std::string& path) const;
+    void RemoveConnection(const AsioHttpConnection* connection);
+
+    HttpServerConfig config_;
+    IoStrand& strand_;
+    std::unique_ptr<asio::ip::tcp::acceptor> acceptor_;
+    std::unique_ptr<asio::thread_pool> workers_;
+    std::unique_ptr<asio::thread_pool> blocking_workers_;   ///< blocking 路由专用
+    std::atomic<bool> running_{false};
+
+    std::vector<Route> routes_;
+    std::vector<Mount> mounts_;
+    std::vector<EventStream> event_streams_;
+    HttpHandler post_routing_;
+
+    // 连接列表：strand 上增删，Stop() 时关闭
+    mutable std::mutex connections_mutex_;
+    std::vector<std::shared_ptr<AsioHttpConnection>> connections_;
+
+    std::atomic<uint64_t> connections_total_{0};
+    std::atomic<uint64_t> requests_total_{0};
+    std::atomic<uint64_t> requests_reused_{0};
+    std::atomic<uint64_t> event_streams_active_{0};
+};
@@ -0,0 +1,214 @@
+/**
+ * @file http_event_channel.h
+ * @brief Server-Sent Events 推送通道
+ *
+ * 发布方按事件名发布最新状态（通常是 JSON 文本），通道为每个事件名保留最后一条：
+ * 新订阅者连接后立即收到当前状态，之后只在内容变化时收到推送，替代客户端定时轮询。
+ * 同一事件连续发布相同内容时不推送。
+ *
+ * 两种订阅方式，对应 HttpServer 的两种模式：
+ * - 回调订阅（asio 模式）：Publish 所在线程调用回调，回调只负责投递到连接的 strand，
+ *   空闲的事件流连接不占用线程
+ * - 游标等待（线程池模式）：工作线程在 WaitNext 上等待新消息，超时发送心跳
+ *
+ * @note header-only，线程安全
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-15
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+class HttpEventChannel : public std::enable_shared_from_this<HttpEventChannel> {
+public:
+    using Message = std::shared_ptr<const std::string>;   ///< 编码好的 SSE 帧（含结尾空行）
+    using Subscriber = std::function<void(const Message&)>;
+
+    /// 无消息时发送心跳的间隔（防止代理 / 浏览器判定连接空闲）
+    static constexpr std::chrono::seconds kHeartbeatInterval{15};
+
+    /**
+     * @brief 线程池模式的读取位置（持有期间计入订阅者数）
+     */
+    class Cursor {
+    public:
+        explicit Cursor(std::shared_ptr<HttpEventChannel> channel)
+            : channel_(std::move(channel)) {}
+        ~Cursor() { channel_->CloseCursor(); }
+
+        Cursor(const Cursor&) = delete;
+        Cursor& operator=(const Cursor&) = delete;
+
+    private:
+        friend class HttpEventChannel;
+        std::shared_ptr<HttpEventChannel> channel_;
+        uint64_t seq_ = 0;          ///< 已读到的发布序号（0 = 尚未收到当前状态）
+    };
+
+    enum class WaitResult { kMessages, kTimeout, kClosed };
+
+    /**
+     * @brief 发布事件（内容与该事件上一条相同时忽略）
+     *
+     * @param event 事件名（SSE 的 event 字段）
+     * @param data  事件内容，多行文本按 SSE 格式逐行加 data: 前缀
+     */
+    void Publish(const std::string& event, const std::string& data) {
+        std::vector<std::shared_ptr<Subscriber>> subscribers;
+        Message message;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (closed_) {
+                return;
+            }
+            auto& latest = latest_[event];
+            if (latest.message && latest.data == data) {
+                return;
+            }
+            latest.seq = ++seq_;
+            latest.data = data;
+            latest.message = message = Encode(event, data, latest.seq);
+            subscribers.reserve(subscribers_.size());
+            for (const auto& [id, subscriber] : subscribers_) {
+                subscribers.push_back(subscriber);
+            }
+        }
+        cond_.notify_all();
+        for (const auto& subscriber : subscribers) {
+            (*subscriber)(message);
+        }
+    }
+
+    /**
+     * @brief 回调订阅
+     *
+     * @param subscriber 新消息回调（在 Publish 线程调用，不得阻塞）
+     * @param initial    输出各事件的当前状态，订阅者应先发送它们
+     * @return 订阅 ID（用于 Unsubscribe），通道已关闭时返回 0
+     */
+    uint64_t Subscribe(Subscriber subscriber, std::vector<Message>* initial) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_) {
+            return 0;
+        }
+        for (const auto& [event, latest] : latest_) {
+            initial->push_back(latest.message);
+        }
+        const uint64_t id = ++next_subscriber_id_;
+        subscribers_.emplace(id, std::make_shared<Subscriber>(std::move(subscriber)));
+        return id;
+    }
+
+    void Unsubscribe(uint64_t id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        subscribers_.erase(id);
+    }
+
+    /**
+     * @brief 打开游标（线程池模式），首次 WaitNext 立即返回各事件的当前状态
+     *
+     * 游标持有通道的引用，通道须由 std::make_shared 创建
+     */
+    std::unique_ptr<Cursor> OpenCursor() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++cursors_;
+        return std::make_unique<Cursor>(shared_from_this());
+    }
+
+    /**
+     * @brief 等待游标之后的新消息（同一事件只返回最新一条）
+     */
+    WaitResult WaitNext(Cursor& cursor, std::vector<Message>* out,
+                        std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait_for(lock, timeout, [&] { return closed_ || seq_ > cursor.seq_; });
+        if (closed_) {
+            return WaitResult::kClosed;
+        }
+        if (seq_ <= cursor.seq_) {
+            return WaitResult::kTimeout;
+        }
+        for (const auto& [event, latest] : latest_) {
+            if (latest.seq > cursor.seq_) {
+                out->push_back(latest.message);
+            }
+        }
+        cursor.seq_ = seq_;
+        return WaitResult::kMessages;
+    }
+
+    /**
+     * @brief 当前订阅者数（回调订阅 + 打开的游标）；发布方可据此在无人订阅时跳过刷新
+     */
+    size_t SubscriberCount() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return subscribers_.size() + cursors_;
+    }
+
+    /**
+     * @brief 关闭通道：唤醒所有等待者，之后不再接受订阅和发布（服务器停止时调用）
+     */
+    void Close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+            subscribers_.clear();
+        }
+        cond_.notify_all();
+    }
+
+    /// 心跳帧（SSE 注释行，浏览器忽略）
+    static const Message& Heartbeat() {
+        static const Message heartbeat = std::make_shared<const std::string>(": keepalive\n\n");
+        return heartbeat;
+    }
+
+private:
+    struct Latest {
+        uint64_t seq = 0;
+        std::string data;
+        Message message;
+    };
+
+    static Message Encode(const std::string& event, const std::string& data, uint64_t seq) {
+        std::string frame;
+        frame.reserve(event.size() + data.size() + 48);
+        frame += "event: " + event + "\nid: " + std::to_string(seq) + "\n";
+        size_t pos = 0;
+        while (true) {
+            size_t end = data.find('\n', pos);
+            frame += "data: ";
+            frame.append(data, pos, end == std::string::npos ? std::string::npos : end - pos);
+            frame += '\n';
+            if (end == std::string::npos) break;
+            pos = end + 1;
+        }
+        frame += '\n';
+        return std::make_shared<const std::string>(std::move(frame));
+    }
+
+    void CloseCursor() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --cursors_;
+    }
+
+    mutable std::mutex mutex_;
+    std::condition_variable cond_;
+    bool closed_ = false;
+    uint64_t seq_ = 0;
+    std::map<std::string, Latest> latest_;
+    uint64_t next_subscriber_id_ = 0;
+    std::map<uint64_t, std::shared_ptr<Subscriber>> subscribers_;
+    size_t cursors_ = 0;
+};
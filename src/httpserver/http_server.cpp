@@ -4,6 +4,7 @@
  */
 
 #include "http_server.h"
+#include "asio_http_server.h"
 #include "common/logger.h"
 
 // cpp-httplib (header-only)
@@ -24,6 +25,17 @@ bool HttpServer::Init(const HttpServerConfig& config) {
 
     config_ = config;
 
+    if (config_.mode == HttpServerMode::kAsio) {
+        asio_ = std::make_unique<AsioHttpServer>(config_);
+        if (!config_.static_dir.empty()) {
+            if (!SetStaticFileDir(config_.static_mount, config_.static_dir)) {
+                LOG_WARN("设置静态文件目录失败: {}", config_.static_dir);
+            }
+        }
+        LOG_INFO("HTTP 服务器初始化完成 (asio 模式)");
+        return true;
+    }
+
     // 创建 httplib 服务器实例
     server_ = std::make_unique<httplib::Server>();
 
@@ -37,6 +49,10 @@ bool HttpServer::Init(const HttpServerConfig& config) {
         return new httplib::ThreadPool(config_.thread_pool_size);
     };
 
+    // keep-alive：看板多客户端高频轮询时复用连接（每个空闲连接仍占用一个线程）
+    server_->set_keep_alive_max_count(static_cast<size_t>(config_.keep_alive_max_count));
+    server_->set_keep_alive_timeout(config_.keep_alive_timeout_sec);
+
     // 设置错误处理
     server_->set_error_handler([](const HttpRequest& req, HttpResponse& res) {
         LOG_WARN("HTTP 错误: {} {} -> {}", req.method, req.path, res.status);
@@ -58,7 +74,8 @@ bool HttpServer::Init(const HttpServerConfig& config) {
     });
 
     // 设置日志
-    server_->set_logger([](const HttpRequest& req, const HttpResponse& res) {
+    server_->set_logger([this](const HttpRequest& req, const HttpResponse& res) {
+        requests_total_.fetch_add(1, std::memory_order_relaxed);
         LOG_DEBUG("HTTP: {} {} -> {} ({})", req.method, req.path, res.status,
                   res.get_header_value("Content-Length"));
     });
@@ -80,6 +97,15 @@ bool HttpServer::Start() {
         return true;
     }
 
+    if (asio_) {
+        if (!asio_->Start()) {
+            return false;
+        }
+        running_ = true;
+        LOG_INFO("HTTP 服务器启动: {}:{}", config_.host, config_.port);
+        return true;
+    }
+
     if (!server_) {
         LOG_ERROR("HTTP 服务器未初始化");
         return false;
@@ -103,6 +129,15 @@ void HttpServer::Stop() {
 
     running_ = false;
 
+    // 唤醒等待事件的工作线程，关闭事件流
+    for (auto& channel : event_channels_) {
+        channel->Close();
+    }
+
+    if (asio_) {
+        asio_->Stop();
+    }
+
     // 停止 httplib 服务器
     if (server_) {
         server_->stop();
@@ -117,10 +152,18 @@ void HttpServer::Stop() {
 }
 
 bool HttpServer::IsRunning() const {
+    if (asio_) {
+        return running_ && asio_->IsRunning();
+    }
     return running_ && server_ && server_->is_running();
 }
 
 void HttpServer::Get(const std::string& pattern, HttpHandler handler) {
+    if (asio_) {
+        asio_->AddRoute("GET", pattern, std::move(handler));
+        LOG_DEBUG("注册 GET 路由: {}", pattern);
+        return;
+    }
     if (!server_) {
         LOG_ERROR("HTTP 服务器未初始化，无法注册 GET 路由: {}", pattern);
         return;
@@ -129,7 +172,21 @@ void HttpServer::Get(const std::string& pattern, HttpHandler handler) {
     LOG_DEBUG("注册 GET 路由: {}", pattern);
 }
 
+void HttpServer::GetBlocking(const std::string& pattern, HttpHandler handler) {
+    if (asio_) {
+        asio_->AddRoute("GET", pattern, std::move(handler), true);
+        LOG_DEBUG("注册 GET 路由（阻塞）: {}", pattern);
+        return;
+    }
+    Get(pattern, std::move(handler));
+}
+
 void HttpServer::Post(const std::string& pattern, HttpHandler handler) {
+    if (asio_) {
+        asio_->AddRoute("POST", pattern, std::move(handler));
+        LOG_DEBUG("注册 POST 路由: {}", pattern);
+        return;
+    }
     if (!server_) {
         LOG_ERROR("HTTP 服务器未初始化，无法注册 POST 路由: {}", pattern);
         return;
@@ -139,6 +196,11 @@ void HttpServer::Post(const std::string& pattern, HttpHandler handler) {
 }
 
 void HttpServer::Put(const std::string& pattern, HttpHandler handler) {
+    if (asio_) {
+        asio_->AddRoute("PUT", pattern, std::move(handler));
+        LOG_DEBUG("注册 PUT 路由: {}", pattern);
+        return;
+    }
     if (!server_) {
         LOG_ERROR("HTTP 服务器未初始化，无法注册 PUT 路由: {}", pattern);
         return;
@@ -148,6 +210,11 @@ void HttpServer::Put(const std::string& pattern, HttpHandler handler) {
 }
 
 void HttpServer::Delete(const std::string& pattern, HttpHandler handler) {
+    if (asio_) {
+        asio_->AddRoute("DELETE", pattern, std::move(handler));
+        LOG_DEBUG("注册 DELETE 路由: {}", pattern);
+        return;
+    }
     if (!server_) {
         LOG_ERROR("HTTP 服务器未初始化，无法注册 DELETE 路由: {}", pattern);
         return;
@@ -156,8 +223,68 @@ void HttpServer::Delete(const std::string& pattern, HttpHandler handler) {
     LOG_DEBUG("注册 DELETE 路由: {}", pattern);
 }
 
+void HttpServer::SetPostRoutingHandler(HttpHandler handler) {
+    if (asio_) {
+        asio_->SetPostRoutingHandler(std::move(handler));
+    } else if (server_) {
+        server_->set_post_routing_handler(std::move(handler));
+    }
+}
+
+std::shared_ptr<HttpEventChannel> HttpServer::EventStream(const std::string& path) {
+    auto channel = std::make_shared<HttpEventChannel>();
+    event_channels_.push_back(channel);
+
+    if (asio_) {
+        asio_->AddEventStream(path, channel);
+    } else if (server_) {
+        // 每个订阅者占用一个工作线程，在通道上等待新消息，超时发送心跳
+        server_->Get(path, [channel](const HttpRequest& /*req*/, HttpResponse& res) {
+            res.set_header("Cache-Control", "no-cache");
+            res.set_header("X-Accel-Buffering", "no");
+            std::shared_ptr<HttpEventChannel::Cursor> cursor = channel->OpenCursor();
+            res.set_chunked_content_provider(
+                "text/event-stream",
+                [channel, cursor](size_t /*offset*/, httplib::DataSink& sink) {
+                    std::vector<HttpEventChannel::Message> messages;
+                    switch (channel->WaitNext(*cursor, &messages,
+                                              HttpEventChannel::kHeartbeatInterval)) {
+                        case HttpEventChannel::WaitResult::kClosed:
+                            sink.done();
+                            return true;
+                        case HttpEventChannel::WaitResult::kTimeout:
+                            messages.push_back(HttpEventChannel::Heartbeat());
+                            break;
+                        case HttpEventChannel::WaitResult::kMessages:
+                            break;
+                    }
+                    for (const auto& message : messages) {
+                        if (!sink.write(message->data(), message->size())) {
+                            return false;
+                        }
+                    }
+                    return true;
+                });
+        });
+    } else {
+        LOG_ERROR("HTTP 服务器未初始化，无法注册事件流: {}", path);
+        return channel;
+    }
+
+    LOG_DEBUG("注册事件流: {}", path);
+    return channel;
+}
+
 bool HttpServer::SetStaticFileDir(const std::string& mount_point,
                                    const std::string& dir) {
+    if (asio_) {
+        if (!asio_->AddMountPoint(mount_point, dir)) {
+            LOG_ERROR("设置静态文件目录失败: {} -> {}", mount_point, dir);
+            return false;
+        }
+        LOG_INFO("设置静态文件目录: {} -> {}", mount_point, dir);
+        return true;
+    }
     if (!server_) {
         LOG_ERROR("HTTP 服务器未初始化");
         return false;
@@ -178,6 +305,15 @@ std::string HttpServer::GetListenAddress() const {
     return config_.host + ":" + std::to_string(config_.port);
 }
 
+HttpServerStats HttpServer::GetStats() const {
+    if (asio_) {
+        return asio_->GetStats();
+    }
+    HttpServerStats stats;
+    stats.requests_total = requests_total_.load(std::memory_order_relaxed);
+    return stats;
+}
+
 void HttpServer::ServerThread() {
     LOG_INFO("HTTP 服务器线程启动");
 
@@ -2,7 +2,14 @@
  * @file http_server.h
  * @brief HTTP 服务器封装 - 基于 cpp-httplib
  *
- * 提供 HTTP 服务器功能，支持静态文件服务和 API 接口
+ * 提供 HTTP 服务器功能，支持静态文件服务、API 接口和 Server-Sent Events 事件流
+ *
+ * 两种运行模式（路由处理器通用）：
+ * - kThreaded：cpp-httplib 在独立线程上 listen，每个连接占用一个线程池线程
+ *   （keep-alive 空闲期间也占用）
+ * - kAsio：连接 I/O 运行在全局 IoContext 上（见 asio_http_server.h），
+ *   空闲连接和事件流不占线程，处理器在 thread_pool_size 个工作线程上执行；
+ *   GetBlocking() 注册的长时间阻塞处理器在 blocking_pool_size 个独立线程上执行
  *
  * @author 好软，好温暖
  * @date 2026-01-31
@@ -16,6 +23,9 @@
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <vector>
+
+#include "http_event_channel.h"
 
 // 前向声明 httplib 类型
 namespace httplib {
@@ -24,16 +34,40 @@ class Request;
 class Response;
 }  // namespace httplib
 
+class AsioHttpServer;
+
 // ============================================================================
 // HTTP 服务器配置
 // ============================================================================
 
+enum class HttpServerMode {
+    kThreaded,      ///< cpp-httplib 独立线程 + 线程池
+    kAsio,          ///< 共用全局 IoContext 的事件驱动模式
+};
+
 struct HttpServerConfig {
     std::string host = "0.0.0.0";     ///< 监听地址
     int port = 8080;                   ///< 监听端口
     std::string static_dir = "";       ///< 静态文件目录（空则不提供静态文件服务）
     std::string static_mount = "/";    ///< 静态文件挂载路径
-    int thread_pool_size = 1;          ///< 线程池大小
+    int thread_pool_size = 1;          ///< 线程池大小（asio 模式下为处理器工作线程数）
+    HttpServerMode mode = HttpServerMode::kThreaded;  ///< 运行模式
+    int keep_alive_max_count = 100;    ///< 单个连接最多处理的请求数
+    int keep_alive_timeout_sec = 10;   ///< keep-alive 连接空闲超时
+    int max_connections = 32;          ///< 最大并发连接数（仅 asio 模式）
+    int blocking_pool_size = 4;        ///< 阻塞处理器（GetBlocking）的独立线程数（仅 asio 模式）
+};
+
+/**
+ * @brief 连接统计（threaded 模式只统计请求数）
+ */
+struct HttpServerStats {
+    const char* mode = "threaded";
+    uint64_t connections_active = 0;   ///< 当前连接数（含事件流）
+    uint64_t connections_total = 0;    ///< 累计接受的连接数
+    uint64_t requests_total = 0;       ///< 累计请求数
+    uint64_t requests_reused = 0;      ///< 复用已有 keep-alive 连接的请求数
+    uint64_t event_streams = 0;        ///< 当前事件流订阅连接数
 };
 
 // ============================================================================
@@ -107,6 +141,17 @@ public:
      */
     void Get(const std::string& pattern, HttpHandler handler);
 
+    /**
+     * @brief 注册可能长时间阻塞的 GET 请求处理器（如 LL-HLS 阻塞式刷新）
+     *
+     * asio 模式下在独立的 blocking_pool_size 个线程上执行，排满时只排队阻塞请求，
+     * 不占用 API 处理器的工作线程；threaded 模式等同 Get()
+     *
+     * @param pattern URL 模式（支持正则）
+     * @param handler 处理函数
+     */
+    void GetBlocking(const std::string& pattern, HttpHandler handler);
+
     /**
      * @brief 注册 POST 请求处理器
      *
@@ -131,6 +176,27 @@ public:
      */
     void Delete(const std::string& pattern, HttpHandler handler);
 
+    /**
+     * @brief 设置路由后处理器（每个请求的处理器返回后、响应发送前调用）
+     *
+     * @param handler 处理函数（可读取请求、修改响应）
+     */
+    void SetPostRoutingHandler(HttpHandler handler);
+
+    // ========================================
+    // 事件流（Server-Sent Events）
+    // ========================================
+
+    /**
+     * @brief 注册事件流端点（GET，text/event-stream）
+     *
+     * 返回的通道上发布的事件推送给该端点的所有订阅者；Stop() 时关闭通道
+     *
+     * @param path URL 路径（精确匹配）
+     * @return 事件通道
+     */
+    std::shared_ptr<HttpEventChannel> EventStream(const std::string& path);
+
     // ========================================
     // 静态文件服务
     // ========================================
@@ -155,14 +221,22 @@ public:
      */
     std::string GetListenAddress() const;
 
+    /**
+     * @brief 获取连接与请求统计
+     */
+    HttpServerStats GetStats() const;
+
 private:
     /**
      * @brief 服务器线程入口
      */
     void ServerThread();
 
-    std::unique_ptr<httplib::Server> server_;  ///< httplib 服务器实例
+    std::unique_ptr<httplib::Server> server_;  ///< httplib 服务器实例（threaded 模式）
+    std::unique_ptr<AsioHttpServer> asio_;      ///< 事件驱动服务器实例（asio 模式）
     std::thread server_thread_;                 ///< 服务器线程
     std::atomic<bool> running_{false};          ///< 运行状态标志
     HttpServerConfig config_;                   ///< 服务器配置
+    std::vector<std::shared_ptr<HttpEventChannel>> event_channels_;  ///< Stop() 时关闭
+    std::atomic<uint64_t> requests_total_{0};   ///< threaded 模式请求计数
 };
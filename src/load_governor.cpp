@@ -0,0 +1,321 @@
+/**
+ * @file load_governor.cpp
+ * @brief 负载调度器实现
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-18
+ */
+
+#define LOG_TAG "governor"
+
+#include "load_governor.h"
+#include "common/latency_trace.h"
+#include "common/logger.h"
+#include "media_producer/media_manager.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+/// 最多探测的 thermal zone 数
+constexpr int kMaxThermalZones = 8;
+
+}  // namespace
+
+LoadGovernor& LoadGovernor::Instance() {
+    static LoadGovernor instance;
+    return instance;
+}
+
+// ============================================================================
+// 配置
+// ============================================================================
+
+void LoadGovernor::Configure(const LoadGovernorConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+    config_.interval_ms = std::max(config_.interval_ms, 100);
+    config_.inference_divisor = std::max(config_.inference_divisor, 1);
+    config_.reduced_fps = std::clamp(config_.reduced_fps, 1, 30);
+}
+
+void LoadGovernor::AddRung(const std::string& name, EngageAction engage, ReleaseAction release) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    registered_.push_back(Rung{name, std::move(engage), std::move(release)});
+}
+
+// ============================================================================
+// 生命周期
+// ============================================================================
+
+bool LoadGovernor::Start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_ || !config_.enabled) {
+        return false;
+    }
+
+    // 按 ladder 顺序挑出已注册的级别
+    rungs_.clear();
+    engaged_.clear();
+    std::string ladder;
+    for (const auto& name : config_.ladder) {
+        auto it = std::find_if(registered_.begin(), registered_.end(),
+                               [&name](const Rung& r) { return r.name == name; });
+        if (it == registered_.end()) {
+            LOG_INFO("Governor rung '{}' not available, skipped", name);
+            continue;
+        }
+        rungs_.push_back(*it);
+        ladder += (ladder.empty() ? "" : " -> ") + name;
+    }
+    if (rungs_.empty()) {
+        LOG_WARN("Governor has no usable rungs, not started");
+        return false;
+    }
+
+    last_ = ReadCounters();
+    overload_since_ = Clock::time_point();
+    headroom_since_ = Clock::time_point();
+    running_ = true;
+    thread_ = std::thread(&LoadGovernor::Loop, this);
+
+    LOG_INFO("Load governor started: cpu {:.0f}/{:.0f}%, temp {:.0f}/{:.0f}C, "
+             "latency {:.0f}/{:.0f}ms, drops {:.0f}/{:.0f}%, ladder: {}",
+             config_.cpu_high, config_.cpu_low, config_.temp_high, config_.temp_low,
+             config_.latency_high_ms, config_.latency_low_ms, config_.drop_high * 100,
+             config_.drop_low * 100, ladder);
+    return true;
+}
+
+void LoadGovernor::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    // 退出前撤销全部降级，避免残留的降帧率 / 降速被下次启动继承
+    while (!engaged_.empty()) {
+        const Rung& rung = rungs_[engaged_.back()];
+        if (rung.release && !rung.release()) {
+            LOG_WARN("Governor rung '{}' failed to restore on stop", rung.name);
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        engaged_.pop_back();
+    }
+    LOG_INFO("Load governor stopped");
+}
+
+LoadGovernorStatus LoadGovernor::GetStatus() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    LoadGovernorStatus status;
+    status.enabled = config_.enabled;
+    status.running = running_;
+    for (const auto& rung : rungs_) {
+        status.ladder.push_back(rung.name);
+    }
+    for (size_t index : engaged_) {
+        status.engaged.push_back(rungs_[index].name);
+    }
+    status.sample = sample_;
+    status.pressure = pressure_;
+    status.degrades = degrades_;
+    status.restores = restores_;
+    return status;
+}
+
+// ============================================================================
+// 采样
+// ============================================================================
+
+LoadGovernor::Counters LoadGovernor::ReadCounters() const {
+    Counters c;
+
+    // /proc/stat 首行：cpu user nice system idle iowait irq softirq steal
+    if (FILE* f = fopen("/proc/stat", "r")) {
+        unsigned long long v[8] = {};
+        if (fscanf(f, "cpu %llu %llu %llu %llu %llu %llu %llu %llu", &v[0], &v[1], &v[2],
+                   &v[3], &v[4], &v[5], &v[6], &v[7]) >= 4) {
+            for (auto x : v) {
+                c.cpu_total += x;
+            }
+            c.cpu_idle = v[3] + v[4];
+        }
+        fclose(f);
+    }
+
+    auto hist = media::LatencyTracer::Instance()
+                    .CaptureHistogram(media::LatencyTracer::Stage::kInference)
+                    .Read();
+    c.inference_count = hist.count;
+    c.inference_sum_us = hist.sum_us;
+
+    for (const auto& stats : media::MediaManager::Instance().GetStreamConsumerStats()) {
+        c.delivered += stats.delivered;
+        c.dropped += stats.dropped;
+    }
+    return c;
+}
+
+double LoadGovernor::ReadMaxTemperature() {
+    double max_c = 0.0;
+    char path[64];
+    for (int i = 0; i < kMaxThermalZones; ++i) {
+        snprintf(path, sizeof(path), "/sys/class/thermal/thermal_zone%d/temp", i);
+        FILE* f = fopen(path, "r");
+        if (!f) {
+            break;
+        }
+        long milli = 0;
+        if (fscanf(f, "%ld", &milli) == 1) {
+            max_c = std::max(max_c, milli / 1000.0);
+        }
+        fclose(f);
+    }
+    return max_c;
+}
+
+LoadSample LoadGovernor::Measure(const Counters& now) const {
+    LoadSample s;
+
+    const uint64_t total = now.cpu_total - std::min(now.cpu_total, last_.cpu_total);
+    const uint64_t idle = now.cpu_idle - std::min(now.cpu_idle, last_.cpu_idle);
+    if (total > 0) {
+        s.cpu_percent = 100.0 * static_cast<double>(total - std::min(total, idle)) / total;
+    }
+
+    s.temp_c = ReadMaxTemperature();
+
+    if (now.inference_count > last_.inference_count) {
+        s.inference_latency_ms = (now.inference_sum_us - last_.inference_sum_us) / 1000.0 /
+                                 static_cast<double>(now.inference_count - last_.inference_count);
+    }
+
+    // 消费者重新注册（模式切换、改订阅码流）后计数归零，本窗口不计丢帧率
+    if (now.delivered >= last_.delivered && now.dropped >= last_.dropped) {
+        const uint64_t delivered = now.delivered - last_.delivered;
+        const uint64_t dropped = now.dropped - last_.dropped;
+        if (delivered + dropped > 0) {
+            s.drop_ratio = static_cast<double>(dropped) / static_cast<double>(delivered + dropped);
+        }
+    }
+    return s;
+}
+
+// ============================================================================
+// 调度
+// ============================================================================
+
+const char* LoadGovernor::Overloaded(const LoadSample& s) const {
+    if (config_.temp_high > 0 && s.temp_c >= config_.temp_high) return "temperature";
+    if (config_.cpu_high > 0 && s.cpu_percent >= config_.cpu_high) return "cpu";
+    if (config_.latency_high_ms > 0 && s.inference_latency_ms >= config_.latency_high_ms) {
+        return "inference_latency";
+    }
+    if (config_.drop_high > 0 && s.drop_ratio >= config_.drop_high) return "drops";
+    return nullptr;
+}
+
+bool LoadGovernor::HasHeadroom(const LoadSample& s) const {
+    return (config_.temp_high <= 0 || s.temp_c < config_.temp_low) &&
+           (config_.cpu_high <= 0 || s.cpu_percent < config_.cpu_low) &&
+           (config_.latency_high_ms <= 0 || s.inference_latency_ms < config_.latency_low_ms) &&
+           (config_.drop_high <= 0 || s.drop_ratio < config_.drop_low);
+}
+
+void LoadGovernor::Loop() {
+    const auto interval = std::chrono::milliseconds(config_.interval_ms);
+    const auto hold = std::chrono::milliseconds(config_.hold_ms);
+    const auto recover = std::chrono::milliseconds(config_.recover_ms);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_) {
+        cv_.wait_for(lock, interval, [this] { return !running_; });
+        if (!running_) {
+            break;
+        }
+        lock.unlock();
+
+        const Counters counters = ReadCounters();
+        const LoadSample sample = Measure(counters);
+        last_ = counters;
+        const char* pressure = Overloaded(sample);
+        const auto now = Clock::now();
+
+        if (pressure) {
+            headroom_since_ = Clock::time_point();
+            if (overload_since_ == Clock::time_point()) {
+                overload_since_ = now;
+            }
+            if (now - overload_since_ >= hold) {
+                StepDown(pressure, sample);
+                overload_since_ = now;   // 降级后重新计时，给上一级生效的时间
+            }
+        } else {
+            overload_since_ = Clock::time_point();
+            if (!HasHeadroom(sample)) {
+                headroom_since_ = Clock::time_point();
+            } else {
+                if (headroom_since_ == Clock::time_point()) {
+                    headroom_since_ = now;
+                }
+                // 撤销失败时不重新计时，下个采样周期再试
+                if (now - headroom_since_ >= recover && StepUp(sample)) {
+                    headroom_since_ = now;
+                }
+            }
+        }
+
+        lock.lock();
+        sample_ = sample;
+        pressure_ = pressure ? pressure : "";
+    }
+}
+
+void LoadGovernor::StepDown(const char* pressure, const LoadSample& s) {
+    size_t next = engaged_.empty() ? 0 : engaged_.back() + 1;
+    for (; next < rungs_.size(); ++next) {
+        const Rung& rung = rungs_[next];
+        if (!rung.engage || !rung.engage()) {
+            LOG_DEBUG("Governor rung '{}' not applicable, trying next", rung.name);
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            engaged_.push_back(next);
+            degrades_++;
+        }
+        LOG_WARN("Load governor degrade -> {} (level {}/{}; {}: cpu {:.0f}%, temp {:.1f}C, "
+                 "inference {:.0f}ms, drops {:.1f}%)",
+                 rung.name, engaged_.size(), rungs_.size(), pressure, s.cpu_percent, s.temp_c,
+                 s.inference_latency_ms, s.drop_ratio * 100);
+        return;
+    }
+    LOG_WARN_THROTTLED(30000, "Load governor at lowest level, still overloaded ({})", pressure);
+}
+
+bool LoadGovernor::StepUp(const LoadSample& s) {
+    if (engaged_.empty()) {
+        return true;
+    }
+    const Rung& rung = rungs_[engaged_.back()];
+    if (rung.release && !rung.release()) {
+        LOG_WARN_THROTTLED(30000, "Load governor failed to restore {}, will retry", rung.name);
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        engaged_.pop_back();
+        restores_++;
+    }
+    LOG_INFO("Load governor restore <- {} (level {}/{}; cpu {:.0f}%, temp {:.1f}C)",
+             rung.name, engaged_.size(), rungs_.size(), s.cpu_percent, s.temp_c);
+    return true;
+}
@@ -0,0 +1,186 @@
+/**
+ * @file load_governor.h
+ * @brief 负载调度器 - CPU / 温度过载时按阶梯逐级降级，余量恢复后逆序还原
+ *
+ * 后台线程每 interval_ms 采样一次：
+ * - CPU 占用：/proc/stat 两次采样之差（全部核心合计，iowait 计为空闲）
+ * - SoC 温度：/sys/class/thermal/thermal_zone* 中的最高温度
+ * - 推理阶段延迟：VI 采集到推理完成的捕获延迟（LatencyTracer inference 阶段）本窗口均值
+ * - 消费者丢帧率：各流消费者本窗口 dropped / (delivered + dropped)
+ *
+ * 任一指标越过上限并持续 hold_ms，启用降级阶梯的下一级；仍未缓解则每隔 hold_ms 再降一级。
+ * 全部指标回到下限以下并持续 recover_ms，撤销最近启用的一级（撤销失败时保持启用，
+ * 下个采样周期重试）。上下限之间保持不动（回差）。
+ *
+ * 阶梯各级由调用方注册（名称 + 启用 / 撤销回调），按 ladder 中的顺序启用，默认：
+ *   inference    推理降速（MediaManager::SetInferenceDivisor）
+ *   preview_sub  低延迟预览（WebSocket / WebRTC）切到子码流
+ *   keyframes    WebSocket 预览只推关键帧
+ *   fps          主码流 VENC 降帧率（IMediaProducer::SetFrameRate）
+ * ladder 中未注册的级别（如未开启子码流时的 preview_sub）直接跳过。
+ *
+ * @note 启用 / 撤销回调在调度线程执行；GetStatus() 可在任意线程调用
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-18
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ============================================================================
+// 配置与状态
+// ============================================================================
+
+/**
+ * @brief 负载调度配置（阈值为 0 表示不看该指标）
+ */
+struct LoadGovernorConfig {
+    bool enabled = true;
+    int interval_ms = 1000;             ///< 采样周期
+    int hold_ms = 3000;                 ///< 过载持续多久降一级
+    int recover_ms = 15000;             ///< 余量持续多久恢复一级
+
+    double cpu_high = 90.0;             ///< CPU 占用上限（%）
+    double cpu_low = 70.0;              ///< CPU 占用恢复线
+    double temp_high = 90.0;            ///< SoC 温度上限（°C）
+    double temp_low = 80.0;             ///< SoC 温度恢复线
+    double latency_high_ms = 500.0;     ///< 推理阶段捕获延迟上限
+    double latency_low_ms = 250.0;      ///< 推理阶段捕获延迟恢复线
+    double drop_high = 0.05;            ///< 消费者丢帧率上限
+    double drop_low = 0.01;             ///< 消费者丢帧率恢复线
+
+    /// 降级阶梯（启用顺序；撤销顺序相反）
+    std::vector<std::string> ladder = {"inference", "preview_sub", "keyframes", "fps"};
+
+    int inference_divisor = 2;          ///< inference 级：推理降速倍数
+    int reduced_fps = 15;               ///< fps 级：主码流输出帧率
+};
+
+/**
+ * @brief 一次采样的负载指标
+ */
+struct LoadSample {
+    double cpu_percent = 0.0;
+    double temp_c = 0.0;                ///< 0 表示没有可读的温度传感器
+    double inference_latency_ms = 0.0;  ///< 本窗口没有推理时为 0
+    double drop_ratio = 0.0;
+};
+
+/**
+ * @brief 负载调度状态快照
+ */
+struct LoadGovernorStatus {
+    bool enabled = false;
+    bool running = false;
+    std::vector<std::string> ladder;    ///< 实际可用的阶梯（已注册的级别，按启用顺序）
+    std::vector<std::string> engaged;   ///< 已启用的级别（按启用顺序）
+    LoadSample sample;                  ///< 最近一次采样
+    std::string pressure;               ///< 最近一次采样中越过上限的指标（为空表示未过载）
+    uint64_t degrades = 0;              ///< 累计降级次数
+    uint64_t restores = 0;              ///< 累计恢复次数
+};
+
+// ============================================================================
+// 负载调度器
+// ============================================================================
+
+class LoadGovernor {
+public:
+    /// 启用一级降级；返回 false 表示当前不适用，跳到下一级
+    using EngageAction = std::function<bool()>;
+    /// 撤销一级降级；返回 false 表示未能生效，保持启用，下个采样周期重试
+    using ReleaseAction = std::function<bool()>;
+
+    static LoadGovernor& Instance();
+
+    LoadGovernor(const LoadGovernor&) = delete;
+    LoadGovernor& operator=(const LoadGovernor&) = delete;
+
+    /**
+     * @brief 设置配置（Start 之前调用）
+     */
+    void Configure(const LoadGovernorConfig& config);
+
+    const LoadGovernorConfig& GetConfig() const { return config_; }
+
+    /**
+     * @brief 注册一级降级（Start 之前调用；是否启用及顺序由 ladder 决定）
+     */
+    void AddRung(const std::string& name, EngageAction engage, ReleaseAction release);
+
+    /**
+     * @brief 启动调度线程（未启用或没有可用级别时不启动）
+     */
+    bool Start();
+
+    /**
+     * @brief 停止调度线程，并按相反顺序撤销所有已启用的级别
+     */
+    void Stop();
+
+    LoadGovernorStatus GetStatus() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Rung {
+        std::string name;
+        EngageAction engage;
+        ReleaseAction release;
+    };
+
+    /// 累计计数（两次采样之差即本窗口的值）
+    struct Counters {
+        uint64_t cpu_total = 0;
+        uint64_t cpu_idle = 0;
+        uint64_t inference_count = 0;
+        uint64_t inference_sum_us = 0;
+        uint64_t delivered = 0;
+        uint64_t dropped = 0;
+    };
+
+    LoadGovernor() = default;
+
+    void Loop();
+    Counters ReadCounters() const;
+    LoadSample Measure(const Counters& now) const;
+    static double ReadMaxTemperature();
+
+    /// 越过上限的指标名（未过载时为 nullptr）
+    const char* Overloaded(const LoadSample& s) const;
+    /// 全部指标都在恢复线以下
+    bool HasHeadroom(const LoadSample& s) const;
+
+    void StepDown(const char* pressure, const LoadSample& s);
+    /// 撤销最近启用的一级；撤销失败时返回 false（保持启用）
+    bool StepUp(const LoadSample& s);
+
+    LoadGovernorConfig config_;
+
+    mutable std::mutex mutex_;
+    std::vector<Rung> rungs_;           // 按 ladder 顺序排列的可用级别
+    std::vector<Rung> registered_;      // AddRung() 注册的全部级别
+    std::vector<size_t> engaged_;       // 已启用级别在 rungs_ 中的下标（栈）
+    LoadSample sample_;
+    std::string pressure_;
+    uint64_t degrades_ = 0;
+    uint64_t restores_ = 0;
+
+    // 仅调度线程访问
+    Counters last_;
+    Clock::time_point overload_since_;
+    Clock::time_point headroom_since_;
+
+    std::condition_variable cv_;
+    bool running_ = false;
+    std::thread thread_;
+};
@@ -3,15 +3,16 @@
  * @brief AIPC 主程序 - 基于 RV1106 的边缘 AI 相机
  *
  * 支持的输出方式：
- * - RTSP: rtsp://<device_ip>:554/live/0
+ * - RTSP: rtsp://<device_ip>:554/live/0（双码流时为 /live/main 与 /live/sub）
  * - WebRTC: http://<device_ip>:8080
+ * - LL-HLS: http://<device_ip>:8080/hls/live.m3u8
  * - 文件录制: /root/record/
  *
  * HTTP API: 见 http.h
  * 
  * 使用新的 Producer-based 架构：
- * - MediaManager: 统一管理视频采集模式（SimpleIPC/YOLOv5/RetinaFace）
- * - StreamManager: 管理流分发（RTSP/WebRTC/WebSocket/File）
+ * - MediaManager: 统一管理视频采集模式（SimpleIPC/YOLOv5/RetinaFace；--replay 时为文件回放）
+ * - StreamManager: 管理流分发（RTSP/WebRTC/WebSocket/HLS/File）
  *
  * @author 好软，好温暖
  * @date 2026-02-12
@@ -21,21 +22,31 @@
 #define LOG_TAG "main"
 
 #include <csignal>
+#include <algorithm>
 #include <atomic>
 #include <thread>
 #include <chrono>
+#include <cstdio>
 #include <cstdlib>
+#include <fstream>
+#include <future>
+#include <iterator>
 #include <unistd.h>
 #include <linux/limits.h>
 #include "common/logger.h"
 #include "common/asio_context.h"
+#include "common/latency_trace.h"
+#include "common/startup_timeline.h"
 #include "media_producer/media_manager.h"
+#include "media_producer/common/detection_metadata.h"
 #include "media_distribution/stream_manager.h"
 #include "media_distribution/rtsp/rtsp_service.h"
 #include "media_distribution/file/file_service.h"
 #include "media_distribution/webrtc/webrtc_service.h"
 #include "media_distribution/wspreview/ws_preview.h"
+#include "media_distribution/hls/hls_packager.h"
 #include "http.h"
+#include "load_governor.h"
 
 // 全局退出标志
 static std::atomic<bool> g_running{true};
@@ -43,6 +54,9 @@ static std::atomic<bool> g_running{true};
 // 全局 HTTP API 实例
 static std::unique_ptr<HttpApi> g_http_api;
 
+// 低延迟预览（WebSocket / WebRTC）当前订阅的码流：负载调度降级时可在运行中切到子码流
+static std::atomic<media::StreamSelector> g_live_preview{media::StreamSelector::kMain};
+
 // 获取可执行文件所在目录
 static std::string get_exe_dir() {
     char path[PATH_MAX];
@@ -80,8 +94,13 @@ static void print_startup_info(const StreamConfig& config, int http_port) {
     
     if (config.enable_rtsp) {
         LOG_INFO("RTSP Stream:");
-        LOG_INFO("  URL: rtsp://<device_ip>:{}{}", 
-                 config.rtsp_config.port, config.rtsp_config.path);
+        if (config.rtsp_config.mounts.empty()) {
+            LOG_INFO("  URL: rtsp://<device_ip>:{}{}",
+                     config.rtsp_config.port, config.rtsp_config.path);
+        }
+        for (const auto& mount : config.rtsp_config.mounts) {
+            LOG_INFO("  URL: rtsp://<device_ip>:{}{}", config.rtsp_config.port, mount.path);
+        }
     }
     
     if (config.enable_webrtc) {
@@ -94,6 +113,11 @@ static void print_startup_info(const StreamConfig& config, int http_port) {
         LOG_INFO("  URL: ws://<device_ip>:{}", config.ws_preview_config.port);
     }
     
+    if (config.enable_hls) {
+        LOG_INFO("LL-HLS Stream:");
+        LOG_INFO("  URL: http://<device_ip>:{}/hls/live.m3u8", http_port);
+    }
+    
     if (config.enable_file) {
         LOG_INFO("Recording:");
         LOG_INFO("  Output: {}", config.mp4_config.outputDir);
@@ -105,6 +129,9 @@ static void print_startup_info(const StreamConfig& config, int http_port) {
 }
 
 int main(int argc, char* argv[]) {
+    // 启动时间线以进程入口为零点
+    media::StartupTimeline::Instance();
+
     // 初始化日志系统
     LogManager::Init();
     
@@ -156,6 +183,9 @@ int main(int argc, char* argv[]) {
     stream_config.enable_ws_preview = true;
     stream_config.ws_preview_config.port = 8082;
     
+    // LL-HLS 配置 - 默认启用，由 HTTP 服务器提供，无请求时不打包
+    stream_config.enable_hls = true;
+    
     // ========================================================================
     // HTTP API 配置
     // ========================================================================
@@ -166,7 +196,25 @@ int main(int argc, char* argv[]) {
     http_config.host = "0.0.0.0";
     http_config.port = 8080;
     http_config.static_dir = exe_dir + "/../www";
-    http_config.thread_pool_size = 2;
+    http_config.thread_pool_size = 4;
+    // LL-HLS 阻塞式刷新 / 预告 part 在独立线程上等待发布（每个播放器约两个），不占 API 工作线程
+    http_config.blocking_pool_size = 8;
+    // 连接 I/O 在 IoContext 上处理，keep-alive 空闲连接与事件流不占工作线程
+    http_config.mode = HttpServerMode::kAsio;
+
+    // ========================================================================
+    // 视频生产者配置
+    // ========================================================================
+    media::ProducerConfig producer_config;
+    producer_config.resolution = media::Resolution::R_1080P;
+    producer_config.framerate = 30;
+    producer_config.bitrate_kbps = 10 * 1024;  // 10 Mbps
+    producer_config.model_cache_mb = 64;        // 模型缓存上限（常驻 + 空闲模型）
+    int gop_cache_kb = 0;                       // GOP 缓存上限（作用于预览码流，0 = 关闭）
+    int io_threads = 0;                         // IO 线程数（0 = CPU 核数）
+    bool preview_main = false;                  // 双码流时预览仍订阅主码流（负载调度可降到子码流）
+    LoadGovernorConfig governor_config;         // 负载调度（CPU / 温度过载时逐级降级）
+    media::ProducerMode initial_mode = media::ProducerMode::SimpleIPC;
 
     // ========================================================================
     // 命令行参数解析
@@ -179,19 +227,324 @@ int main(int argc, char* argv[]) {
         } else if (arg == "--rtsp") {
             stream_config.auto_start_rtsp = true;
             LOG_INFO("RTSP auto-start enabled via command line");
+        } else if (arg == "--rtsp-multicast" && i + 1 < argc) {
+            // 组播地址，如 239.255.42.1（第 N 路依次 +N）
+            stream_config.rtsp_config.enableMulticast = true;
+            stream_config.rtsp_config.multicastGroup = argv[++i];
+            LOG_INFO("RTSP multicast enabled: {}", stream_config.rtsp_config.multicastGroup);
+        } else if (arg == "--rtsp-no-tcp") {
+            stream_config.rtsp_config.enableTcp = false;
+            LOG_INFO("RTSP TCP interleaved transport disabled via command line");
         } else if (arg == "--webrtc") {
             stream_config.auto_start_webrtc = true;
             LOG_INFO("WebRTC auto-start enabled via command line");
         } else if (arg == "--no-ws-preview") {
             stream_config.enable_ws_preview = false;
             LOG_INFO("WebSocket preview disabled via command line");
+        } else if (arg == "--no-hls") {
+            stream_config.enable_hls = false;
+            LOG_INFO("LL-HLS disabled via command line");
+        } else if (arg == "--warm-models" && i + 1 < argc) {
+            // 逗号分隔，如 yolov5,retinaface
+            std::string list = argv[++i];
+            producer_config.warm_models.clear();
+            size_t pos = 0;
+            while (pos <= list.size()) {
+                size_t comma = list.find(',', pos);
+                if (comma == std::string::npos) comma = list.size();
+                if (comma > pos) {
+                    producer_config.warm_models.push_back(list.substr(pos, comma - pos));
+                }
+                pos = comma + 1;
+            }
+            LOG_INFO("Warm models: {}", list);
+        } else if (arg == "--preload-models") {
+            producer_config.preload_models = true;
+            LOG_INFO("Model preloading enabled via command line");
+        } else if (arg == "--model-cache-mb" && i + 1 < argc) {
+            producer_config.model_cache_mb = std::atoi(argv[++i]);
+            LOG_INFO("Model cache limit: {}MB", producer_config.model_cache_mb);
+        } else if (arg == "--codec" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (!media::ParseVideoCodec(name, &producer_config.codec)) {
+                LOG_ERROR("Unknown codec: {} (expected h264 or h265)", name);
+                return -1;
+            }
+            stream_config.codec = producer_config.codec;
+            LOG_INFO("Video codec: {}", media::VideoCodecToString(producer_config.codec));
+        } else if (arg == "--sub-stream" && i + 1 < argc) {
+            // 子码流分辨率，如 640x360
+            int w = 0, h = 0;
+            if (std::sscanf(argv[++i], "%dx%d", &w, &h) != 2 || w <= 0 || h <= 0) {
+                LOG_ERROR("Invalid sub stream size: {} (expected WxH)", argv[i]);
+                return -1;
+            }
+            producer_config.sub_stream = true;
+            producer_config.sub_width = w;
+            producer_config.sub_height = h;
+            LOG_INFO("Sub stream enabled: {}x{}", w, h);
+        } else if (arg == "--preview-main") {
+            preview_main = true;
+        } else if (arg == "--sub-bitrate" && i + 1 < argc) {
+            producer_config.sub_bitrate_kbps = std::atoi(argv[++i]);
+            LOG_INFO("Sub stream bitrate: {}kbps", producer_config.sub_bitrate_kbps);
+        } else if (arg == "--gop-cache-kb" && i + 1 < argc) {
+            gop_cache_kb = std::atoi(argv[++i]);
+            LOG_INFO("GOP cache budget: {}KB", gop_cache_kb);
+        } else if (arg == "--io-threads" && i + 1 < argc) {
+            io_threads = std::atoi(argv[++i]);
+            LOG_INFO("IO threads: {}", io_threads);
+        } else if (arg == "--prerecord-sec" && i + 1 < argc) {
+            stream_config.prerecord_config.pre_seconds = std::atoi(argv[++i]);
+            LOG_INFO("Event prerecord: {}s", stream_config.prerecord_config.pre_seconds);
+        } else if (arg == "--postrecord-sec" && i + 1 < argc) {
+            stream_config.prerecord_config.post_seconds = std::atoi(argv[++i]);
+            LOG_INFO("Event postrecord: {}s", stream_config.prerecord_config.post_seconds);
+        } else if (arg == "--prerecord-kb" && i + 1 < argc) {
+            stream_config.prerecord_config.buffer_kb = std::atoi(argv[++i]);
+            LOG_INFO("Prerecord buffer: {}KB", stream_config.prerecord_config.buffer_kb);
+        } else if (arg == "--fmp4") {
+            stream_config.mp4_config.fragmented = true;
+            LOG_INFO("Recording as fragmented MP4 (one fragment per GOP)");
+        } else if (arg == "--record-chunk-kb" && i + 1 < argc) {
+            stream_config.mp4_config.ioChunkKb = std::atoi(argv[++i]);
+            LOG_INFO("Record write chunk: {}KB", stream_config.mp4_config.ioChunkKb);
+        } else if (arg == "--record-direct") {
+            stream_config.mp4_config.ioDirect = true;
+            LOG_INFO("Record writes use O_DIRECT");
+        } else if (arg == "--record-prealloc-mb" && i + 1 < argc) {
+            stream_config.mp4_config.preallocBytes = std::atoll(argv[++i]) << 20;
+            LOG_INFO("Record preallocation: {}MB per file", stream_config.mp4_config.preallocBytes >> 20);
+        } else if (arg == "--segment-sec" && i + 1 < argc) {
+            stream_config.mp4_config.segmentDurationSec = std::atoi(argv[++i]);
+            LOG_INFO("Record segment duration: {}s", stream_config.mp4_config.segmentDurationSec);
+        } else if (arg == "--segment-mb" && i + 1 < argc) {
+            stream_config.mp4_config.maxFileSizeBytes = std::atoll(argv[++i]) << 20;
+            LOG_INFO("Record segment size: {}MB", stream_config.mp4_config.maxFileSizeBytes >> 20);
+        } else if (arg == "--retention-pct" && i + 1 < argc) {
+            stream_config.mp4_config.retentionMaxUsagePct = std::atoi(argv[++i]);
+            LOG_INFO("Record retention: disk usage <= {}%",
+                     stream_config.mp4_config.retentionMaxUsagePct);
+        } else if (arg == "--retention-mb" && i + 1 < argc) {
+            stream_config.mp4_config.retentionMaxBytes = std::atoll(argv[++i]) << 20;
+            LOG_INFO("Record retention: total <= {}MB",
+                     stream_config.mp4_config.retentionMaxBytes >> 20);
+        } else if (arg == "--event-record") {
+            producer_config.detection_events.enabled = true;
+            LOG_INFO("Detection-triggered recording enabled via command line");
+        } else if (arg == "--event-classes" && i + 1 < argc) {
+            // 逗号分隔，如 person,car
+            std::string list = argv[++i];
+            auto& classes = producer_config.detection_events.classes;
+            classes.clear();
+            size_t pos = 0;
+            while (pos <= list.size()) {
+                size_t comma = list.find(',', pos);
+                if (comma == std::string::npos) comma = list.size();
+                if (comma > pos) {
+                    classes.push_back(list.substr(pos, comma - pos));
+                }
+                pos = comma + 1;
+            }
+            LOG_INFO("Event classes: {}", list);
+        } else if (arg == "--event-conf" && i + 1 < argc) {
+            producer_config.detection_events.min_confidence = std::strtof(argv[++i], nullptr);
+        } else if (arg == "--event-min-area" && i + 1 < argc) {
+            producer_config.detection_events.min_area = std::strtof(argv[++i], nullptr);
+        } else if (arg == "--event-dwell-ms" && i + 1 < argc) {
+            producer_config.detection_events.dwell_ms = std::atoi(argv[++i]);
+        } else if (arg == "--event-cooldown-ms" && i + 1 < argc) {
+            producer_config.detection_events.cooldown_ms = std::atoi(argv[++i]);
+        } else if (arg == "--webrtc-abr") {
+            stream_config.webrtc_config.webrtc_config.abr.enabled = true;
+            LOG_INFO("WebRTC adaptive bitrate enabled via command line");
+        } else if (arg == "--webrtc-no-standby") {
+            stream_config.webrtc_config.webrtc_config.standby_peer = false;
+        } else if (arg == "--ai-overlay" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name == "rgn") {
+                producer_config.ai_overlay = media::OverlayBackend::kRgn;
+            } else if (name == "cpu") {
+                producer_config.ai_overlay = media::OverlayBackend::kCpu;
+            } else if (name == "client") {
+                producer_config.ai_overlay = media::OverlayBackend::kClient;
+            } else {
+                LOG_ERROR("Unknown AI overlay backend: {} (expected rgn, cpu or client)", name);
+                return 1;
+            }
+            LOG_INFO("AI overlay backend: {}", name);
+        } else if (arg == "--ai-interval" && i + 1 < argc) {
+            producer_config.inference_interval = std::max(1, std::atoi(argv[++i]));
+            LOG_INFO("AI inference interval: {} frames", producer_config.inference_interval);
+        } else if (arg == "--ai-fixed-interval") {
+            producer_config.adaptive_inference = false;
+        } else if (arg == "--yolo-hz" && i + 1 < argc) {
+            producer_config.yolo_rate_hz = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--face-hz" && i + 1 < argc) {
+            producer_config.face_rate_hz = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--face-full-frame") {
+            producer_config.face_in_person = false;
+        } else if (arg == "--motion-gate") {
+            producer_config.motion_gate.enabled = true;
+        } else if (arg == "--motion-threshold" && i + 1 < argc) {
+            producer_config.motion_gate.pixel_threshold = std::atoi(argv[++i]);
+        } else if (arg == "--motion-sensitivity" && i + 1 < argc) {
+            producer_config.motion_gate.sensitivity = std::atoi(argv[++i]);
+        } else if (arg == "--motion-map" && i + 1 < argc) {
+            // 文件路径或内联字符串（9 行 x 16 位数字，行间以 ',' 分隔）
+            std::string value = argv[++i];
+            std::ifstream file(value);
+            if (file) {
+                value.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            }
+            producer_config.motion_gate.sensitivity_map = value;
+        } else if (arg == "--motion-hold-ms" && i + 1 < argc) {
+            producer_config.motion_gate.hold_ms = std::atoi(argv[++i]);
+        } else if (arg == "--roi") {
+            producer_config.smart_encode.roi = true;
+        } else if (arg == "--roi-qp" && i + 1 < argc) {
+            producer_config.smart_encode.roi_qp = std::atoi(argv[++i]);
+        } else if (arg == "--smart-rate") {
+            producer_config.smart_encode.smart_rate = true;
+        } else if (arg == "--idle-bitrate-pct" && i + 1 < argc) {
+            producer_config.smart_encode.idle_bitrate_percent = std::atoi(argv[++i]);
+        } else if (arg == "--idle-fps" && i + 1 < argc) {
+            producer_config.smart_encode.idle_fps = std::atoi(argv[++i]);
+        } else if (arg == "--no-snapshot") {
+            producer_config.snapshot = false;
+        } else if (arg == "--snapshot-quality" && i + 1 < argc) {
+            producer_config.snapshot_quality = std::atoi(argv[++i]);
+        } else if (arg == "--no-governor") {
+            governor_config.enabled = false;
+            LOG_INFO("Load governor disabled via command line");
+        } else if (arg == "--governor-cpu" && i + 1 < argc) {
+            // 过载线；恢复线低 20 个百分点
+            governor_config.cpu_high = std::atof(argv[++i]);
+            governor_config.cpu_low = std::max(0.0, governor_config.cpu_high - 20.0);
+        } else if (arg == "--governor-temp" && i + 1 < argc) {
+            // 过载线（°C）；恢复线低 10°C
+            governor_config.temp_high = std::atof(argv[++i]);
+            governor_config.temp_low = std::max(0.0, governor_config.temp_high - 10.0);
+        } else if (arg == "--governor-ladder" && i + 1 < argc) {
+            // 逗号分隔，如 inference,keyframes,fps
+            std::string list = argv[++i];
+            governor_config.ladder.clear();
+            size_t pos = 0;
+            while (pos <= list.size()) {
+                size_t comma = list.find(',', pos);
+                if (comma == std::string::npos) comma = list.size();
+                if (comma > pos) {
+                    governor_config.ladder.push_back(list.substr(pos, comma - pos));
+                }
+                pos = comma + 1;
+            }
+            LOG_INFO("Governor ladder: {}", list);
+        } else if (arg == "--governor-fps" && i + 1 < argc) {
+            governor_config.reduced_fps = std::atoi(argv[++i]);
+        } else if (arg == "--governor-ai-divisor" && i + 1 < argc) {
+            governor_config.inference_divisor = std::atoi(argv[++i]);
+        } else if (arg == "--latency-sei") {
+            media::LatencyTracer::Instance().SetSeiEnabled(true);
+            LOG_INFO("Capture timestamp SEI enabled via command line (debug)");
+        } else if (arg == "--http-threaded") {
+            http_config.mode = HttpServerMode::kThreaded;
+            LOG_INFO("HTTP server uses the cpp-httplib thread pool via command line");
+        } else if (arg == "--replay" && i + 1 < argc) {
+            producer_config.replay.path = argv[++i];
+            initial_mode = media::ProducerMode::Replay;
+            LOG_INFO("Replay mode enabled via command line: {}", producer_config.replay.path);
+        } else if (arg == "--replay-nv12" && i + 1 < argc) {
+            // NV12 原始帧尺寸，如 1920x1080
+            int w = 0, h = 0;
+            if (std::sscanf(argv[++i], "%dx%d", &w, &h) != 2 || w <= 0 || h <= 0) {
+                LOG_ERROR("Invalid NV12 frame size: {} (expected WxH)", argv[i]);
+                return -1;
+            }
+            producer_config.replay.format = media::ReplayFormat::kNV12;
+            producer_config.replay.width = w;
+            producer_config.replay.height = h;
+        } else if (arg == "--replay-model" && i + 1 < argc) {
+            producer_config.replay.model = argv[++i];
+        } else if (arg == "--replay-results" && i + 1 < argc) {
+            producer_config.replay.results_path = argv[++i];
+        } else if (arg == "--replay-fast") {
+            producer_config.replay.realtime = false;
+        } else if (arg == "--replay-once") {
+            producer_config.replay.loop = false;
         } else if (arg == "--help" || arg == "-h") {
             printf("Usage: %s [options]\n", argv[0]);
             printf("Options:\n");
             printf("  --record, -r      Enable file recording\n");
             printf("  --rtsp            Auto-start RTSP server on startup\n");
+            printf("  --rtsp-multicast G  Allow RTSP multicast on group G (e.g. 239.255.42.1)\n");
+            printf("  --rtsp-no-tcp     Reject RTSP RTP-over-TCP (interleaved) clients\n");
             printf("  --webrtc          Auto-start WebRTC server on startup\n");
             printf("  --no-ws-preview   Disable WebSocket preview\n");
+            printf("  --no-hls          Disable LL-HLS (http://<ip>:8080/hls/live.m3u8)\n");
+            printf("  --codec C         Video codec: h264 (default) or h265\n");
+            printf("  --sub-stream WxH  Encode a sub stream (e.g. 640x360) for WebRTC/WS/HLS preview\n");
+            printf("                    and RTSP /live/sub (main stream moves to /live/main)\n");
+            printf("  --preview-main    With --sub-stream, keep WS/WebRTC/HLS preview on the main stream\n");
+            printf("                    (the load governor may move WS/WebRTC to the sub stream)\n");
+            printf("  --sub-bitrate N   Sub stream bitrate in kbps (default: 1024)\n");
+            printf("  --webrtc-abr      Adapt sub stream bitrate to WebRTC RTCP feedback\n");
+            printf("  --webrtc-no-standby  Do not keep a pre-warmed WebRTC PeerConnection\n");
+            printf("  --gop-cache-kb N  Cache the latest GOP (up to N KB) for instant WS/WebRTC start\n");
+            printf("  --io-threads N    IO event loop threads (default: 0 = one per CPU core)\n");
+            printf("  --fmp4            Record fragmented MP4 (playable after power loss)\n");
+            printf("  --record-chunk-kb N  Record write chunk size in KB (default 512)\n");
+            printf("  --record-direct   Write recordings with O_DIRECT (bypass page cache)\n");
+            printf("  --record-prealloc-mb N  Preallocate N MB per recording file\n");
+            printf("  --segment-sec N   Start a new MP4 file every N seconds (at a keyframe)\n");
+            printf("  --segment-mb N    Start a new MP4 file once the current one reaches N MB\n");
+            printf("  --retention-pct N Delete the oldest recordings when disk usage exceeds N%%\n");
+            printf("  --retention-mb N  Delete the oldest recordings when they exceed N MB in total\n");
+            printf("  --prerecord-sec N Record N seconds before an event (default: 0 = off)\n");
+            printf("  --postrecord-sec N Record N seconds after the last event (default: 10)\n");
+            printf("  --prerecord-kb N  Prerecord buffer size in KB (default: 8192)\n");
+            printf("  --event-record    Record when AI detections match the event rules\n");
+            printf("  --event-classes L Event classes, comma separated (default: any)\n");
+            printf("  --event-conf F    Event min confidence (default: 0.5)\n");
+            printf("  --event-min-area F Event min box area as fraction of frame (default: 0)\n");
+            printf("  --event-dwell-ms N Detection must persist N ms (default: 500)\n");
+            printf("  --event-cooldown-ms N No new event for N ms after one ends (default: 5000)\n");
+            printf("  --warm-models L   Keep models resident, comma separated (yolov5,retinaface)\n");
+            printf("  --preload-models  Load warm models at startup instead of first use\n");
+            printf("  --model-cache-mb N  Model cache memory limit in MB (default: 64)\n");
+            printf("  --ai-overlay B    Detection box rendering: rgn (default), cpu, or client (browser draws)\n");
+            printf("  --ai-interval N   Run YOLO every N frames, track boxes in between (default: 1)\n");
+            printf("  --ai-fixed-interval  Never run early when tracks are unstable\n");
+            printf("  --yolo-hz F       yolo_face mode: person detection rate, 0 = unlimited (default: 10)\n");
+            printf("  --face-hz F       yolo_face mode: face detection rate, 0 = unlimited (default: 5)\n");
+            printf("  --face-full-frame yolo_face mode: detect faces in the whole frame, not just person boxes\n");
+            printf("  --motion-gate     Skip YOLO inference while the scene is still\n");
+            printf("  --motion-threshold N  Motion pixel luma difference threshold (default: 18)\n");
+            printf("  --motion-sensitivity N  Default cell sensitivity 1-9 (default: 5)\n");
+            printf("  --motion-map M    Sensitivity map file or inline 9 rows of 16 digits (0 = ignore)\n");
+            printf("  --motion-hold-ms N  Keep inferring N ms after motion stops (default: 2000)\n");
+            printf("  --roi             Encode detected objects as VENC ROI (sharper subjects)\n");
+            printf("  --roi-qp N        ROI relative QP (default: -6)\n");
+            printf("  --smart-rate      Lower bitrate and frame rate while no objects are detected\n");
+            printf("  --idle-bitrate-pct N  Idle bitrate as percent of full bitrate (default: 30)\n");
+            printf("  --idle-fps N      Idle output frame rate, 0 keeps full rate (default: 10)\n");
+            printf("  --no-snapshot     Disable JPEG snapshots (/api/snapshot)\n");
+            printf("  --snapshot-quality N  Snapshot JPEG quality 1-99 (default: 80)\n");
+            printf("  --no-governor     Disable CPU/thermal load shedding\n");
+            printf("  --governor-cpu N  Degrade above N%% CPU, restore below N-20%% (default: 90)\n");
+            printf("  --governor-temp N Degrade above N C SoC temperature, restore below N-10 (default: 90)\n");
+            printf("  --governor-ladder L  Degradation order, comma separated\n");
+            printf("                    (default: inference,preview_sub,keyframes,fps)\n");
+            printf("  --governor-fps N  Main stream frame rate at the fps rung (default: 15)\n");
+            printf("  --governor-ai-divisor N  Run inference 1/N as often at the inference rung (default: 2)\n");
+            printf("  --latency-sei     Embed capture timestamps as SEI for end-to-end latency tests\n");
+            printf("  --http-threaded   Serve HTTP from the cpp-httplib thread pool instead of the IO loop\n");
+            printf("  --replay PATH     Replay an Annex-B file (--codec) instead of the sensor\n");
+            printf("                    (frame times from PATH.pts if present, else the frame rate)\n");
+            printf("  --replay-nv12 WxH Replay PATH as raw NV12 frames through AI inference (no video)\n");
+            printf("  --replay-model M  NV12 replay model: yolov5 (default) or retinaface\n");
+            printf("  --replay-results F  Write NV12 replay detections per frame to F (JSON Lines)\n");
+            printf("  --replay-fast     Replay as fast as possible instead of the original cadence\n");
+            printf("  --replay-once     Stop at the end of the file instead of looping\n");
             printf("  --help, -h        Show this help\n");
             printf("\nNotes:\n");
             printf("  RTSP and WebRTC services are created but not started by default.\n");
@@ -202,13 +555,79 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    // 回放模式只有一路码流（文件本身），不做子码流
+    if (initial_mode == media::ProducerMode::Replay && producer_config.sub_stream) {
+        LOG_WARN("--sub-stream is ignored in replay mode");
+        producer_config.sub_stream = false;
+    }
+
+    // 双码流：录制使用主码流，WebRTC、WebSocket 预览与 LL-HLS 订阅子码流（--preview-main
+    // 时仍订阅主码流）；RTSP 在同一端口上按路径区分：/live/main（兼容 /live/0）与 /live/sub
+    const media::StreamSelector preview_stream =
+        (producer_config.sub_stream && !preview_main) ? media::StreamSelector::kSub
+                                                      : media::StreamSelector::kMain;
+    g_live_preview = preview_stream;
+    if (producer_config.sub_stream) {
+        RtspMountConfig main_mount;
+        main_mount.path = "/live/main";
+        main_mount.aliases.push_back(stream_config.rtsp_config.path);
+        RtspMountConfig sub_mount;
+        sub_mount.path = "/live/sub";
+        stream_config.rtsp_config.mounts = {main_mount, sub_mount};
+    }
+    if (preview_stream == media::StreamSelector::kSub) {
+        stream_config.webrtc_config.webrtc_config.video.width = producer_config.sub_width;
+        stream_config.webrtc_config.webrtc_config.video.height = producer_config.sub_height;
+        stream_config.hls_config.width = producer_config.sub_width;
+        stream_config.hls_config.height = producer_config.sub_height;
+    }
+
+    // GOP 缓存只需要开在预览消费者订阅的码流上
+    if (gop_cache_kb > 0) {
+        if (producer_config.sub_stream) {
+            producer_config.sub_gop_cache_kb = gop_cache_kb;
+        } else {
+            producer_config.gop_cache_kb = gop_cache_kb;
+        }
+    }
+
+    // 自适应码率只作用于子码流：主码流同时供录制使用，不能因单个观看者的网络而降码率
+    auto& abr = stream_config.webrtc_config.webrtc_config.abr;
+    if (abr.enabled) {
+        if (preview_stream == media::StreamSelector::kSub) {
+            abr.max_kbps = producer_config.sub_bitrate_kbps;
+            abr.min_kbps = std::max(128, producer_config.sub_bitrate_kbps / 8);
+        } else {
+            abr.enabled = false;
+            LOG_WARN("WebRTC adaptive bitrate requires preview on --sub-stream, disabled");
+        }
+    }
+
+    // ========================================================================
+    // 初始化 MediaManager（新的 Producer-based 架构）
+    // ========================================================================
+    // 媒体链路（ISP/VI/VPSS/VENC）在独立线程初始化，与下面的网络服务创建并行；
+    // 两者互不依赖，直到注册流消费者时才汇合
+    LOG_INFO("Initializing MediaManager in {} mode...", media::ProducerModeToString(initial_mode));
+    auto& media_manager = media::MediaManager::Instance();
+    auto media_init = std::async(std::launch::async,
+                                 [&media_manager, &producer_config, initial_mode]() {
+        media::StartupTimeline::Scope scope("media_init");
+        return media_manager.Init(initial_mode, producer_config);
+    });
+
     // ========================================================================
     // 创建流管理器
     // ========================================================================
-    CreateStreamManager(stream_config);
+    {
+        media::StartupTimeline::Scope scope("stream_manager");
+        CreateStreamManager(stream_config);
+    }
     
     if (!GetStreamManager()) {
         LOG_ERROR("Failed to create stream manager!");
+        media_init.get();
+        media_manager.Deinit();
         return -1;
     }
 
@@ -217,30 +636,27 @@ int main(int argc, char* argv[]) {
     // ========================================================================
     g_http_api = std::make_unique<HttpApi>();
     
-    if (!g_http_api->Init(http_config, stream_config)) {
-        LOG_ERROR("Failed to initialize HTTP API!");
-        DestroyStreamManager();
-        return -1;
+    bool http_ok = false;
+    {
+        media::StartupTimeline::Scope scope("http_api");
+        if (!g_http_api->Init(http_config, stream_config)) {
+            LOG_ERROR("Failed to initialize HTTP API!");
+        } else if (!g_http_api->Start()) {
+            LOG_ERROR("Failed to start HTTP API!");
+        } else {
+            http_ok = true;
+        }
     }
     
-    if (!g_http_api->Start()) {
-        LOG_ERROR("Failed to start HTTP API!");
+    if (!http_ok) {
+        media_init.get();
+        media_manager.Deinit();
         DestroyStreamManager();
         return -1;
     }
 
-    // ========================================================================
-    // 初始化 MediaManager（新的 Producer-based 架构）
-    // ========================================================================
-    media::ProducerConfig producer_config;
-    producer_config.resolution = media::Resolution::R_1080P;
-    producer_config.framerate = 30;
-    producer_config.bitrate_kbps = 10 * 1024;  // 10 Mbps
-    
-    LOG_INFO("Initializing MediaManager in SimpleIPC mode...");
-    auto& media_manager = media::MediaManager::Instance();
-    
-    if (media_manager.Init(media::ProducerMode::SimpleIPC, producer_config) != 0) {
+    // 等待媒体链路就绪
+    if (media_init.get() != 0) {
         LOG_ERROR("Failed to initialize MediaManager!");
         g_http_api->Stop();
         DestroyStreamManager();
@@ -252,15 +668,33 @@ int main(int argc, char* argv[]) {
     
     auto* stream_mgr = GetStreamManager();
     
-    // 注册 RTSP 消费者
+    // 注册 RTSP 消费者（mount 0 = 主码流；双码流时 mount 1 = 子码流）
     if (stream_mgr->GetRtspService()) {
         media_manager.RegisterStreamConsumer(
             "rtsp",
             [](EncodedStreamPtr stream) {
-                RtspService::StreamConsumer(stream, GetStreamManager()->GetRtspService());
+                RtspService::StreamConsumer(stream, GetStreamManager()->GetRtspService(), 0);
             },
             media::StreamConsumerType::AsyncIO);
-        LOG_INFO("RTSP consumer registered");
+        LOG_INFO("RTSP consumer registered ({})", stream_mgr->GetRtspService()->GetUrl(0));
+
+        if (stream_mgr->GetRtspService()->MountCount() > 1) {
+            media_manager.RegisterStreamConsumer(
+                "rtsp_sub",
+                [](EncodedStreamPtr stream) {
+                    RtspService::StreamConsumer(stream, GetStreamManager()->GetRtspService(), 1);
+                },
+                media::StreamConsumerType::AsyncIO, 3,
+                media::QueueDropPolicy::DropToKeyframe, media::StreamSelector::kSub,
+                kRtspStrand);   // 与主码流同一 strand，RtspServer 内部串行
+            LOG_INFO("RTSP sub consumer registered ({})", stream_mgr->GetRtspService()->GetUrl(1));
+        }
+
+        // 新客户端 PLAY 后请求该路 IDR，不必等满一个 GOP
+        stream_mgr->GetRtspService()->OnKeyframeRequest([](size_t mount) {
+            media::MediaManager::Instance().RequestKeyFrame(
+                mount == 1 ? media::StreamSelector::kSub : media::StreamSelector::kMain, "rtsp");
+        });
     }
     
     // 注册 WebSocket 预览消费者
@@ -270,8 +704,40 @@ int main(int argc, char* argv[]) {
             [](EncodedStreamPtr stream) {
                 WsPreviewServer::StreamConsumer(stream, GetStreamManager()->GetWsPreviewServer());
             },
-            media::StreamConsumerType::AsyncIO);
-        LOG_INFO("WebSocket preview consumer registered");
+            media::StreamConsumerType::AsyncIO, 3,
+            media::QueueDropPolicy::DropToKeyframe, preview_stream);
+        LOG_INFO("WebSocket preview consumer registered ({} stream)",
+                 media::StreamSelectorToString(preview_stream));
+
+        // 新客户端先补发缓存的 GOP；没有缓存时请求 IDR，不必等满一个 GOP
+        // （按当前订阅的码流，负载调度可能已把预览切到子码流）
+        stream_mgr->GetWsPreviewServer()->OnKeyframeRequest([]() {
+            media::MediaManager::Instance().RequestKeyFrame(g_live_preview.load(), "ws_preview");
+        });
+        stream_mgr->GetWsPreviewServer()->OnGopSnapshotRequest([]() {
+            return media::MediaManager::Instance().GetGopSnapshot(g_live_preview.load());
+        });
+    }
+    
+    // 注册 LL-HLS 打包消费者（未激活时每帧只做一次判断）
+    if (stream_mgr->GetHlsPackager()) {
+        media_manager.RegisterStreamConsumer(
+            "hls",
+            [](EncodedStreamPtr stream) {
+                HlsPackager::StreamConsumer(stream, GetStreamManager()->GetHlsPackager());
+            },
+            media::StreamConsumerType::AsyncIO, 3,
+            media::QueueDropPolicy::DropToKeyframe, preview_stream);
+        LOG_INFO("HLS consumer registered ({} stream)",
+                 media::StreamSelectorToString(preview_stream));
+
+        // 激活时先用缓存的 GOP 补齐当前分段；没有缓存时请求 IDR
+        stream_mgr->GetHlsPackager()->OnKeyframeRequest([preview_stream]() {
+            media::MediaManager::Instance().RequestKeyFrame(preview_stream, "hls");
+        });
+        stream_mgr->GetHlsPackager()->OnGopSnapshotRequest([preview_stream]() {
+            return media::MediaManager::Instance().GetGopSnapshot(preview_stream);
+        });
     }
     
     // 注册文件保存消费者
@@ -281,8 +747,21 @@ int main(int argc, char* argv[]) {
             [](EncodedStreamPtr stream) {
                 FileService::StreamConsumer(stream, GetStreamManager()->GetFileService());
             },
-            media::StreamConsumerType::Queued, 10);
+            media::StreamConsumerType::Queued, 10,
+            media::QueueDropPolicy::DropToKeyframe);  // SD 卡卡顿时整段丢弃，保证 MP4 可解码
         LOG_INFO("File consumer registered");
+
+        // 开始录制时请求 IDR，MP4 无需等待下一个 GOP
+        stream_mgr->GetFileService()->OnKeyframeRequest([]() {
+            media::MediaManager::Instance().RequestKeyFrame(media::StreamSelector::kMain, "record");
+        });
+
+        // AI 检测命中事件规则时触发事件录制（持续命中时延长录制）
+        media_manager.DetectionEvents().SetTriggerCallback([](const std::string& reason) {
+            if (auto* fs = GetStreamManager()->GetFileService()) {
+                fs->TriggerEventRecording(reason);
+            }
+        });
     }
     
     // 注册 WebRTC 消费者
@@ -292,12 +771,72 @@ int main(int argc, char* argv[]) {
             [](EncodedStreamPtr stream) {
                 WebRTCService::StreamConsumer(stream, GetStreamManager()->GetWebRTCService());
             },
-            media::StreamConsumerType::AsyncIO);
-        LOG_INFO("WebRTC consumer registered");
+            media::StreamConsumerType::AsyncIO, 3,
+            media::QueueDropPolicy::DropToKeyframe, preview_stream);
+        LOG_INFO("WebRTC consumer registered ({} stream)",
+                 media::StreamSelectorToString(preview_stream));
+
+        // RTCP 反馈：目标码率下发到预览码流 VENC；PLI/FIR 与新观看者请求 IDR，
+        // 新观看者有缓存 GOP 时先补发
+        auto* webrtc_service = stream_mgr->GetWebRTCService();
+        webrtc_service->OnBitrateRequest([preview_stream](int kbps) {
+            media::MediaManager::Instance().SetStreamBitrate(preview_stream, kbps);
+        });
+        webrtc_service->OnKeyframeRequest([]() {
+            media::MediaManager::Instance().RequestKeyFrame(g_live_preview.load(), "webrtc");
+        });
+        webrtc_service->OnGopSnapshotRequest([]() {
+            return media::MediaManager::Instance().GetGopSnapshot(g_live_preview.load());
+        });
+    }
+
+    // 检测元数据：有订阅者时编码一次，投递到 WS 预览 / WebRTC 各自的 strand 发送
+    // （与视频帧同一 strand，元数据紧跟在同一时刻的画面之后）
+    if (stream_mgr->GetWsPreviewServer() || stream_mgr->GetWebRTCService()) {
+        media_manager.AddDetectionListener(
+            [](const rknn::DetectionResultList& results, int width, int height) {
+                auto* mgr = GetStreamManager();
+                if (!mgr) {
+                    return;
+                }
+                auto* ws = mgr->GetWsPreviewServer();
+                auto* webrtc = mgr->GetWebRTCService();
+                const bool to_ws = ws && ws->GetMetadataClientCount() > 0;
+                const bool to_webrtc = webrtc && webrtc->HasMetadataChannels();
+                if (!to_ws && !to_webrtc) {
+                    return;
+                }
+
+                auto message = std::make_shared<std::string>();
+                media::EncodeDetectionMetadata(results, width, height, message.get());
+                auto& io = IoContext::Instance();
+                if (to_ws) {
+                    io.PostTo(io.Strand("ws_preview"), [message]() {
+                        auto* mgr = GetStreamManager();
+                        if (auto* ws = mgr ? mgr->GetWsPreviewServer() : nullptr) {
+                            ws->SendMetadata(reinterpret_cast<const uint8_t*>(message->data()),
+                                             message->size());
+                        }
+                    });
+                }
+                if (to_webrtc) {
+                    io.PostTo(io.Strand("webrtc"), [message]() {
+                        auto* mgr = GetStreamManager();
+                        if (auto* webrtc = mgr ? mgr->GetWebRTCService() : nullptr) {
+                            webrtc->SendMetadata(*message);
+                        }
+                    });
+                }
+            });
     }
 
-    // 启动视频采集
-    if (!media_manager.Start()) {
+    // 启动视频采集（首帧到达分发器时打印启动时间线）
+    bool media_started = false;
+    {
+        media::StartupTimeline::Scope scope("media_start");
+        media_started = media_manager.Start();
+    }
+    if (!media_started) {
         LOG_ERROR("Failed to start MediaManager!");
         g_http_api->Stop();
         DestroyStreamManager();
@@ -305,7 +844,68 @@ int main(int argc, char* argv[]) {
     }
 
     // 启动流输出
-    GetStreamManager()->Start();
+    {
+        media::StartupTimeline::Scope scope("stream_start");
+        GetStreamManager()->Start();
+    }
+
+    // 负载调度：CPU / 温度 / 推理延迟 / 丢帧过载时按阶梯降级，余量恢复后逆序还原
+    auto& governor = LoadGovernor::Instance();
+    governor.Configure(governor_config);
+    const int governor_divisor = governor.GetConfig().inference_divisor;
+    const int governor_fps = governor.GetConfig().reduced_fps;
+    governor.AddRung(
+        "inference",
+        [governor_divisor]() {
+            // 非 AI 模式下只记录，切到 AI 模式后生效
+            return media::MediaManager::Instance().SetInferenceDivisor(governor_divisor) == 0;
+        },
+        []() { return media::MediaManager::Instance().SetInferenceDivisor(1) == 0; });
+    // 预览切子码流只对 WebSocket / WebRTC 生效：LL-HLS 的播放列表中途不能换分辨率
+    if (producer_config.sub_stream && preview_stream == media::StreamSelector::kMain) {
+        auto move_live_preview = [](media::StreamSelector stream) {
+            auto& mm = media::MediaManager::Instance();
+            g_live_preview = stream;
+            mm.SetConsumerStream("ws_preview", stream);
+            mm.SetConsumerStream("webrtc", stream);
+            mm.RequestKeyFrame(stream, "governor");
+        };
+        governor.AddRung(
+            "preview_sub",
+            [move_live_preview]() {
+                move_live_preview(media::StreamSelector::kSub);
+                return true;
+            },
+            [move_live_preview]() {
+                move_live_preview(media::StreamSelector::kMain);
+                return true;
+            });
+    }
+    if (GetStreamManager()->GetWsPreviewServer()) {
+        governor.AddRung(
+            "keyframes",
+            []() {
+                auto* ws = GetStreamManager()->GetWsPreviewServer();
+                if (!ws || ws->GetClientCount() == 0) {
+                    return false;   // 没有观看者时省不下什么，直接降下一级
+                }
+                ws->SetKeyframeOnly(true);
+                return true;
+            },
+            []() {
+                if (auto* ws = GetStreamManager()->GetWsPreviewServer()) {
+                    ws->SetKeyframeOnly(false);
+                }
+                return true;
+            });
+    }
+    governor.AddRung(
+        "fps",
+        [governor_fps]() {
+            return media::MediaManager::Instance().SetFrameRateLimit(governor_fps) == 0;
+        },
+        []() { return media::MediaManager::Instance().SetFrameRateLimit(0) == 0; });
+    governor.Start();
 
     // 打印启动信息
     print_startup_info(stream_config, http_config.port);
@@ -314,9 +914,10 @@ int main(int argc, char* argv[]) {
     // ========================================================================
     // 主事件循环 - 使用 asio 替代 sleep 循环
     // ========================================================================
-    LOG_INFO("Starting main IO event loop (optimized for single-core CPU)...");
+    // 主线程 + 其余 IO 线程共同运行事件循环，各分发服务在自己的 strand 上串行
+    IoContext::Instance().SetThreadCount(io_threads);
+    LOG_INFO("Starting main IO event loop ({} thread(s))...", IoContext::Instance().GetThreadCount());
     
-    // 在主线程运行 asio 事件循环
     IoContext::Instance().Run();
     
     // 事件循环退出后（收到信号）开始清理
@@ -326,6 +927,9 @@ int main(int argc, char* argv[]) {
     // ========================================================================
     LOG_INFO("Shutting down AIPC...");
     
+    // 0. 停止负载调度（撤销降级，之后不再改动消费者与编码参数）
+    LoadGovernor::Instance().Stop();
+    
     // 1. 先清除流消费者（防止继续 post 新帧到 IoContext）
     LOG_DEBUG("Clearing stream consumers...");
     media_manager.ClearStreamConsumers();
@@ -10,6 +10,7 @@
 
 #include "file_saver.h"
 #include "common/logger.h"
+#include "common/media_buffer.h"
 
 #include "rk_mpi_mb.h"
 #include "rk_mpi_vi.h"
@@ -18,19 +19,18 @@
 #include "rk_mpi_tde.h"
 #include "rk_mpi_cal.h"
 
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
 #include <ctime>
+#include <dirent.h>
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
 #include <chrono>
 #include <thread>
-
-// FFmpeg 头文件
-extern "C" {
-#include <libavformat/avformat.h>
-#include <libavcodec/avcodec.h>
-#include <libavutil/opt.h>
-#include <libavutil/timestamp.h>
-}
+#include <vector>
 
 // ============================================================================
 // 辅助函数
@@ -63,70 +63,21 @@ static bool EnsureDirectory(const std::string& dir) {
     return false;
 }
 
-/**
- * @brief 在 H.264 Annex B 流中查找 NAL 单元
- * @param data 数据指针
- * @param size 数据大小
- * @param start 输出：NAL 起始位置（不含 start code）
- * @param nal_size 输出：NAL 大小
- * @param offset 搜索起始偏移
- * @return 下一个 NAL 的搜索偏移，如果没有找到返回 size
- */
-static size_t FindNalUnit(const uint8_t* data, size_t size, 
-                          const uint8_t** start, size_t* nal_size, 
-                          size_t offset = 0) {
-    // 查找 start code (0x000001 或 0x00000001)
-    size_t i = offset;
-    while (i + 3 < size) {
-        if (data[i] == 0 && data[i + 1] == 0) {
-            if (data[i + 2] == 1) {
-                // 0x000001
-                *start = data + i + 3;
-                break;
-            } else if (data[i + 2] == 0 && i + 4 < size && data[i + 3] == 1) {
-                // 0x00000001
-                *start = data + i + 4;
-                break;
-            }
-        }
-        i++;
-    }
-    
-    if (i + 3 >= size) {
-        *start = nullptr;
-        *nal_size = 0;
-        return size;
-    }
-    
-    // 查找下一个 start code 来确定 NAL 大小
-    size_t nal_start = *start - data;
-    size_t j = nal_start;
-    while (j + 3 < size) {
-        if (data[j] == 0 && data[j + 1] == 0 && 
-            (data[j + 2] == 1 || (data[j + 2] == 0 && j + 4 < size && data[j + 3] == 1))) {
-            *nal_size = j - nal_start;
-            return j;
-        }
-        j++;
-    }
-    
-    // 到末尾
-    *nal_size = size - nal_start;
-    return size;
-}
-
 // ============================================================================
 // Mp4Recorder 实现
 // ============================================================================
 
 Mp4Recorder::Mp4Recorder(const Mp4RecordConfig& config)
-    : config_(config) {
+    : config_(config)
+    , io_metrics_(std::make_shared<RecordIoMetrics>())
+    , finalizer_(std::make_unique<SegmentFinalizer>()) {
     EnsureDirectory(config_.outputDir);
     LOG_INFO("Mp4Recorder created, output dir: {}", config_.outputDir);
 }
 
 Mp4Recorder::~Mp4Recorder() {
     StopRecording();
+    finalizer_.reset();  // 等待所有分段收尾完成
     LOG_INFO("Mp4Recorder destroyed");
 }
 
@@ -135,74 +86,37 @@ std::string Mp4Recorder::GenerateFilename() {
 }
 
 bool Mp4Recorder::CreateOutputFile(const std::string& filepath) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    AVFormatContext* ofmt_ctx = nullptr;
-    if (avformat_alloc_output_context2(&ofmt_ctx, nullptr, nullptr, filepath.c_str()) < 0) {
-        LOG_ERROR("Could not create output context for: {}", filepath);
-        return false;
-    }
-    
-    AVCodecID codec_id = (config_.codecType == 12) ? AV_CODEC_ID_HEVC : AV_CODEC_ID_H264;
-    const AVCodec* codec = avcodec_find_encoder(codec_id);
-    if (!codec) {
-        LOG_ERROR("Codec not found: {}", (config_.codecType == 12) ? "H.265" : "H.264");
-        avformat_free_context(ofmt_ctx);
-        return false;
-    }
-    
-    AVCodecContext* codec_ctx = avcodec_alloc_context3(codec);
-    if (!codec_ctx) {
-        LOG_ERROR("Failed to allocate codec context");
-        avformat_free_context(ofmt_ctx);
-        return false;
-    }
-    
-    codec_ctx->codec_id = codec_id;
-    codec_ctx->codec_type = AVMEDIA_TYPE_VIDEO;
-    codec_ctx->bit_rate = 3000000;
-    codec_ctx->width = config_.width;
-    codec_ctx->height = config_.height;
-    codec_ctx->time_base = AVRational{1, config_.fps};
-    codec_ctx->framerate = AVRational{config_.fps, 1};
-    codec_ctx->gop_size = config_.gopSize;
-    codec_ctx->max_b_frames = 0;
-    codec_ctx->pix_fmt = AV_PIX_FMT_NV12;
-    
-    AVStream* video_st = avformat_new_stream(ofmt_ctx, codec);
-    if (!video_st) {
-        LOG_ERROR("Failed to create video stream");
-        avcodec_free_context(&codec_ctx);
-        avformat_free_context(ofmt_ctx);
-        return false;
-    }
-    
-    if (avcodec_parameters_from_context(video_st->codecpar, codec_ctx) < 0) {
-        LOG_ERROR("Failed to copy codec parameters to stream");
-        avcodec_free_context(&codec_ctx);
-        avformat_free_context(ofmt_ctx);
+    Mp4MuxerConfig muxer_config;
+    muxer_config.codec = (config_.codecType == 12) ? media::VideoCodec::kH265
+                                                   : media::VideoCodec::kH264;
+    muxer_config.width = config_.width;
+    muxer_config.height = config_.height;
+    muxer_config.fps = config_.fps;
+    muxer_config.gopSize = config_.gopSize;
+    muxer_config.fragmented = config_.fragmented;
+    muxer_config.fragmentSync = config_.fragmentSync;
+    muxer_config.io.chunk_bytes = static_cast<size_t>(std::max(config_.ioChunkKb, 4)) * 1024;
+    muxer_config.io.buffers = config_.ioBuffers;
+    muxer_config.io.direct = config_.ioDirect;
+    int64_t prealloc = config_.preallocBytes > 0 ? config_.preallocBytes : config_.maxFileSizeBytes;
+    muxer_config.io.prealloc_bytes = static_cast<uint64_t>(std::max<int64_t>(prealloc, 0));
+    muxer_config.ioMetrics = io_metrics_;
+
+    auto muxer = CreateMp4Muxer(muxer_config);
+    if (!muxer->Open(filepath)) {
         return false;
     }
     
-    video_st->codecpar->codec_tag = 0;
-    video_st->time_base = AVRational{1, config_.fps};
+    // 不在这里写入 header，等待第一个关键帧确定参数集后再写
     
-    if (!(ofmt_ctx->oformat->flags & AVFMT_NOFILE)) {
-        if (avio_open(&ofmt_ctx->pb, filepath.c_str(), AVIO_FLAG_WRITE) < 0) {
-            LOG_ERROR("Could not open output file: {}", filepath);
-            avcodec_free_context(&codec_ctx);
-            avformat_free_context(ofmt_ctx);
-            return false;
-        }
-    }
-    
-    // 不在这里写入 header，等待第一个关键帧设置 extradata 后再写
-    
-    format_ctx_ = ofmt_ctx;
-    codec_ctx_ = codec_ctx;
+    std::lock_guard<std::mutex> lock(mutex_);
+    muxer_ = std::move(muxer);
     current_file_path_ = filepath;
     first_pts_ = 0;
-    stats_ = Stats{};
+    fragments_seen_ = 0;
+    stats_.segments++;
+    stats_.segment_bytes = 0;
+    stats_.segment_duration_sec = 0.0;
     header_written_ = false;  // 标记 header 尚未写入
     
     LOG_INFO("Created output file (waiting for keyframe): {}", filepath);
@@ -210,154 +124,208 @@ bool Mp4Recorder::CreateOutputFile(const std::string& filepath) {
 }
 
 void Mp4Recorder::CloseOutputFile() {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    if (format_ctx_) {
-        AVFormatContext* ofmt_ctx = static_cast<AVFormatContext*>(format_ctx_);
-        
-        // 只有在 header 已写入时才写 trailer
-        if (header_written_) {
-            av_write_trailer(ofmt_ctx);
+    auto segment = std::make_shared<Segment>();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!muxer_) {
+            return;
         }
-        
-        if (!(ofmt_ctx->oformat->flags & AVFMT_NOFILE)) {
-            avio_closep(&ofmt_ctx->pb);
+        segment->muxer = std::move(muxer_);
+        segment->path = current_file_path_;
+        segment->header_written = header_written_;
+        segment->bytes = stats_.segment_bytes;
+        segment->duration_sec = stats_.segment_duration_sec;
+        finalizing_paths_.push_back(segment->path);
+
+        current_file_path_.clear();
+        header_written_ = false;
+    }
+
+    // trailer 与 fsync 交给后台，写入线程立即返回
+    finalizer_->Submit([this, segment]() {
+        FinalizeSegment(*segment);
+        EnforceRetention();
+    });
+}
+
+void Mp4Recorder::FinalizeSegment(Segment& segment) {
+    auto start = std::chrono::steady_clock::now();
+
+    // 只有在 header 已写入时才写 trailer（Finish 内部判断）
+    if (segment.muxer) {
+        if (!segment.muxer->Finish() && segment.header_written) {
+            LOG_WARN("Failed to finalize output file: {}", segment.path);
         }
-        
-        avformat_free_context(ofmt_ctx);
-        format_ctx_ = nullptr;
+        segment.muxer.reset();
     }
-    
-    if (codec_ctx_) {
-        AVCodecContext* ctx = static_cast<AVCodecContext*>(codec_ctx_);
-        avcodec_free_context(&ctx);
-        codec_ctx_ = nullptr;
+
+    if (!segment.header_written) {
+        // 未等到关键帧的分段没有可播放内容
+        unlink(segment.path.c_str());
+        LOG_INFO("Removed empty output file: {}", segment.path);
+    } else if (config_.fsyncOnClose) {
+        int fd = open(segment.path.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            if (fsync(fd) != 0) {
+                LOG_WARN("fsync failed for {}: {}", segment.path, strerror(errno));
+            }
+            close(fd);
+        }
     }
-    
-    if (!current_file_path_.empty()) {
-        LOG_INFO("Closed output file: {}, {} frames, {:.2f} sec", 
-                 current_file_path_, stats_.frames_written, stats_.duration_sec);
-        current_file_path_.clear();
+
+    double elapsed_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        finalizing_paths_.erase(
+            std::remove(finalizing_paths_.begin(), finalizing_paths_.end(), segment.path),
+            finalizing_paths_.end());
+        stats_.segments_finalized++;
+        stats_.last_finalize_ms = elapsed_ms;
+        stats_.max_finalize_ms = std::max(stats_.max_finalize_ms, elapsed_ms);
+    }
+
+    if (segment.header_written) {
+        LOG_INFO("Closed output file: {}, {:.2f} sec, {} bytes, finalized in {:.0f} ms",
+                 segment.path, segment.duration_sec, segment.bytes, elapsed_ms);
     }
-    
-    extradata_set_ = false;
-    header_written_ = false;
 }
 
-bool Mp4Recorder::SetExtradataFromStream(const uint8_t* data, size_t size) {
-    // 从 H.264 Annex B 流中提取 SPS 和 PPS
-    // H.264 NAL 类型：7=SPS, 8=PPS
-    
-    const uint8_t* sps_data = nullptr;
-    const uint8_t* pps_data = nullptr;
-    size_t sps_size = 0;
-    size_t pps_size = 0;
-    
-    size_t offset = 0;
-    while (offset < size) {
-        const uint8_t* nal_start = nullptr;
-        size_t nal_size = 0;
-        offset = FindNalUnit(data, size, &nal_start, &nal_size, offset);
-        
-        if (!nal_start || nal_size == 0) {
-            break;
-        }
-        
-        uint8_t nal_type = nal_start[0] & 0x1F;
-        
-        if (nal_type == 7 && !sps_data) {  // SPS
-            sps_data = nal_start;
-            sps_size = nal_size;
-            LOG_DEBUG("Found SPS: {} bytes", sps_size);
-        } else if (nal_type == 8 && !pps_data) {  // PPS
-            pps_data = nal_start;
-            pps_size = nal_size;
-            LOG_DEBUG("Found PPS: {} bytes", pps_size);
+// ============================================================================
+// 保留策略
+// ============================================================================
+
+void Mp4Recorder::EnforceRetention() {
+    if (config_.retentionMaxUsagePct <= 0 && config_.retentionMaxBytes <= 0) {
+        return;
+    }
+
+    struct Entry {
+        std::string path;
+        time_t mtime;
+        uint64_t size;
+    };
+    std::vector<Entry> files;
+    uint64_t total_bytes = 0;
+
+    DIR* dir = opendir(config_.outputDir.c_str());
+    if (!dir) {
+        LOG_WARN("Retention: cannot open {}", config_.outputDir);
+        return;
+    }
+    while (struct dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.size() < 4 || name.compare(name.size() - 4, 4, ".mp4") != 0) {
+            continue;
         }
-        
-        if (sps_data && pps_data) {
-            break;
+        std::string path = config_.outputDir + "/" + name;
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+            continue;
         }
+        files.push_back({path, st.st_mtime, static_cast<uint64_t>(st.st_size)});
+        total_bytes += static_cast<uint64_t>(st.st_size);
     }
-    
-    if (!sps_data || !pps_data) {
-        LOG_WARN("SPS or PPS not found in stream");
+    closedir(dir);
+
+    std::sort(files.begin(), files.end(), [](const Entry& a, const Entry& b) {
+        return a.mtime != b.mtime ? a.mtime < b.mtime : a.path < b.path;
+    });
+
+    auto over_limit = [&]() {
+        if (config_.retentionMaxBytes > 0 &&
+            total_bytes > static_cast<uint64_t>(config_.retentionMaxBytes)) {
+            return true;
+        }
+        if (config_.retentionMaxUsagePct > 0) {
+            struct statvfs vfs;
+            if (statvfs(config_.outputDir.c_str(), &vfs) == 0 && vfs.f_blocks > 0) {
+                // 与 df 一致：used / (used + 普通用户可用)
+                uint64_t used = static_cast<uint64_t>(vfs.f_blocks - vfs.f_bfree);
+                uint64_t avail = static_cast<uint64_t>(vfs.f_bavail);
+                if (used + avail > 0 &&
+                    used * 100 > static_cast<uint64_t>(config_.retentionMaxUsagePct) *
+                                     (used + avail)) {
+                    return true;
+                }
+            }
+        }
         return false;
+    };
+
+    // 正在写入 / 等待收尾的分段不参与删除
+    std::vector<std::string> busy;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        busy = finalizing_paths_;
+        busy.push_back(current_file_path_);
     }
-    
-    // 构造 AVCC 格式的 extradata
-    // AVCC 格式：
-    // 1 byte: version (1)
-    // 1 byte: profile
-    // 1 byte: compatibility
-    // 1 byte: level
-    // 1 byte: 0xFC | (lengthSizeMinusOne & 0x03)  -> 通常是 0xFF (4字节长度)
-    // 1 byte: 0xE0 | numSPS  -> 通常是 0xE1 (1个SPS)
-    // 2 bytes: SPS length (big endian)
-    // SPS data
-    // 1 byte: numPPS -> 通常是 0x01
-    // 2 bytes: PPS length (big endian)
-    // PPS data
-    
-    size_t extradata_size = 6 + 2 + sps_size + 1 + 2 + pps_size;
-    uint8_t* extradata = static_cast<uint8_t*>(av_malloc(extradata_size + AV_INPUT_BUFFER_PADDING_SIZE));
-    if (!extradata) {
-        LOG_ERROR("Failed to allocate extradata");
-        return false;
+
+    uint64_t deleted_files = 0;
+    uint64_t deleted_bytes = 0;
+    for (const auto& file : files) {
+        if (!over_limit()) {
+            break;
+        }
+        if (std::find(busy.begin(), busy.end(), file.path) != busy.end()) {
+            continue;
+        }
+        if (unlink(file.path.c_str()) != 0) {
+            LOG_WARN("Retention: failed to delete {}: {}", file.path, strerror(errno));
+            continue;
+        }
+        total_bytes -= file.size;
+        deleted_files++;
+        deleted_bytes += file.size;
+        LOG_INFO("Retention: deleted {} ({} bytes)", file.path, file.size);
     }
-    memset(extradata, 0, extradata_size + AV_INPUT_BUFFER_PADDING_SIZE);
-    
-    uint8_t* p = extradata;
-    *p++ = 1;                          // version
-    *p++ = sps_data[1];                // profile
-    *p++ = sps_data[2];                // compatibility
-    *p++ = sps_data[3];                // level
-    *p++ = 0xFF;                       // 4 bytes NAL length
-    *p++ = 0xE1;                       // 1 SPS
-    *p++ = (sps_size >> 8) & 0xFF;     // SPS length high byte
-    *p++ = sps_size & 0xFF;            // SPS length low byte
-    memcpy(p, sps_data, sps_size);
-    p += sps_size;
-    *p++ = 1;                          // 1 PPS
-    *p++ = (pps_size >> 8) & 0xFF;     // PPS length high byte
-    *p++ = pps_size & 0xFF;            // PPS length low byte
-    memcpy(p, pps_data, pps_size);
-    
-    // 设置到 codecpar
-    AVFormatContext* ofmt_ctx = static_cast<AVFormatContext*>(format_ctx_);
-    AVStream* video_stream = ofmt_ctx->streams[0];
-    
-    // 释放旧的 extradata（如果有）
-    if (video_stream->codecpar->extradata) {
-        av_free(video_stream->codecpar->extradata);
+
+    if (deleted_files > 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.retention_deleted_files += deleted_files;
+        stats_.retention_deleted_bytes += deleted_bytes;
+    }
+    if (over_limit()) {
+        LOG_WARN("Retention: still over limit after deleting {} files", deleted_files);
     }
-    
-    video_stream->codecpar->extradata = extradata;
-    video_stream->codecpar->extradata_size = extradata_size;
-    
-    LOG_INFO("Set H.264 extradata: SPS={} bytes, PPS={} bytes", sps_size, pps_size);
-    return true;
 }
 
 bool Mp4Recorder::StartRecording(const std::string& filename) {
+    std::lock_guard<std::mutex> control(control_mutex_);
     if (state_ != RecordState::kIdle) {
         LOG_WARN("Recording already in progress");
         return false;
     }
     
-    std::string fname = filename.empty() ? GenerateFilename() : filename;
-    std::string filepath = config_.outputDir + "/" + fname + ".mp4";
+    base_name_ = filename;
+    segment_index_ = 0;
+    record_started_ = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // 累计的收尾 / 保留策略统计跨录制保留
+        stats_.frames_written = 0;
+        stats_.bytes_written = 0;
+        stats_.duration_sec = 0.0;
+        stats_.segments = 0;
+        stats_.fragments = 0;
+    }
     
+    std::string filepath = NextSegmentPath();
     if (!CreateOutputFile(filepath)) {
         return false;
     }
     
+    // 开始写入前先按保留策略腾出空间
+    finalizer_->Submit([this]() { EnforceRetention(); });
+    
     state_ = RecordState::kRecording;
     LOG_INFO("Started recording to: {}", filepath);
     return true;
 }
 
 void Mp4Recorder::StopRecording() {
+    // 与写入线程上的分段切换互斥：切换完成后再关闭新分段，不会留下无人收尾的文件
+    std::lock_guard<std::mutex> control(control_mutex_);
     if (state_ != RecordState::kRecording) {
         return;
     }
@@ -369,91 +337,183 @@ void Mp4Recorder::StopRecording() {
     LOG_INFO("Stopped recording");
 }
 
+std::string Mp4Recorder::GetCurrentFilePath() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return current_file_path_;
+}
+
+Mp4Recorder::Stats Mp4Recorder::GetStats() const {
+    Stats stats;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats = stats_;
+    }
+    stats.finalize_pending = finalizer_->Pending();
+    stats.io = io_metrics_->Snapshot();
+    return stats;
+}
+
+// ============================================================================
+// 分段
+// ============================================================================
+
+std::string Mp4Recorder::NextSegmentPath() {
+    std::string name = base_name_.empty() ? GenerateFilename() : base_name_;
+    if (!base_name_.empty() && segment_index_ > 0) {
+        name += "_" + std::to_string(segment_index_);
+    }
+    segment_index_++;
+    
+    // 按大小分段时同一秒内可能切换多次，避免覆盖已有文件
+    std::string path = config_.outputDir + "/" + name + ".mp4";
+    struct stat st;
+    for (int n = 1; stat(path.c_str(), &st) == 0; n++) {
+        path = config_.outputDir + "/" + name + "_" + std::to_string(n) + ".mp4";
+    }
+    return path;
+}
+
+bool Mp4Recorder::ShouldRotateLocked(uint64_t pts) const {
+    if (!header_written_) {
+        return false;
+    }
+    if (config_.segmentDurationSec > 0 &&
+        pts - first_pts_ >= static_cast<uint64_t>(config_.segmentDurationSec) * 1000000ULL) {
+        return true;
+    }
+    return config_.maxFileSizeBytes > 0 &&
+           stats_.segment_bytes >= static_cast<uint64_t>(config_.maxFileSizeBytes);
+}
+
+bool Mp4Recorder::RotateSegment() {
+    std::lock_guard<std::mutex> control(control_mutex_);
+    if (state_ != RecordState::kRecording) {
+        return true;    // 判断之后已停止录制：分段已由 StopRecording 收尾
+    }
+    std::string next = NextSegmentPath();
+    CloseOutputFile();
+    if (!CreateOutputFile(next)) {
+        LOG_ERROR("Failed to open next segment: {}", next);
+        state_ = RecordState::kIdle;
+        return false;
+    }
+    LOG_INFO("Rotated to segment {}: {}", segment_index_, next);
+    return true;
+}
+
 bool Mp4Recorder::WriteFrame(const EncodedStreamPtr& stream) {
     if (state_ != RecordState::kRecording || !stream || !stream->pstPack) {
         return false;
     }
     
-    void* data = RK_MPI_MB_Handle2VirAddr(stream->pstPack->pMbBlk);
+    void* data = get_stream_vir_addr(stream);
     if (!data || stream->pstPack->u32Len == 0) {
         LOG_WARN("Invalid frame data");
         return false;
     }
     
-    bool is_keyframe = (stream->pstPack->DataType.enH264EType == H264E_NALU_IDRSLICE ||
-                        stream->pstPack->DataType.enH264EType == H264E_NALU_ISLICE ||
-                        stream->pstPack->DataType.enH265EType == H265E_NALU_IDRSLICE ||
-                        stream->pstPack->DataType.enH265EType == H265E_NALU_ISLICE);
+    // NAL 索引由分发器建立；直接调用时在本地解析一次
+    const media::NalIndex* nal = get_stream_nal_index(stream);
+    media::NalIndex local;
+    if (!nal) {
+        media::build_nal_index(static_cast<const uint8_t*>(data), stream->pstPack->u32Len,
+                               config_.codecType == 12 ? media::VideoCodec::kH265
+                                                       : media::VideoCodec::kH264,
+                               &local);
+        local.is_keyframe = local.is_keyframe || is_stream_keyframe(stream);
+        nal = &local;
+    }
+    return WriteFrameData(static_cast<const uint8_t*>(data), stream->pstPack->u32Len,
+                          stream->pstPack->u64PTS, *nal);
+}
+
+bool Mp4Recorder::WriteFrameData(const uint8_t* data, size_t len, uint64_t pts,
+                                 const media::NalIndex& nal) {
+    if (state_ != RecordState::kRecording || !data || len == 0) {
+        return false;
+    }
+    bool is_keyframe = nal.is_keyframe;
     
-    // 等待第一个关键帧，从中提取 SPS/PPS 并写入 header
-    if (!header_written_) {
-        if (!is_keyframe) {
-            // 跳过非关键帧，等待关键帧
-            LOG_DEBUG("Waiting for keyframe to start recording...");
-            return true;
+    // 分段切换只在关键帧上进行，新分段从本帧开始
+    if (is_keyframe) {
+        bool rotate = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            rotate = ShouldRotateLocked(pts);
+        }
+        if (rotate && !RotateSegment()) {
+            return false;
         }
+    }
+    
+    bool reached_max = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
         
-        // 从关键帧中提取 SPS/PPS 设置 extradata
-        if (!SetExtradataFromStream(static_cast<uint8_t*>(data), stream->pstPack->u32Len)) {
-            LOG_ERROR("Failed to extract SPS/PPS from keyframe");
+        if (!muxer_) {
             return false;
         }
-        extradata_set_ = true;
         
-        // 现在写入 header
-        AVFormatContext* ofmt_ctx = static_cast<AVFormatContext*>(format_ctx_);
-        if (avformat_write_header(ofmt_ctx, nullptr) < 0) {
-            LOG_ERROR("Error writing header");
+        // 等待第一个关键帧，从中提取 SPS/PPS 并写入 header
+        if (!header_written_) {
+            if (!is_keyframe) {
+                // 跳过非关键帧，等待关键帧
+                LOG_DEBUG("Waiting for keyframe to start recording...");
+                return true;
+            }
+            
+            // 优先使用分发器缓存的参数集，其次取本帧携带的 VPS/SPS/PPS
+            media::ParameterSetsPtr params = nal.params;
+            if (!params || !params->IsComplete()) {
+                params = media::update_parameter_sets(data, nal, nullptr);
+            }
+            if (!params || !params->IsComplete()) {
+                LOG_ERROR("Failed to extract parameter sets from keyframe");
+                return false;
+            }
+            
+            // 写入 header（参数集写入 avcC / hvcC）
+            if (!muxer_->WriteHeader(*params)) {
+                LOG_ERROR("Error writing header");
+                return false;
+            }
+            header_written_ = true;
+            first_pts_ = pts;
+            if (!record_started_) {
+                record_first_pts_ = pts;
+                record_started_ = true;
+            }
+            LOG_INFO("Header written, recording started from keyframe");
+        }
+        
+        // 每个分段的时间戳从 0 开始
+        uint64_t relative_pts = pts - first_pts_;
+        
+        if (!muxer_->WriteSample(data, len, nal, relative_pts)) {
+            LOG_ERROR("Error writing frame");
             return false;
         }
-        header_written_ = true;
-        first_pts_ = stream->pstPack->u64PTS;
-        LOG_INFO("Header written, recording started from keyframe");
-    }
-    
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    if (!format_ctx_) {
-        return false;
-    }
-    
-    AVFormatContext* ofmt_ctx = static_cast<AVFormatContext*>(format_ctx_);
-    AVStream* video_stream = ofmt_ctx->streams[0];
-    
-    int flags = 0;
-    if (is_keyframe) {
-        flags |= AV_PKT_FLAG_KEY;
-    }
-    
-    uint64_t relative_pts = (stream->pstPack->u64PTS - first_pts_) / 1000;
-    
-    AVPacket packet = {};
-    packet.data = static_cast<uint8_t*>(data);
-    packet.size = stream->pstPack->u32Len;
-    packet.pts = av_rescale_q(relative_pts, AVRational{1, 1000}, video_stream->time_base);
-    packet.dts = packet.pts;
-    packet.stream_index = video_stream->index;
-    packet.duration = av_rescale_q(1, AVRational{1, config_.fps}, video_stream->time_base);
-    packet.flags = flags;
-    
-    int ret = av_interleaved_write_frame(ofmt_ctx, &packet);
-    if (ret < 0) {
-        char errbuf[128];
-        av_strerror(ret, errbuf, sizeof(errbuf));
-        LOG_ERROR("Error writing frame: {}", errbuf);
-        return false;
+        
+        // fMP4：封装器在 fragment 写出后立即提交写盘（fragmentSync 时在写盘线程 fdatasync）；
+        // 掉电时文件停在最后一个完整 fragment，仍可播放
+        uint64_t fragments = muxer_->Fragments();
+        stats_.fragments += fragments - fragments_seen_;
+        fragments_seen_ = fragments;
+        
+        stats_.frames_written++;
+        stats_.bytes_written += len;
+        stats_.duration_sec = static_cast<double>(pts - record_first_pts_) / 1e6;
+        stats_.segment_bytes += len;
+        stats_.segment_duration_sec = static_cast<double>(relative_pts) / 1e6;
+        
+        reached_max = config_.maxDurationSec > 0 && stats_.duration_sec >= config_.maxDurationSec;
     }
     
-    stats_.frames_written++;
-    stats_.bytes_written += stream->pstPack->u32Len;
-    stats_.duration_sec = static_cast<double>(relative_pts) / 1000.0;
-    
-    // 检查限制
-    if (config_.maxDurationSec > 0 && stats_.duration_sec >= config_.maxDurationSec) {
+    // 收尾在后台进行，可以直接在写入线程停止
+    if (reached_max) {
         LOG_INFO("Max duration reached, stopping recording");
-        // 注意：这里不能直接调用 StopRecording，因为会死锁
-        // 应该在外部线程处理
+        StopRecording();
     }
     
     return true;
-}
\ No newline at end of file
+}
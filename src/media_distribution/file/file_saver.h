@@ -7,6 +7,12 @@
  * - 析构函数完成清理
  * - 无需额外的 init/deinit 调用
  *
+ * 分段录制：按时长或文件大小在关键帧处切换到新文件，旧分段的 trailer、fsync
+ * 由 SegmentFinalizer 在后台完成，写入线程不等待；录像目录超出保留策略时删除最旧的文件。
+ *
+ * fMP4 模式（fragmented）：文件以空 moov 开头，每个 GOP 写出一个 moof + mdat，
+ * 收尾时无需回写整个 moov；掉电后文件截止到最后一个完整 fragment 仍可播放。
+ *
  * @author 好软，好温暖
  * @date 2026-01-31
  */
@@ -17,10 +23,15 @@
 #include <atomic>
 #include <memory>
 #include <mutex>
+#include <vector>
 
 // RKMPI 头文件
 #include "rk_mpi_venc.h"
 
+#include "common/nal_index.h"
+#include "file/mp4_muxer.h"
+#include "file/segment_finalizer.h"
+
 // 前向声明
 using EncodedStreamPtr = std::shared_ptr<VENC_STREAM_S>;
 
@@ -39,8 +50,18 @@ struct Mp4RecordConfig {
     int fps = 30;                         ///< 帧率
     int gopSize = 60;                     ///< GOP 大小
     int codecType = 8;                    ///< 编码类型：8=H.264, 12=H.265
-    int maxDurationSec = 0;               ///< 最大录制时长（秒），0表示无限制
-    int64_t maxFileSizeBytes = 0;         ///< 最大文件大小（字节），0表示无限制
+    int maxDurationSec = 0;               ///< 最大录制时长（秒，到达后停止录制），0表示无限制
+    int segmentDurationSec = 0;           ///< 分段时长（秒，到达后在关键帧处切换文件），0表示不分段
+    int64_t maxFileSizeBytes = 0;         ///< 单个文件大小上限（字节，到达后在关键帧处切换文件），0表示无限制
+    int retentionMaxUsagePct = 0;         ///< 磁盘使用率上限（%，超出时删除最旧的录像），0表示关闭
+    int64_t retentionMaxBytes = 0;        ///< 录像目录 .mp4 总大小上限（字节），0表示无限制
+    bool fsyncOnClose = true;             ///< 分段收尾时 fsync，掉电不丢已完成的分段
+    bool fragmented = false;              ///< fMP4：每个 GOP 写出一个 moof/mdat，掉电不丢已写出的 GOP
+    bool fragmentSync = true;             ///< fMP4 下每个 fragment 写出后在写盘线程 fdatasync
+    int ioChunkKb = 512;                  ///< 录制写盘块大小（KB，建议接近 SD 卡擦除块）
+    int ioBuffers = 3;                    ///< 录制写盘缓冲数
+    bool ioDirect = false;                ///< 使用 O_DIRECT 绕过页缓存
+    int64_t preallocBytes = 0;            ///< 每个文件 fallocate 预分配（字节），0 表示按 maxFileSizeBytes
 };
 
 /**
@@ -59,7 +80,7 @@ enum class RecordState {
 /**
  * @brief MP4 视频录制器
  * 
- * 使用 FFmpeg 将 H.264/H.265 编码流封装为 MP4 文件
+ * 将 H.264/H.265 编码流封装为 MP4 / fMP4 文件（封装器后端见 mp4_muxer.h）
  * RAII 设计：构造即可用，析构自动清理
  */
 class Mp4Recorder {
@@ -95,6 +116,17 @@ public:
      */
     bool WriteFrame(const EncodedStreamPtr& stream);
 
+    /**
+     * @brief 写入一帧裸数据（预录缓冲回放时使用，数据无需包装为 EncodedStreamPtr）
+     * @param data Annex-B 帧数据
+     * @param len 数据长度
+     * @param pts 采集时间戳（微秒，与 VENC u64PTS 同一时基）
+     * @param nal 帧的 NAL 索引
+     * @return true 成功，false 失败
+     */
+    bool WriteFrameData(const uint8_t* data, size_t len, uint64_t pts,
+                        const media::NalIndex& nal);
+
     /**
      * @brief 获取当前录制状态
      */
@@ -106,9 +138,9 @@ public:
     bool IsRecording() const { return state_ == RecordState::kRecording; }
 
     /**
-     * @brief 获取当前录制文件路径
+     * @brief 获取当前录制文件路径（分段录制时为正在写入的分段）
      */
-    std::string GetCurrentFilePath() const { return current_file_path_; }
+    std::string GetCurrentFilePath() const;
 
     /**
      * @brief 录制统计信息
@@ -117,25 +149,63 @@ public:
         uint64_t frames_written = 0;    ///< 已写入帧数
         uint64_t bytes_written = 0;     ///< 已写入字节数
         double duration_sec = 0.0;      ///< 录制时长（秒）
+        uint64_t segments = 0;          ///< 本次录制已创建的分段文件数
+        double segment_duration_sec = 0.0;  ///< 当前分段时长（秒）
+        uint64_t segment_bytes = 0;     ///< 当前分段已写入字节数
+        uint64_t fragments = 0;         ///< 本次录制已写出的 fragment 数（fMP4）
+        size_t finalize_pending = 0;    ///< 等待后台收尾的分段数
+        uint64_t segments_finalized = 0;    ///< 累计完成收尾的分段数
+        double last_finalize_ms = 0.0;  ///< 最近一次收尾耗时（trailer + close + fsync）
+        double max_finalize_ms = 0.0;   ///< 最大收尾耗时
+        uint64_t retention_deleted_files = 0;   ///< 保留策略累计删除的文件数
+        uint64_t retention_deleted_bytes = 0;   ///< 保留策略累计删除的字节数
+        RecordIoStats io;               ///< 写盘统计与延迟直方图（跨录制累计）
     };
-    Stats GetStats() const { return stats_; }
+    Stats GetStats() const;
 
 private:
+    /// 已脱离写入线程、等待收尾的分段
+    struct Segment {
+        std::unique_ptr<Mp4Muxer> muxer;
+        std::string path;
+        bool header_written = false;
+        uint64_t bytes = 0;
+        double duration_sec = 0.0;
+    };
+
     bool CreateOutputFile(const std::string& filepath);
+    /// 脱离当前分段并交给后台收尾（不等待 trailer 写完）
     void CloseOutputFile();
+    /// 关键帧处切换到新分段（期间已停止录制时不再创建新分段）
+    bool RotateSegment();
+    bool ShouldRotateLocked(uint64_t pts) const;
+    std::string NextSegmentPath();
     std::string GenerateFilename();
-    bool SetExtradataFromStream(const uint8_t* data, size_t size);
+
+    // 以下在收尾线程执行
+    void FinalizeSegment(Segment& segment);
+    void EnforceRetention();
 
     Mp4RecordConfig config_;
     std::atomic<RecordState> state_{RecordState::kIdle};
     std::string current_file_path_;
     Stats stats_;
-    uint64_t first_pts_ = 0;
-    bool extradata_set_ = false;   // 标记是否已设置 SPS/PPS
+    uint64_t first_pts_ = 0;           // 当前分段首帧 PTS
+    uint64_t record_first_pts_ = 0;    // 本次录制首帧 PTS
+    bool record_started_ = false;      // 本次录制是否已写入首帧
+    std::string base_name_;            // StartRecording 指定的文件名（空 = 时间戳命名，control_mutex_）
+    int segment_index_ = 0;            // 下一个分段序号（control_mutex_）
+    std::vector<std::string> finalizing_paths_;    // 等待收尾的分段（保留策略不删除）
     bool header_written_ = false;  // 标记是否已写入 header
-    std::mutex mutex_;
+    uint64_t fragments_seen_ = 0;  // 当前分段已计入统计的 fragment 数
+    mutable std::mutex mutex_;
+    // 串行化开始 / 停止录制与分段切换（先于 mutex_ 获取）：停止等待进行中的切换完成，
+    // 切换在持有期间确认仍在录制才创建下一个分段
+    std::mutex control_mutex_;
+
+    std::unique_ptr<Mp4Muxer> muxer_;  // 当前分段的封装器
+    std::shared_ptr<RecordIoMetrics> io_metrics_;  // 所有分段共享的写盘统计
 
-    // FFmpeg 上下文（使用 void* 避免头文件依赖）
-    void* format_ctx_ = nullptr;
-    void* codec_ctx_ = nullptr;
+    // 声明在最后：析构时最先销毁，收尾完所有分段后才释放其余成员
+    std::unique_ptr<SegmentFinalizer> finalizer_;
 };
\ No newline at end of file
@@ -10,6 +10,9 @@
 
 #include "file_service.h"
 #include "common/logger.h"
+#include "common/media_buffer.h"
+
+#include <algorithm>
 
 // ============================================================================
 // FileService 实现
@@ -21,6 +24,15 @@ FileService::FileService(const FileServiceConfig& config)
     // 创建 MP4 录制器
     mp4_recorder_ = std::make_unique<Mp4Recorder>(config_.mp4Config);
     
+    // 预录 arena 在此一次性分配，运行期不再申请内存
+    const PrerecordConfig& pre = config_.prerecord;
+    if (pre.pre_seconds > 0 && pre.buffer_kb > 0) {
+        prerecord_ = std::make_unique<PrerecordBuffer>(
+            static_cast<size_t>(pre.buffer_kb) * 1024, pre.pre_seconds,
+            config_.mp4Config.codecType == 12 ? media::VideoCodec::kH265
+                                              : media::VideoCodec::kH264);
+    }
+    
     LOG_INFO("FileService created");
 }
 
@@ -47,6 +59,8 @@ void FileService::Stop() {
     LOG_INFO("Stopping FileService...");
     
     // 停止录制
+    event_pending_ = false;
+    event_active_ = false;
     if (mp4_recorder_ && mp4_recorder_->IsRecording()) {
         mp4_recorder_->StopRecording();
     }
@@ -65,10 +79,25 @@ bool FileService::StartRecording(const std::string& filename) {
         return false;
     }
     
-    return mp4_recorder_->StartRecording(filename);
+    // 事件录制进行中：转为手动录制，不再按 post_seconds 自动停止
+    if (event_active_.exchange(false) && mp4_recorder_->IsRecording()) {
+        LOG_INFO("Event recording taken over as manual recording");
+        return true;
+    }
+    
+    if (!mp4_recorder_->StartRecording(filename)) {
+        return false;
+    }
+    
+    // 录制器丢弃首个关键帧之前的帧，主动请求 IDR 缩短起录时间
+    if (keyframe_callback_) {
+        keyframe_callback_();
+    }
+    return true;
 }
 
 void FileService::StopRecording() {
+    event_active_ = false;
     if (mp4_recorder_) {
         mp4_recorder_->StopRecording();
     }
@@ -92,15 +121,152 @@ Mp4Recorder::Stats FileService::GetRecordStats() const {
     return {};
 }
 
+// ============================================================================
+// 事件录制
+// ============================================================================
+
+bool FileService::TriggerEventRecording(const std::string& reason) {
+    if (!mp4_recorder_) {
+        return false;
+    }
+    event_triggers_++;
+    event_pending_ = true;
+    LOG_DEBUG("Event recording triggered: {}", reason);
+    return true;
+}
+
+EventRecordStats FileService::GetEventStats() const {
+    EventRecordStats s;
+    s.active = event_active_;
+    s.triggers = event_triggers_;
+    s.recordings = event_recordings_;
+    s.prerecord_frames = prerecord_frames_;
+    s.prerecord_gaps = prerecord_gaps_;
+    std::lock_guard<std::mutex> lock(prerecord_mutex_);
+    if (prerecord_) {
+        s.buffer = prerecord_->GetStats();
+    }
+    return s;
+}
+
+void FileService::BeginEventRecording(uint64_t pts) {
+    uint64_t post_us = static_cast<uint64_t>(std::max(config_.prerecord.post_seconds, 0)) *
+                       1000000ULL;
+
+    if (mp4_recorder_->IsRecording()) {
+        // 事件录制中再次触发：延长录制；手动录制不接管
+        if (event_active_) {
+            event_end_pts_ = std::max(event_end_pts_, pts + post_us);
+        }
+        return;
+    }
+
+    if (!mp4_recorder_->StartRecording()) {
+        return;
+    }
+    event_active_ = true;
+    event_end_pts_ = pts + post_us;
+    event_recordings_++;
+
+    PrerecordStats buffered;
+    {
+        std::lock_guard<std::mutex> lock(prerecord_mutex_);
+        replaying_ = prerecord_ && !prerecord_->Empty();
+        if (replaying_) {
+            replay_seq_ = prerecord_->OldestSeq();
+            buffered = prerecord_->GetStats();
+        }
+    }
+
+    if (replaying_) {
+        LOG_INFO("Event recording started with {:.1f}s prerecord ({} frames)",
+                 buffered.duration_sec, buffered.frames);
+    } else {
+        // 没有可用的预录帧，录制器会等待下一个关键帧
+        LOG_INFO("Event recording started without prerecord");
+        if (keyframe_callback_) {
+            keyframe_callback_();
+        }
+    }
+}
+
+void FileService::ReplayPrerecord() {
+    std::lock_guard<std::mutex> lock(prerecord_mutex_);
+    if (replay_seq_ < prerecord_->OldestSeq()) {
+        // 回放落后于淘汰：跳到缓存中最旧的关键帧继续
+        LOG_WARN("Prerecord replay fell behind, skipped {} frames",
+                 prerecord_->OldestSeq() - replay_seq_);
+        replay_seq_ = prerecord_->OldestSeq();
+        prerecord_gaps_++;
+    }
+
+    PrerecordBuffer::Frame frame;
+    for (int i = 0; i < kReplayFramesPerTick && prerecord_->Read(replay_seq_, &frame); ++i) {
+        mp4_recorder_->WriteFrameData(frame.data, frame.size, frame.pts, *frame.nal);
+        replay_seq_++;
+        prerecord_frames_++;
+    }
+
+    if (replay_seq_ >= prerecord_->NextSeq()) {
+        replaying_ = false;
+        LOG_DEBUG("Prerecord replay caught up with live stream");
+    }
+}
+
+void FileService::CheckEventDeadline(uint64_t pts) {
+    if (!event_active_ || replaying_ || pts < event_end_pts_) {
+        return;
+    }
+    event_active_ = false;
+    mp4_recorder_->StopRecording();
+    LOG_INFO("Event recording finished ({}s after last trigger)", config_.prerecord.post_seconds);
+}
+
 // ============================================================================
 // 流消费者接口
 // ============================================================================
 
 void FileService::OnEncodedStream(const EncodedStreamPtr& stream) {
-    // 如果正在录制，写入帧
-    if (mp4_recorder_ && mp4_recorder_->IsRecording()) {
+    if (!mp4_recorder_) {
+        return;
+    }
+    uint64_t pts = get_stream_pts(stream);
+
+    // 预录缓冲持续保存最近的画面（与是否正在录制无关）
+    bool buffered = false;
+    if (prerecord_) {
+        std::lock_guard<std::mutex> lock(prerecord_mutex_);
+        buffered = prerecord_->Push(stream);
+    }
+
+    if (event_pending_.exchange(false)) {
+        BeginEventRecording(pts);
+    }
+
+    if (!mp4_recorder_->IsRecording()) {
+        replaying_ = false;
+        event_active_ = false;
+        return;
+    }
+
+    if (replaying_ && !buffered) {
+        // 本帧未进入缓存（帧过大导致缓存清空），放弃剩余预录帧，直接衔接实时帧
+        replaying_ = false;
+        prerecord_gaps_++;
+    }
+
+    // 回放期间实时帧已在缓存末尾，由回放按序写入
+    if (replaying_) {
+        ReplayPrerecord();
+    } else {
         mp4_recorder_->WriteFrame(stream);
     }
+
+    CheckEventDeadline(pts);
+}
+
+void FileService::OnKeyframeRequest(KeyframeRequestCallback callback) {
+    keyframe_callback_ = std::move(callback);
 }
 
 void FileService::StreamConsumer(EncodedStreamPtr stream, void* user_data) {
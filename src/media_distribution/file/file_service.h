@@ -4,6 +4,7 @@
  *
  * 独立的服务模块，负责：
  * - MP4 视频录制的启停控制
+ * - 事件触发录制：预录缓冲中事件前 pre_seconds 的画面 + 最后一次触发后 post_seconds
  * - 预留控制接口供 WebSocket/HTTP API 调用
  *
  * 作为视频编码流的消费者之一，使用 Queued 模式处理，
@@ -18,10 +19,12 @@
 #include <string>
 #include <memory>
 #include <atomic>
+#include <mutex>
 #include <thread>
 #include <functional>
 
 #include "file/file_saver.h"
+#include "file/prerecord_buffer.h"
 
 // ============================================================================
 // 文件保存服务配置
@@ -29,6 +32,19 @@
 
 struct FileServiceConfig {
     Mp4RecordConfig mp4Config;        ///< MP4 录制配置
+    PrerecordConfig prerecord;        ///< 事件预录配置
+};
+
+/**
+ * @brief 事件录制统计
+ */
+struct EventRecordStats {
+    bool active = false;              ///< 当前录制由事件触发
+    uint64_t triggers = 0;            ///< 触发次数（含延长录制的重复触发）
+    uint64_t recordings = 0;          ///< 事件录制文件数
+    uint64_t prerecord_frames = 0;    ///< 从预录缓冲写入的帧数
+    uint64_t prerecord_gaps = 0;      ///< 回放未追上、预录帧被淘汰的次数
+    PrerecordStats buffer;            ///< 预录缓冲状态
 };
 
 // ============================================================================
@@ -53,6 +69,9 @@ enum class FileCommand {
  */
 class FileService {
 public:
+    /// 开始录制时请求关键帧，MP4 从 IDR 开始（接收方负责限频合并）
+    using KeyframeRequestCallback = std::function<void()>;
+
     /**
      * @brief 构造函数
      * @param config 文件服务配置
@@ -111,6 +130,23 @@ public:
      */
     Mp4Recorder::Stats GetRecordStats() const;
 
+    /**
+     * @brief 触发事件录制（任意线程调用，由文件写入线程执行）
+     *
+     * 未在录制时新建文件，先写入预录缓冲中的事件前画面，再衔接实时帧，
+     * 最后一次触发 post_seconds 后自动停止；事件录制中再次触发会延长录制。
+     * 手动录制进行中时只计数，不改变录制状态。
+     *
+     * @param reason 触发来源（用于日志）
+     * @return true 已受理，false 录制器不可用
+     */
+    bool TriggerEventRecording(const std::string& reason);
+
+    /**
+     * @brief 获取事件录制统计
+     */
+    EventRecordStats GetEventStats() const;
+
     // ========================================================================
     // 流消费者接口（供 StreamDispatcher 调用）
     // ========================================================================
@@ -126,12 +162,40 @@ public:
      */
     static void StreamConsumer(EncodedStreamPtr stream, void* user_data);
 
+    /**
+     * @brief 设置关键帧请求回调
+     */
+    void OnKeyframeRequest(KeyframeRequestCallback callback);
+
 private:
+    // 预录回放时每个实时帧附带写入的缓存帧数（分摊写入，避免一次性阻塞文件线程）
+    static constexpr int kReplayFramesPerTick = 8;
+
+    void BeginEventRecording(uint64_t pts);
+    void ReplayPrerecord();
+    void CheckEventDeadline(uint64_t pts);
+
     FileServiceConfig config_;
     
     std::unique_ptr<Mp4Recorder> mp4_recorder_;
     
+    KeyframeRequestCallback keyframe_callback_;
+    
     std::atomic<bool> running_{false};
+
+    // 事件录制（以下非原子成员只在文件写入线程访问）
+    std::unique_ptr<PrerecordBuffer> prerecord_;
+    mutable std::mutex prerecord_mutex_;    ///< 保护 prerecord_（统计查询来自 HTTP 线程）
+    std::atomic<bool> event_pending_{false};
+    std::atomic<bool> event_active_{false};
+    uint64_t event_end_pts_ = 0;
+    bool replaying_ = false;                ///< 预录帧尚未全部写入
+    uint64_t replay_seq_ = 0;
+
+    std::atomic<uint64_t> event_triggers_{0};
+    std::atomic<uint64_t> event_recordings_{0};
+    std::atomic<uint64_t> prerecord_frames_{0};
+    std::atomic<uint64_t> prerecord_gaps_{0};
 };
 
 // ============================================================================
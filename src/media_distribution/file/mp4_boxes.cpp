@@ -0,0 +1,251 @@
+/**
+ * @file mp4_boxes.cpp
+ * @brief MP4 / fMP4 box 构造实现
+ *
+ * @author 好软，好温暖
+ * @date 2026-01-31
+ */
+
+#include "mp4_boxes.h"
+
+// ============================================================================
+// ftyp
+// ============================================================================
+
+void WriteMp4Ftyp(Mp4BoxBuffer& b, media::VideoCodec codec, bool fragmented) {
+    size_t ftyp = b.BeginBox("ftyp");
+    b.Fourcc("isom");
+    b.U32(0x200);
+    b.Fourcc("isom");
+    b.Fourcc("iso2");
+    if (fragmented) {
+        b.Fourcc("iso6");
+    }
+    b.Fourcc(codec == media::VideoCodec::kH265 ? "hvc1" : "avc1");
+    b.Fourcc("mp41");
+    b.EndBox(ftyp);
+}
+
+// ============================================================================
+// moov
+// ============================================================================
+
+namespace {
+
+void WriteSampleEntry(Mp4BoxBuffer& b, const Mp4TrackInfo& track) {
+    const bool hevc = (track.codec == media::VideoCodec::kH265);
+    size_t entry = b.BeginBox(hevc ? "hvc1" : "avc1");
+    b.Zeros(6);                                 // reserved
+    b.U16(1);                                   // data_reference_index
+    b.Zeros(16);                                // pre_defined / reserved
+    b.U16(static_cast<uint16_t>(track.width));
+    b.U16(static_cast<uint16_t>(track.height));
+    b.U32(0x00480000);                          // 72 dpi
+    b.U32(0x00480000);
+    b.U32(0);                                   // reserved
+    b.U16(1);                                   // frame_count
+    b.Zeros(32);                                // compressorname
+    b.U16(0x0018);                              // depth
+    b.U16(0xFFFF);                              // pre_defined = -1
+
+    size_t record = b.BeginBox(hevc ? "hvcC" : "avcC");
+    b.Bytes(track.config_record.data(), track.config_record.size());
+    b.EndBox(record);
+    b.EndBox(entry);
+}
+
+void WriteStbl(Mp4BoxBuffer& b, const Mp4TrackInfo& track, bool fragmented,
+               const std::vector<Mp4SampleEntry>& samples,
+               const std::vector<uint32_t>& sync_samples) {
+    size_t stbl = b.BeginBox("stbl");
+
+    size_t stsd = b.BeginFullBox("stsd", 0, 0);
+    b.U32(1);
+    WriteSampleEntry(b, track);
+    b.EndBox(stsd);
+
+    // fMP4 的样本表为空，样本信息在各 fragment 的 trun 中
+    const bool tables = !fragmented;
+
+    // stts：相同时长的连续样本合并为一项
+    size_t stts = b.BeginFullBox("stts", 0, 0);
+    size_t stts_count_pos = b.Size();
+    b.U32(0);
+    uint32_t runs = 0;
+    if (tables) {
+        for (size_t i = 0; i < samples.size();) {
+            size_t j = i + 1;
+            while (j < samples.size() && samples[j].duration == samples[i].duration) j++;
+            b.U32(static_cast<uint32_t>(j - i));
+            b.U32(samples[i].duration);
+            runs++;
+            i = j;
+        }
+    }
+    b.PatchU32(stts_count_pos, runs);
+    b.EndBox(stts);
+
+    if (tables) {
+        size_t stss = b.BeginFullBox("stss", 0, 0);
+        b.U32(static_cast<uint32_t>(sync_samples.size()));
+        for (uint32_t n : sync_samples) b.U32(n);
+        b.EndBox(stss);
+    }
+
+    // 每个样本一个 chunk
+    size_t stsc = b.BeginFullBox("stsc", 0, 0);
+    if (tables && !samples.empty()) {
+        b.U32(1);
+        b.U32(1);                               // first_chunk
+        b.U32(1);                               // samples_per_chunk
+        b.U32(1);                               // sample_description_index
+    } else {
+        b.U32(0);
+    }
+    b.EndBox(stsc);
+
+    size_t stsz = b.BeginFullBox("stsz", 0, 0);
+    b.U32(0);                                   // sample_size = 0：逐个给出
+    b.U32(tables ? static_cast<uint32_t>(samples.size()) : 0);
+    if (tables) {
+        for (const auto& s : samples) b.U32(s.size);
+    }
+    b.EndBox(stsz);
+
+    size_t co64 = b.BeginFullBox("co64", 0, 0);
+    b.U32(tables ? static_cast<uint32_t>(samples.size()) : 0);
+    if (tables) {
+        for (const auto& s : samples) b.U64(s.offset);
+    }
+    b.EndBox(co64);
+
+    b.EndBox(stbl);
+}
+
+}  // namespace
+
+void WriteMp4Moov(Mp4BoxBuffer& b, const Mp4TrackInfo& track, bool fragmented,
+                  const std::vector<Mp4SampleEntry>& samples,
+                  const std::vector<uint32_t>& sync_samples) {
+    uint64_t duration = 0;
+    if (!fragmented) {
+        for (const auto& s : samples) duration += s.duration;
+    }
+    const uint64_t movie_duration = duration * kMp4MovieTimescale / kMp4Timescale;
+
+    size_t moov = b.BeginBox("moov");
+
+    size_t mvhd = b.BeginFullBox("mvhd", 0, 0);
+    b.U32(0);                                   // creation_time
+    b.U32(0);                                   // modification_time
+    b.U32(kMp4MovieTimescale);
+    b.U32(static_cast<uint32_t>(movie_duration));
+    b.U32(0x00010000);                          // rate 1.0
+    b.U16(0x0100);                              // volume 1.0
+    b.Zeros(10);
+    b.Matrix();
+    b.Zeros(24);                                // pre_defined
+    b.U32(kMp4TrackId + 1);                     // next_track_ID
+    b.EndBox(mvhd);
+
+    size_t trak = b.BeginBox("trak");
+    size_t tkhd = b.BeginFullBox("tkhd", 0, 0x000003);   // enabled | in_movie
+    b.U32(0);
+    b.U32(0);
+    b.U32(kMp4TrackId);
+    b.U32(0);
+    b.U32(static_cast<uint32_t>(movie_duration));
+    b.Zeros(8);
+    b.U16(0);                                   // layer
+    b.U16(0);                                   // alternate_group
+    b.U16(0);                                   // volume
+    b.U16(0);
+    b.Matrix();
+    b.U32(static_cast<uint32_t>(track.width) << 16);
+    b.U32(static_cast<uint32_t>(track.height) << 16);
+    b.EndBox(tkhd);
+
+    size_t mdia = b.BeginBox("mdia");
+    size_t mdhd = b.BeginFullBox("mdhd", 1, 0);
+    b.U64(0);
+    b.U64(0);
+    b.U32(kMp4Timescale);
+    b.U64(duration);
+    b.U16(0x55C4);                              // language = "und"
+    b.U16(0);
+    b.EndBox(mdhd);
+
+    size_t hdlr = b.BeginFullBox("hdlr", 0, 0);
+    b.U32(0);
+    b.Fourcc("vide");
+    b.Zeros(12);
+    static const char kHandlerName[] = "VideoHandler";
+    b.Bytes(reinterpret_cast<const uint8_t*>(kHandlerName), sizeof(kHandlerName));
+    b.EndBox(hdlr);
+
+    size_t minf = b.BeginBox("minf");
+    size_t vmhd = b.BeginFullBox("vmhd", 0, 1);
+    b.Zeros(8);                                 // graphicsmode + opcolor
+    b.EndBox(vmhd);
+
+    size_t dinf = b.BeginBox("dinf");
+    size_t dref = b.BeginFullBox("dref", 0, 0);
+    b.U32(1);
+    size_t url = b.BeginFullBox("url ", 0, 1);  // 数据在本文件内
+    b.EndBox(url);
+    b.EndBox(dref);
+    b.EndBox(dinf);
+
+    WriteStbl(b, track, fragmented, samples, sync_samples);
+    b.EndBox(minf);
+    b.EndBox(mdia);
+    b.EndBox(trak);
+
+    if (fragmented) {
+        size_t mvex = b.BeginBox("mvex");
+        size_t trex = b.BeginFullBox("trex", 0, 0);
+        b.U32(kMp4TrackId);
+        b.U32(1);                               // default_sample_description_index
+        b.U32(track.default_duration);
+        b.U32(0);
+        b.U32(kMp4NonSyncSampleFlags);
+        b.EndBox(trex);
+        b.EndBox(mvex);
+    }
+
+    b.EndBox(moov);
+}
+
+// ============================================================================
+// moof
+// ============================================================================
+
+void WriteMp4Moof(Mp4BoxBuffer& b, uint32_t sequence, uint64_t base_dts, bool first_sync,
+                  const std::vector<Mp4SampleEntry>& samples, uint32_t data_offset) {
+    size_t moof = b.BeginBox("moof");
+    size_t mfhd = b.BeginFullBox("mfhd", 0, 0);
+    b.U32(sequence);
+    b.EndBox(mfhd);
+
+    size_t traf = b.BeginBox("traf");
+    size_t tfhd = b.BeginFullBox("tfhd", 0, 0x020000);    // default-base-is-moof
+    b.U32(kMp4TrackId);
+    b.EndBox(tfhd);
+
+    size_t tfdt = b.BeginFullBox("tfdt", 1, 0);
+    b.U64(base_dts);
+    b.EndBox(tfdt);
+
+    // data-offset | first-sample-flags | sample-duration | sample-size
+    size_t trun = b.BeginFullBox("trun", 0, 0x000001 | 0x000004 | 0x000100 | 0x000200);
+    b.U32(static_cast<uint32_t>(samples.size()));
+    b.U32(data_offset);
+    b.U32(first_sync ? kMp4SyncSampleFlags : kMp4NonSyncSampleFlags);
+    for (const auto& s : samples) {
+        b.U32(s.duration);
+        b.U32(s.size);
+    }
+    b.EndBox(trun);
+    b.EndBox(traf);
+    b.EndBox(moof);
+}
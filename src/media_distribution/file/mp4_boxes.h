@@ -0,0 +1,154 @@
+/**
+ * @file mp4_boxes.h
+ * @brief MP4 / fMP4 box 构造 - 内置封装器与 HLS 分片共用
+ *
+ * 只负责把轨道参数与样本表序列化为 box，不关心数据写到哪里：
+ * - Mp4Muxer 内置后端：写 ftyp/moov/moof 到录制文件
+ * - HLS 打包器：在内存中生成 init 段（ftyp + moov）与 part（moof + mdat）
+ *
+ * 单视频轨，时间刻度 90kHz。
+ *
+ * @author 好软，好温暖
+ * @date 2026-01-31
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "common/nal_index.h"
+
+constexpr uint32_t kMp4Timescale = 90000;           ///< 视频轨时间刻度
+constexpr uint32_t kMp4MovieTimescale = 1000;       ///< mvhd / tkhd 时间刻度
+constexpr uint32_t kMp4TrackId = 1;
+
+constexpr uint32_t kMp4SyncSampleFlags = 0x02000000;     ///< sample_depends_on = 2（不依赖其他帧）
+constexpr uint32_t kMp4NonSyncSampleFlags = 0x01010000;  ///< depends_on = 1，is_non_sync_sample = 1
+
+// ============================================================================
+// Box 缓冲
+// ============================================================================
+
+/**
+ * @brief 大端字节缓冲，支持嵌套 box 的长度回填
+ */
+class Mp4BoxBuffer {
+public:
+    void U8(uint8_t v) { buf_.push_back(v); }
+    void U16(uint16_t v) {
+        U8(static_cast<uint8_t>(v >> 8));
+        U8(static_cast<uint8_t>(v));
+    }
+    void U24(uint32_t v) {
+        U8(static_cast<uint8_t>(v >> 16));
+        U16(static_cast<uint16_t>(v));
+    }
+    void U32(uint32_t v) {
+        U16(static_cast<uint16_t>(v >> 16));
+        U16(static_cast<uint16_t>(v));
+    }
+    void U64(uint64_t v) {
+        U32(static_cast<uint32_t>(v >> 32));
+        U32(static_cast<uint32_t>(v));
+    }
+    void Zeros(size_t n) { buf_.insert(buf_.end(), n, 0); }
+    void Bytes(const uint8_t* data, size_t n) { buf_.insert(buf_.end(), data, data + n); }
+    void Fourcc(const char* type) { Bytes(reinterpret_cast<const uint8_t*>(type), 4); }
+
+    /// 开始一个 box，返回其起始位置，EndBox() 时回填长度
+    size_t BeginBox(const char* type) {
+        size_t pos = buf_.size();
+        U32(0);
+        Fourcc(type);
+        return pos;
+    }
+    size_t BeginFullBox(const char* type, uint8_t version, uint32_t flags) {
+        size_t pos = BeginBox(type);
+        U8(version);
+        U24(flags);
+        return pos;
+    }
+    void EndBox(size_t pos) { PatchU32(pos, static_cast<uint32_t>(buf_.size() - pos)); }
+
+    void PatchU32(size_t pos, uint32_t v) {
+        buf_[pos] = static_cast<uint8_t>(v >> 24);
+        buf_[pos + 1] = static_cast<uint8_t>(v >> 16);
+        buf_[pos + 2] = static_cast<uint8_t>(v >> 8);
+        buf_[pos + 3] = static_cast<uint8_t>(v);
+    }
+
+    void Matrix() {
+        static const uint32_t kUnity[9] = {0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000};
+        for (uint32_t v : kUnity) U32(v);
+    }
+
+    void Clear() { buf_.clear(); }
+    size_t Size() const { return buf_.size(); }
+    const uint8_t* Data() const { return buf_.data(); }
+
+private:
+    std::vector<uint8_t> buf_;
+};
+
+// ============================================================================
+// 轨道与样本
+// ============================================================================
+
+/**
+ * @brief 视频轨参数
+ */
+struct Mp4TrackInfo {
+    media::VideoCodec codec = media::VideoCodec::kH264;
+    int width = 1920;
+    int height = 1080;
+    uint32_t default_duration = kMp4Timescale / 30;     ///< 默认样本时长（trex）
+    std::vector<uint8_t> config_record;                 ///< avcC / hvcC
+};
+
+/**
+ * @brief 每个样本的表项（普通 MP4 的样本表 / fMP4 的 trun）
+ */
+struct Mp4SampleEntry {
+    uint64_t offset = 0;        ///< 文件偏移（仅普通 MP4 的 co64 使用）
+    uint32_t size = 0;
+    uint32_t duration = 0;
+};
+
+// ============================================================================
+// Box 序列化
+// ============================================================================
+
+/**
+ * @brief ftyp（fMP4 额外声明 iso6）
+ */
+void WriteMp4Ftyp(Mp4BoxBuffer& b, media::VideoCodec codec, bool fragmented);
+
+/**
+ * @brief moov
+ *
+ * @param fragmented true：样本表为空并追加 mvex（fMP4 init 段）；false：由 samples / sync_samples 生成样本表
+ * @param samples 普通 MP4 的全部样本（fMP4 忽略）
+ * @param sync_samples 关键帧样本序号，从 1 开始（fMP4 忽略）
+ */
+void WriteMp4Moov(Mp4BoxBuffer& b, const Mp4TrackInfo& track, bool fragmented,
+                  const std::vector<Mp4SampleEntry>& samples,
+                  const std::vector<uint32_t>& sync_samples);
+
+/**
+ * @brief moof（mfhd + traf{tfhd(default-base-is-moof), tfdt, trun}）
+ *
+ * @param sequence fragment 序号（从 1 开始递增）
+ * @param base_dts 首个样本的解码时间（kMp4Timescale）
+ * @param first_sync 首个样本是否为关键帧
+ * @param samples 本 fragment 的样本（时长、大小）
+ * @param data_offset moof 起点到首个样本数据的偏移
+ */
+void WriteMp4Moof(Mp4BoxBuffer& b, uint32_t sequence, uint64_t base_dts, bool first_sync,
+                  const std::vector<Mp4SampleEntry>& samples, uint32_t data_offset);
+
+/**
+ * @brief WriteMp4Moof() 生成的 moof 字节数
+ */
+inline size_t Mp4MoofSize(size_t samples) { return 92 + 8 * samples; }
@@ -0,0 +1,186 @@
+/**
+ * @file mp4_muxer.cpp
+ * @brief 封装器公共部分 - 参数集 -> avcC / hvcC
+ *
+ * @author 好软，好温暖
+ * @date 2026-01-31
+ */
+
+#include "mp4_muxer.h"
+
+// ============================================================================
+// 参数集 -> MP4 解码配置记录（avcC / hvcC）
+// ============================================================================
+
+namespace {
+
+/**
+ * @brief 简易 RBSP 比特读取器（用于解析 H.265 SPS 头部字段）
+ */
+class BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    uint32_t Read(int bits) {
+        uint32_t value = 0;
+        for (int i = 0; i < bits; i++) {
+            value <<= 1;
+            if (pos_ < size_ * 8) {
+                value |= (data_[pos_ >> 3] >> (7 - (pos_ & 7))) & 1;
+            }
+            pos_++;
+        }
+        return value;
+    }
+
+    void Skip(size_t bits) { pos_ += bits; }
+
+    /// 无符号指数哥伦布码 ue(v)
+    uint32_t ReadUe() {
+        int zeros = 0;
+        while (zeros < 32 && Read(1) == 0) zeros++;
+        if (zeros == 0) return 0;
+        return ((1u << zeros) - 1) + Read(zeros);
+    }
+
+    bool Overrun() const { return pos_ > size_ * 8; }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_ = 0;
+};
+
+/**
+ * @brief 去除防竞争字节（00 00 03 -> 00 00）
+ */
+std::vector<uint8_t> NalToRbsp(const uint8_t* nal, size_t size) {
+    std::vector<uint8_t> rbsp;
+    rbsp.reserve(size);
+    int zeros = 0;
+    for (size_t i = 0; i < size; i++) {
+        if (zeros >= 2 && nal[i] == 0x03) {
+            zeros = 0;
+            continue;
+        }
+        zeros = (nal[i] == 0) ? zeros + 1 : 0;
+        rbsp.push_back(nal[i]);
+    }
+    return rbsp;
+}
+
+void PutBe16(std::vector<uint8_t>& out, size_t value) {
+    out.push_back(static_cast<uint8_t>((value >> 8) & 0xFF));
+    out.push_back(static_cast<uint8_t>(value & 0xFF));
+}
+
+/**
+ * @brief 构造 AVCDecoderConfigurationRecord（avcC）
+ */
+bool BuildAvcc(const std::vector<uint8_t>& sps, const std::vector<uint8_t>& pps,
+               std::vector<uint8_t>* out) {
+    if (sps.size() < 4 || pps.empty()) return false;
+
+    out->clear();
+    out->push_back(1);          // version
+    out->push_back(sps[1]);     // profile
+    out->push_back(sps[2]);     // compatibility
+    out->push_back(sps[3]);     // level
+    out->push_back(0xFF);       // 4 bytes NAL length
+    out->push_back(0xE1);       // 1 SPS
+    PutBe16(*out, sps.size());
+    out->insert(out->end(), sps.begin(), sps.end());
+    out->push_back(1);          // 1 PPS
+    PutBe16(*out, pps.size());
+    out->insert(out->end(), pps.begin(), pps.end());
+    return true;
+}
+
+/**
+ * @brief 构造 HEVCDecoderConfigurationRecord（hvcC，ISO/IEC 14496-15 8.3.3）
+ *
+ * profile_tier_level 与色度/位深取自 SPS，其余字段使用保守默认值
+ */
+bool BuildHvcc(const std::vector<uint8_t>& vps, const std::vector<uint8_t>& sps,
+               const std::vector<uint8_t>& pps, std::vector<uint8_t>* out) {
+    if (vps.empty() || sps.size() < 15 || pps.empty()) return false;
+
+    // 跳过 2 字节 NAL 头
+    std::vector<uint8_t> rbsp = NalToRbsp(sps.data() + 2, sps.size() - 2);
+    BitReader br(rbsp.data(), rbsp.size());
+
+    br.Skip(4);                                 // sps_video_parameter_set_id
+    uint32_t max_sub_layers_minus1 = br.Read(3);
+    uint32_t temporal_id_nesting = br.Read(1);
+
+    // general_profile_tier_level：12 字节原样拷贝
+    uint8_t ptl[12];
+    for (auto& b : ptl) b = static_cast<uint8_t>(br.Read(8));
+
+    // sub_layer 信息：只需跳过
+    std::vector<bool> profile_present(max_sub_layers_minus1), level_present(max_sub_layers_minus1);
+    for (uint32_t i = 0; i < max_sub_layers_minus1; i++) {
+        profile_present[i] = br.Read(1);
+        level_present[i] = br.Read(1);
+    }
+    if (max_sub_layers_minus1 > 0) {
+        br.Skip(2 * (8 - max_sub_layers_minus1));
+    }
+    for (uint32_t i = 0; i < max_sub_layers_minus1; i++) {
+        if (profile_present[i]) br.Skip(88);
+        if (level_present[i]) br.Skip(8);
+    }
+
+    br.ReadUe();                                // sps_seq_parameter_set_id
+    uint32_t chroma_format_idc = br.ReadUe();
+    if (chroma_format_idc == 3) br.Skip(1);     // separate_colour_plane_flag
+    br.ReadUe();                                // pic_width_in_luma_samples
+    br.ReadUe();                                // pic_height_in_luma_samples
+    if (br.Read(1)) {                           // conformance_window_flag
+        br.ReadUe();
+        br.ReadUe();
+        br.ReadUe();
+        br.ReadUe();
+    }
+    uint32_t bit_depth_luma_minus8 = br.ReadUe();
+    uint32_t bit_depth_chroma_minus8 = br.ReadUe();
+    if (br.Overrun()) return false;
+
+    out->clear();
+    out->push_back(1);                                          // configurationVersion
+    out->insert(out->end(), ptl, ptl + 12);                     // profile/tier/level
+    out->push_back(0xF0);                                       // min_spatial_segmentation_idc = 0
+    out->push_back(0x00);
+    out->push_back(0xFC);                                       // parallelismType = 0
+    out->push_back(0xFC | (chroma_format_idc & 0x03));
+    out->push_back(0xF8 | (bit_depth_luma_minus8 & 0x07));
+    out->push_back(0xF8 | (bit_depth_chroma_minus8 & 0x07));
+    PutBe16(*out, 0);                                           // avgFrameRate
+    out->push_back(static_cast<uint8_t>(((max_sub_layers_minus1 + 1) & 0x07) << 3 |
+                                        (temporal_id_nesting & 0x01) << 2 |
+                                        0x03));                 // lengthSizeMinusOne = 3
+    out->push_back(3);                                          // numOfArrays
+
+    auto put_array = [out](uint8_t nal_type, const std::vector<uint8_t>& nal) {
+        out->push_back(0x80 | nal_type);                        // array_completeness = 1
+        PutBe16(*out, 1);                                       // numNalus
+        PutBe16(*out, nal.size());
+        out->insert(out->end(), nal.begin(), nal.end());
+    };
+    put_array(32, vps);
+    put_array(33, sps);
+    put_array(34, pps);
+    return true;
+}
+
+}  // namespace
+
+bool BuildDecoderConfigRecord(const media::ParameterSets& params, std::vector<uint8_t>* out) {
+    if (!params.IsComplete()) {
+        return false;
+    }
+    if (params.codec == media::VideoCodec::kH265) {
+        return BuildHvcc(params.vps, params.sps, params.pps, out);
+    }
+    return BuildAvcc(params.sps, params.pps, out);
+}
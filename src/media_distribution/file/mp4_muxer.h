@@ -0,0 +1,90 @@
+/**
+ * @file mp4_muxer.h
+ * @brief MP4 / fMP4 封装器接口
+ *
+ * Mp4Recorder 只依赖本接口，后端在编译期选择（src/media_distribution/file/CMakeLists.txt）：
+ * - 内置封装器（默认）：直接写 ftyp/moov/moof/mdat，样本的 NAL 负载从 VENC 包缓冲
+ *   直接拷入写盘缓冲，不做单独的格式转换，录制路径不链接 FFmpeg
+ * - libavformat（AIPC_RECORD_LIBAVFORMAT=ON）：沿用 movenc
+ *
+ * 两种后端都经 RecordWriter 对齐、批量写盘（libavformat 后端使用自定义 AVIO）。
+ *
+ * 调用顺序：Open() -> WriteHeader() -> WriteSample()* -> Finish()
+ * 同一实例只在一个线程内使用（写入线程写样本，Finish() 可移交到收尾线程）。
+ *
+ * @author 好软，好温暖
+ * @date 2026-01-31
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/nal_index.h"
+#include "file/record_writer.h"
+
+/**
+ * @brief 封装器配置
+ */
+struct Mp4MuxerConfig {
+    media::VideoCodec codec = media::VideoCodec::kH264;
+    int width = 1920;
+    int height = 1080;
+    int fps = 30;
+    int gopSize = 60;
+    bool fragmented = false;    ///< true：空 moov + 每个 GOP 一个 moof/mdat
+    bool fragmentSync = true;   ///< fMP4：每个 fragment 写出后立即提交写盘并 fdatasync
+    RecordIoConfig io;
+    std::shared_ptr<RecordIoMetrics> ioMetrics;     ///< 可为空
+};
+
+class Mp4Muxer {
+public:
+    virtual ~Mp4Muxer() = default;
+
+    /**
+     * @brief 创建输出文件（header 等第一个关键帧确定参数集后再写）
+     */
+    virtual bool Open(const std::string& path) = 0;
+
+    /**
+     * @brief 写入文件头，参数集写入 avcC / hvcC
+     */
+    virtual bool WriteHeader(const media::ParameterSets& params) = 0;
+
+    /**
+     * @brief 写入一帧
+     * @param data Annex-B 帧数据
+     * @param len 数据长度
+     * @param nal 帧的 NAL 索引（据此转换为长度前缀格式）
+     * @param pts_us 相对分段起点的时间戳（微秒）
+     */
+    virtual bool WriteSample(const uint8_t* data, size_t len, const media::NalIndex& nal,
+                             uint64_t pts_us) = 0;
+
+    /**
+     * @brief 写出尾部（最后一个 fragment 或 moov）并关闭文件
+     *
+     * 未调用 WriteHeader() 时只关闭文件
+     */
+    virtual bool Finish() = 0;
+
+    /**
+     * @brief 已完整写出的 fragment 数（非 fMP4 为 0）
+     */
+    virtual uint64_t Fragments() const = 0;
+};
+
+/**
+ * @brief 创建编译期选定的封装器后端
+ */
+std::unique_ptr<Mp4Muxer> CreateMp4Muxer(const Mp4MuxerConfig& config);
+
+/**
+ * @brief 由参数集构造 MP4 解码配置记录（H.264: avcC，H.265: hvcC）
+ */
+bool BuildDecoderConfigRecord(const media::ParameterSets& params, std::vector<uint8_t>* out);
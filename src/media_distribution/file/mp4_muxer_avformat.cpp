@@ -0,0 +1,345 @@
+/**
+ * @file mp4_muxer_avformat.cpp
+ * @brief libavformat 封装器后端（AIPC_RECORD_LIBAVFORMAT=ON 时编译）
+ *
+ * movenc 通过自定义 AVIO 写入 RecordWriter：顺序写追加到写盘缓冲，
+ * movenc 回头修改已写区域（mdat 长度、moov 回写）时转为 RecordWriter::Pwrite()。
+ *
+ * @author 好软，好温暖
+ * @date 2026-01-31
+ */
+
+#define LOG_TAG "file"
+
+#include "mp4_muxer.h"
+#include "common/logger.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+// FFmpeg 头文件
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/opt.h>
+}
+
+namespace {
+
+/**
+ * @brief Annex-B 帧转换为 MP4 样本格式（每个 NAL 前为 4 字节大端长度）
+ *
+ * extradata 为 avcC / hvcC 时 movenc 不再转换码流，样本必须已是长度前缀格式。
+ * 直接按帧的 NAL 索引拷贝，不再扫描起始码；索引被截断时对剩余部分重新建立索引。
+ */
+void AnnexBToLengthPrefixed(const uint8_t* data, size_t len, const media::NalIndex& nal,
+                            std::vector<uint8_t>* out) {
+    out->clear();
+    out->reserve(len + 4);
+
+    const media::NalIndex* index = &nal;
+    media::NalIndex rest;
+    size_t base = 0;
+    while (true) {
+        for (uint8_t i = 0; i < index->count; i++) {
+            const media::NalUnit& unit = index->units[i];
+            uint32_t size = unit.PayloadSize();
+            out->push_back(static_cast<uint8_t>(size >> 24));
+            out->push_back(static_cast<uint8_t>(size >> 16));
+            out->push_back(static_cast<uint8_t>(size >> 8));
+            out->push_back(static_cast<uint8_t>(size));
+            const uint8_t* payload = data + base + unit.PayloadOffset();
+            out->insert(out->end(), payload, payload + size);
+        }
+        if (!index->truncated || index->count == 0) {
+            break;
+        }
+        const media::NalUnit& last = index->units[index->count - 1];
+        base += last.offset + last.size;
+        media::build_nal_index(data + base, len - base, nal.codec, &rest);
+        index = &rest;
+    }
+}
+
+// ============================================================================
+// libavformat 封装器
+// ============================================================================
+
+class AvformatMp4Muxer : public Mp4Muxer {
+public:
+    explicit AvformatMp4Muxer(const Mp4MuxerConfig& config) : config_(config) {}
+
+    ~AvformatMp4Muxer() override { Release(); }
+
+    bool Open(const std::string& path) override;
+    bool WriteHeader(const media::ParameterSets& params) override;
+    bool WriteSample(const uint8_t* data, size_t len, const media::NalIndex& nal,
+                     uint64_t pts_us) override;
+    bool Finish() override;
+    uint64_t Fragments() const override { return fragments_; }
+
+private:
+    static constexpr int kAvioBufferSize = 32 * 1024;
+
+    static int AvioWrite(void* opaque, uint8_t* buf, int size);
+    static int64_t AvioSeek(void* opaque, int64_t offset, int whence);
+
+    void Release();
+
+    Mp4MuxerConfig config_;
+    std::unique_ptr<RecordWriter> writer_;
+    uint64_t cursor_ = 0;              // movenc 视角的写位置
+    AVFormatContext* format_ctx_ = nullptr;
+    AVCodecContext* codec_ctx_ = nullptr;
+    bool header_written_ = false;
+    bool has_keyframe_ = false;
+    uint64_t fragments_ = 0;
+    std::vector<uint8_t> sample_buf_;  // 长度前缀格式的样本（复用，避免逐帧分配）
+};
+
+bool AvformatMp4Muxer::Open(const std::string& filepath) {
+    AVFormatContext* ofmt_ctx = nullptr;
+    if (avformat_alloc_output_context2(&ofmt_ctx, nullptr, "mp4", filepath.c_str()) < 0) {
+        LOG_ERROR("Could not create output context for: {}", filepath);
+        return false;
+    }
+    
+    const bool hevc = (config_.codec == media::VideoCodec::kH265);
+    AVCodecID codec_id = hevc ? AV_CODEC_ID_HEVC : AV_CODEC_ID_H264;
+    // 码流来自硬件 VENC，编码器只用于填写 codecpar；
+    // 精简版 FFmpeg 通常不带 HEVC 编码器，此时以空 codec 创建上下文
+    const AVCodec* codec = avcodec_find_encoder(codec_id);
+    if (!codec) {
+        LOG_DEBUG("No FFmpeg encoder for {}, using bare codec parameters",
+                  hevc ? "H.265" : "H.264");
+    }
+    
+    AVCodecContext* codec_ctx = avcodec_alloc_context3(codec);
+    if (!codec_ctx) {
+        LOG_ERROR("Failed to allocate codec context");
+        avformat_free_context(ofmt_ctx);
+        return false;
+    }
+    
+    codec_ctx->codec_id = codec_id;
+    codec_ctx->codec_type = AVMEDIA_TYPE_VIDEO;
+    codec_ctx->bit_rate = 3000000;
+    codec_ctx->width = config_.width;
+    codec_ctx->height = config_.height;
+    codec_ctx->time_base = AVRational{1, config_.fps};
+    codec_ctx->framerate = AVRational{config_.fps, 1};
+    codec_ctx->gop_size = config_.gopSize;
+    codec_ctx->max_b_frames = 0;
+    codec_ctx->pix_fmt = AV_PIX_FMT_NV12;
+    
+    AVStream* video_st = avformat_new_stream(ofmt_ctx, codec);
+    if (!video_st) {
+        LOG_ERROR("Failed to create video stream");
+        avcodec_free_context(&codec_ctx);
+        avformat_free_context(ofmt_ctx);
+        return false;
+    }
+    
+    if (avcodec_parameters_from_context(video_st->codecpar, codec_ctx) < 0) {
+        LOG_ERROR("Failed to copy codec parameters to stream");
+        avcodec_free_context(&codec_ctx);
+        avformat_free_context(ofmt_ctx);
+        return false;
+    }
+    
+    video_st->codecpar->codec_tag = 0;
+    video_st->time_base = AVRational{1, config_.fps};
+    
+    format_ctx_ = ofmt_ctx;
+    codec_ctx_ = codec_ctx;
+
+    writer_ = std::make_unique<RecordWriter>(config_.io, config_.ioMetrics);
+    cursor_ = 0;
+    uint8_t* avio_buffer = static_cast<uint8_t*>(av_malloc(kAvioBufferSize));
+    if (!avio_buffer || !writer_->Open(filepath)) {
+        av_free(avio_buffer);
+        Release();
+        return false;
+    }
+    ofmt_ctx->pb = avio_alloc_context(avio_buffer, kAvioBufferSize, 1, this, nullptr,
+                                      &AvformatMp4Muxer::AvioWrite,
+                                      &AvformatMp4Muxer::AvioSeek);
+    if (!ofmt_ctx->pb) {
+        LOG_ERROR("Could not create AVIO context for: {}", filepath);
+        av_free(avio_buffer);
+        Release();
+        return false;
+    }
+    ofmt_ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
+    return true;
+}
+
+// ============================================================================
+// 自定义 AVIO -> RecordWriter
+// ============================================================================
+
+int AvformatMp4Muxer::AvioWrite(void* opaque, uint8_t* buf, int size) {
+    auto* self = static_cast<AvformatMp4Muxer*>(opaque);
+    RecordWriter* writer = self->writer_.get();
+    size_t len = static_cast<size_t>(size);
+    const uint64_t end = writer->Position();
+    if (self->cursor_ > end) {
+        return AVERROR(EINVAL);     // 不支持跳过未写区域
+    }
+
+    // 与已写区域重叠的部分回填，其余追加
+    size_t overlap = static_cast<size_t>(std::min<uint64_t>(end - self->cursor_, len));
+    if (overlap > 0 && !writer->Pwrite(buf, overlap, self->cursor_)) {
+        return AVERROR(EIO);
+    }
+    if (len > overlap && !writer->Write(buf + overlap, len - overlap)) {
+        return AVERROR(EIO);
+    }
+    self->cursor_ += len;
+    return size;
+}
+
+int64_t AvformatMp4Muxer::AvioSeek(void* opaque, int64_t offset, int whence) {
+    auto* self = static_cast<AvformatMp4Muxer*>(opaque);
+    const int64_t end = static_cast<int64_t>(self->writer_->Position());
+    switch (whence & ~AVSEEK_FORCE) {
+        case AVSEEK_SIZE: return end;
+        case SEEK_SET: break;
+        case SEEK_CUR: offset += static_cast<int64_t>(self->cursor_); break;
+        case SEEK_END: offset += end; break;
+        default: return AVERROR(EINVAL);
+    }
+    if (offset < 0 || offset > end) {
+        return AVERROR(EINVAL);
+    }
+    self->cursor_ = static_cast<uint64_t>(offset);
+    return offset;
+}
+
+bool AvformatMp4Muxer::WriteHeader(const media::ParameterSets& params) {
+    if (!format_ctx_) {
+        return false;
+    }
+
+    const bool hevc = (config_.codec == media::VideoCodec::kH265);
+    std::vector<uint8_t> record;
+    if (!BuildDecoderConfigRecord(params, &record)) {
+        LOG_ERROR("Failed to build {} from parameter sets", hevc ? "hvcC" : "avcC");
+        return false;
+    }
+
+    uint8_t* extradata = static_cast<uint8_t*>(
+        av_malloc(record.size() + AV_INPUT_BUFFER_PADDING_SIZE));
+    if (!extradata) {
+        LOG_ERROR("Failed to allocate extradata");
+        return false;
+    }
+    memcpy(extradata, record.data(), record.size());
+    memset(extradata + record.size(), 0, AV_INPUT_BUFFER_PADDING_SIZE);
+    
+    // 设置到 codecpar（释放旧的 extradata）
+    AVStream* video_stream = format_ctx_->streams[0];
+    if (video_stream->codecpar->extradata) {
+        av_free(video_stream->codecpar->extradata);
+    }
+    video_stream->codecpar->extradata = extradata;
+    video_stream->codecpar->extradata_size = static_cast<int>(record.size());
+
+    // fMP4：空 moov，样本随每个 GOP 的 moof/mdat 写出
+    AVDictionary* opts = nullptr;
+    if (config_.fragmented) {
+        av_dict_set(&opts, "movflags", "frag_keyframe+empty_moov+default_base_moof", 0);
+    }
+    int ret = avformat_write_header(format_ctx_, &opts);
+    av_dict_free(&opts);
+    if (ret < 0) {
+        LOG_ERROR("Error writing header");
+        return false;
+    }
+    header_written_ = true;
+    return true;
+}
+
+bool AvformatMp4Muxer::WriteSample(const uint8_t* data, size_t len, const media::NalIndex& nal,
+                                   uint64_t pts_us) {
+    if (!header_written_) {
+        return false;
+    }
+    AVStream* video_stream = format_ctx_->streams[0];
+
+    AnnexBToLengthPrefixed(data, len, nal, &sample_buf_);
+    
+    AVPacket packet = {};
+    packet.data = sample_buf_.data();
+    packet.size = static_cast<int>(sample_buf_.size());
+    packet.pts = av_rescale_q(static_cast<int64_t>(pts_us / 1000), AVRational{1, 1000},
+                              video_stream->time_base);
+    packet.dts = packet.pts;
+    packet.stream_index = video_stream->index;
+    packet.duration = av_rescale_q(1, AVRational{1, config_.fps}, video_stream->time_base);
+    packet.flags = nal.is_keyframe ? AV_PKT_FLAG_KEY : 0;
+    
+    int ret = av_interleaved_write_frame(format_ctx_, &packet);
+    if (ret < 0) {
+        char errbuf[128];
+        av_strerror(ret, errbuf, sizeof(errbuf));
+        LOG_ERROR("Error writing frame: {}", errbuf);
+        return false;
+    }
+
+    // frag_keyframe：关键帧到达时 movenc 已把上一个 GOP 作为 fragment 写出，
+    // 立即刷出 AVIO 缓冲并提交写盘
+    if (config_.fragmented && nal.is_keyframe) {
+        avio_flush(format_ctx_->pb);
+        if (has_keyframe_) {
+            fragments_++;
+            if (!writer_->Flush(config_.fragmentSync)) {
+                return false;
+            }
+        }
+        has_keyframe_ = true;
+    }
+    return true;
+}
+
+bool AvformatMp4Muxer::Finish() {
+    if (!format_ctx_) {
+        return false;
+    }
+    bool ok = true;
+    if (header_written_) {
+        ok = av_write_trailer(format_ctx_) == 0;
+        if (config_.fragmented && has_keyframe_) {
+            fragments_++;
+        }
+    }
+    if (format_ctx_->pb) {
+        avio_flush(format_ctx_->pb);
+    }
+    ok = (!writer_ || writer_->Close()) && ok;
+    Release();
+    return ok;
+}
+
+void AvformatMp4Muxer::Release() {
+    if (format_ctx_) {
+        if (format_ctx_->pb) {
+            av_freep(&format_ctx_->pb->buffer);
+            avio_context_free(&format_ctx_->pb);
+        }
+        avformat_free_context(format_ctx_);
+        format_ctx_ = nullptr;
+    }
+    writer_.reset();
+    if (codec_ctx_) {
+        avcodec_free_context(&codec_ctx_);
+    }
+    header_written_ = false;
+}
+
+}  // namespace
+
+std::unique_ptr<Mp4Muxer> CreateMp4Muxer(const Mp4MuxerConfig& config) {
+    return std::make_unique<AvformatMp4Muxer>(config);
+}
@@ -0,0 +1,346 @@
+/**
+ * @file mp4_muxer_native.cpp
+ * @brief 内置 MP4 / fMP4 封装器（单视频轨）
+ *
+ * 文件布局：
+ * - 普通 MP4：ftyp | mdat(64 位长度，收尾时回填) | moov（收尾时追加样本表）
+ * - fMP4：ftyp | moov(空样本表 + mvex) | { moof | free | mdat }*
+ *
+ * fMP4 的 moof 必须位于 mdat 之前，但 GOP 结束前样本数未知；为了不缓存整个 GOP，
+ * 每个 fragment 开始时先预留能容纳 2×GOP 个样本的 moof 空间
+ * （写为 free box）和一个长度为 0（延伸到文件尾）的 mdat 头，样本直接追加；
+ * fragment 结束时用 pwrite 回填 moof、剩余空间的 free box 与 mdat 长度。
+ * 掉电时最后一个未完成的 fragment 表现为 free + 空 mdat，之前的 fragment 均完整可播。
+ *
+ * 样本中的 VPS/SPS/PPS 已写入 avcC / hvcC，写样本时跳过，其余 NAL 的长度前缀
+ * 与 VENC 包缓冲中的负载组成 iovec 交给 RecordWriter，拷贝进对齐的写盘缓冲后按 chunk 写出。
+ *
+ * @author 好软，好温暖
+ * @date 2026-01-31
+ */
+
+#define LOG_TAG "file"
+
+#include "mp4_muxer.h"
+#include "mp4_boxes.h"
+#include "common/logger.h"
+
+#include <algorithm>
+
+namespace {
+
+// ============================================================================
+// 内置封装器
+// ============================================================================
+
+class NativeMp4Muxer : public Mp4Muxer {
+public:
+    explicit NativeMp4Muxer(const Mp4MuxerConfig& config)
+        : config_(config)
+        , default_duration_(kMp4Timescale / static_cast<uint32_t>(config.fps > 0 ? config.fps : 30))
+        , fragment_capacity_(static_cast<size_t>(
+              std::min(std::max(config.gopSize * 2, 64), static_cast<int>(kMaxFragmentSamples)))) {
+        track_.codec = config.codec;
+        track_.width = config.width;
+        track_.height = config.height;
+        track_.default_duration = default_duration_;
+    }
+
+    bool Open(const std::string& path) override;
+    bool WriteHeader(const media::ParameterSets& params) override;
+    bool WriteSample(const uint8_t* data, size_t len, const media::NalIndex& nal,
+                     uint64_t pts_us) override;
+    bool Finish() override;
+    uint64_t Fragments() const override { return fragments_; }
+
+private:
+    static constexpr size_t kMaxFragmentSamples = 1024;
+
+    /// 把样本的 NAL 填入 iov_（长度前缀写入 lengths_），返回样本字节数
+    size_t BuildSampleIov(const uint8_t* data, size_t len, const media::NalIndex& nal);
+
+    bool BeginFragment();
+    bool EndFragment(uint64_t next_dts);
+
+    Mp4MuxerConfig config_;
+    const uint32_t default_duration_;
+    const size_t fragment_capacity_;
+
+    std::unique_ptr<RecordWriter> writer_;
+    bool header_written_ = false;
+    Mp4TrackInfo track_;                    ///< 轨道参数与 avcC / hvcC
+
+    /// 普通 MP4 收尾时生成样本表；fMP4 只保留当前 fragment
+    std::vector<Mp4SampleEntry> samples_;
+    std::vector<uint32_t> sync_samples_;    ///< 关键帧样本序号（从 1 开始，普通 MP4 的 stss）
+    bool first_sync_ = false;               ///< fMP4：当前 fragment 首个样本是否为关键帧
+    uint64_t first_dts_ = 0;                ///< fMP4：当前 fragment 首个样本的解码时间
+    uint64_t last_dts_ = 0;                 ///< 上一个样本的解码时间（kMp4Timescale）
+    bool has_last_ = false;
+
+    uint64_t mdat_pos_ = 0;                 ///< 普通 MP4：mdat 头位置
+    uint64_t fragment_pos_ = 0;             ///< fMP4：当前 fragment 的 moof 位置
+    bool fragment_open_ = false;
+    uint32_t sequence_ = 0;
+    uint64_t fragments_ = 0;
+
+    std::vector<struct iovec> iov_;
+    std::vector<uint8_t> lengths_;          ///< iov_ 引用的 4 字节长度前缀
+    Mp4BoxBuffer box_;
+};
+
+// ============================================================================
+// 文件头
+// ============================================================================
+
+bool NativeMp4Muxer::Open(const std::string& path) {
+    writer_ = std::make_unique<RecordWriter>(config_.io, config_.ioMetrics);
+    if (!writer_->Open(path)) {
+        writer_.reset();
+        return false;
+    }
+    return true;
+}
+
+bool NativeMp4Muxer::WriteHeader(const media::ParameterSets& params) {
+    if (!writer_ || !BuildDecoderConfigRecord(params, &track_.config_record)) {
+        LOG_ERROR("Failed to build {} from parameter sets",
+                  config_.codec == media::VideoCodec::kH265 ? "hvcC" : "avcC");
+        return false;
+    }
+
+    box_.Clear();
+    WriteMp4Ftyp(box_, config_.codec, config_.fragmented);
+    if (config_.fragmented) {
+        WriteMp4Moov(box_, track_, true, samples_, sync_samples_);
+    } else {
+        // 64 位 mdat 头：size = 1 表示使用 largesize，收尾时回填
+        mdat_pos_ = box_.Size();
+        box_.U32(1);
+        box_.Fourcc("mdat");
+        box_.U64(0);
+    }
+    if (!writer_->Write(box_.Data(), box_.Size())) {
+        return false;
+    }
+
+    header_written_ = true;
+    return true;
+}
+
+// ============================================================================
+// 样本写入
+// ============================================================================
+
+size_t NativeMp4Muxer::BuildSampleIov(const uint8_t* data, size_t len,
+                                      const media::NalIndex& nal) {
+    // 先收集 NAL，再填 iovec：lengths_ 扩容后地址才稳定
+    iov_.clear();
+    lengths_.clear();
+
+    const media::NalIndex* index = &nal;
+    media::NalIndex rest;
+    size_t base = 0;
+    while (true) {
+        for (uint8_t i = 0; i < index->count; i++) {
+            const media::NalUnit& unit = index->units[i];
+            if (media::nal_is_sps(nal.codec, unit.type) ||
+                media::nal_is_pps(nal.codec, unit.type) ||
+                media::nal_is_vps(nal.codec, unit.type) || unit.PayloadSize() == 0) {
+                continue;   // 参数集已在 avcC / hvcC 中
+            }
+            struct iovec payload;
+            payload.iov_base = const_cast<uint8_t*>(data + base + unit.PayloadOffset());
+            payload.iov_len = unit.PayloadSize();
+            iov_.push_back(payload);
+        }
+        if (!index->truncated || index->count == 0) {
+            break;
+        }
+        // 索引被截断：对剩余部分重新建立索引
+        const media::NalUnit& last = index->units[index->count - 1];
+        base += last.offset + last.size;
+        media::build_nal_index(data + base, len - base, nal.codec, &rest);
+        index = &rest;
+    }
+
+    const size_t nals = iov_.size();
+    lengths_.resize(nals * 4);
+    iov_.resize(nals * 2);
+    size_t total = 0;
+    for (size_t i = nals; i-- > 0;) {
+        struct iovec payload = iov_[i];
+        uint32_t size = static_cast<uint32_t>(payload.iov_len);
+        uint8_t* prefix = &lengths_[i * 4];
+        prefix[0] = static_cast<uint8_t>(size >> 24);
+        prefix[1] = static_cast<uint8_t>(size >> 16);
+        prefix[2] = static_cast<uint8_t>(size >> 8);
+        prefix[3] = static_cast<uint8_t>(size);
+        iov_[i * 2].iov_base = prefix;
+        iov_[i * 2].iov_len = 4;
+        iov_[i * 2 + 1] = payload;
+        total += 4 + size;
+    }
+    return total;
+}
+
+bool NativeMp4Muxer::WriteSample(const uint8_t* data, size_t len, const media::NalIndex& nal,
+                                 uint64_t pts_us) {
+    if (!header_written_) {
+        return false;
+    }
+
+    // 时间戳转换到轨道时间刻度，保证严格递增
+    uint64_t dts = pts_us * kMp4Timescale / 1000000ULL;
+    if (has_last_ && dts <= last_dts_) {
+        dts = last_dts_ + 1;
+    }
+
+    if (config_.fragmented) {
+        bool full = samples_.size() >= fragment_capacity_;
+        if (fragment_open_ && !samples_.empty() && (nal.is_keyframe || full)) {
+            if (!EndFragment(dts)) {
+                return false;
+            }
+        }
+        if (!fragment_open_ && !BeginFragment()) {
+            return false;
+        }
+    }
+
+    size_t size = BuildSampleIov(data, len, nal);
+    if (size == 0) {
+        return true;    // 只有参数集的帧
+    }
+
+    // 上一个样本的时长在本样本到达时确定
+    if (!samples_.empty()) {
+        samples_.back().duration = static_cast<uint32_t>(dts - last_dts_);
+    } else {
+        first_dts_ = dts;
+        first_sync_ = nal.is_keyframe;
+    }
+
+    Mp4SampleEntry entry;
+    entry.offset = writer_->Position();
+    entry.size = static_cast<uint32_t>(size);
+    entry.duration = default_duration_;
+    if (!writer_->Writev(iov_.data(), static_cast<int>(iov_.size()))) {
+        return false;
+    }
+    samples_.push_back(entry);
+    if (nal.is_keyframe && !config_.fragmented) {
+        sync_samples_.push_back(static_cast<uint32_t>(samples_.size()));
+    }
+    last_dts_ = dts;
+    has_last_ = true;
+    return true;
+}
+
+// ============================================================================
+// fMP4 fragment
+// ============================================================================
+
+bool NativeMp4Muxer::BeginFragment() {
+    // 预留 moof 空间（暂为 free box）+ 长度为 0 的 mdat（延伸到文件尾）
+    const size_t reserved = Mp4MoofSize(fragment_capacity_);
+    box_.Clear();
+    box_.U32(static_cast<uint32_t>(reserved));
+    box_.Fourcc("free");
+    box_.Zeros(reserved - 8);
+    box_.U32(0);
+    box_.Fourcc("mdat");
+
+    fragment_pos_ = writer_->Position();
+    if (!writer_->Write(box_.Data(), box_.Size())) {
+        return false;
+    }
+    samples_.clear();
+    fragment_open_ = true;
+    return true;
+}
+
+bool NativeMp4Muxer::EndFragment(uint64_t next_dts) {
+    fragment_open_ = false;
+    const size_t reserved = Mp4MoofSize(fragment_capacity_);
+    const size_t count = samples_.size();
+    const uint64_t mdat_pos = fragment_pos_ + reserved;
+
+    uint8_t mdat_size[4];
+    uint64_t mdat_bytes = writer_->Position() - mdat_pos;
+    mdat_size[0] = static_cast<uint8_t>(mdat_bytes >> 24);
+    mdat_size[1] = static_cast<uint8_t>(mdat_bytes >> 16);
+    mdat_size[2] = static_cast<uint8_t>(mdat_bytes >> 8);
+    mdat_size[3] = static_cast<uint8_t>(mdat_bytes);
+
+    if (count == 0) {
+        // 保持为 free + 空 mdat
+        return writer_->Pwrite(mdat_size, sizeof(mdat_size), mdat_pos);
+    }
+    samples_.back().duration = static_cast<uint32_t>(next_dts - last_dts_);
+
+    box_.Clear();
+    WriteMp4Moof(box_, ++sequence_, first_dts_, first_sync_, samples_,
+                 static_cast<uint32_t>(reserved + 8));      // moof 起点 -> 首个样本
+
+    // 预留空间的剩余部分写为 free box（样本数少于容量时至少 8 字节）
+    if (box_.Size() < reserved) {
+        box_.U32(static_cast<uint32_t>(reserved - box_.Size()));
+        box_.Fourcc("free");
+        box_.Zeros(reserved - box_.Size());
+    }
+
+    // 先回填 mdat 长度，再写 moof：中途掉电时 moof 仍是 free，fragment 被整体忽略
+    if (!writer_->Pwrite(mdat_size, sizeof(mdat_size), mdat_pos) ||
+        !writer_->Pwrite(box_.Data(), box_.Size(), fragment_pos_)) {
+        return false;
+    }
+
+    fragments_++;
+    samples_.clear();
+
+    // 完整的 fragment 立即提交写盘，不等 chunk 写满
+    return writer_->Flush(config_.fragmentSync);
+}
+
+// ============================================================================
+// 收尾
+// ============================================================================
+
+bool NativeMp4Muxer::Finish() {
+    if (!writer_) {
+        return false;
+    }
+
+    bool ok = true;
+    if (header_written_) {
+        if (config_.fragmented) {
+            ok = !fragment_open_ || EndFragment(last_dts_ + default_duration_);
+        } else {
+            // 回填 mdat 长度后追加 moov
+            uint64_t mdat_bytes = writer_->Position() - mdat_pos_;
+            uint8_t size[8];
+            for (int i = 0; i < 8; i++) {
+                size[i] = static_cast<uint8_t>(mdat_bytes >> (56 - 8 * i));
+            }
+            box_.Clear();
+            WriteMp4Moov(box_, track_, false, samples_, sync_samples_);
+            ok = writer_->Pwrite(size, sizeof(size), mdat_pos_ + 8) &&
+                 writer_->Write(box_.Data(), box_.Size());
+        }
+    }
+
+    ok = writer_->Close() && ok;
+    writer_.reset();
+    samples_.clear();
+    samples_.shrink_to_fit();
+    sync_samples_.clear();
+    sync_samples_.shrink_to_fit();
+    return ok;
+}
+
+}  // namespace
+
+std::unique_ptr<Mp4Muxer> CreateMp4Muxer(const Mp4MuxerConfig& config) {
+    return std::make_unique<NativeMp4Muxer>(config);
+}
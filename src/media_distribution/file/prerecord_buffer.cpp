@@ -0,0 +1,187 @@
+/**
+ * @file prerecord_buffer.cpp
+ * @brief 预录环形缓冲实现
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-04
+ */
+
+#define LOG_TAG "file"
+
+#include "prerecord_buffer.h"
+#include "common/logger.h"
+#include "common/media_buffer.h"
+
+#include <cstring>
+
+// ============================================================================
+// 构造
+// ============================================================================
+
+PrerecordBuffer::PrerecordBuffer(size_t capacity_bytes, int pre_seconds,
+                                 media::VideoCodec codec)
+    : arena_(capacity_bytes)
+    , pre_us_(static_cast<uint64_t>(pre_seconds > 0 ? pre_seconds : 0) * 1000000ULL)
+    , codec_(codec) {
+    LOG_INFO("Prerecord buffer created: {}KB arena, pre={}s", capacity_bytes / 1024, pre_seconds);
+}
+
+// ============================================================================
+// 写入
+// ============================================================================
+
+bool PrerecordBuffer::Push(const EncodedStreamPtr& stream) {
+    const auto* data = static_cast<const uint8_t*>(get_stream_vir_addr(stream));
+    size_t len = get_stream_length(stream);
+    if (!data || len == 0) {
+        return false;
+    }
+
+    const media::NalIndex* nal = get_stream_nal_index(stream);
+    media::NalIndex local;
+    if (!nal) {
+        media::build_nal_index(data, len, codec_, &local);
+        local.is_keyframe = local.is_keyframe || is_stream_keyframe(stream);
+        nal = &local;
+    }
+
+    if (len > arena_.size()) {
+        LOG_WARN("Frame of {} bytes exceeds prerecord arena ({} bytes), buffer cleared",
+                 len, arena_.size());
+        oversized_++;
+        Clear();
+        return false;
+    }
+
+    size_t offset = 0;
+    while (!Allocate(len, &offset)) {
+        EvictOldestGop();
+    }
+
+    // 缓存必须从关键帧开始
+    if (slots_.empty() && !nal->is_keyframe) {
+        return false;
+    }
+
+    memcpy(arena_.data() + offset, data, len);
+
+    Slot slot;
+    slot.offset = offset;
+    slot.size = len;
+    slot.pts = get_stream_pts(stream);
+    slot.nal = *nal;
+    if (nal->is_keyframe) {
+        keyframes_.push_back(NextSeq());
+    }
+    slots_.push_back(std::move(slot));
+    bytes_ += len;
+    pushed_++;
+
+    TrimToDuration();
+    return true;
+}
+
+void PrerecordBuffer::Clear() {
+    // 序号保持递增，持有旧序号的读取方据此发现缓存已被清空
+    first_seq_ += slots_.size();
+    slots_.clear();
+    keyframes_.clear();
+    bytes_ = 0;
+}
+
+// ============================================================================
+// 空间管理
+// ============================================================================
+
+bool PrerecordBuffer::Allocate(size_t len, size_t* offset) const {
+    if (slots_.empty()) {
+        *offset = 0;
+        return len <= arena_.size();
+    }
+
+    const Slot& front = slots_.front();
+    const Slot& back = slots_.back();
+    size_t write = back.offset + back.size;
+
+    if (back.offset >= front.offset) {
+        // 未回绕：空闲区为 [write, end) 和 [0, front.offset)
+        if (write + len <= arena_.size()) {
+            *offset = write;
+            return true;
+        }
+        if (len <= front.offset) {
+            *offset = 0;
+            return true;
+        }
+        return false;
+    }
+
+    // 已回绕：空闲区为 [write, front.offset)
+    if (write + len <= front.offset) {
+        *offset = write;
+        return true;
+    }
+    return false;
+}
+
+void PrerecordBuffer::PopFront() {
+    if (!keyframes_.empty() && keyframes_.front() == first_seq_) {
+        keyframes_.pop_front();
+    }
+    bytes_ -= slots_.front().size;
+    slots_.pop_front();
+    first_seq_++;
+}
+
+void PrerecordBuffer::EvictOldestGop() {
+    PopFront();
+    space_evictions_++;
+    while (!slots_.empty() && !slots_.front().nal.is_keyframe) {
+        PopFront();
+        space_evictions_++;
+    }
+}
+
+void PrerecordBuffer::TrimToDuration() {
+    uint64_t newest = slots_.back().pts;
+    while (keyframes_.size() >= 2) {
+        uint64_t second = keyframes_[1];
+        if (newest - slots_[second - first_seq_].pts < pre_us_) {
+            break;
+        }
+        while (first_seq_ < second) {
+            PopFront();
+        }
+    }
+}
+
+// ============================================================================
+// 读取
+// ============================================================================
+
+bool PrerecordBuffer::Read(uint64_t seq, Frame* out) const {
+    if (seq < first_seq_ || seq >= NextSeq()) {
+        return false;
+    }
+    const Slot& slot = slots_[seq - first_seq_];
+    out->data = arena_.data() + slot.offset;
+    out->size = slot.size;
+    out->pts = slot.pts;
+    out->nal = &slot.nal;
+    return true;
+}
+
+PrerecordStats PrerecordBuffer::GetStats() const {
+    PrerecordStats s;
+    s.enabled = true;
+    s.capacity_bytes = arena_.size();
+    s.frames = slots_.size();
+    s.bytes = bytes_;
+    if (!slots_.empty()) {
+        s.duration_sec = (slots_.back().pts - slots_.front().pts) / 1e6;
+    }
+    s.pushed = pushed_;
+    s.space_evictions = space_evictions_;
+    s.oversized = oversized_;
+    return s;
+}
@@ -0,0 +1,146 @@
+/**
+ * @file prerecord_buffer.h
+ * @brief 预录环形缓冲 - 事件触发录制前的编码帧缓存
+ *
+ * 事件（移动侦测、AI 检测、HTTP 触发）发生时，需要把事件前几秒的画面一并写入 MP4。
+ * 预录缓冲持续保存最近 pre_seconds 的主码流编码帧，触发时整段写入录制文件，
+ * 之后无缝衔接实时帧。
+ *
+ * 内存布局：
+ * - 启动时一次性分配 buffer_kb 大小的连续 arena，帧数据按到达顺序首尾相接写入，
+ *   尾部放不下时回绕到 arena 起点；不为每帧单独分配内存
+ * - 帧描述（偏移、长度、PTS、NAL 索引）保存在 slots_ 中，按序号（seq）寻址
+ *
+ * 关键帧对齐：
+ * - 缓冲中的第一帧始终是关键帧，淘汰旧帧后会继续丢弃到下一个关键帧
+ * - 第二个关键帧之后的内容已覆盖 pre_seconds 时，丢弃第一个 GOP
+ * - arena 不足以容纳 pre_seconds 时按空间淘汰（计入 space_evictions，应调大 buffer_kb）
+ *
+ * @note 非线程安全，由调用方加锁（FileService 在文件写入线程中使用）
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-04
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "rk_mpi_venc.h"
+
+#include "common/nal_index.h"
+#include "common/video_codec.h"
+
+using EncodedStreamPtr = std::shared_ptr<VENC_STREAM_S>;
+
+// ============================================================================
+// 配置与统计
+// ============================================================================
+
+/**
+ * @brief 事件预录配置
+ */
+struct PrerecordConfig {
+    int pre_seconds = 0;            ///< 事件前预录时长（秒），0 = 关闭预录缓冲
+    int post_seconds = 10;          ///< 最后一次触发后继续录制的时长（秒）
+    int buffer_kb = 8192;           ///< 预录 arena 大小（KB），约为 主码流码率 × (pre_seconds + GOP)
+};
+
+/**
+ * @brief 预录缓冲统计
+ */
+struct PrerecordStats {
+    bool enabled = false;
+    size_t capacity_bytes = 0;      ///< arena 大小
+    size_t frames = 0;              ///< 当前缓存帧数
+    size_t bytes = 0;               ///< 当前缓存字节数
+    double duration_sec = 0.0;      ///< 当前缓存覆盖的时长
+    uint64_t pushed = 0;            ///< 入队帧数
+    uint64_t space_evictions = 0;   ///< 因 arena 空间不足淘汰的帧数
+    uint64_t oversized = 0;         ///< 单帧超过 arena 被丢弃的次数
+};
+
+// ============================================================================
+// 预录缓冲
+// ============================================================================
+
+class PrerecordBuffer {
+public:
+    /**
+     * @brief 缓存帧视图（data 指向 arena，下一次 Push() 前有效）
+     */
+    struct Frame {
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+        uint64_t pts = 0;
+        const media::NalIndex* nal = nullptr;
+    };
+
+    /**
+     * @param capacity_bytes arena 大小（构造时一次性分配）
+     * @param pre_seconds 需要保留的预录时长
+     * @param codec 码流格式（帧未附带 NAL 索引时用于本地解析）
+     */
+    PrerecordBuffer(size_t capacity_bytes, int pre_seconds, media::VideoCodec codec);
+
+    PrerecordBuffer(const PrerecordBuffer&) = delete;
+    PrerecordBuffer& operator=(const PrerecordBuffer&) = delete;
+
+    /**
+     * @brief 缓存一帧（拷贝进 arena，不持有 VENC buffer）
+     * @return true 已缓存，false 被忽略（尚无关键帧或单帧过大）
+     */
+    bool Push(const EncodedStreamPtr& stream);
+
+    /// 清空缓存（arena 保留）
+    void Clear();
+
+    bool Empty() const { return slots_.empty(); }
+
+    /// 最旧一帧的序号（缓存为空时等于 NextSeq()）
+    uint64_t OldestSeq() const { return first_seq_; }
+
+    /// 下一帧将获得的序号
+    uint64_t NextSeq() const { return first_seq_ + slots_.size(); }
+
+    /**
+     * @brief 读取指定序号的帧
+     * @return false 该帧已被淘汰或尚未写入
+     */
+    bool Read(uint64_t seq, Frame* out) const;
+
+    PrerecordStats GetStats() const;
+
+private:
+    struct Slot {
+        size_t offset = 0;
+        size_t size = 0;
+        uint64_t pts = 0;
+        media::NalIndex nal;
+    };
+
+    /// 在 arena 中为 len 字节找一段连续空间，失败返回 false
+    bool Allocate(size_t len, size_t* offset) const;
+    /// 淘汰最旧一帧，并继续丢弃到下一个关键帧
+    void EvictOldestGop();
+    void PopFront();
+    /// 丢弃已被后续 GOP 覆盖的旧 GOP
+    void TrimToDuration();
+
+    std::vector<uint8_t> arena_;
+    const uint64_t pre_us_;
+    const media::VideoCodec codec_;
+
+    std::deque<Slot> slots_;
+    std::deque<uint64_t> keyframes_;    ///< 缓存中关键帧的序号（升序）
+    uint64_t first_seq_ = 0;
+    size_t bytes_ = 0;
+
+    uint64_t pushed_ = 0;
+    uint64_t space_evictions_ = 0;
+    uint64_t oversized_ = 0;
+};
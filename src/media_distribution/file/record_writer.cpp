@@ -0,0 +1,453 @@
+/**
+ * @file record_writer.cpp
+ * @brief 录制 I/O 层实现
+ *
+ * @author 好软，好温暖
+ * @date 2026-01-31
+ */
+
+#define LOG_TAG "file"
+
+#include "record_writer.h"
+#include "common/logger.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+// ============================================================================
+// RecordIoMetrics
+// ============================================================================
+
+void RecordIoMetrics::Histogram::Record(double ms) {
+    size_t bucket = 0;
+    while (bucket < LatencyHistogram::kBuckets - 1 && ms >= LatencyHistogram::kBoundsMs[bucket]) {
+        bucket++;
+    }
+    counts[bucket]++;
+    total++;
+
+    uint64_t us = static_cast<uint64_t>(ms * 1000.0);
+    sum_us += us;
+    uint64_t prev = max_us.load();
+    while (us > prev && !max_us.compare_exchange_weak(prev, us)) {
+    }
+}
+
+LatencyHistogram RecordIoMetrics::Histogram::Snapshot() const {
+    LatencyHistogram h;
+    for (size_t i = 0; i < LatencyHistogram::kBuckets; i++) {
+        h.counts[i] = counts[i].load();
+    }
+    h.total = total.load();
+    h.sum_ms = sum_us.load() / 1000.0;
+    h.max_ms = max_us.load() / 1000.0;
+    return h;
+}
+
+void RecordIoMetrics::RecordWrite(double ms, size_t bytes, bool patch) {
+    chunks_++;
+    bytes_ += bytes;
+    if (patch) {
+        patches_++;
+    }
+    write_.Record(ms);
+}
+
+void RecordIoMetrics::RecordStall(double ms) {
+    stall_.Record(ms);
+}
+
+RecordIoStats RecordIoMetrics::Snapshot() const {
+    RecordIoStats s;
+    s.chunks = chunks_.load();
+    s.bytes = bytes_.load();
+    s.patches = patches_.load();
+    s.syncs = syncs_.load();
+    s.stalls = stall_.total.load();
+    s.errors = errors_.load();
+    s.write_latency = write_.Snapshot();
+    s.stall_latency = stall_.Snapshot();
+    return s;
+}
+
+// ============================================================================
+// 构造 / 打开 / 关闭
+// ============================================================================
+
+RecordWriter::RecordWriter(const RecordIoConfig& config, std::shared_ptr<RecordIoMetrics> metrics)
+    : config_(config)
+    , metrics_(metrics ? std::move(metrics) : std::make_shared<RecordIoMetrics>()) {
+    // chunk 至少 4KB 且为 4KB 的整数倍，保证 O_DIRECT 下偏移与长度对齐
+    config_.chunk_bytes = std::max<size_t>(
+        (config_.chunk_bytes + kBlockSize - 1) / kBlockSize * kBlockSize, kBlockSize);
+    config_.buffers = std::max(config_.buffers, 2);
+}
+
+RecordWriter::~RecordWriter() {
+    if (fd_ >= 0) {
+        Close();
+    }
+}
+
+bool RecordWriter::Open(const std::string& path) {
+    int flags = O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC;
+    direct_ = config_.direct;
+    if (direct_) {
+        fd_ = open(path.c_str(), flags | O_DIRECT, 0644);
+        if (fd_ < 0) {
+            LOG_WARN("O_DIRECT not supported for {} ({}), using buffered I/O",
+                     path, strerror(errno));
+            direct_ = false;
+        }
+    }
+    if (fd_ < 0) {
+        fd_ = open(path.c_str(), flags, 0644);
+    }
+    if (fd_ < 0) {
+        LOG_ERROR("Could not open output file: {} ({})", path, strerror(errno));
+        return false;
+    }
+    path_ = path;
+
+    // 预分配不改变文件长度（KEEP_SIZE），关闭时截断释放多余部分
+    if (config_.prealloc_bytes > 0 &&
+        fallocate(fd_, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(config_.prealloc_bytes)) != 0) {
+        LOG_DEBUG("fallocate({} bytes) failed for {}: {}", config_.prealloc_bytes, path,
+                  strerror(errno));
+    }
+
+    storage_.resize(config_.buffers + (direct_ ? 1 : 0), nullptr);
+    for (auto& block : storage_) {
+        void* p = nullptr;
+        if (posix_memalign(&p, kBlockSize, config_.chunk_bytes) != 0) {
+            LOG_ERROR("Failed to allocate {} bytes record buffer", config_.chunk_bytes);
+            Close();
+            return false;
+        }
+        block = static_cast<uint8_t*>(p);
+    }
+    buffers_.resize(config_.buffers);
+    for (int i = 0; i < config_.buffers; i++) {
+        buffers_[i].data = storage_[i];
+        free_.push_back(&buffers_[i]);
+    }
+    if (direct_) {
+        scratch_ = storage_.back();
+    }
+
+    current_ = free_.back();
+    free_.pop_back();
+    buf_start_ = 0;
+    fill_ = 0;
+    stop_ = false;
+    failed_ = false;
+    thread_ = std::thread(&RecordWriter::Loop, this);
+
+    LOG_DEBUG("Record writer opened: {} ({}KB x {}{})", path, config_.chunk_bytes / 1024,
+              config_.buffers, direct_ ? ", O_DIRECT" : "");
+    return true;
+}
+
+bool RecordWriter::Close() {
+    if (fd_ < 0) {
+        return false;
+    }
+
+    if (thread_.joinable()) {
+        if (current_ && fill_ > 0) {
+            Submit(false, true);
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        task_cv_.notify_all();
+        thread_.join();
+    }
+
+    // 去掉 O_DIRECT 的尾部填充与 fallocate 的预留空间
+    if (ftruncate(fd_, static_cast<off_t>(Position())) != 0) {
+        LOG_WARN("ftruncate failed for {}: {}", path_, strerror(errno));
+    }
+    close(fd_);
+    fd_ = -1;
+
+    for (auto* block : storage_) {
+        free(block);
+    }
+    storage_.clear();
+    buffers_.clear();
+    free_.clear();
+    current_ = nullptr;
+    scratch_ = nullptr;
+    return !failed_;
+}
+
+// ============================================================================
+// 写入方
+// ============================================================================
+
+bool RecordWriter::Write(const void* data, size_t len) {
+    if (!current_ || failed_) {
+        return false;
+    }
+    const auto* p = static_cast<const uint8_t*>(data);
+    while (len > 0) {
+        size_t n = std::min(len, config_.chunk_bytes - fill_);
+        memcpy(current_->data + fill_, p, n);
+        fill_ += n;
+        p += n;
+        len -= n;
+        if (fill_ == config_.chunk_bytes && !Submit(false)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RecordWriter::Writev(const struct iovec* iov, int count) {
+    for (int i = 0; i < count; i++) {
+        if (!Write(iov[i].iov_base, iov[i].iov_len)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RecordWriter::Pwrite(const void* data, size_t len, uint64_t offset) {
+    if (!current_ || failed_ || offset + len > Position()) {
+        return false;
+    }
+    const auto* p = static_cast<const uint8_t*>(data);
+
+    // 仍在填充缓冲中的部分直接修改
+    if (offset + len > buf_start_) {
+        uint64_t begin = std::max(offset, buf_start_);
+        size_t n = static_cast<size_t>(offset + len - begin);
+        memcpy(current_->data + (begin - buf_start_), p + (begin - offset), n);
+        len -= n;
+    }
+
+    // 已提交的部分排在写盘队列中，保证在对应 chunk 之后写入
+    if (len > 0) {
+        Task task;
+        task.type = Task::Type::kPatch;
+        task.offset = offset;
+        task.len = len;
+        task.patch.assign(p, p + len);
+        Enqueue(std::move(task));
+    }
+    return true;
+}
+
+bool RecordWriter::Flush(bool sync) {
+    if (!current_ || failed_) {
+        return false;
+    }
+    if (fill_ == 0) {
+        if (sync) {
+            Task task;
+            task.type = Task::Type::kSync;
+            Enqueue(std::move(task));
+        }
+        return true;
+    }
+    return Submit(sync);
+}
+
+bool RecordWriter::Submit(bool sync, bool final) {
+    Buffer* full = current_;
+    size_t write_len = fill_;
+    size_t carry = 0;
+    uint8_t tail[kBlockSize];
+
+    if (direct_ && fill_ % kBlockSize != 0) {
+        // O_DIRECT 只能写整块：尾块补零写出，未满的尾块带到下一个缓冲，之后整块重写
+        write_len = (fill_ + kBlockSize - 1) / kBlockSize * kBlockSize;
+        carry = fill_ % kBlockSize;
+        memcpy(tail, full->data + fill_ - carry, carry);
+        memset(full->data + fill_, 0, write_len - fill_);
+    }
+
+    Task task;
+    task.type = Task::Type::kChunk;
+    task.buffer = full;
+    task.offset = buf_start_;
+    task.len = write_len;
+    Enqueue(std::move(task));
+    if (sync) {
+        Task sync_task;
+        sync_task.type = Task::Type::kSync;
+        Enqueue(std::move(sync_task));
+    }
+
+    buf_start_ += fill_ - carry;
+    fill_ = 0;
+    current_ = nullptr;
+    if (final) {
+        buf_start_ += carry;
+        return !failed_;
+    }
+
+    current_ = AcquireBuffer();
+    if (!current_) {
+        return false;
+    }
+    memcpy(current_->data, tail, carry);
+    fill_ = carry;
+    return true;
+}
+
+RecordWriter::Buffer* RecordWriter::AcquireBuffer() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (free_.empty()) {
+        // 写盘跟不上：等待写盘线程归还缓冲
+        auto start = std::chrono::steady_clock::now();
+        free_cv_.wait(lock, [this] { return !free_.empty() || failed_; });
+        metrics_->RecordStall(std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+    if (free_.empty()) {
+        return nullptr;
+    }
+    Buffer* buffer = free_.back();
+    free_.pop_back();
+    return buffer;
+}
+
+void RecordWriter::Enqueue(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    task_cv_.notify_one();
+}
+
+// ============================================================================
+// 写盘线程
+// ============================================================================
+
+void RecordWriter::Loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        task_cv_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+        if (tasks_.empty()) {
+            break;  // stop_ 且队列已清空
+        }
+        Task task = std::move(tasks_.front());
+        tasks_.pop_front();
+        lock.unlock();
+
+        bool ok = !failed_;
+        if (ok) {
+            switch (task.type) {
+                case Task::Type::kChunk:
+                    ok = WriteAt(task.buffer->data, task.len, task.offset);
+                    break;
+                case Task::Type::kPatch:
+                    ok = PatchAt(task.patch.data(), task.len, task.offset);
+                    break;
+                case Task::Type::kSync:
+                    ok = fdatasync(fd_) == 0;
+                    if (ok) {
+                        metrics_->RecordSync();
+                    } else {
+                        LOG_WARN("fdatasync failed for {}: {}", path_, strerror(errno));
+                    }
+                    break;
+            }
+        }
+        if (!ok && !failed_) {
+            failed_ = true;
+            metrics_->RecordError();
+        }
+
+        lock.lock();
+        if (task.buffer) {
+            free_.push_back(task.buffer);
+            free_cv_.notify_one();
+        } else if (failed_) {
+            free_cv_.notify_all();
+        }
+    }
+}
+
+bool RecordWriter::WriteAt(const uint8_t* data, size_t len, uint64_t offset) {
+    auto start = std::chrono::steady_clock::now();
+    const size_t total = len;
+    while (len > 0) {
+        ssize_t n = pwrite(fd_, data, len, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("Write failed for {}: {}", path_, strerror(errno));
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    metrics_->RecordWrite(std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count(), total, false);
+    return true;
+}
+
+bool RecordWriter::PatchAt(const uint8_t* data, size_t len, uint64_t offset) {
+    if (!direct_) {
+        auto start = std::chrono::steady_clock::now();
+        const size_t total = len;
+        bool ok = true;
+        while (len > 0) {
+            ssize_t n = pwrite(fd_, data, len, static_cast<off_t>(offset));
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                ok = false;
+                break;
+            }
+            data += n;
+            len -= static_cast<size_t>(n);
+            offset += static_cast<uint64_t>(n);
+        }
+        if (!ok) {
+            LOG_ERROR("Write failed for {}: {}", path_, strerror(errno));
+            return false;
+        }
+        metrics_->RecordWrite(std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count(), total, true);
+        return true;
+    }
+
+    // O_DIRECT：逐块读改写
+    while (len > 0) {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t block = offset / kBlockSize * kBlockSize;
+        size_t in_block = static_cast<size_t>(offset - block);
+        size_t n = std::min(len, kBlockSize - in_block);
+
+        ssize_t got = pread(fd_, scratch_, kBlockSize, static_cast<off_t>(block));
+        if (got < 0) {
+            LOG_ERROR("Read failed for {}: {}", path_, strerror(errno));
+            return false;
+        }
+        if (static_cast<size_t>(got) < kBlockSize) {
+            memset(scratch_ + got, 0, kBlockSize - static_cast<size_t>(got));
+        }
+        memcpy(scratch_ + in_block, data, n);
+        if (pwrite(fd_, scratch_, kBlockSize, static_cast<off_t>(block)) !=
+            static_cast<ssize_t>(kBlockSize)) {
+            LOG_ERROR("Write failed for {}: {}", path_, strerror(errno));
+            return false;
+        }
+        metrics_->RecordWrite(std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count(), kBlockSize, true);
+
+        data += n;
+        len -= n;
+        offset += n;
+    }
+    return true;
+}
@@ -0,0 +1,205 @@
+/**
+ * @file record_writer.h
+ * @brief 录制 I/O 层 - 对齐、批量写盘
+ *
+ * 逐帧 write() 在 SD 卡 / eMMC 上产生大量小的非对齐写，卡内 FTL 频繁读改写，
+ * 表现为周期性的长时间卡顿，也加速闪存磨损。RecordWriter 把写入攒到预分配的
+ * 对齐缓冲中，按 chunk（默认 512KB，接近擦除块大小）交给独立写盘线程：
+ *
+ * - 缓冲池：1 个填充中 + 其余排队写盘；写盘跟不上时写入方等待空闲缓冲（计为 stall）
+ * - 文件偏移与写入长度均按 chunk / 4KB 对齐，可选 O_DIRECT 绕过页缓存
+ * - 打开时 fallocate 预分配，关闭时截断到实际长度
+ * - Pwrite() 回填已写区域（moof、mdat 长度）：仍在填充缓冲中的直接修改，
+ *   已提交的按顺序排在写盘队列中（O_DIRECT 下读改写所在的 4KB 块）
+ * - 写盘耗时与 stall 耗时记入直方图（RecordIoMetrics，多个分段共享）
+ *
+ * 写入接口只在一个线程调用（写入线程或收尾线程，不并发）。
+ *
+ * @author 好软，好温暖
+ * @date 2026-01-31
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/uio.h>
+
+// ============================================================================
+// 配置与统计
+// ============================================================================
+
+/**
+ * @brief 录制 I/O 配置
+ */
+struct RecordIoConfig {
+    size_t chunk_bytes = 512 * 1024;    ///< 单次写盘大小（4KB 的整数倍）
+    int buffers = 3;                    ///< 缓冲数（≥ 2）
+    bool direct = false;                ///< O_DIRECT（文件系统不支持时自动回退）
+    uint64_t prealloc_bytes = 0;        ///< 打开时 fallocate 预分配的大小，0 表示不预分配
+};
+
+/**
+ * @brief 延迟直方图快照
+ */
+struct LatencyHistogram {
+    static constexpr size_t kBuckets = 10;
+    /// 各桶上限（毫秒），最后一桶为 >= 500ms
+    static constexpr double kBoundsMs[kBuckets - 1] = {1, 2, 5, 10, 20, 50, 100, 200, 500};
+
+    uint64_t counts[kBuckets] = {};
+    uint64_t total = 0;
+    double max_ms = 0.0;
+    double sum_ms = 0.0;
+};
+
+/**
+ * @brief 录制 I/O 统计快照
+ */
+struct RecordIoStats {
+    uint64_t chunks = 0;                ///< 写盘次数（chunk 与回填）
+    uint64_t bytes = 0;                 ///< 写盘字节数（含对齐填充）
+    uint64_t patches = 0;               ///< 回填写次数（已提交区域）
+    uint64_t syncs = 0;                 ///< fdatasync 次数
+    uint64_t stalls = 0;                ///< 写入方等待空闲缓冲的次数
+    uint64_t errors = 0;                ///< 写盘失败次数
+    LatencyHistogram write_latency;     ///< 写盘线程单次 pwrite 耗时
+    LatencyHistogram stall_latency;     ///< 写入方等待空闲缓冲的耗时
+};
+
+/**
+ * @brief 录制 I/O 计数器（原子累加，多个 RecordWriter 共享一份）
+ */
+class RecordIoMetrics {
+public:
+    void RecordWrite(double ms, size_t bytes, bool patch);
+    void RecordStall(double ms);
+    void RecordSync() { syncs_++; }
+    void RecordError() { errors_++; }
+
+    RecordIoStats Snapshot() const;
+
+private:
+    struct Histogram {
+        std::atomic<uint64_t> counts[LatencyHistogram::kBuckets] = {};
+        std::atomic<uint64_t> total{0};
+        std::atomic<uint64_t> sum_us{0};
+        std::atomic<uint64_t> max_us{0};
+
+        void Record(double ms);
+        LatencyHistogram Snapshot() const;
+    };
+
+    std::atomic<uint64_t> chunks_{0};
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> patches_{0};
+    std::atomic<uint64_t> syncs_{0};
+    std::atomic<uint64_t> errors_{0};
+    Histogram write_;
+    Histogram stall_;
+};
+
+// ============================================================================
+// RecordWriter
+// ============================================================================
+
+class RecordWriter {
+public:
+    RecordWriter(const RecordIoConfig& config, std::shared_ptr<RecordIoMetrics> metrics);
+    ~RecordWriter();
+
+    RecordWriter(const RecordWriter&) = delete;
+    RecordWriter& operator=(const RecordWriter&) = delete;
+
+    /**
+     * @brief 创建文件并启动写盘线程
+     */
+    bool Open(const std::string& path);
+
+    /**
+     * @brief 追加数据（拷贝到填充缓冲，缓冲满时提交写盘）
+     */
+    bool Write(const void* data, size_t len);
+    bool Writev(const struct iovec* iov, int count);
+
+    /**
+     * @brief 回填已写区域 [offset, offset + len)，区域必须在 Position() 之前
+     */
+    bool Pwrite(const void* data, size_t len, uint64_t offset);
+
+    /**
+     * @brief 提交填充缓冲中的全部数据（不等待写盘完成）
+     * @param sync 写盘后执行 fdatasync
+     */
+    bool Flush(bool sync = false);
+
+    /**
+     * @brief 写出剩余数据、截断到实际长度并关闭（等待写盘线程退出）
+     */
+    bool Close();
+
+    /// 当前追加位置（即文件逻辑长度）
+    uint64_t Position() const { return buf_start_ + fill_; }
+
+    bool Failed() const { return failed_.load(); }
+
+private:
+    static constexpr size_t kBlockSize = 4096;
+
+    struct Buffer {
+        uint8_t* data = nullptr;
+    };
+
+    struct Task {
+        enum class Type { kChunk, kPatch, kSync };
+        Type type = Type::kChunk;
+        Buffer* buffer = nullptr;       ///< kChunk：写完后归还缓冲池
+        uint64_t offset = 0;
+        size_t len = 0;
+        std::vector<uint8_t> patch;     ///< kPatch：回填内容
+    };
+
+    /// 提交填充缓冲并换一个空闲缓冲（可能等待）；final 时不再换缓冲
+    bool Submit(bool sync, bool final = false);
+    Buffer* AcquireBuffer();
+    void Enqueue(Task task);
+
+    void Loop();
+    bool WriteAt(const uint8_t* data, size_t len, uint64_t offset);
+    bool PatchAt(const uint8_t* data, size_t len, uint64_t offset);
+
+    RecordIoConfig config_;
+    std::shared_ptr<RecordIoMetrics> metrics_;
+    int fd_ = -1;
+    bool direct_ = false;
+    std::string path_;
+
+    // 缓冲池
+    std::vector<uint8_t*> storage_;
+    std::vector<Buffer> buffers_;
+    std::vector<Buffer*> free_;
+
+    // 填充缓冲（写入方独占）
+    Buffer* current_ = nullptr;
+    uint64_t buf_start_ = 0;            ///< 填充缓冲对应的文件偏移（O_DIRECT 下 4KB 对齐）
+    size_t fill_ = 0;
+
+    // 写盘线程
+    std::mutex mutex_;
+    std::condition_variable task_cv_;
+    std::condition_variable free_cv_;
+    std::deque<Task> tasks_;
+    bool stop_ = false;
+    std::atomic<bool> failed_{false};
+    uint8_t* scratch_ = nullptr;        ///< O_DIRECT 读改写用的对齐块
+    std::thread thread_;
+};
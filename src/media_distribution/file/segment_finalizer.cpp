@@ -0,0 +1,72 @@
+/**
+ * @file segment_finalizer.cpp
+ * @brief 分段收尾线程实现
+ *
+ * @author 好软，好温暖
+ * @date 2026-01-31
+ */
+
+#define LOG_TAG "file"
+
+#include "segment_finalizer.h"
+#include "common/logger.h"
+
+SegmentFinalizer::SegmentFinalizer() {
+    thread_ = std::thread(&SegmentFinalizer::Loop, this);
+}
+
+SegmentFinalizer::~SegmentFinalizer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void SegmentFinalizer::Submit(Job job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push_back(std::move(job));
+    }
+    cv_.notify_one();
+}
+
+void SegmentFinalizer::WaitIdle() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_cv_.wait(lock, [this] { return jobs_.empty() && running_ == 0; });
+}
+
+size_t SegmentFinalizer::Pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return jobs_.size() + running_;
+}
+
+void SegmentFinalizer::Loop() {
+    LOG_DEBUG("Segment finalizer thread started");
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+        if (jobs_.empty()) {
+            break;  // stop_ 且队列已清空
+        }
+
+        Job job = std::move(jobs_.front());
+        jobs_.pop_front();
+        running_++;
+        lock.unlock();
+
+        job();
+
+        lock.lock();
+        running_--;
+        if (jobs_.empty() && running_ == 0) {
+            idle_cv_.notify_all();
+        }
+    }
+
+    LOG_DEBUG("Segment finalizer thread exited");
+}
@@ -0,0 +1,59 @@
+/**
+ * @file segment_finalizer.h
+ * @brief 分段收尾线程 - 在后台完成 MP4 trailer、fsync 与录像清理
+ *
+ * av_write_trailer() 需要写出整个 moov，SD 卡上可能耗时数百毫秒；
+ * 若在写入线程同步执行，分段切换 / 停止录制时编码流队列会积压并丢帧。
+ * 录制器把已脱离的旧分段交给本线程收尾，写入线程立刻开始写下一个分段。
+ *
+ * 任务按提交顺序串行执行；析构时执行完所有已提交任务再退出，保证文件完整。
+ *
+ * @author 好软，好温暖
+ * @date 2026-01-31
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+class SegmentFinalizer {
+public:
+    using Job = std::function<void()>;
+
+    SegmentFinalizer();
+    ~SegmentFinalizer();
+
+    SegmentFinalizer(const SegmentFinalizer&) = delete;
+    SegmentFinalizer& operator=(const SegmentFinalizer&) = delete;
+
+    /**
+     * @brief 提交收尾任务（任意线程调用，不阻塞）
+     */
+    void Submit(Job job);
+
+    /**
+     * @brief 等待已提交的任务全部完成
+     */
+    void WaitIdle();
+
+    /**
+     * @brief 尚未完成的任务数（含正在执行的任务）
+     */
+    size_t Pending() const;
+
+private:
+    void Loop();
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable idle_cv_;
+    std::deque<Job> jobs_;
+    size_t running_ = 0;
+    bool stop_ = false;
+    std::thread thread_;
+};
@@ -0,0 +1,582 @@
+/**
+ * @file hls_packager.cpp
+ * @brief LL-HLS 打包器实现
+ *
+ * @author 好软，好温暖
+ * @date 2026-01-31
+ */
+
+#define LOG_TAG "hls"
+
+#include "hls_packager.h"
+#include "file/mp4_muxer.h"
+#include "common/logger.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+constexpr size_t kMaxPartSamples = 64;
+constexpr size_t kMdatHeaderSize = 8;
+
+int64_t NowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// kMp4Timescale 时长转为秒（三位小数）
+std::string Seconds(uint64_t ticks) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.3f", static_cast<double>(ticks) / kMp4Timescale);
+    return buf;
+}
+
+void PutBe32(uint8_t* p, uint32_t v) {
+    p[0] = static_cast<uint8_t>(v >> 24);
+    p[1] = static_cast<uint8_t>(v >> 16);
+    p[2] = static_cast<uint8_t>(v >> 8);
+    p[3] = static_cast<uint8_t>(v);
+}
+
+/**
+ * @brief 以长度前缀格式追加一帧的 NAL（跳过已写入 avcC / hvcC 的参数集）
+ *
+ * @return 追加的字节数（只有参数集的帧为 0）
+ */
+size_t AppendSample(const uint8_t* data, size_t len, const media::NalIndex& nal,
+                    std::vector<uint8_t>* out) {
+    const size_t start = out->size();
+    const media::NalIndex* index = &nal;
+    media::NalIndex rest;
+    size_t base = 0;
+    while (true) {
+        for (uint8_t i = 0; i < index->count; i++) {
+            const media::NalUnit& unit = index->units[i];
+            if (media::nal_is_sps(nal.codec, unit.type) ||
+                media::nal_is_pps(nal.codec, unit.type) ||
+                media::nal_is_vps(nal.codec, unit.type) || unit.PayloadSize() == 0) {
+                continue;
+            }
+            uint8_t prefix[4];
+            PutBe32(prefix, unit.PayloadSize());
+            out->insert(out->end(), prefix, prefix + 4);
+            const uint8_t* payload = data + base + unit.PayloadOffset();
+            out->insert(out->end(), payload, payload + unit.PayloadSize());
+        }
+        if (!index->truncated || index->count == 0) {
+            break;
+        }
+        // 索引被截断：对剩余部分重新建立索引
+        const media::NalUnit& last = index->units[index->count - 1];
+        base += last.offset + last.size;
+        media::build_nal_index(data + base, len - base, nal.codec, &rest);
+        index = &rest;
+    }
+    return out->size() - start;
+}
+
+}  // namespace
+
+// ============================================================================
+// 构造
+// ============================================================================
+
+HlsPackager::HlsPackager(const HlsConfig& config)
+    : config_(config)
+    , part_target_(static_cast<uint32_t>(std::max(config.partTargetMs, 100)) *
+                   (kMp4Timescale / 1000))
+    , part_reserve_(Mp4MoofSize(kMaxPartSamples) + kMdatHeaderSize) {
+    track_.codec = config_.codec;
+    track_.width = config_.width;
+    track_.height = config_.height;
+    track_.default_duration = kMp4Timescale / static_cast<uint32_t>(config_.fps > 0 ? config_.fps : 30);
+    LOG_INFO("HLS packager created: {}x{} {}, part target {}ms, window {} segments",
+             config_.width, config_.height, media::VideoCodecToString(config_.codec),
+             config_.partTargetMs, config_.windowSegments);
+}
+
+HlsPackager::~HlsPackager() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cv_.notify_all();
+}
+
+void HlsPackager::OnGopSnapshotRequest(GopSnapshotCallback callback) {
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    gop_callback_ = std::move(callback);
+}
+
+void HlsPackager::OnKeyframeRequest(KeyframeRequestCallback callback) {
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    keyframe_callback_ = std::move(callback);
+}
+
+// ============================================================================
+// 输入（IO 线程）
+// ============================================================================
+
+void HlsPackager::StreamConsumer(EncodedStreamPtr stream, void* user_data) {
+    auto* packager = static_cast<HlsPackager*>(user_data);
+    if (packager) {
+        packager->SendVideoFrame(stream);
+    }
+}
+
+void HlsPackager::SendVideoFrame(const EncodedStreamPtr& stream) {
+    if (!active_ || !stream || !stream->pstPack) {
+        return;
+    }
+    if (NowMs() - last_request_ms_.load() > config_.idleTimeoutSec * 1000LL) {
+        Deactivate();
+        return;
+    }
+
+    const uint64_t pts = stream->pstPack->u64PTS;
+    if (prime_pending_.exchange(false)) {
+        Prime(pts);
+    }
+    if (has_last_pts_ && pts <= last_pts_) {
+        return;     // 已由 GOP 缓存补打包
+    }
+
+    const auto* data = static_cast<const uint8_t*>(get_stream_vir_addr(stream));
+    if (!data) {
+        return;
+    }
+    const size_t len = get_stream_length(stream);
+    const media::NalIndex* nal = get_stream_nal_index(stream);
+    if (!nal || nal->codec != config_.codec) {
+        media::build_nal_index(data, len, config_.codec, &local_nal_);
+        local_nal_.is_keyframe = local_nal_.is_keyframe || is_stream_keyframe(stream);
+        nal = &local_nal_;
+    }
+    PackageFrame(data, len, *nal, pts);
+}
+
+void HlsPackager::Prime(uint64_t current_pts) {
+    std::vector<EncodedStreamPtr> frames;
+    KeyframeRequestCallback request_keyframe;
+    {
+        std::lock_guard<std::mutex> lock(callback_mutex_);
+        if (gop_callback_) {
+            frames = gop_callback_();
+        }
+        request_keyframe = keyframe_callback_;
+    }
+
+    // 快照可能包含当前帧及之后仍在队列中的帧，这些帧随后按实时帧到达
+    uint64_t primed = 0;
+    for (const auto& frame : frames) {
+        if (!frame || !frame->pstPack || frame->pstPack->u64PTS >= current_pts) {
+            break;
+        }
+        const auto* data = static_cast<const uint8_t*>(get_stream_vir_addr(frame));
+        const media::NalIndex* nal = get_stream_nal_index(frame);
+        if (!data || !nal) {
+            break;
+        }
+        PackageFrame(data, get_stream_length(frame), *nal, frame->pstPack->u64PTS);
+        primed++;
+    }
+
+    primed_frames_ += primed;
+    if (primed > 0) {
+        LOG_INFO("HLS primed with {} cached frames", primed);
+    } else if (request_keyframe) {
+        request_keyframe();
+    }
+}
+
+void HlsPackager::PackageFrame(const uint8_t* data, size_t len, const media::NalIndex& nal,
+                               uint64_t pts) {
+    // 时间戳转换到轨道时间刻度，保证严格递增
+    uint64_t dts = pts * kMp4Timescale / 1000000ULL;
+    if (has_last_ && dts <= last_dts_) {
+        dts = last_dts_ + 1;
+    }
+
+    params_ = nal.params ? nal.params : media::update_parameter_sets(data, nal, params_);
+
+    if (nal.is_keyframe) {
+        if (!params_ || !params_->IsComplete()) {
+            return;
+        }
+        if (params_ != init_params_ && !BuildInit(*params_)) {
+            return;
+        }
+
+        // 关键帧：封口当前 part 与分段，开始新的分段
+        ClosePart(dts);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (in_segment_ && !segments_.empty()) {
+                Segment& last = segments_.back();
+                last.complete = true;
+                segments_published_++;
+                uint32_t seconds = static_cast<uint32_t>(
+                    (last.duration + kMp4Timescale - 1) / kMp4Timescale);
+                target_duration_ = std::max(target_duration_, std::max(seconds, 1u));
+            }
+            Segment segment;
+            segment.msn = next_msn_++;
+            segments_.push_back(std::move(segment));
+            TrimWindowLocked();
+            RebuildPlaylistLocked();
+        }
+        cv_.notify_all();
+        in_segment_ = true;
+        BeginPart();
+    } else if (!in_segment_) {
+        return;     // 等待第一个关键帧
+    } else if (!samples_.empty() &&
+               (dts + last_interval_ - part_first_dts_ > part_target_ ||
+                samples_.size() >= kMaxPartSamples)) {
+        // 加入本帧会超出 PART-TARGET：先发布当前 part
+        ClosePart(dts);
+        BeginPart();
+    }
+
+    size_t size = AppendSample(data, len, nal, &part_->bytes);
+    if (size == 0) {
+        return;     // 只有参数集的帧
+    }
+
+    // 上一个样本的时长在本样本到达时确定
+    if (samples_.empty()) {
+        part_first_dts_ = dts;
+        part_first_sync_ = nal.is_keyframe;
+    } else {
+        samples_.back().duration = static_cast<uint32_t>(dts - last_dts_);
+    }
+    Mp4SampleEntry entry;
+    entry.size = static_cast<uint32_t>(size);
+    entry.duration = track_.default_duration;
+    samples_.push_back(entry);
+
+    if (has_last_) {
+        last_interval_ = static_cast<uint32_t>(dts - last_dts_);
+    }
+    last_dts_ = dts;
+    has_last_ = true;
+    last_pts_ = pts;
+    has_last_pts_ = true;
+    frames_packaged_++;
+}
+
+bool HlsPackager::BuildInit(const media::ParameterSets& params) {
+    if (!BuildDecoderConfigRecord(params, &track_.config_record)) {
+        LOG_ERROR("Failed to build {} from parameter sets",
+                  config_.codec == media::VideoCodec::kH265 ? "hvcC" : "avcC");
+        return false;
+    }
+
+    Mp4BoxBuffer box;
+    WriteMp4Ftyp(box, config_.codec, true);
+    WriteMp4Moov(box, track_, true, {}, {});
+    auto init = std::make_shared<HlsBuffer>();
+    init->bytes.assign(box.Data(), box.Data() + box.Size());
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (init_params_) {
+            // 参数集变化（编码器重建）：旧分段与新 init 段不兼容，清空窗口
+            LOG_WARN("HLS parameter sets changed, restarting playlist");
+            segments_.clear();
+            window_bytes_ = 0;
+            playlist_.reset();
+        }
+        init_ = std::move(init);
+    }
+    part_.reset();
+    samples_.clear();
+    in_segment_ = false;
+    init_params_ = params_;
+    return true;
+}
+
+void HlsPackager::BeginPart() {
+    part_ = std::make_shared<HlsBuffer>();
+    part_->bytes.reserve(part_reserve_ + last_part_bytes_ + last_part_bytes_ / 4);
+    part_->bytes.resize(part_reserve_);
+    samples_.clear();
+}
+
+void HlsPackager::ClosePart(uint64_t next_dts) {
+    if (!part_ || samples_.empty()) {
+        return;
+    }
+    samples_.back().duration = static_cast<uint32_t>(next_dts - last_dts_);
+
+    // moof 右对齐写在 mdat 头之前，有效数据从 begin 开始
+    const size_t moof_size = Mp4MoofSize(samples_.size());
+    const size_t mdat_pos = part_reserve_ - kMdatHeaderSize;
+    Mp4BoxBuffer box;
+    WriteMp4Moof(box, ++sequence_, part_first_dts_, part_first_sync_, samples_,
+                 static_cast<uint32_t>(moof_size + kMdatHeaderSize));
+
+    auto& bytes = part_->bytes;
+    part_->begin = mdat_pos - box.Size();
+    std::copy(box.Data(), box.Data() + box.Size(), bytes.begin() + part_->begin);
+    PutBe32(&bytes[mdat_pos], static_cast<uint32_t>(bytes.size() - mdat_pos));
+    std::copy_n("mdat", 4, bytes.begin() + mdat_pos + 4);
+
+    uint32_t duration = 0;
+    for (const auto& s : samples_) duration += s.duration;
+    last_part_bytes_ = bytes.size() - part_reserve_;
+    const size_t size = part_->size();
+    const bool independent = part_first_sync_;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!segments_.empty()) {
+            Segment& segment = segments_.back();
+            segment.parts.push_back(std::move(part_));
+            segment.part_durations.push_back(duration);
+            segment.part_independent.push_back(independent);
+            segment.duration += duration;
+            segment.bytes += size;
+            window_bytes_ += size;
+            parts_published_++;
+            TrimWindowLocked();
+            RebuildPlaylistLocked();
+        }
+    }
+    cv_.notify_all();
+    part_.reset();
+    samples_.clear();
+}
+
+void HlsPackager::Deactivate() {
+    active_ = false;
+    if (NowMs() - last_request_ms_.load() <= config_.idleTimeoutSec * 1000LL) {
+        // 与新请求的 Touch() 竞争：保持激活
+        active_ = true;
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        segments_.clear();
+        window_bytes_ = 0;
+        playlist_.reset();
+        init_.reset();
+    }
+    cv_.notify_all();
+
+    part_.reset();
+    samples_.clear();
+    init_params_.reset();
+    in_segment_ = false;
+    has_last_ = false;
+    LOG_INFO("HLS packaging stopped (idle {}s)", config_.idleTimeoutSec);
+}
+
+// ============================================================================
+// 窗口与播放列表（持有 mutex_）
+// ============================================================================
+
+void HlsPackager::TrimWindowLocked() {
+    const size_t budget = static_cast<size_t>(config_.memoryBudgetKb) * 1024;
+    auto complete = std::count_if(segments_.begin(), segments_.end(),
+                                  [](const Segment& s) { return s.complete; });
+    while (!segments_.empty() && segments_.front().complete &&
+           (complete > config_.windowSegments || (window_bytes_ > budget && complete > 1))) {
+        window_bytes_ -= segments_.front().bytes;
+        segments_.pop_front();
+        complete--;
+    }
+}
+
+void HlsPackager::RebuildPlaylistLocked() {
+    bool has_part = std::any_of(segments_.begin(), segments_.end(),
+                                [](const Segment& s) { return !s.parts.empty(); });
+    if (!has_part || !init_) {
+        playlist_.reset();
+        return;
+    }
+
+    std::string m3u8;
+    m3u8.reserve(4096);
+    m3u8 += "#EXTM3U\n#EXT-X-VERSION:6\n";
+    m3u8 += "#EXT-X-TARGETDURATION:" + std::to_string(target_duration_) + "\n";
+    m3u8 += "#EXT-X-PART-INF:PART-TARGET=" + Seconds(part_target_) + "\n";
+    m3u8 += "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=" +
+            Seconds(part_target_ * 3) + "\n";
+    m3u8 += "#EXT-X-MEDIA-SEQUENCE:" + std::to_string(segments_.front().msn) + "\n";
+    m3u8 += "#EXT-X-MAP:URI=\"init.mp4\"\n";
+
+    // 只为最近的分段列出 part（更早的 part 客户端不再需要）
+    const size_t part_from = segments_.size() > 3 ? segments_.size() - 3 : 0;
+    for (size_t i = 0; i < segments_.size(); ++i) {
+        const Segment& segment = segments_[i];
+        const std::string msn = std::to_string(segment.msn);
+        if (i >= part_from) {
+            for (size_t p = 0; p < segment.parts.size(); ++p) {
+                m3u8 += "#EXT-X-PART:DURATION=" + Seconds(segment.part_durations[p]) +
+                        ",URI=\"part_" + msn + "_" + std::to_string(p) + ".m4s\"";
+                if (segment.part_independent[p]) {
+                    m3u8 += ",INDEPENDENT=YES";
+                }
+                m3u8 += "\n";
+            }
+        }
+        if (segment.complete) {
+            m3u8 += "#EXTINF:" + Seconds(segment.duration) + ",\nseg_" + msn + ".m4s\n";
+        }
+    }
+
+    // 预告下一个 part：客户端提前发出请求，part 发布后立即返回
+    const Segment& last = segments_.back();
+    m3u8 += "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"part_" + std::to_string(last.msn) + "_" +
+            std::to_string(last.parts.size()) + ".m4s\"\n";
+
+    playlist_ = std::make_shared<const std::string>(std::move(m3u8));
+}
+
+const HlsPackager::Segment* HlsPackager::FindSegmentLocked(uint64_t msn) const {
+    if (segments_.empty() || msn < segments_.front().msn || msn > segments_.back().msn) {
+        return nullptr;
+    }
+    return &segments_[static_cast<size_t>(msn - segments_.front().msn)];
+}
+
+bool HlsPackager::HasPartLocked(uint64_t msn, uint64_t part) const {
+    if (segments_.empty()) {
+        return false;
+    }
+    if (msn < segments_.front().msn) {
+        return true;    // 已移出窗口，返回当前播放列表
+    }
+    const Segment* segment = FindSegmentLocked(msn);
+    return segment && (segment->complete || segment->parts.size() > part);
+}
+
+// ============================================================================
+// 输出（HTTP 线程）
+// ============================================================================
+
+void HlsPackager::Touch() {
+    requests_++;
+    last_request_ms_ = NowMs();
+    if (!active_.exchange(true)) {
+        prime_pending_ = true;
+        LOG_INFO("HLS packaging activated");
+    }
+}
+
+HlsPackager::Result HlsPackager::GetPlaylist(int64_t msn, int64_t part,
+                                             std::shared_ptr<const std::string>* out) {
+    Touch();
+    if (msn >= 0) {
+        blocked_requests_++;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::milliseconds(config_.blockTimeoutMs);
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait_until(lock, deadline, [&] {
+        if (!playlist_) return false;
+        if (msn < 0) return true;
+        if (part < 0) {
+            const Segment* segment = FindSegmentLocked(static_cast<uint64_t>(msn));
+            return (segment && segment->complete) ||
+                   static_cast<uint64_t>(msn) < segments_.front().msn;
+        }
+        return HasPartLocked(static_cast<uint64_t>(msn), static_cast<uint64_t>(part));
+    });
+
+    // 超时返回当前播放列表，由客户端重试
+    if (!playlist_) {
+        return Result::kUnavailable;
+    }
+    *out = playlist_;
+    return Result::kOk;
+}
+
+HlsPackager::Result HlsPackager::GetInit(HlsResource* out) {
+    Touch();
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::milliseconds(config_.blockTimeoutMs);
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!cv_.wait_until(lock, deadline, [this] { return init_ != nullptr; })) {
+        return Result::kUnavailable;
+    }
+    out->chunks = {init_};
+    out->size = init_->size();
+    return Result::kOk;
+}
+
+HlsPackager::Result HlsPackager::GetSegment(uint64_t msn, HlsResource* out) {
+    Touch();
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::milliseconds(config_.blockTimeoutMs);
+    std::unique_lock<std::mutex> lock(mutex_);
+    // 尚未封口的分段等到封口（客户端一般只请求已列出的完整分段）
+    cv_.wait_until(lock, deadline, [&] {
+        const Segment* segment = FindSegmentLocked(msn);
+        return !segment || segment->complete;
+    });
+    const Segment* segment = FindSegmentLocked(msn);
+    if (!segment) {
+        return Result::kNotFound;
+    }
+    if (!segment->complete) {
+        return Result::kUnavailable;
+    }
+    out->chunks = segment->parts;
+    out->size = segment->bytes;
+    return Result::kOk;
+}
+
+HlsPackager::Result HlsPackager::GetPart(uint64_t msn, uint32_t index, HlsResource* out) {
+    Touch();
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // 只允许等待“下一个” part：当前分段的下一个，或下一个分段的第一个
+    auto is_next = [&] {
+        if (segments_.empty()) return false;
+        const Segment& last = segments_.back();
+        return (msn == last.msn && !last.complete && index == last.parts.size()) ||
+               (msn == next_msn_ && index == 0);
+    };
+    auto published = [&] {
+        const Segment* segment = FindSegmentLocked(msn);
+        return segment && segment->parts.size() > index;
+    };
+
+    if (!published() && is_next()) {
+        blocked_requests_++;
+        auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(config_.blockTimeoutMs);
+        cv_.wait_until(lock, deadline, [&] { return published() || !is_next(); });
+    }
+    if (!published()) {
+        return Result::kNotFound;
+    }
+    const Segment* segment = FindSegmentLocked(msn);
+    out->chunks = {segment->parts[index]};
+    out->size = segment->parts[index]->size();
+    return Result::kOk;
+}
+
+// ============================================================================
+// 状态
+// ============================================================================
+
+HlsPackager::Stats HlsPackager::GetStats() const {
+    Stats stats;
+    stats.active = active_.load();
+    stats.framesPackaged = frames_packaged_.load();
+    stats.partsPublished = parts_published_.load();
+    stats.segmentsPublished = segments_published_.load();
+    stats.primedFrames = primed_frames_.load();
+    stats.requests = requests_.load();
+    stats.blockedRequests = blocked_requests_.load();
+    stats.bytesServed = bytes_served_.load();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.firstMsn = segments_.empty() ? next_msn_ : segments_.front().msn;
+    stats.segments = static_cast<uint32_t>(segments_.size());
+    stats.windowBytes = window_bytes_;
+    return stats;
+}
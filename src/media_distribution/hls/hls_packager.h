@@ -0,0 +1,249 @@
+/**
+ * @file hls_packager.h
+ * @brief LL-HLS 打包器 - 编码流一次封装为内存中的 fMP4 part / 分段，供任意数量的 HTTP 观看者
+ *
+ * 作为 AsyncIO 消费者在 IO 线程逐帧打包（mp4_boxes 的 moof / moov 构造，与 fMP4 录制同一套）：
+ * - init 段：ftyp + moov(mvex)，首个关键帧确定参数集后生成
+ * - part：moof + mdat，按 partTargetMs 切分；关键帧开始新的分段（segment），
+ *   分段即其全部 part 的顺序拼接，不另外封装
+ * - 播放列表在每次发布 part 时重新生成一次并缓存，请求只取共享指针
+ *
+ * 观看者数量不影响打包开销：part / 分段 / 播放列表都是不可变的共享缓冲，
+ * HTTP 线程持有引用直接从中写出，不做逐客户端的拷贝或重新封装。
+ *
+ * 按需打包：没有 HTTP 请求时不做任何工作；首个请求激活打包器，下一帧到达时先用
+ * GOP 缓存快照补齐当前 GOP（新观看者立即有完整分段可播），没有缓存时请求 IDR；
+ * idleTimeoutSec 内没有请求则停止打包并释放窗口。
+ *
+ * 阻塞式刷新（LL-HLS CAN-BLOCK-RELOAD）：播放列表请求带 _HLS_msn / _HLS_part 时
+ * 等到对应 part 发布后再返回；预告 part（PRELOAD-HINT）的请求同样等待发布。
+ * 等待发生在 HTTP 线程（条件变量，asio 模式下为独立的阻塞处理线程池，不占用 API 工作线程），
+ * IO 线程只负责发布并通知。
+ *
+ * @author 好软，好温暖
+ * @date 2026-01-31
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "common/media_buffer.h"
+#include "common/nal_index.h"
+#include "file/mp4_boxes.h"
+
+// ============================================================================
+// 配置
+// ============================================================================
+
+struct HlsConfig {
+    media::VideoCodec codec = media::VideoCodec::kH264;
+    int width = 1920;
+    int height = 1080;
+    int fps = 30;
+    int partTargetMs = 500;         ///< part 目标时长（PART-TARGET）
+    int windowSegments = 4;         ///< 播放列表保留的完整分段数
+    int idleTimeoutSec = 30;        ///< 无请求后停止打包
+    int blockTimeoutMs = 3000;      ///< 阻塞式请求的最长等待
+    int memoryBudgetKb = 16384;     ///< 窗口内分段的字节上限，超出时提前淘汰最旧的分段
+};
+
+// ============================================================================
+// 共享缓冲
+// ============================================================================
+
+/**
+ * @brief 不可变的打包结果（init 段 / part）
+ *
+ * part 的 moof 在 mdat 之后才能确定，构造时在缓冲头部预留 moof 空间，
+ * 封口时把 moof 右对齐写在 mdat 之前，有效数据从 begin 开始，避免再拷贝一次负载
+ */
+struct HlsBuffer {
+    std::vector<uint8_t> bytes;
+    size_t begin = 0;
+
+    const uint8_t* data() const { return bytes.data() + begin; }
+    size_t size() const { return bytes.size() - begin; }
+};
+using HlsBufferPtr = std::shared_ptr<const HlsBuffer>;
+
+/**
+ * @brief 一个可供 HTTP 写出的资源：按顺序拼接的若干缓冲（分段 = 其全部 part）
+ */
+struct HlsResource {
+    std::vector<HlsBufferPtr> chunks;
+    size_t size = 0;
+};
+
+// ============================================================================
+// 打包器
+// ============================================================================
+
+class HlsPackager {
+public:
+    /// 激活时获取 GOP 缓存快照（首帧为关键帧，可为空）
+    using GopSnapshotCallback = std::function<std::vector<EncodedStreamPtr>()>;
+    /// 请求关键帧
+    using KeyframeRequestCallback = std::function<void()>;
+
+    /// 播放列表 / 资源请求结果
+    enum class Result { kOk, kNotFound, kUnavailable };
+
+    explicit HlsPackager(const HlsConfig& config);
+    ~HlsPackager();
+
+    HlsPackager(const HlsPackager&) = delete;
+    HlsPackager& operator=(const HlsPackager&) = delete;
+
+    // ========================================================================
+    // 输入（IO 线程）
+    // ========================================================================
+
+    /**
+     * @brief 打包一帧（未激活时直接返回）
+     */
+    void SendVideoFrame(const EncodedStreamPtr& stream);
+
+    /**
+     * @brief 消费者回调（注册到 MediaManager，AsyncIO）
+     */
+    static void StreamConsumer(EncodedStreamPtr stream, void* user_data);
+
+    void OnGopSnapshotRequest(GopSnapshotCallback callback);
+    void OnKeyframeRequest(KeyframeRequestCallback callback);
+
+    // ========================================================================
+    // 输出（HTTP 线程，可阻塞）
+    // ========================================================================
+
+    /**
+     * @brief 获取播放列表
+     *
+     * @param msn _HLS_msn（< 0 表示不阻塞）
+     * @param part _HLS_part（< 0 表示等待整个分段）
+     * @param out 输出播放列表文本
+     * @return kOk；打包器尚未产出任何 part 时等待，超时返回 kUnavailable
+     */
+    Result GetPlaylist(int64_t msn, int64_t part, std::shared_ptr<const std::string>* out);
+
+    /// init 段（ftyp + moov）
+    Result GetInit(HlsResource* out);
+
+    /// 完整分段（其 part 的顺序拼接）
+    Result GetSegment(uint64_t msn, HlsResource* out);
+
+    /// 单个 part；尚未发布的下一个 part（预告）会等待发布
+    Result GetPart(uint64_t msn, uint32_t index, HlsResource* out);
+
+    // ========================================================================
+    // 状态
+    // ========================================================================
+
+    struct Stats {
+        bool active = false;
+        uint64_t framesPackaged = 0;
+        uint64_t partsPublished = 0;
+        uint64_t segmentsPublished = 0;
+        uint64_t primedFrames = 0;          ///< 激活时从 GOP 缓存补打包的帧数
+        uint64_t requests = 0;
+        uint64_t blockedRequests = 0;       ///< 阻塞式刷新 / 预告 part 请求数
+        uint64_t bytesServed = 0;
+        uint64_t firstMsn = 0;              ///< 窗口内首个分段序号
+        uint32_t segments = 0;              ///< 窗口内分段数（含未完成的当前分段）
+        size_t windowBytes = 0;
+    };
+    Stats GetStats() const;
+
+    /// 记录已写出的字节数（HTTP 线程）
+    void AddBytesServed(size_t bytes) { bytes_served_ += bytes; }
+
+    const HlsConfig& config() const { return config_; }
+
+private:
+    /// 一个分段：关键帧开始，part 依次追加，下一个关键帧到达时封口
+    struct Segment {
+        uint64_t msn = 0;
+        std::vector<HlsBufferPtr> parts;
+        std::vector<uint32_t> part_durations;   ///< kMp4Timescale
+        std::vector<bool> part_independent;
+        uint64_t duration = 0;                  ///< kMp4Timescale
+        size_t bytes = 0;
+        bool complete = false;
+    };
+
+    /// 标记一次请求，未激活时激活打包器
+    void Touch();
+
+    // 打包（IO 线程）
+    void PackageFrame(const uint8_t* data, size_t len, const media::NalIndex& nal, uint64_t pts);
+    void Prime(uint64_t current_pts);
+    bool BuildInit(const media::ParameterSets& params);
+    void BeginPart();
+    /// 封口当前 part（next_dts：下一个样本的解码时间，确定最后一个样本的时长）
+    void ClosePart(uint64_t next_dts);
+    void Deactivate();
+    void RebuildPlaylistLocked();
+    void TrimWindowLocked();
+
+    // 查询（持有 mutex_）
+    bool HasPartLocked(uint64_t msn, uint64_t part) const;
+    const Segment* FindSegmentLocked(uint64_t msn) const;
+
+    HlsConfig config_;
+    Mp4TrackInfo track_;
+    const uint32_t part_target_;            ///< kMp4Timescale
+    const size_t part_reserve_;             ///< part 缓冲头部预留的 moof + mdat 头空间
+
+    // 打包状态（仅 IO 线程）
+    media::NalIndex local_nal_;             ///< 帧未经分发器索引时本地建立
+    media::ParameterSetsPtr params_;        ///< 最新参数集
+    media::ParameterSetsPtr init_params_;   ///< 当前 init 段对应的参数集（变化时重建）
+    std::shared_ptr<HlsBuffer> part_;       ///< 正在填充的 part
+    size_t last_part_bytes_ = 0;            ///< 上一个 part 的大小（预分配参考）
+    std::vector<Mp4SampleEntry> samples_;
+    bool part_first_sync_ = false;
+    uint64_t part_first_dts_ = 0;
+    uint64_t last_dts_ = 0;
+    uint32_t last_interval_ = 0;
+    bool has_last_ = false;
+    bool in_segment_ = false;               ///< 已从关键帧开始一个分段
+    uint32_t sequence_ = 0;
+    uint64_t last_pts_ = 0;                 ///< 已打包的最新帧时间戳（补打包去重）
+    bool has_last_pts_ = false;
+
+    // 发布状态（mutex_ 保护，cv_ 通知等待的 HTTP 线程）
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    HlsBufferPtr init_;
+    std::deque<Segment> segments_;
+    uint64_t next_msn_ = 0;
+    std::shared_ptr<const std::string> playlist_;
+    uint32_t target_duration_ = 1;          ///< EXT-X-TARGETDURATION（秒，只增不减）
+    size_t window_bytes_ = 0;
+
+    std::atomic<bool> active_{false};
+    std::atomic<bool> prime_pending_{false};
+    std::atomic<int64_t> last_request_ms_{0};
+
+    std::mutex callback_mutex_;
+    GopSnapshotCallback gop_callback_;
+    KeyframeRequestCallback keyframe_callback_;
+
+    // 统计
+    std::atomic<uint64_t> frames_packaged_{0};
+    std::atomic<uint64_t> parts_published_{0};
+    std::atomic<uint64_t> segments_published_{0};
+    std::atomic<uint64_t> primed_frames_{0};
+    std::atomic<uint64_t> requests_{0};
+    std::atomic<uint64_t> blocked_requests_{0};
+    std::atomic<uint64_t> bytes_served_{0};
+};
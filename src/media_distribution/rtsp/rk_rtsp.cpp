@@ -10,18 +10,54 @@
 #define LOG_TAG "rtsp"
 
 #include "rk_rtsp.h"
-#include "rtsp_demo.h"
+#include "rtsp_session.h"
 #include "common/logger.h"
+#include "common/media_buffer.h"
 
-#include "rk_mpi_mb.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
 #include <thread>
 #include <chrono>
 
+namespace {
+
+std::string Base64(const std::vector<uint8_t>& data) {
+    static const char kTable[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((data.size() + 2) / 3 * 4);
+    size_t i = 0;
+    for (; i + 2 < data.size(); i += 3) {
+        uint32_t v = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+        out += kTable[(v >> 18) & 0x3F];
+        out += kTable[(v >> 12) & 0x3F];
+        out += kTable[(v >> 6) & 0x3F];
+        out += kTable[v & 0x3F];
+    }
+    if (i + 1 == data.size()) {
+        uint32_t v = data[i] << 16;
+        out += kTable[(v >> 18) & 0x3F];
+        out += kTable[(v >> 12) & 0x3F];
+        out += "==";
+    } else if (i + 2 == data.size()) {
+        uint32_t v = (data[i] << 16) | (data[i + 1] << 8);
+        out += kTable[(v >> 18) & 0x3F];
+        out += kTable[(v >> 12) & 0x3F];
+        out += kTable[(v >> 6) & 0x3F];
+        out += '=';
+    }
+    return out;
+}
+
+}  // namespace
+
 // ============================================================================
 // RtspServer 类实现
 // ============================================================================
 
-RtspServer::RtspServer() = default;
+RtspServer::RtspServer()
+    : strand_(IoContext::Instance().Strand(kRtspStrand)) {}
 
 RtspServer::~RtspServer() {
     Deinit();
@@ -34,58 +70,91 @@ bool RtspServer::Init(const RtspConfig& config) {
     }
 
     config_ = config;
+    next_rtp_port_ = static_cast<uint16_t>(config_.rtpPortBase & ~1);
+
+    // 未配置多路径时按 path / codecType 建一路
+    if (config_.mounts.empty()) {
+        RtspMountConfig mount;
+        mount.path = config_.path;
+        mount.codecType = config_.codecType;
+        config_.mounts.push_back(mount);
+    }
+    mounts_.clear();
+    for (const auto& mount_config : config_.mounts) {
+        auto mount = std::make_unique<Mount>();
+        mount->config = mount_config;
+        auto codec = (mount_config.codecType == 2) ? media::VideoCodec::kH265
+                                                   : media::VideoCodec::kH264;
+        mount->packetizer = std::make_unique<RtpPacketizer>(codec,
+                                                            static_cast<size_t>(config_.mtu));
+        mounts_.push_back(std::move(mount));
+    }
+    if (config_.enableMulticast) {
+        for (size_t i = 0; i < mounts_.size(); ++i) {
+            if (!OpenMulticastGroup(*mounts_[i], i)) {
+                LOG_WARN("Multicast disabled for {}", mounts_[i]->config.path);
+            }
+        }
+    }
 
-    // 创建 RTSP demo（带重试机制，等待端口释放）
+    // 创建监听 socket（带重试机制，等待端口释放）
     const int maxRetries = 10;
     const int retryDelayMs = 500;
-    
+
+    asio::ip::tcp::endpoint endpoint(asio::ip::tcp::v4(), static_cast<uint16_t>(config_.port));
     for (int retry = 0; retry < maxRetries; ++retry) {
-        demo_handle_ = create_rtsp_demo(config_.port);
-        if (demo_handle_) {
-            break;  // 成功
+        asio::error_code ec;
+        auto acceptor = std::make_unique<asio::ip::tcp::acceptor>(strand_);
+        acceptor->open(endpoint.protocol(), ec);
+        if (!ec) acceptor->set_option(asio::socket_base::reuse_address(true), ec);
+        if (!ec) acceptor->bind(endpoint, ec);
+        if (!ec) acceptor->listen(asio::socket_base::max_listen_connections, ec);
+        if (!ec) {
+            acceptor_ = std::move(acceptor);
+            break;
         }
-        
+
         if (retry < maxRetries - 1) {
-            LOG_WARN("Port {} may be in use, retrying ({}/{})...", 
-                     config_.port, retry + 1, maxRetries);
+            LOG_WARN("Port {} may be in use ({}), retrying ({}/{})...",
+                     config_.port, ec.message(), retry + 1, maxRetries);
             std::this_thread::sleep_for(std::chrono::milliseconds(retryDelayMs));
         }
     }
-    
-    if (!demo_handle_) {
-        LOG_ERROR("Failed to create RTSP demo on port {} after {} retries", 
-                  config_.port, maxRetries);
-        return false;
-    }
 
-    // 创建 RTSP session
-    session_handle_ = rtsp_new_session(
-        static_cast<rtsp_demo_handle>(demo_handle_), 
-        config_.path.c_str()
-    );
-    if (!session_handle_) {
-        LOG_ERROR("Failed to create RTSP session for path: {}", config_.path);
-        rtsp_del_demo(static_cast<rtsp_demo_handle>(demo_handle_));
-        demo_handle_ = nullptr;
+    if (!acceptor_) {
+        LOG_ERROR("Failed to listen on RTSP port {} after {} retries",
+                  config_.port, maxRetries);
+        for (auto& mount : mounts_) {
+            if (mount->multicast) {
+                asio::error_code ignored;
+                mount->multicast->rtp.close(ignored);
+                mount->multicast->rtcp.close(ignored);
+            }
+        }
+        mounts_.clear();
         return false;
     }
 
-    // 设置视频编码格式
-    int codecId = (config_.codecType == 2) ? RTSP_CODEC_ID_VIDEO_H265 : RTSP_CODEC_ID_VIDEO_H264;
-    rtsp_set_video(
-        static_cast<rtsp_session_handle>(session_handle_), 
-        codecId, 
-        nullptr, 
-        0
-    );
-
-    // 同步时间戳
-    SyncVideoTimestamp();
+    tick_timer_ = std::make_unique<asio::steady_timer>(strand_);
 
+    errors_ = 0;
+    closed_packets_ = 0;
+    closed_dropped_ = 0;
     initialized_ = true;
-    stats_ = Stats{};  // 重置统计
 
-    LOG_INFO("RTSP server initialized on port {}, path: {}", config_.port, config_.path);
+    Accept();
+    ScheduleTick();
+
+    for (const auto& mount : mounts_) {
+        LOG_INFO("RTSP server initialized on port {}, path: {} ({})", config_.port,
+                 mount->config.path, mount->config.codecType == 2 ? "H.265" : "H.264");
+        if (mount->multicast) {
+            LOG_INFO("  multicast: {}:{} ttl {}", mount->multicast->address,
+                     mount->multicast->port, config_.multicastTtl);
+        }
+    }
+    LOG_INFO("RTSP transports: udp{}{}", config_.enableTcp ? ", tcp" : "",
+             config_.enableMulticast ? ", multicast" : "");
     return true;
 }
 
@@ -96,31 +165,265 @@ void RtspServer::Deinit() {
 
     initialized_ = false;
 
-    if (session_handle_) {
-        rtsp_del_session(static_cast<rtsp_session_handle>(session_handle_));
-        session_handle_ = nullptr;
+    asio::error_code ec;
+    if (acceptor_) {
+        acceptor_->close(ec);
+    }
+    if (tick_timer_) {
+        tick_timer_->cancel();
+    }
+
+    std::vector<std::shared_ptr<RtspSession>> sessions;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        sessions.swap(sessions_);
+    }
+    for (auto& session : sessions) {
+        session->Close("server shutdown");
+    }
+
+    for (const auto& mount : mounts_) {
+        LOG_INFO("RTSP {} deinitialized, stats: {} frames, {} bytes sent",
+                 mount->config.path, mount->frames_sent.load(), mount->bytes_sent.load());
+        if (mount->multicast) {
+            mount->multicast->rtp.close(ec);
+            mount->multicast->rtcp.close(ec);
+        }
+    }
+    LOG_INFO("RTSP server deinitialized, {} errors", errors_.load());
+}
+
+// ============================================================================
+// 连接管理
+// ============================================================================
+
+void RtspServer::Accept() {
+    acceptor_->async_accept([this](const asio::error_code& ec, asio::ip::tcp::socket socket) {
+        if (ec == asio::error::operation_aborted || !initialized_) {
+            return;
+        }
+        if (ec) {
+            LOG_WARN("RTSP accept failed: {}", ec.message());
+        } else {
+            size_t count = 0;
+            {
+                std::lock_guard<std::mutex> lock(sessions_mutex_);
+                count = sessions_.size();
+            }
+            if (count >= static_cast<size_t>(config_.maxClients)) {
+                asio::error_code ignored;
+                LOG_WARN("RTSP client limit reached ({}), rejecting {}", config_.maxClients,
+                         socket.remote_endpoint(ignored).address().to_string());
+                socket.close(ignored);
+            } else {
+                auto session = std::make_shared<RtspSession>(std::move(socket), this);
+                {
+                    std::lock_guard<std::mutex> lock(sessions_mutex_);
+                    sessions_.push_back(session);
+                }
+                session->Start();
+            }
+        }
+        Accept();
+    });
+}
+
+void RtspServer::ScheduleTick() {
+    tick_timer_->expires_after(std::chrono::seconds(1));
+    tick_timer_->async_wait([this](const asio::error_code& ec) {
+        if (ec || !initialized_) {
+            return;
+        }
+        Tick();
+        ScheduleTick();
+    });
+}
+
+void RtspServer::Tick() {
+    auto now = std::chrono::steady_clock::now();
+    for (auto& session : sessions_) {
+        session->Tick(now);
+    }
+
+    // 组播组的 SR 由服务器统一发往组 RTCP 端口
+    for (auto& mount : mounts_) {
+        MulticastGroup* group = mount->multicast.get();
+        if (!group || group->state.packets == 0 ||
+            now - group->last_sr < RtspSession::kSenderReportInterval) {
+            continue;
+        }
+        group->last_sr = now;
+        uint8_t report[kRtcpSenderReportSize];
+        BuildSenderReport(group->state, group->last_frame_time, report);
+        asio::error_code ec;
+        group->rtcp.send_to(asio::buffer(report, sizeof(report)), group->rtcp_remote, 0, ec);
+    }
+
+    // 回收已关闭的会话，累计其计数
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    auto it = std::remove_if(sessions_.begin(), sessions_.end(),
+                             [this](const std::shared_ptr<RtspSession>& s) {
+                                 if (!s->IsClosed()) return false;
+                                 closed_packets_ += s->counters().packets.load();
+                                 closed_dropped_ += s->counters().dropped.load();
+                                 return true;
+                             });
+    sessions_.erase(it, sessions_.end());
+}
+
+bool RtspServer::BindRtpPorts(asio::ip::udp::socket& rtp, asio::ip::udp::socket& rtcp,
+                              uint16_t* rtp_port) {
+    // 在 [rtpPortBase, rtpPortBase + 2 * 256) 内轮转寻找空闲的偶数 / 奇数端口对
+    const uint16_t base = static_cast<uint16_t>(config_.rtpPortBase & ~1);
+    const int kPairs = 256;
+    for (int attempt = 0; attempt < kPairs; ++attempt) {
+        uint16_t port = next_rtp_port_;
+        next_rtp_port_ = static_cast<uint16_t>(port + 2);
+        if (next_rtp_port_ >= base + 2 * kPairs || next_rtp_port_ < base) {
+            next_rtp_port_ = base;
+        }
+
+        asio::error_code ec;
+        rtp.open(asio::ip::udp::v4(), ec);
+        if (!ec) rtp.bind(asio::ip::udp::endpoint(asio::ip::udp::v4(), port), ec);
+        if (ec) {
+            rtp.close();
+            continue;
+        }
+        rtcp.open(asio::ip::udp::v4(), ec);
+        if (!ec) {
+            rtcp.bind(asio::ip::udp::endpoint(asio::ip::udp::v4(),
+                                              static_cast<uint16_t>(port + 1)), ec);
+        }
+        if (ec) {
+            rtp.close();
+            rtcp.close();
+            continue;
+        }
+        *rtp_port = port;
+        return true;
+    }
+    LOG_ERROR("No free RTP port pair from {}", base);
+    return false;
+}
+
+bool RtspServer::OpenMulticastGroup(Mount& mount, size_t index) {
+    asio::error_code ec;
+    auto base = asio::ip::make_address_v4(config_.multicastGroup, ec);
+    if (ec || !base.is_multicast()) {
+        LOG_ERROR("Invalid multicast group: {}", config_.multicastGroup);
+        return false;
     }
 
-    if (demo_handle_) {
-        rtsp_del_demo(static_cast<rtsp_demo_handle>(demo_handle_));
-        demo_handle_ = nullptr;
+    auto group = std::make_unique<MulticastGroup>(strand_);
+    auto address = asio::ip::address_v4(base.to_uint() + static_cast<uint32_t>(index));
+    group->address = address.to_string();
+    group->port = static_cast<uint16_t>((config_.multicastPort & ~1) + 2 * index);
+
+    group->rtp.open(asio::ip::udp::v4(), ec);
+    if (!ec) group->rtp.set_option(asio::ip::multicast::hops(config_.multicastTtl), ec);
+    if (!ec) group->rtp.set_option(asio::ip::multicast::enable_loopback(false), ec);
+    if (!ec && !config_.multicastInterface.empty()) {
+        auto iface = asio::ip::make_address_v4(config_.multicastInterface, ec);
+        if (!ec) group->rtp.set_option(asio::ip::multicast::outbound_interface(iface), ec);
+    }
+    if (!ec) group->rtp.connect(asio::ip::udp::endpoint(address, group->port), ec);
+    if (!ec) group->rtp.non_blocking(true, ec);
+    if (!ec) group->rtcp.open(asio::ip::udp::v4(), ec);
+    if (!ec) group->rtcp.set_option(asio::ip::multicast::hops(config_.multicastTtl), ec);
+    if (ec) {
+        LOG_ERROR("Failed to open multicast group {}:{}: {}", group->address, group->port,
+                  ec.message());
+        return false;
+    }
+    const int send_buffer = config_.sendBufferKb * 1024;
+    if (send_buffer > 0) {
+        group->rtp.set_option(asio::socket_base::send_buffer_size(send_buffer), ec);
     }
 
-    LOG_INFO("RTSP server deinitialized, stats: {} frames, {} bytes sent, {} errors",
-             stats_.framesSent, stats_.bytesSent, stats_.errors);
+    group->rtcp_remote = asio::ip::udp::endpoint(address, static_cast<uint16_t>(group->port + 1));
+    group->state.ssrc = static_cast<uint32_t>(std::random_device{}());
+    group->state.seq = static_cast<uint16_t>(std::random_device{}());
+    group->state.timestamp_offset = static_cast<uint32_t>(std::random_device{}());
+    group->last_sr = group->last_frame_time = std::chrono::steady_clock::now();
+    mount.multicast = std::move(group);
+    return true;
 }
 
-bool RtspServer::SendVideoFrame(const EncodedStreamPtr& stream) {
+// ============================================================================
+// SDP
+// ============================================================================
+
+int RtspServer::FindMount(const std::string& path) const {
+    auto matches = [&path](const std::string& mount_path) {
+        return path == mount_path || path.compare(0, mount_path.size() + 1, mount_path + "/") == 0;
+    };
+    for (size_t i = 0; i < mounts_.size(); ++i) {
+        const auto& config = mounts_[i]->config;
+        if (matches(config.path)) return static_cast<int>(i);
+        for (const auto& alias : config.aliases) {
+            if (matches(alias)) return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+std::string RtspServer::BuildSdp(int mount, const std::string& local_ip) const {
+    const Mount& m = *mounts_[mount];
+    const bool hevc = m.packetizer->codec() == media::VideoCodec::kH265;
+
+    std::string sdp;
+    sdp += "v=0\r\n";
+    auto version = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    sdp += "o=- " + std::to_string(version) + " 1 IN IP4 " + local_ip + "\r\n";
+    sdp += "s=aipc\r\n";
+    sdp += "c=IN IP4 0.0.0.0\r\n";
+    sdp += "t=0 0\r\n";
+    sdp += "a=range:npt=0-\r\n";
+    sdp += "a=control:*\r\n";
+    sdp += "m=video 0 RTP/AVP 96\r\n";
+    sdp += hevc ? "a=rtpmap:96 H265/90000\r\n" : "a=rtpmap:96 H264/90000\r\n";
+
+    // 参数集尚未出现时省略 sprop，客户端从码流内的 SPS/PPS 获取
+    const auto& params = m.params;
+    if (hevc) {
+        if (params && params->IsComplete()) {
+            sdp += "a=fmtp:96 sprop-vps=" + Base64(params->vps) +
+                   ";sprop-sps=" + Base64(params->sps) +
+                   ";sprop-pps=" + Base64(params->pps) + "\r\n";
+        }
+    } else {
+        std::string fmtp = "a=fmtp:96 packetization-mode=1";
+        if (params && params->IsComplete() && params->sps.size() >= 4) {
+            char profile[7];
+            snprintf(profile, sizeof(profile), "%02X%02X%02X",
+                     params->sps[1], params->sps[2], params->sps[3]);
+            fmtp += ";profile-level-id=";
+            fmtp += profile;
+            fmtp += ";sprop-parameter-sets=" + Base64(params->sps) + "," + Base64(params->pps);
+        }
+        sdp += fmtp + "\r\n";
+    }
+    sdp += "a=control:trackID=0\r\n";
+    return sdp;
+}
+
+// ============================================================================
+// 推流
+// ============================================================================
+
+bool RtspServer::SendVideoFrame(const EncodedStreamPtr& stream, size_t mount) {
     if (!initialized_ || !stream || !stream->pstPack) {
         LOG_WARN("SendVideoFrame: invalid state or stream");
         return false;
     }
 
-    // 从 MPI buffer 获取虚拟地址
-    void* data = RK_MPI_MB_Handle2VirAddr(stream->pstPack->pMbBlk);
+    // 获取数据虚拟地址（VENC buffer 或 GOP 缓存拷贝）
+    void* data = get_stream_vir_addr(stream);
     if (!data) {
         LOG_ERROR("Failed to get virtual address from MB handle");
-        stats_.errors++;
+        errors_++;
         return false;
     }
 
@@ -129,55 +432,179 @@ bool RtspServer::SendVideoFrame(const EncodedStreamPtr& stream) {
     return SendVideoData(
         static_cast<const uint8_t*>(data),
         stream->pstPack->u32Len,
-        stream->pstPack->u64PTS
+        stream->pstPack->u64PTS,
+        get_stream_nal_index(stream),
+        mount
     );
 }
 
-bool RtspServer::SendVideoData(const uint8_t* data, int len, uint64_t pts) {
-    if (!initialized_ || !data || len <= 0) {
+bool RtspServer::SendVideoData(const uint8_t* data, int len, uint64_t pts,
+                               const media::NalIndex* nal, size_t mount) {
+    if (!initialized_ || !data || len <= 0 || mount >= mounts_.size()) {
         return false;
     }
+    Mount& m = *mounts_[mount];
+    const int index = static_cast<int>(mount);
 
-    int ret = rtsp_tx_video(
-        static_cast<rtsp_session_handle>(session_handle_),
-        data,
-        len,
-        pts
-    );
+    if (!nal || nal->codec != m.packetizer->codec()) {
+        media::build_nal_index(data, static_cast<size_t>(len), m.packetizer->codec(),
+                               &local_nal_);
+        nal = &local_nal_;
+    }
+    m.last_pts = pts;
+    if (nal->params) {
+        m.params = nal->params;
+    } else {
+        m.params = media::update_parameter_sets(data, *nal, m.params);
+    }
 
-    if (ret < 0) {
-        stats_.errors++;
-        return false;
+    // 该路没有正在播放的客户端时不做打包
+    bool any_playing = std::any_of(sessions_.begin(), sessions_.end(),
+                                   [index](const std::shared_ptr<RtspSession>& s) {
+                                       return s->IsPlaying() && s->mount() == index;
+                                   });
+    if (!any_playing) {
+        return true;
     }
 
-    // 处理 RTSP 事件
-    DoEvent();
+    m.packetizer->Packetize(data, static_cast<size_t>(len), *nal, &packets_);
+    if (packets_.empty()) {
+        errors_++;
+        return false;
+    }
 
-    stats_.framesSent++;
-    stats_.bytesSent += len;
+    // 组播：该路所有组播客户端共享一次发送
+    if (m.multicast) {
+        SendMulticast(m, index, pts, nal->is_keyframe);
+    }
+    for (auto& session : sessions_) {
+        if (session->mount() == index) {
+            session->SendFrame(sender_, packets_, pts, nal->is_keyframe);
+        }
+    }
+    packets_.clear();   // 包描述引用帧数据，不跨帧保留
 
+    m.frames_sent++;
+    m.bytes_sent += static_cast<uint64_t>(len);
     return true;
 }
 
-void RtspServer::DoEvent() {
-    if (demo_handle_) {
-        rtsp_do_event(static_cast<rtsp_demo_handle>(demo_handle_));
+void RtspServer::SendMulticast(Mount& mount, int index, uint64_t pts, bool is_keyframe) {
+    MulticastGroup& group = *mount.multicast;
+    bool subscribed = std::any_of(sessions_.begin(), sessions_.end(),
+                                  [index](const std::shared_ptr<RtspSession>& s) {
+                                      return s->IsPlaying() && s->mount() == index &&
+                                             s->transport() == RtspSession::Transport::kMulticast;
+                                  });
+    if (!subscribed) {
+        group.waiting_keyframe = true;
+        return;
+    }
+    if (group.waiting_keyframe) {
+        if (!is_keyframe) {
+            return;
+        }
+        group.waiting_keyframe = false;
     }
-}
 
-void RtspServer::SyncVideoTimestamp() {
-    if (session_handle_) {
-        rtsp_sync_video_ts(
-            static_cast<rtsp_session_handle>(session_handle_),
-            rtsp_get_reltime(),
-            rtsp_get_ntptime()
-        );
+    auto result = sender_.Send(group.rtp.native_handle(), packets_, pts, &group.state);
+    group.last_frame_time = std::chrono::steady_clock::now();
+    group.packets += result.sent;
+    group.bytes += result.bytes;
+    if (result.dropped > 0) {
+        group.dropped += result.dropped;
+        group.waiting_keyframe = true;
+        RequestKeyframe(index);
     }
 }
 
-std::string RtspServer::GetUrl() const {
+void RtspServer::OnKeyframeRequest(KeyframeRequestCallback callback) {
+    std::lock_guard<std::mutex> lock(keyframe_mutex_);
+    keyframe_callback_ = std::move(callback);
+}
+
+void RtspServer::RequestKeyframe(int mount) {
+    std::lock_guard<std::mutex> lock(keyframe_mutex_);
+    if (keyframe_callback_ && mount >= 0) keyframe_callback_(static_cast<size_t>(mount));
+}
+
+// ============================================================================
+// 状态
+// ============================================================================
+
+std::string RtspServer::GetUrl(size_t mount) const {
     // 返回 RTSP URL 格式
-    return "rtsp://<device_ip>:" + std::to_string(config_.port) + config_.path;
+    const std::string& path = mount < config_.mounts.size() ? config_.mounts[mount].path
+                                                            : config_.path;
+    return "rtsp://<device_ip>:" + std::to_string(config_.port) + path;
+}
+
+RtspServer::Stats RtspServer::GetStats() const {
+    Stats stats;
+    stats.errors = errors_.load();
+    for (const auto& mount : mounts_) {
+        MountStats m;
+        m.path = mount->config.path;
+        m.codecType = mount->config.codecType;
+        m.framesSent = mount->frames_sent.load();
+        m.bytesSent = mount->bytes_sent.load();
+        if (mount->multicast) {
+            m.multicastAddress = mount->multicast->address;
+            m.multicastPort = mount->multicast->port;
+            m.multicastPackets = mount->multicast->packets.load();
+            m.multicastBytes = mount->multicast->bytes.load();
+            m.multicastDropped = mount->multicast->dropped.load();
+            stats.packetsSent += m.multicastPackets;
+            stats.packetsDropped += m.multicastDropped;
+        }
+        stats.framesSent += m.framesSent;
+        stats.bytesSent += m.bytesSent;
+        stats.mounts.push_back(std::move(m));
+    }
+    stats.packetsSent += closed_packets_.load();
+    stats.packetsDropped += closed_dropped_.load();
+    stats.tcpEnabled = config_.enableTcp;
+    stats.multicastEnabled = config_.enableMulticast;
+
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    for (const auto& session : sessions_) {
+        const auto& c = session->counters();
+        ClientStats client;
+        client.session_id = session->id();
+        client.address = session->peer();
+        int mount = c.mount.load();
+        if (mount >= 0 && static_cast<size_t>(mount) < stats.mounts.size()) {
+            client.path = stats.mounts[mount].path;
+            if (c.playing.load()) {
+                stats.mounts[mount].playing++;
+                if (c.transport.load() == static_cast<int>(RtspSession::Transport::kMulticast)) {
+                    stats.mounts[mount].multicastSubscribers++;
+                }
+            }
+        }
+        client.transport = RtspSession::TransportName(
+            static_cast<RtspSession::Transport>(c.transport.load()));
+        client.rtpPort = c.rtp_port.load();
+        client.playing = c.playing.load();
+        client.framesSent = c.frames.load();
+        client.packetsSent = c.packets.load();
+        client.bytesSent = c.bytes.load();
+        client.packetsDropped = c.dropped.load();
+        client.sendQueueBytes = c.send_queue_bytes.load();
+        client.sendQueuePeakBytes = c.send_queue_peak.load();
+        client.rtcpReceived = c.rtcp_received.load();
+        client.durationMs = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                now - session->created()).count());
+
+        stats.packetsSent += client.packetsSent;
+        stats.packetsDropped += client.packetsDropped;
+        if (client.playing) stats.playing++;
+        stats.clients.push_back(std::move(client));
+    }
+    stats.sessions = static_cast<uint32_t>(stats.clients.size());
+    return stats;
 }
 
 // ============================================================================
@@ -202,6 +629,6 @@ void rtsp_server_deinit() {
     GetRtspServer().Deinit();
 }
 
-void rtsp_stream_consumer(EncodedStreamPtr stream, void* /* userData */) {
-    GetRtspServer().SendVideoFrame(stream);
-}
\ No newline at end of file
+void rtsp_stream_consumer(EncodedStreamPtr stream, void* /* userData */, size_t mount) {
+    GetRtspServer().SendVideoFrame(stream, mount);
+}
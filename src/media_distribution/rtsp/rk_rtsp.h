@@ -1,10 +1,35 @@
 /**
  * @file rk_rtsp.h
- * @brief RTSP 服务器封装 - 基于 Rockchip rtsp_demo 库
+ * @brief RTSP 服务器 - 基于全局 IoContext 的 RTSP/RTP 推流
  *
  * 提供 RTSP 服务器的初始化、推流、状态查询等功能
  * 支持 H.264/H.265 视频流推送
  *
+ * 事件模型：
+ * - 监听 socket、控制连接、RTCP 全部是注册在全局 IoContext 上的异步操作，
+ *   建连 / 保活 / 拆除由 socket 就绪驱动，不再依赖发帧时顺带轮询
+ * - 每秒一次的定时器负责会话超时与 RTCP SR
+ * - 所有 socket / 定时器都建在 IoContext 的 "rtsp" strand 上（kRtspStrand），
+ *   主 / 子码流消费者也投递到同一 strand：多个 IO 线程时 RTSP 内部仍严格串行，
+ *   下文的“IO 线程”均指该 strand
+ *
+ * 发送路径（IO 线程）：
+ * - 每帧只打包一次，RTP 包描述直接引用 VENC 缓冲（MB_BLK 虚拟地址）
+ * - 逐个客户端以 sendmmsg 分散-聚集发送（RTP 头 + 负载两段 iovec），用户态不拷贝负载
+ * - 新客户端 PLAY 后从下一个关键帧开始接收，并经关键帧请求回调请求 IDR
+ *
+ * 传输方式（客户端在 SETUP 的 Transport 头中选择）：
+ * - UDP 单播：每个客户端一对 RTP/RTCP socket
+ * - UDP 组播（enableMulticast）：每个 mount 一个组播组，每帧只发一次，
+ *   局域网内 N 个订阅者共享同一路 RTP 流，发送包率与订阅者数量无关
+ * - TCP 交织（enableTcp）：RTP/RTCP 复用 RTSP 控制连接，穿越 NAT / 防火墙；
+ *   发送队列有上限，慢客户端整帧丢弃并等待关键帧，交织帧格式不会被截断
+ *
+ * 多路径：一个监听端口上可挂多个 mount（各自的路径、编码格式、打包器与参数集），
+ * 客户端在 DESCRIBE / SETUP 时按 URL 路径绑定到其中一路，只接收该路的帧。
+ * 例如主码流挂 /live/main 供 NVR 存储，子码流挂 /live/sub 供手机端预览，
+ * 两路复用同一端口与同一次 VENC 编码输出。
+ *
  * @author 好软，好温暖
  * @date 2026-01-31
  */
@@ -14,11 +39,21 @@
 #include <cstdint>
 #include <string>
 #include <atomic>
+#include <chrono>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 // RKMPI 头文件
 #include "rk_mpi_venc.h"
 
+#include "common/asio_context.h"
+#include "common/nal_index.h"
+#include "rtp_packetizer.h"
+
+class RtspSession;
+
 // 前向声明编码流智能指针类型
 using EncodedStreamPtr = std::shared_ptr<VENC_STREAM_S>;
 
@@ -26,10 +61,38 @@ using EncodedStreamPtr = std::shared_ptr<VENC_STREAM_S>;
 // RTSP 配置参数
 // ============================================================================
 
-struct RtspConfig {
-    int port = 554;                   ///< RTSP 服务端口
+/**
+ * @brief 一个推流路径（挂载点），对应一路 VENC 码流
+ */
+struct RtspMountConfig {
     std::string path = "/live/0";     ///< 推流路径
     int codecType = 1;                ///< 编码类型：1=H.264, 2=H.265
+    std::vector<std::string> aliases; ///< 等价路径（如兼容旧的 /live/0）
+};
+
+struct RtspConfig {
+    int port = 554;                   ///< RTSP 服务端口
+    std::string path = "/live/0";     ///< 推流路径（mounts 为空时使用）
+    int codecType = 1;                ///< 编码类型：1=H.264, 2=H.265（mounts 为空时使用）
+    /// 多路径：同一端口上按路径区分码流（如 /live/main、/live/sub），下标即 mount 序号；
+    /// 为空时按 path / codecType 建一路
+    std::vector<RtspMountConfig> mounts;
+    int maxClients = 8;               ///< 同时连接的客户端上限
+    int rtpPortBase = 50000;          ///< 服务端 RTP 端口起点（偶数，RTCP = RTP + 1）
+    int mtu = 1400;                   ///< RTP 负载上限（字节）
+    int sessionTimeoutSec = 60;       ///< 无 RTSP 请求且无 RTCP 时的会话超时
+    int sendBufferKb = 512;           ///< 每个客户端 RTP socket 的 SO_SNDBUF（容纳一个关键帧）
+
+    // TCP 交织
+    bool enableTcp = true;            ///< 允许 RTP/AVP/TCP 交织传输
+    int tcpSendQueueKb = 1024;        ///< 每个 TCP 客户端待发送数据上限，超出时整帧丢弃
+
+    // 组播
+    bool enableMulticast = false;     ///< 允许组播传输
+    std::string multicastGroup = "239.255.42.1";    ///< 第 0 路的组播地址，第 N 路为其后第 N 个地址
+    int multicastPort = 52000;        ///< 第 0 路的 RTP 端口（偶数），第 N 路为 +2N，RTCP = RTP + 1
+    int multicastTtl = 4;             ///< 组播 TTL（跳数）
+    std::string multicastInterface;   ///< 组播出口网卡地址（为空时按路由选择）
 };
 
 // ============================================================================
@@ -37,17 +100,20 @@ struct RtspConfig {
 // ============================================================================
 
 /**
- * @brief RTSP 服务器封装类
- * 
- * 封装 Rockchip rtsp_demo 库，提供面向对象的接口
- * 
+ * @brief RTSP 服务器
+ *
  * 使用方式：
- * 1. 创建实例并调用 Init() 初始化
- * 2. 调用 SendVideoFrame() 发送编码后的视频帧
- * 3. 定期调用 DoEvent() 处理 RTSP 事件（或在 SendVideoFrame 中自动调用）
+ * 1. 创建实例并调用 Init() 初始化（在 IoContext 上开始监听）
+ * 2. 在 IO 线程调用 SendVideoFrame() 把各路码流的帧发往对应 mount
  */
+/// RTSP 服务所在的 IO strand（socket、定时器与码流消费者共用）
+constexpr const char* kRtspStrand = "rtsp";
+
 class RtspServer {
 public:
+    /// 某一路的新客户端需要关键帧（IO 线程，接收方负责限频合并）
+    using KeyframeRequestCallback = std::function<void(size_t mount)>;
+
     RtspServer();
     ~RtspServer();
 
@@ -57,7 +123,7 @@ public:
 
     /**
      * @brief 初始化 RTSP 服务器
-     * 
+     *
      * @param config RTSP 配置参数
      * @return true 成功，false 失败
      */
@@ -65,40 +131,37 @@ public:
 
     /**
      * @brief 反初始化 RTSP 服务器
+     *
+     * 在 IoContext 停止后调用（关闭监听 socket 与全部会话）
      */
     void Deinit();
 
     /**
      * @brief 发送编码后的视频帧
-     * 
+     *
      * @param stream 编码流智能指针（来自 StreamDispatcher）
+     * @param mount 目标 mount 序号
      * @return true 成功，false 失败
      */
-    bool SendVideoFrame(const EncodedStreamPtr& stream);
+    bool SendVideoFrame(const EncodedStreamPtr& stream, size_t mount = 0);
 
     /**
-     * @brief 发送原始视频数据
-     * 
-     * @param data 视频数据指针
+     * @brief 发送原始视频数据（IO 线程）
+     *
+     * @param data 视频数据指针（Annex-B）
      * @param len 数据长度
-     * @param pts 时间戳
+     * @param pts 时间戳（微秒）
+     * @param nal 分发器建立的 NAL 索引（为空时本地解析）
+     * @param mount 目标 mount 序号
      * @return true 成功，false 失败
      */
-    bool SendVideoData(const uint8_t* data, int len, uint64_t pts);
+    bool SendVideoData(const uint8_t* data, int len, uint64_t pts,
+                       const media::NalIndex* nal = nullptr, size_t mount = 0);
 
     /**
-     * @brief 处理 RTSP 事件（客户端连接、断开等）
-     * 
-     * 如果设置了自动处理，则无需手动调用此函数
+     * @brief 设置关键帧请求回调
      */
-    void DoEvent();
-
-    /**
-     * @brief 同步视频时间戳
-     * 
-     * 用于保持 RTSP 流的时间戳同步
-     */
-    void SyncVideoTimestamp();
+    void OnKeyframeRequest(KeyframeRequestCallback callback);
 
     /**
      * @brief 检查服务器是否已初始化
@@ -107,28 +170,150 @@ public:
 
     /**
      * @brief 获取 RTSP URL
-     * 
+     *
+     * @param mount mount 序号
      * @return RTSP 播放地址（例如：rtsp://192.168.1.100:554/live/0）
      */
-    std::string GetUrl() const;
+    std::string GetUrl(size_t mount = 0) const;
+
+    /// mount 数量
+    size_t MountCount() const { return mounts_.size(); }
+
+    /**
+     * @brief 单个客户端统计
+     */
+    struct ClientStats {
+        std::string session_id;
+        std::string address;
+        std::string path;                 ///< 绑定的 mount 路径（尚未 SETUP 时为空）
+        std::string transport;            ///< "udp" / "tcp" / "multicast"（尚未 SETUP 时为空）
+        uint16_t rtpPort = 0;             ///< 客户端 RTP 端口（UDP 单播）
+        bool playing = false;
+        uint64_t framesSent = 0;
+        uint64_t packetsSent = 0;
+        uint64_t bytesSent = 0;
+        uint64_t packetsDropped = 0;      ///< 发送缓冲满丢弃的 RTP 包
+        uint32_t sendQueueBytes = 0;      ///< 最近一帧发送后发送队列深度（TCP 含用户态队列）
+        uint32_t sendQueuePeakBytes = 0;  ///< 发送队列深度峰值
+        uint32_t rtcpReceived = 0;        ///< 收到的 RTCP 包数
+        uint64_t durationMs = 0;
+    };
+
+    /**
+     * @brief 单个 mount 统计
+     */
+    struct MountStats {
+        std::string path;
+        int codecType = 1;
+        uint64_t framesSent = 0;      ///< 至少发给一个客户端的帧数
+        uint64_t bytesSent = 0;
+        uint32_t playing = 0;         ///< 正在播放该路的客户端数
+        // 组播（未启用时 multicastAddress 为空）
+        std::string multicastAddress;
+        uint16_t multicastPort = 0;
+        uint32_t multicastSubscribers = 0;  ///< 正在播放的组播客户端数
+        uint64_t multicastPackets = 0;      ///< 组播 RTP 包数（每包只发一次）
+        uint64_t multicastBytes = 0;
+        uint64_t multicastDropped = 0;
+    };
 
     /**
      * @brief 获取推流统计信息
      */
     struct Stats {
-        uint64_t framesSent = 0;      ///< 已发送帧数
-        uint64_t bytesSent = 0;       ///< 已发送字节数
+        uint64_t framesSent = 0;      ///< 已发送帧数（至少发给一个客户端）
+        uint64_t bytesSent = 0;       ///< 已发送字节数（帧数据）
         uint64_t errors = 0;          ///< 发送错误次数
+        uint64_t packetsSent = 0;     ///< 已发送 RTP 包数（所有客户端）
+        uint64_t packetsDropped = 0;  ///< 丢弃的 RTP 包数（所有客户端）
+        uint32_t sessions = 0;        ///< 当前连接数
+        uint32_t playing = 0;         ///< 正在播放的连接数
+        bool tcpEnabled = false;
+        bool multicastEnabled = false;
+        std::vector<MountStats> mounts;
+        std::vector<ClientStats> clients;
     };
-    Stats GetStats() const { return stats_; }
+    Stats GetStats() const;
 
 private:
-    void* demo_handle_ = nullptr;     ///< rtsp_demo_handle
-    void* session_handle_ = nullptr;  ///< rtsp_session_handle
-    
-    std::atomic<bool> initialized_{false};
+    friend class RtspSession;
+
+    void Accept();
+    void ScheduleTick();
+    void Tick();
+
+    /**
+     * @brief 一路推流的组播组：一对 socket 与一份 RTP 流状态，由该路全部组播客户端共享
+     */
+    struct MulticastGroup {
+        explicit MulticastGroup(const IoStrand& strand) : rtp(strand), rtcp(strand) {}
+
+        asio::ip::udp::socket rtp;          ///< connect 到组地址的非阻塞 socket
+        asio::ip::udp::socket rtcp;
+        asio::ip::udp::endpoint rtcp_remote;
+        std::string address;
+        uint16_t port = 0;
+        RtpStreamState state;
+        bool waiting_keyframe = true;       ///< 没有订阅者后重新从关键帧开始
+        std::chrono::steady_clock::time_point last_frame_time;
+        std::chrono::steady_clock::time_point last_sr;
+        std::atomic<uint64_t> packets{0};
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<uint64_t> dropped{0};
+    };
+
+    /**
+     * @brief 一路推流的发送状态（仅 IO 线程访问，计数器除外）
+     */
+    struct Mount {
+        RtspMountConfig config;
+        std::unique_ptr<MulticastGroup> multicast;  ///< 未启用组播时为空
+        std::unique_ptr<RtpPacketizer> packetizer;
+        media::ParameterSetsPtr params;     ///< 最新参数集（SDP sprop 使用）
+        uint64_t last_pts = 0;              ///< 最近一帧的时间戳（PLAY 的 RTP-Info 使用）
+        std::atomic<uint64_t> frames_sent{0};
+        std::atomic<uint64_t> bytes_sent{0};
+    };
+
+    // 供 RtspSession 使用（IO 线程）
+    const RtspConfig& config() const { return config_; }
+    /// 按 URL 路径（含 /trackID=N 等后缀）查找 mount，找不到返回 -1
+    int FindMount(const std::string& path) const;
+    const std::string& MountPath(int mount) const { return mounts_[mount]->config.path; }
+    std::string BuildSdp(int mount, const std::string& local_ip) const;
+    bool BindRtpPorts(asio::ip::udp::socket& rtp, asio::ip::udp::socket& rtcp,
+                      uint16_t* rtp_port);
+    void RequestKeyframe(int mount);
+    uint64_t last_pts(int mount) const { return mounts_[mount]->last_pts; }
+    const MulticastGroup* multicast(int mount) const { return mounts_[mount]->multicast.get(); }
+
+    bool OpenMulticastGroup(Mount& mount, size_t index);
+    void SendMulticast(Mount& mount, int index, uint64_t pts, bool is_keyframe);
+
     RtspConfig config_;
-    Stats stats_;
+    std::atomic<bool> initialized_{false};
+    IoStrand& strand_;
+
+    std::unique_ptr<asio::ip::tcp::acceptor> acceptor_;
+    std::unique_ptr<asio::steady_timer> tick_timer_;
+    uint16_t next_rtp_port_ = 0;
+
+    // 会话列表：仅 IO 线程增删，GetStats() 经 sessions_mutex_ 读取
+    mutable std::mutex sessions_mutex_;
+    std::vector<std::shared_ptr<RtspSession>> sessions_;
+
+    // 发送路径（仅 IO 线程；mounts_ 在 Init() 中建立，运行期间不增删）
+    std::vector<std::unique_ptr<Mount>> mounts_;
+    RtpBatchSender sender_;
+    std::vector<RtpPacket> packets_;
+    media::NalIndex local_nal_;
+
+    std::mutex keyframe_mutex_;
+    KeyframeRequestCallback keyframe_callback_;
+
+    std::atomic<uint64_t> errors_{0};
+    std::atomic<uint64_t> closed_packets_{0};   ///< 已关闭会话累计的 RTP 包数
+    std::atomic<uint64_t> closed_dropped_{0};   ///< 已关闭会话累计的丢包数
 };
 
 // ============================================================================
@@ -146,7 +331,7 @@ RtspServer& GetRtspServer();
 
 /**
  * @brief 初始化全局 RTSP 服务器
- * 
+ *
  * @param config RTSP 配置
  * @return true 成功，false 失败
  */
@@ -159,10 +344,11 @@ void rtsp_server_deinit();
 
 /**
  * @brief 获取 RTSP 流消费者回调
- * 
+ *
  * 用于注册到 StreamDispatcher 的回调函数
- * 
+ *
  * @param stream 编码流
  * @param userData 用户数据（未使用）
+ * @param mount 目标 mount 序号
  */
-void rtsp_stream_consumer(EncodedStreamPtr stream, void* userData);
+void rtsp_stream_consumer(EncodedStreamPtr stream, void* userData, size_t mount = 0);
@@ -0,0 +1,299 @@
+/**
+ * @file rtp_packetizer.cpp
+ * @brief RTP 打包与批量发送实现
+ *
+ * @author 好软，好温暖
+ * @date 2026-01-31
+ */
+
+#include "rtp_packetizer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+
+constexpr uint8_t kH264FuA = 28;
+constexpr uint8_t kH265Fu = 49;
+constexpr uint8_t kFuStart = 0x80;
+constexpr uint8_t kFuEnd = 0x40;
+constexpr size_t kInterleavedHeaderSize = 4;
+
+void PutBe32(uint8_t* p, uint32_t v) {
+    p[0] = static_cast<uint8_t>(v >> 24);
+    p[1] = static_cast<uint8_t>(v >> 16);
+    p[2] = static_cast<uint8_t>(v >> 8);
+    p[3] = static_cast<uint8_t>(v);
+}
+
+}  // namespace
+
+// ============================================================================
+// RtpPacketizer
+// ============================================================================
+
+RtpPacketizer::RtpPacketizer(media::VideoCodec codec, size_t mtu)
+    : codec_(codec)
+    , mtu_(std::max<size_t>(mtu, 64)) {}
+
+void RtpPacketizer::Packetize(const uint8_t* data, size_t size, const media::NalIndex& nal,
+                              std::vector<RtpPacket>* out) const {
+    out->clear();
+    if (!data || size == 0) return;
+
+    size_t end = 0;
+    for (uint8_t i = 0; i < nal.count; ++i) {
+        const auto& unit = nal.units[i];
+        PacketizeNal(data + unit.PayloadOffset(), unit.PayloadSize(), out);
+        end = unit.offset + unit.size;
+    }
+
+    // 超出 kMaxUnits 的 NAL 未被索引，从最后一个已索引单元之后继续扫描
+    media::NalIndex tail;
+    while (nal.truncated && end < size) {
+        size_t base = end;
+        if (media::build_nal_index(data + base, size - base, codec_, &tail) == 0) break;
+        for (uint8_t i = 0; i < tail.count; ++i) {
+            const auto& unit = tail.units[i];
+            PacketizeNal(data + base + unit.PayloadOffset(), unit.PayloadSize(), out);
+            end = base + unit.offset + unit.size;
+        }
+        if (!tail.truncated) break;
+    }
+
+    if (!out->empty()) {
+        out->back().marker = true;
+    }
+}
+
+void RtpPacketizer::PacketizeNal(const uint8_t* nal, size_t size,
+                                 std::vector<RtpPacket>* out) const {
+    const bool hevc = codec_ == media::VideoCodec::kH265;
+    const size_t header_len = hevc ? 2 : 1;
+
+    // 去掉尾部的 trailing zero（下一个起始码前的填充）
+    while (size > header_len && nal[size - 1] == 0) {
+        size--;
+    }
+    if (size <= header_len) return;
+
+    if (size <= mtu_) {
+        RtpPacket packet;
+        packet.payload = nal;
+        packet.size = static_cast<uint32_t>(size);
+        out->push_back(packet);
+        return;
+    }
+
+    // 分片：FU 前缀由原 NAL 头派生，原 NAL 头本身不再发送
+    uint8_t prefix[3];
+    uint8_t prefix_len;
+    uint8_t fu_type;
+    if (hevc) {
+        uint8_t type = static_cast<uint8_t>((nal[0] >> 1) & 0x3F);
+        prefix[0] = static_cast<uint8_t>((nal[0] & 0x81) | (kH265Fu << 1));
+        prefix[1] = nal[1];
+        prefix_len = 3;
+        fu_type = type;
+    } else {
+        prefix[0] = static_cast<uint8_t>((nal[0] & 0xE0) | kH264FuA);
+        prefix_len = 2;
+        fu_type = static_cast<uint8_t>(nal[0] & 0x1F);
+    }
+
+    const size_t chunk = mtu_ - prefix_len;
+    const uint8_t* p = nal + header_len;
+    size_t remaining = size - header_len;
+    bool first = true;
+    while (remaining > 0) {
+        size_t len = std::min(chunk, remaining);
+        RtpPacket packet;
+        packet.payload = p;
+        packet.size = static_cast<uint32_t>(len);
+        std::memcpy(packet.prefix, prefix, prefix_len - 1);
+        uint8_t fu_header = fu_type;
+        if (first) fu_header |= kFuStart;
+        if (len == remaining) fu_header |= kFuEnd;
+        packet.prefix[prefix_len - 1] = fu_header;
+        packet.prefix_len = prefix_len;
+        out->push_back(packet);
+
+        p += len;
+        remaining -= len;
+        first = false;
+    }
+}
+
+void WriteRtpHeader(uint8_t* out, uint8_t payload_type, bool marker, uint16_t seq,
+                    uint32_t timestamp, uint32_t ssrc) {
+    out[0] = 0x80;
+    out[1] = static_cast<uint8_t>((marker ? 0x80 : 0x00) | (payload_type & 0x7F));
+    out[2] = static_cast<uint8_t>(seq >> 8);
+    out[3] = static_cast<uint8_t>(seq & 0xFF);
+    out[4] = static_cast<uint8_t>(timestamp >> 24);
+    out[5] = static_cast<uint8_t>((timestamp >> 16) & 0xFF);
+    out[6] = static_cast<uint8_t>((timestamp >> 8) & 0xFF);
+    out[7] = static_cast<uint8_t>(timestamp & 0xFF);
+    out[8] = static_cast<uint8_t>(ssrc >> 24);
+    out[9] = static_cast<uint8_t>((ssrc >> 16) & 0xFF);
+    out[10] = static_cast<uint8_t>((ssrc >> 8) & 0xFF);
+    out[11] = static_cast<uint8_t>(ssrc & 0xFF);
+}
+
+// ============================================================================
+// RtpBatchSender
+// ============================================================================
+
+RtpBatchSender::Result RtpBatchSender::Send(int fd, const std::vector<RtpPacket>& packets,
+                                            uint64_t timestamp_us, RtpStreamState* state) {
+    Result result;
+    if (fd < 0 || packets.empty()) return result;
+
+    const uint32_t timestamp = state->timestamp_offset + RtpTimestampFromUs(timestamp_us);
+    state->last_timestamp = timestamp;
+
+    headers_.resize(kBatch * kHeaderSlot);
+    iov_.resize(kBatch * 2);
+    msgs_.resize(kBatch);
+
+    size_t index = 0;
+    while (index < packets.size()) {
+        const size_t batch = std::min(kBatch, packets.size() - index);
+        for (size_t i = 0; i < batch; ++i) {
+            const RtpPacket& packet = packets[index + i];
+            uint8_t* header = headers_.data() + i * kHeaderSlot;
+            WriteRtpHeader(header, state->payload_type, packet.marker,
+                           static_cast<uint16_t>(state->seq + i), timestamp, state->ssrc);
+            std::memcpy(header + RtpPacketizer::kRtpHeaderSize, packet.prefix, packet.prefix_len);
+
+            iov_[i * 2].iov_base = header;
+            iov_[i * 2].iov_len = RtpPacketizer::kRtpHeaderSize + packet.prefix_len;
+            iov_[i * 2 + 1].iov_base = const_cast<uint8_t*>(packet.payload);
+            iov_[i * 2 + 1].iov_len = packet.size;
+
+            std::memset(&msgs_[i], 0, sizeof(msgs_[i]));
+            msgs_[i].msg_hdr.msg_iov = &iov_[i * 2];
+            msgs_[i].msg_hdr.msg_iovlen = 2;
+        }
+
+        int ret;
+        do {
+            ret = sendmmsg(fd, msgs_.data(), static_cast<unsigned int>(batch), MSG_DONTWAIT);
+        } while (ret < 0 && errno == EINTR);
+
+        size_t accepted = ret > 0 ? static_cast<size_t>(ret) : 0;
+        for (size_t i = 0; i < accepted; ++i) {
+            const RtpPacket& packet = packets[index + i];
+            result.bytes += iov_[i * 2].iov_len + packet.size;
+            state->octets += packet.prefix_len + packet.size;
+        }
+        result.sent += accepted;
+        state->packets += accepted;
+
+        if (accepted < batch) {
+            // 发送缓冲已满（或出错）：本帧剩余的包全部丢弃，序列号照常推进，
+            // 接收端据此识别丢包，而不是收到错位拼接的帧
+            if (ret < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                result.error = errno;
+            }
+            result.dropped = packets.size() - index - accepted;
+            break;
+        }
+        index += batch;
+    }
+
+    state->seq = static_cast<uint16_t>(state->seq + packets.size());
+    return result;
+}
+
+// ============================================================================
+// TCP 交织
+// ============================================================================
+
+size_t InterleavedFrameSize(const std::vector<RtpPacket>& packets) {
+    size_t total = 0;
+    for (const auto& packet : packets) {
+        total += kInterleavedHeaderSize + RtpPacketizer::kRtpHeaderSize + packet.prefix_len +
+                 packet.size;
+    }
+    return total;
+}
+
+void AppendInterleaved(const std::vector<RtpPacket>& packets, uint64_t timestamp_us,
+                       uint8_t channel, RtpStreamState* state, std::string* out) {
+    const uint32_t timestamp = state->timestamp_offset + RtpTimestampFromUs(timestamp_us);
+    state->last_timestamp = timestamp;
+
+    out->reserve(out->size() + InterleavedFrameSize(packets));
+    for (const auto& packet : packets) {
+        const size_t rtp_len = RtpPacketizer::kRtpHeaderSize + packet.prefix_len + packet.size;
+        uint8_t header[kInterleavedHeaderSize + RtpPacketizer::kRtpHeaderSize + 3];
+        header[0] = '$';
+        header[1] = channel;
+        header[2] = static_cast<uint8_t>(rtp_len >> 8);
+        header[3] = static_cast<uint8_t>(rtp_len & 0xFF);
+        WriteRtpHeader(header + kInterleavedHeaderSize, state->payload_type, packet.marker,
+                       state->seq++, timestamp, state->ssrc);
+        std::memcpy(header + kInterleavedHeaderSize + RtpPacketizer::kRtpHeaderSize,
+                    packet.prefix, packet.prefix_len);
+
+        out->append(reinterpret_cast<const char*>(header),
+                    kInterleavedHeaderSize + RtpPacketizer::kRtpHeaderSize + packet.prefix_len);
+        out->append(reinterpret_cast<const char*>(packet.payload), packet.size);
+        state->packets++;
+        state->octets += packet.prefix_len + packet.size;
+    }
+}
+
+// ============================================================================
+// RTCP
+// ============================================================================
+
+void BuildSenderReport(const RtpStreamState& state,
+                       std::chrono::steady_clock::time_point last_frame_time, uint8_t* out) {
+    std::memset(out, 0, kRtcpSenderReportSize);
+    out[0] = 0x80;
+    out[1] = 200;
+    out[3] = 6;
+    PutBe32(out + 4, state.ssrc);
+
+    auto wall = std::chrono::system_clock::now().time_since_epoch();
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(wall).count();
+    uint64_t ntp_sec = static_cast<uint64_t>(us / 1000000) + 2208988800ULL;
+    uint64_t ntp_frac = (static_cast<uint64_t>(us % 1000000) << 32) / 1000000;
+    PutBe32(out + 8, static_cast<uint32_t>(ntp_sec));
+    PutBe32(out + 12, static_cast<uint32_t>(ntp_frac));
+
+    // 把最近一帧的 RTP 时间戳外推到当前时刻
+    auto since_frame = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - last_frame_time).count();
+    uint32_t rtp_now = state.last_timestamp +
+                       RtpTimestampFromUs(static_cast<uint64_t>(std::max<int64_t>(since_frame, 0)));
+    PutBe32(out + 16, rtp_now);
+    PutBe32(out + 20, static_cast<uint32_t>(state.packets));
+    PutBe32(out + 24, static_cast<uint32_t>(state.octets));
+
+    uint8_t* sdes = out + 28;
+    sdes[0] = 0x81;
+    sdes[1] = 202;
+    sdes[3] = 3;                    // 4 字 - 1
+    PutBe32(sdes + 4, state.ssrc);
+    sdes[8] = 1;                    // CNAME
+    sdes[9] = 4;
+    std::memcpy(sdes + 10, "aipc", 4);
+    // sdes[14..15] = 0：条目结束 + 填充
+}
+
+bool RtcpContainsBye(const uint8_t* data, size_t size) {
+    size_t pos = 0;
+    while (pos + 4 <= size) {
+        uint8_t pt = data[pos + 1];
+        size_t words = (static_cast<size_t>(data[pos + 2]) << 8) | data[pos + 3];
+        if (pt == 203) {
+            return true;
+        }
+        pos += (words + 1) * 4;
+    }
+    return false;
+}
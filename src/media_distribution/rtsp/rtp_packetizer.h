@@ -0,0 +1,189 @@
+/**
+ * @file rtp_packetizer.h
+ * @brief RTP 打包与批量发送 - 直接引用编码缓冲，分散-聚集发送
+ *
+ * 每帧只做一次 NAL 切分 / FU 分片，得到的 RtpPacket 只记录负载在 VENC 缓冲
+ * （MB_BLK 虚拟地址）中的位置和 1~3 字节的分片前缀，不拷贝负载；
+ * 发送时逐个客户端填写 12 字节 RTP 头（序列号 / 时间戳 / SSRC 各不相同），
+ * 以 {RTP 头 + 前缀, 负载} 两段 iovec 组成 mmsghdr，一次 sendmmsg 发出一批包。
+ *
+ * - H.264：RFC 6184 单 NAL 包 / FU-A
+ * - H.265：RFC 7798 单 NAL 包 / FU
+ * - TCP 交织（RFC 2326 10.12）：同一组包描述按 `$ | channel | length` 帧格式追加到
+ *   控制连接的发送队列（TCP 需要把负载拷入用户态队列，不能长期占用 VENC 缓冲）
+ *
+ * @author 好软，好温暖
+ * @date 2026-01-31
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "common/nal_index.h"
+
+// ============================================================================
+// RTP 包描述
+// ============================================================================
+
+/**
+ * @brief 一个 RTP 包（不含 RTP 头）
+ *
+ * payload 指向帧数据内部，只在帧数据有效期间（发送函数返回前）可用
+ */
+struct RtpPacket {
+    const uint8_t* payload = nullptr;
+    uint32_t size = 0;              ///< 负载长度（不含 prefix）
+    uint8_t prefix[3] = {};         ///< FU 指示 / 头（单 NAL 包时为空）
+    uint8_t prefix_len = 0;
+    bool marker = false;            ///< 帧内最后一个包
+};
+
+// ============================================================================
+// 打包器
+// ============================================================================
+
+class RtpPacketizer {
+public:
+    static constexpr size_t kRtpHeaderSize = 12;
+    static constexpr uint32_t kClockRate = 90000;
+
+    /**
+     * @param codec 编码格式
+     * @param mtu 单个 RTP 包负载上限（不含 RTP 头）
+     */
+    explicit RtpPacketizer(media::VideoCodec codec, size_t mtu = 1400);
+
+    /**
+     * @brief 把一帧切分为 RTP 包描述
+     *
+     * @param data Annex-B 帧数据
+     * @param size 帧长度
+     * @param nal 帧的 NAL 索引（truncated 时超出部分在本地补扫）
+     * @param out 输出（先清空）
+     */
+    void Packetize(const uint8_t* data, size_t size, const media::NalIndex& nal,
+                   std::vector<RtpPacket>* out) const;
+
+    media::VideoCodec codec() const { return codec_; }
+
+private:
+    void PacketizeNal(const uint8_t* nal, size_t size, std::vector<RtpPacket>* out) const;
+
+    media::VideoCodec codec_;
+    size_t mtu_;
+};
+
+/**
+ * @brief 写 12 字节 RTP 固定头（V=2，无 CSRC / 扩展）
+ */
+void WriteRtpHeader(uint8_t* out, uint8_t payload_type, bool marker, uint16_t seq,
+                    uint32_t timestamp, uint32_t ssrc);
+
+/**
+ * @brief 微秒时间戳换算为 90kHz RTP 时钟
+ */
+inline uint32_t RtpTimestampFromUs(uint64_t us) {
+    return static_cast<uint32_t>(us * RtpPacketizer::kClockRate / 1000000);
+}
+
+// ============================================================================
+// 批量发送
+// ============================================================================
+
+/**
+ * @brief 单个客户端的 RTP 流状态
+ */
+struct RtpStreamState {
+    uint8_t payload_type = 96;
+    uint32_t ssrc = 0;
+    uint16_t seq = 0;               ///< 下一个包的序列号
+    uint32_t timestamp_offset = 0;  ///< RTP 时间戳随机起点
+    uint32_t last_timestamp = 0;    ///< 最近发送帧的 RTP 时间戳（RTCP SR 使用）
+    uint64_t packets = 0;           ///< 已发送 RTP 包数（RTCP SR 使用）
+    uint64_t octets = 0;            ///< 已发送负载字节数（RTCP SR 使用，不含 RTP 头）
+};
+
+/**
+ * @brief 一帧 RTP 包的分散-聚集发送器
+ *
+ * 头部与 iovec / mmsghdr 数组为复用的成员缓冲，只能在单个线程（IO 线程）中使用
+ */
+class RtpBatchSender {
+public:
+    struct Result {
+        size_t sent = 0;            ///< 内核已接受的包数
+        size_t dropped = 0;         ///< 发送缓冲满（EAGAIN）或出错丢弃的包数
+        size_t bytes = 0;           ///< 已发送字节数（含 RTP 头）
+        int error = 0;              ///< 非 EAGAIN 的 errno（0 = 无）
+    };
+
+    /**
+     * @brief 把一帧的 RTP 包发给已 connect 的非阻塞 UDP socket
+     *
+     * @param fd 目的 socket
+     * @param packets 本帧 RTP 包
+     * @param timestamp_us 帧时间戳（微秒）
+     * @param state 客户端流状态（更新序列号与计数）
+     */
+    Result Send(int fd, const std::vector<RtpPacket>& packets, uint64_t timestamp_us,
+                RtpStreamState* state);
+
+private:
+    static constexpr size_t kBatch = 64;
+    static constexpr size_t kHeaderSlot = 16;   ///< RTP 头 12 + 前缀 ≤ 3
+
+    std::vector<uint8_t> headers_;
+    std::vector<struct iovec> iov_;
+    std::vector<struct mmsghdr> msgs_;
+};
+
+// ============================================================================
+// TCP 交织
+// ============================================================================
+
+/**
+ * @brief 一帧 RTP 包按交织格式编码后的总字节数（含 4 字节交织头与 RTP 头）
+ */
+size_t InterleavedFrameSize(const std::vector<RtpPacket>& packets);
+
+/**
+ * @brief 把一帧 RTP 包以交织格式追加到 out（更新序列号与计数）
+ *
+ * @param packets 本帧 RTP 包
+ * @param timestamp_us 帧时间戳（微秒）
+ * @param channel RTP 交织通道号
+ * @param state 客户端流状态
+ * @param out 发送队列
+ */
+void AppendInterleaved(const std::vector<RtpPacket>& packets, uint64_t timestamp_us,
+                       uint8_t channel, RtpStreamState* state, std::string* out);
+
+// ============================================================================
+// RTCP
+// ============================================================================
+
+/// SR（28 字节）+ SDES CNAME（16 字节）复合包长度
+constexpr size_t kRtcpSenderReportSize = 44;
+
+/**
+ * @brief 构造 RTCP SR + SDES 复合包
+ *
+ * @param state 流状态（SSRC、包数、字节数、最近帧的 RTP 时间戳）
+ * @param last_frame_time 最近一帧的发送时刻（把 RTP 时间戳外推到当前时刻）
+ * @param out 输出缓冲，至少 kRtcpSenderReportSize 字节
+ */
+void BuildSenderReport(const RtpStreamState& state,
+                       std::chrono::steady_clock::time_point last_frame_time, uint8_t* out);
+
+/**
+ * @brief 复合 RTCP 包中是否含 BYE（PT=203）
+ */
+bool RtcpContainsBye(const uint8_t* data, size_t size);
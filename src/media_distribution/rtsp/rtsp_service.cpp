@@ -28,7 +28,9 @@ RtspService::RtspService(const RtspConfig& config)
     }
     
     valid_ = true;
-    LOG_INFO("RTSP streaming initialized, URL: {}", GetRtspServer().GetUrl());
+    for (size_t i = 0; i < GetRtspServer().MountCount(); ++i) {
+        LOG_INFO("RTSP streaming initialized, URL: {}", GetRtspServer().GetUrl(i));
+    }
 }
 
 RtspService::~RtspService() {
@@ -64,20 +66,28 @@ void RtspService::Stop() {
     LOG_INFO("RTSP streaming stopped");
 }
 
-std::string RtspService::GetUrl() const {
-    return GetRtspServer().GetUrl();
+std::string RtspService::GetUrl(size_t mount) const {
+    return GetRtspServer().GetUrl(mount);
+}
+
+size_t RtspService::MountCount() const {
+    return GetRtspServer().MountCount();
 }
 
 RtspServer::Stats RtspService::GetStats() const {
     return GetRtspServer().GetStats();
 }
 
-void RtspService::StreamConsumer(EncodedStreamPtr stream, void* user_data) {
+void RtspService::OnKeyframeRequest(RtspServer::KeyframeRequestCallback callback) {
+    GetRtspServer().OnKeyframeRequest(std::move(callback));
+}
+
+void RtspService::StreamConsumer(EncodedStreamPtr stream, void* user_data, size_t mount) {
     auto* self = static_cast<RtspService*>(user_data);
     
     // 只有在运行状态下才推送帧
     if (self && self->running_) {
-        rtsp_stream_consumer(stream, nullptr);
+        rtsp_stream_consumer(stream, nullptr, mount);
     }
 }
 
@@ -65,19 +65,31 @@ public:
 
     /**
      * @brief 获取 RTSP URL
+     * @param mount mount 序号（多路径时与 RtspConfig::mounts 下标一致）
      */
-    std::string GetUrl() const;
+    std::string GetUrl(size_t mount = 0) const;
+
+    /**
+     * @brief mount 数量
+     */
+    size_t MountCount() const;
 
     /**
      * @brief 获取 RTSP 服务器统计信息
      */
     RtspServer::Stats GetStats() const;
 
+    /**
+     * @brief 设置关键帧请求回调（某一路的新客户端开始播放时请求 IDR，参数为 mount 序号）
+     */
+    void OnKeyframeRequest(RtspServer::KeyframeRequestCallback callback);
+
     /**
      * @brief 流消费者回调（用于注册到 StreamDispatcher）
      * 只有在 running_ 状态下才会推送帧
+     * @param mount 目标 mount 序号（每路码流各注册一个消费者）
      */
-    static void StreamConsumer(EncodedStreamPtr stream, void* user_data);
+    static void StreamConsumer(EncodedStreamPtr stream, void* user_data, size_t mount = 0);
 
 private:
     RtspConfig config_;
@@ -0,0 +1,826 @@
+/**
+ * @file rtsp_session.cpp
+ * @brief RTSP 客户端会话实现
+ *
+ * @author 好软，好温暖
+ * @date 2026-01-31
+ */
+
+#define LOG_TAG "rtsp"
+
+#include "rtsp_session.h"
+#include "rk_rtsp.h"
+#include "common/logger.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <istream>
+#include <random>
+
+#include <linux/sockios.h>
+#include <sys/ioctl.h>
+
+namespace {
+
+constexpr size_t kMaxRequestSize = 8192;
+constexpr size_t kMaxBodySize = 4096;
+
+uint32_t RandomU32() {
+    static std::mt19937 rng{std::random_device{}()};
+    return static_cast<uint32_t>(rng());
+}
+
+std::string Trim(const std::string& s) {
+    size_t begin = s.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) return "";
+    size_t end = s.find_last_not_of(" \t\r\n");
+    return s.substr(begin, end - begin + 1);
+}
+
+std::string ToLower(std::string s) {
+    std::transform(s.begin(), s.end(), s.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return s;
+}
+
+/// rtsp://host[:port]/path[?query] -> /path（不以 rtsp:// 开头时按路径处理）
+std::string UrlPath(const std::string& url) {
+    std::string path = url;
+    size_t scheme = url.find("://");
+    if (scheme != std::string::npos) {
+        size_t slash = url.find('/', scheme + 3);
+        path = slash == std::string::npos ? "/" : url.substr(slash);
+    }
+    size_t query = path.find('?');
+    if (query != std::string::npos) {
+        path.resize(query);
+    }
+    return path;
+}
+
+/// 解析 "a-b" 或 "a" 形式的端口对
+bool ParsePortPair(const std::string& value, uint16_t* first, uint16_t* second) {
+    char* end = nullptr;
+    long a = std::strtol(value.c_str(), &end, 10);
+    if (end == value.c_str() || a <= 0 || a > 65535) return false;
+    long b = a + 1;
+    if (*end == '-') {
+        b = std::strtol(end + 1, nullptr, 10);
+        if (b <= 0 || b > 65535) b = a + 1;
+    }
+    *first = static_cast<uint16_t>(a);
+    *second = static_cast<uint16_t>(b);
+    return true;
+}
+
+/// 解析 "a-b" 或 "a" 形式的交织通道对
+bool ParseChannelPair(const std::string& value, uint8_t* first, uint8_t* second) {
+    char* end = nullptr;
+    long a = std::strtol(value.c_str(), &end, 10);
+    if (end == value.c_str() || a < 0 || a > 255) return false;
+    long b = a + 1;
+    if (*end == '-') {
+        b = std::strtol(end + 1, nullptr, 10);
+        if (b < 0 || b > 255) b = a + 1;
+    }
+    *first = static_cast<uint8_t>(a);
+    *second = static_cast<uint8_t>(b);
+    return true;
+}
+
+/**
+ * @brief 控制连接上一条完整消息的匹配条件（async_read_until 使用）
+ *
+ * TCP 交织模式下客户端的 RTCP 以 `$ | channel | length(16) | data` 帧与 RTSP 请求
+ * 混在同一条连接上，按首字节区分：'$' 按长度取整帧，否则取到请求头结束的空行
+ */
+struct RtspMessageMatch {
+    typedef std::pair<asio::buffers_iterator<asio::streambuf::const_buffers_type>, bool>
+        result_type;
+
+    template <typename Iterator>
+    std::pair<Iterator, bool> operator()(Iterator begin, Iterator end) const {
+        if (begin == end) {
+            return {begin, false};
+        }
+        if (*begin == '$') {
+            if (end - begin < 4) return {begin, false};
+            size_t length = (static_cast<size_t>(static_cast<uint8_t>(begin[2])) << 8) |
+                            static_cast<uint8_t>(begin[3]);
+            if (static_cast<size_t>(end - begin) < 4 + length) return {begin, false};
+            return {begin + 4 + length, true};
+        }
+        static const char kHeaderEnd[] = "\r\n\r\n";
+        Iterator it = std::search(begin, end, kHeaderEnd, kHeaderEnd + 4);
+        if (it == end) return {begin, false};
+        return {it + 4, true};
+    }
+};
+
+/// Transport 头中的参数值（如 client_port=5000-5001），不存在时返回空
+std::string TransportParam(const std::string& transport, const std::string& name) {
+    size_t pos = 0;
+    while (pos < transport.size()) {
+        size_t end = transport.find(';', pos);
+        if (end == std::string::npos) end = transport.size();
+        std::string item = Trim(transport.substr(pos, end - pos));
+        if (item.compare(0, name.size() + 1, name + "=") == 0) {
+            return item.substr(name.size() + 1);
+        }
+        pos = end + 1;
+    }
+    return "";
+}
+
+const char* StatusText(int code) {
+    switch (code) {
+        case 200: return "OK";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 454: return "Session Not Found";
+        case 455: return "Method Not Valid in This State";
+        case 461: return "Unsupported Transport";
+        case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
+        default: return "Error";
+    }
+}
+
+}  // namespace
+
+// ============================================================================
+// 构造 / 关闭
+// ============================================================================
+
+RtspSession::RtspSession(asio::ip::tcp::socket socket, RtspServer* server)
+    : server_(server)
+    , socket_(std::move(socket))
+    , read_buffer_(kMaxRequestSize)
+    , rtp_socket_(socket_.get_executor())     // 与控制连接同在 RTSP strand 上
+    , rtcp_socket_(socket_.get_executor())
+{
+    char id[17];
+    snprintf(id, sizeof(id), "%08X%08X", RandomU32(), RandomU32());
+    id_ = id;
+
+    asio::error_code ec;
+    auto remote = socket_.remote_endpoint(ec);
+    if (!ec) {
+        peer_address_ = remote.address();
+        peer_ = remote.address().to_string() + ":" + std::to_string(remote.port());
+    }
+
+    rtp_.ssrc = RandomU32();
+    rtp_.seq = static_cast<uint16_t>(RandomU32());
+    rtp_.timestamp_offset = RandomU32();
+
+    created_ = last_activity_ = last_sr_ = std::chrono::steady_clock::now();
+}
+
+RtspSession::~RtspSession() = default;
+
+const char* RtspSession::TransportName(Transport transport) {
+    switch (transport) {
+        case Transport::kUdp: return "udp";
+        case Transport::kTcp: return "tcp";
+        case Transport::kMulticast: return "multicast";
+        default: return "";
+    }
+}
+
+void RtspSession::Start() {
+    asio::error_code ec;
+    socket_.set_option(asio::ip::tcp::no_delay(true), ec);
+    LOG_INFO("RTSP client connected: {} (session {})", peer_, id_);
+    ReadRequest();
+}
+
+void RtspSession::Close(const char* reason) {
+    if (closed_) {
+        return;
+    }
+    closed_ = true;
+    state_ = State::kInit;
+    counters_.playing = false;
+
+    asio::error_code ec;
+    socket_.shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+    socket_.close(ec);
+    rtp_socket_.close(ec);
+    rtcp_socket_.close(ec);
+
+    LOG_INFO("RTSP client {} disconnected ({}): {} frames, {} packets, {} dropped",
+             peer_, reason, counters_.frames.load(), counters_.packets.load(),
+             counters_.dropped.load());
+}
+
+// ============================================================================
+// 请求读取
+// ============================================================================
+
+std::string RtspSession::Request::Header(const std::string& name) const {
+    auto it = headers.find(name);
+    return it == headers.end() ? "" : it->second;
+}
+
+void RtspSession::ReadRequest() {
+    auto self = shared_from_this();
+    asio::async_read_until(socket_, read_buffer_, RtspMessageMatch(),
+                           [this, self](const asio::error_code& ec, size_t length) {
+        if (closed_) {
+            return;
+        }
+        if (ec) {
+            Close(ec == asio::error::eof ? "closed by peer" : ec.message().c_str());
+            return;
+        }
+
+        std::string head(asio::buffers_begin(read_buffer_.data()),
+                         asio::buffers_begin(read_buffer_.data()) + length);
+        read_buffer_.consume(length);
+
+        if (head[0] == '$') {
+            HandleInterleaved(reinterpret_cast<const uint8_t*>(head.data()), head.size());
+            if (!closed_) {
+                ReadRequest();
+            }
+            return;
+        }
+
+        Request request;
+        size_t line_end = head.find("\r\n");
+        std::string line = head.substr(0, line_end);
+        size_t sp1 = line.find(' ');
+        size_t sp2 = line.find(' ', sp1 + 1);
+        if (sp1 == std::string::npos || sp2 == std::string::npos) {
+            Close("malformed request");
+            return;
+        }
+        request.method = line.substr(0, sp1);
+        request.url = line.substr(sp1 + 1, sp2 - sp1 - 1);
+
+        size_t pos = line_end + 2;
+        while (pos < head.size()) {
+            size_t end = head.find("\r\n", pos);
+            if (end == std::string::npos || end == pos) break;
+            std::string header = head.substr(pos, end - pos);
+            size_t colon = header.find(':');
+            if (colon != std::string::npos) {
+                request.headers[ToLower(Trim(header.substr(0, colon)))] =
+                    Trim(header.substr(colon + 1));
+            }
+            pos = end + 2;
+        }
+
+        size_t body = std::strtoul(request.Header("content-length").c_str(), nullptr, 10);
+        if (body > kMaxBodySize) {
+            Close("request body too large");
+            return;
+        }
+        if (body > 0) {
+            ReadBody(std::move(request), body);
+            return;
+        }
+        HandleRequest(request);
+        if (!closed_) {
+            ReadRequest();
+        }
+    });
+}
+
+void RtspSession::ReadBody(Request request, size_t length) {
+    // 目前所有请求的 body（SET_PARAMETER 等）都不需要解析，只需跳过
+    if (read_buffer_.size() >= length) {
+        read_buffer_.consume(length);
+        HandleRequest(request);
+        if (!closed_) {
+            ReadRequest();
+        }
+        return;
+    }
+
+    auto self = shared_from_this();
+    auto req = std::make_shared<Request>(std::move(request));
+    asio::async_read(socket_, read_buffer_,
+                     asio::transfer_exactly(length - read_buffer_.size()),
+                     [this, self, req, length](const asio::error_code& ec, size_t) {
+        if (closed_) {
+            return;
+        }
+        if (ec) {
+            Close(ec.message().c_str());
+            return;
+        }
+        read_buffer_.consume(length);
+        HandleRequest(*req);
+        if (!closed_) {
+            ReadRequest();
+        }
+    });
+}
+
+void RtspSession::HandleInterleaved(const uint8_t* data, size_t size) {
+    // data = '$' | channel | length(16) | payload；只关心本会话的 RTCP 通道
+    if (transport_ == Transport::kTcp && data[1] == rtcp_channel_) {
+        HandleRtcp(data + 4, size - 4);
+    }
+}
+
+// ============================================================================
+// 请求处理
+// ============================================================================
+
+void RtspSession::HandleRequest(const Request& request) {
+    last_activity_ = std::chrono::steady_clock::now();
+    LOG_DEBUG("RTSP {} {} from {}", request.method, request.url, peer_);
+
+    if (request.method == "OPTIONS") {
+        HandleOptions(request);
+    } else if (request.method == "DESCRIBE") {
+        HandleDescribe(request);
+    } else if (request.method == "SETUP") {
+        HandleSetup(request);
+    } else if (request.method == "PLAY") {
+        HandlePlay(request);
+    } else if (request.method == "PAUSE") {
+        HandlePause(request);
+    } else if (request.method == "TEARDOWN") {
+        HandleTeardown(request);
+    } else if (request.method == "GET_PARAMETER" || request.method == "SET_PARAMETER") {
+        // 客户端常用的保活请求
+        SendResponse(request, 200);
+    } else {
+        SendResponse(request, 501);
+    }
+}
+
+void RtspSession::HandleOptions(const Request& request) {
+    SendResponse(request, 200,
+                 "Public: OPTIONS, DESCRIBE, SETUP, PLAY, PAUSE, TEARDOWN, "
+                 "GET_PARAMETER, SET_PARAMETER\r\n");
+}
+
+void RtspSession::HandleDescribe(const Request& request) {
+    int mount = ResolveMount(request);
+    if (mount < 0) {
+        return;
+    }
+
+    asio::error_code ec;
+    std::string local_ip = socket_.local_endpoint(ec).address().to_string();
+    std::string base = request.url;
+    if (base.empty() || base.back() != '/') base += '/';
+
+    SendResponse(request, 200,
+                 "Content-Base: " + base + "\r\nContent-Type: application/sdp\r\n",
+                 server_->BuildSdp(mount, local_ip));
+}
+
+void RtspSession::HandleSetup(const Request& request) {
+    int mount = ResolveMount(request);
+    if (mount < 0) {
+        return;
+    }
+    if (state_ != State::kInit && !CheckSession(request)) {
+        return;
+    }
+    // 一个会话只承载一路码流，换路需要新的会话
+    if (mount_ >= 0 && mount != mount_) {
+        SendResponse(request, 455);
+        return;
+    }
+
+    // Transport 可以列出多个逗号分隔的候选，按客户端的偏好顺序取第一个可用的
+    std::string transport = request.Header("transport");
+    std::string reply;
+    int code = 461;
+    size_t pos = 0;
+    while (pos < transport.size()) {
+        size_t end = transport.find(',', pos);
+        if (end == std::string::npos) end = transport.size();
+        code = SetupTransport(Trim(transport.substr(pos, end - pos)), mount, &reply);
+        if (code != 461) break;
+        pos = end + 1;
+    }
+    if (code != 200) {
+        SendResponse(request, code);
+        return;
+    }
+
+    std::string headers =
+        "Transport: " + reply + "\r\n" +
+        "Session: " + id_ + ";timeout=" +
+        std::to_string(server_->config().sessionTimeoutSec) + "\r\n";
+
+    if (state_ == State::kInit) {
+        state_ = State::kReady;
+    }
+    mount_ = mount;
+    counters_.mount = mount;
+    SendResponse(request, 200, headers);
+}
+
+int RtspSession::SetupTransport(const std::string& spec, int mount, std::string* reply) {
+    Transport mode = Transport::kUdp;
+    if (spec.compare(0, 11, "RTP/AVP/TCP") == 0 || spec.find("interleaved") != std::string::npos) {
+        mode = Transport::kTcp;
+    } else if (spec.find("multicast") != std::string::npos) {
+        mode = Transport::kMulticast;
+    } else if (spec.compare(0, 7, "RTP/AVP") != 0) {
+        return 461;
+    }
+    // 播放中不允许切换传输方式
+    if (state_ == State::kPlaying && mode != transport_) {
+        return 455;
+    }
+
+    const RtspConfig& config = server_->config();
+    if (mode == Transport::kTcp) {
+        if (!config.enableTcp) {
+            return 461;
+        }
+        uint8_t rtp_channel = 0;
+        uint8_t rtcp_channel = 1;
+        std::string channels = TransportParam(spec, "interleaved");
+        if (!channels.empty() && !ParseChannelPair(channels, &rtp_channel, &rtcp_channel)) {
+            return 461;
+        }
+        CloseRtpChannel();
+        rtp_channel_ = rtp_channel;
+        rtcp_channel_ = rtcp_channel;
+
+        char ssrc[9];
+        snprintf(ssrc, sizeof(ssrc), "%08X", rtp_.ssrc);
+        *reply = "RTP/AVP/TCP;unicast;interleaved=" + std::to_string(rtp_channel_) + "-" +
+                 std::to_string(rtcp_channel_) + ";ssrc=" + ssrc;
+    } else if (mode == Transport::kMulticast) {
+        const auto* group = config.enableMulticast ? server_->multicast(mount) : nullptr;
+        if (!group) {
+            return 461;
+        }
+        CloseRtpChannel();
+
+        // 组地址与端口由服务器决定，忽略客户端请求的 destination / port
+        char ssrc[9];
+        snprintf(ssrc, sizeof(ssrc), "%08X", group->state.ssrc);
+        *reply = "RTP/AVP;multicast;destination=" + group->address + ";port=" +
+                 std::to_string(group->port) + "-" + std::to_string(group->port + 1) +
+                 ";ttl=" + std::to_string(config.multicastTtl) + ";ssrc=" + ssrc;
+    } else {
+        uint16_t rtp_port = 0;
+        uint16_t rtcp_port = 0;
+        if (!ParsePortPair(TransportParam(spec, "client_port"), &rtp_port, &rtcp_port)) {
+            return 461;
+        }
+        if (!rtp_socket_.is_open() || rtp_port != client_rtp_port_) {
+            if (!OpenRtpChannel(rtp_port, rtcp_port)) {
+                return 500;
+            }
+        }
+
+        char ssrc[9];
+        snprintf(ssrc, sizeof(ssrc), "%08X", rtp_.ssrc);
+        *reply = "RTP/AVP;unicast;client_port=" + std::to_string(client_rtp_port_) + "-" +
+                 std::to_string(client_rtcp_port_) + ";server_port=" +
+                 std::to_string(server_rtp_port_) + "-" + std::to_string(server_rtp_port_ + 1) +
+                 ";ssrc=" + ssrc;
+    }
+
+    transport_ = mode;
+    counters_.transport = static_cast<int>(mode);
+    return 200;
+}
+
+const RtpStreamState& RtspSession::StreamState() const {
+    if (transport_ == Transport::kMulticast) {
+        return server_->multicast(mount_)->state;
+    }
+    return rtp_;
+}
+
+void RtspSession::HandlePlay(const Request& request) {
+    if (!CheckSession(request)) {
+        return;
+    }
+    if (state_ == State::kInit) {
+        SendResponse(request, 455);
+        return;
+    }
+
+    if (state_ != State::kPlaying) {
+        state_ = State::kPlaying;
+        counters_.playing = true;
+        waiting_keyframe_ = true;
+        server_->RequestKeyframe(mount_);
+        if (transport_ == Transport::kUdp) {
+            LOG_INFO("RTSP client {} playing {} via udp (rtp {} -> {})", peer_,
+                     server_->MountPath(mount_), server_rtp_port_, client_rtp_port_);
+        } else {
+            LOG_INFO("RTSP client {} playing {} via {}", peer_, server_->MountPath(mount_),
+                     TransportName(transport_));
+        }
+    }
+
+    std::string track = request.url;
+    if (track.find("trackID=") == std::string::npos) {
+        if (track.empty() || track.back() != '/') track += '/';
+        track += "trackID=0";
+    }
+    const RtpStreamState& stream = StreamState();
+    uint32_t rtptime = stream.timestamp_offset + RtpTimestampFromUs(server_->last_pts(mount_));
+    SendResponse(request, 200,
+                 "Range: npt=0.000-\r\nRTP-Info: url=" + track + ";seq=" +
+                 std::to_string(stream.seq) + ";rtptime=" + std::to_string(rtptime) + "\r\n");
+}
+
+void RtspSession::HandlePause(const Request& request) {
+    if (!CheckSession(request)) {
+        return;
+    }
+    if (state_ == State::kPlaying) {
+        state_ = State::kReady;
+        counters_.playing = false;
+    }
+    SendResponse(request, 200);
+}
+
+void RtspSession::HandleTeardown(const Request& request) {
+    state_ = State::kInit;
+    counters_.playing = false;
+    close_after_write_ = true;
+    SendResponse(request, 200);
+}
+
+int RtspSession::ResolveMount(const Request& request) {
+    int mount = server_->FindMount(UrlPath(request.url));
+    if (mount < 0) {
+        SendResponse(request, 404);
+    }
+    return mount;
+}
+
+bool RtspSession::CheckSession(const Request& request) {
+    std::string session = request.Header("session");
+    session = session.substr(0, session.find(';'));
+    if (Trim(session) == id_) {
+        return true;
+    }
+    SendResponse(request, 454);
+    return false;
+}
+
+// ============================================================================
+// 响应写出
+// ============================================================================
+
+void RtspSession::SendResponse(const Request& request, int code, const std::string& headers,
+                               const std::string& body) {
+    std::string response = "RTSP/1.0 " + std::to_string(code) + " " + StatusText(code) + "\r\n";
+    response += "CSeq: " + request.Header("cseq") + "\r\n";
+    response += "Server: aipc\r\n";
+    if (state_ != State::kInit && headers.find("Session:") == std::string::npos) {
+        response += "Session: " + id_ + "\r\n";
+    }
+    response += headers;
+    if (!body.empty()) {
+        response += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    }
+    response += "\r\n";
+    response += body;
+    Write(response);
+}
+
+void RtspSession::Write(const std::string& data) {
+    if (closed_) {
+        return;
+    }
+    write_queue_ += data;
+    Flush();
+}
+
+void RtspSession::Flush() {
+    if (closed_ || writing_ || write_queue_.empty()) {
+        return;
+    }
+
+    // 交换而非拷贝：两个缓冲轮流使用，容量在会话期间复用
+    writing_ = true;
+    write_pending_.clear();
+    write_pending_.swap(write_queue_);
+    auto self = shared_from_this();
+    asio::async_write(socket_, asio::buffer(write_pending_),
+                      [this, self](const asio::error_code& ec, size_t) {
+        writing_ = false;
+        write_pending_.clear();
+        if (closed_) {
+            return;
+        }
+        if (ec) {
+            Close(ec.message().c_str());
+            return;
+        }
+        if (!write_queue_.empty()) {
+            Flush();
+        } else if (close_after_write_) {
+            Close("teardown");
+        }
+    });
+}
+
+// ============================================================================
+// RTP / RTCP
+// ============================================================================
+
+bool RtspSession::OpenRtpChannel(uint16_t client_rtp_port, uint16_t client_rtcp_port) {
+    asio::error_code ec;
+    rtp_socket_.close(ec);
+    rtcp_socket_.close(ec);
+
+    if (!server_->BindRtpPorts(rtp_socket_, rtcp_socket_, &server_rtp_port_)) {
+        return false;
+    }
+
+    rtp_socket_.connect(asio::ip::udp::endpoint(peer_address_, client_rtp_port), ec);
+    if (ec) {
+        LOG_ERROR("RTP connect to {}:{} failed: {}", peer_address_.to_string(),
+                  client_rtp_port, ec.message());
+        rtp_socket_.close(ec);
+        rtcp_socket_.close(ec);
+        return false;
+    }
+    rtp_socket_.non_blocking(true, ec);
+    rtcp_socket_.non_blocking(true, ec);
+
+    const int send_buffer = server_->config().sendBufferKb * 1024;
+    if (send_buffer > 0) {
+        rtp_socket_.set_option(asio::socket_base::send_buffer_size(send_buffer), ec);
+    }
+
+    client_rtp_port_ = client_rtp_port;
+    client_rtcp_port_ = client_rtcp_port;
+    counters_.rtp_port = client_rtp_port;
+    rtcp_remote_ = asio::ip::udp::endpoint(peer_address_, client_rtcp_port);
+    ReceiveRtcp();
+    return true;
+}
+
+void RtspSession::CloseRtpChannel() {
+    asio::error_code ec;
+    rtp_socket_.close(ec);
+    rtcp_socket_.close(ec);
+    client_rtp_port_ = 0;
+    client_rtcp_port_ = 0;
+    counters_.rtp_port = 0;
+}
+
+void RtspSession::SendFrame(RtpBatchSender& sender, const std::vector<RtpPacket>& packets,
+                            uint64_t timestamp_us, bool is_keyframe) {
+    if (closed_ || state_ != State::kPlaying) {
+        return;
+    }
+    if (waiting_keyframe_) {
+        if (!is_keyframe) {
+            return;
+        }
+        waiting_keyframe_ = false;
+        LOG_INFO("RTSP client {} received first keyframe", peer_);
+    }
+
+    if (transport_ == Transport::kMulticast) {
+        // 组播 RTP 已由 RtspServer 按组发出一次
+        counters_.frames++;
+        return;
+    }
+    if (transport_ == Transport::kTcp) {
+        SendInterleaved(packets, timestamp_us);
+        return;
+    }
+
+    auto result = sender.Send(rtp_socket_.native_handle(), packets, timestamp_us, &rtp_);
+    last_frame_time_ = std::chrono::steady_clock::now();
+
+    counters_.frames++;
+    counters_.packets += result.sent;
+    counters_.bytes += result.bytes;
+    if (result.dropped > 0) {
+        counters_.dropped += result.dropped;
+        // 丢了半帧，后续帧依赖关系已断；等下一个关键帧再恢复发送
+        waiting_keyframe_ = true;
+        server_->RequestKeyframe(mount_);
+        LOG_DEBUG("RTSP client {} dropped {} packets (errno {})", peer_, result.dropped,
+                  result.error);
+    }
+    SampleSendQueue();
+}
+
+void RtspSession::SendInterleaved(const std::vector<RtpPacket>& packets, uint64_t timestamp_us) {
+    // 负载必须拷入队列：TCP 客户端可能很慢，不能让队列长期持有 VENC 缓冲
+    const size_t frame_size = InterleavedFrameSize(packets);
+    const size_t queued = write_pending_.size() + write_queue_.size();
+    const size_t limit = static_cast<size_t>(server_->config().tcpSendQueueKb) * 1024;
+    if (limit > 0 && queued > 0 && queued + frame_size > limit) {
+        // 只整帧丢弃，已入队的交织帧保持完整；序列号不推进（TCP 本身不丢包），
+        // 客户端从下一个关键帧继续解码
+        counters_.dropped += packets.size();
+        waiting_keyframe_ = true;
+        server_->RequestKeyframe(mount_);
+        LOG_DEBUG("RTSP client {} tcp queue full ({} bytes), dropped frame", peer_, queued);
+        SampleSendQueue();
+        return;
+    }
+
+    AppendInterleaved(packets, timestamp_us, rtp_channel_, &rtp_, &write_queue_);
+    last_frame_time_ = std::chrono::steady_clock::now();
+    counters_.frames++;
+    counters_.packets += packets.size();
+    counters_.bytes += frame_size;
+    Flush();
+    SampleSendQueue();
+}
+
+void RtspSession::SampleSendQueue() {
+    // TCP：内核发送队列 + 用户态待发送数据；UDP：RTP socket 的内核发送队列
+    const bool tcp = transport_ == Transport::kTcp;
+    int fd = tcp ? socket_.native_handle() : rtp_socket_.native_handle();
+    int queued = 0;
+    if (ioctl(fd, SIOCOUTQ, &queued) == 0 && queued >= 0) {
+        uint32_t depth = static_cast<uint32_t>(queued);
+        if (tcp) {
+            depth += static_cast<uint32_t>(write_pending_.size() + write_queue_.size());
+        }
+        counters_.send_queue_bytes = depth;
+        if (depth > counters_.send_queue_peak.load()) {
+            counters_.send_queue_peak = depth;
+        }
+    }
+}
+
+void RtspSession::ReceiveRtcp() {
+    auto self = shared_from_this();
+    rtcp_socket_.async_receive_from(
+        asio::buffer(rtcp_buffer_), rtcp_sender_,
+        [this, self](const asio::error_code& ec, size_t length) {
+            if (closed_ || ec == asio::error::operation_aborted) {
+                return;
+            }
+            // 套接字未 connect：只接受 SETUP 协商的客户端 RTCP 端口发来的包，
+            // 其他来源伪造的 BYE / 保活一律丢弃
+            if (!ec && rtcp_sender_ == rtcp_remote_ && !HandleRtcp(rtcp_buffer_, length)) {
+                return;
+            }
+            ReceiveRtcp();
+        });
+}
+
+bool RtspSession::HandleRtcp(const uint8_t* data, size_t size) {
+    last_activity_ = std::chrono::steady_clock::now();
+    counters_.rtcp_received++;
+
+    // 复合包中任一 BYE 都视为客户端离开
+    if (RtcpContainsBye(data, size)) {
+        Close("rtcp bye");
+        return false;
+    }
+    return true;
+}
+
+void RtspSession::SendSenderReport() {
+    uint8_t report[kRtcpSenderReportSize];
+    BuildSenderReport(rtp_, last_frame_time_, report);
+
+    if (transport_ == Transport::kTcp) {
+        std::string frame;
+        frame += '$';
+        frame += static_cast<char>(rtcp_channel_);
+        frame += static_cast<char>(0);
+        frame += static_cast<char>(sizeof(report));
+        frame.append(reinterpret_cast<const char*>(report), sizeof(report));
+        Write(frame);
+        return;
+    }
+
+    asio::error_code ec;
+    rtcp_socket_.send_to(asio::buffer(report, sizeof(report)), rtcp_remote_, 0, ec);
+}
+
+void RtspSession::Tick(std::chrono::steady_clock::time_point now) {
+    if (closed_) {
+        return;
+    }
+
+    auto timeout = std::chrono::seconds(server_->config().sessionTimeoutSec);
+    if (now - last_activity_ > timeout) {
+        Close("timeout");
+        return;
+    }
+
+    // 组播的 SR 由 RtspServer 按组发送
+    if (state_ == State::kPlaying && transport_ != Transport::kMulticast && rtp_.packets > 0 &&
+        now - last_sr_ >= kSenderReportInterval) {
+        last_sr_ = now;
+        SendSenderReport();
+    }
+}
@@ -0,0 +1,192 @@
+/**
+ * @file rtsp_session.h
+ * @brief RTSP 客户端会话 - 单个 RTSP 控制连接及其 RTP/RTCP 通道
+ *
+ * 每个 TCP 控制连接对应一个 RtspSession，全部异步操作注册在全局 IoContext 上：
+ * - 控制连接：async_read_until 读取请求，处理 OPTIONS / DESCRIBE / SETUP / PLAY /
+ *   PAUSE / TEARDOWN / GET_PARAMETER / SET_PARAMETER
+ * - RTP：按 SETUP 协商的传输方式发送
+ *   - UDP 单播：connect 到客户端端口的非阻塞 UDP socket，由 RtspServer 直接批量发送
+ *   - TCP 交织：RTP/RTCP 以 `$ | channel | length` 帧写入控制连接的发送队列，
+ *     队列超过 tcpSendQueueKb 时整帧丢弃并等待关键帧
+ *   - 组播：会话只记录订阅关系，RTP/RTCP SR 由 RtspServer 按组统一发送
+ * - RTCP：UDP 单播只接受客户端协商的 RTCP 端口、TCP 在交织通道上接收 RR / BYE（刷新存活时间），定时发送 SR
+ *
+ * 事件处理由 socket 就绪驱动，与帧节奏无关；没有视频帧时也能正常建连、保活与拆除。
+ *
+ * @author 好软，好温暖
+ * @date 2026-01-31
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "common/asio_context.h"
+#include "rtp_packetizer.h"
+
+class RtspServer;
+
+// ============================================================================
+// RTSP 会话
+// ============================================================================
+
+class RtspSession : public std::enable_shared_from_this<RtspSession> {
+public:
+    enum class State { kInit, kReady, kPlaying };
+    enum class Transport { kNone, kUdp, kTcp, kMulticast };
+
+    static constexpr std::chrono::seconds kSenderReportInterval{5};
+
+    static const char* TransportName(Transport transport);
+
+    RtspSession(asio::ip::tcp::socket socket, RtspServer* server);
+    ~RtspSession();
+
+    RtspSession(const RtspSession&) = delete;
+    RtspSession& operator=(const RtspSession&) = delete;
+
+    /**
+     * @brief 开始读取控制连接
+     */
+    void Start();
+
+    /**
+     * @brief 关闭控制连接与 RTP/RTCP socket（可重复调用）
+     */
+    void Close(const char* reason);
+
+    /**
+     * @brief 发送一帧（IO 线程，由 RtspServer 调用）
+     *
+     * 未 PLAY 或仍在等待关键帧（且本帧不是关键帧）时直接返回
+     */
+    void SendFrame(RtpBatchSender& sender, const std::vector<RtpPacket>& packets,
+                   uint64_t timestamp_us, bool is_keyframe);
+
+    /**
+     * @brief 周期检查（IO 线程，每秒一次）：超时拆除、发送 RTCP SR
+     */
+    void Tick(std::chrono::steady_clock::time_point now);
+
+    bool IsClosed() const { return closed_; }
+    bool IsPlaying() const { return state_ == State::kPlaying; }
+    /// 绑定的 mount 序号（SETUP 前为 -1）
+    int mount() const { return mount_; }
+    Transport transport() const { return transport_; }
+    const std::string& id() const { return id_; }
+    const std::string& peer() const { return peer_; }
+
+    /**
+     * @brief 会话统计（计数器为原子量，可从 HTTP 线程读取）
+     */
+    struct Counters {
+        std::atomic<uint64_t> frames{0};
+        std::atomic<uint64_t> packets{0};
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<uint64_t> dropped{0};               ///< 发送缓冲满丢弃的 RTP 包
+        std::atomic<uint32_t> send_queue_bytes{0};      ///< 本帧发送后 socket 发送队列中的字节数
+        std::atomic<uint32_t> send_queue_peak{0};       ///< 发送队列峰值
+        std::atomic<uint32_t> rtcp_received{0};
+        std::atomic<uint16_t> rtp_port{0};              ///< 客户端 RTP 端口（UDP 单播）
+        std::atomic<int> mount{-1};                     ///< 绑定的 mount 序号
+        std::atomic<int> transport{0};                  ///< Transport 枚举值
+        std::atomic<bool> playing{false};
+    };
+    const Counters& counters() const { return counters_; }
+    std::chrono::steady_clock::time_point created() const { return created_; }
+
+private:
+    struct Request {
+        std::string method;
+        std::string url;
+        std::map<std::string, std::string> headers;     ///< 名称转为小写
+
+        std::string Header(const std::string& name) const;
+    };
+
+    void ReadRequest();
+    void ReadBody(Request request, size_t length);
+    void HandleRequest(const Request& request);
+    /// 控制连接上收到的交织数据帧（TCP 模式下客户端的 RTCP）
+    void HandleInterleaved(const uint8_t* data, size_t size);
+
+    void HandleOptions(const Request& request);
+    void HandleDescribe(const Request& request);
+    void HandleSetup(const Request& request);
+    void HandlePlay(const Request& request);
+    void HandlePause(const Request& request);
+    void HandleTeardown(const Request& request);
+
+    /**
+     * @brief 按一条 Transport 描述建立传输通道
+     *
+     * @param spec Transport 头中的一项（逗号分隔的候选之一）
+     * @param reply 成功时输出响应的 Transport 值
+     * @return RTSP 状态码（200 成功，461 不支持该传输方式）
+     */
+    int SetupTransport(const std::string& spec, int mount, std::string* reply);
+    /// 当前传输方式使用的 RTP 流状态（组播为组共享的状态）
+    const RtpStreamState& StreamState() const;
+
+    /// 按请求 URL 查找 mount；找不到时回 404 并返回 -1
+    int ResolveMount(const Request& request);
+    /// 非本会话的 Session 头回 454 并返回 false
+    bool CheckSession(const Request& request);
+
+    void SendResponse(const Request& request, int code, const std::string& headers = "",
+                      const std::string& body = "");
+    void Write(const std::string& data);
+    void Flush();
+
+    bool OpenRtpChannel(uint16_t client_rtp_port, uint16_t client_rtcp_port);
+    void CloseRtpChannel();
+    void SendInterleaved(const std::vector<RtpPacket>& packets, uint64_t timestamp_us);
+    void ReceiveRtcp();
+    /// 处理一个 RTCP 复合包；收到 BYE 时关闭会话并返回 false
+    bool HandleRtcp(const uint8_t* data, size_t size);
+    void SendSenderReport();
+    void SampleSendQueue();
+
+    RtspServer* server_;
+    asio::ip::tcp::socket socket_;
+    asio::streambuf read_buffer_;
+    std::string write_pending_;         ///< 正在写出的数据（单个 async_write 在途）
+    std::string write_queue_;           ///< 等待写出的响应与交织 RTP/RTCP 帧
+    bool writing_ = false;
+    bool close_after_write_ = false;    ///< TEARDOWN：响应写出后关闭连接
+
+    std::string id_;
+    std::string peer_;
+    asio::ip::address peer_address_;
+    State state_ = State::kInit;
+    int mount_ = -1;
+    Transport transport_ = Transport::kNone;
+    bool closed_ = false;
+
+    // RTP / RTCP
+    asio::ip::udp::socket rtp_socket_;
+    asio::ip::udp::socket rtcp_socket_;
+    asio::ip::udp::endpoint rtcp_remote_;   ///< 客户端 RTCP 端口（SR 目的地址）
+    asio::ip::udp::endpoint rtcp_sender_;  ///< 收到的 RTCP 来源（须与 rtcp_remote_ 一致）
+    uint8_t rtcp_buffer_[1500];
+    uint16_t server_rtp_port_ = 0;
+    uint16_t client_rtp_port_ = 0;
+    uint16_t client_rtcp_port_ = 0;
+    uint8_t rtp_channel_ = 0;               ///< TCP 交织通道号
+    uint8_t rtcp_channel_ = 1;
+    RtpStreamState rtp_;
+    bool waiting_keyframe_ = true;
+
+    std::chrono::steady_clock::time_point created_;
+    std::chrono::steady_clock::time_point last_activity_;
+    std::chrono::steady_clock::time_point last_sr_;
+    std::chrono::steady_clock::time_point last_frame_time_;
+
+    Counters counters_;
+};
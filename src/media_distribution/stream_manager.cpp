@@ -16,6 +16,7 @@
 #include "file/file_service.h"
 #include "webrtc/webrtc_service.h"
 #include "wspreview/ws_preview.h"
+#include "hls/hls_packager.h"
 
 #include <memory>
 
@@ -23,10 +24,27 @@
 // StreamManager 实现
 // ============================================================================
 
+/**
+ * @brief 将总配置中的编码格式同步到各分发路径
+ */
+static void ApplyCodec(StreamConfig& config) {
+    const bool hevc = config.codec == media::VideoCodec::kH265;
+    config.rtsp_config.codecType = hevc ? 2 : 1;
+    for (auto& mount : config.rtsp_config.mounts) {
+        mount.codecType = hevc ? 2 : 1;
+    }
+    config.mp4_config.codecType = hevc ? 12 : 8;
+    config.webrtc_config.webrtc_config.video.codec = media::VideoCodecToString(config.codec);
+    config.ws_preview_config.codec = config.codec;
+    config.hls_config.codec = config.codec;
+}
+
 StreamManager::StreamManager(const StreamConfig& config)
     : config_(config) {
     
-    LOG_INFO("Creating StreamManager (optimized for single-core CPU)...");
+    ApplyCodec(config_);
+    LOG_INFO("Creating StreamManager (optimized for single-core CPU, codec={})...",
+             media::VideoCodecToString(config_.codec));
     
     // 创建 RTSP 服务（如果启用）
     if (config_.enable_rtsp) {
@@ -44,6 +62,7 @@ StreamManager::StreamManager(const StreamConfig& config)
     if (config_.enable_file) {
         FileServiceConfig file_config;
         file_config.mp4Config = config_.mp4_config;
+        file_config.prerecord = config_.prerecord_config;
         
         file_service_ = std::make_unique<FileService>(file_config);
         LOG_INFO("File service created");
@@ -61,6 +80,12 @@ StreamManager::StreamManager(const StreamConfig& config)
         LOG_INFO("WebSocket preview server created");
     }
     
+    // 创建 LL-HLS 打包器（如果启用，首个 HTTP 请求到达后才开始打包）
+    if (config_.enable_hls) {
+        hls_packager_ = std::make_unique<HlsPackager>(config_.hls_config);
+        LOG_INFO("HLS packager created");
+    }
+    
     LOG_INFO("StreamManager created");
 }
 
@@ -4,7 +4,7 @@
  *
  * 负责：
  * - 管理流分发器（StreamDispatcher）
- * - 协调 RTSP、File、WebRTC、WsPreview 等消费者的注册
+ * - 协调 RTSP、File、WebRTC、WsPreview、HLS 等消费者的注册
  * - 提供统一的启动/停止接口
  *
  * 各个消费者的具体实现在各自的模块中：
@@ -12,6 +12,7 @@
  * - file/file_service.h
  * - webrtc/webrtc_service.h
  * - wspreview/ws_preview.h
+ * - hls/hls_packager.h
  *
  * @author 好软，好温暖
  * @date 2026-02-04
@@ -20,16 +21,20 @@
 #pragma once
 
 #include <string>
+#include "common/video_codec.h"
 #include "rtsp/rk_rtsp.h"
 #include "file/file_saver.h"
+#include "file/prerecord_buffer.h"
 #include "webrtc/webrtc_service.h"
 #include "wspreview/ws_preview.h"
+#include "hls/hls_packager.h"
 
 // 前向声明，避免头文件依赖
 class RtspService;
 class FileService;
 class WebRTCService;
 class WsPreviewServer;
+class HlsPackager;
 
 // ============================================================================
 // 流输出配置
@@ -43,14 +48,20 @@ struct StreamConfig {
     bool enable_file = false;          ///< 是否启用文件保存
     bool enable_webrtc = false;        ///< 是否创建 WebRTC 服务
     bool enable_ws_preview = false;    ///< 是否启用 WebSocket 预览
+    bool enable_hls = false;           ///< 是否启用 LL-HLS（由 HTTP 服务器提供）
     
     bool auto_start_rtsp = true;       ///< 是否自动启动 RTSP 服务
     bool auto_start_webrtc = true;     ///< 是否自动启动 WebRTC 服务
     
+    /// 码流编码格式（须与 ProducerConfig::codec 一致，构造时同步到各子配置）
+    media::VideoCodec codec = media::VideoCodec::kH264;
+    
     RtspConfig rtsp_config;            ///< RTSP 配置
     Mp4RecordConfig mp4_config;        ///< MP4 录制配置
+    PrerecordConfig prerecord_config;  ///< 事件预录配置
     WebRTCServiceConfig webrtc_config;  ///< WebRTC 配置
     WsPreviewConfig ws_preview_config; ///< WebSocket 预览配置
+    HlsConfig hls_config;              ///< LL-HLS 配置
 };
 
 // ============================================================================
@@ -100,6 +111,7 @@ public:
     FileService* GetFileService() const { return file_service_.get(); }
     WebRTCService* GetWebRTCService() const { return webrtc_service_.get(); }
     WsPreviewServer* GetWsPreviewServer() const { return ws_preview_server_.get(); }
+    HlsPackager* GetHlsPackager() const { return hls_packager_.get(); }
 
 private:
     StreamConfig config_;
@@ -109,6 +121,7 @@ private:
     std::unique_ptr<FileService> file_service_;
     std::unique_ptr<WebRTCService> webrtc_service_;
     std::unique_ptr<WsPreviewServer> ws_preview_server_;
+    std::unique_ptr<HlsPackager> hls_packager_;
 };
 
 // ============================================================================
@@ -0,0 +1,113 @@
+/**
+ * @file bitrate_controller.cpp
+ * @brief WebRTC 自适应码率实现
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-04
+ */
+
+#include "bitrate_controller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+// ============================================================================
+// 构造
+// ============================================================================
+
+BitrateController::BitrateController(const BitrateControllerConfig& config)
+    : config_(config)
+{
+    if (config_.min_kbps > config_.max_kbps) {
+        std::swap(config_.min_kbps, config_.max_kbps);
+    }
+    applied_kbps_ = config_.max_kbps;
+}
+
+int BitrateController::Clamp(double kbps) const {
+    return std::max(config_.min_kbps,
+                    std::min(config_.max_kbps, static_cast<int>(std::lround(kbps))));
+}
+
+// ============================================================================
+// 评估
+// ============================================================================
+
+bool BitrateController::IsDue() const {
+    return std::chrono::steady_clock::now() - last_update_ >=
+           std::chrono::milliseconds(config_.interval_ms);
+}
+
+bool BitrateController::Update(std::vector<WebRTCPeerStats>& peers, int* target_kbps) {
+    last_update_ = std::chrono::steady_clock::now();
+
+    // 离开的观看者不再约束码率
+    for (auto it = estimates_.begin(); it != estimates_.end();) {
+        bool present = std::any_of(peers.begin(), peers.end(), [&](const WebRTCPeerStats& p) {
+            return p.session_id == it->first;
+        });
+        it = present ? std::next(it) : estimates_.erase(it);
+    }
+
+    double target = config_.max_kbps;
+    bool constrained = false;
+    for (auto& peer : peers) {
+        auto [it, inserted] = estimates_.try_emplace(peer.session_id);
+        ViewerEstimate& est = it->second;
+        if (inserted) {
+            est.kbps = applied_kbps_;
+        }
+
+        // 只在收到新报告块时调整，报告间隔内保持估计不变
+        if (peer.reports > est.last_reports) {
+            est.last_reports = peer.reports;
+            if (peer.fraction_lost > config_.loss_high) {
+                est.kbps *= 1.0 - 0.5 * peer.fraction_lost;
+            } else if (peer.rtt_ms > config_.rtt_high_ms) {
+                est.kbps *= config_.rtt_backoff;
+            } else if (peer.fraction_lost < config_.loss_low) {
+                est.kbps *= config_.increase;
+            }
+        }
+        if (peer.remb_kbps > 0) {
+            est.kbps = std::min(est.kbps, static_cast<double>(peer.remb_kbps));
+        }
+        est.kbps = Clamp(est.kbps);
+        peer.estimate_kbps = static_cast<int>(est.kbps);
+
+        bool fresh = peer.report_age_ms >= 0 && peer.report_age_ms <= config_.stale_ms;
+        if (fresh) {
+            target = std::min(target, est.kbps);
+            constrained = true;
+        }
+    }
+
+    int next = constrained ? Clamp(target) : config_.max_kbps;
+    int delta = std::abs(next - applied_kbps_);
+    bool at_bound = (next == config_.min_kbps || next == config_.max_kbps);
+    if (delta == 0 || (!at_bound && delta * 100 < applied_kbps_ * config_.min_change_pct)) {
+        return false;
+    }
+
+    applied_kbps_ = next;
+    *target_kbps = next;
+    return true;
+}
+
+bool BitrateController::Reset(int* target_kbps) {
+    estimates_.clear();
+    if (applied_kbps_ == config_.max_kbps) {
+        return false;
+    }
+    applied_kbps_ = config_.max_kbps;
+    *target_kbps = applied_kbps_;
+    return true;
+}
+
+void BitrateController::AnnotatePeers(std::vector<WebRTCPeerStats>& peers) const {
+    for (auto& peer : peers) {
+        auto it = estimates_.find(peer.session_id);
+        peer.estimate_kbps = it != estimates_.end() ? static_cast<int>(it->second.kbps) : 0;
+    }
+}
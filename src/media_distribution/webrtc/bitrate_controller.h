@@ -0,0 +1,96 @@
+/**
+ * @file bitrate_controller.h
+ * @brief WebRTC 自适应码率 - 基于 RTCP 丢包 / RTT / REMB 的拥塞控制
+ *
+ * 所有观看者共享同一路 VENC 输出，编码码率只能有一个，因此按观看者分别估计可用码率，
+ * 目标码率取其中最小值（最差网络决定上限），再钳制到 [min_kbps, max_kbps]：
+ * - 丢包率 > loss_high：估计值 *= (1 - 0.5 * loss)
+ * - RTT > rtt_high_ms：估计值 *= rtt_backoff
+ * - 丢包率 < loss_low 且 RTT 正常：估计值 *= increase
+ * - 收到 REMB 时估计值不超过 REMB
+ * - 超过 stale_ms 未收到报告的观看者不参与决策
+ *
+ * 目标变化小于 min_change_pct 时不下发，避免频繁改写 VENC 码控参数；
+ * 没有可用反馈时回到 max_kbps。
+ *
+ * @note 非线程安全，由调用方加锁
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-04
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "rtp_fanout.h"
+
+// ============================================================================
+// 配置
+// ============================================================================
+
+struct BitrateControllerConfig {
+    bool enabled = false;
+    int min_kbps = 256;
+    int max_kbps = 1024;            ///< 一般取编码器的配置码率
+    int interval_ms = 1000;         ///< 评估周期
+    double loss_high = 0.10;
+    double loss_low = 0.02;
+    double increase = 1.08;
+    int rtt_high_ms = 400;
+    double rtt_backoff = 0.90;
+    int stale_ms = 5000;
+    int min_change_pct = 5;
+};
+
+// ============================================================================
+// 码率控制器
+// ============================================================================
+
+class BitrateController {
+public:
+    explicit BitrateController(const BitrateControllerConfig& config = BitrateControllerConfig{});
+
+    /// 距上次评估是否已满一个评估周期
+    bool IsDue() const;
+
+    /**
+     * @brief 更新估计（调用方按 IsDue() 控制频率）
+     *
+     * @param peers 当前观看者统计（含 RTCP 反馈），会写回每个观看者的 estimate_kbps
+     * @param target_kbps 输出需要下发的新目标码率
+     * @return true 目标码率需要下发到编码器
+     */
+    bool Update(std::vector<WebRTCPeerStats>& peers, int* target_kbps);
+
+    /**
+     * @brief 清空观看者估计并回到上限码率
+     * @return true 目标码率发生变化，需要下发
+     */
+    bool Reset(int* target_kbps);
+
+    /// 当前已下发的目标码率
+    int TargetKbps() const { return applied_kbps_; }
+
+    /// 填充观看者的估计码率（不推进评估）
+    void AnnotatePeers(std::vector<WebRTCPeerStats>& peers) const;
+
+    const BitrateControllerConfig& GetConfig() const { return config_; }
+
+private:
+    struct ViewerEstimate {
+        double kbps = 0.0;
+        uint64_t last_reports = 0;
+    };
+
+    int Clamp(double kbps) const;
+
+    BitrateControllerConfig config_;
+    std::unordered_map<std::string, ViewerEstimate> estimates_;
+    std::chrono::steady_clock::time_point last_update_;
+    int applied_kbps_ = 0;
+};
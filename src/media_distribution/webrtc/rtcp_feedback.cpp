@@ -0,0 +1,169 @@
+/**
+ * @file rtcp_feedback.cpp
+ * @brief RTCP 反馈解析实现
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-04
+ */
+
+#include "rtcp_feedback.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr uint8_t kRtcpSr = 200;
+constexpr uint8_t kRtcpRr = 201;
+constexpr uint8_t kRtcpRtpfb = 205;
+constexpr uint8_t kRtcpPsfb = 206;
+
+constexpr uint8_t kFmtNack = 1;
+constexpr uint8_t kFmtPli = 1;
+constexpr uint8_t kFmtFir = 4;
+constexpr uint8_t kFmtAfb = 15;     // 应用层反馈（REMB）
+
+constexpr size_t kReportBlockSize = 24;
+
+// NTP 纪元（1900）与 Unix 纪元（1970）之差
+constexpr uint64_t kNtpEpochOffset = 2208988800ULL;
+
+uint32_t ReadU32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+uint16_t ReadU16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+int64_t SteadyNowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 当前时间的 NTP 中间 32 位（16.16 定点秒），与 SR 中的 LSR 同一时基
+uint32_t NtpMiddle32Now() {
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+    uint64_t seconds = static_cast<uint64_t>(us / 1000000) + kNtpEpochOffset;
+    uint64_t frac16 = (static_cast<uint64_t>(us % 1000000) << 16) / 1000000;
+    return static_cast<uint32_t>(((seconds & 0xFFFF) << 16) | (frac16 & 0xFFFF));
+}
+
+}  // namespace
+
+// ============================================================================
+// 构造
+// ============================================================================
+
+RtcpFeedbackHandler::RtcpFeedbackHandler(uint32_t ssrc,
+                                         KeyframeRequestCallback on_keyframe_request)
+    : ssrc_(ssrc)
+    , on_keyframe_request_(std::move(on_keyframe_request))
+{
+}
+
+// ============================================================================
+// 入站处理
+// ============================================================================
+
+void RtcpFeedbackHandler::incoming(rtc::message_vector& messages,
+                                   const rtc::message_callback& /*send*/) {
+    for (const auto& message : messages) {
+        if (!message || message->type != rtc::Message::Control) continue;
+        ParseCompound(reinterpret_cast<const uint8_t*>(message->data()), message->size());
+    }
+}
+
+void RtcpFeedbackHandler::ParseCompound(const uint8_t* data, size_t size) {
+    size_t pos = 0;
+    while (pos + 8 <= size) {
+        const uint8_t* p = data + pos;
+        if ((p[0] >> 6) != 2) break;
+
+        uint8_t count = p[0] & 0x1F;     // RC（报告块数）或 FMT
+        uint8_t pt = p[1];
+        size_t length = (static_cast<size_t>(ReadU16(p + 2)) + 1) * 4;
+        if (pos + length > size) break;
+
+        switch (pt) {
+            case kRtcpRr:
+                HandleReportBlocks(p + 8, count, length - 8);
+                break;
+            case kRtcpSr:
+                if (length >= 28) {
+                    HandleReportBlocks(p + 28, count, length - 28);
+                }
+                break;
+            case kRtcpRtpfb:
+                if (count == kFmtNack && length >= 12 && ReadU32(p + 8) == ssrc_) {
+                    // FCI: PID(16) + BLP(16)，每项代表 1 + popcount(BLP) 个丢失包
+                    uint64_t lost = 0;
+                    for (size_t off = 12; off + 4 <= length; off += 4) {
+                        uint16_t blp = ReadU16(p + off + 2);
+                        lost += 1 + static_cast<uint64_t>(__builtin_popcount(blp));
+                    }
+                    nack_packets_.fetch_add(lost);
+                }
+                break;
+            case kRtcpPsfb:
+                if ((count == kFmtPli || count == kFmtFir) && length >= 12) {
+                    pli_count_.fetch_add(1);
+                    if (on_keyframe_request_) on_keyframe_request_();
+                } else if (count == kFmtAfb && length >= 20 && memcmp(p + 12, "REMB", 4) == 0) {
+                    // Num SSRC(8) | BR Exp(6) | BR Mantissa(18)
+                    uint32_t exp = p[17] >> 2;
+                    uint64_t mantissa = (static_cast<uint64_t>(p[17] & 0x03) << 16) |
+                                        (static_cast<uint64_t>(p[18]) << 8) | p[19];
+                    uint64_t bps = exp < 46 ? (mantissa << exp) : UINT64_MAX;
+                    remb_kbps_.store(static_cast<uint32_t>(
+                        std::min<uint64_t>(bps / 1000, UINT32_MAX)));
+                }
+                break;
+            default:
+                break;
+        }
+        pos += length;
+    }
+}
+
+void RtcpFeedbackHandler::HandleReportBlocks(const uint8_t* blocks, size_t count,
+                                             size_t available) {
+    for (size_t i = 0; i < count && (i + 1) * kReportBlockSize <= available; ++i) {
+        const uint8_t* b = blocks + i * kReportBlockSize;
+        if (ReadU32(b) != ssrc_) continue;
+
+        fraction_lost_q8_.store(b[4]);
+
+        // RTT = now - LSR - DLSR（单位 1/65536 秒）；LSR 为 0 表示对端尚未收到 SR
+        uint32_t lsr = ReadU32(b + 16);
+        uint32_t dlsr = ReadU32(b + 20);
+        if (lsr != 0) {
+            uint32_t rtt_q16 = NtpMiddle32Now() - lsr - dlsr;
+            if (rtt_q16 < (60u << 16)) {
+                rtt_ms_.store(static_cast<int>((static_cast<uint64_t>(rtt_q16) * 1000) >> 16));
+            }
+        }
+
+        reports_.fetch_add(1);
+        last_report_ms_.store(SteadyNowMs());
+    }
+}
+
+// ============================================================================
+// 统计
+// ============================================================================
+
+RtcpFeedbackStats RtcpFeedbackHandler::GetStats() const {
+    RtcpFeedbackStats s;
+    s.fraction_lost = fraction_lost_q8_.load() / 256.0;
+    s.rtt_ms = rtt_ms_.load();
+    s.nack_packets = nack_packets_.load();
+    s.pli_count = pli_count_.load();
+    s.remb_kbps = remb_kbps_.load();
+    s.reports = reports_.load();
+    int64_t last = last_report_ms_.load();
+    s.report_age_ms = s.reports > 0 ? SteadyNowMs() - last : -1;
+    return s;
+}
@@ -0,0 +1,74 @@
+/**
+ * @file rtcp_feedback.h
+ * @brief RTCP 反馈解析 - 从观看者的 RR / NACK / PLI / FIR / REMB 中提取网络状况
+ *
+ * 挂在每个观看者轨道的 MediaHandler 链最前端，只读取入站 RTCP，不修改也不消费消息，
+ * 后续的 RtcpSrReporter / RtcpReceivingSession 照常处理：
+ * - RR/SR 报告块（PT 200/201）：丢包率（fraction lost）与 RTT（LSR/DLSR）
+ * - RTPFB（PT 205）FMT 1：NACK 请求的包数
+ * - PSFB（PT 206）FMT 1 / 4：PLI / FIR，触发关键帧请求回调
+ * - PSFB（PT 206）FMT 15：REMB，浏览器估计的可用带宽
+ *
+ * 结果写入原子变量，由码率控制器在发送线程周期性读取。
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-04
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include <rtc/rtc.hpp>
+
+// ============================================================================
+// 反馈快照
+// ============================================================================
+
+struct RtcpFeedbackStats {
+    double fraction_lost = 0.0;         ///< 最近一个 RR 的丢包率（0.0 ~ 1.0）
+    int rtt_ms = -1;                    ///< 最近一次 RTT（-1 = 尚未测得）
+    uint64_t nack_packets = 0;          ///< 累计 NACK 请求的包数
+    uint64_t pli_count = 0;             ///< 累计 PLI + FIR 次数
+    uint32_t remb_kbps = 0;             ///< 最近一次 REMB（0 = 未收到）
+    uint64_t reports = 0;               ///< 累计收到的报告块数
+    int64_t report_age_ms = -1;         ///< 距最近一个报告块的时间（-1 = 尚未收到）
+};
+
+// ============================================================================
+// RTCP 反馈处理器
+// ============================================================================
+
+class RtcpFeedbackHandler : public rtc::MediaHandler {
+public:
+    using KeyframeRequestCallback = std::function<void()>;
+
+    /**
+     * @param ssrc 本观看者的发送 SSRC（只统计针对该 SSRC 的报告块）
+     * @param on_keyframe_request 收到 PLI/FIR 时调用（libdatachannel 线程）
+     */
+    RtcpFeedbackHandler(uint32_t ssrc, KeyframeRequestCallback on_keyframe_request);
+
+    void incoming(rtc::message_vector& messages, const rtc::message_callback& send) override;
+
+    RtcpFeedbackStats GetStats() const;
+
+private:
+    void ParseCompound(const uint8_t* data, size_t size);
+    void HandleReportBlocks(const uint8_t* blocks, size_t count, size_t available);
+
+    const uint32_t ssrc_;
+    KeyframeRequestCallback on_keyframe_request_;
+
+    std::atomic<uint32_t> fraction_lost_q8_{0};     // RR 原始值：丢包率 * 256
+    std::atomic<int> rtt_ms_{-1};
+    std::atomic<uint64_t> nack_packets_{0};
+    std::atomic<uint64_t> pli_count_{0};
+    std::atomic<uint32_t> remb_kbps_{0};
+    std::atomic<uint64_t> reports_{0};
+    std::atomic<int64_t> last_report_ms_{0};        // steady_clock 毫秒
+};
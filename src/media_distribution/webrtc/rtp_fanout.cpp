@@ -0,0 +1,365 @@
+/**
+ * @file rtp_fanout.cpp
+ * @brief RTP 扇出实现
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-04
+ */
+
+#include "rtp_fanout.h"
+#include "rtcp_feedback.h"
+#include "common/logger.h"
+
+#include <rtc/rtc.hpp>
+#include <rtc/h264rtppacketizer.hpp>
+#include <rtc/h265rtppacketizer.hpp>
+#include <rtc/rtcpsrreporter.hpp>
+#include <rtc/rtcpreceivingsession.hpp>
+#include <rtc/frameinfo.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+#undef LOG_TAG
+#define LOG_TAG "rtp_fanout"
+
+namespace {
+
+// RTP 固定头：序列号位于字节 2-3，SSRC 位于字节 8-11（网络字节序）
+constexpr size_t kRtpHeaderSize = 12;
+
+void RewriteRtpHeader(std::byte* packet, uint16_t seq, uint32_t ssrc) {
+    packet[2] = static_cast<std::byte>(seq >> 8);
+    packet[3] = static_cast<std::byte>(seq & 0xFF);
+    packet[8] = static_cast<std::byte>(ssrc >> 24);
+    packet[9] = static_cast<std::byte>((ssrc >> 16) & 0xFF);
+    packet[10] = static_cast<std::byte>((ssrc >> 8) & 0xFF);
+    packet[11] = static_cast<std::byte>(ssrc & 0xFF);
+}
+
+uint32_t ReadRtpTimestamp(const std::byte* packet) {
+    return (static_cast<uint32_t>(packet[4]) << 24) | (static_cast<uint32_t>(packet[5]) << 16) |
+           (static_cast<uint32_t>(packet[6]) << 8) | static_cast<uint32_t>(packet[7]);
+}
+
+uint16_t RandomSequence() {
+    static std::mt19937 rng{std::random_device{}()};
+    return static_cast<uint16_t>(rng());
+}
+
+}  // namespace
+
+// ============================================================================
+// 构造
+// ============================================================================
+
+RtpFanout::RtpFanout(bool hevc, int payload_type, size_t mtu)
+    : hevc_(hevc)
+    , payload_type_(payload_type)
+{
+    // 共享打包器的 SSRC 不会出现在网络上，发送前逐个观看者改写
+    rtp_config_ = std::make_shared<rtc::RtpPacketizationConfig>(
+        0, "video", payload_type_, rtc::H264RtpPacketizer::ClockRate);
+
+    if (hevc_) {
+        packetizer_ = std::make_shared<rtc::H265RtpPacketizer>(
+            rtc::NalUnit::Separator::StartSequence, rtp_config_, mtu);
+    } else {
+        packetizer_ = std::make_shared<rtc::H264RtpPacketizer>(
+            rtc::NalUnit::Separator::StartSequence, rtp_config_, mtu);
+    }
+    scratch_.reserve(mtu + kRtpHeaderSize + 64);
+}
+
+RtpFanout::~RtpFanout() {
+    SetKeyframeRequestCallback(nullptr);
+    Clear();
+}
+
+// ============================================================================
+// 观看者管理
+// ============================================================================
+
+std::shared_ptr<rtc::Track> RtpFanout::AddViewer(const std::string& session_id,
+                                                 rtc::PeerConnection& pc, uint32_t ssrc) {
+    auto track = AddTrack(pc, ssrc);
+    if (!track || !AttachViewer(session_id, track, ssrc)) {
+        return nullptr;
+    }
+    return track;
+}
+
+std::shared_ptr<rtc::Track> RtpFanout::AddTrack(rtc::PeerConnection& pc, uint32_t ssrc) const {
+    try {
+        rtc::Description::Video video_desc("video", rtc::Description::Direction::SendOnly);
+        if (hevc_) {
+            video_desc.addH265Codec(payload_type_);
+        } else {
+            video_desc.addH264Codec(payload_type_);
+        }
+        video_desc.addSSRC(ssrc, "video", "stream1", "video");
+        return pc.addTrack(video_desc);
+    } catch (const std::exception& e) {
+        LOG_ERROR("创建观看者轨道失败: {}", e.what());
+        return nullptr;
+    }
+}
+
+bool RtpFanout::AttachViewer(const std::string& session_id, std::shared_ptr<rtc::Track> track,
+                             uint32_t ssrc) {
+    if (!track) {
+        return false;
+    }
+
+    auto viewer = std::make_shared<Viewer>();
+    viewer->session_id = session_id;
+    viewer->track = std::move(track);
+
+    try {
+        // 每个观看者独立的 RTCP：SR 统计本观看者实际收到的包，RR/REMB 各自处理
+        viewer->rtp_config = std::make_shared<rtc::RtpPacketizationConfig>(
+            ssrc, "video", payload_type_, rtc::H264RtpPacketizer::ClockRate);
+        viewer->rtp_config->startTimestamp = rtp_config_->startTimestamp;
+        viewer->rtp_config->timestamp = rtp_config_->timestamp;
+
+        // 反馈解析放在链首，只读取入站 RTCP，不影响后续处理器
+        std::weak_ptr<KeyframeSink> weak_sink = keyframe_sink_;
+        viewer->feedback = std::make_shared<RtcpFeedbackHandler>(ssrc, [weak_sink, session_id]() {
+            if (auto sink = weak_sink.lock()) {
+                std::lock_guard<std::mutex> lock(sink->mutex);
+                if (sink->callback) sink->callback(session_id, "pli");
+            }
+        });
+        viewer->sr_reporter = std::make_shared<rtc::RtcpSrReporter>(viewer->rtp_config);
+        viewer->rtcp_session = std::make_shared<rtc::RtcpReceivingSession>();
+        viewer->feedback->addToChain(viewer->sr_reporter);
+        viewer->feedback->addToChain(viewer->rtcp_session);
+        viewer->track->setMediaHandler(viewer->feedback);
+    } catch (const std::exception& e) {
+        LOG_ERROR("挂载观看者 RTCP 处理器失败: {}", e.what());
+        return false;
+    }
+
+    viewer->next_seq = RandomSequence();
+    viewer->added_time = std::chrono::steady_clock::now();
+    viewer->window_start = viewer->added_time;
+
+    size_t count = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        viewers_.erase(std::remove_if(viewers_.begin(), viewers_.end(),
+                                      [&](const std::shared_ptr<Viewer>& v) {
+                                          return v->session_id == session_id;
+                                      }),
+                       viewers_.end());
+        viewers_.push_back(viewer);
+        count = viewers_.size();
+    }
+
+    LOG_INFO("观看者加入: {} (ssrc={}, 当前 {} 人)", session_id, ssrc, count);
+    return true;
+}
+
+void RtpFanout::RemoveViewer(const std::string& session_id) {
+    size_t count = 0;
+    bool removed = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = std::remove_if(viewers_.begin(), viewers_.end(),
+                                 [&](const std::shared_ptr<Viewer>& v) {
+                                     return v->session_id == session_id;
+                                 });
+        removed = it != viewers_.end();
+        viewers_.erase(it, viewers_.end());
+        count = viewers_.size();
+    }
+    if (removed) {
+        LOG_INFO("观看者离开: {} (剩余 {} 人)", session_id, count);
+    }
+}
+
+void RtpFanout::Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    viewers_.clear();
+}
+
+void RtpFanout::SetKeyframeRequestCallback(KeyframeRequestCallback callback) {
+    std::lock_guard<std::mutex> lock(keyframe_sink_->mutex);
+    keyframe_sink_->callback = std::move(callback);
+}
+
+void RtpFanout::RequestKeyframe(const std::string& session_id, const char* reason) {
+    std::lock_guard<std::mutex> lock(keyframe_sink_->mutex);
+    if (keyframe_sink_->callback) keyframe_sink_->callback(session_id, reason);
+}
+
+std::vector<std::shared_ptr<RtpFanout::Viewer>> RtpFanout::SnapshotViewers() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return viewers_;
+}
+
+// ============================================================================
+// 发送
+// ============================================================================
+
+size_t RtpFanout::SendFrame(const uint8_t* data, size_t size, uint64_t timestamp_us,
+                            bool is_keyframe) {
+    // 只给轨道已打开、且已收到（或本帧即为）关键帧的观看者发送
+    auto now = std::chrono::steady_clock::now();
+    std::vector<std::shared_ptr<Viewer>> targets;
+    for (auto& v : SnapshotViewers()) {
+        if (!v->track || !v->track->isOpen()) continue;
+        if (!v->keyframe_received && !is_keyframe) {
+            // 刚打开的轨道不等 GOP，主动请求 IDR（编码侧限频合并）
+            if (now - v->last_keyframe_request >= std::chrono::milliseconds(500)) {
+                v->last_keyframe_request = now;
+                RequestKeyframe(v->session_id, "join");
+            }
+            continue;
+        }
+        targets.push_back(std::move(v));
+    }
+    return SendToViewers(targets, data, size, timestamp_us, now);
+}
+
+size_t RtpFanout::SendBurst(const std::vector<BurstFrame>& frames) {
+    if (frames.empty()) {
+        return 0;
+    }
+
+    std::vector<std::shared_ptr<Viewer>> targets;
+    for (auto& v : SnapshotViewers()) {
+        if (v->track && v->track->isOpen() && !v->keyframe_received) {
+            targets.push_back(std::move(v));
+        }
+    }
+    if (targets.empty()) {
+        return 0;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    size_t delivered = 0;
+    for (const auto& frame : frames) {
+        delivered = std::max(delivered, SendToViewers(targets, frame.data, frame.size,
+                                                      frame.timestamp_us, now));
+    }
+    for (const auto& v : targets) {
+        LOG_INFO("观看者 {} 已补发缓存的 GOP ({} 帧)", v->session_id, frames.size());
+    }
+    return delivered;
+}
+
+size_t RtpFanout::AwaitingKeyframeCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<size_t>(std::count_if(
+        viewers_.begin(), viewers_.end(), [](const std::shared_ptr<Viewer>& v) {
+            return v->track && v->track->isOpen() && !v->keyframe_received;
+        }));
+}
+
+size_t RtpFanout::SendToViewers(const std::vector<std::shared_ptr<Viewer>>& targets,
+                                const uint8_t* data, size_t size, uint64_t timestamp_us,
+                                std::chrono::steady_clock::time_point now) {
+    if (targets.empty()) {
+        return 0;
+    }
+
+    // 一次打包：Annex-B -> RTP 包（时间戳由 FrameInfo 换算）
+    auto sample_time = std::chrono::duration<double>(timestamp_us / 1000000.0);
+    auto frame = rtc::make_message(reinterpret_cast<const std::byte*>(data),
+                                   reinterpret_cast<const std::byte*>(data) + size,
+                                   rtc::Message::Binary, 0, nullptr,
+                                   std::make_shared<rtc::FrameInfo>(sample_time));
+    rtc::message_vector packets{frame};
+    try {
+        packetizer_->outgoing(packets, nullptr);
+    } catch (const std::exception& e) {
+        LOG_ERROR("RTP 打包失败: {}", e.what());
+        return 0;
+    }
+    frames_packetized_.fetch_add(1);
+
+    size_t delivered = 0;
+    for (auto& v : targets) {
+        if (!v->keyframe_received) {
+            v->keyframe_received = true;
+            LOG_INFO("观看者 {} 收到首个关键帧，开始发送", v->session_id);
+        }
+
+        uint32_t ssrc = v->rtp_config->ssrc;
+        uint64_t bytes = 0;
+        size_t sent = 0;
+        try {
+            for (const auto& packet : packets) {
+                if (!packet || packet->size() < kRtpHeaderSize) continue;
+                scratch_.assign(packet->begin(), packet->end());
+                RewriteRtpHeader(scratch_.data(), v->next_seq++, ssrc);
+                v->rtp_config->timestamp = ReadRtpTimestamp(scratch_.data());
+                v->rtp_config->sequenceNumber = v->next_seq;
+                v->track->send(scratch_.data(), scratch_.size());
+                bytes += scratch_.size();
+                sent++;
+            }
+        } catch (const std::exception& e) {
+            LOG_WARN("发送给观看者 {} 失败: {}", v->session_id, e.what());
+        }
+
+        v->packets_sent.fetch_add(sent);
+        v->bytes_sent.fetch_add(bytes);
+        v->window_bytes += bytes;
+        auto window_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            now - v->window_start).count();
+        if (window_ms >= 1000) {
+            v->bitrate_kbps.store(v->window_bytes * 8 / static_cast<uint64_t>(window_ms));
+            v->window_bytes = 0;
+            v->window_start = now;
+        }
+        if (sent > 0) delivered++;
+    }
+    return delivered;
+}
+
+// ============================================================================
+// 统计
+// ============================================================================
+
+size_t RtpFanout::ViewerCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return viewers_.size();
+}
+
+size_t RtpFanout::ActiveViewerCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<size_t>(std::count_if(
+        viewers_.begin(), viewers_.end(),
+        [](const std::shared_ptr<Viewer>& v) { return v->track && v->track->isOpen(); }));
+}
+
+std::vector<WebRTCPeerStats> RtpFanout::GetPeerStats() const {
+    auto now = std::chrono::steady_clock::now();
+    std::vector<WebRTCPeerStats> result;
+    for (const auto& v : SnapshotViewers()) {
+        WebRTCPeerStats s;
+        s.session_id = v->session_id;
+        s.ssrc = v->rtp_config ? v->rtp_config->ssrc : 0;
+        s.packets_sent = v->packets_sent.load();
+        s.bytes_sent = v->bytes_sent.load();
+        s.bitrate_kbps = v->bitrate_kbps.load();
+        s.connection_duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            now - v->added_time).count();
+        s.receiving = v->packets_sent.load() > 0;
+        if (v->feedback) {
+            auto fb = v->feedback->GetStats();
+            s.fraction_lost = fb.fraction_lost;
+            s.rtt_ms = fb.rtt_ms;
+            s.nack_packets = fb.nack_packets;
+            s.pli_count = fb.pli_count;
+            s.remb_kbps = fb.remb_kbps;
+            s.reports = fb.reports;
+            s.report_age_ms = fb.report_age_ms;
+        }
+        result.push_back(std::move(s));
+    }
+    return result;
+}
@@ -0,0 +1,224 @@
+/**
+ * @file rtp_fanout.h
+ * @brief RTP 扇出 - 每帧只打包一次，分发给多个观看者
+ *
+ * 多人同时观看同一路摄像头时，每个 PeerConnection 各挂一条 H264RtpPacketizer
+ * 会把同一帧重复切片 N 次。RtpFanout 持有唯一的打包器：
+ * - 每帧 Annex-B 数据只做一次 NAL 切分 / FU-A 分片，得到共享的 RTP 包
+ * - 逐个观看者改写 SSRC 与序列号后发送（时间戳共享）
+ * - 每个观看者的轨道只挂 RtcpFeedbackHandler + RtcpSrReporter + RtcpReceivingSession，
+ *   SR/RR 等 RTCP 以各自的 SSRC 独立处理，丢包 / RTT / PLI 等反馈按观看者统计
+ *
+ * 新加入的观看者从下一个关键帧开始接收，不影响已在观看的其他人；
+ * 轨道打开后仍在等待关键帧的观看者会经关键帧请求回调请求 IDR（等待期间每 500ms 重发），
+ * 无需等满一个 GOP；调用方有 GOP 缓存时可经 SendBurst() 先补发缓存帧，立即开始接收。
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-04
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace rtc {
+class PeerConnection;
+class Track;
+class RtpPacketizationConfig;
+class RtpPacketizer;
+class RtcpSrReporter;
+class RtcpReceivingSession;
+}
+class RtcpFeedbackHandler;
+
+// ============================================================================
+// 观看者统计
+// ============================================================================
+
+struct WebRTCPeerStats {
+    std::string session_id;
+    uint32_t ssrc = 0;
+    uint64_t packets_sent = 0;          ///< 已发送 RTP 包数
+    uint64_t bytes_sent = 0;            ///< 已发送 RTP 字节数（含 RTP 头）
+    uint64_t bitrate_kbps = 0;          ///< 最近 1 秒的发送码率
+    uint64_t connection_duration_ms = 0;
+    bool receiving = false;             ///< 已收到关键帧并开始接收
+
+    // RTCP 反馈（来自观看者的 RR / NACK / PLI / REMB）
+    double fraction_lost = 0.0;         ///< 最近一个 RR 的丢包率（0.0 ~ 1.0）
+    int rtt_ms = -1;                    ///< 最近一次 RTT（-1 = 尚未测得）
+    uint64_t nack_packets = 0;          ///< 累计 NACK 请求的包数
+    uint64_t pli_count = 0;             ///< 累计 PLI + FIR 次数
+    uint32_t remb_kbps = 0;             ///< 最近一次 REMB（0 = 未收到）
+    uint64_t reports = 0;               ///< 累计报告块数
+    int64_t report_age_ms = -1;         ///< 距最近一个报告块的时间（-1 = 尚未收到）
+    int estimate_kbps = 0;              ///< 码率控制器对该观看者的可用码率估计
+};
+
+// ============================================================================
+// RTP 扇出
+// ============================================================================
+
+class RtpFanout {
+public:
+    /**
+     * 观看者需要关键帧：reason 为 "pli"（PLI/FIR，libdatachannel 线程）
+     * 或 "join"（轨道已打开、等待首个关键帧，发送线程）
+     */
+    using KeyframeRequestCallback =
+        std::function<void(const std::string& session_id, const char* reason)>;
+
+    /// GOP 补发中的一帧（数据只需在 SendBurst() 返回前有效）
+    struct BurstFrame {
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+        uint64_t timestamp_us = 0;      ///< 与 SendFrame() 同一时基
+    };
+
+    /**
+     * @param hevc true 为 H.265，false 为 H.264
+     * @param payload_type RTP 负载类型（所有观看者共用）
+     * @param mtu 单个 RTP 包的最大负载
+     */
+    RtpFanout(bool hevc, int payload_type, size_t mtu = 1200);
+    ~RtpFanout();
+
+    RtpFanout(const RtpFanout&) = delete;
+    RtpFanout& operator=(const RtpFanout&) = delete;
+
+    /**
+     * @brief 在 PeerConnection 上创建发送轨道并加入扇出
+     *
+     * @param session_id 观看者标识（同名旧观看者会被替换）
+     * @param pc 观看者的 PeerConnection
+     * @param ssrc 该观看者使用的 SSRC
+     * @return 视频轨道，失败返回 nullptr
+     */
+    std::shared_ptr<rtc::Track> AddViewer(const std::string& session_id,
+                                          rtc::PeerConnection& pc, uint32_t ssrc);
+
+    /**
+     * @brief 只在 PeerConnection 上创建发送轨道，不加入扇出
+     *
+     * 预热的待命会话在生成 Offer 前用它建好轨道，取用时再 AttachViewer()
+     *
+     * @return 视频轨道，失败返回 nullptr
+     */
+    std::shared_ptr<rtc::Track> AddTrack(rtc::PeerConnection& pc, uint32_t ssrc) const;
+
+    /**
+     * @brief 把 AddTrack() 创建的轨道加入扇出（挂上该观看者的 RTCP 处理器链）
+     *
+     * @param session_id 观看者标识（同名旧观看者会被替换）
+     * @param track 视频轨道
+     * @param ssrc 创建轨道时使用的 SSRC
+     * @return true 成功
+     */
+    bool AttachViewer(const std::string& session_id, std::shared_ptr<rtc::Track> track,
+                      uint32_t ssrc);
+
+    /**
+     * @brief 移除观看者（轨道由 PeerConnection 负责关闭）
+     */
+    void RemoveViewer(const std::string& session_id);
+
+    /**
+     * @brief 移除全部观看者
+     */
+    void Clear();
+
+    /**
+     * @brief 设置关键帧请求回调（对已加入和之后加入的观看者均生效）
+     */
+    void SetKeyframeRequestCallback(KeyframeRequestCallback callback);
+
+    /**
+     * @brief 打包一帧并发送给所有轨道已打开的观看者
+     *
+     * 没有可发送的观看者时直接返回，不做打包
+     *
+     * @param data Annex-B 编码数据
+     * @param size 数据长度
+     * @param timestamp_us 帧时间戳（微秒，相对首帧）
+     * @param is_keyframe 是否为关键帧
+     * @return 实际发送到的观看者数
+     */
+    size_t SendFrame(const uint8_t* data, size_t size, uint64_t timestamp_us, bool is_keyframe);
+
+    /**
+     * @brief 给轨道已打开、仍在等待关键帧的观看者补发缓存的 GOP
+     *
+     * 每帧同样只打包一次；补发后这些观看者视为已收到关键帧，随后的 SendFrame() 直接衔接
+     *
+     * @param frames 缓存帧（首帧须为关键帧，时间戳早于下一次 SendFrame()）
+     * @return 补发到的观看者数
+     */
+    size_t SendBurst(const std::vector<BurstFrame>& frames);
+
+    /// 轨道已打开、仍在等待关键帧的观看者数
+    size_t AwaitingKeyframeCount() const;
+
+    /// 已加入的观看者数
+    size_t ViewerCount() const;
+    /// 轨道已打开的观看者数
+    size_t ActiveViewerCount() const;
+
+    std::vector<WebRTCPeerStats> GetPeerStats() const;
+
+    uint64_t FramesPacketized() const { return frames_packetized_.load(); }
+
+private:
+    struct Viewer {
+        std::string session_id;
+        std::shared_ptr<rtc::Track> track;
+        std::shared_ptr<rtc::RtpPacketizationConfig> rtp_config;
+        std::shared_ptr<rtc::RtcpSrReporter> sr_reporter;
+        std::shared_ptr<rtc::RtcpReceivingSession> rtcp_session;
+        std::shared_ptr<RtcpFeedbackHandler> feedback;
+        uint16_t next_seq = 0;
+        bool keyframe_received = false;
+        std::chrono::steady_clock::time_point last_keyframe_request;  // 仅发送线程访问
+
+        // 统计（仅发送线程写入）
+        std::atomic<uint64_t> packets_sent{0};
+        std::atomic<uint64_t> bytes_sent{0};
+        std::atomic<uint64_t> bitrate_kbps{0};
+        uint64_t window_bytes = 0;
+        std::chrono::steady_clock::time_point window_start;
+        std::chrono::steady_clock::time_point added_time;
+    };
+
+    // 轨道的处理器链可能比 RtpFanout 活得久，回调经由共享的 sink 间接调用
+    struct KeyframeSink {
+        std::mutex mutex;
+        KeyframeRequestCallback callback;
+    };
+
+    std::vector<std::shared_ptr<Viewer>> SnapshotViewers() const;
+    size_t SendToViewers(const std::vector<std::shared_ptr<Viewer>>& targets,
+                         const uint8_t* data, size_t size, uint64_t timestamp_us,
+                         std::chrono::steady_clock::time_point now);
+    void RequestKeyframe(const std::string& session_id, const char* reason);
+
+    const bool hevc_;
+    const int payload_type_;
+
+    // 共享打包器（仅发送线程使用）
+    std::shared_ptr<rtc::RtpPacketizationConfig> rtp_config_;
+    std::shared_ptr<rtc::RtpPacketizer> packetizer_;
+    std::vector<std::byte> scratch_;
+
+    mutable std::mutex mutex_;
+    std::vector<std::shared_ptr<Viewer>> viewers_;
+
+    std::shared_ptr<KeyframeSink> keyframe_sink_ = std::make_shared<KeyframeSink>();
+
+    std::atomic<uint64_t> frames_packetized_{0};
+};
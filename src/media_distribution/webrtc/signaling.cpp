@@ -230,6 +230,42 @@ bool SignalingClient::SendIceCandidate(const std::string& candidate, const std::
     return SendJsonMessage(msg.dump());
 }
 
+bool SignalingClient::SendIceCandidates(const std::vector<IceCandidate>& candidates,
+                                         const std::string& target_device_id) {
+    if (candidates.empty()) {
+        return true;
+    }
+    if (candidates.size() == 1) {
+        const auto& c = candidates.front();
+        return SendIceCandidate(c.candidate, c.mid, c.mline_index, target_device_id);
+    }
+
+    auto current = status_.load();
+    if (current != SignalingStatus::kJoined && current != SignalingStatus::kPaired) {
+        return false;
+    }
+
+    json list = json::array();
+    for (const auto& c : candidates) {
+        list.push_back({
+            {"candidate", c.candidate},
+            {"sdpMid", c.mid},
+            {"sdpMLineIndex", c.mline_index}
+        });
+    }
+
+    json msg = {
+        {"type", "ice_batch"},
+        {"from", config_.device_id},
+        {"to", target_device_id},
+        {"data", {{"candidates", list}}},
+        {"time", GetCurrentTimestamp()}
+    };
+
+    LOG_DEBUG("批量发送 ICE 候选: {}", candidates.size());
+    return SendJsonMessage(msg.dump());
+}
+
 bool SignalingClient::SendConnectionRequest(const std::string& peer_id, const ConnectionRequest& request) {
     auto current = status_.load();
     if (current != SignalingStatus::kJoined && current != SignalingStatus::kPaired) {
@@ -387,6 +423,13 @@ void SignalingClient::HandleMessage(const std::string& message) {
             std::string mid = data.value("sdpMid", "");
             int mline_index = data.value("sdpMLineIndex", 0);
             HandleIceMessage(from, candidate, mid, mline_index);
+        } else if (type == "ice_batch") {
+            std::string from = msg.value("from", "");
+            auto data = msg.value("data", json::object());
+            for (const auto& c : data.value("candidates", json::array())) {
+                HandleIceMessage(from, c.value("candidate", ""), c.value("sdpMid", ""),
+                                 c.value("sdpMLineIndex", 0));
+            }
         } else if (type == "info") {
             auto data = msg.value("data", json::object());
             RoomInfo info;
@@ -5,7 +5,7 @@
  * 提供与信令服务器通信的功能：
  * - WebSocket 连接管理
  * - SDP Offer/Answer 交换
- * - ICE 候选交换
+ * - ICE 候选交换（多个候选合并为一条 "ice_batch" 消息，单个候选仍用 "ice"）
  * - 房间管理
  *
  * @author 好软，好温暖
@@ -74,6 +74,15 @@ struct ConnectionRequest {
     bool video = true;    ///< 是否开启视频通道
 };
 
+/**
+ * @brief ICE 候选
+ */
+struct IceCandidate {
+    std::string candidate;  ///< 候选字符串
+    std::string mid;        ///< SDP mid
+    int mline_index = 0;    ///< SDP mline index
+};
+
 // ============================================================================
 // 回调类型定义
 // ============================================================================
@@ -172,6 +181,14 @@ public:
     bool SendIceCandidate(const std::string& candidate, const std::string& mid,
                           int mline_index, const std::string& target_device_id);
 
+    /**
+     * @brief 批量发送 ICE 候选（一条消息，减少信令往返；只有一个时按 "ice" 发送）
+     * @param candidates ICE 候选列表
+     * @param target_device_id 目标设备 ID
+     */
+    bool SendIceCandidates(const std::vector<IceCandidate>& candidates,
+                           const std::string& target_device_id);
+
     /**
      * @brief 发送连接请求
      */
@@ -10,20 +10,92 @@
 #include "common/logger.h"
 
 #include <rtc/rtc.hpp>
-#include <rtc/h264rtppacketizer.hpp>
-#include <rtc/rtcpsrreporter.hpp>
-#include <rtc/rtcpreceivingsession.hpp>
-#include <rtc/frameinfo.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <iterator>
+#include <stdexcept>
 
 #undef LOG_TAG
 #define LOG_TAG "webrtc"
 
+namespace {
+
+// 信令服务器配对的对端在扇出中的会话 ID
+constexpr const char* kSignalingSessionId = "signaling";
+
+// 检测元数据通道积压上限：超过后丢弃新消息（检测框只看最新一帧）
+constexpr size_t kMetadataBufferLimit = 64 * 1024;
+
+// 现场创建会话时等待本地 SDP 的上限
+constexpr auto kSdpTimeout = std::chrono::seconds(5);
+
+// 待命会话等待候选收集完成的上限（STUN 不可达时先用已收集的 host 候选）
+constexpr auto kStandbyGatherTimeout = std::chrono::seconds(3);
+
+// 待命会话的有效期：NAT 映射通常 30 秒以上才老化，到期后重建以保证 srflx 候选可用
+constexpr auto kStandbyMaxAge = std::chrono::seconds(30);
+
+// 预热失败后的重试间隔
+constexpr auto kStandbyRetry = std::chrono::seconds(5);
+
+// 检测元数据通道：无序投递，旧消息由客户端按 seq 丢弃
+std::shared_ptr<rtc::DataChannel> CreateMetadataChannel(rtc::PeerConnection& pc) {
+    rtc::DataChannelInit init;
+    init.reliability.unordered = true;
+    return pc.createDataChannel(WebRTCSystem::kMetadataChannelLabel, init);
+}
+
+bool SendMetadataTo(const std::shared_ptr<rtc::DataChannel>& dc, const std::string& message,
+                    std::atomic<uint64_t>& sent, std::atomic<uint64_t>& dropped) {
+    if (!dc || !dc->isOpen()) {
+        return false;
+    }
+    if (dc->bufferedAmount() > kMetadataBufferLimit) {
+        dropped.fetch_add(1);
+        return false;
+    }
+    try {
+        dc->send(reinterpret_cast<const std::byte*>(message.data()), message.size());
+        sent.fetch_add(1);
+        return true;
+    } catch (const std::exception& e) {
+        LOG_DEBUG("发送检测元数据失败: {}", e.what());
+        return false;
+    }
+}
+
+}  // namespace
+
+// ============================================================================
+// HTTP 观看者会话
+// ============================================================================
+
+struct WebRTCSystem::HttpSession {
+    std::string id;                                 ///< 取用时分配（待命期间为空）
+    uint32_t ssrc = 0;
+    std::shared_ptr<rtc::PeerConnection> pc;
+    std::shared_ptr<rtc::Track> track;              ///< 发送轨道（取用时加入扇出）
+    std::shared_ptr<rtc::DataChannel> metadata;     ///< 检测元数据通道
+    std::shared_ptr<rtc::DataChannel> message;      ///< 消息通道（信令对端取用时使用）
+    std::atomic<bool> closed{false};
+    std::chrono::steady_clock::time_point created;
+
+    // 本地描述与 ICE 候选（libdatachannel 线程写入，HTTP / 预热线程读取）
+    mutable std::mutex ice_mutex;
+    std::condition_variable ice_cv;
+    bool description_ready = false;
+    bool gathering_complete = false;
+    std::vector<std::pair<std::string, std::string>> local_candidates;
+};
+
 // ============================================================================
 // WebRTCSystem 实现
 // ============================================================================
 
 WebRTCSystem::WebRTCSystem(const WebRTCConfig& config)
     : config_(config)
+    , bitrate_controller_(config.abr)
 {
     LOG_INFO("WebRTC 系统创建");
 }
@@ -51,6 +123,15 @@ WebRTCError WebRTCSystem::Init(std::shared_ptr<SignalingClient> signaling) {
 
     LOG_INFO("开始初始化 WebRTC 系统...");
     signaling_ = std::move(signaling);
+    fanout_ = std::make_unique<RtpFanout>(config_.video.codec == "h265",
+                                          config_.video.payload_type);
+    fanout_->SetKeyframeRequestCallback([this](const std::string& session_id,
+                                               const char* reason) {
+        HandleKeyframeRequest(session_id, reason);
+    });
+    if (config_.abr.enabled) {
+        LOG_INFO("自适应码率已启用: {}~{} kbps", config_.abr.min_kbps, config_.abr.max_kbps);
+    }
 
     // 设置信令回调
     signaling_->OnWebRTCReady([this](const std::string& role, const std::string& peer_id) {
@@ -94,6 +175,12 @@ WebRTCError WebRTCSystem::Init(std::shared_ptr<SignalingClient> signaling) {
     });
 
     initialized_.store(true);
+
+    if (config_.standby_peer) {
+        standby_stop_.store(false);
+        standby_thread_ = std::thread(&WebRTCSystem::StandbyLoop, this);
+    }
+
     LOG_INFO("WebRTC 系统初始化完成");
     return WebRTCError::kNone;
 }
@@ -105,9 +192,24 @@ void WebRTCSystem::Deinit() {
 
     LOG_INFO("关闭 WebRTC 系统...");
 
+    StopStandby();
     Disconnect();
     Cleanup();
+    CloseAllHttpSessions();
+    fanout_.reset();
     signaling_.reset();
+
+    // 观看者已全部离开，编码器恢复到上限码率
+    int target_kbps = 0;
+    bool restore = false;
+    {
+        std::lock_guard<std::mutex> lock(abr_mutex_);
+        restore = config_.abr.enabled && bitrate_controller_.Reset(&target_kbps);
+    }
+    if (restore) {
+        std::lock_guard<std::mutex> lock(feedback_mutex_);
+        if (bitrate_callback_) bitrate_callback_(target_kbps);
+    }
     initialized_.store(false);
     SetState(WebRTCState::kIdle);
 
@@ -211,41 +313,12 @@ void WebRTCSystem::Disconnect() {
     SetState(WebRTCState::kDisconnected);
 }
 
-void WebRTCSystem::SendVideoData(const uint8_t* data, size_t size, uint64_t timestamp) {
-    if (!IsConnected() || !video_track_ || !video_track_->isOpen()) {
+void WebRTCSystem::SendVideoData(const uint8_t* data, size_t size, uint64_t timestamp,
+                                 bool is_keyframe) {
+    if (!fanout_ || fanout_->ActiveViewerCount() == 0) {
         return;
     }
 
-    // 检测关键帧（IDR帧）：搜索 NAL Unit Type 5 (IDR) 或 Type 7 (SPS)
-    // H.264 NAL Unit 起始码：00 00 00 01 或 00 00 01
-    bool is_keyframe = false;
-    for (size_t i = 0; i + 4 < size; i++) {
-        // 查找起始码 00 00 00 01 或 00 00 01
-        if ((data[i] == 0 && data[i+1] == 0 && data[i+2] == 0 && data[i+3] == 1) ||
-            (data[i] == 0 && data[i+1] == 0 && data[i+2] == 1)) {
-            size_t nal_start = (data[i+2] == 1) ? i + 3 : i + 4;
-            if (nal_start < size) {
-                uint8_t nal_type = data[nal_start] & 0x1F;
-                // NAL Type 5 = IDR, Type 7 = SPS
-                if (nal_type == 5 || nal_type == 7) {
-                    is_keyframe = true;
-                    break;
-                }
-            }
-        }
-    }
-
-    // 如果还没收到关键帧，跳过非关键帧
-    if (!keyframe_received_ && !is_keyframe) {
-        return;
-    }
-    
-    // 标记已收到关键帧
-    if (is_keyframe && !keyframe_received_) {
-        keyframe_received_ = true;
-        LOG_INFO("收到首个关键帧，开始发送视频数据");
-    }
-
     // 帧率控制 - 使用更宽松的时间窗口避免丢帧
     auto now = std::chrono::steady_clock::now();
     if (last_video_send_time_ != std::chrono::steady_clock::time_point{}) {
@@ -266,23 +339,50 @@ void WebRTCSystem::SendVideoData(const uint8_t* data, size_t size, uint64_t time
             first_video_timestamp_ = timestamp;
         }
         uint64_t relative_timestamp = timestamp - first_video_timestamp_;
-        auto sample_time = std::chrono::duration<double>(relative_timestamp / 1000000.0);
-        
-        video_track_->sendFrame(
-            reinterpret_cast<const std::byte*>(data), size,
-            rtc::FrameInfo(sample_time));
 
-        // 更新统计
-        {
-            std::lock_guard<std::mutex> lock(stats_mutex_);
-            stats_.video_packets_sent++;
-            stats_.video_bytes_sent += size;
-        }
+        // 打包一次，逐个观看者改写 SSRC/序列号发送（未收到关键帧的观看者等待下一个 IDR）
+        fanout_->SendFrame(data, size, relative_timestamp, is_keyframe);
     } catch (const std::exception& e) {
         LOG_ERROR("发送视频失败: {}", e.what());
     }
 }
 
+size_t WebRTCSystem::SendVideoBurst(const std::vector<RtpFanout::BurstFrame>& frames) {
+    if (!fanout_ || frames.empty()) {
+        return 0;
+    }
+
+    // 补发帧与实时帧共用首帧时间基准；首个观看者就是补发对象时以缓存首帧为基准
+    if (first_video_timestamp_ == 0) {
+        first_video_timestamp_ = frames.front().timestamp_us;
+    }
+    if (frames.front().timestamp_us < first_video_timestamp_) {
+        LOG_DEBUG("缓存 GOP 早于时间基准，跳过补发");
+        return 0;
+    }
+
+    std::vector<RtpFanout::BurstFrame> relative(frames);
+    for (auto& frame : relative) {
+        frame.timestamp_us -= first_video_timestamp_;
+    }
+
+    size_t delivered = 0;
+    try {
+        delivered = fanout_->SendBurst(relative);
+    } catch (const std::exception& e) {
+        LOG_ERROR("补发 GOP 失败: {}", e.what());
+        return 0;
+    }
+    if (delivered > 0) {
+        gop_bursts_.fetch_add(1);
+    }
+    return delivered;
+}
+
+size_t WebRTCSystem::AwaitingKeyframeCount() const {
+    return fanout_ ? fanout_->AwaitingKeyframeCount() : 0;
+}
+
 bool WebRTCSystem::SendDataMessage(const std::string& message) {
     if (!data_channel_ || !data_channel_->isOpen()) {
         LOG_WARN("DataChannel 未打开");
@@ -299,9 +399,48 @@ bool WebRTCSystem::SendDataMessage(const std::string& message) {
     }
 }
 
+size_t WebRTCSystem::SendMetadata(const std::string& message) {
+    std::vector<std::shared_ptr<rtc::DataChannel>> channels;
+    {
+        std::lock_guard<std::mutex> lock(http_mutex_);
+        channels.reserve(http_sessions_.size() + 1);
+        for (const auto& session : http_sessions_) {
+            if (!session->closed.load() && session->metadata) {
+                channels.push_back(session->metadata);
+            }
+        }
+    }
+    if (auto dc = std::atomic_load(&metadata_channel_)) {
+        channels.push_back(std::move(dc));
+    }
+
+    size_t delivered = 0;
+    for (const auto& dc : channels) {
+        if (SendMetadataTo(dc, message, metadata_sent_, metadata_dropped_)) {
+            ++delivered;
+        }
+    }
+    return delivered;
+}
+
+bool WebRTCSystem::HasMetadataChannels() const {
+    if (auto dc = std::atomic_load(&metadata_channel_); dc && dc->isOpen()) {
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(http_mutex_);
+    return std::any_of(http_sessions_.begin(), http_sessions_.end(),
+                       [](const std::shared_ptr<HttpSession>& s) {
+                           return !s->closed.load() && s->metadata && s->metadata->isOpen();
+                       });
+}
+
 bool WebRTCSystem::IsConnected() const {
     auto s = state_.load();
-    return s == WebRTCState::kIceConnected || s == WebRTCState::kConnected;
+    if (s == WebRTCState::kIceConnected || s == WebRTCState::kConnected) {
+        return true;
+    }
+    // HTTP 观看者不经过 state_ 状态机，以轨道是否打开为准
+    return fanout_ && fanout_->ActiveViewerCount() > 0;
 }
 
 bool WebRTCSystem::IsConnecting() const {
@@ -320,6 +459,40 @@ std::string WebRTCSystem::GetPeerId() const {
 WebRTCStats WebRTCSystem::GetStats() const {
     std::lock_guard<std::mutex> lock(stats_mutex_);
     WebRTCStats result = stats_;
+
+    if (fanout_) {
+        result.peers = fanout_->GetPeerStats();
+        result.viewer_count = result.peers.size();
+        result.video_frames_packetized = fanout_->FramesPacketized();
+        for (const auto& peer : result.peers) {
+            result.video_packets_sent += peer.packets_sent;
+            result.video_bytes_sent += peer.bytes_sent;
+        }
+    }
+
+    result.abr_enabled = config_.abr.enabled;
+    result.abr_adjustments = abr_adjustments_.load();
+    result.keyframe_requests = keyframe_requests_.load();
+    result.gop_bursts = gop_bursts_.load();
+    result.metadata_sent = metadata_sent_.load();
+    result.metadata_dropped = metadata_dropped_.load();
+    result.connects = connects_.load();
+    result.last_connect_ms = last_connect_ms_.load();
+    if (result.connects > 0) {
+        result.avg_connect_ms = static_cast<double>(connect_ms_total_.load()) / result.connects;
+    }
+    result.standby_enabled = config_.standby_peer;
+    result.standby_hits = standby_hits_.load();
+    result.standby_misses = standby_misses_.load();
+    {
+        std::lock_guard<std::mutex> standby_lock(standby_mutex_);
+        result.standby_ready = standby_ != nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> abr_lock(abr_mutex_);
+        result.abr_target_kbps = bitrate_controller_.TargetKbps();
+        bitrate_controller_.AnnotatePeers(result.peers);
+    }
     
     if (connection_start_time_ != std::chrono::steady_clock::time_point{} && IsConnected()) {
         auto now = std::chrono::steady_clock::now();
@@ -351,6 +524,16 @@ void WebRTCSystem::OnDataMessage(MessageCallback callback) {
     message_callback_ = std::move(callback);
 }
 
+void WebRTCSystem::OnBitrateRequest(BitrateCallback callback) {
+    std::lock_guard<std::mutex> lock(feedback_mutex_);
+    bitrate_callback_ = std::move(callback);
+}
+
+void WebRTCSystem::OnKeyframeRequest(KeyframeCallback callback) {
+    std::lock_guard<std::mutex> lock(feedback_mutex_);
+    keyframe_callback_ = std::move(callback);
+}
+
 const char* WebRTCSystem::StateToString(WebRTCState state) {
     switch (state) {
         case WebRTCState::kIdle: return "Idle";
@@ -392,6 +575,10 @@ void WebRTCSystem::HandleStateTransition(WebRTCState old_state, WebRTCState new_
         case WebRTCState::kConnected:
             connection_start_time_ = std::chrono::steady_clock::now();
             LOG_INFO("WebRTC 连接已建立");
+            if (connect_request_time_ != std::chrono::steady_clock::time_point{}) {
+                RecordConnectTime(kSignalingSessionId, connect_request_time_);
+                connect_request_time_ = std::chrono::steady_clock::time_point{};
+            }
             break;
         case WebRTCState::kDisconnected:
         case WebRTCState::kFailed:
@@ -405,6 +592,15 @@ void WebRTCSystem::HandleStateTransition(WebRTCState old_state, WebRTCState new_
 void WebRTCSystem::StartWebRTCConnection() {
     try {
         LOG_INFO("开始建立 WebRTC 连接...");
+        connect_request_time_ = std::chrono::steady_clock::now();
+
+        // 有预热好的会话时直接发送其 Offer（候选已包含在 SDP 中），省去创建与收集的等待
+        if (auto standby = TakeStandby()) {
+            AdoptStandby(standby);
+            SetState(WebRTCState::kSdpConnecting);
+            OnLocalDescription(LocalSdp(*standby), "offer");
+            return;
+        }
 
         CreatePeerConnection();
         CreateVideoTrack(true);  // SendOnly
@@ -419,25 +615,28 @@ void WebRTCSystem::StartWebRTCConnection() {
     }
 }
 
-void WebRTCSystem::CreatePeerConnection() {
+rtc::Configuration WebRTCSystem::BuildRtcConfiguration() const {
     rtc::Configuration config;
 
     // 添加 ICE 服务器
     for (const auto& stun : config_.ice.stun_servers) {
         config.iceServers.emplace_back(stun);
-        LOG_INFO("添加 STUN 服务器: {}", stun);
+        LOG_DEBUG("添加 STUN 服务器: {}", stun);
     }
     for (const auto& turn : config_.ice.turn_servers) {
         config.iceServers.emplace_back(turn);
-        LOG_INFO("添加 TURN 服务器: {}", turn);
+        LOG_DEBUG("添加 TURN 服务器: {}", turn);
     }
 
     config.iceTransportPolicy = config_.ice.use_relay_only 
         ? rtc::TransportPolicy::Relay 
         : rtc::TransportPolicy::All;
     config.disableAutoNegotiation = true;
+    return config;
+}
 
-    peer_connection_ = std::make_shared<rtc::PeerConnection>(config);
+void WebRTCSystem::CreatePeerConnection() {
+    peer_connection_ = std::make_shared<rtc::PeerConnection>(BuildRtcConfiguration());
     SetupPeerConnectionCallbacks();
 
     sdp_exchange_completed_.store(false);
@@ -460,36 +659,31 @@ void WebRTCSystem::CreateVideoTrack(bool send_only) {
             ? rtc::Description::Direction::SendOnly 
             : rtc::Description::Direction::RecvOnly;
 
-        LOG_INFO("创建视频轨道: {}x{} @ {}fps, direction={}", 
-                 config_.video.width, config_.video.height, config_.video.fps,
-                 send_only ? "SendOnly" : "RecvOnly");
-
-        rtc::Description::Video video_desc("video", direction);
-        video_desc.addH264Codec(config_.video.payload_type);
-        video_desc.addSSRC(config_.video.ssrc, "video", "stream1", "video");
-
-        video_track_ = peer_connection_->addTrack(video_desc);
+        LOG_INFO("创建视频轨道: {} {}x{} @ {}fps, direction={}", 
+                 config_.video.codec, config_.video.width, config_.video.height,
+                 config_.video.fps, send_only ? "SendOnly" : "RecvOnly");
 
         if (send_only) {
-            // 配置 RTP 发送组件
-            video_rtp_config_ = std::make_shared<rtc::RtpPacketizationConfig>(
-                config_.video.ssrc, "video", config_.video.payload_type,
-                rtc::H264RtpPacketizer::ClockRate);
-
-            video_packetizer_ = std::make_shared<rtc::H264RtpPacketizer>(
-                rtc::NalUnit::Separator::StartSequence, video_rtp_config_, 1200);
-
-            video_sr_reporter_ = std::make_shared<rtc::RtcpSrReporter>(video_rtp_config_);
-            video_packetizer_->addToChain(video_sr_reporter_);
-
-            video_rtcp_session_ = std::make_shared<rtc::RtcpReceivingSession>();
-            video_packetizer_->addToChain(video_rtcp_session_);
-
-            video_track_->setMediaHandler(video_packetizer_);
-
+            // 发送轨道加入扇出（不单独挂打包器，共享 RtpFanout 的打包结果）
+            video_track_ = fanout_ ? fanout_->AddViewer(kSignalingSessionId, *peer_connection_,
+                                                        config_.video.ssrc)
+                                   : nullptr;
+            if (!video_track_) {
+                LOG_ERROR("视频轨道加入扇出失败");
+                return;
+            }
             video_track_->onOpen([this]() {
                 OnTrackOpen();
             });
+        } else {
+            rtc::Description::Video video_desc("video", direction);
+            if (config_.video.codec == "h265") {
+                video_desc.addH265Codec(config_.video.payload_type);
+            } else {
+                video_desc.addH264Codec(config_.video.payload_type);
+            }
+            video_desc.addSSRC(config_.video.ssrc, "video", "stream1", "video");
+            video_track_ = peer_connection_->addTrack(video_desc);
         }
 
         LOG_INFO("视频轨道创建成功");
@@ -506,20 +700,10 @@ void WebRTCSystem::SetupDataChannel() {
 
     try {
         data_channel_ = peer_connection_->createDataChannel("message");
+        SetupDataChannelCallbacks();
 
-        data_channel_->onOpen([this]() {
-            OnDataChannelOpen();
-        });
-
-        data_channel_->onClosed([this]() {
-            LOG_INFO("DataChannel 已关闭");
-        });
-
-        data_channel_->onMessage([this](auto data) {
-            if (std::holds_alternative<std::string>(data)) {
-                OnDataChannelMessage(std::get<std::string>(data));
-            }
-        });
+        // 检测元数据通道只发不收
+        std::atomic_store(&metadata_channel_, CreateMetadataChannel(*peer_connection_));
 
         LOG_INFO("DataChannel 创建成功");
     } catch (const std::exception& e) {
@@ -527,6 +711,22 @@ void WebRTCSystem::SetupDataChannel() {
     }
 }
 
+void WebRTCSystem::SetupDataChannelCallbacks() {
+    data_channel_->onOpen([this]() {
+        OnDataChannelOpen();
+    });
+
+    data_channel_->onClosed([this]() {
+        LOG_INFO("DataChannel 已关闭");
+    });
+
+    data_channel_->onMessage([this](auto data) {
+        if (std::holds_alternative<std::string>(data)) {
+            OnDataChannelMessage(std::get<std::string>(data));
+        }
+    });
+}
+
 void WebRTCSystem::GenerateAndSendOffer() {
     if (!peer_connection_) {
         LOG_ERROR("PeerConnection 未创建");
@@ -592,10 +792,14 @@ void WebRTCSystem::FlushPendingIceCandidates() {
         peer_id = peer_device_id_;
     }
 
-    for (const auto& [candidate, mid, mline_index] : pending_ice_candidates_) {
-        if (signaling_ && signaling_->IsPaired()) {
-            signaling_->SendIceCandidate(candidate, mid, mline_index, peer_id);
+    // 合并为一条信令消息
+    if (signaling_ && signaling_->IsPaired()) {
+        std::vector<IceCandidate> batch;
+        batch.reserve(pending_ice_candidates_.size());
+        for (const auto& [candidate, mid, mline_index] : pending_ice_candidates_) {
+            batch.push_back(IceCandidate{candidate, mid, mline_index});
         }
+        signaling_->SendIceCandidates(batch, peer_id);
     }
 
     pending_ice_candidates_.clear();
@@ -613,6 +817,14 @@ void WebRTCSystem::SetupPeerConnectionCallbacks() {
         OnLocalCandidate(std::string(candidate), candidate.mid());
     });
 
+    // SDP 交换完成后收集到的候选在收集结束时一次发出
+    peer_connection_->onGatheringStateChange([this](rtc::PeerConnection::GatheringState state) {
+        if (state == rtc::PeerConnection::GatheringState::Complete &&
+            sdp_exchange_completed_.load()) {
+            FlushPendingIceCandidates();
+        }
+    });
+
     peer_connection_->onStateChange([this](rtc::PeerConnection::State state) {
         OnPeerConnectionStateChange(static_cast<int>(state));
     });
@@ -657,6 +869,7 @@ void WebRTCSystem::OnLocalDescription(const std::string& sdp, const std::string&
         signaling_->SendAnswer(sdp, peer_id);
         sdp_exchange_completed_.store(true);
         SetState(WebRTCState::kSdpConnected);
+        FlushPendingIceCandidates();
     }
 }
 
@@ -665,19 +878,10 @@ void WebRTCSystem::OnLocalCandidate(const std::string& candidate, const std::str
         return;
     }
 
-    if (sdp_exchange_completed_.load()) {
-        std::string peer_id;
-        {
-            std::lock_guard<std::mutex> lock(state_mutex_);
-            peer_id = peer_device_id_;
-        }
-        signaling_->SendIceCandidate(candidate, mid, 0, peer_id);
-        LOG_DEBUG("发送 ICE 候选");
-    } else {
-        std::lock_guard<std::mutex> lock(ice_mutex_);
-        pending_ice_candidates_.emplace_back(candidate, mid, 0);
-        LOG_DEBUG("缓存 ICE 候选: {}", pending_ice_candidates_.size());
-    }
+    // 不逐个发送：SDP 交换完成或候选收集结束时合并为一条消息
+    std::lock_guard<std::mutex> lock(ice_mutex_);
+    pending_ice_candidates_.emplace_back(candidate, mid, 0);
+    LOG_DEBUG("缓存 ICE 候选: {}", pending_ice_candidates_.size());
 }
 
 void WebRTCSystem::OnPeerConnectionStateChange(int state) {
@@ -750,10 +954,53 @@ void WebRTCSystem::OnDataChannelMessage(const std::string& message) {
     }
 }
 
+// ============================================================================
+// 自适应码率
+// ============================================================================
+
+void WebRTCSystem::UpdateBitrate() {
+    if (!config_.abr.enabled) {
+        return;
+    }
+
+    int target_kbps = 0;
+    {
+        std::lock_guard<std::mutex> lock(abr_mutex_);
+        if (!bitrate_controller_.IsDue()) {
+            return;
+        }
+        auto peers = fanout_ ? fanout_->GetPeerStats() : std::vector<WebRTCPeerStats>{};
+        if (!bitrate_controller_.Update(peers, &target_kbps)) {
+            return;
+        }
+    }
+
+    LOG_INFO("目标码率调整为 {} kbps", target_kbps);
+    abr_adjustments_.fetch_add(1);
+
+    std::lock_guard<std::mutex> lock(feedback_mutex_);
+    if (bitrate_callback_) {
+        bitrate_callback_(target_kbps);
+    }
+}
+
+void WebRTCSystem::HandleKeyframeRequest(const std::string& session_id, const char* reason) {
+    LOG_DEBUG("观看者 {} 请求关键帧 ({})", session_id, reason);
+    keyframe_requests_.fetch_add(1);
+
+    std::lock_guard<std::mutex> lock(feedback_mutex_);
+    if (keyframe_callback_) {
+        keyframe_callback_();
+    }
+}
+
 void WebRTCSystem::Cleanup() {
     LOG_INFO("清理 WebRTC 资源...");
 
-    // 关闭轨道
+    // 退出扇出，再关闭轨道
+    if (fanout_) {
+        fanout_->RemoveViewer(kSignalingSessionId);
+    }
     if (video_track_) {
         try {
             video_track_->close();
@@ -761,12 +1008,6 @@ void WebRTCSystem::Cleanup() {
         video_track_.reset();
     }
 
-    // 清理 RTP 组件
-    video_packetizer_.reset();
-    video_rtp_config_.reset();
-    video_sr_reporter_.reset();
-    video_rtcp_session_.reset();
-
     // 关闭 DataChannel
     if (data_channel_) {
         try {
@@ -774,6 +1015,11 @@ void WebRTCSystem::Cleanup() {
         } catch (...) {}
         data_channel_.reset();
     }
+    if (auto dc = std::atomic_exchange(&metadata_channel_, std::shared_ptr<rtc::DataChannel>())) {
+        try {
+            dc->close();
+        } catch (...) {}
+    }
 
     // 关闭 PeerConnection
     if (peer_connection_) {
@@ -791,7 +1037,7 @@ void WebRTCSystem::Cleanup() {
         message_callback_ = nullptr;
     }
 
-    // 重置统计
+    // 重置统计（观看者统计由扇出按会话维护）
     {
         std::lock_guard<std::mutex> lock(stats_mutex_);
         stats_ = WebRTCStats{};
@@ -804,17 +1050,18 @@ void WebRTCSystem::Cleanup() {
     }
     sdp_exchange_completed_.store(false);
 
-    // 重置时间戳和关键帧状态
-    first_video_timestamp_ = 0;
-    last_video_send_time_ = std::chrono::steady_clock::time_point{};
-    keyframe_received_ = false;
+    // 没有其他观看者时重置时间戳基准
+    if (!fanout_ || fanout_->ViewerCount() == 0) {
+        first_video_timestamp_ = 0;
+        last_video_send_time_ = std::chrono::steady_clock::time_point{};
+    }
 
     LOG_INFO("资源清理完成");
 }
 
 bool WebRTCSystem::ValidateConfig() const {
-    if (config_.video.codec != "h264") {
-        LOG_ERROR("仅支持 H.264 编码");
+    if (config_.video.codec != "h264" && config_.video.codec != "h265") {
+        LOG_ERROR("仅支持 H.264/H.265 编码");
         return false;
     }
 
@@ -839,109 +1086,198 @@ void WebRTCSystem::InvokeErrorCallback(WebRTCError error, const std::string& mes
 }
 
 // ============================================================================
-// HTTP 信令模式实现
+// HTTP 信令模式实现（多观看者）
 // ============================================================================
 
-std::string WebRTCSystem::CreateOfferForHttp() {
-    LOG_INFO("[HTTP] 创建 Offer...");
-
-    // 清理之前的连接
-    if (peer_connection_) {
-        Cleanup();
+std::shared_ptr<WebRTCSystem::HttpSession> WebRTCSystem::FindHttpSession(
+    const std::string& session_id) const {
+    std::lock_guard<std::mutex> lock(http_mutex_);
+    const std::string& id = session_id.empty() ? latest_http_session_ : session_id;
+    for (const auto& session : http_sessions_) {
+        if (session->id == id) return session;
     }
+    return nullptr;
+}
 
-    http_mode_.store(true);
-    pending_local_sdp_.clear();
+void WebRTCSystem::PruneHttpSessions() {
+    // 在 HTTP 线程中销毁已关闭的 PeerConnection（不能在其自身回调中析构）
+    std::vector<std::shared_ptr<HttpSession>> closed;
     {
-        std::lock_guard<std::mutex> lock(local_ice_mutex_);
-        local_ice_candidates_.clear();
+        std::lock_guard<std::mutex> lock(http_mutex_);
+        auto it = std::partition(http_sessions_.begin(), http_sessions_.end(),
+                                 [](const std::shared_ptr<HttpSession>& s) {
+                                     return !s->closed.load();
+                                 });
+        closed.assign(std::make_move_iterator(it),
+                      std::make_move_iterator(http_sessions_.end()));
+        http_sessions_.erase(it, http_sessions_.end());
+    }
+    for (auto& session : closed) {
+        if (fanout_) fanout_->RemoveViewer(session->id);
+        CloseSession(session);
+        LOG_INFO("[HTTP] 会话已回收: {}", session->id);
     }
+}
 
+void WebRTCSystem::CloseSession(const std::shared_ptr<HttpSession>& session) {
+    if (!session || !session->pc) {
+        return;
+    }
     try {
-        CreatePeerConnection();
-        CreateVideoTrack(true);  // SendOnly
-        // SetupDataChannel();  // 暂时不需要 DataChannel
+        session->pc->onStateChange(nullptr);
+        session->pc->close();
+    } catch (...) {}
+}
 
-        SetState(WebRTCState::kSdpConnecting);
+std::string WebRTCSystem::LocalSdp(const HttpSession& session) {
+    // 本地描述随收集过程追加候选，收集完成后即为带全部候选的完整 SDP
+    auto desc = session.pc->localDescription();
+    return desc ? std::string(*desc) : std::string();
+}
 
-        // 设置回调来捕获本地描述
-        std::mutex sdp_mutex;
-        std::condition_variable sdp_cv;
-        bool sdp_ready = false;
-        std::string local_sdp;
-
-        peer_connection_->onLocalDescription([&](rtc::Description desc) {
-            std::lock_guard<std::mutex> lock(sdp_mutex);
-            local_sdp = std::string(desc);
-            sdp_ready = true;
-            sdp_cv.notify_one();
-            LOG_INFO("[HTTP] 本地描述已生成");
-        });
+void WebRTCSystem::CloseAllHttpSessions() {
+    {
+        std::lock_guard<std::mutex> lock(http_mutex_);
+        for (auto& session : http_sessions_) {
+            session->closed.store(true);
+        }
+        latest_http_session_.clear();
+    }
+    PruneHttpSessions();
+}
 
-        // 重新设置 ICE 候选回调以收集本地候选
-        peer_connection_->onLocalCandidate([this](rtc::Candidate candidate) {
-            std::lock_guard<std::mutex> lock(local_ice_mutex_);
-            local_ice_candidates_.emplace_back(std::string(candidate), candidate.mid());
-            LOG_DEBUG("[HTTP] 收集到本地 ICE 候选: {}", candidate.mid());
-        });
+bool WebRTCSystem::CloseHttpSession(const std::string& session_id) {
+    auto session = FindHttpSession(session_id);
+    if (!session) {
+        return false;
+    }
+    session->closed.store(true);
+    PruneHttpSessions();
+    return true;
+}
 
-        // 生成 Offer
-        peer_connection_->setLocalDescription();
+std::string WebRTCSystem::CreateOfferForHttp(std::string* session_id) {
+    LOG_INFO("[HTTP] 创建 Offer...");
+
+    if (!fanout_) {
+        LOG_ERROR("[HTTP] WebRTC 系统未初始化");
+        return "";
+    }
+
+    PruneHttpSessions();
 
-        // 等待 SDP 生成
-        std::unique_lock<std::mutex> lock(sdp_mutex);
-        if (!sdp_cv.wait_for(lock, std::chrono::seconds(5), [&]{ return sdp_ready; })) {
-            LOG_ERROR("[HTTP] 等待 SDP 超时");
+    {
+        std::lock_guard<std::mutex> lock(http_mutex_);
+        if (static_cast<int>(http_sessions_.size()) >= config_.max_viewers) {
+            LOG_WARN("[HTTP] 观看者已满 ({}/{})", http_sessions_.size(), config_.max_viewers);
             return "";
         }
+    }
 
-        pending_local_sdp_ = local_sdp;
-        LOG_INFO("[HTTP] Offer 创建成功, 长度: {}", local_sdp.length());
-        return local_sdp;
+    // 优先取用预热的待命会话，没有时现场创建（只等本地 SDP，候选经 /api/webrtc/candidates 补充）
+    const auto offer_time = std::chrono::steady_clock::now();
+    auto session = TakeStandby();
+    const bool warm = session != nullptr;
+    if (!session) {
+        session = CreateSession(false);
+        if (!session) {
+            return "";
+        }
+    }
 
+    {
+        std::lock_guard<std::mutex> lock(http_mutex_);
+        ++http_session_seq_;
+        session->id = "http-" + std::to_string(http_session_seq_);
+    }
+
+    try {
+        if (!fanout_->AttachViewer(session->id, session->track, session->ssrc)) {
+            CloseSession(session);
+            return "";
+        }
+
+        // 回调只持有弱引用，避免 PeerConnection <-> 会话循环引用
+        std::weak_ptr<HttpSession> weak = session;
+        const std::string id = session->id;
+        session->pc->onStateChange([this, weak, id, offer_time](rtc::PeerConnection::State state) {
+            LOG_INFO("[HTTP] 会话 {} 状态: {}", id, static_cast<int>(state));
+            if (state == rtc::PeerConnection::State::Connected) {
+                RecordConnectTime(id, offer_time);
+            } else if (state == rtc::PeerConnection::State::Disconnected ||
+                       state == rtc::PeerConnection::State::Failed ||
+                       state == rtc::PeerConnection::State::Closed) {
+                // 立即停止发送；PeerConnection 在下次 HTTP 请求时回收
+                if (auto s = weak.lock()) s->closed.store(true);
+                if (fanout_) fanout_->RemoveViewer(id);
+            }
+        });
     } catch (const std::exception& e) {
         LOG_ERROR("[HTTP] 创建 Offer 失败: {}", e.what());
-        SetState(WebRTCState::kFailed);
+        fanout_->RemoveViewer(session->id);
+        CloseSession(session);
         return "";
     }
+
+    const std::string local_sdp = LocalSdp(*session);
+    size_t candidates = 0;
+    {
+        std::lock_guard<std::mutex> lock(session->ice_mutex);
+        candidates = session->local_candidates.size();
+    }
+
+    size_t count = 0;
+    {
+        std::lock_guard<std::mutex> lock(http_mutex_);
+        http_sessions_.push_back(session);
+        latest_http_session_ = session->id;
+        count = http_sessions_.size();
+    }
+    if (session_id) *session_id = session->id;
+
+    LOG_INFO("[HTTP] Offer 创建成功: session={}{}, 长度: {}, 候选 {} 个, 观看者 {}/{}",
+             session->id, warm ? "（预热）" : "", local_sdp.length(), candidates, count,
+             config_.max_viewers);
+    return local_sdp;
 }
 
-bool WebRTCSystem::SetAnswerFromHttp(const std::string& sdp) {
+bool WebRTCSystem::SetAnswerFromHttp(const std::string& sdp, const std::string& session_id) {
     LOG_INFO("[HTTP] 设置 Answer...");
 
-    if (!peer_connection_) {
-        LOG_ERROR("[HTTP] PeerConnection 不存在");
+    auto session = FindHttpSession(session_id);
+    if (!session) {
+        LOG_ERROR("[HTTP] 会话不存在: {}", session_id.empty() ? "(latest)" : session_id);
         return false;
     }
 
     try {
         rtc::Description remote_desc(sdp, rtc::Description::Type::Answer);
-        peer_connection_->setRemoteDescription(remote_desc);
+        session->pc->setRemoteDescription(remote_desc);
 
-        sdp_exchange_completed_.store(true);
-        SetState(WebRTCState::kSdpConnected);
-
-        LOG_INFO("[HTTP] Answer 设置成功");
+        LOG_INFO("[HTTP] Answer 设置成功: session={}", session->id);
         return true;
 
     } catch (const std::exception& e) {
         LOG_ERROR("[HTTP] 设置 Answer 失败: {}", e.what());
-        SetState(WebRTCState::kFailed);
+        session->closed.store(true);
+        PruneHttpSessions();
         return false;
     }
 }
 
-bool WebRTCSystem::AddIceCandidateFromHttp(const std::string& candidate, const std::string& mid) {
+bool WebRTCSystem::AddIceCandidateFromHttp(const std::string& candidate, const std::string& mid,
+                                           const std::string& session_id) {
     LOG_DEBUG("[HTTP] 添加远程 ICE 候选: mid={}", mid);
 
-    if (!peer_connection_) {
-        LOG_ERROR("[HTTP] PeerConnection 不存在");
+    auto session = FindHttpSession(session_id);
+    if (!session) {
+        LOG_ERROR("[HTTP] 会话不存在: {}", session_id.empty() ? "(latest)" : session_id);
         return false;
     }
 
     try {
         rtc::Candidate rtc_candidate(candidate, mid);
-        peer_connection_->addRemoteCandidate(rtc_candidate);
+        session->pc->addRemoteCandidate(rtc_candidate);
         return true;
     } catch (const std::exception& e) {
         LOG_ERROR("[HTTP] 添加 ICE 候选失败: {}", e.what());
@@ -949,13 +1285,239 @@ bool WebRTCSystem::AddIceCandidateFromHttp(const std::string& candidate, const s
     }
 }
 
-std::vector<std::pair<std::string, std::string>> WebRTCSystem::GetLocalIceCandidates() {
-    std::lock_guard<std::mutex> lock(local_ice_mutex_);
-    return local_ice_candidates_;
+std::vector<std::pair<std::string, std::string>> WebRTCSystem::GetLocalIceCandidates(
+    const std::string& session_id) {
+    auto session = FindHttpSession(session_id);
+    if (!session) {
+        return {};
+    }
+    std::lock_guard<std::mutex> lock(session->ice_mutex);
+    return session->local_candidates;
+}
+
+bool WebRTCSystem::HasPendingLocalIceCandidates(const std::string& session_id) const {
+    auto session = FindHttpSession(session_id);
+    if (!session) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(session->ice_mutex);
+    return !session->local_candidates.empty();
+}
+
+// ============================================================================
+// 会话预热
+// ============================================================================
+
+std::shared_ptr<WebRTCSystem::HttpSession> WebRTCSystem::CreateSession(bool wait_gathering) {
+    auto session = std::make_shared<HttpSession>();
+    // 信令对端现场创建时使用 video.ssrc，预热 / HTTP 会话依次递增
+    session->ssrc = config_.video.ssrc + ssrc_seq_.fetch_add(1) + 1;
+    session->created = std::chrono::steady_clock::now();
+
+    try {
+        session->pc = std::make_shared<rtc::PeerConnection>(BuildRtcConfiguration());
+        session->track = fanout_ ? fanout_->AddTrack(*session->pc, session->ssrc) : nullptr;
+        if (!session->track) {
+            CloseSession(session);
+            return nullptr;
+        }
+
+        std::weak_ptr<HttpSession> weak = session;
+        session->pc->onLocalDescription([weak](rtc::Description /*desc*/) {
+            if (auto s = weak.lock()) {
+                std::lock_guard<std::mutex> lock(s->ice_mutex);
+                s->description_ready = true;
+                s->ice_cv.notify_all();
+            }
+        });
+
+        session->pc->onLocalCandidate([weak](rtc::Candidate candidate) {
+            if (auto s = weak.lock()) {
+                std::lock_guard<std::mutex> lock(s->ice_mutex);
+                s->local_candidates.emplace_back(std::string(candidate), candidate.mid());
+                LOG_DEBUG("收集到本地 ICE 候选: {}", candidate.mid());
+            }
+        });
+
+        session->pc->onGatheringStateChange([weak](rtc::PeerConnection::GatheringState state) {
+            if (state != rtc::PeerConnection::GatheringState::Complete) return;
+            if (auto s = weak.lock()) {
+                std::lock_guard<std::mutex> lock(s->ice_mutex);
+                s->gathering_complete = true;
+                s->ice_cv.notify_all();
+            }
+        });
+
+        // DataChannel 须在生成 Offer 前创建，才能进入首次 SDP
+        session->metadata = CreateMetadataChannel(*session->pc);
+        session->message = session->pc->createDataChannel("message");
+
+        session->pc->setLocalDescription();
+
+        // 预热时等到候选收集完成（分段等待，以便 Deinit 及时打断）
+        const auto deadline = std::chrono::steady_clock::now() +
+                              (wait_gathering ? kStandbyGatherTimeout : kSdpTimeout);
+        std::unique_lock<std::mutex> lock(session->ice_mutex);
+        auto done = [&] {
+            return wait_gathering ? session->gathering_complete : session->description_ready;
+        };
+        while (!done() && std::chrono::steady_clock::now() < deadline &&
+               !(wait_gathering && standby_stop_.load())) {
+            session->ice_cv.wait_for(lock, std::chrono::milliseconds(100));
+        }
+
+        if (wait_gathering && standby_stop_.load()) {
+            lock.unlock();
+            CloseSession(session);
+            return nullptr;
+        }
+        if (!session->description_ready) {
+            lock.unlock();
+            LOG_ERROR("等待 SDP 超时");
+            CloseSession(session);
+            return nullptr;
+        }
+        if (wait_gathering && !session->gathering_complete) {
+            LOG_WARN("候选收集未在 {}s 内完成，待命会话先使用已收集的 {} 个",
+                     std::chrono::duration_cast<std::chrono::seconds>(kStandbyGatherTimeout).count(),
+                     session->local_candidates.size());
+        }
+    } catch (const std::exception& e) {
+        LOG_ERROR("创建会话失败: {}", e.what());
+        CloseSession(session);
+        return nullptr;
+    }
+
+    return session;
+}
+
+std::shared_ptr<WebRTCSystem::HttpSession> WebRTCSystem::TakeStandby() {
+    if (!config_.standby_peer) {
+        return nullptr;
+    }
+
+    std::shared_ptr<HttpSession> session;
+    {
+        std::lock_guard<std::mutex> lock(standby_mutex_);
+        session = std::move(standby_);
+    }
+    // 唤醒预热线程补充下一个
+    standby_cv_.notify_all();
+
+    // 网络变化等原因已失效的待命会话不再使用
+    if (session) {
+        auto state = session->pc->state();
+        if (state == rtc::PeerConnection::State::Failed ||
+            state == rtc::PeerConnection::State::Closed) {
+            CloseSession(session);
+            session.reset();
+        }
+    }
+
+    if (session) {
+        standby_hits_.fetch_add(1);
+    } else {
+        standby_misses_.fetch_add(1);
+        LOG_INFO("待命会话未就绪，现场创建");
+    }
+    return session;
+}
+
+void WebRTCSystem::AdoptStandby(const std::shared_ptr<HttpSession>& session) {
+    peer_connection_ = session->pc;
+    SetupPeerConnectionCallbacks();
+
+    sdp_exchange_completed_.store(false);
+    {
+        std::lock_guard<std::mutex> lock(ice_mutex_);
+        pending_ice_candidates_.clear();
+    }
+
+    if (!fanout_ || !fanout_->AttachViewer(kSignalingSessionId, session->track, session->ssrc)) {
+        throw std::runtime_error("视频轨道加入扇出失败");
+    }
+    video_track_ = session->track;
+    video_track_->onOpen([this]() {
+        OnTrackOpen();
+    });
+
+    data_channel_ = session->message;
+    SetupDataChannelCallbacks();
+    std::atomic_store(&metadata_channel_, session->metadata);
+
+    LOG_INFO("取用预热的 PeerConnection (ssrc={})", session->ssrc);
 }
 
-bool WebRTCSystem::HasPendingLocalIceCandidates() const {
-    std::lock_guard<std::mutex> lock(local_ice_mutex_);
-    return !local_ice_candidates_.empty();
+void WebRTCSystem::StandbyLoop() {
+    std::unique_lock<std::mutex> lock(standby_mutex_);
+    while (!standby_stop_.load()) {
+        // 待命会话有效时等到它过期或被取用
+        if (standby_ && std::chrono::steady_clock::now() - standby_->created < kStandbyMaxAge) {
+            const auto expire = standby_->created + kStandbyMaxAge;
+            standby_cv_.wait_until(lock, expire, [this] {
+                return standby_stop_.load() || !standby_;
+            });
+            continue;
+        }
+
+        auto stale = std::move(standby_);
+        lock.unlock();
+        if (stale) {
+            LOG_DEBUG("待命会话已过期，重新预热");
+            CloseSession(stale);
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        auto fresh = CreateSession(true);
+        const auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+        lock.lock();
+        if (standby_stop_.load()) {
+            lock.unlock();
+            CloseSession(fresh);
+            lock.lock();
+            break;
+        }
+        if (!fresh) {
+            standby_cv_.wait_for(lock, kStandbyRetry, [this] { return standby_stop_.load(); });
+            continue;
+        }
+
+        size_t candidates = 0;
+        {
+            std::lock_guard<std::mutex> ice_lock(fresh->ice_mutex);
+            candidates = fresh->local_candidates.size();
+        }
+        standby_ = std::move(fresh);
+        LOG_DEBUG("待命会话就绪: 耗时 {}ms, 候选 {} 个", elapsed_ms, candidates);
+    }
 }
 
+void WebRTCSystem::StopStandby() {
+    {
+        std::lock_guard<std::mutex> lock(standby_mutex_);
+        standby_stop_.store(true);
+    }
+    standby_cv_.notify_all();
+    if (standby_thread_.joinable()) {
+        standby_thread_.join();
+    }
+
+    std::shared_ptr<HttpSession> standby;
+    {
+        std::lock_guard<std::mutex> lock(standby_mutex_);
+        standby = std::move(standby_);
+    }
+    CloseSession(standby);
+}
+
+void WebRTCSystem::RecordConnectTime(const std::string& session_id,
+                                     std::chrono::steady_clock::time_point since) {
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - since).count();
+    connects_.fetch_add(1);
+    connect_ms_total_.fetch_add(static_cast<uint64_t>(ms));
+    last_connect_ms_.store(ms);
+    LOG_INFO("观看者 {} 已连接，建连耗时 {}ms", session_id, ms);
+}
@@ -7,7 +7,18 @@
  * - 音视频轨道配置
  * - SDP 协商
  * - ICE 连接
- * - 媒体数据发送
+ * - 媒体数据发送（RtpFanout：每帧打包一次，扇出给多个观看者）
+ * - 自适应码率：按观看者的 RTCP 丢包 / RTT 估计可用码率，经回调调整 VENC；PLI 回调请求 IDR
+ * - 秒开：新观看者可先补发调用方提供的缓存 GOP，无需等待 IDR
+ * - 检测元数据：每个观看者附带一个无序的 "detections" DataChannel，推送 AI 检测结果
+ *   （二进制，格式见 media_producer/common/detection_metadata.h），由浏览器绘制检测框
+ * - 快速建连：后台始终预热一个待命的 PeerConnection（证书、发送轨道、DataChannel、Offer 已生成，
+ *   host/srflx 候选已收集完成），新观看者直接取用，Offer SDP 中即带全部候选；
+ *   之后的本地候选合并成批发送，不再逐个走信令
+ *
+ * 观看者来源：
+ * - 信令服务器配对的对端（单个）
+ * - HTTP 信令会话（网页直连，每次 /api/webrtc/offer 新建一个，上限 max_viewers）
  *
  * 与 RTSP 和 File 模块并列，作为视频流的第三条推送路径
  *
@@ -24,20 +35,21 @@
 #include <mutex>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <thread>
 
 #include "signaling.h"
+#include "rtp_fanout.h"
+#include "bitrate_controller.h"
 
 // 前向声明 libdatachannel 类型
 namespace rtc {
 class PeerConnection;
 class Track;
 class DataChannel;
-class RtpPacketizationConfig;
-class H264RtpPacketizer;
-class RtcpSrReporter;
-class RtcpReceivingSession;
 class Description;
 class Candidate;
+struct Configuration;
 }
 
 // ============================================================================
@@ -79,6 +91,8 @@ using StateCallback = std::function<void(WebRTCState)>;
 using ErrorCallback = std::function<void(WebRTCError, const std::string&)>;
 using DataCallback = std::function<void(const uint8_t*, size_t)>;
 using MessageCallback = std::function<void(const std::string&)>;
+using BitrateCallback = std::function<void(int kbps)>;
+using KeyframeCallback = std::function<void()>;
 
 // ============================================================================
 // WebRTC 配置
@@ -87,7 +101,7 @@ using MessageCallback = std::function<void(const std::string&)>;
 struct WebRTCConfig {
     // 视频配置
     struct {
-        std::string codec = "h264";
+        std::string codec = "h264";     ///< "h264" 或 "h265"
         int width = 1920;
         int height = 1080;
         int fps = 30;
@@ -102,6 +116,15 @@ struct WebRTCConfig {
         bool use_relay_only = false;
         int timeout_ms = 15000;
     } ice;
+
+    /// HTTP 信令模式同时在线的观看者上限（共享同一份 RTP 打包结果）
+    int max_viewers = 4;
+
+    /// 预热一个待命的 PeerConnection，新观看者取用后立即补充（过期自动重建）
+    bool standby_peer = true;
+
+    /// 自适应码率（所有观看者共享编码器，目标码率取最差观看者的估计）
+    BitrateControllerConfig abr;
 };
 
 // ============================================================================
@@ -109,9 +132,28 @@ struct WebRTCConfig {
 // ============================================================================
 
 struct WebRTCStats {
-    uint64_t video_packets_sent = 0;
-    uint64_t video_bytes_sent = 0;
+    uint64_t video_packets_sent = 0;    ///< RTP 包数（当前观看者合计）
+    uint64_t video_bytes_sent = 0;      ///< RTP 字节数（当前观看者合计）
+    uint64_t video_frames_packetized = 0;  ///< 打包的帧数（与观看者数无关）
     uint64_t connection_duration_ms = 0;
+    size_t viewer_count = 0;            ///< 已加入的观看者数
+    std::vector<WebRTCPeerStats> peers; ///< 逐个观看者的统计
+    bool abr_enabled = false;
+    int abr_target_kbps = 0;            ///< 最近一次下发给编码器的目标码率
+    uint64_t abr_adjustments = 0;       ///< 目标码率下发次数
+    uint64_t keyframe_requests = 0;     ///< 观看者 PLI/FIR 与新轨道触发的关键帧请求次数
+    uint64_t gop_bursts = 0;            ///< 新观看者补发缓存 GOP 的次数
+    uint64_t metadata_sent = 0;         ///< 检测元数据消息发送次数（按观看者计）
+    uint64_t metadata_dropped = 0;      ///< 通道积压而丢弃的检测元数据消息
+
+    // 建连耗时：从收到连接请求 / /api/webrtc/offer 到 PeerConnection Connected
+    uint64_t connects = 0;              ///< 建立成功的连接数
+    int64_t last_connect_ms = -1;       ///< 最近一次建连耗时（-1 = 尚无）
+    double avg_connect_ms = 0.0;        ///< 平均建连耗时
+    bool standby_enabled = false;
+    bool standby_ready = false;         ///< 当前是否有预热好的待命会话
+    uint64_t standby_hits = 0;          ///< 取用待命会话的连接数
+    uint64_t standby_misses = 0;        ///< 待命会话未就绪、现场创建的连接数
 };
 
 // ============================================================================
@@ -122,7 +164,7 @@ struct WebRTCStats {
  * @brief WebRTC 系统
  * 
  * 管理 WebRTC 连接的完整生命周期
- * 支持发送 H.264 编码的视频流
+ * 支持发送 H.264/H.265 编码的视频流，多个观看者共享同一份 RTP 打包结果
  */
 class WebRTCSystem {
 public:
@@ -189,48 +231,95 @@ public:
 
     /**
      * @brief 发送视频数据
-     * @param data H.264 编码数据
+     * @param data H.264/H.265 编码数据（Annex-B）
      * @param size 数据大小
      * @param timestamp 时间戳（微秒）
+     * @param is_keyframe 是否为关键帧（由分发器的 NAL 索引给出）
      */
-    void SendVideoData(const uint8_t* data, size_t size, uint64_t timestamp);
+    void SendVideoData(const uint8_t* data, size_t size, uint64_t timestamp, bool is_keyframe);
+
+    /**
+     * @brief 给等待首个关键帧的观看者补发缓存的 GOP
+     *
+     * @param frames 缓存帧（时间戳与 SendVideoData 相同为绝对微秒值，首帧须为关键帧）
+     * @return 补发到的观看者数
+     */
+    size_t SendVideoBurst(const std::vector<RtpFanout::BurstFrame>& frames);
+
+    /**
+     * @brief 轨道已打开、仍在等待首个关键帧的观看者数（大于 0 时值得补发 GOP）
+     */
+    size_t AwaitingKeyframeCount() const;
+
+    /**
+     * @brief 按评估周期更新自适应码率（未启用时直接返回）
+     *
+     * 由视频源按帧调用，没有观看者时也需要调用，以便观看者离开后恢复码率
+     */
+    void UpdateBitrate();
 
     /**
      * @brief 发送 DataChannel 消息
      */
     bool SendDataMessage(const std::string& message);
 
+    /// 检测元数据 DataChannel 的标签
+    static constexpr const char* kMetadataChannelLabel = "detections";
+
+    /**
+     * @brief 发送一条检测元数据给所有观看者（二进制消息，通道积压时丢弃）
+     * @return 发送到的观看者数
+     */
+    size_t SendMetadata(const std::string& message);
+
+    /**
+     * @brief 是否有已打开的检测元数据通道（为 false 时调用方可跳过编码）
+     */
+    bool HasMetadataChannels() const;
+
     // ========================================================================
     // HTTP 信令模式 API（用于网页直连）
     // ========================================================================
 
+    // 以下接口的 session_id 为空时指向最近创建的会话（兼容单观看者的旧页面）
+
     /**
-     * @brief 创建 Offer 用于 HTTP 信令
-     * @return SDP Offer 字符串，失败返回空
+     * @brief 创建新的观看者会话并生成 Offer
+     * @param session_id 输出新会话 ID（可为空）
+     * @return SDP Offer 字符串，失败（含观看者已满）返回空
      */
-    std::string CreateOfferForHttp();
+    std::string CreateOfferForHttp(std::string* session_id = nullptr);
 
     /**
      * @brief 处理来自 HTTP 的 Answer
      * @param sdp Answer SDP
+     * @param session_id 会话 ID
      * @return true 成功
      */
-    bool SetAnswerFromHttp(const std::string& sdp);
+    bool SetAnswerFromHttp(const std::string& sdp, const std::string& session_id = "");
 
     /**
      * @brief 添加来自 HTTP 的 ICE 候选
      */
-    bool AddIceCandidateFromHttp(const std::string& candidate, const std::string& mid);
+    bool AddIceCandidateFromHttp(const std::string& candidate, const std::string& mid,
+                                 const std::string& session_id = "");
 
     /**
      * @brief 获取本地 ICE 候选列表（用于 HTTP 响应）
      */
-    std::vector<std::pair<std::string, std::string>> GetLocalIceCandidates();
+    std::vector<std::pair<std::string, std::string>> GetLocalIceCandidates(
+        const std::string& session_id = "");
 
     /**
      * @brief 检查是否有待发送的本地 ICE 候选
      */
-    bool HasPendingLocalIceCandidates() const;
+    bool HasPendingLocalIceCandidates(const std::string& session_id = "") const;
+
+    /**
+     * @brief 关闭 HTTP 观看者会话
+     * @return true 会话存在并已关闭
+     */
+    bool CloseHttpSession(const std::string& session_id);
 
     // ========================================================================
     // 状态查询
@@ -251,6 +340,23 @@ public:
     void OnError(ErrorCallback callback);
     void OnDataMessage(MessageCallback callback);
 
+    /**
+     * @brief 设置目标码率回调（自适应码率启用时，发送线程周期性调用）
+     *
+     * @note 与状态回调不同，断开连接时不会被清除
+     */
+    void OnBitrateRequest(BitrateCallback callback);
+
+    /**
+     * @brief 设置关键帧请求回调
+     *
+     * 观看者发送 PLI/FIR（libdatachannel 线程）或轨道打开后等待首个关键帧（发送线程）时调用，
+     * 接收方负责限频合并
+     *
+     * @note 断开连接时不会被清除
+     */
+    void OnKeyframeRequest(KeyframeCallback callback);
+
     // ========================================================================
     // 工具函数
     // ========================================================================
@@ -267,6 +373,7 @@ private:
     void CreatePeerConnection();
     void CreateVideoTrack(bool send_only);
     void SetupDataChannel();
+    void SetupDataChannelCallbacks();
     void GenerateAndSendOffer();
     void ProcessRemoteOffer(const std::string& sdp);
     void ProcessRemoteAnswer(const std::string& sdp);
@@ -282,7 +389,28 @@ private:
     void OnDataChannelOpen();
     void OnDataChannelMessage(const std::string& message);
 
+    // 观看者 PLI/FIR 或新轨道等待首个关键帧
+    void HandleKeyframeRequest(const std::string& session_id, const char* reason);
+
+    // HTTP 观看者会话（也用作预热的待命会话）
+    struct HttpSession;
+    std::shared_ptr<HttpSession> FindHttpSession(const std::string& session_id) const;
+    void PruneHttpSessions();
+    void CloseAllHttpSessions();
+    static void CloseSession(const std::shared_ptr<HttpSession>& session);
+    static std::string LocalSdp(const HttpSession& session);
+
+    // 会话预热：创建 PeerConnection、轨道与 DataChannel 并生成 Offer
+    std::shared_ptr<HttpSession> CreateSession(bool wait_gathering);
+    std::shared_ptr<HttpSession> TakeStandby();
+    void AdoptStandby(const std::shared_ptr<HttpSession>& session);
+    void StandbyLoop();
+    void StopStandby();
+    void RecordConnectTime(const std::string& session_id,
+                           std::chrono::steady_clock::time_point since);
+
     // 工具方法
+    rtc::Configuration BuildRtcConfiguration() const;
     void Cleanup();
     bool ValidateConfig() const;
     void InvokeErrorCallback(WebRTCError error, const std::string& message);
@@ -302,17 +430,14 @@ private:
     std::shared_ptr<rtc::PeerConnection> peer_connection_;
     std::shared_ptr<rtc::Track> video_track_;
     std::shared_ptr<rtc::DataChannel> data_channel_;
+    std::shared_ptr<rtc::DataChannel> metadata_channel_;
 
-    // RTP 组件
-    std::shared_ptr<rtc::RtpPacketizationConfig> video_rtp_config_;
-    std::shared_ptr<rtc::H264RtpPacketizer> video_packetizer_;
-    std::shared_ptr<rtc::RtcpSrReporter> video_sr_reporter_;
-    std::shared_ptr<rtc::RtcpReceivingSession> video_rtcp_session_;
+    // RTP 扇出（所有观看者共享一个打包器，Init 时创建）
+    std::unique_ptr<RtpFanout> fanout_;
 
-    // 发送控制
+    // 发送控制（首帧时间戳在观看者之间共享，保证 RTP 时间戳连续）
     std::chrono::steady_clock::time_point last_video_send_time_;
     uint64_t first_video_timestamp_{0};  // 第一帧的时间戳，用于计算相对时间
-    bool keyframe_received_{false};      // 是否已收到关键帧
 
     // 回调函数
     mutable std::mutex callback_mutex_;
@@ -320,20 +445,50 @@ private:
     ErrorCallback error_callback_;
     MessageCallback message_callback_;
 
+    // 编码器反馈回调（码率 / 关键帧），生命周期与 WebRTCSystem 相同
+    mutable std::mutex feedback_mutex_;
+    BitrateCallback bitrate_callback_;
+    KeyframeCallback keyframe_callback_;
+
+    // 自适应码率（发送线程更新，统计查询时读取）
+    mutable std::mutex abr_mutex_;
+    BitrateController bitrate_controller_;
+    std::atomic<uint64_t> abr_adjustments_{0};
+    std::atomic<uint64_t> keyframe_requests_{0};
+    std::atomic<uint64_t> gop_bursts_{0};
+    std::atomic<uint64_t> metadata_sent_{0};
+    std::atomic<uint64_t> metadata_dropped_{0};
+
     // 统计信息
     mutable std::mutex stats_mutex_;
     WebRTCStats stats_;
     std::chrono::steady_clock::time_point connection_start_time_;
+    std::chrono::steady_clock::time_point connect_request_time_;  // 信令对端的建连起点
+
+    // 建连耗时统计（HTTP 与信令对端共用，不随 Cleanup 清零）
+    std::atomic<uint64_t> connects_{0};
+    std::atomic<uint64_t> connect_ms_total_{0};
+    std::atomic<int64_t> last_connect_ms_{-1};
+    std::atomic<uint64_t> standby_hits_{0};
+    std::atomic<uint64_t> standby_misses_{0};
 
     // ICE 候选缓存
     std::mutex ice_mutex_;
     std::vector<std::tuple<std::string, std::string, int>> pending_ice_candidates_;
     std::atomic<bool> sdp_exchange_completed_{false};
 
-    // HTTP 信令模式的本地 ICE 候选缓存
-    mutable std::mutex local_ice_mutex_;
-    std::vector<std::pair<std::string, std::string>> local_ice_candidates_;
-    std::string pending_local_sdp_;
-    std::atomic<bool> http_mode_{false};
+    // HTTP 信令模式的观看者会话
+    mutable std::mutex http_mutex_;
+    std::vector<std::shared_ptr<HttpSession>> http_sessions_;
+    std::string latest_http_session_;
+    uint32_t http_session_seq_{0};
+    std::atomic<uint32_t> ssrc_seq_{0};
+
+    // 预热的待命会话（后台线程维护）
+    mutable std::mutex standby_mutex_;
+    std::condition_variable standby_cv_;
+    std::shared_ptr<HttpSession> standby_;
+    std::atomic<bool> standby_stop_{false};
+    std::thread standby_thread_;
 };
 
@@ -50,6 +50,8 @@ bool WebRTCService::Start() {
 
     // 创建 WebRTC 系统
     webrtc_ = std::make_shared<WebRTCSystem>(config_.webrtc_config);
+    webrtc_->OnBitrateRequest(bitrate_callback_);
+    webrtc_->OnKeyframeRequest(keyframe_callback_);
 
     // 初始化 WebRTC 系统
     auto err = webrtc_->Init(signaling_);
@@ -111,6 +113,16 @@ WebRTCStats WebRTCService::GetStats() const {
     return webrtc_ ? webrtc_->GetStats() : WebRTCStats{};
 }
 
+void WebRTCService::SendMetadata(const std::string& message) {
+    if (webrtc_) {
+        webrtc_->SendMetadata(message);
+    }
+}
+
+bool WebRTCService::HasMetadataChannels() const {
+    return webrtc_ && webrtc_->HasMetadataChannels();
+}
+
 void WebRTCService::StreamConsumer(EncodedStreamPtr stream, void* user_data) {
     auto* self = static_cast<WebRTCService*>(user_data);
     if (self) {
@@ -119,18 +131,57 @@ void WebRTCService::StreamConsumer(EncodedStreamPtr stream, void* user_data) {
 }
 
 void WebRTCService::SendVideoFrame(const EncodedStreamPtr& stream) {
+    if (webrtc_) {
+        webrtc_->UpdateBitrate();
+    }
     if (!IsConnected() || !stream || !stream->pstPack) {
         return;
     }
 
     // 获取视频数据
-    const uint8_t* data = static_cast<const uint8_t*>(
-        RK_MPI_MB_Handle2VirAddr(stream->pstPack->pMbBlk));
+    const uint8_t* data = static_cast<const uint8_t*>(get_stream_vir_addr(stream));
     uint32_t len = stream->pstPack->u32Len;
     uint64_t pts = stream->pstPack->u64PTS;
 
-    if (data && len > 0) {
-        webrtc_->SendVideoData(data, len, pts);
+    if (!data || len == 0) {
+        return;
+    }
+
+    // 关键帧判断优先使用分发器建立的 NAL 索引
+    const media::NalIndex* nal = get_stream_nal_index(stream);
+    media::NalIndex local;
+    if (!nal) {
+        media::VideoCodec codec = media::VideoCodec::kH264;
+        media::ParseVideoCodec(config_.webrtc_config.video.codec, &codec);
+        media::build_nal_index(data, len, codec, &local);
+        nal = &local;
+    }
+
+    // 新观看者先补发缓存的 GOP，随后的实时帧直接衔接
+    if (!nal->is_keyframe && gop_callback_ && webrtc_->AwaitingKeyframeCount() > 0) {
+        SendGopBurst(pts);
+    }
+
+    webrtc_->SendVideoData(data, len, pts, nal->is_keyframe);
+}
+
+void WebRTCService::SendGopBurst(uint64_t pts) {
+    auto cached = gop_callback_();
+    std::vector<RtpFanout::BurstFrame> frames;
+    frames.reserve(cached.size());
+    for (const auto& stream : cached) {
+        // 缓存末尾通常就是当前帧，由实时路径发送
+        if (get_stream_pts(stream) >= pts) break;
+        RtpFanout::BurstFrame frame;
+        frame.data = static_cast<const uint8_t*>(get_stream_vir_addr(stream));
+        frame.size = get_stream_length(stream);
+        frame.timestamp_us = get_stream_pts(stream);
+        if (frame.data && frame.size > 0) {
+            frames.push_back(frame);
+        }
+    }
+    if (!frames.empty()) {
+        webrtc_->SendVideoBurst(frames);
     }
 }
 
@@ -146,39 +197,66 @@ void WebRTCService::OnError(ErrorCallback callback) {
     }
 }
 
+void WebRTCService::OnBitrateRequest(BitrateCallback callback) {
+    bitrate_callback_ = std::move(callback);
+    if (webrtc_) {
+        webrtc_->OnBitrateRequest(bitrate_callback_);
+    }
+}
+
+void WebRTCService::OnGopSnapshotRequest(GopSnapshotCallback callback) {
+    gop_callback_ = std::move(callback);
+}
+
+void WebRTCService::OnKeyframeRequest(KeyframeCallback callback) {
+    keyframe_callback_ = std::move(callback);
+    if (webrtc_) {
+        webrtc_->OnKeyframeRequest(keyframe_callback_);
+    }
+}
+
 // ============================================================================
 // HTTP 信令模式实现
 // ============================================================================
 
-std::string WebRTCService::CreateOfferForHttp() {
+std::string WebRTCService::CreateOfferForHttp(std::string* session_id) {
     if (!webrtc_) {
         LOG_ERROR("WebRTC 系统未初始化");
         return "";
     }
-    return webrtc_->CreateOfferForHttp();
+    return webrtc_->CreateOfferForHttp(session_id);
 }
 
-bool WebRTCService::SetAnswerFromHttp(const std::string& sdp) {
+bool WebRTCService::SetAnswerFromHttp(const std::string& sdp, const std::string& session_id) {
     if (!webrtc_) {
         LOG_ERROR("WebRTC 系统未初始化");
         return false;
     }
-    return webrtc_->SetAnswerFromHttp(sdp);
+    return webrtc_->SetAnswerFromHttp(sdp, session_id);
 }
 
-bool WebRTCService::AddIceCandidateFromHttp(const std::string& candidate, const std::string& mid) {
+bool WebRTCService::AddIceCandidateFromHttp(const std::string& candidate, const std::string& mid,
+                                            const std::string& session_id) {
     if (!webrtc_) {
         LOG_ERROR("WebRTC 系统未初始化");
         return false;
     }
-    return webrtc_->AddIceCandidateFromHttp(candidate, mid);
+    return webrtc_->AddIceCandidateFromHttp(candidate, mid, session_id);
 }
 
-std::vector<std::pair<std::string, std::string>> WebRTCService::GetLocalIceCandidates() {
+std::vector<std::pair<std::string, std::string>> WebRTCService::GetLocalIceCandidates(
+    const std::string& session_id) {
     if (!webrtc_) {
         return {};
     }
-    return webrtc_->GetLocalIceCandidates();
+    return webrtc_->GetLocalIceCandidates(session_id);
+}
+
+bool WebRTCService::CloseHttpSession(const std::string& session_id) {
+    if (!webrtc_) {
+        return false;
+    }
+    return webrtc_->CloseHttpSession(session_id);
 }
 
 // ============================================================================
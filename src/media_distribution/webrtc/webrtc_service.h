@@ -18,9 +18,11 @@
 
 #pragma once
 
+#include <functional>
 #include <string>
 #include <memory>
 #include <atomic>
+#include <vector>
 
 #include "webrtc.h"
 #include "signaling.h"
@@ -51,6 +53,9 @@ struct WebRTCServiceConfig {
  */
 class WebRTCService {
 public:
+    /// 新观看者等待首个关键帧时获取 GOP 缓存快照（首帧为关键帧，为空表示无缓存）
+    using GopSnapshotCallback = std::function<std::vector<EncodedStreamPtr>()>;
+
     /**
      * @brief 构造函数
      * @param config WebRTC 服务配置
@@ -110,6 +115,16 @@ public:
      */
     void SendVideoFrame(const EncodedStreamPtr& stream);
 
+    /**
+     * @brief 发送检测元数据给所有观看者的 "detections" DataChannel
+     */
+    void SendMetadata(const std::string& message);
+
+    /**
+     * @brief 是否有观看者打开了检测元数据通道
+     */
+    bool HasMetadataChannels() const;
+
     // ========================================================================
     // 回调设置
     // ========================================================================
@@ -124,30 +139,53 @@ public:
      */
     void OnError(ErrorCallback callback);
 
+    /**
+     * @brief 设置目标码率回调（自适应码率，Start 之前或之后设置均可，重启后保留）
+     */
+    void OnBitrateRequest(BitrateCallback callback);
+
+    /**
+     * @brief 设置关键帧请求回调（观看者 PLI/FIR，重启后保留）
+     */
+    void OnKeyframeRequest(KeyframeCallback callback);
+
+    /**
+     * @brief 设置 GOP 快照回调（新观看者先补发缓存的 GOP，没有缓存时等待请求的 IDR）
+     */
+    void OnGopSnapshotRequest(GopSnapshotCallback callback);
+
     // ========================================================================
-    // HTTP 信令模式 API
+    // HTTP 信令模式 API（每个观看者一个会话，session_id 为空时指向最近创建的会话）
     // ========================================================================
 
     /**
-     * @brief 创建 Offer (HTTP 信令模式)
-     * @return SDP Offer
+     * @brief 创建观看者会话与 Offer (HTTP 信令模式)
+     * @param session_id 输出新会话 ID
+     * @return SDP Offer，失败或观看者已满返回空
      */
-    std::string CreateOfferForHttp();
+    std::string CreateOfferForHttp(std::string* session_id = nullptr);
 
     /**
      * @brief 设置 Answer (HTTP 信令模式)
      */
-    bool SetAnswerFromHttp(const std::string& sdp);
+    bool SetAnswerFromHttp(const std::string& sdp, const std::string& session_id = "");
 
     /**
      * @brief 添加远程 ICE 候选 (HTTP 信令模式)
      */
-    bool AddIceCandidateFromHttp(const std::string& candidate, const std::string& mid);
+    bool AddIceCandidateFromHttp(const std::string& candidate, const std::string& mid,
+                                 const std::string& session_id = "");
 
     /**
      * @brief 获取本地 ICE 候选列表
      */
-    std::vector<std::pair<std::string, std::string>> GetLocalIceCandidates();
+    std::vector<std::pair<std::string, std::string>> GetLocalIceCandidates(
+        const std::string& session_id = "");
+
+    /**
+     * @brief 关闭观看者会话（浏览器主动断开时调用，立即释放名额）
+     */
+    bool CloseHttpSession(const std::string& session_id);
 
 private:
     WebRTCServiceConfig config_;
@@ -155,6 +193,15 @@ private:
     
     std::shared_ptr<SignalingClient> signaling_;
     std::shared_ptr<WebRTCSystem> webrtc_;
+
+    /**
+     * @brief 给等待首个关键帧的观看者补发 GOP（不含时间戳不早于 pts 的当前帧）
+     */
+    void SendGopBurst(uint64_t pts);
+
+    BitrateCallback bitrate_callback_;
+    KeyframeCallback keyframe_callback_;
+    GopSnapshotCallback gop_callback_;
 };
 
 // ============================================================================
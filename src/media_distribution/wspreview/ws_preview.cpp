@@ -16,12 +16,22 @@
 #undef LOG_TAG
 #define LOG_TAG "ws_preview"
 
+namespace {
+
+int64_t NowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace
+
 // ============================================================================
 // WsPreviewServer 实现
 // ============================================================================
 
 WsPreviewServer::WsPreviewServer(const WsPreviewConfig& config)
-    : config_(config) {
+    : config_(config)
+    , clients_(std::make_shared<const ClientList>()) {
     LOG_INFO("WebSocket 预览服务器创建: port={}", config_.port);
 }
 
@@ -88,21 +98,20 @@ void WsPreviewServer::Stop() {
 
     // 先拿出所有客户端 shared_ptr，释放锁后再 close
     // 避免死锁：close() 可能同步触发 onClosed 回调，回调中会获取 clients_mutex_
-    std::vector<std::shared_ptr<rtc::WebSocket>> clients_to_close;
+    std::shared_ptr<const ClientList> clients_to_close;
     {
         std::lock_guard<std::mutex> lock(clients_mutex_);
-        clients_to_close.swap(clients_);
+        clients_to_close = LoadClients();
+        StoreClientsLocked(std::make_shared<const ClientList>());
     }
     
     // 在锁外关闭所有客户端
-    for (auto& ws : clients_to_close) {
-        if (ws) {
-            try {
-                ws->close();
-            } catch (...) {}
-        }
+    for (const auto& client : *clients_to_close) {
+        try {
+            client->ws->close();
+        } catch (...) {}
     }
-    clients_to_close.clear();  // 释放所有 shared_ptr
+    clients_to_close.reset();  // 释放所有 shared_ptr
 
     // 停止服务器
     if (ws_server_) {
@@ -110,8 +119,10 @@ void WsPreviewServer::Stop() {
         ws_server_.reset();
     }
 
-    LOG_INFO("WebSocket 预览服务器已停止, 总计发送: {} 帧, {} 字节",
-             frames_sent_.load(), bytes_sent_.load());
+    LOG_INFO("WebSocket 预览服务器已停止, 总计发送: {} 帧, {} 字节, GOP 补发 {} 次, "
+             "丢帧 {} 次, 断开慢客户端 {} 个",
+             frames_sent_.load(), bytes_sent_.load(), gop_bursts_.load(),
+             frames_dropped_.load(), clients_evicted_.load());
 }
 
 uint16_t WsPreviewServer::GetPort() const {
@@ -119,48 +130,84 @@ uint16_t WsPreviewServer::GetPort() const {
 }
 
 size_t WsPreviewServer::GetClientCount() const {
-    std::lock_guard<std::mutex> lock(clients_mutex_);
+    auto clients = LoadClients();
     
     // 统计活跃的客户端数量
-    return std::count_if(clients_.begin(), clients_.end(),
-        [](const std::shared_ptr<rtc::WebSocket>& ws) {
-            return ws && ws->isOpen();
+    return std::count_if(clients->begin(), clients->end(),
+        [](const ClientPtr& client) {
+            return !client->metadata && client->ws->isOpen();
         });
 }
 
+size_t WsPreviewServer::GetMetadataClientCount() const {
+    auto clients = LoadClients();
+    return std::count_if(clients->begin(), clients->end(),
+        [](const ClientPtr& client) {
+            return client->metadata && client->ws->isOpen();
+        });
+}
+
+std::shared_ptr<const WsPreviewServer::ClientList> WsPreviewServer::LoadClients() const {
+    return std::atomic_load(&clients_);
+}
+
+void WsPreviewServer::StoreClientsLocked(std::shared_ptr<const ClientList> clients) {
+    std::atomic_store(&clients_, std::move(clients));
+}
+
 void WsPreviewServer::OnClientConnected(std::shared_ptr<rtc::WebSocket> ws) {
-    LOG_INFO("WebSocket 客户端连接, path={}", ws->path().value_or("(none)"));
+    const std::string path = ws->path().value_or("");
+    LOG_INFO("WebSocket 客户端连接, path={}", path.empty() ? "(none)" : path);
+
+    auto client = std::make_shared<Client>();
+    client->ws = ws;
+    client->address = ws->remoteAddress().value_or("");
+    client->connected_ms = NowMs();
+    client->metadata = path.substr(0, path.find('?')) == kMetadataPath;
 
     // 先添加到客户端列表（使用 shared_ptr 保持连接存活）
     {
         std::lock_guard<std::mutex> lock(clients_mutex_);
         
         // 清理已断开的连接
-        clients_.erase(
-            std::remove_if(clients_.begin(), clients_.end(),
-                [](const std::shared_ptr<rtc::WebSocket>& s) {
-                    return !s || !s->isOpen();
-                }),
-            clients_.end());
+        auto clients = std::make_shared<ClientList>();
+        for (const auto& c : *LoadClients()) {
+            if (c->ws->isOpen()) {
+                clients->push_back(c);
+            }
+        }
 
         // 检查是否超过最大连接数
-        if (static_cast<int>(clients_.size()) >= config_.max_clients) {
+        if (static_cast<int>(clients->size()) >= config_.max_clients) {
             LOG_WARN("达到最大客户端数量限制 ({}), 拒绝新连接", config_.max_clients);
+            StoreClientsLocked(std::move(clients));
             ws->close();
             return;
         }
 
         // 存入 shared_ptr，增加引用计数，保持连接存活
-        clients_.push_back(ws);
-        LOG_INFO("当前客户端数量: {}", clients_.size());
+        clients->push_back(client);
+        LOG_INFO("当前客户端数量: {}", clients->size());
+        StoreClientsLocked(std::move(clients));
     }
 
     // 设置 onOpen 回调 - WebSocket 完全就绪后再发送数据
-    ws->onOpen([this, weak_ws = std::weak_ptr<rtc::WebSocket>(ws)]() {
+    ws->onOpen([this, weak_client = std::weak_ptr<Client>(client)]() {
         LOG_INFO("WebSocket 客户端已就绪");
-        if (auto ws = weak_ws.lock()) {
-            // 发送缓存的 SPS/PPS
-            SendSpsPps(ws);
+        if (auto client = weak_client.lock()) {
+            // 元数据客户端不需要参数集和关键帧
+            if (client->metadata) {
+                return;
+            }
+            // 优先补发缓存的 GOP；没有缓存时发送 SPS/PPS 并请求 IDR 让新客户端尽快出画面
+            if (SendGopBurst(client)) {
+                return;
+            }
+            SendSpsPps(client->ws);
+            std::lock_guard<std::mutex> lock(keyframe_mutex_);
+            if (keyframe_callback_) {
+                keyframe_callback_();
+            }
         }
     });
 
@@ -172,20 +219,18 @@ void WsPreviewServer::OnClientConnected(std::shared_ptr<rtc::WebSocket> ws) {
         }
     });
 
-    // 关键：onClosed 中必须从 clients_ 移除 shared_ptr，否则引用计数永远不为0
-    ws->onClosed([this, weak_ws = std::weak_ptr<rtc::WebSocket>(ws)]() {
+    // 关键：onClosed 中必须从客户端列表移除，否则 WebSocket 的引用计数永远不为0
+    ws->onClosed([this, target = client.get()]() {
         LOG_INFO("WebSocket 客户端断开");
         
-        // 锁定并移除对应的 shared_ptr
         std::lock_guard<std::mutex> lock(clients_mutex_);
-        clients_.erase(
-            std::remove_if(clients_.begin(), clients_.end(),
-                [&weak_ws](const std::shared_ptr<rtc::WebSocket>& s) {
-                    // 比较指针地址是否相同，或者连接已关闭
-                    auto target = weak_ws.lock();
-                    return !s || !s->isOpen() || (target && s == target);
-                }),
-            clients_.end());
+        auto clients = std::make_shared<ClientList>();
+        for (const auto& c : *LoadClients()) {
+            if (c.get() != target && c->ws->isOpen()) {
+                clients->push_back(c);
+            }
+        }
+        StoreClientsLocked(std::move(clients));
     });
 
     ws->onError([](std::string error) {
@@ -193,117 +238,295 @@ void WsPreviewServer::OnClientConnected(std::shared_ptr<rtc::WebSocket> ws) {
     });
 }
 
-void WsPreviewServer::SendVideoFrame(const uint8_t* data, size_t size, uint64_t /*timestamp*/) {
+void WsPreviewServer::SendVideoFrame(const uint8_t* data, size_t size, uint64_t timestamp,
+                                     const media::NalIndex* nal) {
     if (!running_.load() || !data || size == 0) {
         return;
     }
 
-    // 提取 SPS/PPS（如果有）
-    ExtractSpsPps(data, size);
+    // 缓存 SPS/PPS（如果有）
+    media::NalIndex local;
+    if (!nal) {
+        media::build_nal_index(data, size, config_.codec, &local);
+        nal = &local;
+    }
+    CacheParameterSets(data, *nal);
 
-    // 获取活跃客户端（拷贝一份以减少锁持有时间）
-    std::vector<std::shared_ptr<rtc::WebSocket>> active_clients;
-    {
-        std::lock_guard<std::mutex> lock(clients_mutex_);
-        // 直接拷贝 shared_ptr 列表，增加引用计数
-        active_clients = clients_;
+    // 仅关键帧模式（及退出后等待关键帧期间）跳过 P 帧
+    if (nal->is_keyframe) {
+        if (resync_.load(std::memory_order_relaxed)) {
+            resync_.store(false);
+        }
+    } else if (keyframe_only_.load(std::memory_order_relaxed) ||
+               resync_.load(std::memory_order_relaxed)) {
+        frames_skipped_++;
+        return;
     }
 
-    if (active_clients.empty()) {
+    // 客户端列表快照（写时复制，不加锁）
+    auto clients = LoadClients();
+    if (clients->empty()) {
         return;
     }
 
-    // 发送给所有客户端
-    for (auto& ws : active_clients) {
-        if (ws && ws->isOpen()) {
-            try {
-                ws->send(reinterpret_cast<const std::byte*>(data), size);
-            } catch (const std::exception& e) {
-                LOG_DEBUG("发送视频帧失败: {}", e.what());
+    const size_t queue_limit = static_cast<size_t>(config_.client_queue_kb) * 1024;
+    const int64_t now = NowMs();
+    std::vector<std::shared_ptr<rtc::WebSocket>> evicted;
+    size_t sent = 0;
+
+    // 发送给所有客户端：send() 只是写入该客户端的发送队列，由队列深度决定是否丢帧
+    std::unique_lock<std::mutex> send_lock(send_mutex_);
+    for (const auto& client : *clients) {
+        auto& ws = client->ws;
+        if (client->metadata || client->evicted || !ws->isOpen()) {
+            continue;
+        }
+        // 已随 GOP 补发的帧不再重复发送
+        if (client->has_burst) {
+            if (timestamp <= client->burst_until_pts) {
+                continue;
+            }
+            client->has_burst = false;
+        }
+
+        const size_t queued = ws->bufferedAmount();
+        if (queued > client->peak_queued.load(std::memory_order_relaxed)) {
+            client->peak_queued.store(queued, std::memory_order_relaxed);
+        }
+
+        if (client->dropping) {
+            // 落后：丢到下一个关键帧，且队列排空到一半再恢复，避免刚恢复又丢
+            if (!nal->is_keyframe || queued > queue_limit / 2) {
+                client->frames_dropped++;
+                frames_dropped_++;
+                if (now - client->lag_since_ms.load() > config_.evict_after_ms) {
+                    LOG_WARN("WebSocket 客户端 {} 持续落后 {}ms (队列 {} 字节), 断开",
+                             client->address, now - client->lag_since_ms.load(), queued);
+                    client->evicted = true;
+                    clients_evicted_++;
+                    evicted.push_back(ws);
+                }
+                continue;
             }
+            client->dropping = false;
+            client->lag_since_ms = 0;
+            LOG_DEBUG("WebSocket 客户端 {} 已追上, 从关键帧恢复发送", client->address);
+        } else if (queued > 0 && queued + size > queue_limit) {
+            // 队列满：本帧及其后的非关键帧全部丢弃
+            client->dropping = true;
+            client->lag_since_ms = now;
+            client->drop_events++;
+            client->frames_dropped++;
+            frames_dropped_++;
+            LOG_DEBUG("WebSocket 客户端 {} 发送队列 {} 字节, 丢帧到下一个关键帧",
+                      client->address, queued);
+            continue;
+        }
+
+        try {
+            ws->send(reinterpret_cast<const std::byte*>(data), size);
+            client->frames_sent++;
+            client->bytes_sent += size;
+            sent++;
+        } catch (const std::exception& e) {
+            LOG_DEBUG("发送视频帧失败: {}", e.what());
         }
     }
+    send_lock.unlock();
 
-    frames_sent_++;
-    bytes_sent_ += size * active_clients.size();
+    // 在锁外断开慢客户端（close() 可能同步触发 onClosed）
+    for (auto& ws : evicted) {
+        try {
+            ws->close();
+        } catch (...) {}
+    }
+
+    if (sent > 0) {
+        frames_sent_++;
+        bytes_sent_ += size * sent;
+    }
 }
 
-void WsPreviewServer::ExtractSpsPps(const uint8_t* data, size_t size) {
-    // 搜索 NAL 单元，提取 SPS (type=7) 和 PPS (type=8)
-    for (size_t i = 0; i + 4 < size; ) {
-        // 查找起始码
-        size_t start_code_len = 0;
-        if (data[i] == 0 && data[i+1] == 0 && data[i+2] == 0 && data[i+3] == 1) {
-            start_code_len = 4;
-        } else if (data[i] == 0 && data[i+1] == 0 && data[i+2] == 1) {
-            start_code_len = 3;
-        } else {
-            i++;
+void WsPreviewServer::SendMetadata(const uint8_t* data, size_t size) {
+    if (!running_.load() || !data || size == 0) {
+        return;
+    }
+
+    auto clients = LoadClients();
+    const size_t queue_limit = static_cast<size_t>(config_.metadata_queue_kb) * 1024;
+    for (const auto& client : *clients) {
+        auto& ws = client->ws;
+        if (!client->metadata || !ws->isOpen()) {
+            continue;
+        }
+        // 检测框只看最新一帧，积压时丢弃本条而不是排队
+        if (ws->bufferedAmount() > queue_limit) {
+            client->frames_dropped++;
+            metadata_dropped_++;
             continue;
         }
+        try {
+            ws->send(reinterpret_cast<const std::byte*>(data), size);
+            client->frames_sent++;
+            client->bytes_sent += size;
+            metadata_sent_++;
+        } catch (const std::exception& e) {
+            LOG_DEBUG("发送检测元数据失败: {}", e.what());
+        }
+    }
+}
 
-        size_t nal_start = i + start_code_len;
-        if (nal_start >= size) break;
+void WsPreviewServer::CacheParameterSets(const uint8_t* data, const media::NalIndex& nal) {
+    if (nal.sps < 0 && nal.pps < 0 && nal.vps < 0) {
+        return;
+    }
 
-        uint8_t nal_type = data[nal_start] & 0x1F;
+    std::lock_guard<std::mutex> lock(sps_pps_mutex_);
+    // 分发器已维护跨帧快照时直接共享，否则按本帧内容更新
+    auto params = nal.params ? nal.params
+                             : media::update_parameter_sets(data, nal, cached_params_);
+    if (params != cached_params_) {
+        cached_params_ = std::move(params);
+        LOG_DEBUG("缓存参数集: VPS={} 字节, SPS={} 字节, PPS={} 字节",
+                  cached_params_->vps.size(), cached_params_->sps.size(),
+                  cached_params_->pps.size());
+    }
+}
 
-        // 查找下一个起始码以确定 NAL 单元结束位置
-        size_t nal_end = size;
-        for (size_t j = nal_start + 1; j + 3 < size; j++) {
-            if ((data[j] == 0 && data[j+1] == 0 && data[j+2] == 0 && data[j+3] == 1) ||
-                (data[j] == 0 && data[j+1] == 0 && data[j+2] == 1)) {
-                nal_end = j;
-                break;
-            }
-        }
+void WsPreviewServer::OnKeyframeRequest(KeyframeRequestCallback callback) {
+    std::lock_guard<std::mutex> lock(keyframe_mutex_);
+    keyframe_callback_ = std::move(callback);
+}
 
-        size_t nal_size = nal_end - i;  // 包含起始码
+void WsPreviewServer::SetKeyframeOnly(bool enable) {
+    if (keyframe_only_.exchange(enable) == enable) {
+        return;
+    }
+    if (enable) {
+        LOG_INFO("WebSocket 预览进入仅关键帧模式");
+        return;
+    }
 
-        if (nal_type == 7) {  // SPS
-            std::lock_guard<std::mutex> lock(sps_pps_mutex_);
-            cached_sps_.assign(data + i, data + i + nal_size);
-            LOG_DEBUG("缓存 SPS: {} 字节", nal_size);
-        } else if (nal_type == 8) {  // PPS
-            std::lock_guard<std::mutex> lock(sps_pps_mutex_);
-            cached_pps_.assign(data + i, data + i + nal_size);
-            LOG_DEBUG("缓存 PPS: {} 字节", nal_size);
+    // 恢复完整帧率：从下一个关键帧开始，并请求 IDR 缩短等待
+    resync_.store(true);
+    LOG_INFO("WebSocket 预览恢复完整帧率");
+    std::lock_guard<std::mutex> lock(keyframe_mutex_);
+    if (keyframe_callback_) {
+        keyframe_callback_();
+    }
+}
+
+void WsPreviewServer::OnGopSnapshotRequest(GopSnapshotCallback callback) {
+    std::lock_guard<std::mutex> lock(gop_mutex_);
+    gop_callback_ = std::move(callback);
+}
+
+bool WsPreviewServer::SendGopBurst(const ClientPtr& client) {
+    const auto& ws = client->ws;
+    // 持有 send_mutex_ 期间取快照并补发：此前已发出的实时帧都在快照内，
+    // 此后的实时帧按时间戳去重，补发与实时帧之间既不重复也不缺帧
+    std::lock_guard<std::mutex> send_lock(send_mutex_);
+    std::vector<EncodedStreamPtr> frames;
+    {
+        std::lock_guard<std::mutex> lock(gop_mutex_);
+        if (gop_callback_) {
+            frames = gop_callback_();
         }
+    }
+    if (frames.empty()) {
+        return false;
+    }
 
-        i = nal_end;
+    // 关键帧未携带参数集时先补发缓存的 SPS/PPS
+    const media::NalIndex* nal = get_stream_nal_index(frames.front());
+    if (!nal || nal->sps < 0) {
+        SendSpsPps(ws);
+    }
+
+    size_t bytes = 0;
+    try {
+        for (const auto& frame : frames) {
+            const auto* data = static_cast<const std::byte*>(get_stream_vir_addr(frame));
+            uint32_t len = get_stream_length(frame);
+            if (!data || len == 0) continue;
+            ws->send(data, len);
+            bytes += len;
+        }
+    } catch (const std::exception& e) {
+        LOG_WARN("补发 GOP 失败: {}", e.what());
+        return false;
     }
+
+    client->has_burst = true;
+    client->burst_until_pts = get_stream_pts(frames.back());
+    client->frames_sent += frames.size();
+    client->bytes_sent += bytes;
+    gop_bursts_++;
+    bytes_sent_ += bytes;
+    LOG_DEBUG("已补发缓存的 GOP 给新客户端: {} 帧, {} 字节", frames.size(), bytes);
+    return true;
 }
 
-bool WsPreviewServer::IsKeyframe(const uint8_t* data, size_t size) const {
-    for (size_t i = 0; i + 4 < size; i++) {
-        if ((data[i] == 0 && data[i+1] == 0 && data[i+2] == 0 && data[i+3] == 1) ||
-            (data[i] == 0 && data[i+1] == 0 && data[i+2] == 1)) {
-            size_t nal_start = (data[i+2] == 1) ? i + 3 : i + 4;
-            if (nal_start < size) {
-                uint8_t nal_type = data[nal_start] & 0x1F;
-                // IDR 帧 (type=5) 或 SPS (type=7)
-                if (nal_type == 5 || nal_type == 7) {
-                    return true;
-                }
-            }
+WsPreviewServer::Stats WsPreviewServer::GetStats() const {
+    Stats stats;
+    stats.framesSent = frames_sent_.load();
+    stats.bytesSent = bytes_sent_.load();
+    stats.gopBursts = gop_bursts_.load();
+    stats.framesDropped = frames_dropped_.load();
+    stats.clientsEvicted = clients_evicted_.load();
+    stats.metadataSent = metadata_sent_.load();
+    stats.metadataDropped = metadata_dropped_.load();
+    stats.keyframeOnly = keyframe_only_.load();
+    stats.framesSkipped = frames_skipped_.load();
+
+    const int64_t now = NowMs();
+    for (const auto& client : *LoadClients()) {
+        if (!client->ws->isOpen()) {
+            continue;
         }
+        ClientStats c;
+        c.address = client->address;
+        c.metadata = client->metadata;
+        const int64_t lag_since = client->lag_since_ms.load();
+        c.lagging = lag_since != 0;
+        c.lagMs = lag_since != 0 ? static_cast<uint64_t>(now - lag_since) : 0;
+        c.framesSent = client->frames_sent.load();
+        c.framesDropped = client->frames_dropped.load();
+        c.dropEvents = client->drop_events.load();
+        c.bytesSent = client->bytes_sent.load();
+        c.queuedBytes = client->ws->bufferedAmount();
+        c.peakQueuedBytes = client->peak_queued.load();
+        c.durationMs = static_cast<uint64_t>(now - client->connected_ms);
+        stats.clients.push_back(std::move(c));
     }
-    return false;
+    return stats;
 }
 
 void WsPreviewServer::SendSpsPps(std::shared_ptr<rtc::WebSocket> ws) {
-    std::lock_guard<std::mutex> lock(sps_pps_mutex_);
+    media::ParameterSetsPtr params;
+    {
+        std::lock_guard<std::mutex> lock(sps_pps_mutex_);
+        params = cached_params_;
+    }
 
-    if (cached_sps_.empty() || cached_pps_.empty()) {
-        LOG_DEBUG("SPS/PPS 尚未缓存，等待下一个关键帧");
+    if (!params || !params->IsComplete()) {
+        LOG_DEBUG("参数集尚未缓存，等待下一个关键帧");
         return;
     }
 
+    // 参数集缓存不含起始码，发送前补上 4 字节起始码
+    auto send_nal = [&ws](const std::vector<uint8_t>& nal) {
+        if (nal.empty()) return;
+        std::vector<uint8_t> annexb = {0x00, 0x00, 0x00, 0x01};
+        annexb.insert(annexb.end(), nal.begin(), nal.end());
+        ws->send(reinterpret_cast<const std::byte*>(annexb.data()), annexb.size());
+    };
+
     try {
-        // 先发送 SPS
-        ws->send(reinterpret_cast<const std::byte*>(cached_sps_.data()), cached_sps_.size());
-        // 再发送 PPS
-        ws->send(reinterpret_cast<const std::byte*>(cached_pps_.data()), cached_pps_.size());
-        LOG_DEBUG("已发送缓存的 SPS/PPS 给新客户端");
+        send_nal(params->vps);
+        send_nal(params->sps);
+        send_nal(params->pps);
+        LOG_DEBUG("已发送缓存的参数集给新客户端");
     } catch (const std::exception& e) {
         LOG_WARN("发送 SPS/PPS 失败: {}", e.what());
     }
@@ -321,7 +544,7 @@ void WsPreviewServer::StreamConsumer(EncodedStreamPtr stream, void* user_data) {
     uint64_t pts = get_stream_pts(stream);
 
     if (data && len > 0) {
-        self->SendVideoFrame(data, len, pts);
+        self->SendVideoFrame(data, len, pts, get_stream_nal_index(stream));
     }
 }
 
@@ -10,6 +10,25 @@
  * - 跨平台兼容性好 (H.264 + MSE)
  * - 实现简单，不需要复杂的信令
  *
+ * H.265 码流同样按 Annex-B 推送，新客户端连接时补发 VPS/SPS/PPS，
+ * 并经关键帧请求回调向编码器请求 IDR，避免等满一个 GOP 才出画面；
+ * 浏览器端需自行支持 HEVC 解码（jMuxer 仅支持 H.264）。
+ *
+ * 设置了 GOP 快照回调（生产者开启 GOP 缓存）时，新客户端就绪后先收到最近一个 GOP，
+ * 再按时间戳无缝衔接实时帧，无需等待 IDR；快照为空时退回到请求关键帧。
+ *
+ * 慢客户端隔离：每个客户端的发送队列（WebSocket 发送缓冲）以 client_queue_kb 为上限，
+ * 超出后丢帧直到下一个关键帧、且队列排空到一半再恢复，解码不会因缺帧花屏；
+ * 持续落后超过 evict_after_ms 的客户端被断开。发送只是入队，慢客户端不会拖慢
+ * 其他客户端和同在 IO 线程上的 RTSP。客户端列表写时复制，每帧只取一次快照，不加锁。
+ *
+ * 仅关键帧模式（负载调度降级）：只推送关键帧，预览退化为低帧率幻灯片，省下 P 帧的
+ * 发送开销；退出时先请求 IDR，在下一个关键帧之前继续跳过 P 帧，避免参考帧缺失花屏。
+ *
+ * 检测元数据子通道：连接路径为 /detections 的客户端不收视频，只收 AI 检测结果的
+ * 二进制消息（格式见 media_producer/common/detection_metadata.h），由浏览器在画面上层绘制。
+ * 元数据只关心最新一帧，发送队列超过 metadata_queue_kb 时直接丢弃本条。
+ *
  * @author 好软，好温暖
  * @date 2026-02-04
  */
@@ -25,6 +44,7 @@
 #include <vector>
 
 #include "common/media_buffer.h"
+#include "common/video_codec.h"
 
 // 前向声明
 namespace rtc {
@@ -43,6 +63,10 @@ struct WsPreviewConfig {
     uint16_t port = 8082;           ///< WebSocket 服务器端口
     int max_clients = 5;            ///< 最大客户端数量
     int keyframe_interval_ms = 100; ///< 关键帧缓存刷新间隔
+    media::VideoCodec codec = media::VideoCodec::kH264;  ///< 码流编码格式（H.265 需浏览器支持 HEVC MSE）
+    int client_queue_kb = 1024;     ///< 单个客户端发送队列上限，超出后丢帧到下一个关键帧
+    int evict_after_ms = 5000;      ///< 持续丢帧超过该时长的客户端被断开
+    int metadata_queue_kb = 64;     ///< 元数据客户端发送队列上限，超出后丢弃新消息
 };
 
 // ============================================================================
@@ -61,6 +85,11 @@ struct WsPreviewConfig {
  */
 class WsPreviewServer {
 public:
+    /// 新客户端就绪时请求关键帧（libdatachannel 线程，接收方负责限频合并）
+    using KeyframeRequestCallback = std::function<void()>;
+    /// 新客户端就绪时获取 GOP 缓存快照（首帧为关键帧，为空表示无缓存）
+    using GopSnapshotCallback = std::function<std::vector<EncodedStreamPtr>()>;
+
     /**
      * @brief 构造函数
      * @param config 配置参数
@@ -94,19 +123,81 @@ public:
      */
     uint16_t GetPort() const;
 
+    /// 检测元数据子通道的连接路径
+    static constexpr const char* kMetadataPath = "/detections";
+
     /**
-     * @brief 获取当前连接的客户端数量
+     * @brief 获取当前连接的视频客户端数量
      */
     size_t GetClientCount() const;
 
+    /**
+     * @brief 获取当前连接的检测元数据客户端数量（为 0 时调用方可跳过编码）
+     */
+    size_t GetMetadataClientCount() const;
+
+    /**
+     * @brief 单个客户端的状态
+     */
+    struct ClientStats {
+        std::string address;
+        bool metadata = false;              ///< 检测元数据客户端（不收视频）
+        bool lagging = false;               ///< 正在丢帧等待关键帧
+        uint64_t lagMs = 0;                 ///< 本次落后已持续的时长
+        uint64_t framesSent = 0;
+        uint64_t framesDropped = 0;
+        uint64_t dropEvents = 0;            ///< 进入丢帧状态的次数
+        uint64_t bytesSent = 0;
+        size_t queuedBytes = 0;             ///< 发送队列中尚未写出的字节
+        size_t peakQueuedBytes = 0;
+        uint64_t durationMs = 0;
+    };
+
+    struct Stats {
+        uint64_t framesSent = 0;
+        uint64_t bytesSent = 0;
+        uint64_t gopBursts = 0;
+        uint64_t framesDropped = 0;
+        uint64_t clientsEvicted = 0;
+        uint64_t metadataSent = 0;
+        uint64_t metadataDropped = 0;
+        bool keyframeOnly = false;          ///< 仅关键帧模式
+        uint64_t framesSkipped = 0;         ///< 仅关键帧模式下跳过的 P 帧
+        std::vector<ClientStats> clients;
+    };
+
+    /**
+     * @brief 获取统计信息（HTTP 线程调用）
+     */
+    Stats GetStats() const;
+
+    /**
+     * @brief 开关仅关键帧模式（任意线程调用）
+     *
+     * 关闭时请求一次关键帧，下一个关键帧到达前仍跳过 P 帧
+     */
+    void SetKeyframeOnly(bool enable);
+
+    bool IsKeyframeOnly() const { return keyframe_only_.load(); }
+
     /**
      * @brief 发送视频帧给所有客户端
      * 
      * @param data H.264 NAL 数据（Annex-B 格式，带起始码）
      * @param size 数据大小
      * @param timestamp 时间戳（微秒）
+     * @param nal 分发器建立的 NAL 索引（为空时本地解析）
      */
-    void SendVideoFrame(const uint8_t* data, size_t size, uint64_t timestamp);
+    void SendVideoFrame(const uint8_t* data, size_t size, uint64_t timestamp,
+                        const media::NalIndex* nal = nullptr);
+
+    /**
+     * @brief 发送一条检测元数据给所有元数据客户端
+     *
+     * @param data 编码好的元数据消息（二进制帧发送）
+     * @param size 数据大小
+     */
+    void SendMetadata(const uint8_t* data, size_t size);
 
     // ========================================================================
     // StreamDispatcher 回调接口
@@ -119,26 +210,69 @@ public:
      */
     static void StreamConsumer(EncodedStreamPtr stream, void* user_data);
 
+    /**
+     * @brief 设置关键帧请求回调
+     */
+    void OnKeyframeRequest(KeyframeRequestCallback callback);
+
+    /**
+     * @brief 设置 GOP 快照回调
+     */
+    void OnGopSnapshotRequest(GopSnapshotCallback callback);
+
 private:
+    /**
+     * @brief 一个已连接的客户端
+     *
+     * 丢帧 / 补发状态只在 send_mutex_ 下访问；计数为原子量供 HTTP 线程读取
+     */
+    struct Client {
+        std::shared_ptr<rtc::WebSocket> ws;
+        std::string address;
+        int64_t connected_ms = 0;
+        bool metadata = false;              ///< 检测元数据客户端（连接时按路径确定，之后只读）
+
+        bool dropping = false;              ///< 落后：丢帧直到下一个关键帧
+        bool evicted = false;
+        bool has_burst = false;             ///< 已补发 GOP，跳过不晚于 burst_until_pts 的实时帧
+        uint64_t burst_until_pts = 0;
+
+        std::atomic<int64_t> lag_since_ms{0};   ///< 进入丢帧状态的时刻（0 表示未落后）
+        std::atomic<uint64_t> frames_sent{0};
+        std::atomic<uint64_t> frames_dropped{0};
+        std::atomic<uint64_t> drop_events{0};
+        std::atomic<uint64_t> bytes_sent{0};
+        std::atomic<size_t> peak_queued{0};
+    };
+    using ClientPtr = std::shared_ptr<Client>;
+    using ClientList = std::vector<ClientPtr>;
+
+    /// 当前客户端列表快照（无锁读取）
+    std::shared_ptr<const ClientList> LoadClients() const;
+
+    /// 在 clients_mutex_ 下发布新的客户端列表
+    void StoreClientsLocked(std::shared_ptr<const ClientList> clients);
+
     /**
      * @brief 处理新客户端连接
      */
     void OnClientConnected(std::shared_ptr<rtc::WebSocket> ws);
 
     /**
-     * @brief 从 NAL 数据中提取 SPS/PPS
+     * @brief 根据 NAL 索引更新 SPS/PPS 缓存
      */
-    void ExtractSpsPps(const uint8_t* data, size_t size);
+    void CacheParameterSets(const uint8_t* data, const media::NalIndex& nal);
 
     /**
-     * @brief 检查是否为关键帧
+     * @brief 发送参数集（VPS/SPS/PPS）给客户端
      */
-    bool IsKeyframe(const uint8_t* data, size_t size) const;
+    void SendSpsPps(std::shared_ptr<rtc::WebSocket> ws);
 
     /**
-     * @brief 发送 SPS/PPS 给客户端
+     * @brief 给新客户端补发缓存的 GOP
+     * @return true 已补发（无需再请求关键帧）
      */
-    void SendSpsPps(std::shared_ptr<rtc::WebSocket> ws);
+    bool SendGopBurst(const ClientPtr& client);
 
     WsPreviewConfig config_;
     std::atomic<bool> running_{false};
@@ -146,18 +280,37 @@ private:
     // WebSocket 服务器
     std::unique_ptr<rtc::WebSocketServer> ws_server_;
 
-    // 客户端管理
-    mutable std::mutex clients_mutex_;
-    std::vector<std::shared_ptr<rtc::WebSocket>> clients_;  // 使用 shared_ptr 保持对象存活
+    // 客户端管理：写时复制，增删在 clients_mutex_ 下生成新列表，发送路径只原子读取快照
+    std::mutex clients_mutex_;
+    std::shared_ptr<const ClientList> clients_;
 
     // SPS/PPS 缓存（用于新客户端连接时发送）
     mutable std::mutex sps_pps_mutex_;
-    std::vector<uint8_t> cached_sps_;
-    std::vector<uint8_t> cached_pps_;
+    media::ParameterSetsPtr cached_params_;
+
+    // 关键帧请求
+    std::mutex keyframe_mutex_;
+    KeyframeRequestCallback keyframe_callback_;
+
+    // GOP 补发：send_mutex_ 串行化实时发送与补发，保证补发帧在实时帧之前；
+    // 补发过的客户端跳过时间戳不晚于补发末帧的实时帧（Client::burst_until_pts）
+    std::mutex gop_mutex_;
+    GopSnapshotCallback gop_callback_;
+    std::mutex send_mutex_;
+    std::atomic<uint64_t> gop_bursts_{0};
+
+    // 仅关键帧模式；退出后 resync_ 保持到下一个关键帧
+    std::atomic<bool> keyframe_only_{false};
+    std::atomic<bool> resync_{false};
+    std::atomic<uint64_t> frames_skipped_{0};
 
     // 统计
     std::atomic<uint64_t> frames_sent_{0};
     std::atomic<uint64_t> bytes_sent_{0};
+    std::atomic<uint64_t> frames_dropped_{0};
+    std::atomic<uint64_t> clients_evicted_{0};
+    std::atomic<uint64_t> metadata_sent_{0};
+    std::atomic<uint64_t> metadata_dropped_{0};
 };
 
 // ============================================================================
@@ -102,6 +102,7 @@ struct DetectionResult {
     float confidence;       ///< 置信度 [0.0, 1.0]
     BoundingBox box;        ///< 边界框
     std::string label;      ///< 类别名称（如 "person", "car", "face"）
+    int track_id = -1;      ///< 跟踪轨迹 ID（ObjectTracker 填写，-1 = 未跟踪）
     
     /// 人脸关键点（仅 RetinaFace 使用，5个点：左眼、右眼、鼻子、左嘴角、右嘴角）
     std::vector<Landmark> landmarks;
@@ -118,6 +119,7 @@ struct DetectionResultList {
     std::vector<DetectionResult> results;   ///< 检测结果数组
     int frame_id = 0;                       ///< 帧 ID（可选，用于追踪）
     int64_t timestamp_ms = 0;               ///< 时间戳（毫秒）
+    uint64_t pts = 0;                       ///< 来源帧的采集 PTS（微秒，与码流时间戳同源）
     
     /// 获取检测数量
     size_t Count() const { return results.size(); }
@@ -0,0 +1,251 @@
+/**
+ * @file capture_core.cpp
+ * @brief 共享采集核心实现
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-12
+ */
+
+#define LOG_TAG "Capture"
+
+#include "capture_core.h"
+#include "common/logger.h"
+#include "common/startup_timeline.h"
+
+#include "sample_comm.h"
+#include "rk_mpi_sys.h"
+#include "rk_mpi_vi.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace media {
+
+namespace {
+
+// ============================================================================
+// VI 初始化函数
+// ============================================================================
+
+/**
+ * @brief 初始化 VI 设备
+ *
+ * RV1106 SDK 简化版：仅 memset 后调用 API
+ */
+int vi_dev_init() {
+    int ret = 0;
+    int devId = kCaptureViDev;
+    int pipeId = devId;
+
+    VI_DEV_ATTR_S stDevAttr;
+    VI_DEV_BIND_PIPE_S stBindPipe;
+    memset(&stDevAttr, 0, sizeof(stDevAttr));
+    memset(&stBindPipe, 0, sizeof(stBindPipe));
+
+    // 检查设备配置状态
+    ret = RK_MPI_VI_GetDevAttr(devId, &stDevAttr);
+    if (ret == RK_ERR_VI_NOT_CONFIG) {
+        ret = RK_MPI_VI_SetDevAttr(devId, &stDevAttr);
+        if (ret != RK_SUCCESS) {
+            return -1;
+        }
+    }
+
+    // 检查设备启用状态
+    ret = RK_MPI_VI_GetDevIsEnable(devId);
+    if (ret != RK_SUCCESS) {
+        ret = RK_MPI_VI_EnableDev(devId);
+        if (ret != RK_SUCCESS) {
+            return -1;
+        }
+        stBindPipe.u32Num = 1;
+        stBindPipe.PipeId[0] = pipeId;
+        ret = RK_MPI_VI_SetDevBindPipe(devId, &stBindPipe);
+        if (ret != RK_SUCCESS) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief 初始化 VI 通道
+ */
+int vi_chn_init(int channelId, int width, int height) {
+    VI_CHN_ATTR_S stChnAttr;
+    memset(&stChnAttr, 0, sizeof(stChnAttr));
+    stChnAttr.stIspOpt.stMaxSize.u32Width = width;
+    stChnAttr.stIspOpt.stMaxSize.u32Height = height;
+    stChnAttr.stIspOpt.u32BufCount = 2;
+    stChnAttr.stIspOpt.enMemoryType = VI_V4L2_MEMORY_TYPE_DMABUF;
+    stChnAttr.stSize.u32Width = width;
+    stChnAttr.stSize.u32Height = height;
+    stChnAttr.enPixelFormat = RK_FMT_YUV420SP;
+    stChnAttr.enCompressMode = COMPRESS_MODE_NONE;
+    stChnAttr.u32Depth = 0;
+
+    RK_MPI_VI_SetChnAttr(kCaptureViDev, channelId, &stChnAttr);
+    RK_MPI_VI_EnableChn(kCaptureViDev, channelId);
+    return 0;
+}
+
+}  // namespace
+
+// ============================================================================
+// 单例
+// ============================================================================
+
+CaptureCore& CaptureCore::Instance() {
+    static CaptureCore instance;
+    return instance;
+}
+
+CaptureCore::~CaptureCore() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stats_.running) {
+        StopLocked();
+    }
+}
+
+// ============================================================================
+// 引用计数
+// ============================================================================
+
+int CaptureCore::Acquire(int width, int height) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!stats_.running) {
+        if (StartLocked(width, height) != 0) {
+            StopLocked();
+            return -1;
+        }
+    } else if (width != stats_.width || height != stats_.height) {
+        if (ReconfigureViLocked(width, height) != 0) {
+            return -1;
+        }
+    }
+
+    stats_.ref_count++;
+    LOG_DEBUG("Capture core acquired (refs: {})", stats_.ref_count);
+    return 0;
+}
+
+void CaptureCore::Release() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (stats_.ref_count <= 0) {
+        LOG_WARN("Capture core released without matching acquire");
+        return;
+    }
+
+    stats_.ref_count--;
+    LOG_DEBUG("Capture core released (refs: {})", stats_.ref_count);
+
+    if (stats_.ref_count == 0) {
+        StopLocked();
+    }
+}
+
+bool CaptureCore::IsRunning() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_.running;
+}
+
+CaptureCoreStats CaptureCore::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+// ============================================================================
+// 启停
+// ============================================================================
+
+int CaptureCore::StartLocked(int width, int height) {
+    auto start_time = std::chrono::steady_clock::now();
+    RK_S32 ret;
+
+    // 1. ISP 初始化
+    const char* iq_dir = "/etc/iqfiles";
+    {
+        StartupTimeline::Scope scope("isp");
+        SAMPLE_COMM_ISP_Init(kCaptureViDev, RK_AIQ_WORKING_MODE_NORMAL, RK_FALSE, iq_dir);
+        SAMPLE_COMM_ISP_Run(kCaptureViDev);
+    }
+    isp_initialized_ = true;
+    LOG_DEBUG("ISP initialized");
+
+    // 2. MPI 系统初始化
+    ret = RK_MPI_SYS_Init();
+    if (ret != RK_SUCCESS) {
+        LOG_ERROR("RK_MPI_SYS_Init failed: {:#x}", ret);
+        return -1;
+    }
+    mpi_initialized_ = true;
+    LOG_DEBUG("MPI system initialized");
+
+    // 3. VI 初始化
+    {
+        StartupTimeline::Scope scope("vi");
+        if (vi_dev_init() != 0) {
+            LOG_ERROR("VI device init failed");
+            return -1;
+        }
+        vi_chn_init(kCaptureViChn, width, height);
+    }
+    vi_enabled_ = true;
+
+    stats_.running = true;
+    stats_.width = width;
+    stats_.height = height;
+    stats_.start_count++;
+    stats_.last_start_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time).count();
+
+    LOG_INFO("Capture core started: {}x{} ({}ms)", width, height, stats_.last_start_ms);
+    return 0;
+}
+
+void CaptureCore::StopLocked() {
+    // VI
+    if (vi_enabled_) {
+        RK_MPI_VI_DisableChn(kCaptureViDev, kCaptureViChn);
+        RK_MPI_VI_DisableDev(kCaptureViDev);
+        vi_enabled_ = false;
+        LOG_DEBUG("VI deinitialized");
+    }
+
+    // MPI 系统
+    if (mpi_initialized_) {
+        RK_MPI_SYS_Exit();
+        mpi_initialized_ = false;
+        LOG_DEBUG("MPI system deinitialized");
+    }
+
+    // ISP
+    if (isp_initialized_) {
+        SAMPLE_COMM_ISP_Stop(kCaptureViDev);
+        isp_initialized_ = false;
+        LOG_DEBUG("ISP stopped");
+    }
+
+    if (stats_.running) {
+        stats_.running = false;
+        LOG_INFO("Capture core stopped");
+    }
+}
+
+int CaptureCore::ReconfigureViLocked(int width, int height) {
+    // 仅重建 VI 通道，ISP 与 VI 设备保持运行
+    RK_MPI_VI_DisableChn(kCaptureViDev, kCaptureViChn);
+    vi_chn_init(kCaptureViChn, width, height);
+
+    LOG_INFO("Capture core VI reconfigured: {}x{} -> {}x{}",
+             stats_.width, stats_.height, width, height);
+    stats_.width = width;
+    stats_.height = height;
+    stats_.reconfig_count++;
+    return 0;
+}
+
+}  // namespace media
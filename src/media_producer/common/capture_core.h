@@ -0,0 +1,111 @@
+/**
+ * @file capture_core.h
+ * @brief 共享采集核心 - ISP + MPI 系统 + VI 的引用计数管理
+ *
+ * 三种生产者共用同一条采集前端（ISP -> VI），差异只在 VPSS/VENC/NPU 之后。
+ * 采集核心把 ISP 启动、RK_MPI_SYS_Init 和 VI 设备/通道使能收拢到一处，
+ * 按引用计数管理：最后一个使用者释放时才真正停止 ISP、退出 MPI 系统。
+ *
+ * MediaManager 在整个生命周期内持有一份引用，因此模式切换时旧生产者
+ * 释放、新生产者获取都不会触发 ISP 重启，切换只需重建 VPSS/VENC 绑定
+ * 和推理引擎（暖切换）。
+ *
+ * 使用方式：
+ * @code
+ * // 生产者 InitMpi
+ * if (CaptureCore::Instance().Acquire(width, height) != 0) return -1;
+ * // ... VPSS/VENC 初始化、绑定 VI -> VPSS ...
+ *
+ * // 生产者 DeinitMpi（先解绑 VI -> VPSS）
+ * CaptureCore::Instance().Release();
+ * @endcode
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-12
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+namespace media {
+
+// ============================================================================
+// 采集前端常量（与各生产者 mpi_config.h 中的 kViDev/kViChn 保持一致）
+// ============================================================================
+
+constexpr int kCaptureViDev = 0;    ///< VI 设备 ID
+constexpr int kCaptureViChn = 0;    ///< VI 通道 ID
+
+/**
+ * @brief 采集核心运行统计
+ */
+struct CaptureCoreStats {
+    int ref_count = 0;              ///< 当前引用数
+    bool running = false;           ///< ISP/VI 是否在运行
+    int width = 0;                  ///< 当前 VI 输出宽度
+    int height = 0;                 ///< 当前 VI 输出高度
+    uint32_t start_count = 0;       ///< ISP 冷启动次数
+    uint32_t reconfig_count = 0;    ///< VI 通道重配置次数（分辨率变化）
+    int64_t last_start_ms = 0;      ///< 最近一次冷启动耗时（毫秒）
+};
+
+/**
+ * @class CaptureCore
+ * @brief 引用计数的 ISP + SYS + VI 采集核心（单例）
+ *
+ * - 首次 Acquire：ISP Init/Run -> RK_MPI_SYS_Init -> VI Dev/Chn 使能
+ * - 后续 Acquire：仅增加引用；分辨率不同时重配置 VI 通道
+ * - 最后一次 Release：VI 关闭 -> RK_MPI_SYS_Exit -> ISP Stop
+ *
+ * @note 分辨率重配置要求调用方此时没有 VI -> VPSS 绑定
+ *       （生产者 DeinitMpi 会先解绑再 Release，满足该条件）
+ */
+class CaptureCore {
+public:
+    static CaptureCore& Instance();
+
+    CaptureCore(const CaptureCore&) = delete;
+    CaptureCore& operator=(const CaptureCore&) = delete;
+
+    /**
+     * @brief 获取一份采集核心引用
+     *
+     * @param width VI 输出宽度
+     * @param height VI 输出高度
+     * @return 0 成功，-1 失败（失败时不增加引用）
+     */
+    int Acquire(int width, int height);
+
+    /**
+     * @brief 释放一份引用，归零时关闭采集前端
+     */
+    void Release();
+
+    /**
+     * @brief 采集前端是否在运行
+     */
+    bool IsRunning() const;
+
+    /**
+     * @brief 获取运行统计
+     */
+    CaptureCoreStats GetStats() const;
+
+private:
+    CaptureCore() = default;
+    ~CaptureCore();
+
+    int StartLocked(int width, int height);
+    void StopLocked();
+    int ReconfigureViLocked(int width, int height);
+
+    mutable std::mutex mutex_;
+    CaptureCoreStats stats_;
+    bool isp_initialized_ = false;
+    bool mpi_initialized_ = false;
+    bool vi_enabled_ = false;
+};
+
+}  // namespace media
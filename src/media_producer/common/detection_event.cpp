@@ -0,0 +1,172 @@
+/**
+ * @file detection_event.cpp
+ * @brief 检测事件引擎实现
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-12
+ */
+
+#define LOG_TAG "DetEvent"
+
+#include "detection_event.h"
+#include "common/logger.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace media {
+
+// ============================================================================
+// 配置
+// ============================================================================
+
+void DetectionEventEngine::Configure(const DetectionEventConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+    state_ = DetectionEventState::kIdle;
+    stats_.enabled = config_.enabled;
+    stats_.state = state_;
+
+    if (config_.enabled) {
+        std::string classes;
+        for (const auto& c : config_.classes) {
+            classes += classes.empty() ? c : "," + c;
+        }
+        LOG_INFO("Detection events enabled: classes=[{}], conf>={:.2f}, area>={:.3f}, "
+                 "dwell={}ms, gap={}ms, cooldown={}ms",
+                 classes.empty() ? "any" : classes, config_.min_confidence, config_.min_area,
+                 config_.dwell_ms, config_.gap_ms, config_.cooldown_ms);
+    }
+}
+
+DetectionEventConfig DetectionEventEngine::GetConfig() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return config_;
+}
+
+void DetectionEventEngine::SetTriggerCallback(TriggerCallback callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    callback_ = std::move(callback);
+}
+
+void DetectionEventEngine::Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    state_ = DetectionEventState::kIdle;
+    stats_.state = state_;
+}
+
+// ============================================================================
+// 评估
+// ============================================================================
+
+const rknn::DetectionResult* DetectionEventEngine::FindMatch(
+    const rknn::DetectionResultList& results, int frame_width, int frame_height) const {
+    const double frame_area = static_cast<double>(frame_width) * frame_height;
+    const rknn::DetectionResult* best = nullptr;
+
+    for (const auto& r : results.results) {
+        if (r.confidence < config_.min_confidence) continue;
+        if (!config_.classes.empty() &&
+            std::find(config_.classes.begin(), config_.classes.end(), r.label) ==
+                config_.classes.end()) {
+            continue;
+        }
+        if (config_.min_area > 0.0f && frame_area > 0.0) {
+            double area = static_cast<double>(r.box.width) * r.box.height / frame_area;
+            if (area < config_.min_area) continue;
+        }
+        if (!best || r.confidence > best->confidence) {
+            best = &r;
+        }
+    }
+    return best;
+}
+
+void DetectionEventEngine::OnDetections(const rknn::DetectionResultList& results,
+                                        int frame_width, int frame_height) {
+    TriggerCallback callback;
+    std::string reason;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!config_.enabled) {
+            return;
+        }
+
+        auto now = Clock::now();
+        stats_.evaluations++;
+
+        const rknn::DetectionResult* match = FindMatch(results, frame_width, frame_height);
+        if (match) {
+            stats_.matched++;
+            last_match_ = now;
+        }
+        const bool lost = !match && ElapsedMs(last_match_, now) > config_.gap_ms;
+
+        if (state_ == DetectionEventState::kCooldown && now >= cooldown_until_) {
+            state_ = DetectionEventState::kIdle;
+        }
+
+        bool fire = false;
+        switch (state_) {
+            case DetectionEventState::kIdle:
+                if (match) {
+                    state_ = DetectionEventState::kDwell;
+                    dwell_start_ = now;
+                }
+                break;
+            case DetectionEventState::kDwell:
+                if (lost) {
+                    state_ = DetectionEventState::kIdle;
+                }
+                break;
+            case DetectionEventState::kActive:
+                if (lost) {
+                    state_ = DetectionEventState::kCooldown;
+                    cooldown_until_ = now + std::chrono::milliseconds(config_.cooldown_ms);
+                    LOG_INFO("Detection event ended, cooldown {}ms", config_.cooldown_ms);
+                } else if (match && ElapsedMs(last_trigger_, now) >= config_.retrigger_ms) {
+                    fire = true;
+                }
+                break;
+            case DetectionEventState::kCooldown:
+                if (match) {
+                    stats_.suppressed++;
+                }
+                break;
+        }
+
+        // 停留时间满足（dwell_ms = 0 时首次命中即触发）
+        if (state_ == DetectionEventState::kDwell && match &&
+            ElapsedMs(dwell_start_, now) >= config_.dwell_ms) {
+            state_ = DetectionEventState::kActive;
+            stats_.events++;
+            fire = true;
+            LOG_INFO("Detection event started: {} ({:.2f})", match->label, match->confidence);
+        }
+        stats_.state = state_;
+
+        if (fire) {
+            last_trigger_ = now;
+            stats_.triggers++;
+            stats_.last_label = match->label;
+            stats_.last_confidence = match->confidence;
+
+            char buf[96];
+            snprintf(buf, sizeof(buf), "%s %.2f",
+                     match->label.empty() ? "object" : match->label.c_str(), match->confidence);
+            reason = buf;
+            callback = callback_;
+        }
+    }
+
+    if (callback) {
+        callback(reason);
+    }
+}
+
+DetectionEventStats DetectionEventEngine::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+}  // namespace media
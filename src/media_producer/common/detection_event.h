@@ -0,0 +1,157 @@
+/**
+ * @file detection_event.h
+ * @brief 检测事件引擎 - 按规则把 AI 检测结果转换为事件录制触发
+ *
+ * YOLOv5 / RetinaFace 生产者每次推理后把映射到主码流坐标的检测结果交给引擎，
+ * 引擎按规则判定"有事发生"，通过回调触发 FileService 的事件录制
+ * （预录缓冲提供事件前画面，最后一次触发后录制 post_seconds 自动停止）。
+ *
+ * 规则（同一帧内任一目标满足即为命中）：
+ * - classes：类别名集合（如 person、car、face），为空表示任意类别
+ * - min_confidence：最低置信度
+ * - min_area：框面积占画面比例下限，过滤远处的小目标
+ *
+ * 状态机：
+ * - kIdle    -> 命中后进入 kDwell
+ * - kDwell   -> 持续命中 dwell_ms 后进入 kActive 并触发；中断超过 gap_ms 回到 kIdle
+ * - kActive  -> 持续命中时每 retrigger_ms 再次触发以延长录制；未命中超过 gap_ms 进入 kCooldown
+ * - kCooldown-> cooldown_ms 内不再开始新事件，之后回到 kIdle
+ *
+ * @note 线程安全：OnDetections() 在推理线程调用，配置与统计可在任意线程访问
+ * @note 触发回调在引擎锁外执行
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-12
+ */
+
+#pragma once
+
+#include "ai_types.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace media {
+
+// ============================================================================
+// 配置与统计
+// ============================================================================
+
+/**
+ * @brief 检测事件规则
+ */
+struct DetectionEventConfig {
+    bool enabled = false;
+    std::vector<std::string> classes;   ///< 触发类别（空 = 任意类别）
+    float min_confidence = 0.5f;        ///< 最低置信度
+    float min_area = 0.0f;              ///< 框面积 / 画面面积下限 [0, 1]
+    int dwell_ms = 500;                 ///< 持续命中多久才算事件（过滤单帧误检）
+    int gap_ms = 1000;                  ///< 容忍的漏检间隔，超过视为目标离开
+    int cooldown_ms = 5000;             ///< 事件结束后的冷却时间
+    int retrigger_ms = 1000;            ///< 事件持续期间重复触发的间隔
+};
+
+/**
+ * @brief 事件状态
+ */
+enum class DetectionEventState {
+    kIdle,
+    kDwell,
+    kActive,
+    kCooldown,
+};
+
+inline const char* DetectionEventStateToString(DetectionEventState state) {
+    switch (state) {
+        case DetectionEventState::kIdle:     return "idle";
+        case DetectionEventState::kDwell:    return "dwell";
+        case DetectionEventState::kActive:   return "active";
+        case DetectionEventState::kCooldown: return "cooldown";
+        default:                             return "unknown";
+    }
+}
+
+/**
+ * @brief 检测事件统计
+ */
+struct DetectionEventStats {
+    bool enabled = false;
+    DetectionEventState state = DetectionEventState::kIdle;
+    uint64_t evaluations = 0;           ///< 评估的推理结果数
+    uint64_t matched = 0;               ///< 命中规则的推理结果数
+    uint64_t events = 0;                ///< 开始的事件数
+    uint64_t triggers = 0;              ///< 触发回调次数（含延长录制）
+    uint64_t suppressed = 0;            ///< 冷却期内被抑制的命中数
+    std::string last_label;             ///< 最近一次触发的目标类别
+    float last_confidence = 0.0f;       ///< 最近一次触发的目标置信度
+};
+
+// ============================================================================
+// 检测事件引擎
+// ============================================================================
+
+class DetectionEventEngine {
+public:
+    /// 触发回调（reason 形如 "person 0.87"）
+    using TriggerCallback = std::function<void(const std::string& reason)>;
+
+    DetectionEventEngine() = default;
+
+    DetectionEventEngine(const DetectionEventEngine&) = delete;
+    DetectionEventEngine& operator=(const DetectionEventEngine&) = delete;
+
+    /**
+     * @brief 更新规则（状态机回到 kIdle）
+     */
+    void Configure(const DetectionEventConfig& config);
+
+    DetectionEventConfig GetConfig() const;
+
+    void SetTriggerCallback(TriggerCallback callback);
+
+    /**
+     * @brief 评估一次推理结果（推理线程调用）
+     *
+     * @param results 检测结果（坐标已映射到主码流画面）
+     * @param frame_width 画面宽度
+     * @param frame_height 画面高度
+     */
+    void OnDetections(const rknn::DetectionResultList& results, int frame_width,
+                      int frame_height);
+
+    /**
+     * @brief 重置状态机（生产者切换时调用，旧模式的事件不延续）
+     */
+    void Reset();
+
+    DetectionEventStats GetStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /// 挑选命中规则且置信度最高的目标，未命中返回 nullptr
+    const rknn::DetectionResult* FindMatch(const rknn::DetectionResultList& results,
+                                           int frame_width, int frame_height) const;
+
+    static int64_t ElapsedMs(Clock::time_point from, Clock::time_point to) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(to - from).count();
+    }
+
+    mutable std::mutex mutex_;
+    DetectionEventConfig config_;
+    TriggerCallback callback_;
+
+    DetectionEventState state_ = DetectionEventState::kIdle;
+    Clock::time_point dwell_start_;
+    Clock::time_point last_match_;
+    Clock::time_point last_trigger_;
+    Clock::time_point cooldown_until_;
+
+    DetectionEventStats stats_;
+};
+
+}  // namespace media
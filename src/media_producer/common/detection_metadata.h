@@ -0,0 +1,123 @@
+/**
+ * @file detection_metadata.h
+ * @brief 检测结果元数据 - 紧凑二进制编码，供客户端自行渲染检测框
+ *
+ * AI 模式下检测框可以不烧进画面（ai_overlay = kClient），而是把每次推理的结果
+ * 编码成一条二进制消息，经 WebRTC 数据通道 / WebSocket 元数据子通道推给浏览器，
+ * 由浏览器在 video 上层的 canvas 绘制。消息携带来源帧的采集 PTS，
+ * 客户端可按视频帧时间戳对齐。
+ *
+ * 消息格式（小端）：
+ *   头部 20 字节
+ *     u8  magic          0xDE
+ *     u8  version        1
+ *     u16 count          检测数
+ *     u64 pts_us         来源帧采集 PTS（微秒）
+ *     u32 seq            结果序号（DetectionResultList::frame_id，隔帧推理时预测帧也递增）
+ *     u16 frame_width    坐标所在画面宽（主码流分辨率）
+ *     u16 frame_height   坐标所在画面高
+ *   每个检测 14 字节 + 关键点 + 类别名
+ *     u16 class_id
+ *     u16 score          置信度 * 65535
+ *     u16 x, y, w, h     边界框（像素，裁剪到 [0, 65535]）
+ *     u8  landmark_count
+ *     u8  label_len
+ *     u16 x, y           * landmark_count（RetinaFace 5 点关键点）
+ *     u8  label[label_len]（UTF-8，不含结尾 0）
+ *
+ * 典型 YOLO 结果（5 个目标）约 120 字节；无检测时只有 20 字节头部（客户端据此清屏）。
+ *
+ * @note header-only，无状态，线程安全
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-16
+ */
+
+#pragma once
+
+#include "ai_types.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+namespace media {
+
+constexpr uint8_t kDetectionMetadataMagic = 0xDE;
+constexpr uint8_t kDetectionMetadataVersion = 1;
+constexpr size_t kDetectionMetadataHeaderSize = 20;
+
+namespace detail {
+
+inline void PutU8(std::string* out, uint32_t v) {
+    out->push_back(static_cast<char>(v & 0xFF));
+}
+
+inline void PutU16(std::string* out, uint32_t v) {
+    PutU8(out, v);
+    PutU8(out, v >> 8);
+}
+
+inline void PutU32(std::string* out, uint32_t v) {
+    PutU16(out, v);
+    PutU16(out, v >> 16);
+}
+
+inline void PutU64(std::string* out, uint64_t v) {
+    PutU32(out, static_cast<uint32_t>(v));
+    PutU32(out, static_cast<uint32_t>(v >> 32));
+}
+
+inline uint32_t ClampU16(int v) {
+    return static_cast<uint32_t>(std::clamp(v, 0, 0xFFFF));
+}
+
+}  // namespace detail
+
+/**
+ * @brief 编码一次推理的检测结果
+ *
+ * @param results      检测结果（坐标已映射到主码流画面）
+ * @param frame_width  坐标所在画面宽
+ * @param frame_height 坐标所在画面高
+ * @param out          输出缓冲（覆盖写入，调用方可复用以避免分配）
+ */
+inline void EncodeDetectionMetadata(const rknn::DetectionResultList& results,
+                                    int frame_width, int frame_height, std::string* out) {
+    using namespace detail;
+
+    const size_t count = std::min<size_t>(results.Count(), 0xFFFF);
+    out->clear();
+    out->reserve(kDetectionMetadataHeaderSize + count * 32);
+
+    PutU8(out, kDetectionMetadataMagic);
+    PutU8(out, kDetectionMetadataVersion);
+    PutU16(out, static_cast<uint32_t>(count));
+    PutU64(out, results.pts);
+    PutU32(out, static_cast<uint32_t>(results.frame_id));
+    PutU16(out, ClampU16(frame_width));
+    PutU16(out, ClampU16(frame_height));
+
+    for (size_t i = 0; i < count; ++i) {
+        const auto& det = results.results[i];
+        const float score = std::clamp(det.confidence, 0.0f, 1.0f);
+        const size_t landmarks = std::min<size_t>(det.landmarks.size(), 0xFF);
+        const size_t label_len = std::min<size_t>(det.label.size(), 0xFF);
+
+        PutU16(out, ClampU16(det.class_id));
+        PutU16(out, static_cast<uint32_t>(score * 65535.0f + 0.5f));
+        PutU16(out, ClampU16(det.box.x));
+        PutU16(out, ClampU16(det.box.y));
+        PutU16(out, ClampU16(det.box.width));
+        PutU16(out, ClampU16(det.box.height));
+        PutU8(out, static_cast<uint32_t>(landmarks));
+        PutU8(out, static_cast<uint32_t>(label_len));
+        for (size_t j = 0; j < landmarks; ++j) {
+            PutU16(out, ClampU16(det.landmarks[j].x));
+            PutU16(out, ClampU16(det.landmarks[j].y));
+        }
+        out->append(det.label, 0, label_len);
+    }
+}
+
+}  // namespace media
@@ -1,11 +1,14 @@
 /**
  * @file image_utils.cpp
- * @brief 图像处理工具实现 - 基于 OpenCV-mobile
+ * @brief 图像处理工具实现 - 基于 OpenCV-mobile / RGA
  *
  * 使用 OpenCV-mobile 进行图像处理：
  * - NV12 -> RGB 颜色空间转换
  * - 等比缩放 + letterbox 填充
  *
+ * RGA 后端：以 DMA fd 导入 VPSS 帧和 rknn 输入内存，单次 improcess
+ * 完成颜色转换 + 缩放 + 写入 letterbox 区域，CPU 不触碰像素。
+ *
  * @author 好软，好温暖
  * @date 2026-02-05
  */
@@ -19,11 +22,42 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 
+// librga (im2d API)
+#include "im2d.h"
+#include "rga.h"
+
 #include <cstring>
 #include <algorithm>
 
 namespace rknn {
 
+namespace {
+
+/**
+ * @brief 求源图实际处理区域：裁剪区域裁到图像内，偏移与尺寸取偶数（NV12 色度 2x2 采样）
+ * @return false 裁剪区域为空
+ */
+bool ResolveCrop(const ImageBuffer& src, int* x, int* y, int* width, int* height) {
+    if (!src.HasCrop()) {
+        *x = 0;
+        *y = 0;
+        *width = src.width;
+        *height = src.height;
+        return true;
+    }
+    const int x1 = std::max(0, src.crop_x) & ~1;
+    const int y1 = std::max(0, src.crop_y) & ~1;
+    const int x2 = std::min(src.width, src.crop_x + src.crop_width);
+    const int y2 = std::min(src.height, src.crop_y + src.crop_height);
+    *x = x1;
+    *y = y1;
+    *width = (x2 - x1) & ~1;
+    *height = (y2 - y1) & ~1;
+    return *width > 0 && *height > 0;
+}
+
+}  // namespace
+
 // ============================================================================
 // ImageProcessor 实现
 // ============================================================================
@@ -32,21 +66,24 @@ ImageProcessor::~ImageProcessor() {
     Deinit();
 }
 
-bool ImageProcessor::Init(int model_width, int model_height) {
+bool ImageProcessor::Init(int model_width, int model_height, PreprocessBackend backend) {
     if (initialized_) {
         Deinit();
     }
 
     model_width_ = model_width;
     model_height_ = model_height;
+    backend_ = backend;
+    rga_fallback_count_ = 0;
 
-    // 预分配临时缓冲区不再需要（OpenCV 会管理内存）
+    // 临时缓冲区按首帧尺寸懒分配，之后跨帧复用
     temp_rgb_buffer_.clear();
     temp_scaled_buffer_.clear();
 
     initialized_ = true;
     
-    LOG_INFO("ImageProcessor initialized with OpenCV-mobile: model size {}x{}", model_width, model_height);
+    LOG_INFO("ImageProcessor initialized: backend={}, model size {}x{}",
+             PreprocessBackendToString(backend_), model_width, model_height);
     
     return true;
 }
@@ -56,6 +93,7 @@ void ImageProcessor::Deinit() {
         return;
     }
 
+    ReleaseRgaDst();
     temp_rgb_buffer_.clear();
     temp_scaled_buffer_.clear();
     model_width_ = 0;
@@ -67,14 +105,31 @@ void ImageProcessor::Deinit() {
 
 int ImageProcessor::ConvertNV12ToModelInput(const void* nv12_data, int src_width, int src_height,
                                              int src_stride, void* rgb_output, LetterboxInfo& letterbox_info) {
-    if (!initialized_ || !nv12_data || !rgb_output) {
+    ImageBuffer src;
+    src.data = const_cast<void*>(nv12_data);
+    src.width = src_width;
+    src.height = src_height;
+    src.stride = src_stride;
+    return ConvertNV12ToModelInputCpu(src, rgb_output, letterbox_info);
+}
+
+int ImageProcessor::ConvertNV12ToModelInputCpu(const ImageBuffer& src, void* rgb_output,
+                                                LetterboxInfo& letterbox_info) {
+    if (!initialized_ || !src.data || !rgb_output) {
         LOG_ERROR("Invalid parameters or not initialized");
         return -1;
     }
     
-    // 如果未指定 stride，使用 width
-    if (src_stride <= 0) {
-        src_stride = src_width;
+    // 如果未指定 stride，使用 width；UV 平面紧跟在 vir_height 行之后（VPSS 可能按 16 行对齐）
+    const int src_stride = src.stride > 0 ? src.stride : src.width;
+    const int src_vir_height = src.vir_height > 0 ? src.vir_height : src.height;
+
+    int crop_x = 0;
+    int crop_y = 0;
+    int crop_width = 0;
+    int crop_height = 0;
+    if (!ResolveCrop(src, &crop_x, &crop_y, &crop_width, &crop_height)) {
+        return -1;
     }
 
     // ========================================
@@ -83,84 +138,258 @@ int ImageProcessor::ConvertNV12ToModelInput(const void* nv12_data, int src_width
     // ========================================
     
     // 计算 letterbox 参数
+    int scaled_width = 0;
+    int scaled_height = 0;
+    ComputeLetterbox(crop_width, crop_height, false, letterbox_info, scaled_width, scaled_height);
+    letterbox_info.crop_x = crop_x;
+    letterbox_info.crop_y = crop_y;
+    const int pad_left = letterbox_info.pad_left;
+    const int pad_top = letterbox_info.pad_top;
+
+    // ========================================
+    // 步骤 1: NV12 -> RGB（带步长 Mat 直接包装 Y/UV 平面，无需逐行拷贝）
+    // NV12 格式：Y 平面 height 行（占 vir_height 行），UV 平面 height/2 行；裁剪时从区域左上角开始包装
+    // ========================================
+    const uint8_t* src_ptr = static_cast<const uint8_t*>(src.data);
+    const uint8_t* uv_ptr = src_ptr + static_cast<size_t>(src_stride) * src_vir_height;
+    cv::Mat y_plane(crop_height, crop_width, CV_8UC1,
+                    const_cast<uint8_t*>(src_ptr + static_cast<size_t>(src_stride) * crop_y + crop_x),
+                    src_stride);
+    cv::Mat uv_plane(crop_height / 2, crop_width / 2, CV_8UC2,
+                     const_cast<uint8_t*>(uv_ptr + static_cast<size_t>(src_stride) * (crop_y / 2) +
+                                          crop_x),
+                     src_stride);
+
+    // RGB 中间缓冲区跨帧复用
+    size_t rgb_size = static_cast<size_t>(crop_width) * crop_height * 3;
+    if (temp_rgb_buffer_.size() < rgb_size) {
+        temp_rgb_buffer_.resize(rgb_size);
+    }
+    cv::Mat rgb(crop_height, crop_width, CV_8UC3, temp_rgb_buffer_.data());
+    cv::cvtColorTwoPlane(y_plane, uv_plane, rgb, cv::COLOR_YUV2RGB_NV12);
+
+    // ========================================
+    // 步骤 2: 清黑边并直接缩放到输出缓冲区的 letterbox 区域
+    // ========================================
+    std::memset(rgb_output, 0, static_cast<size_t>(model_width_) * model_height_ * 3);
+    cv::Mat letterbox_img(model_height_, model_width_, CV_8UC3, rgb_output);
+    cv::Mat roi = letterbox_img(cv::Rect(pad_left, pad_top, scaled_width, scaled_height));
+    cv::resize(rgb, roi, cv::Size(scaled_width, scaled_height), 0, 0, cv::INTER_LINEAR);
+
+    return 0;
+}
+
+int ImageProcessor::ConvertNV12ToModelInput(const ImageBuffer& src, const ImageBuffer& dst,
+                                             LetterboxInfo& letterbox_info) {
+    if (backend_ == PreprocessBackend::kRga && src.fd >= 0 && dst.fd >= 0) {
+        if (ConvertNV12ToModelInputRga(src, dst, letterbox_info) == 0) {
+            return 0;
+        }
+        // 单帧失败回退 CPU，避免推理中断；只在首次和每 300 次时告警
+        if (rga_fallback_count_++ % 300 == 0) {
+            LOG_WARN("RGA preprocess failed, falling back to OpenCV (count={})",
+                     rga_fallback_count_);
+        }
+    }
+
+    return ConvertNV12ToModelInputCpu(src, dst.data, letterbox_info);
+}
+
+int ImageProcessor::ConvertNV12ToModelInputRga(const ImageBuffer& src, const ImageBuffer& dst,
+                                                LetterboxInfo& letterbox_info) {
+    if (!initialized_) {
+        return -1;
+    }
+
+    const int src_stride = src.stride > 0 ? src.stride : src.width;
+    const int src_vir_height = src.vir_height > 0 ? src.vir_height : src.height;
+
+    int crop_x = 0;
+    int crop_y = 0;
+    int crop_width = 0;
+    int crop_height = 0;
+    if (!ResolveCrop(src, &crop_x, &crop_y, &crop_width, &crop_height)) {
+        return -1;
+    }
+
+    int scaled_width = 0;
+    int scaled_height = 0;
+    ComputeLetterbox(crop_width, crop_height, true, letterbox_info, scaled_width, scaled_height);
+    letterbox_info.crop_x = crop_x;
+    letterbox_info.crop_y = crop_y;
+
+    // 目标：rknn 输入内存，fd 在模型生命周期内不变，仅首次导入
+    if (dst.fd != rga_dst_fd_) {
+        ReleaseRgaDst();
+        rga_dst_handle_ = importbuffer_fd(dst.fd, model_width_ * model_height_ * 3);
+        if (rga_dst_handle_ == 0) {
+            LOG_ERROR("RGA importbuffer_fd failed for model input fd={}", dst.fd);
+            return -1;
+        }
+        rga_dst_fd_ = dst.fd;
+    }
+
+    // 源：VPSS MB_BLK，按帧导入（VPSS 内部轮转多个 buffer）
+    rga_buffer_handle_t src_handle = importbuffer_fd(
+        src.fd, src_stride * src_vir_height * 3 / 2);
+    if (src_handle == 0) {
+        LOG_ERROR("RGA importbuffer_fd failed for source fd={}", src.fd);
+        return -1;
+    }
+
+    rga_buffer_t src_img = wrapbuffer_handle(src_handle, src.width, src.height,
+                                             RK_FORMAT_YCbCr_420_SP, src_stride, src_vir_height);
+    rga_buffer_t dst_img = wrapbuffer_handle(rga_dst_handle_, model_width_, model_height_,
+                                             RK_FORMAT_RGB_888);
+
+    int ret = 0;
+
+    // 黑边只需在几何变化时填充一次，后续帧只覆盖中间有效区域
+    int fill_key[4] = {letterbox_info.pad_left, letterbox_info.pad_top,
+                       scaled_width, scaled_height};
+    if (!std::equal(fill_key, fill_key + 4, rga_fill_key_)) {
+        im_rect full_rect = {0, 0, model_width_, model_height_};
+        IM_STATUS status = imfill(dst_img, full_rect, 0x00000000);
+        if (status != IM_STATUS_SUCCESS) {
+            LOG_WARN("RGA imfill failed: {}", imStrError(status));
+            ret = -1;
+        } else {
+            std::copy(fill_key, fill_key + 4, rga_fill_key_);
+        }
+    }
+
+    if (ret == 0) {
+        // 一次 improcess：NV12 -> RGB888 + 缩放 + 写入 letterbox 区域
+        rga_buffer_t pat;
+        memset(&pat, 0, sizeof(pat));
+        im_rect src_rect = {crop_x, crop_y, crop_width, crop_height};
+        im_rect dst_rect = {letterbox_info.pad_left, letterbox_info.pad_top,
+                            scaled_width, scaled_height};
+        im_rect pat_rect = {0, 0, 0, 0};
+
+        IM_STATUS status = improcess(src_img, dst_img, pat, src_rect, dst_rect, pat_rect, IM_SYNC);
+        if (status != IM_STATUS_SUCCESS) {
+            LOG_WARN("RGA improcess failed: {}", imStrError(status));
+            ret = -1;
+        }
+    }
+
+    releasebuffer_handle(src_handle);
+
+    if (ret != 0) {
+        // CPU 回退会重写整张图，下次 RGA 需要重新填充黑边
+        std::fill(rga_fill_key_, rga_fill_key_ + 4, -1);
+    }
+    return ret;
+}
+
+void ImageProcessor::ReleaseRgaDst() {
+    if (rga_dst_handle_ != 0) {
+        releasebuffer_handle(rga_dst_handle_);
+        rga_dst_handle_ = 0;
+    }
+    rga_dst_fd_ = -1;
+    std::fill(rga_fill_key_, rga_fill_key_ + 4, -1);
+}
+
+void ImageProcessor::ComputeLetterbox(int src_width, int src_height, bool align_even,
+                                      LetterboxInfo& info,
+                                      int& scaled_width, int& scaled_height) const {
     float scale_x = static_cast<float>(model_width_) / src_width;
     float scale_y = static_cast<float>(model_height_) / src_height;
     float scale = std::min(scale_x, scale_y);
 
-    int scaled_width = static_cast<int>(src_width * scale);
-    int scaled_height = static_cast<int>(src_height * scale);
+    scaled_width = static_cast<int>(src_width * scale);
+    scaled_height = static_cast<int>(src_height * scale);
 
     int pad_left = (model_width_ - scaled_width) / 2;
     int pad_top = (model_height_ - scaled_height) / 2;
 
-    // 填充 letterbox 信息
-    letterbox_info.scale = scale;
-    letterbox_info.pad_left = pad_left;
-    letterbox_info.pad_top = pad_top;
-    letterbox_info.src_width = src_width;
-    letterbox_info.src_height = src_height;
-    letterbox_info.dst_width = model_width_;
-    letterbox_info.dst_height = model_height_;
+    if (align_even) {
+        scaled_width &= ~1;
+        scaled_height &= ~1;
+        pad_left &= ~1;
+        pad_top &= ~1;
+    }
 
-    // ========================================
-    // 步骤 1: 创建 NV12 Mat（考虑 stride）
-    // NV12 格式：Y 平面 height 行，UV 平面 height/2 行
-    // ========================================
-    
-    // 如果 stride == width，可以直接用连续内存
-    // 否则需要按行拷贝处理（暂时假设 stride == width 或接近）
-    cv::Mat yuv420sp;
-    if (src_stride == src_width) {
-        // stride 等于 width，直接使用
-        yuv420sp = cv::Mat(src_height + src_height / 2, src_width, CV_8UC1, 
-                           const_cast<void*>(nv12_data));
-    } else {
-        // stride 不等于 width，需要逐行拷贝 Y 和 UV 平面
-        // Y 平面: height 行，每行 width 字节（stride 对齐）
-        // UV 平面: height/2 行，每行 width 字节（stride 对齐）
-        yuv420sp = cv::Mat(src_height + src_height / 2, src_width, CV_8UC1);
-        
-        const uint8_t* src_ptr = static_cast<const uint8_t*>(nv12_data);
-        uint8_t* dst_ptr = yuv420sp.data;
-        
-        // 拷贝 Y 平面
-        for (int y = 0; y < src_height; ++y) {
-            std::memcpy(dst_ptr + y * src_width, src_ptr + y * src_stride, src_width);
-        }
-        
-        // 拷贝 UV 平面（从 stride * height 开始）
-        const uint8_t* uv_src = src_ptr + src_stride * src_height;
-        uint8_t* uv_dst = dst_ptr + src_width * src_height;
-        for (int y = 0; y < src_height / 2; ++y) {
-            std::memcpy(uv_dst + y * src_width, uv_src + y * src_stride, src_width);
+    info.scale = scale;
+    info.pad_left = pad_left;
+    info.pad_top = pad_top;
+    info.src_width = src_width;
+    info.src_height = src_height;
+    info.crop_x = 0;
+    info.crop_y = 0;
+    info.dst_width = model_width_;
+    info.dst_height = model_height_;
+}
+
+int ImageProcessor::LetterboxRGBToModelInput(const ImageBuffer& src, const ImageBuffer& dst,
+                                             LetterboxInfo& letterbox_info) {
+    if (!initialized_ || !src.data || !dst.data) {
+        LOG_ERROR("Invalid parameters or not initialized");
+        return -1;
+    }
+
+    int crop_x = 0;
+    int crop_y = 0;
+    int crop_width = 0;
+    int crop_height = 0;
+    if (!ResolveCrop(src, &crop_x, &crop_y, &crop_width, &crop_height)) {
+        return -1;
+    }
+
+    int scaled_width = 0;
+    int scaled_height = 0;
+    ComputeLetterbox(crop_width, crop_height, false, letterbox_info, scaled_width, scaled_height);
+    letterbox_info.crop_x = crop_x;
+    letterbox_info.crop_y = crop_y;
+
+    const int src_stride = src.stride > 0 ? src.stride : src.width * 3;
+    uint8_t* in_data = static_cast<uint8_t*>(src.data) +
+                       static_cast<size_t>(crop_y) * src_stride + static_cast<size_t>(crop_x) * 3;
+    const size_t dst_stride = static_cast<size_t>(model_width_) * 3;
+    uint8_t* out = static_cast<uint8_t*>(dst.data);
+
+    std::memset(out, 0, dst_stride * model_height_);
+
+    if (scaled_width == crop_width && scaled_height == crop_height) {
+        // VPSS 已缩放到位：逐行拷贝到 letterbox 区域
+        const uint8_t* in = in_data;
+        uint8_t* row = out + letterbox_info.pad_top * dst_stride + letterbox_info.pad_left * 3;
+        for (int y = 0; y < crop_height; ++y) {
+            std::memcpy(row + y * dst_stride, in + static_cast<size_t>(y) * src_stride,
+                        static_cast<size_t>(crop_width) * 3);
         }
+    } else {
+        cv::Mat in(crop_height, crop_width, CV_8UC3, in_data, src_stride);
+        cv::Mat letterbox_img(model_height_, model_width_, CV_8UC3, dst.data);
+        cv::Mat roi = letterbox_img(cv::Rect(letterbox_info.pad_left, letterbox_info.pad_top,
+                                             scaled_width, scaled_height));
+        cv::resize(in, roi, cv::Size(scaled_width, scaled_height), 0, 0, cv::INTER_LINEAR);
     }
 
-    // ========================================
-    // 步骤 2: NV12 -> BGR -> RGB
-    // ========================================
-    cv::Mat bgr, rgb;
-    cv::cvtColor(yuv420sp, bgr, cv::COLOR_YUV420sp2BGR);
-    cv::cvtColor(bgr, rgb, cv::COLOR_BGR2RGB);
+    return 0;
+}
 
-    // ========================================
-    // 步骤 3: 缩放到目标尺寸
-    // ========================================
-    cv::Mat scaled;
-    cv::resize(rgb, scaled, cv::Size(scaled_width, scaled_height), 0, 0, cv::INTER_LINEAR);
+int ImageProcessor::ConvertNV12ToRGB(const void* nv12_data, int width, int height, int stride,
+                                     void* rgb_output) {
+    if (!nv12_data || !rgb_output || width <= 0 || height <= 0) {
+        LOG_ERROR("Invalid parameters");
+        return -1;
+    }
 
-    // ========================================
-    // 步骤 4: 创建黑色 letterbox 并复制缩放后的图像到中心
-    // ========================================
-    cv::Mat letterbox_img(model_height_, model_width_, CV_8UC3, cv::Scalar(0, 0, 0));
-    cv::Rect roi(pad_left, pad_top, scaled_width, scaled_height);
-    scaled.copyTo(letterbox_img(roi));
+    if (stride <= 0) {
+        stride = width;
+    }
 
-    // ========================================
-    // 步骤 5: 复制到输出缓冲区
-    // ========================================
-    std::memcpy(rgb_output, letterbox_img.data, model_width_ * model_height_ * 3);
+    // Y/UV 平面共享 stride，可用带步长的 Mat 直接包装，无需逐行拷贝
+    const uint8_t* src = static_cast<const uint8_t*>(nv12_data);
+    cv::Mat y_plane(height, width, CV_8UC1, const_cast<uint8_t*>(src), stride);
+    cv::Mat uv_plane(height / 2, width / 2, CV_8UC2,
+                     const_cast<uint8_t*>(src + static_cast<size_t>(stride) * height), stride);
+    cv::Mat rgb(height, width, CV_8UC3, rgb_output);
 
+    cv::cvtColorTwoPlane(y_plane, uv_plane, rgb, cv::COLOR_YUV2RGB_NV12);
     return 0;
 }
 
@@ -223,9 +452,38 @@ int ImageProcessor::DrawDetections(void* rgb_data, int width, int height,
 
 void ImageProcessor::MapCoordinates(int& x, int& y, const LetterboxInfo& info) {
     // 从模型空间映射回原始图像空间
-    // 模型坐标 -> 去掉 padding -> 除以 scale -> 原始坐标
-    x = static_cast<int>((x - info.pad_left) / info.scale);
-    y = static_cast<int>((y - info.pad_top) / info.scale);
+    // 模型坐标 -> 去掉 padding -> 除以 scale -> 加上裁剪偏移 -> 原始坐标
+    x = static_cast<int>((x - info.pad_left) / info.scale) + info.crop_x;
+    y = static_cast<int>((y - info.pad_top) / info.scale) + info.crop_y;
+}
+
+void ImageProcessor::MapDetections(DetectionResultList& results, const LetterboxInfo& info,
+                                   int width, int height) {
+    for (auto& result : results.results) {
+        int x1 = result.box.x;
+        int y1 = result.box.y;
+        int x2 = result.box.x + result.box.width;
+        int y2 = result.box.y + result.box.height;
+
+        MapCoordinates(x1, y1, info);
+        MapCoordinates(x2, y2, info);
+
+        x1 = std::max(0, std::min(x1, width - 1));
+        y1 = std::max(0, std::min(y1, height - 1));
+        x2 = std::max(0, std::min(x2, width - 1));
+        y2 = std::max(0, std::min(y2, height - 1));
+
+        result.box.x = x1;
+        result.box.y = y1;
+        result.box.width = x2 - x1;
+        result.box.height = y2 - y1;
+
+        for (auto& lm : result.landmarks) {
+            MapCoordinates(lm.x, lm.y, info);
+            lm.x = std::max(0, std::min(lm.x, width - 1));
+            lm.y = std::max(0, std::min(lm.y, height - 1));
+        }
+    }
 }
 
 }  // namespace rknn
@@ -4,7 +4,7 @@
  *
  * 基于 OpenCV-mobile 和 RGA 提供图像处理功能：
  * - NV12 -> RGB 颜色空间转换
- * - 图像缩放和 letterbox 填充
+ * - 图像缩放和 letterbox 填充（RGA 硬件路径：DMA fd 直出到 rknn 输入内存）
  * - 检测框和文字绘制
  *
  * @author 好软，好温暖
@@ -20,6 +20,26 @@
 
 namespace rknn {
 
+/**
+ * @enum PreprocessBackend
+ * @brief 模型输入预处理后端
+ */
+enum class PreprocessBackend {
+    kOpenCV,    ///< CPU（OpenCV-mobile）：颜色转换 + 缩放 + letterbox
+    kRga,       ///< RGA 硬件：按 DMA fd 一次完成转换、缩放和填充，失败时回退 OpenCV
+};
+
+/**
+ * @brief 预处理后端转字符串
+ */
+inline const char* PreprocessBackendToString(PreprocessBackend backend) {
+    switch (backend) {
+        case PreprocessBackend::kOpenCV: return "opencv";
+        case PreprocessBackend::kRga:    return "rga";
+        default:                         return "unknown";
+    }
+}
+
 /**
  * @struct ImageBuffer
  * @brief 图像缓冲区描述
@@ -30,6 +50,16 @@ struct ImageBuffer {
     int height = 0;             ///< 高度
     int stride = 0;             ///< 行步长（字节）
     int channels = 3;           ///< 通道数
+    int fd = -1;                ///< DMA-BUF fd（-1 表示仅有虚拟地址，RGA 不可用）
+    int vir_height = 0;         ///< 虚拟高度（NV12 的 UV 平面偏移为 stride * vir_height），0 表示同 height
+    
+    /// 源裁剪区域（只把该区域 letterbox 到模型输入，NV12 需偶数对齐）；crop_width/crop_height 为 0 表示整幅
+    int crop_x = 0;
+    int crop_y = 0;
+    int crop_width = 0;
+    int crop_height = 0;
+    
+    bool HasCrop() const { return crop_width > 0 && crop_height > 0; }
     
     /**
      * @brief 计算数据大小
@@ -47,8 +77,10 @@ struct LetterboxInfo {
     float scale = 1.0f;         ///< 缩放比例
     int pad_left = 0;           ///< 左侧填充
     int pad_top = 0;            ///< 顶部填充
-    int src_width = 0;          ///< 原始宽度
-    int src_height = 0;         ///< 原始高度
+    int src_width = 0;          ///< 原始宽度（裁剪时为裁剪区域宽度）
+    int src_height = 0;         ///< 原始高度（裁剪时为裁剪区域高度）
+    int crop_x = 0;             ///< 裁剪区域在原图中的偏移（映射回原图时加上）
+    int crop_y = 0;
     int dst_width = 0;          ///< 目标宽度
     int dst_height = 0;         ///< 目标高度
 };
@@ -69,9 +101,11 @@ public:
      * 
      * @param model_width 模型输入宽度
      * @param model_height 模型输入高度
+     * @param backend 预处理后端（RGA 不可用时自动回退到 OpenCV）
      * @return true 成功，false 失败
      */
-    bool Init(int model_width, int model_height);
+    bool Init(int model_width, int model_height,
+              PreprocessBackend backend = PreprocessBackend::kRga);
 
     /**
      * @brief 反初始化
@@ -92,6 +126,50 @@ public:
     int ConvertNV12ToModelInput(const void* nv12_data, int src_width, int src_height,
                                  int src_stride, void* rgb_output, LetterboxInfo& letterbox_info);
 
+    /**
+     * @brief 转换 NV12 到 RGB 并缩放到模型输入尺寸（支持 DMA fd）
+     * 
+     * RGA 后端且 src/dst 均带 fd 时走硬件路径：直接读 VPSS MB_BLK，
+     * 将 letterbox 后的 RGB888 写入 rknn_tensor_mem；否则走 OpenCV 路径。
+     * src 带裁剪区域时只处理该区域（如只在人形框内检测人脸）。
+     * 
+     * @param src NV12 源图像（data 必填，fd/vir_height 可选）
+     * @param dst 模型输入缓冲区（data 必填，fd 可选）
+     * @param[out] letterbox_info letterbox 信息（用于坐标映射）
+     * @return 0 成功，负值失败
+     */
+    int ConvertNV12ToModelInput(const ImageBuffer& src, const ImageBuffer& dst,
+                                 LetterboxInfo& letterbox_info);
+
+    /**
+     * @brief 将 RGB888 图像 letterbox 到模型输入尺寸
+     * 
+     * 用于 VPSS 已硬件缩放并输出 RGB 的场景：尺寸已适配时 CPU 只逐行拷贝并补黑边，
+     * 否则退化为一次 resize。支持 src 裁剪区域。
+     * 
+     * @param src RGB888 源图像（stride 为行字节数，0 表示 width * 3）
+     * @param dst 模型输入缓冲区
+     * @param[out] letterbox_info letterbox 信息（用于坐标映射）
+     * @return 0 成功，负值失败
+     */
+    int LetterboxRGBToModelInput(const ImageBuffer& src, const ImageBuffer& dst,
+                                 LetterboxInfo& letterbox_info);
+
+    /**
+     * @brief 转换 NV12 到同尺寸 RGB888（用于送编码）
+     * 
+     * 直接写入输出缓冲区，不做缩放，也不分配中间帧。
+     * 
+     * @param nv12_data NV12 数据（Y + UV 平面）
+     * @param width 图像宽度
+     * @param height 图像高度
+     * @param stride 行步长（虚拟宽度），0 表示使用 width
+     * @param rgb_output RGB 输出缓冲区（width * height * 3 字节）
+     * @return 0 成功，负值失败
+     */
+    int ConvertNV12ToRGB(const void* nv12_data, int width, int height, int stride,
+                         void* rgb_output);
+
     /**
      * @brief 在 RGB 图像上绘制检测结果
      * 
@@ -115,16 +193,60 @@ public:
      */
     static void MapCoordinates(int& x, int& y, const LetterboxInfo& info);
 
+    /**
+     * @brief 将整组检测结果（框 + 关键点）映射回原始图像空间并裁剪到图像内
+     * 
+     * @param results 输入/输出检测结果
+     * @param info letterbox 信息
+     * @param width 原始图像宽度
+     * @param height 原始图像高度
+     */
+    static void MapDetections(DetectionResultList& results, const LetterboxInfo& info,
+                              int width, int height);
+
     /**
      * @brief 获取模型输入尺寸
      */
     int GetModelWidth() const { return model_width_; }
     int GetModelHeight() const { return model_height_; }
 
+    /**
+     * @brief 获取当前预处理后端
+     */
+    PreprocessBackend GetBackend() const { return backend_; }
+
+private:
+    /**
+     * @brief 计算 letterbox 参数
+     * 
+     * @param align_even 是否将缩放尺寸和偏移对齐到偶数（RGA YUV 输入要求）
+     */
+    void ComputeLetterbox(int src_width, int src_height, bool align_even,
+                          LetterboxInfo& info, int& scaled_width, int& scaled_height) const;
+
+    /// OpenCV 路径（支持裁剪区域）
+    int ConvertNV12ToModelInputCpu(const ImageBuffer& src, void* rgb_output,
+                                   LetterboxInfo& letterbox_info);
+
+    /// RGA 硬件路径
+    int ConvertNV12ToModelInputRga(const ImageBuffer& src, const ImageBuffer& dst,
+                                   LetterboxInfo& letterbox_info);
+
+    /// 释放缓存的 RGA 目标 handle
+    void ReleaseRgaDst();
+
 private:
     int model_width_ = 0;
     int model_height_ = 0;
     bool initialized_ = false;
+    PreprocessBackend backend_ = PreprocessBackend::kOpenCV;
+
+    // RGA 目标缓冲区（rknn 输入内存在模型生命周期内固定，handle 只导入一次）
+    int rga_dst_fd_ = -1;
+    uint32_t rga_dst_handle_ = 0;   ///< rga_buffer_handle_t
+    // 上次填充 padding 时的有效区域，几何不变时无需重复清黑边
+    int rga_fill_key_[4] = {-1, -1, -1, -1};
+    uint64_t rga_fallback_count_ = 0;
     
     // 中间缓冲区
     std::vector<uint8_t> temp_rgb_buffer_;     ///< NV12->RGB 转换后的全尺寸缓冲区
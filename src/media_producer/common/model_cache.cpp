@@ -0,0 +1,151 @@
+/**
+ * @file model_cache.cpp
+ * @brief 模型缓存实现
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-12
+ */
+
+#define LOG_TAG "ModelCache"
+
+#include "model_cache.h"
+#include "common/logger.h"
+
+#include <algorithm>
+
+namespace rknn {
+
+// ============================================================================
+// 单例
+// ============================================================================
+
+ModelCache& ModelCache::Instance() {
+    static ModelCache instance;
+    return instance;
+}
+
+// ============================================================================
+// 配置
+// ============================================================================
+
+void ModelCache::Configure(const ModelCacheConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+
+    std::string warm;
+    for (const auto& name : config_.warm_models) {
+        if (!warm.empty()) warm += ",";
+        warm += name;
+    }
+    LOG_INFO("Model cache configured: warm=[{}], limit={}MB",
+             warm, config_.memory_limit_bytes >> 20);
+
+    TrimLocked();
+}
+
+bool ModelCache::IsWarm(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return IsWarmLocked(name);
+}
+
+// ============================================================================
+// 淘汰
+// ============================================================================
+
+void ModelCache::Trim() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    TrimLocked();
+}
+
+void ModelCache::Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::remove_if(entries_.begin(), entries_.end(), [](const Entry& e) {
+        return e.model.use_count() <= 1;
+    });
+    size_t removed = static_cast<size_t>(entries_.end() - it);
+    entries_.erase(it, entries_.end());
+    if (removed > 0) {
+        LOG_INFO("Model cache cleared: {} model(s) released", removed);
+    }
+}
+
+void ModelCache::TrimLocked() {
+    size_t total = TotalBytesLocked();
+
+    while (!entries_.empty()) {
+        // 找最久未使用的空闲非常驻模型
+        auto victim = entries_.end();
+        for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+            if (it->model.use_count() > 1 || IsWarmLocked(it->name)) continue;
+            if (victim == entries_.end() || it->last_used < victim->last_used) {
+                victim = it;
+            }
+        }
+        if (victim == entries_.end()) break;
+
+        // 上限内保留；上限为 0 时空闲的非常驻模型立即释放
+        if (config_.memory_limit_bytes > 0 && total <= config_.memory_limit_bytes) break;
+
+        LOG_INFO("Evicting model '{}' ({}KB, idle)", victim->name, victim->memory_bytes >> 10);
+        total -= victim->memory_bytes;
+        entries_.erase(victim);
+        evictions_++;
+    }
+
+    if (config_.memory_limit_bytes > 0 && total > config_.memory_limit_bytes) {
+        LOG_WARN("Model cache over limit: {}KB used, {}KB allowed (models in use or warm)",
+                 total >> 10, config_.memory_limit_bytes >> 10);
+    }
+}
+
+// ============================================================================
+// 内部辅助
+// ============================================================================
+
+ModelCache::Entry* ModelCache::FindLocked(const std::string& name) {
+    for (auto& e : entries_) {
+        if (e.name == name) return &e;
+    }
+    return nullptr;
+}
+
+bool ModelCache::IsWarmLocked(const std::string& name) const {
+    return std::find(config_.warm_models.begin(), config_.warm_models.end(), name) !=
+           config_.warm_models.end();
+}
+
+size_t ModelCache::TotalBytesLocked() const {
+    size_t total = 0;
+    for (const auto& e : entries_) {
+        total += e.memory_bytes;
+    }
+    return total;
+}
+
+// ============================================================================
+// 统计
+// ============================================================================
+
+ModelCacheStats ModelCache::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    ModelCacheStats stats;
+    stats.limit_bytes = config_.memory_limit_bytes;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.evictions = evictions_;
+    for (const auto& e : entries_) {
+        ModelCacheEntryStats es;
+        es.name = e.name;
+        es.memory_bytes = e.memory_bytes;
+        es.load_ms = e.load_ms;
+        es.hits = e.hits;
+        es.warm = IsWarmLocked(e.name);
+        es.in_use = e.model.use_count() > 1;
+        stats.entries.push_back(es);
+        stats.total_bytes += e.memory_bytes;
+    }
+    return stats;
+}
+
+}  // namespace rknn
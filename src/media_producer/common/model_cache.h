@@ -0,0 +1,224 @@
+/**
+ * @file model_cache.h
+ * @brief 模型缓存 - RKNN 模型上下文与 IO 内存常驻管理
+ *
+ * 每次加载 .rknn 模型都要经历 rknn_init（读文件 + NPU 图编译）、属性查询、
+ * rknn_create_mem 分配输入输出张量，耗时可达数百毫秒。模型缓存把已加载的
+ * 模型实例（含 rknn_context 与零拷贝 IO 内存）按名称常驻，AI 模式切换时
+ * 直接取回同一实例，相当于一次指针交换。
+ *
+ * 缓存策略：
+ * - 常驻模型（warm_models）：永不淘汰，可在启动时预加载
+ * - 其他模型：首次使用时加载，空闲后在内存上限内保留，超限按 LRU 淘汰
+ * - 正在被生产者使用的模型不会被淘汰
+ *
+ * 使用方式：
+ * @code
+ * auto model = ModelCache::Instance().Acquire<YoloV5Model>("yolov5", model_cfg);
+ * // ... 推理 ...
+ * ModelCache::Instance().Release(model);  // 归还，按策略保留或淘汰
+ * @endcode
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-12
+ */
+
+#pragma once
+
+#include "ai_types.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace rknn {
+
+// ============================================================================
+// 配置与统计
+// ============================================================================
+
+/**
+ * @struct ModelCacheConfig
+ * @brief 模型缓存配置
+ */
+struct ModelCacheConfig {
+    std::vector<std::string> warm_models;   ///< 常驻模型名（如 "yolov5"、"retinaface"）
+    size_t memory_limit_bytes = 64u << 20;  ///< 缓存总内存上限（0 = 仅保留常驻模型）
+};
+
+/**
+ * @struct ModelCacheEntryStats
+ * @brief 单个缓存模型的统计
+ */
+struct ModelCacheEntryStats {
+    std::string name;
+    size_t memory_bytes = 0;        ///< NPU 内存占用（权重 + 中间层 + IO 张量）
+    int64_t load_ms = 0;            ///< 加载耗时
+    uint64_t hits = 0;              ///< 命中次数
+    bool warm = false;              ///< 是否常驻
+    bool in_use = false;            ///< 是否正被生产者使用
+};
+
+/**
+ * @struct ModelCacheStats
+ * @brief 模型缓存统计快照
+ */
+struct ModelCacheStats {
+    std::vector<ModelCacheEntryStats> entries;
+    size_t total_bytes = 0;
+    size_t limit_bytes = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+};
+
+// ============================================================================
+// ModelCache
+// ============================================================================
+
+/**
+ * @class ModelCache
+ * @brief 按名称缓存已初始化的模型实例（单例）
+ *
+ * 模型类型需提供：
+ * - int Init(const ModelConfig&)
+ * - size_t GetMemoryUsage() const
+ *
+ * @note 同一时刻只有一个生产者使用某个模型实例，推理线程无需额外同步
+ */
+class ModelCache {
+public:
+    static ModelCache& Instance();
+
+    ModelCache(const ModelCache&) = delete;
+    ModelCache& operator=(const ModelCache&) = delete;
+
+    /**
+     * @brief 设置缓存策略（立即按新上限淘汰空闲模型）
+     */
+    void Configure(const ModelCacheConfig& config);
+
+    /**
+     * @brief 是否为常驻模型
+     */
+    bool IsWarm(const std::string& name) const;
+
+    /**
+     * @brief 获取模型实例，缓存未命中时加载
+     *
+     * @param name 模型名称（缓存键）
+     * @param config 加载参数（仅未命中时使用）
+     * @return 模型实例，加载失败返回 nullptr
+     */
+    template <typename Model>
+    std::shared_ptr<Model> Acquire(const std::string& name, const ModelConfig& config);
+
+    /**
+     * @brief 归还模型实例并按策略整理缓存
+     *
+     * @param model 调用方持有的实例，调用后被置空
+     */
+    template <typename Model>
+    void Release(std::shared_ptr<Model>& model) {
+        model.reset();
+        Trim();
+    }
+
+    /**
+     * @brief 按内存上限淘汰空闲的非常驻模型（LRU）
+     */
+    void Trim();
+
+    /**
+     * @brief 释放所有空闲模型（含常驻模型，用于退出）
+     */
+    void Clear();
+
+    /**
+     * @brief 获取统计快照
+     */
+    ModelCacheStats GetStats() const;
+
+private:
+    struct Entry {
+        std::string name;
+        const void* type_tag = nullptr;
+        std::shared_ptr<void> model;
+        size_t memory_bytes = 0;
+        int64_t load_ms = 0;
+        uint64_t hits = 0;
+        std::chrono::steady_clock::time_point last_used;
+    };
+
+    ModelCache() = default;
+
+    /// 每种模型类型唯一的标识地址，防止同名不同类型的误转换
+    template <typename Model>
+    static const void* TypeTag() {
+        static const char tag = 0;
+        return &tag;
+    }
+
+    Entry* FindLocked(const std::string& name);
+    bool IsWarmLocked(const std::string& name) const;
+    size_t TotalBytesLocked() const;
+    void TrimLocked();
+
+    mutable std::mutex mutex_;
+    ModelCacheConfig config_;
+    std::vector<Entry> entries_;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t evictions_ = 0;
+};
+
+// ============================================================================
+// 模板实现
+// ============================================================================
+
+template <typename Model>
+std::shared_ptr<Model> ModelCache::Acquire(const std::string& name, const ModelConfig& config) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Entry* entry = FindLocked(name);
+        if (entry && entry->type_tag == TypeTag<Model>()) {
+            entry->hits++;
+            entry->last_used = std::chrono::steady_clock::now();
+            hits_++;
+            return std::static_pointer_cast<Model>(entry->model);
+        }
+        misses_++;
+    }
+
+    // 未命中：在锁外加载（rknn_init 可能耗时数百毫秒）
+    auto start = std::chrono::steady_clock::now();
+    auto model = std::make_shared<Model>();
+    if (model->Init(config) != 0) {
+        return nullptr;
+    }
+
+    Entry fresh;
+    fresh.name = name;
+    fresh.type_tag = TypeTag<Model>();
+    fresh.model = model;
+    fresh.memory_bytes = model->GetMemoryUsage();
+    fresh.last_used = std::chrono::steady_clock::now();
+    fresh.load_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        fresh.last_used - start).count();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry* entry = FindLocked(name);
+    if (entry) {
+        // 同名旧条目（类型不同或并发加载）：替换为新实例
+        *entry = std::move(fresh);
+    } else {
+        entries_.push_back(std::move(fresh));
+    }
+    TrimLocked();
+    return model;
+}
+
+}  // namespace rknn
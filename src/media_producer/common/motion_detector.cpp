@@ -0,0 +1,188 @@
+/**
+ * @file motion_detector.cpp
+ * @brief 运动检测实现
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-18
+ */
+
+#define LOG_TAG "Motion"
+
+#include "motion_detector.h"
+#include "common/logger.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MOTION_USE_NEON 1
+#endif
+
+namespace media {
+
+bool MotionDetector::Init(const MotionGateConfig& config) {
+    config_ = config;
+    config_.grid_cols = std::clamp(config_.grid_cols, 1, config_.width);
+    config_.grid_rows = std::clamp(config_.grid_rows, 1, config_.height);
+    config_.sensitivity = std::clamp(config_.sensitivity, 0, 9);
+    config_.background_shift = std::clamp(config_.background_shift, 1, 7);
+    cell_count_ = config_.grid_cols * config_.grid_rows;
+
+    const int width = config_.width;
+    const int height = config_.height;
+    background_.assign(static_cast<size_t>(width) * height, 0);
+    changed_.assign(width, 0);
+    column_cell_.resize(width);
+    row_cell_.resize(height);
+    for (int x = 0; x < width; ++x) {
+        column_cell_[x] = static_cast<uint16_t>(x * config_.grid_cols / width);
+    }
+    for (int y = 0; y < height; ++y) {
+        row_cell_[y] = static_cast<uint16_t>(y * config_.grid_rows / height);
+    }
+
+    sensitivity_.assign(cell_count_, static_cast<uint8_t>(config_.sensitivity));
+    if (!config_.sensitivity_map.empty() && !ParseSensitivityMap(config_.sensitivity_map)) {
+        return false;
+    }
+
+    // 每格像素数 * (10 - 灵敏度) * 2%
+    std::vector<uint32_t> cell_area(cell_count_, 0);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            cell_area[row_cell_[y] * config_.grid_cols + column_cell_[x]]++;
+        }
+    }
+    required_.resize(cell_count_);
+    int masked = 0;
+    for (int i = 0; i < cell_count_; ++i) {
+        const int s = sensitivity_[i];
+        if (s == 0) {
+            required_[i] = 0;
+            masked++;
+        } else {
+            required_[i] = std::max<uint32_t>(1, cell_area[i] * (10 - s) * 2 / 100);
+        }
+    }
+    counts_.assign(cell_count_, 0);
+
+    has_background_ = false;
+    active_cells_ = 0;
+    LOG_INFO("Motion detector: {}x{}, grid {}x{} ({} masked), pixel threshold {}",
+             width, height, config_.grid_cols, config_.grid_rows, masked,
+             config_.pixel_threshold);
+    return true;
+}
+
+bool MotionDetector::ParseSensitivityMap(const std::string& map) {
+    int row = 0;
+    int col = 0;
+    for (char c : map) {
+        if (c == ',' || c == ';' || c == '\n') {
+            if (col != 0) {
+                if (col != config_.grid_cols) break;
+                row++;
+                col = 0;
+            }
+            continue;
+        }
+        if (c == ' ' || c == '\r' || c == '\t') {
+            continue;
+        }
+        if (c < '0' || c > '9' || row >= config_.grid_rows || col >= config_.grid_cols) {
+            LOG_ERROR("Invalid motion sensitivity map near row {} col {}", row, col);
+            return false;
+        }
+        sensitivity_[row * config_.grid_cols + col] = static_cast<uint8_t>(c - '0');
+        col++;
+    }
+    if (col == config_.grid_cols) {
+        row++;
+        col = 0;
+    }
+    if (row != config_.grid_rows || col != 0) {
+        LOG_ERROR("Motion sensitivity map must be {} rows of {} digits",
+                  config_.grid_rows, config_.grid_cols);
+        return false;
+    }
+    return true;
+}
+
+bool MotionDetector::Process(const uint8_t* luma, int stride) {
+    const int width = config_.width;
+    const int height = config_.height;
+
+    if (!has_background_) {
+        for (int y = 0; y < height; ++y) {
+            memcpy(&background_[static_cast<size_t>(y) * width], luma + static_cast<size_t>(y) * stride,
+                   width);
+        }
+        has_background_ = true;
+        active_cells_ = cell_count_;
+        return true;
+    }
+
+    std::fill(counts_.begin(), counts_.end(), 0);
+    const int shift = config_.background_shift;
+    const uint8_t threshold = static_cast<uint8_t>(std::clamp(config_.pixel_threshold, 0, 255));
+
+#ifdef MOTION_USE_NEON
+    const uint8x16_t v_threshold = vdupq_n_u8(threshold);
+    const uint8x16_t v_one = vdupq_n_u8(1);
+    const int16x8_t v_shift = vdupq_n_s16(static_cast<int16_t>(-shift));
+#endif
+
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* src = luma + static_cast<size_t>(y) * stride;
+        uint8_t* bg = &background_[static_cast<size_t>(y) * width];
+        uint8_t* changed = changed_.data();
+        int x = 0;
+
+#ifdef MOTION_USE_NEON
+        for (; x + 16 <= width; x += 16) {
+            const uint8x16_t v_src = vld1q_u8(src + x);
+            const uint8x16_t v_bg = vld1q_u8(bg + x);
+
+            // 变化标记：|y - bg| > threshold
+            const uint8x16_t v_diff = vabdq_u8(v_src, v_bg);
+            vst1q_u8(changed + x, vandq_u8(vcgtq_u8(v_diff, v_threshold), v_one));
+
+            // 背景更新：bg += round((y - bg) / 2^shift)
+            const int16x8_t d_lo = vreinterpretq_s16_u16(
+                vsubl_u8(vget_low_u8(v_src), vget_low_u8(v_bg)));
+            const int16x8_t d_hi = vreinterpretq_s16_u16(
+                vsubl_u8(vget_high_u8(v_src), vget_high_u8(v_bg)));
+            const int16x8_t b_lo = vaddq_s16(
+                vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(v_bg))), vrshlq_s16(d_lo, v_shift));
+            const int16x8_t b_hi = vaddq_s16(
+                vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(v_bg))), vrshlq_s16(d_hi, v_shift));
+            vst1q_u8(bg + x, vcombine_u8(vqmovun_s16(b_lo), vqmovun_s16(b_hi)));
+        }
+#endif
+
+        const int round = 1 << (shift - 1);
+        for (; x < width; ++x) {
+            const int d = static_cast<int>(src[x]) - bg[x];
+            changed[x] = std::abs(d) > threshold ? 1 : 0;
+            bg[x] = static_cast<uint8_t>(std::clamp(bg[x] + ((d + round) >> shift), 0, 255));
+        }
+
+        uint32_t* row_counts = &counts_[row_cell_[y] * config_.grid_cols];
+        for (int i = 0; i < width; ++i) {
+            row_counts[column_cell_[i]] += changed[i];
+        }
+    }
+
+    int active = 0;
+    for (int i = 0; i < cell_count_; ++i) {
+        if (required_[i] > 0 && counts_[i] >= required_[i]) {
+            active++;
+        }
+    }
+    active_cells_ = active;
+    return active > 0;
+}
+
+}  // namespace media
@@ -0,0 +1,142 @@
+/**
+ * @file npu_scheduler.cpp
+ * @brief NPU 调度器实现
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-18
+ */
+
+#include "npu_scheduler.h"
+
+namespace media {
+
+namespace {
+
+constexpr auto kRateWindow = std::chrono::seconds(1);
+
+}  // namespace
+
+int NpuScheduler::AddTask(const NpuTaskConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (tasks_.size() >= 32) {
+        return -1;
+    }
+    Task task;
+    task.config = config;
+    if (config.target_hz > 0.0) {
+        task.period = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(1.0 / config.target_hz));
+    }
+    task.release = Clock::now();
+    task.deadline = task.release + task.period;
+    tasks_.push_back(std::move(task));
+    return static_cast<int>(tasks_.size()) - 1;
+}
+
+void NpuScheduler::Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.clear();
+}
+
+void NpuScheduler::Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto now = Clock::now();
+    for (auto& task : tasks_) {
+        task.release = now;
+        task.deadline = now + task.period;
+        task.runs = 0;
+        task.deadline_misses = 0;
+        task.run_time_us = 0;
+        task.window_start = Clock::time_point();
+        task.window_runs = 0;
+        task.rate_hz = 0.0;
+    }
+}
+
+int NpuScheduler::Next(Clock::time_point now, uint32_t ready_mask) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int best = -1;
+
+    for (size_t i = 0; i < tasks_.size(); ++i) {
+        auto& task = tasks_[i];
+        if ((ready_mask & (1u << i)) == 0) {
+            // 未就绪：释放时刻随当前时刻滑动，就绪后立即可运行且不计错过截止
+            if (task.release < now) {
+                task.release = now;
+                task.deadline = now + task.period;
+            }
+            continue;
+        }
+        if (now < task.release) {
+            continue;
+        }
+
+        // 优先级高者先运行，同优先级截止时间早者先运行
+        if (best < 0) {
+            best = static_cast<int>(i);
+            continue;
+        }
+        const auto& current = tasks_[best];
+        if (task.config.priority != current.config.priority
+                ? task.config.priority > current.config.priority
+                : task.deadline < current.deadline) {
+            best = static_cast<int>(i);
+        }
+    }
+    return best;
+}
+
+void NpuScheduler::Finish(int index, Clock::time_point start, Clock::time_point end) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index < 0 || index >= static_cast<int>(tasks_.size())) {
+        return;
+    }
+    auto& task = tasks_[index];
+
+    task.runs++;
+    if (task.period.count() > 0 && start > task.deadline) {
+        task.deadline_misses++;
+    }
+    task.run_time_us += static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+
+    // 下一周期：不补跑积压的周期
+    task.release += task.period;
+    if (task.release < end) {
+        task.release = end;
+    }
+    task.deadline = task.release + task.period;
+
+    if (task.window_start == Clock::time_point()) {
+        task.window_start = end;
+    }
+    task.window_runs++;
+    const auto elapsed = end - task.window_start;
+    if (elapsed >= kRateWindow) {
+        task.rate_hz = task.window_runs / std::chrono::duration<double>(elapsed).count();
+        task.window_start = end;
+        task.window_runs = 0;
+    }
+}
+
+std::vector<NpuTaskStats> NpuScheduler::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<NpuTaskStats> stats;
+    stats.reserve(tasks_.size());
+    for (const auto& task : tasks_) {
+        NpuTaskStats s;
+        s.name = task.config.name;
+        s.target_hz = task.config.target_hz;
+        s.priority = task.config.priority;
+        s.runs = task.runs;
+        s.deadline_misses = task.deadline_misses;
+        if (task.runs > 0) {
+            s.avg_run_ms = task.run_time_us / 1000.0 / static_cast<double>(task.runs);
+        }
+        s.rate_hz = task.rate_hz;
+        stats.push_back(std::move(s));
+    }
+    return stats;
+}
+
+}  // namespace media
@@ -0,0 +1,127 @@
+/**
+ * @file npu_scheduler.h
+ * @brief NPU 调度器 - 多个 rknn 模型按目标速率分时共用一个 NPU
+ *
+ * RV1106 只有一个 NPU 核，同一时刻只能跑一个 rknn_run。组合模式下推理线程每取到一帧，
+ * 先问调度器这一帧交给哪个模型（或都不跑），跑完再回报耗时：
+ * - 每个任务有目标速率（周期 T = 1 / target_hz）：释放时刻 r 之后才可运行，截止时刻 d = r + T
+ * - 已释放且就绪的任务中优先级高者先运行，同优先级按截止时间（EDF）；
+ *   低优先级任务使用高优先级任务两个周期之间的 NPU 空闲时间，
+ *   过载时低优先级任务先降速，不会拖慢高优先级任务
+ * - 运行完成后 r += T；已经落后时 r 对齐到完成时刻，不补跑积压的周期
+ * - 未就绪的任务（如画面中没有人形框时的人脸检测）不占用 NPU，其释放时刻随当前时刻滑动，
+ *   一旦就绪立即可运行，且不记为错过截止时间
+ *
+ * 使用示例：
+ * @code
+ * NpuScheduler sched;
+ * int yolo = sched.AddTask({"yolov5", 10.0, 1});
+ * int face = sched.AddTask({"retinaface", 5.0, 0});
+ * // 推理线程每帧：
+ * int task = sched.Next(now, has_person ? ~0u : ~(1u << face));
+ * if (task >= 0) { run(task); sched.Finish(task, start, end); }
+ * @endcode
+ *
+ * @note Next()/Finish() 只在推理线程调用；GetStats() 可在任意线程调用
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-18
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace media {
+
+/**
+ * @brief 调度任务参数
+ */
+struct NpuTaskConfig {
+    std::string name;
+    double target_hz = 0.0;     ///< 目标速率（0 = 不限速，每帧都到期）
+    int priority = 0;           ///< 同时到期时数值大者先运行
+};
+
+/**
+ * @brief 单个任务的调度统计
+ */
+struct NpuTaskStats {
+    std::string name;
+    double target_hz = 0.0;
+    int priority = 0;
+    uint64_t runs = 0;              ///< 运行次数
+    uint64_t deadline_misses = 0;   ///< 开始运行时已过截止时间的次数
+    double avg_run_ms = 0.0;        ///< 平均单次耗时（预处理 + rknn_run + 后处理）
+    double rate_hz = 0.0;           ///< 实际运行速率（最近统计窗口）
+};
+
+class NpuScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    NpuScheduler() = default;
+
+    NpuScheduler(const NpuScheduler&) = delete;
+    NpuScheduler& operator=(const NpuScheduler&) = delete;
+
+    /**
+     * @brief 添加任务（Start 之前调用）
+     * @return 任务序号（即就绪掩码中的位），最多 32 个
+     */
+    int AddTask(const NpuTaskConfig& config);
+
+    /**
+     * @brief 清空所有任务
+     */
+    void Clear();
+
+    /**
+     * @brief 清零统计，所有任务立即到期
+     */
+    void Reset();
+
+    /**
+     * @brief 选出本帧要运行的任务
+     *
+     * @param now        当前时刻
+     * @param ready_mask 第 i 位为 1 表示任务 i 的前置条件满足
+     * @return 任务序号，-1 表示本帧没有到期的任务
+     */
+    int Next(Clock::time_point now, uint32_t ready_mask = ~0u);
+
+    /**
+     * @brief 回报任务完成，推进下一个周期
+     */
+    void Finish(int index, Clock::time_point start, Clock::time_point end);
+
+    std::vector<NpuTaskStats> GetStats() const;
+
+    size_t TaskCount() const { return tasks_.size(); }
+
+private:
+    struct Task {
+        NpuTaskConfig config;
+        Clock::duration period{0};
+        Clock::time_point release;      ///< 本周期最早可运行时刻
+        Clock::time_point deadline;     ///< 本周期截止时刻
+
+        uint64_t runs = 0;
+        uint64_t deadline_misses = 0;
+        uint64_t run_time_us = 0;
+
+        // 速率统计窗口
+        Clock::time_point window_start;
+        uint64_t window_runs = 0;
+        double rate_hz = 0.0;
+    };
+
+    mutable std::mutex mutex_;
+    std::vector<Task> tasks_;
+};
+
+}  // namespace media
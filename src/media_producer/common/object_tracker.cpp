@@ -0,0 +1,237 @@
+/**
+ * @file object_tracker.cpp
+ * @brief 轻量目标跟踪器实现
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-17
+ */
+
+#include "object_tracker.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace media {
+
+// ============================================================================
+// 一维匀速 Kalman 滤波
+// ============================================================================
+
+void ObjectTracker::Axis::Init(float value, float pos_var, float vel_var) {
+    x = value;
+    v = 0.0f;
+    p00 = pos_var;
+    p01 = 0.0f;
+    p11 = vel_var;
+}
+
+void ObjectTracker::Axis::Predict(float dt, float accel_var) {
+    // F = [[1, dt], [0, 1]]，Q = accel_var * [[dt^4/4, dt^3/2], [dt^3/2, dt^2]]
+    const float dt2 = dt * dt;
+    x += v * dt;
+    p00 += dt * (2.0f * p01 + dt * p11) + accel_var * dt2 * dt2 * 0.25f;
+    p01 += dt * p11 + accel_var * dt2 * dt * 0.5f;
+    p11 += accel_var * dt2;
+}
+
+void ObjectTracker::Axis::Correct(float z, float meas_var) {
+    // H = [1, 0]
+    const float s = p00 + meas_var;
+    const float k0 = p00 / s;
+    const float k1 = p01 / s;
+    const float y = z - x;
+    x += k0 * y;
+    v += k1 * y;
+    p11 -= k1 * p01;
+    p01 -= k0 * p01;
+    p00 -= k0 * p00;
+}
+
+// ============================================================================
+// ObjectTracker
+// ============================================================================
+
+ObjectTracker::ObjectTracker(const ObjectTrackerConfig& config)
+    : config_(config) {}
+
+void ObjectTracker::Reset() {
+    tracks_.clear();
+    unstable_ = false;
+    stats_.active_tracks = 0;
+}
+
+ObjectTrackerStats ObjectTracker::GetStats() const {
+    return stats_;
+}
+
+float ObjectTracker::IoU(const rknn::BoundingBox& a, const rknn::BoundingBox& b) {
+    const int x1 = std::max(a.x, b.x);
+    const int y1 = std::max(a.y, b.y);
+    const int x2 = std::min(a.Right(), b.Right());
+    const int y2 = std::min(a.Bottom(), b.Bottom());
+    if (x2 <= x1 || y2 <= y1) {
+        return 0.0f;
+    }
+    const float inter = static_cast<float>(x2 - x1) * static_cast<float>(y2 - y1);
+    const float area_a = static_cast<float>(a.width) * a.height;
+    const float area_b = static_cast<float>(b.width) * b.height;
+    return inter / (area_a + area_b - inter);
+}
+
+float ObjectTracker::Seconds(uint64_t from, uint64_t to) const {
+    if (to <= from) {
+        return 0.0f;
+    }
+    return std::min(static_cast<float>(to - from) * 1e-6f, config_.max_predict_sec);
+}
+
+rknn::BoundingBox ObjectTracker::BoxAt(const Track& track, float dt) const {
+    const float w = std::max(track.w.At(dt), 1.0f);
+    const float h = std::max(track.h.At(dt), 1.0f);
+    rknn::BoundingBox box;
+    box.x = static_cast<int>(std::lround(track.cx.At(dt) - w * 0.5f));
+    box.y = static_cast<int>(std::lround(track.cy.At(dt) - h * 0.5f));
+    box.width = static_cast<int>(std::lround(w));
+    box.height = static_cast<int>(std::lround(h));
+    return box;
+}
+
+void ObjectTracker::StartTrack(rknn::DetectionResult& detection, uint64_t pts_us) {
+    const auto& box = detection.box;
+    const float scale = static_cast<float>(std::max(box.height, 1));
+    const float pos_var = std::pow(config_.measurement_noise * scale, 2.0f);
+    // 新轨迹速度未知：初始速度方差取"一秒走一个框高"
+    const float vel_var = scale * scale;
+
+    Track track;
+    track.id = next_id_++;
+    track.pts = pts_us;
+    track.cx.Init(box.x + box.width * 0.5f, pos_var, vel_var);
+    track.cy.Init(box.y + box.height * 0.5f, pos_var, vel_var);
+    track.w.Init(static_cast<float>(box.width), pos_var, vel_var);
+    track.h.Init(static_cast<float>(box.height), pos_var, vel_var);
+    track.hits = 1;
+    detection.track_id = static_cast<int>(track.id);
+    track.last = detection;
+
+    tracks_.push_back(std::move(track));
+    stats_.tracks_created++;
+}
+
+void ObjectTracker::Update(rknn::DetectionResultList& detections, uint64_t pts_us) {
+    stats_.updates++;
+    auto& dets = detections.results;
+    const size_t num_tracks = tracks_.size();
+    const size_t num_dets = dets.size();
+
+    // 1. 轨迹预测到本帧，计算同类别的 IoU 候选对
+    predicted_.resize(num_tracks);
+    for (size_t t = 0; t < num_tracks; ++t) {
+        predicted_[t] = BoxAt(tracks_[t], Seconds(tracks_[t].pts, pts_us));
+    }
+
+    pairs_.clear();
+    for (size_t t = 0; t < num_tracks; ++t) {
+        for (size_t d = 0; d < num_dets; ++d) {
+            if (dets[d].class_id != tracks_[t].last.class_id) continue;
+            const float iou = IoU(predicted_[t], dets[d].box);
+            if (iou >= config_.iou_threshold) {
+                pairs_.push_back({iou, static_cast<uint16_t>(t), static_cast<uint16_t>(d)});
+            }
+        }
+    }
+
+    // 2. 贪心关联：IoU 从高到低，一对一（目标数很少，匈牙利算法不划算）
+    std::sort(pairs_.begin(), pairs_.end(),
+              [](const Pair& a, const Pair& b) { return a.iou > b.iou; });
+    track_matched_.assign(num_tracks, 0);
+    detection_matched_.assign(num_dets, 0);
+
+    bool unstable = false;
+    for (const auto& pair : pairs_) {
+        if (track_matched_[pair.track] || detection_matched_[pair.detection]) continue;
+        track_matched_[pair.track] = 1;
+        detection_matched_[pair.detection] = 1;
+
+        Track& track = tracks_[pair.track];
+        auto& det = dets[pair.detection];
+        const auto& box = det.box;
+        const float scale = static_cast<float>(std::max(box.height, 1));
+        const float meas_var = std::pow(config_.measurement_noise * scale, 2.0f);
+        const float accel_var = std::pow(config_.acceleration_noise * scale, 2.0f);
+        const float dt = Seconds(track.pts, pts_us);
+
+        for (Axis* axis : {&track.cx, &track.cy, &track.w, &track.h}) {
+            axis->Predict(dt, accel_var);
+        }
+        track.cx.Correct(box.x + box.width * 0.5f, meas_var);
+        track.cy.Correct(box.y + box.height * 0.5f, meas_var);
+        track.w.Correct(static_cast<float>(box.width), meas_var);
+        track.h.Correct(static_cast<float>(box.height), meas_var);
+
+        track.pts = pts_us;
+        track.hits++;
+        track.misses = 0;
+        det.track_id = static_cast<int>(track.id);
+        track.last = det;
+
+        if (track.hits < config_.confirm_hits || pair.iou < config_.stable_iou) {
+            unstable = true;
+        }
+    }
+
+    // 3. 未匹配的轨迹记漏检，超限删除
+    size_t keep = 0;
+    for (size_t t = 0; t < num_tracks; ++t) {
+        Track& track = tracks_[t];
+        if (!track_matched_[t]) {
+            track.hits = 0;
+            if (++track.misses > config_.max_misses) continue;
+            unstable = true;
+        }
+        if (keep != t) {
+            tracks_[keep] = std::move(track);
+        }
+        keep++;
+    }
+    tracks_.resize(keep);
+
+    // 4. 未匹配的检测新建轨迹
+    for (size_t d = 0; d < num_dets; ++d) {
+        if (!detection_matched_[d]) {
+            StartTrack(dets[d], pts_us);
+            unstable = unstable || config_.confirm_hits > 1;
+        }
+    }
+
+    unstable_ = unstable;
+    stats_.active_tracks = tracks_.size();
+}
+
+void ObjectTracker::Predict(uint64_t pts_us, rknn::DetectionResultList* out) {
+    stats_.predictions++;
+    auto& results = out->results;
+    results.clear();
+
+    for (const auto& track : tracks_) {
+        if (track.misses > 0) continue;
+
+        const float dt = Seconds(track.pts, pts_us);
+        rknn::DetectionResult det = track.last;
+        det.box = BoxAt(track, dt);
+
+        // 关键点随框平移、缩放
+        if (!det.landmarks.empty()) {
+            const auto& from = track.last.box;
+            const float sx = static_cast<float>(det.box.width) / std::max(from.width, 1);
+            const float sy = static_cast<float>(det.box.height) / std::max(from.height, 1);
+            for (auto& lm : det.landmarks) {
+                lm.x = det.box.x + static_cast<int>(std::lround((lm.x - from.x) * sx));
+                lm.y = det.box.y + static_cast<int>(std::lround((lm.y - from.y) * sy));
+            }
+        }
+        results.push_back(std::move(det));
+    }
+}
+
+}  // namespace media
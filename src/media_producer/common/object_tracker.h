@@ -0,0 +1,141 @@
+/**
+ * @file object_tracker.h
+ * @brief 轻量目标跟踪器 - IoU 关联 + 匀速 Kalman 预测，让 NPU 隔帧推理
+ *
+ * 插在模型 GetResults() 与 OSD / 元数据输出之间：
+ * - 推理帧：Update() 把检测结果按 IoU 贪心关联到已有轨迹（同类别），
+ *   用检测框校正轨迹的 Kalman 状态；未匹配的检测新建轨迹，连续漏检的轨迹删除。
+ *   输出就是本次检测结果（附带轨迹 ID），推理帧的框与不跟踪时完全一致
+ * - 跳过帧：Predict() 按采集 PTS 把轨迹外推到当前帧，输出预测框，
+ *   画面上的框随目标移动而不是停在上一次推理的位置
+ *
+ * 状态：框中心 (cx, cy) 与宽高 (w, h) 各自一个 [位置, 速度] 二维 Kalman 滤波
+ * （匀速模型，白噪声加速度），四个量解耦，每条轨迹只有十几次乘加。
+ * 噪声按框高缩放：大目标的像素抖动本来就大。
+ *
+ * 稳定性（供自适应推理间隔使用）：存在未确认的新轨迹、刚漏检的轨迹，
+ * 或上次校正时预测框与检测框 IoU 偏低（目标在加速 / 转向）时视为不稳定，
+ * 调用方应尽快再推理一次。
+ *
+ * 坐标系由调用方决定（YOLO 生产者使用模型输入坐标，映射在输出后进行），
+ * 跟踪器只要求同一坐标系内连续。
+ *
+ * @note 非线程安全：只在推理线程使用
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-17
+ */
+
+#pragma once
+
+#include "ai_types.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace media {
+
+/**
+ * @brief 跟踪器参数
+ */
+struct ObjectTrackerConfig {
+    float iou_threshold = 0.3f;         ///< 检测与预测框关联所需的最小 IoU
+    int confirm_hits = 3;               ///< 连续命中多少次后轨迹视为稳定
+    int max_misses = 2;                 ///< 连续漏检超过该次数删除轨迹
+    float stable_iou = 0.5f;            ///< 校正时预测框与检测框 IoU 低于该值视为不稳定
+    float measurement_noise = 0.05f;    ///< 检测框观测噪声（标准差，占框高比例）
+    float acceleration_noise = 2.0f;    ///< 过程噪声（加速度标准差，框高 / 秒²）
+    float max_predict_sec = 1.0f;       ///< 外推时长上限，超过后轨迹停在原地
+};
+
+/**
+ * @brief 跟踪统计（由调用方按需汇总到生产者统计）
+ */
+struct ObjectTrackerStats {
+    uint64_t updates = 0;               ///< Update() 次数（推理帧）
+    uint64_t predictions = 0;           ///< Predict() 次数（跳过帧）
+    uint64_t tracks_created = 0;        ///< 累计新建轨迹数
+    size_t active_tracks = 0;           ///< 当前轨迹数
+};
+
+class ObjectTracker {
+public:
+    explicit ObjectTracker(const ObjectTrackerConfig& config = ObjectTrackerConfig());
+
+    /**
+     * @brief 推理帧：用检测结果校正轨迹
+     *
+     * @param detections 本帧检测结果（会被写入 track_id）
+     * @param pts_us     来源帧采集 PTS（微秒）
+     */
+    void Update(rknn::DetectionResultList& detections, uint64_t pts_us);
+
+    /**
+     * @brief 跳过帧：输出外推到 pts_us 的轨迹框
+     *
+     * 只输出上一次推理命中的轨迹（漏检中的轨迹不显示，避免框停在目标离开的位置）。
+     * 轨迹状态本身不前移，下一次 Update() 仍从校正点按实际间隔预测。
+     */
+    void Predict(uint64_t pts_us, rknn::DetectionResultList* out);
+
+    /**
+     * @brief 轨迹是否不稳定（应尽快再推理一次）
+     */
+    bool Unstable() const { return unstable_; }
+
+    /**
+     * @brief 清空轨迹（模式切换 / 重启时调用）
+     */
+    void Reset();
+
+    ObjectTrackerStats GetStats() const;
+
+private:
+    /// 一维匀速 Kalman 滤波：状态 [x, v]，协方差 [[p00, p01], [p01, p11]]
+    struct Axis {
+        float x = 0.0f;
+        float v = 0.0f;
+        float p00 = 0.0f;
+        float p01 = 0.0f;
+        float p11 = 0.0f;
+
+        void Init(float value, float pos_var, float vel_var);
+        void Predict(float dt, float accel_var);
+        void Correct(float z, float meas_var);
+        float At(float dt) const { return x + v * dt; }
+    };
+
+    struct Track {
+        uint32_t id = 0;
+        uint64_t pts = 0;           ///< 最近一次校正的采集 PTS
+        Axis cx, cy, w, h;
+        int hits = 0;               ///< 连续命中次数
+        int misses = 0;             ///< 连续漏检次数
+        rknn::DetectionResult last; ///< 最近一次命中的检测（类别、置信度、关键点）
+    };
+
+    static float IoU(const rknn::BoundingBox& a, const rknn::BoundingBox& b);
+    float Seconds(uint64_t from, uint64_t to) const;
+    rknn::BoundingBox BoxAt(const Track& track, float dt) const;
+    void StartTrack(rknn::DetectionResult& detection, uint64_t pts_us);
+
+    ObjectTrackerConfig config_;
+    std::vector<Track> tracks_;
+    uint32_t next_id_ = 1;
+    bool unstable_ = false;
+
+    // 关联用的复用缓冲（Update 每次清空，不重新分配）
+    struct Pair {
+        float iou;
+        uint16_t track;
+        uint16_t detection;
+    };
+    std::vector<Pair> pairs_;
+    std::vector<rknn::BoundingBox> predicted_;
+    std::vector<uint8_t> track_matched_;
+    std::vector<uint8_t> detection_matched_;
+
+    ObjectTrackerStats stats_;
+};
+
+}  // namespace media
@@ -32,17 +32,22 @@ bool OSDOverlay::Init(int vencChn, const OSDConfig& config) {
     venc_chn_ = vencChn;
     config_ = config;
     
-    // 预分配 bitmap 缓冲区（corner_size x corner_size ARGB8888）
-    int bufferSize = config_.corner_size * config_.corner_size;
-    bitmap_buffer_.resize(bufferSize);
+    // 确保 corner_size 是偶数
+    corner_size_ = config_.corner_size & ~1;
+    if (corner_size_ < 4) corner_size_ = 4;
     
-    // 计算最大 RGN 数量：每个框 4 个角，最多 max_boxes 个框
-    int maxHandles = config_.max_boxes * 4;
-    active_handles_.reserve(maxHandles);
+    // 常驻 handle 池：每个框 4 个角，最多 max_boxes 个框（首次使用时创建）
+    corners_.assign(config_.max_boxes * 4, CornerState());
+    bitmap_cache_.clear();
+    
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_ = OSDStats();
+    }
     
     initialized_ = true;
     LOG_INFO("OSD initialized: venc_chn={}, max_boxes={}, corner_size={}", 
-             vencChn, config_.max_boxes, config_.corner_size);
+             vencChn, config_.max_boxes, corner_size_);
     
     return true;
 }
@@ -53,6 +58,7 @@ void OSDOverlay::Deinit() {
     }
     
     DestroyAllRGN();
+    bitmap_cache_.clear();
     initialized_ = false;
     
     LOG_INFO("OSD deinitialized");
@@ -63,78 +69,47 @@ void OSDOverlay::UpdateBoxes(const std::vector<OSDBox>& boxes) {
         return;
     }
     
-    // 先清除旧的 RGN
-    DestroyAllRGN();
+    OSDUpdateCounts counts;
     
     // 限制最大框数
     size_t numBoxes = std::min(boxes.size(), static_cast<size_t>(config_.max_boxes));
     
-    if (numBoxes == 0) {
-        return;
-    }
-    
-    // 为每个框创建 4 个角标记
     for (size_t i = 0; i < numBoxes; ++i) {
-        const auto& box = boxes[i];
-        uint32_t color = box.color ? box.color : config_.default_color;
-        
-        // RGN 要求坐标必须是 2 的倍数（2像素对齐）
-        // 对坐标进行对齐处理
-        int aligned_x = box.x & ~1;  // 向下对齐到偶数
-        int aligned_y = box.y & ~1;
-        int aligned_right = (box.x + box.width) & ~1;
-        int aligned_bottom = (box.y + box.height) & ~1;
-        
-        // 确保 corner_size 也是偶数
-        int corner_size = config_.corner_size & ~1;
-        if (corner_size < 4) corner_size = 4;
+        OSDBox box = NormalizeBox(boxes[i]);
+        int right = box.x + box.width;
+        int bottom = box.y + box.height;
         
         // 四个角的位置
         // 0: 左上, 1: 右上, 2: 左下, 3: 右下
         struct {
-            int x, y, type;
-        } corners[4] = {
-            { aligned_x, aligned_y, 0 },                                   // 左上
-            { aligned_right - corner_size, aligned_y, 1 },                 // 右上
-            { aligned_x, aligned_bottom - corner_size, 2 },                // 左下
-            { aligned_right - corner_size, aligned_bottom - corner_size, 3 } // 右下
+            int x, y;
+        } pos[4] = {
+            { box.x, box.y },                                   // 左上
+            { right - corner_size_, box.y },                    // 右上
+            { box.x, bottom - corner_size_ },                   // 左下
+            { right - corner_size_, bottom - corner_size_ }     // 右下
         };
         
         for (int c = 0; c < 4; ++c) {
-            // 再次确保坐标对齐（处理边界情况）
-            int pos_x = corners[c].x & ~1;
-            int pos_y = corners[c].y & ~1;
-            
-            // 确保坐标非负
-            if (pos_x < 0) pos_x = 0;
-            if (pos_y < 0) pos_y = 0;
-            
-            int handle = next_handle_++;
-            
-            // 填充角标记 bitmap（使用对齐后的尺寸）
-            FillCornerBitmap(bitmap_buffer_.data(), corner_size, corners[c].type, color);
-            
-            // 创建并配置 RGN（使用对齐后的坐标和尺寸）
-            if (CreateCornerRGN(handle, pos_x, pos_y, corner_size)) {
-                // 设置 bitmap
-                BITMAP_S stBitmap;
-                memset(&stBitmap, 0, sizeof(stBitmap));
-                stBitmap.enPixelFormat = RK_FMT_ARGB8888;
-                stBitmap.u32Width = corner_size;
-                stBitmap.u32Height = corner_size;
-                stBitmap.pData = bitmap_buffer_.data();
-                
-                RK_S32 ret = RK_MPI_RGN_SetBitMap(handle, &stBitmap);
-                if (ret != RK_SUCCESS) {
-                    LOG_WARN("RK_MPI_RGN_SetBitMap failed: handle={}, ret={:#x}", handle, ret);
-                }
-                
-                active_handles_.push_back(handle);
-            }
+            // 再次确保坐标对齐且非负（处理边界情况）
+            int x = std::max(0, pos[c].x & ~1);
+            int y = std::max(0, pos[c].y & ~1);
+            PlaceCorner(static_cast<int>(i) * 4 + c, x, y, c, box.color, counts);
         }
     }
     
-    LOG_DEBUG("OSD updated: {} boxes, {} RGN handles", numBoxes, active_handles_.size());
+    // 本次未使用的 handle：隐藏而不销毁，下次直接复用
+    for (size_t h = numBoxes * 4; h < corners_.size(); ++h) {
+        HideCorner(static_cast<int>(h), counts);
+    }
+    
+    RecordUpdate(counts);
+    
+    if (counts.Total() > 0) {
+        LOG_DEBUG("OSD updated: {} boxes, mpi calls={} (create={}, bitmap={}, move={}, hide={})",
+                  numBoxes, counts.Total(), counts.create, counts.set_bitmap,
+                  counts.move, counts.hide);
+    }
 }
 
 void OSDOverlay::Clear() {
@@ -142,10 +117,88 @@ void OSDOverlay::Clear() {
         return;
     }
     
-    DestroyAllRGN();
+    OSDUpdateCounts counts;
+    for (size_t h = 0; h < corners_.size(); ++h) {
+        HideCorner(static_cast<int>(h), counts);
+    }
+    RecordUpdate(counts);
     LOG_DEBUG("OSD cleared");
 }
 
+OSDStats OSDOverlay::GetStats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return stats_;
+}
+
+OSDBox OSDOverlay::NormalizeBox(const OSDBox& box) const {
+    OSDBox out = box;
+    out.color = box.color ? box.color : config_.default_color;
+    
+    // RGN 要求坐标必须是 2 的倍数（2像素对齐）
+    // 对坐标进行对齐处理
+    int aligned_x = box.x & ~1;  // 向下对齐到偶数
+    int aligned_y = box.y & ~1;
+    int aligned_right = (box.x + box.width) & ~1;
+    int aligned_bottom = (box.y + box.height) & ~1;
+    
+    out.x = aligned_x;
+    out.y = aligned_y;
+    out.width = aligned_right - aligned_x;
+    out.height = aligned_bottom - aligned_y;
+    return out;
+}
+
+void OSDOverlay::PlaceCorner(int handle, int x, int y, int cornerType, uint32_t color,
+                             OSDUpdateCounts& counts) {
+    auto& corner = corners_[handle];
+    
+    if (!corner.created) {
+        // 首次使用：创建 + 附加（直接显示在目标位置）+ 设置 bitmap
+        if (!CreateCornerRGN(handle, x, y, corner_size_)) {
+            return;
+        }
+        counts.create++;
+        corner.created = true;
+        corner.shown = true;
+        corner.x = x;
+        corner.y = y;
+        
+        if (SetCornerBitmap(handle, cornerType, color)) {
+            corner.color = color;
+        }
+        counts.set_bitmap++;
+        return;
+    }
+    
+    if (corner.color != color) {
+        if (SetCornerBitmap(handle, cornerType, color)) {
+            corner.color = color;
+        }
+        counts.set_bitmap++;
+    }
+    
+    if (!corner.shown || corner.x != x || corner.y != y) {
+        if (SetCornerDisplay(handle, x, y, true)) {
+            corner.shown = true;
+            corner.x = x;
+            corner.y = y;
+        }
+        counts.move++;
+    }
+}
+
+void OSDOverlay::HideCorner(int handle, OSDUpdateCounts& counts) {
+    auto& corner = corners_[handle];
+    if (!corner.created || !corner.shown) {
+        return;
+    }
+    
+    if (SetCornerDisplay(handle, corner.x, corner.y, false)) {
+        corner.shown = false;
+    }
+    counts.hide++;
+}
+
 bool OSDOverlay::CreateCornerRGN(int handle, int x, int y, int size) {
     // 创建 OVERLAY 类型的 RGN
     RGN_ATTR_S stRgnAttr;
@@ -188,6 +241,68 @@ bool OSDOverlay::CreateCornerRGN(int handle, int x, int y, int size) {
     return true;
 }
 
+bool OSDOverlay::SetCornerDisplay(int handle, int x, int y, bool show) {
+    MPP_CHN_S stMppChn;
+    memset(&stMppChn, 0, sizeof(stMppChn));
+    stMppChn.enModId = RK_ID_VENC;
+    stMppChn.s32DevId = 0;
+    stMppChn.s32ChnId = venc_chn_;
+    
+    RGN_CHN_ATTR_S stChnAttr;
+    memset(&stChnAttr, 0, sizeof(stChnAttr));
+    stChnAttr.bShow = show ? RK_TRUE : RK_FALSE;
+    stChnAttr.enType = OVERLAY_RGN;
+    stChnAttr.unChnAttr.stOverlayChn.stPoint.s32X = x;
+    stChnAttr.unChnAttr.stOverlayChn.stPoint.s32Y = y;
+    stChnAttr.unChnAttr.stOverlayChn.u32BgAlpha = 0;
+    stChnAttr.unChnAttr.stOverlayChn.u32FgAlpha = 255;
+    stChnAttr.unChnAttr.stOverlayChn.u32Layer = 0;
+    
+    RK_S32 ret = RK_MPI_RGN_SetDisplayAttr(handle, &stMppChn, &stChnAttr);
+    if (ret != RK_SUCCESS) {
+        LOG_WARN("RK_MPI_RGN_SetDisplayAttr failed: handle={}, ret={:#x}", handle, ret);
+        return false;
+    }
+    return true;
+}
+
+bool OSDOverlay::SetCornerBitmap(int handle, int cornerType, uint32_t color) {
+    const auto& bitmap = GetCornerBitmap(cornerType, color);
+    
+    BITMAP_S stBitmap;
+    memset(&stBitmap, 0, sizeof(stBitmap));
+    stBitmap.enPixelFormat = RK_FMT_ARGB8888;
+    stBitmap.u32Width = corner_size_;
+    stBitmap.u32Height = corner_size_;
+    stBitmap.pData = const_cast<uint32_t*>(bitmap.data());
+    
+    RK_S32 ret = RK_MPI_RGN_SetBitMap(handle, &stBitmap);
+    if (ret != RK_SUCCESS) {
+        LOG_WARN("RK_MPI_RGN_SetBitMap failed: handle={}, ret={:#x}", handle, ret);
+        return false;
+    }
+    return true;
+}
+
+const std::vector<uint32_t>& OSDOverlay::GetCornerBitmap(int cornerType, uint32_t color) {
+    uint64_t key = (static_cast<uint64_t>(color) << 2) | static_cast<uint64_t>(cornerType & 3);
+    
+    auto it = bitmap_cache_.find(key);
+    if (it != bitmap_cache_.end()) {
+        return it->second;
+    }
+    
+    // 颜色数量有限（按类别着色），缓存过大时整体丢弃重建
+    if (bitmap_cache_.size() >= 256) {
+        bitmap_cache_.clear();
+    }
+    
+    auto& bitmap = bitmap_cache_[key];
+    bitmap.resize(corner_size_ * corner_size_);
+    FillCornerBitmap(bitmap.data(), corner_size_, cornerType, color);
+    return bitmap;
+}
+
 void OSDOverlay::DestroyAllRGN() {
     MPP_CHN_S stMppChn;
     memset(&stMppChn, 0, sizeof(stMppChn));
@@ -195,12 +310,30 @@ void OSDOverlay::DestroyAllRGN() {
     stMppChn.s32DevId = 0;
     stMppChn.s32ChnId = venc_chn_;
     
-    for (int handle : active_handles_) {
-        RK_MPI_RGN_DetachFromChn(handle, &stMppChn);
-        RK_MPI_RGN_Destroy(handle);
+    for (size_t h = 0; h < corners_.size(); ++h) {
+        if (!corners_[h].created) {
+            continue;
+        }
+        RK_MPI_RGN_DetachFromChn(static_cast<int>(h), &stMppChn);
+        RK_MPI_RGN_Destroy(static_cast<int>(h));
+        corners_[h] = CornerState();
+    }
+}
+
+void OSDOverlay::RecordUpdate(const OSDUpdateCounts& counts) {
+    int created = 0;
+    int visible = 0;
+    for (const auto& corner : corners_) {
+        created += corner.created ? 1 : 0;
+        visible += corner.shown ? 1 : 0;
     }
     
-    active_handles_.clear();
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.updates++;
+    stats_.total_mpi_calls += counts.Total();
+    stats_.last = counts;
+    stats_.handles_created = created;
+    stats_.handles_visible = visible;
 }
 
 void OSDOverlay::FillCornerBitmap(uint32_t* buffer, int size, int cornerType, uint32_t color) {
@@ -258,3 +391,7 @@ void osd_update_boxes(const std::vector<OSDBox>& boxes) {
 void osd_clear() {
     g_osd.Clear();
 }
+
+OSDStats osd_get_stats() {
+    return g_osd.GetStats();
+}
@@ -20,6 +20,8 @@
 
 #include <vector>
 #include <cstdint>
+#include <mutex>
+#include <unordered_map>
 
 // ============================================================================
 // 检测框结构
@@ -46,6 +48,30 @@ struct OSDConfig {
     uint32_t default_color = 0x00FF00FF;  // 默认颜色：绿色不透明
 };
 
+// ============================================================================
+// OSD 统计
+// ============================================================================
+
+/**
+ * @brief 每次 UpdateBoxes 的 RGN MPI 调用计数（用于验证增量更新的收益）
+ */
+struct OSDUpdateCounts {
+    uint32_t create = 0;        // RK_MPI_RGN_Create + AttachToChn
+    uint32_t set_bitmap = 0;    // RK_MPI_RGN_SetBitMap
+    uint32_t move = 0;          // RK_MPI_RGN_SetDisplayAttr（位置变化或重新显示）
+    uint32_t hide = 0;          // RK_MPI_RGN_SetDisplayAttr（隐藏闲置 handle）
+
+    uint32_t Total() const { return create * 2 + set_bitmap + move + hide; }
+};
+
+struct OSDStats {
+    uint64_t updates = 0;           // UpdateBoxes 调用次数
+    uint64_t total_mpi_calls = 0;   // 累计 MPI 调用次数
+    OSDUpdateCounts last;           // 最近一次更新的调用明细
+    int handles_created = 0;        // 当前已创建（常驻）的 handle 数
+    int handles_visible = 0;        // 当前显示中的 handle 数
+};
+
 // ============================================================================
 // OSD Overlay 类
 // ============================================================================
@@ -69,44 +95,85 @@ public:
     /**
      * @brief 更新检测框显示
      * 
-     * 清除旧的检测框，显示新的检测框列表
+     * handle 常驻复用：每个框槽位固定 4 个角标记 handle，首次使用时创建，
+     * 之后只对坐标变化的角调用 SetDisplayAttr 移动、颜色变化的角换 bitmap，
+     * 未使用的 handle 隐藏而不销毁。未变化的框不产生任何 MPI 调用。
      * 
      * @param boxes 检测框列表
      */
     void UpdateBoxes(const std::vector<OSDBox>& boxes);
     
     /**
-     * @brief 清除所有检测框
+     * @brief 清除所有检测框（隐藏全部 handle，不销毁）
      */
     void Clear();
     
+    /**
+     * @brief 获取 RGN 调用统计
+     */
+    OSDStats GetStats() const;
+    
     /**
      * @brief 检查是否已初始化
      */
     bool IsInitialized() const { return initialized_; }
 
 private:
+    // 单个角标记 handle 的常驻状态（handle 号 = 槽位 * 4 + 角类型）
+    struct CornerState {
+        bool created = false;
+        bool shown = false;
+        int x = 0;
+        int y = 0;
+        uint32_t color = 0;
+    };
+
+    // 对齐坐标（RGN 要求 2 像素对齐）并填充默认颜色
+    OSDBox NormalizeBox(const OSDBox& box) const;
+    
+    // 将一个角标记放到指定位置/颜色（按需创建、换图、移动）
+    void PlaceCorner(int handle, int x, int y, int cornerType, uint32_t color,
+                     OSDUpdateCounts& counts);
+    
+    // 隐藏一个角标记
+    void HideCorner(int handle, OSDUpdateCounts& counts);
+    
     // 创建一个角标记 RGN
     bool CreateCornerRGN(int handle, int x, int y, int size);
     
+    // 设置角标记显示属性（位置 + 显隐）
+    bool SetCornerDisplay(int handle, int x, int y, bool show);
+    
+    // 设置角标记 bitmap
+    bool SetCornerBitmap(int handle, int cornerType, uint32_t color);
+    
+    // 获取（必要时生成）缓存的角标记 bitmap
+    const std::vector<uint32_t>& GetCornerBitmap(int cornerType, uint32_t color);
+    
     // 销毁所有 RGN
     void DestroyAllRGN();
     
     // 填充角标记 bitmap
     void FillCornerBitmap(uint32_t* buffer, int size, int cornerType, uint32_t color);
 
+    // 记录一次更新的调用统计
+    void RecordUpdate(const OSDUpdateCounts& counts);
+
 private:
     bool initialized_ = false;
     int venc_chn_ = 0;
     OSDConfig config_;
+    int corner_size_ = 0;
+    
+    // 常驻 handle 池（max_boxes * 4）
+    std::vector<CornerState> corners_;
     
-    // 当前活动的 RGN handles
-    // 每个检测框使用 4 个 RGN（四个角）
-    std::vector<int> active_handles_;
-    int next_handle_ = 0;
+    // bitmap 缓存：key = (color << 2) | cornerType
+    std::unordered_map<uint64_t, std::vector<uint32_t>> bitmap_cache_;
     
-    // 预分配的 bitmap 缓冲区
-    std::vector<uint32_t> bitmap_buffer_;
+    // 统计（推理线程更新，HTTP 线程读取）
+    mutable std::mutex stats_mutex_;
+    OSDStats stats_;
 };
 
 // ============================================================================
@@ -132,3 +199,8 @@ void osd_update_boxes(const std::vector<OSDBox>& boxes);
  * @brief 清除所有检测框
  */
 void osd_clear();
+
+/**
+ * @brief 获取全局 OSD 实例的 RGN 调用统计
+ */
+OSDStats osd_get_stats();
@@ -0,0 +1,245 @@
+/**
+ * @file smart_encoder.cpp
+ * @brief 检测驱动编码实现
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-17
+ */
+
+#define LOG_TAG "SmartEnc"
+
+#include "smart_encoder.h"
+#include "venc_codec.h"
+#include "common/logger.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "rk_mpi_venc.h"
+
+namespace media {
+
+namespace {
+
+/// ROI 区域对齐粒度（H.264 宏块；H.265 编码器内部按 CTU 再取整）
+constexpr int kRoiAlign = 16;
+
+int AlignDown(int v) { return v / kRoiAlign * kRoiAlign; }
+int AlignUp(int v) { return (v + kRoiAlign - 1) / kRoiAlign * kRoiAlign; }
+
+}  // namespace
+
+// ============================================================================
+// 配置
+// ============================================================================
+
+void SmartEncoder::Configure(const SmartEncodeConfig& config, int venc_chn, int frame_width,
+                             int frame_height) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+    config_.roi_max = std::clamp(config_.roi_max, 0, kMaxRoiRegions);
+    config_.idle_bitrate_percent = std::clamp(config_.idle_bitrate_percent, 1, 100);
+    venc_chn_ = venc_chn;
+    frame_width_ = frame_width;
+    frame_height_ = frame_height;
+    idle_ = false;
+    last_detection_ = Clock::now();
+    roi_applied_.fill(Rect());
+
+    RK_U32 kbps = 0;
+    RK_U32 fps = 0;
+    if (venc_get_rate(venc_chn, &kbps, &fps) != RK_SUCCESS) {
+        LOG_WARN("VENC chn{} rate control not readable, smart rate disabled", venc_chn);
+        config_.smart_rate = false;
+    }
+    full_bitrate_kbps_ = static_cast<int>(kbps);
+    full_fps_ = static_cast<int>(fps);
+
+    stats_ = SmartEncodeStats();
+    stats_.roi = config_.roi;
+    stats_.smart_rate = config_.smart_rate;
+    stats_.bitrate_kbps = full_bitrate_kbps_;
+    stats_.fps = full_fps_;
+
+    if (config_.roi) {
+        LOG_INFO("Detection ROI enabled: chn{}, up to {} regions, qp {:+d}", venc_chn,
+                 config_.roi_max, config_.roi_qp);
+    }
+    if (config_.smart_rate) {
+        LOG_INFO("Smart rate enabled: {}kbps@{}fps, idle {}%@{}fps after {}ms",
+                 full_bitrate_kbps_, full_fps_, config_.idle_bitrate_percent,
+                 config_.idle_fps > 0 ? config_.idle_fps : full_fps_, config_.idle_delay_ms);
+    }
+}
+
+int SmartEncoder::SetBitrate(int kbps) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (venc_chn_ < 0 || kbps <= 0) {
+        return -1;
+    }
+    full_bitrate_kbps_ = kbps;
+    return ApplyRate();
+}
+
+int SmartEncoder::SetFrameRate(int fps) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // 码控参数不可读时没有满码率基准，不能整体改写
+    if (venc_chn_ < 0 || fps <= 0 || full_bitrate_kbps_ <= 0) {
+        return -1;
+    }
+    full_fps_ = fps;
+    return ApplyRate();
+}
+
+void SmartEncoder::Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (venc_chn_ < 0) {
+        return;
+    }
+    for (int i = 0; i < kMaxRoiRegions; ++i) {
+        SetRoiRegion(i, Rect());
+    }
+    stats_.roi_regions = 0;
+    if (idle_) {
+        idle_ = false;
+        ApplyRate();
+    }
+    last_detection_ = Clock::now();
+}
+
+SmartEncodeStats SmartEncoder::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+// ============================================================================
+// 检测结果 -> ROI / 码控
+// ============================================================================
+
+void SmartEncoder::OnDetections(const rknn::DetectionResultList& results) {
+    if (!config_.Enabled()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (venc_chn_ < 0) {
+        return;
+    }
+
+    if (config_.roi) {
+        UpdateRoi(results);
+    }
+
+    if (config_.smart_rate) {
+        const auto now = Clock::now();
+        if (results.Count() > 0) {
+            last_detection_ = now;
+            if (idle_) {
+                idle_ = false;
+                ApplyRate();
+                LOG_DEBUG("Detections resumed, VENC back to {}kbps@{}fps",
+                          full_bitrate_kbps_, full_fps_);
+            }
+        } else if (!idle_ && now - last_detection_ >=
+                                 std::chrono::milliseconds(config_.idle_delay_ms)) {
+            idle_ = true;
+            stats_.idle_transitions++;
+            ApplyRate();
+            LOG_DEBUG("Scene idle, VENC down to {}kbps@{}fps", stats_.bitrate_kbps, stats_.fps);
+        }
+    }
+}
+
+int SmartEncoder::ApplyRate() {
+    int kbps = full_bitrate_kbps_;
+    int fps = full_fps_;
+    if (idle_) {
+        kbps = std::max(1, full_bitrate_kbps_ * config_.idle_bitrate_percent / 100);
+        if (config_.idle_fps > 0) {
+            fps = std::min(fps, config_.idle_fps);
+        }
+    }
+
+    RK_S32 ret = venc_set_rate(venc_chn_, static_cast<RK_U32>(kbps), static_cast<RK_U32>(fps));
+    if (ret != RK_SUCCESS) {
+        LOG_WARN_THROTTLED(5000, "VENC chn{} set rate {}kbps@{}fps failed: {:#x}",
+                           venc_chn_, kbps, fps, ret);
+        return -1;
+    }
+    stats_.idle = idle_;
+    stats_.bitrate_kbps = kbps;
+    stats_.fps = fps;
+    return 0;
+}
+
+SmartEncoder::Rect SmartEncoder::AlignedRect(const rknn::BoundingBox& box) const {
+    const int mx = static_cast<int>(box.width * config_.roi_margin);
+    const int my = static_cast<int>(box.height * config_.roi_margin);
+    const int x1 = AlignDown(std::max(box.x - mx, 0));
+    const int y1 = AlignDown(std::max(box.y - my, 0));
+    const int x2 = std::min(AlignUp(box.Right() + mx), AlignDown(frame_width_));
+    const int y2 = std::min(AlignUp(box.Bottom() + my), AlignDown(frame_height_));
+
+    Rect rect;
+    if (x2 > x1 && y2 > y1) {
+        rect.x = x1;
+        rect.y = y1;
+        rect.width = x2 - x1;
+        rect.height = y2 - y1;
+    }
+    return rect;
+}
+
+void SmartEncoder::UpdateRoi(const rknn::DetectionResultList& results) {
+    // 面积最大的 roi_max 个目标（近处的人脸 / 人体最值得保清晰）
+    const auto& dets = results.results;
+    order_.resize(dets.size());
+    for (size_t i = 0; i < dets.size(); ++i) {
+        order_[i] = i;
+    }
+    const size_t count = std::min(dets.size(), static_cast<size_t>(config_.roi_max));
+    std::partial_sort(order_.begin(), order_.begin() + count, order_.end(),
+                      [&](size_t a, size_t b) {
+                          return dets[a].box.width * dets[a].box.height >
+                                 dets[b].box.width * dets[b].box.height;
+                      });
+
+    int regions = 0;
+    for (int i = 0; i < config_.roi_max; ++i) {
+        Rect rect;
+        if (static_cast<size_t>(i) < count) {
+            rect = AlignedRect(dets[order_[i]].box);
+        }
+        SetRoiRegion(i, rect);
+        regions += rect.Empty() ? 0 : 1;
+    }
+    stats_.roi_regions = regions;
+}
+
+void SmartEncoder::SetRoiRegion(int index, const Rect& rect) {
+    Rect& applied = roi_applied_[index];
+    if (applied == rect || (applied.Empty() && rect.Empty())) {
+        return;
+    }
+
+    VENC_ROI_ATTR_S roi;
+    memset(&roi, 0, sizeof(roi));
+    roi.u32Index = static_cast<RK_U32>(index);
+    roi.bEnable = rect.Empty() ? RK_FALSE : RK_TRUE;
+    roi.bAbsQp = RK_FALSE;
+    roi.s32Qp = config_.roi_qp;
+    roi.bIntra = RK_FALSE;
+    roi.stRect.s32X = rect.x;
+    roi.stRect.s32Y = rect.y;
+    roi.stRect.u32Width = static_cast<RK_U32>(rect.width);
+    roi.stRect.u32Height = static_cast<RK_U32>(rect.height);
+
+    stats_.roi_updates++;
+    RK_S32 ret = RK_MPI_VENC_SetRoiAttr(venc_chn_, &roi);
+    if (ret != RK_SUCCESS) {
+        LOG_WARN_THROTTLED(5000, "VENC chn{} SetRoiAttr[{}] failed: {:#x}", venc_chn_, index, ret);
+        return;
+    }
+    applied = rect;
+}
+
+}  // namespace media
@@ -0,0 +1,154 @@
+/**
+ * @file smart_encoder.h
+ * @brief 检测驱动编码 - 检测框作为 VENC ROI，静止场景自动降码率 / 帧率
+ *
+ * AI 生产者每次发布检测结果（坐标已映射到主码流）后交给 SmartEncoder：
+ * - ROI：按面积取最大的若干个目标，外扩并对齐到宏块后写入 VENC ROI
+ *   （RK_MPI_VENC_SetRoiAttr，相对 QP 为负），码控在总码率不变的前提下
+ *   把比特让给人脸 / 人体，背景 QP 相应抬高。区域对齐后未变化时不调用 MPI
+ * - 智能码控：最后一次检测之后 idle_delay_ms 内无目标，进入静止状态，
+ *   目标码率降到 idle_bitrate_percent，输出帧率降到 idle_fps；
+ *   一旦出现检测立即恢复满码率、满帧率
+ *
+ * 运行中改码率（WebRTC 自适应码率）经 SetBitrate() 进入：记录为满码率基准，
+ * 静止状态下按比例下发，不会被状态切换覆盖。运行中降帧率（负载调度）经 SetFrameRate()
+ * 同样记录为满帧率基准。
+ *
+ * @note 线程安全：OnDetections() 在推理线程调用，SetBitrate() / SetFrameRate() / GetStats()
+ *       可在任意线程调用
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-17
+ */
+
+#pragma once
+
+#include "ai_types.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace media {
+
+/**
+ * @brief 检测驱动编码配置（仅 AI 模式主码流）
+ */
+struct SmartEncodeConfig {
+    bool roi = false;                   ///< 检测框作为 VENC ROI
+    int roi_qp = -6;                    ///< ROI 相对 QP（负值 = 目标更清晰）
+    int roi_max = 4;                    ///< 最多几个 ROI 区域（硬件上限 8）
+    float roi_margin = 0.1f;            ///< 检测框四周外扩比例（覆盖框外的头发、肩膀等）
+
+    bool smart_rate = false;            ///< 静止场景降码率 / 帧率，出现目标立即恢复
+    int idle_bitrate_percent = 30;      ///< 静止状态码率占满码率的百分比
+    int idle_fps = 10;                  ///< 静止状态输出帧率（0 = 不降帧率）
+    int idle_delay_ms = 5000;           ///< 最后一次检测后多久进入静止状态
+
+    bool Enabled() const { return roi || smart_rate; }
+};
+
+/**
+ * @brief 检测驱动编码统计
+ */
+struct SmartEncodeStats {
+    bool roi = false;
+    bool smart_rate = false;
+    bool idle = false;                  ///< 当前处于静止状态
+    int bitrate_kbps = 0;               ///< 当前下发的目标码率
+    int fps = 0;                        ///< 当前下发的输出帧率
+    uint64_t idle_transitions = 0;      ///< 进入静止状态次数
+    int roi_regions = 0;                ///< 当前启用的 ROI 区域数
+    uint64_t roi_updates = 0;           ///< 累计 SetRoiAttr 调用次数
+};
+
+class SmartEncoder {
+public:
+    /// VENC ROI 硬件区域数
+    static constexpr int kMaxRoiRegions = 8;
+
+    SmartEncoder() = default;
+
+    SmartEncoder(const SmartEncoder&) = delete;
+    SmartEncoder& operator=(const SmartEncoder&) = delete;
+
+    /**
+     * @brief 绑定 VENC 通道（VENC 创建之后调用）
+     *
+     * 满码率与满帧率取自通道当前属性，之后的 SetBitrate() 更新满码率。
+     *
+     * @param config 配置（均未开启时只做码率透传）
+     * @param venc_chn 主码流 VENC 通道
+     * @param frame_width 主码流宽（ROI 裁剪范围）
+     * @param frame_height 主码流高
+     */
+    void Configure(const SmartEncodeConfig& config, int venc_chn, int frame_width,
+                   int frame_height);
+
+    /**
+     * @brief 处理一次检测结果（推理线程调用）
+     */
+    void OnDetections(const rknn::DetectionResultList& results);
+
+    /**
+     * @brief 设置满码率（静止状态下按比例下发）
+     * @return 0 成功，-1 失败
+     */
+    int SetBitrate(int kbps);
+
+    /**
+     * @brief 设置满帧率（静止状态下仍取与 idle_fps 的较小值）
+     * @return 0 成功，-1 失败
+     */
+    int SetFrameRate(int fps);
+
+    /**
+     * @brief 关闭全部 ROI 区域并恢复满码率、满帧率（生产者停止时调用）
+     */
+    void Reset();
+
+    bool Enabled() const { return config_.Enabled(); }
+
+    SmartEncodeStats GetStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Rect {
+        int x = 0;
+        int y = 0;
+        int width = 0;
+        int height = 0;
+
+        bool operator==(const Rect& o) const {
+            return x == o.x && y == o.y && width == o.width && height == o.height;
+        }
+        bool Empty() const { return width <= 0 || height <= 0; }
+    };
+
+    Rect AlignedRect(const rknn::BoundingBox& box) const;
+    void UpdateRoi(const rknn::DetectionResultList& results);
+    void SetRoiRegion(int index, const Rect& rect);
+    /// 按当前状态下发码率与帧率（调用方持有 mutex_）
+    int ApplyRate();
+
+    mutable std::mutex mutex_;
+    SmartEncodeConfig config_;
+    int venc_chn_ = -1;
+    int frame_width_ = 0;
+    int frame_height_ = 0;
+
+    int full_bitrate_kbps_ = 0;
+    int full_fps_ = 0;
+    bool idle_ = false;
+    Clock::time_point last_detection_;
+
+    std::array<Rect, kMaxRoiRegions> roi_applied_{};
+    std::vector<size_t> order_;             // 按面积排序的检测下标（复用缓冲）
+
+    SmartEncodeStats stats_;
+};
+
+}  // namespace media
@@ -0,0 +1,234 @@
+/**
+ * @file snapshot.cpp
+ * @brief JPEG 抓拍实现
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-18
+ */
+
+#define LOG_TAG "Snapshot"
+
+#include "snapshot.h"
+#include "common/logger.h"
+#include "common/media_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "rk_mpi_mb.h"
+#include "rk_mpi_venc.h"
+#include "rk_mpi_vpss.h"
+
+namespace media {
+
+namespace {
+
+constexpr int kMinSize = 64;
+constexpr RK_S32 kTimeoutMs = 1000;
+
+}  // namespace
+
+// ============================================================================
+// 生命周期
+// ============================================================================
+
+void SnapshotEncoder::Init(const SnapshotConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+    config_.quality = std::clamp(config_.quality, 1, 99);
+    cache_ = Snapshot();
+    stats_ = SnapshotStats();
+    stats_.enabled = true;
+    enabled_ = true;
+    LOG_INFO("Snapshot enabled: VPSS chn{} -> VENC chn{} (JPEG q{}), up to {}x{}",
+             config_.vpss_chn, config_.venc_chn, config_.quality,
+             config_.max_width, config_.max_height);
+}
+
+void SnapshotEncoder::Deinit() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    DestroyEncoder();
+    cache_ = Snapshot();
+    enabled_ = false;
+    stats_.enabled = false;
+}
+
+SnapshotStats SnapshotEncoder::GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+// ============================================================================
+// 抓拍
+// ============================================================================
+
+void SnapshotEncoder::ResolveSize(const SnapshotRequest& request, int* width,
+                                  int* height) const {
+    const int max_w = config_.max_width;
+    const int max_h = config_.max_height;
+    int w = request.width;
+    int h = request.height;
+    if (w <= 0 && h <= 0) {
+        w = max_w;
+        h = max_h;
+    } else if (w <= 0) {
+        w = static_cast<int>(static_cast<int64_t>(h) * max_w / max_h);
+    } else if (h <= 0) {
+        h = static_cast<int>(static_cast<int64_t>(w) * max_h / max_w);
+    }
+
+    // JPEG 编码器按 16 对齐宽度，VPSS 输出高度取偶数；不放大
+    *width = std::clamp(w, kMinSize, max_w) & ~15;
+    *height = std::clamp(h, kMinSize, max_h) & ~1;
+}
+
+int SnapshotEncoder::Capture(const SnapshotRequest& request, Snapshot* out) {
+    int width = 0;
+    int height = 0;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!enabled_) {
+        return -1;
+    }
+    stats_.requests++;
+    ResolveSize(request, &width, &height);
+
+    const auto now = Clock::now();
+    if (cache_.jpeg && cache_.width == width && cache_.height == height &&
+        now - cache_time_ < std::chrono::milliseconds(config_.cache_ms)) {
+        *out = cache_;
+        out->cached = true;
+        stats_.cache_hits++;
+        return 0;
+    }
+
+    if (!Encode(width, height, out)) {
+        stats_.failures++;
+        return -1;
+    }
+    stats_.encodes++;
+    stats_.last_encode_ms = std::chrono::duration<double, std::milli>(Clock::now() - now).count();
+    cache_ = *out;
+    cache_time_ = now;
+    return 0;
+}
+
+bool SnapshotEncoder::EnsureEncoder(int width, int height) {
+    if (venc_created_ && venc_width_ == width && venc_height_ == height) {
+        return true;
+    }
+    DestroyEncoder();
+
+    VENC_CHN_ATTR_S attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.stVencAttr.enType = RK_VIDEO_ID_JPEG;
+    attr.stVencAttr.enPixelFormat = RK_FMT_YUV420SP;
+    attr.stVencAttr.u32PicWidth = width;
+    attr.stVencAttr.u32PicHeight = height;
+    attr.stVencAttr.u32VirWidth = width;
+    attr.stVencAttr.u32VirHeight = height;
+    attr.stVencAttr.u32StreamBufCnt = 1;
+    attr.stVencAttr.u32BufSize = width * height * 3 / 2;
+
+    RK_S32 ret = RK_MPI_VENC_CreateChn(config_.venc_chn, &attr);
+    if (ret != RK_SUCCESS) {
+        LOG_ERROR("JPEG VENC chn{} create failed: {:#x}", config_.venc_chn, ret);
+        return false;
+    }
+
+    VENC_JPEG_PARAM_S jpeg;
+    memset(&jpeg, 0, sizeof(jpeg));
+    if (RK_MPI_VENC_GetJpegParam(config_.venc_chn, &jpeg) == RK_SUCCESS) {
+        jpeg.u32Qfactor = static_cast<RK_U32>(config_.quality);
+        RK_MPI_VENC_SetJpegParam(config_.venc_chn, &jpeg);
+    }
+
+    VENC_RECV_PIC_PARAM_S recv;
+    memset(&recv, 0, sizeof(recv));
+    recv.s32RecvPicNum = -1;
+    RK_MPI_VENC_StartRecvFrame(config_.venc_chn, &recv);
+
+    venc_created_ = true;
+    venc_width_ = width;
+    venc_height_ = height;
+    LOG_DEBUG("JPEG VENC chn{} ready: {}x{}", config_.venc_chn, width, height);
+    return true;
+}
+
+void SnapshotEncoder::DestroyEncoder() {
+    if (!venc_created_) {
+        return;
+    }
+    RK_MPI_VENC_StopRecvFrame(config_.venc_chn);
+    RK_MPI_VENC_DestroyChn(config_.venc_chn);
+    venc_created_ = false;
+}
+
+bool SnapshotEncoder::Encode(int width, int height, Snapshot* out) {
+    if (!EnsureEncoder(width, height)) {
+        return false;
+    }
+
+    // 1. 临时使能 VPSS 通道，硬件缩放到抓拍尺寸
+    VPSS_CHN_ATTR_S chn_attr;
+    memset(&chn_attr, 0, sizeof(chn_attr));
+    chn_attr.enChnMode = VPSS_CHN_MODE_USER;
+    chn_attr.enDynamicRange = DYNAMIC_RANGE_SDR8;
+    chn_attr.enPixelFormat = RK_FMT_YUV420SP;
+    chn_attr.stFrameRate.s32SrcFrameRate = -1;
+    chn_attr.stFrameRate.s32DstFrameRate = -1;
+    chn_attr.u32Width = width;
+    chn_attr.u32Height = height;
+    chn_attr.u32Depth = 1;
+    chn_attr.enCompressMode = COMPRESS_MODE_NONE;
+
+    RK_S32 ret = RK_MPI_VPSS_SetChnAttr(config_.vpss_grp, config_.vpss_chn, &chn_attr);
+    if (ret == RK_SUCCESS) {
+        ret = RK_MPI_VPSS_EnableChn(config_.vpss_grp, config_.vpss_chn);
+    }
+    if (ret != RK_SUCCESS) {
+        LOG_WARN_THROTTLED(5000, "VPSS chn{} enable failed: {:#x}", config_.vpss_chn, ret);
+        return false;
+    }
+
+    // 2. 取一帧送 JPEG VENC，帧引用在送帧后即可释放
+    bool ok = false;
+    VideoFramePtr frame = acquire_vpss_frame(config_.vpss_grp, config_.vpss_chn, kTimeoutMs);
+    if (!frame) {
+        LOG_WARN_THROTTLED(5000, "Snapshot: no frame from VPSS chn{}", config_.vpss_chn);
+    } else {
+        out->pts = frame->stVFrame.u64PTS;
+        ret = RK_MPI_VENC_SendFrame(config_.venc_chn, frame.get(), kTimeoutMs);
+        frame.reset();
+        if (ret != RK_SUCCESS) {
+            LOG_WARN_THROTTLED(5000, "JPEG VENC SendFrame failed: {:#x}", ret);
+        } else {
+            // 3. 取 JPEG 码流并拷贝出来
+            VENC_PACK_S pack;
+            VENC_STREAM_S stream;
+            memset(&pack, 0, sizeof(pack));
+            memset(&stream, 0, sizeof(stream));
+            stream.pstPack = &pack;
+            ret = RK_MPI_VENC_GetStream(config_.venc_chn, &stream, kTimeoutMs);
+            if (ret != RK_SUCCESS) {
+                LOG_WARN_THROTTLED(5000, "JPEG VENC GetStream failed: {:#x}", ret);
+            } else {
+                const void* data = RK_MPI_MB_Handle2VirAddr(pack.pMbBlk);
+                if (data && pack.u32Len > 0) {
+                    out->jpeg = std::make_shared<const std::string>(
+                        static_cast<const char*>(data), pack.u32Len);
+                    out->width = width;
+                    out->height = height;
+                    out->cached = false;
+                    ok = true;
+                }
+                RK_MPI_VENC_ReleaseStream(config_.venc_chn, &stream);
+            }
+        }
+    }
+
+    RK_MPI_VPSS_DisableChn(config_.vpss_grp, config_.vpss_chn);
+    return ok;
+}
+
+}  // namespace media
@@ -0,0 +1,132 @@
+/**
+ * @file snapshot.h
+ * @brief JPEG 抓拍 - 按需从 VPSS 取一帧，经独立 VENC JPEG 通道硬件编码
+ *
+ * 集成方（NVR、家庭自动化、事件通知）只需要一张图时，不必再建 RTSP 会话解码关键帧：
+ * - 请求到来时使能生产者 VPSS Group 的一个空闲通道（按请求尺寸硬件缩放，缩略图不耗 CPU），
+ *   非阻塞模式下取一帧后立即关闭通道，平时不占 VPSS 带宽
+ * - 帧送入 JPEG VENC 通道（按尺寸惰性创建，尺寸变化时重建），取出码流拷贝后归还
+ * - 短时缓存：cache_ms 内同尺寸的请求直接复用上一张，突发请求只编码一次；
+ *   并发请求在编码锁上排队，等到的直接命中缓存
+ *
+ * 生命周期（由生产者驱动）：
+ * 1. Init()   - VPSS Group 创建之后（只记录参数，不占硬件资源）
+ * 2. Capture()- 任意线程调用
+ * 3. Deinit() - VPSS Group 销毁之前：销毁 VENC 通道
+ *
+ * @note 抓拍取自 VPSS 输出，不经过 RGN，画面不带检测框（检测结果由调用方另附）
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-18
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace media {
+
+/**
+ * @brief 抓拍参数
+ */
+struct SnapshotConfig {
+    int vpss_grp = 0;           ///< 所属 VPSS Group（由生产者创建）
+    int vpss_chn = 3;           ///< 抓拍时临时使能的空闲 VPSS 通道
+    int venc_chn = 2;           ///< JPEG VENC 通道
+    int max_width = 1920;       ///< 最大尺寸（主码流分辨率，VPSS 不放大）
+    int max_height = 1080;
+    int quality = 80;           ///< JPEG 质量 1-99
+    int cache_ms = 500;         ///< 同尺寸请求复用上一张的时长
+};
+
+/**
+ * @brief 抓拍请求（0 = 按另一边等比，两者都为 0 取全尺寸）
+ */
+struct SnapshotRequest {
+    int width = 0;
+    int height = 0;
+};
+
+/**
+ * @brief 抓拍结果
+ */
+struct Snapshot {
+    std::shared_ptr<const std::string> jpeg;
+    int width = 0;
+    int height = 0;
+    uint64_t pts = 0;           ///< 来源帧采集 PTS（微秒）
+    bool cached = false;        ///< 是否命中缓存
+};
+
+/**
+ * @brief 抓拍统计
+ */
+struct SnapshotStats {
+    bool enabled = false;
+    uint64_t requests = 0;
+    uint64_t encodes = 0;
+    uint64_t cache_hits = 0;
+    uint64_t failures = 0;
+    double last_encode_ms = 0.0;
+};
+
+class SnapshotEncoder {
+public:
+    SnapshotEncoder() = default;
+    ~SnapshotEncoder() { Deinit(); }
+
+    SnapshotEncoder(const SnapshotEncoder&) = delete;
+    SnapshotEncoder& operator=(const SnapshotEncoder&) = delete;
+
+    /**
+     * @brief 记录参数并启用抓拍（VPSS Group 创建之后调用）
+     */
+    void Init(const SnapshotConfig& config);
+
+    /**
+     * @brief 销毁 JPEG VENC 通道（VPSS Group 销毁之前调用）
+     */
+    void Deinit();
+
+    bool IsEnabled() const { return enabled_; }
+
+    /**
+     * @brief 抓拍一张 JPEG
+     * @return 0 成功，-1 未启用或编码失败
+     */
+    int Capture(const SnapshotRequest& request, Snapshot* out);
+
+    SnapshotStats GetStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /// 请求尺寸 -> 实际尺寸（等比、对齐、不超过最大尺寸）
+    void ResolveSize(const SnapshotRequest& request, int* width, int* height) const;
+
+    /// 确保 JPEG VENC 通道为指定尺寸（调用方持有 mutex_）
+    bool EnsureEncoder(int width, int height);
+    void DestroyEncoder();
+
+    /// 取一帧并编码（调用方持有 mutex_）
+    bool Encode(int width, int height, Snapshot* out);
+
+    SnapshotConfig config_;
+    bool enabled_ = false;
+
+    mutable std::mutex mutex_;
+    bool venc_created_ = false;
+    int venc_width_ = 0;
+    int venc_height_ = 0;
+
+    Snapshot cache_;
+    Clock::time_point cache_time_;
+
+    SnapshotStats stats_;
+};
+
+}  // namespace media
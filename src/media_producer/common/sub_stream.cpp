@@ -0,0 +1,181 @@
+/**
+ * @file sub_stream.cpp
+ * @brief 子码流编码链路实现
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-12
+ */
+
+#define LOG_TAG "SubStream"
+
+#include "sub_stream.h"
+#include "venc_codec.h"
+#include "common/logger.h"
+
+#include "rk_mpi_vpss.h"
+#include "rk_mpi_venc.h"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace media {
+
+// ============================================================================
+// 初始化
+// ============================================================================
+
+int SubStream::Init(const SubStreamConfig& config) {
+    if (enabled_) {
+        LOG_WARN("Sub stream already initialized");
+        return 0;
+    }
+    config_ = config;
+    RK_S32 ret;
+
+    // 1. VPSS 缩放通道（硬件绑定，不保存帧）
+    VPSS_CHN_ATTR_S stChnAttr;
+    memset(&stChnAttr, 0, sizeof(stChnAttr));
+    stChnAttr.enChnMode = VPSS_CHN_MODE_USER;
+    stChnAttr.enDynamicRange = DYNAMIC_RANGE_SDR8;
+    stChnAttr.enPixelFormat = RK_FMT_YUV420SP;
+    stChnAttr.stFrameRate.s32SrcFrameRate = -1;
+    stChnAttr.stFrameRate.s32DstFrameRate = -1;
+    stChnAttr.u32Width = config_.width;
+    stChnAttr.u32Height = config_.height;
+    stChnAttr.u32Depth = 0;
+    stChnAttr.enCompressMode = COMPRESS_MODE_NONE;
+
+    ret = RK_MPI_VPSS_SetChnAttr(config_.vpss_grp, config_.vpss_chn, &stChnAttr);
+    if (ret != RK_SUCCESS) {
+        LOG_ERROR("VPSS chn{} attr failed: {:#x}", config_.vpss_chn, ret);
+        Deinit();
+        return -1;
+    }
+    ret = RK_MPI_VPSS_EnableChn(config_.vpss_grp, config_.vpss_chn);
+    if (ret != RK_SUCCESS) {
+        LOG_ERROR("VPSS chn{} enable failed: {:#x}", config_.vpss_chn, ret);
+        Deinit();
+        return -1;
+    }
+    vpss_chn_enabled_ = true;
+
+    // 2. VENC 子通道（NV12 输入）
+    VENC_CHN_ATTR_S stAttr;
+    memset(&stAttr, 0, sizeof(stAttr));
+    stAttr.stVencAttr.enPixelFormat = RK_FMT_YUV420SP;
+    stAttr.stVencAttr.u32PicWidth = config_.width;
+    stAttr.stVencAttr.u32PicHeight = config_.height;
+    stAttr.stVencAttr.u32VirWidth = config_.width;
+    stAttr.stVencAttr.u32VirHeight = config_.height;
+    stAttr.stVencAttr.u32StreamBufCnt = 2;
+    stAttr.stVencAttr.u32BufSize = config_.width * config_.height / 2;
+
+    venc_fill_cbr_attr(&stAttr, to_rk_codec_id(config_.codec), config_.bitrate_kbps,
+                       config_.framerate, config_.framerate);
+
+    ret = RK_MPI_VENC_CreateChn(config_.venc_chn, &stAttr);
+    if (ret != RK_SUCCESS) {
+        LOG_ERROR("VENC chn{} create failed: {:#x}", config_.venc_chn, ret);
+        Deinit();
+        return -1;
+    }
+    venc_enabled_ = true;
+
+    VENC_RECV_PIC_PARAM_S stRecvParam;
+    memset(&stRecvParam, 0, sizeof(stRecvParam));
+    stRecvParam.s32RecvPicNum = -1;
+    RK_MPI_VENC_StartRecvFrame(config_.venc_chn, &stRecvParam);
+
+    // 3. VPSS ChnX -> VENC 子通道
+    vpss_chn_.enModId = RK_ID_VPSS;
+    vpss_chn_.s32DevId = config_.vpss_grp;
+    vpss_chn_.s32ChnId = config_.vpss_chn;
+
+    venc_chn_.enModId = RK_ID_VENC;
+    venc_chn_.s32DevId = 0;
+    venc_chn_.s32ChnId = config_.venc_chn;
+
+    ret = RK_MPI_SYS_Bind(&vpss_chn_, &venc_chn_);
+    if (ret != RK_SUCCESS) {
+        LOG_ERROR("Failed to bind VPSS chn{} -> VENC chn{}: {:#x}",
+                  config_.vpss_chn, config_.venc_chn, ret);
+        Deinit();
+        return -1;
+    }
+    bound_ = true;
+
+    dispatcher_.SetCodec(config_.codec);
+    dispatcher_.Keyframes().SetChannel(config_.venc_chn);
+    dispatcher_.Gop().Configure(config_.gop_cache_kb > 0 ? config_.gop_cache_kb * 1024 : 0);
+    enabled_ = true;
+    LOG_INFO("Sub stream initialized: {}x{} @ {}kbps ({}, VPSS chn{} -> VENC chn{})",
+             config_.width, config_.height, config_.bitrate_kbps,
+             VideoCodecToString(config_.codec), config_.vpss_chn, config_.venc_chn);
+    return 0;
+}
+
+void SubStream::Deinit() {
+    Stop();
+
+    if (bound_) {
+        RK_MPI_SYS_UnBind(&vpss_chn_, &venc_chn_);
+        bound_ = false;
+        LOG_DEBUG("VPSS chn{} -> VENC chn{} unbound", config_.vpss_chn, config_.venc_chn);
+    }
+
+    if (venc_enabled_) {
+        dispatcher_.Keyframes().SetChannel(-1);
+        RK_MPI_VENC_StopRecvFrame(config_.venc_chn);
+
+        // 排空 VENC
+        VENC_STREAM_S stFrame;
+        stFrame.pstPack = (VENC_PACK_S*)malloc(sizeof(VENC_PACK_S));
+        if (stFrame.pstPack) {
+            memset(stFrame.pstPack, 0, sizeof(VENC_PACK_S));
+            int drain_count = 0;
+            while (drain_count < 16) {
+                RK_S32 ret = RK_MPI_VENC_GetStream(config_.venc_chn, &stFrame, 50);
+                if (ret != RK_SUCCESS) break;
+                RK_MPI_VENC_ReleaseStream(config_.venc_chn, &stFrame);
+                drain_count++;
+            }
+            free(stFrame.pstPack);
+        }
+
+        RK_MPI_VENC_DestroyChn(config_.venc_chn);
+        venc_enabled_ = false;
+        LOG_DEBUG("Sub VENC deinitialized");
+    }
+
+    if (vpss_chn_enabled_) {
+        RK_MPI_VPSS_DisableChn(config_.vpss_grp, config_.vpss_chn);
+        vpss_chn_enabled_ = false;
+    }
+
+    if (enabled_) {
+        enabled_ = false;
+        LOG_INFO("Sub stream deinitialized");
+    }
+}
+
+// ============================================================================
+// 启停
+// ============================================================================
+
+void SubStream::Start() {
+    if (!enabled_) return;
+    dispatcher_.Start(config_.venc_chn);
+}
+
+void SubStream::Stop() {
+    dispatcher_.Stop();
+}
+
+void SubStream::AppendConsumerStats(std::vector<StreamConsumerStats>& out) const {
+    for (auto& s : dispatcher_.GetConsumerStats()) {
+        s.stream = StreamSelector::kSub;
+        out.push_back(std::move(s));
+    }
+}
+
+}  // namespace media
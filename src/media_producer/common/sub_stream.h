@@ -0,0 +1,138 @@
+/**
+ * @file sub_stream.h
+ * @brief 子码流 - VPSS 缩放通道 -> 独立 VENC 通道的低分辨率编码链路
+ *
+ * 主码流保持全分辨率（录制、RTSP），子码流以较低分辨率和码率编码，
+ * 供 WebRTC / WebSocket 预览使用，每个观看者的带宽随之下降。
+ *
+ * 链路：VPSS Group 的一个空闲通道（u32Depth = 0，硬件绑定）-> VENC 子通道，
+ * 由自带的 StreamDispatcher 在独立 Fetch 线程中拉流分发，与主码流互不阻塞。
+ *
+ * 生命周期（由生产者驱动）：
+ * 1. Init()   - VPSS Group 创建之后：使能缩放通道、创建 VENC、绑定
+ * 2. Start()  - 启动 Fetch 线程
+ * 3. Stop()   - 停止 Fetch 线程并归还积压帧
+ * 4. Deinit() - VPSS Group 销毁之前：解绑、排空并销毁 VENC、关闭通道
+ *
+ * @note 子码流直接取自 VPSS 缩放输出，不经过 RGN，因此不叠加 AI 检测框
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-12
+ */
+
+#pragma once
+
+#include "i_media_producer.h"
+#include "common/stream_dispatcher.h"
+#include "common/video_codec.h"
+
+#include "rk_mpi_sys.h"
+
+namespace media {
+
+/**
+ * @struct SubStreamConfig
+ * @brief 子码流参数
+ */
+struct SubStreamConfig {
+    int vpss_grp = 0;           ///< 所属 VPSS Group（由生产者创建）
+    int vpss_chn = 1;           ///< 用于缩放输出的空闲 VPSS 通道
+    int venc_chn = 1;           ///< 子码流 VENC 通道
+    int width = 640;
+    int height = 360;
+    int bitrate_kbps = 1024;
+    int framerate = 30;
+    VideoCodec codec = VideoCodec::kH264;
+    int gop_cache_kb = 0;       ///< GOP 缓存上限（0 = 关闭）
+};
+
+/**
+ * @brief 由生产者配置生成子码流参数
+ */
+inline SubStreamConfig make_sub_stream_config(const ProducerConfig& config, int vpss_grp,
+                                              int vpss_chn, int venc_chn) {
+    SubStreamConfig sub;
+    sub.vpss_grp = vpss_grp;
+    sub.vpss_chn = vpss_chn;
+    sub.venc_chn = venc_chn;
+    sub.width = config.sub_width;
+    sub.height = config.sub_height;
+    sub.bitrate_kbps = config.sub_bitrate_kbps;
+    sub.framerate = config.framerate;
+    sub.codec = config.codec;
+    sub.gop_cache_kb = config.sub_gop_cache_kb;
+    return sub;
+}
+
+/**
+ * @class SubStream
+ * @brief 子码流编码链路（VPSS 通道 + VENC 通道 + 分发器）
+ */
+class SubStream {
+public:
+    SubStream() = default;
+    ~SubStream() { Deinit(); }
+
+    SubStream(const SubStream&) = delete;
+    SubStream& operator=(const SubStream&) = delete;
+
+    /**
+     * @brief 建立 VPSS 缩放通道 -> VENC 子通道链路
+     * @return 0 成功，-1 失败（已建立的部分会被回收）
+     */
+    int Init(const SubStreamConfig& config);
+
+    /**
+     * @brief 拆除链路（可重复调用）
+     */
+    void Deinit();
+
+    void Start();
+    void Stop();
+
+    bool IsEnabled() const { return enabled_; }
+    const SubStreamConfig& GetConfig() const { return config_; }
+
+    StreamDispatcher& Dispatcher() { return dispatcher_; }
+    const StreamDispatcher& Dispatcher() const { return dispatcher_; }
+
+    /**
+     * @brief 追加子码流消费者统计（stream 字段标记为 kSub）
+     */
+    void AppendConsumerStats(std::vector<StreamConsumerStats>& out) const;
+
+private:
+    SubStreamConfig config_;
+    bool vpss_chn_enabled_ = false;
+    bool venc_enabled_ = false;
+    bool bound_ = false;
+    bool enabled_ = false;
+
+    MPP_CHN_S vpss_chn_{};
+    MPP_CHN_S venc_chn_{};
+
+    StreamDispatcher dispatcher_;
+};
+
+/**
+ * @brief 汇总主码流与子码流的按需关键帧统计
+ */
+inline void fill_keyframe_stats(const StreamDispatcher& main, const SubStream& sub,
+                                ProducerStats* stats) {
+    KeyframeRequestStats m = main.Keyframes().GetStats();
+    KeyframeRequestStats s = sub.Dispatcher().Keyframes().GetStats();
+    stats->keyframe_requests = m.requests + s.requests;
+    stats->keyframes_forced = m.issued + s.issued;
+    stats->keyframe_coalesced = m.coalesced + s.coalesced;
+}
+
+/**
+ * @brief 填充主码流与子码流的 GOP 缓存占用
+ */
+inline void fill_gop_cache_stats(const StreamDispatcher& main, const SubStream& sub,
+                                 ProducerStats* stats) {
+    stats->main_gop_cache = main.Gop().GetStats();
+    stats->sub_gop_cache = sub.Dispatcher().Gop().GetStats();
+}
+
+}  // namespace media
@@ -0,0 +1,166 @@
+/**
+ * @file venc_codec.h
+ * @brief VENC 编码格式辅助 - H.264/H.265 的 profile 与码控参数
+ *
+ * 三种生产者的 venc_init* 只在像素格式、缓冲大小上不同，编码格式相关的
+ * profile、码控模式和 CBR 参数统一在此填写，保证 --codec 切换后各模式一致。
+ * 运行中调整码率（WebRTC 自适应码率）与帧率（静止场景降帧率）同样在此按码控模式改写。
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-12
+ */
+
+#pragma once
+
+#include "rk_mpi_venc.h"
+
+#include "common/video_codec.h"
+
+#include <cstring>
+
+namespace media {
+
+/**
+ * @brief VideoCodec -> RKMPI 编码类型
+ */
+inline RK_CODEC_ID_E to_rk_codec_id(VideoCodec codec) {
+    return codec == VideoCodec::kH265 ? RK_VIDEO_ID_HEVC : RK_VIDEO_ID_AVC;
+}
+
+/**
+ * @brief 按编码类型填写 profile 与 CBR 码控参数
+ *
+ * @param attr VENC 通道属性（enType 之外的编码相关字段由本函数填写）
+ * @param enType RK_VIDEO_ID_AVC 或 RK_VIDEO_ID_HEVC
+ * @param bitrate_kbps 目标码率（kbps）
+ * @param gop GOP 长度（帧）
+ * @param fps 输入/输出帧率
+ */
+inline void venc_fill_cbr_attr(VENC_CHN_ATTR_S* attr, RK_CODEC_ID_E enType,
+                               RK_U32 bitrate_kbps, RK_U32 gop, RK_U32 fps) {
+    attr->stVencAttr.enType = enType;
+
+    if (enType == RK_VIDEO_ID_HEVC) {
+        attr->stVencAttr.u32Profile = H265E_PROFILE_MAIN;
+        attr->stRcAttr.enRcMode = VENC_RC_MODE_H265CBR;
+        attr->stRcAttr.stH265Cbr.u32Gop = gop;
+        attr->stRcAttr.stH265Cbr.u32BitRate = bitrate_kbps;
+        attr->stRcAttr.stH265Cbr.fr32DstFrameRateDen = 1;
+        attr->stRcAttr.stH265Cbr.fr32DstFrameRateNum = fps;
+        attr->stRcAttr.stH265Cbr.u32SrcFrameRateDen = 1;
+        attr->stRcAttr.stH265Cbr.u32SrcFrameRateNum = fps;
+    } else {
+        attr->stVencAttr.u32Profile = H264E_PROFILE_HIGH;
+        attr->stRcAttr.enRcMode = VENC_RC_MODE_H264CBR;
+        attr->stRcAttr.stH264Cbr.u32Gop = gop;
+        attr->stRcAttr.stH264Cbr.u32BitRate = bitrate_kbps;
+        attr->stRcAttr.stH264Cbr.fr32DstFrameRateDen = 1;
+        attr->stRcAttr.stH264Cbr.fr32DstFrameRateNum = fps;
+        attr->stRcAttr.stH264Cbr.u32SrcFrameRateDen = 1;
+        attr->stRcAttr.stH264Cbr.u32SrcFrameRateNum = fps;
+    }
+}
+
+/**
+ * @brief 读取 VENC 当前目标码率与输出帧率
+ *
+ * @return RK_SUCCESS 成功，其他为 RKMPI 错误码（不支持的码控模式返回 -1）
+ */
+inline RK_S32 venc_get_rate(RK_S32 chn, RK_U32* bitrate_kbps, RK_U32* fps) {
+    VENC_CHN_ATTR_S attr;
+    memset(&attr, 0, sizeof(attr));
+    RK_S32 ret = RK_MPI_VENC_GetChnAttr(chn, &attr);
+    if (ret != RK_SUCCESS) {
+        return ret;
+    }
+
+    const VENC_RC_ATTR_S& rc = attr.stRcAttr;
+    switch (rc.enRcMode) {
+        case VENC_RC_MODE_H264CBR:
+            *bitrate_kbps = rc.stH264Cbr.u32BitRate;
+            *fps = rc.stH264Cbr.fr32DstFrameRateNum;
+            break;
+        case VENC_RC_MODE_H265CBR:
+            *bitrate_kbps = rc.stH265Cbr.u32BitRate;
+            *fps = rc.stH265Cbr.fr32DstFrameRateNum;
+            break;
+        case VENC_RC_MODE_H264VBR:
+            *bitrate_kbps = rc.stH264Vbr.u32BitRate;
+            *fps = rc.stH264Vbr.fr32DstFrameRateNum;
+            break;
+        case VENC_RC_MODE_H265VBR:
+            *bitrate_kbps = rc.stH265Vbr.u32BitRate;
+            *fps = rc.stH265Vbr.fr32DstFrameRateNum;
+            break;
+        default:
+            return -1;
+    }
+    return RK_SUCCESS;
+}
+
+/**
+ * @brief 运行中修改 VENC 目标码率与输出帧率（GetChnAttr -> 改写码控参数 -> SetChnAttr）
+ *
+ * 只改动码率和目标帧率字段，GOP、输入帧率等其余属性保持不变（输出帧率低于输入帧率时
+ * VENC 均匀丢帧）；VBR 模式同时保证上限不低于目标码率
+ *
+ * @param chn VENC 通道
+ * @param bitrate_kbps 新的目标码率（kbps）
+ * @param fps 新的输出帧率（0 = 不修改）
+ * @return RK_SUCCESS 成功，其他为 RKMPI 错误码（不支持的码控模式返回 -1）
+ */
+inline RK_S32 venc_set_rate(RK_S32 chn, RK_U32 bitrate_kbps, RK_U32 fps) {
+    VENC_CHN_ATTR_S attr;
+    memset(&attr, 0, sizeof(attr));
+    RK_S32 ret = RK_MPI_VENC_GetChnAttr(chn, &attr);
+    if (ret != RK_SUCCESS) {
+        return ret;
+    }
+
+    VENC_RC_ATTR_S& rc = attr.stRcAttr;
+    switch (rc.enRcMode) {
+        case VENC_RC_MODE_H264CBR:
+            rc.stH264Cbr.u32BitRate = bitrate_kbps;
+            if (fps > 0) rc.stH264Cbr.fr32DstFrameRateNum = fps;
+            break;
+        case VENC_RC_MODE_H265CBR:
+            rc.stH265Cbr.u32BitRate = bitrate_kbps;
+            if (fps > 0) rc.stH265Cbr.fr32DstFrameRateNum = fps;
+            break;
+        case VENC_RC_MODE_H264VBR:
+            rc.stH264Vbr.u32BitRate = bitrate_kbps;
+            if (rc.stH264Vbr.u32MaxBitRate < bitrate_kbps) rc.stH264Vbr.u32MaxBitRate = bitrate_kbps;
+            if (fps > 0) rc.stH264Vbr.fr32DstFrameRateNum = fps;
+            break;
+        case VENC_RC_MODE_H265VBR:
+            rc.stH265Vbr.u32BitRate = bitrate_kbps;
+            if (rc.stH265Vbr.u32MaxBitRate < bitrate_kbps) rc.stH265Vbr.u32MaxBitRate = bitrate_kbps;
+            if (fps > 0) rc.stH265Vbr.fr32DstFrameRateNum = fps;
+            break;
+        default:
+            return -1;
+    }
+    return RK_MPI_VENC_SetChnAttr(chn, &attr);
+}
+
+/**
+ * @brief 运行中修改 VENC 目标码率（帧率不变）
+ */
+inline RK_S32 venc_set_bitrate(RK_S32 chn, RK_U32 bitrate_kbps) {
+    return venc_set_rate(chn, bitrate_kbps, 0);
+}
+
+/**
+ * @brief 运行中修改 VENC 输出帧率（码率不变）
+ */
+inline RK_S32 venc_set_framerate(RK_S32 chn, RK_U32 fps) {
+    RK_U32 kbps = 0;
+    RK_U32 current_fps = 0;
+    RK_S32 ret = venc_get_rate(chn, &kbps, &current_fps);
+    if (ret != RK_SUCCESS) {
+        return ret;
+    }
+    return venc_set_rate(chn, kbps, fps);
+}
+
+}  // namespace media
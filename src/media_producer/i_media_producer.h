@@ -13,6 +13,8 @@
  * - SimpleIPCProducer: 纯监控模式（VI -> VPSS -> VENC 硬件绑定，零拷贝）
  * - YoloProducer: YOLOv5 AI 推理模式（手动帧控制 + NPU 推理 + OSD）
  * - RetinaFaceProducer: RetinaFace 人脸检测模式
+ * - YoloProducer（组合模式）: YOLOv5 + RetinaFace 经 NPU 调度器分时推理
+ * - ReplayProducer: 文件回放（录制的 H.264/H.265 码流或 NV12 原始帧，不占用 sensor）
  *
  * @author 好软，好温暖
  * @date 2026-02-12
@@ -21,30 +23,31 @@
 #pragma once
 
 #include "common/media_buffer.h"
-
+#include "common/stream_dispatcher.h"
+#include "common/video_codec.h"
+#include "common/ai_types.h"
+#include "common/detection_event.h"
+#include "common/motion_detector.h"
+#include "common/npu_scheduler.h"
+#include "common/smart_encoder.h"
+#include "common/snapshot.h"
+
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace media {
 
-// ============================================================================
-// 流消费者类型
-// ============================================================================
+// StreamConsumerType / QueueDropPolicy / StreamCallback 定义在 common/stream_dispatcher.h
 
 /**
- * @brief 流消费者类型
+ * @brief 检测结果回调（推理线程调用，坐标已映射到主码流画面）
  */
-enum class StreamConsumerType {
-    Direct,     ///< 直接在 Fetch 线程中执行（仅用于极快的操作）
-    AsyncIO,    ///< 通过 asio::post 投递到 IO 线程执行（网络发送）
-    Queued      ///< 通过队列投递到独立线程（文件写入等阻塞操作）
-};
-
-/**
- * @brief 编码流回调类型
- */
-using StreamCallback = std::function<void(EncodedStreamPtr)>;
+using DetectionCallback = std::function<void(const rknn::DetectionResultList& results,
+                                             int frame_width, int frame_height)>;
 
 // ============================================================================
 // 分辨率配置
@@ -77,6 +80,65 @@ struct ResolutionConfig {
     }
 };
 
+// ============================================================================
+// AI 输入布局
+// ============================================================================
+
+/**
+ * @brief AI 模式下 VPSS 到 NPU 的输入布局
+ */
+enum class AiInputLayout {
+    kSingleChannel, ///< 单通道：Chn0 全分辨率手动获取，软件缩放给 NPU，CPU 叠框后送 VENC
+    kDualChannel,   ///< 双通道：Chn0 硬件绑定 VENC，Chn1 硬件缩放到模型尺寸给 NPU，RGN 叠框
+};
+
+/**
+ * @brief 双通道布局下 Chn1 的像素格式
+ */
+enum class AiInputFormat {
+    kNV12,      ///< NV12，由 RGA/OpenCV 转 RGB 并补黑边
+    kRGB888,    ///< RGB888，CPU 只需补黑边
+};
+
+/**
+ * @brief AI 模式检测框渲染后端
+ */
+enum class OverlayBackend {
+    kRgn,       ///< 硬件 RGN 叠加：VENC 保持 NV12，可与 VPSS 绑定零拷贝（默认）
+    kCpu,       ///< CPU 绘制：NV12 -> RGB888 后 OpenCV 画框，VENC 需 RGB 输入（仅单通道布局）
+    kClient,    ///< 客户端渲染：画面不叠框，VENC 保持 NV12；检测结果经元数据通道（WebRTC / WS）下发
+};
+
+// ============================================================================
+// 文件回放
+// ============================================================================
+
+/**
+ * @brief 回放文件格式
+ */
+enum class ReplayFormat {
+    kAnnexB,    ///< H.264/H.265 Annex-B 码流（按 ProducerConfig::codec 解析），直接分发给流消费者
+    kNV12,      ///< NV12 原始帧（连续多帧），送 NPU 推理，不输出编码流
+};
+
+/**
+ * @brief 回放模式配置（仅 ProducerMode::Replay 有效）
+ *
+ * 帧间隔：存在 `<path>.pts` 时按其中的时间戳（每行一帧，单位秒，如 ffprobe 导出的
+ * packet pts_time），否则按 ProducerConfig::framerate 均匀输出。
+ */
+struct ReplayConfig {
+    std::string path;                       ///< 回放文件
+    ReplayFormat format = ReplayFormat::kAnnexB;
+    bool realtime = true;                   ///< true 按原始节奏输出；false 尽快输出（压测 / 回归）
+    bool loop = true;                       ///< 到达文件末尾后从头循环（时间戳继续递增）
+    
+    int width = 0;                          ///< NV12 帧尺寸（0 = 取 ProducerConfig 分辨率）
+    int height = 0;
+    std::string model = "yolov5";           ///< NV12 推理模型："yolov5" / "retinaface"
+    std::string results_path;               ///< NV12 逐帧检测结果输出（JSON Lines，空 = 不输出）
+};
+
 // ============================================================================
 // 生产者配置
 // ============================================================================
@@ -89,10 +151,73 @@ struct ProducerConfig {
     int framerate = 30;
     int bitrate_kbps = 10 * 1024;  // 10 Mbps
     
+    /// VENC 编码格式（分发侧 StreamConfig::codec 需保持一致）
+    VideoCodec codec = VideoCodec::kH264;
+    
+    /// 双码流：VPSS 另一路缩放输出编码为低分辨率、低码率子码流，供预览消费者订阅
+    /// （子码流不叠加 AI 检测框；启用失败时仅保留主码流）
+    bool sub_stream = false;
+    int sub_width = 640;
+    int sub_height = 360;
+    int sub_bitrate_kbps = 1024;
+    
+    /// GOP 缓存内存上限（KB，0 = 关闭）：新预览客户端先收到最近一个 GOP 再接实时帧
+    int gop_cache_kb = 0;           ///< 主码流
+    int sub_gop_cache_kb = 0;       ///< 子码流
+    
     // AI 相关（仅对 AI 模式有效）
     int ai_width = 640;
     int ai_height = 640;
     
+    /// 异步推理：VENC 按采集帧率出流，NPU 在独立线程消费最新帧，
+    /// 检测结果以 NPU 速率刷新并叠加到经过的每一帧；false 时退回串行流水线
+    bool async_inference = true;
+    
+    /// 隔帧推理（YOLOv5）：每 inference_interval 帧跑一次 NPU，其余帧由目标跟踪器
+    /// （IoU 关联 + Kalman 匀速预测）外推检测框；1 = 每帧推理，不启用跟踪
+    int inference_interval = 1;
+    /// 自适应：出现新目标、漏检或运动突变时不等满间隔，下一帧立即推理
+    bool adaptive_inference = true;
+    /// 运动门控（YOLOv5）：画面无运动时暂停推理，检测事件随之静默
+    MotionGateConfig motion_gate;
+    
+    /// 组合模式（YoloFace）：NPU 调度器按目标速率分时运行两个模型（0 = 不限速），
+    /// 人形检测优先；人脸默认只在人形框内检测，画面中没有人时不占用 NPU
+    double yolo_rate_hz = 10.0;
+    double face_rate_hz = 5.0;
+    bool face_in_person = true;
+    
+    /// VPSS -> NPU 输入布局及 Chn1 像素格式（仅双通道布局有效）
+    AiInputLayout ai_input_layout = AiInputLayout::kDualChannel;
+    AiInputFormat ai_input_format = AiInputFormat::kNV12;
+    
+    /// 检测框渲染后端（双通道布局强制使用 RGN）
+    OverlayBackend ai_overlay = OverlayBackend::kRgn;
+    
+    /// 模型输入预处理走 RGA 硬件（VPSS fd 直出到 rknn 输入内存）；false 时使用 OpenCV
+    bool rga_preprocess = true;
+    
+    /// 模型缓存：常驻 NPU 的模型名（"yolov5"/"retinaface"），AI 模式切换时免去重新加载
+    std::vector<std::string> warm_models;
+    /// 启动时预加载 warm_models（false 时常驻模型在首次使用后保留）
+    bool preload_models = false;
+    /// 模型缓存内存上限（MB，含常驻模型；空闲的非常驻模型超限按 LRU 淘汰，0 = 不缓存）
+    int model_cache_mb = 64;
+    
+    /// 检测事件规则：AI 模式下命中规则时触发事件录制（由 MediaManager 持有的引擎评估）
+    DetectionEventConfig detection_events;
+    
+    /// 检测驱动编码：检测框作为主码流 VENC ROI；静止场景降码率 / 帧率（仅 AI 模式）
+    SmartEncodeConfig smart_encode;
+    
+    /// JPEG 抓拍：请求时临时使能空闲 VPSS 通道，经独立 VENC JPEG 通道硬件编码
+    bool snapshot = true;
+    int snapshot_quality = 80;          ///< JPEG 质量 1-99
+    int snapshot_cache_ms = 500;        ///< 同尺寸请求复用上一张的时长
+    
+    /// 文件回放（ProducerMode::Replay）：替代 sensor 采集，用于离线基准测试与分发压测
+    ReplayConfig replay;
+    
     /**
      * @brief 获取分辨率配置
      */
@@ -103,6 +228,106 @@ struct ProducerConfig {
     }
 };
 
+// ============================================================================
+// 生产者运行统计
+// ============================================================================
+
+/**
+ * @brief 生产者运行统计快照
+ *
+ * 视频帧率与推理帧率分开统计：异步推理模式下两者相互独立。
+ */
+struct ProducerStats {
+    uint64_t video_frames = 0;          ///< 已送编码的帧数
+    uint64_t inference_frames = 0;      ///< 已完成推理的帧数
+    uint64_t total_detections = 0;      ///< 累计检测目标数
+    
+    // 按需关键帧（主码流与子码流合计）
+    uint64_t keyframe_requests = 0;     ///< 消费者请求次数
+    uint64_t keyframes_forced = 0;      ///< 实际下发 RequestIDR 次数
+    uint64_t keyframe_coalesced = 0;    ///< 被合并的请求次数
+    double video_fps = 0.0;             ///< 视频输出帧率（最近统计窗口）
+    double inference_fps = 0.0;         ///< 推理帧率（最近统计窗口）
+    double avg_inference_ms = 0.0;      ///< 平均单帧推理耗时（预处理 + rknn_run + 后处理）
+    bool async_inference = false;       ///< 是否处于异步推理模式
+    int inference_interval = 1;         ///< 隔帧推理间隔（1 = 每帧推理）
+    uint64_t predicted_frames = 0;      ///< 由跟踪器外推检测框的帧数（未经过 NPU）
+    int inference_divisor = 1;          ///< 推理降速倍数（负载调度降级时 > 1）
+    
+    // NPU 调度（仅组合模式，每个模型一项）
+    std::vector<NpuTaskStats> npu_tasks;
+
+    // 运动门控
+    bool motion_gate = false;           ///< 是否启用运动门控
+    bool motion_active = false;         ///< 当前是否有运动（门控打开）
+    uint64_t motion_frames = 0;         ///< 经过门控判定的帧数
+    uint64_t motion_gated_frames = 0;   ///< 因画面静止跳过推理的帧数
+
+    // RGN 叠框统计（仅 RGN 渲染后端有效）
+    bool osd_enabled = false;           ///< 是否使用 RGN 叠框
+    uint64_t osd_updates = 0;           ///< 检测框更新次数
+    uint64_t osd_mpi_calls = 0;         ///< 累计 RGN MPI 调用次数
+    uint32_t osd_last_mpi_calls = 0;    ///< 最近一次更新的 RGN MPI 调用次数
+    uint32_t osd_last_moves = 0;        ///< 最近一次更新中移动/重新显示的 handle 数
+    uint32_t osd_last_bitmaps = 0;      ///< 最近一次更新中更换 bitmap 的 handle 数
+    int osd_handles_created = 0;        ///< 常驻 RGN handle 数
+    int osd_handles_visible = 0;        ///< 当前显示中的 RGN handle 数
+
+    // 检测驱动编码（ROI / 智能码控）
+    SmartEncodeStats smart_encode;
+
+    // JPEG 抓拍
+    SnapshotStats snapshot;
+
+    // GOP 缓存占用（主码流 / 子码流分别统计）
+    GopCacheStats main_gop_cache;
+    GopCacheStats sub_gop_cache;
+};
+
+/**
+ * @brief 帧率计数器
+ *
+ * 由单一线程调用 Tick()，任意线程通过 Fps() 读取最近一个统计窗口的帧率。
+ */
+class RateMeter {
+public:
+    explicit RateMeter(int window_ms = 1000) : window_ms_(window_ms) {}
+
+    void Tick() {
+        auto now = std::chrono::steady_clock::now();
+        if (window_count_ == 0 && window_start_ == std::chrono::steady_clock::time_point()) {
+            window_start_ = now;
+        }
+        window_count_++;
+        total_.fetch_add(1, std::memory_order_relaxed);
+
+        auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            now - window_start_).count();
+        if (elapsed_ms >= window_ms_) {
+            fps_.store(window_count_ * 1000.0 / elapsed_ms, std::memory_order_relaxed);
+            window_start_ = now;
+            window_count_ = 0;
+        }
+    }
+
+    void Reset() {
+        window_start_ = std::chrono::steady_clock::time_point();
+        window_count_ = 0;
+        total_.store(0, std::memory_order_relaxed);
+        fps_.store(0.0, std::memory_order_relaxed);
+    }
+
+    double Fps() const { return fps_.load(std::memory_order_relaxed); }
+    uint64_t Total() const { return total_.load(std::memory_order_relaxed); }
+
+private:
+    int window_ms_;
+    std::chrono::steady_clock::time_point window_start_;
+    uint64_t window_count_ = 0;
+    std::atomic<uint64_t> total_{0};
+    std::atomic<double> fps_{0.0};
+};
+
 // ============================================================================
 // 媒体生产者接口
 // ============================================================================
@@ -196,19 +421,36 @@ public:
      * @param name 消费者名称（用于日志）
      * @param callback 回调函数
      * @param type 消费者类型
-     * @param queue_size 队列大小（仅对 Queued 类型有效）
+     * @param queue_size 队列大小（Queued 的队列 / AsyncIO 的环形队列）
+     * @param drop_policy 队列满时的丢帧策略（Queued / AsyncIO 有效）
+     * @param stream 订阅的码流（子码流未启用时回退到主码流）
+     * @param strand AsyncIO 回调所在的 IO strand（同名共享，为空时使用消费者名）
      */
     virtual void RegisterStreamConsumer(
         const std::string& name,
         StreamCallback callback,
         StreamConsumerType type = StreamConsumerType::AsyncIO,
-        int queue_size = 3) = 0;
+        int queue_size = 3,
+        QueueDropPolicy drop_policy = QueueDropPolicy::DropToKeyframe,
+        StreamSelector stream = StreamSelector::kMain,
+        const std::string& strand = {}) = 0;
+
+    /**
+     * @brief 移除指定名称的流消费者（主码流与子码流中查找）
+     * @return true 找到并移除
+     */
+    virtual bool RemoveStreamConsumer(const std::string& name) = 0;
 
     /**
      * @brief 清除所有流消费者
      */
     virtual void ClearStreamConsumers() = 0;
 
+    /**
+     * @brief 获取各流消费者的投递/丢帧/延迟统计
+     */
+    virtual std::vector<StreamConsumerStats> GetStreamConsumerStats() const = 0;
+
     // ========== 状态查询 ==========
 
     /**
@@ -231,6 +473,13 @@ public:
      */
     virtual const ProducerConfig& GetConfig() const = 0;
 
+    /**
+     * @brief 获取视频/推理帧率等运行统计
+     *
+     * @note 默认实现返回空统计（仅 AI 模式提供推理相关字段）
+     */
+    virtual ProducerStats GetProducerStats() const { return {}; }
+
     // ========== 可选配置接口 ==========
 
     /**
@@ -247,6 +496,9 @@ public:
     /**
      * @brief 设置帧率
      * 
+     * Init() 之前设置采集与编码帧率；运行中只下调主码流 VENC 输出帧率（VENC 均匀丢帧），
+     * 不超过 Init() 时的配置帧率，传入配置帧率即恢复
+     * 
      * @param fps 帧率（1-30）
      * @return 0 成功，-1 失败
      * 
@@ -254,6 +506,88 @@ public:
      */
     virtual int SetFrameRate(int fps) { (void)fps; return -1; }
 
+    /**
+     * @brief 推理降速：每 divisor 次推理机会只运行一次（可在运行中调用）
+     * 
+     * 跳过的帧与隔帧推理相同处理：启用跟踪时由跟踪器外推，否则保持上次结果
+     * 
+     * @param divisor 降速倍数（1 = 不降速）
+     * @return 0 成功，-1 不支持（非 AI 模式）
+     * 
+     * @note 默认实现返回 -1（不支持）
+     */
+    virtual int SetInferenceDivisor(int divisor) { (void)divisor; return -1; }
+
+    // ========== 编码器运行时控制 ==========
+
+    /**
+     * @brief 运行中调整编码码率（WebRTC 自适应码率等）
+     * 
+     * @param stream 目标码流；子码流未启用时返回 -1，不会回退到主码流，
+     *               避免预览观看者的网络状况拖低录制码率
+     * @param kbps 目标码率
+     * @return 0 成功，-1 失败或不支持
+     * 
+     * @note 默认实现返回 -1（不支持）
+     */
+    virtual int SetBitrate(StreamSelector stream, int kbps) {
+        (void)stream; (void)kbps; return -1;
+    }
+
+    /**
+     * @brief 请求尽快编码一个 IDR 帧（新观看者加入、PLI、开始录制等）
+     * 
+     * 限频并跨消费者合并：已有在途 IDR 时直接复用，冷却期内的请求延后补发一次
+     * （见 KeyframeRequester），多个消费者同时加入只会触发一个 IDR。
+     * 
+     * @param stream 目标码流（子码流未启用时请求主码流，与消费者回退一致）
+     * @param reason 请求来源（用于日志）
+     * @return 0 已下发或已合并，-1 失败或不支持
+     * 
+     * @note 默认实现返回 -1（不支持）
+     */
+    virtual int RequestKeyFrame(StreamSelector stream, const char* reason = nullptr) {
+        (void)stream; (void)reason; return -1;
+    }
+
+    /**
+     * @brief 获取指定码流 GOP 缓存的快照（新客户端秒开）
+     * 
+     * 返回的帧已拷贝出 VENC buffer，首帧为关键帧，可长时间持有而不阻塞编码器。
+     * 
+     * @param stream 目标码流（子码流未启用时取主码流，与消费者回退一致）
+     * @return 缓存帧（GOP 缓存未开启或尚未缓存到关键帧时为空）
+     * 
+     * @note 默认实现返回空
+     */
+    virtual std::vector<EncodedStreamPtr> GetGopSnapshot(StreamSelector stream) {
+        (void)stream; return {};
+    }
+
+    /**
+     * @brief 抓拍一张 JPEG（主码流画面，按请求尺寸硬件缩放）
+     * 
+     * 阻塞至编码完成（通常一帧时间），短时间内同尺寸的请求直接返回缓存。
+     * 
+     * @param request 目标尺寸（0 = 按另一边等比）
+     * @param out 抓拍结果
+     * @return 0 成功，-1 未启用、无空闲通道或编码失败
+     * 
+     * @note 默认实现返回 -1（不支持）
+     */
+    virtual int CaptureSnapshot(const SnapshotRequest& request, Snapshot* out) {
+        (void)request; (void)out; return -1;
+    }
+
+    /**
+     * @brief 设置检测结果回调（每次推理完成后调用）
+     * 
+     * @param callback 回调函数，结果坐标已映射到主码流分辨率
+     * 
+     * @note 需在 Start() 之前调用；默认实现忽略（非 AI 模式没有检测结果）
+     */
+    virtual void SetDetectionCallback(DetectionCallback callback) { (void)callback; }
+
 protected:
     IMediaProducer() = default;
     
@@ -305,6 +639,32 @@ std::unique_ptr<IMediaProducer> CreateYoloProducer(const ProducerConfig& config)
  */
 std::unique_ptr<IMediaProducer> CreateRetinaFaceProducer(const ProducerConfig& config);
 
+/**
+ * @brief 创建 YOLOv5 + RetinaFace 组合模式生产者
+ * 
+ * 特点：
+ * - 与 YOLOv5 模式共用同一条 VI/VPSS/VENC 流水线
+ * - 推理线程经 NPU 调度器按目标速率分时运行两个模型，检测结果合并输出
+ * - 人脸检测默认只在人形框内进行
+ * 
+ * @param config 配置参数（yolo_rate_hz / face_rate_hz / face_in_person）
+ * @return 生产者实例
+ */
+std::unique_ptr<IMediaProducer> CreateYoloFaceProducer(const ProducerConfig& config);
+
+/**
+ * @brief 创建文件回放模式生产者
+ * 
+ * 特点：
+ * - 不初始化 ISP/VI/VPSS/VENC，不需要 sensor
+ * - Annex-B 码流经 mmap 零拷贝分发给流消费者（RTSP/WebRTC/WS/HLS/录制）
+ * - NV12 原始帧逐帧送 NPU 推理，检测结果经检测回调输出，可写入结果文件做回归比对
+ * 
+ * @param config 配置参数（replay）
+ * @return 生产者实例
+ */
+std::unique_ptr<IMediaProducer> CreateReplayProducer(const ProducerConfig& config);
+
 // ============================================================================
 // 生产者模式枚举
 // ============================================================================
@@ -315,7 +675,9 @@ std::unique_ptr<IMediaProducer> CreateRetinaFaceProducer(const ProducerConfig& c
 enum class ProducerMode {
     SimpleIPC,      ///< 纯监控模式
     YoloV5,         ///< YOLOv5 目标检测
-    RetinaFace      ///< RetinaFace 人脸检测
+    RetinaFace,     ///< RetinaFace 人脸检测
+    YoloFace,       ///< YOLOv5 + RetinaFace 组合（NPU 分时调度）
+    Replay          ///< 文件回放（离线基准测试 / 压测，不可与其他模式互相切换）
 };
 
 /**
@@ -331,6 +693,8 @@ inline const char* ProducerModeToString(ProducerMode mode) {
         case ProducerMode::SimpleIPC:   return "SimpleIPC";
         case ProducerMode::YoloV5:      return "YoloV5";
         case ProducerMode::RetinaFace:  return "RetinaFace";
+        case ProducerMode::YoloFace:    return "YoloFace";
+        case ProducerMode::Replay:      return "Replay";
         default:                        return "Unknown";
     }
 }
@@ -12,12 +12,53 @@
 #include "simple_ipc/simple_ipc_producer.h"
 #include "yolov5/yolo_producer.h"
 #include "retainface/retinaface_producer.h"
+#include "replay/replay_producer.h"
+#include "common/capture_core.h"
+#include "common/model_cache.h"
 #include "common/logger.h"
+#include "common/startup_timeline.h"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <thread>
 
 namespace media {
 
+namespace {
+
+/// 按需请求等待 mutex_ 时的轮询间隔（普通持锁者只做查询，很快释放）
+constexpr auto kRequestLockPoll = std::chrono::microseconds(500);
+
+}  // namespace
+
+/**
+ * @brief 停止生产者 / 移除消费者期间置位 reconfiguring_（在 mutex_ 内构造与析构）
+ *
+ * 这段时间持锁者可能在等待消费者回调返回，回调里的按需请求不能再等 mutex_
+ */
+class MediaManager::ReconfigureScope {
+public:
+    explicit ReconfigureScope(MediaManager& mgr) : mgr_(mgr) { mgr_.reconfiguring_ = true; }
+
+    ~ReconfigureScope() {
+        mgr_.reconfiguring_ = false;
+        // 补发重配置期间 SetStreamBitrate() 未能下发的目标码率
+        if (mgr_.main_bitrate_pending_.exchange(false)) {
+            mgr_.ApplyStreamBitrate(StreamSelector::kMain);
+        }
+        if (mgr_.sub_bitrate_pending_.exchange(false)) {
+            mgr_.ApplyStreamBitrate(StreamSelector::kSub);
+        }
+    }
+
+    ReconfigureScope(const ReconfigureScope&) = delete;
+    ReconfigureScope& operator=(const ReconfigureScope&) = delete;
+
+private:
+    MediaManager& mgr_;
+};
+
 // ============================================================================
 // 单例实现
 // ============================================================================
@@ -37,6 +78,7 @@ MediaManager::~MediaManager() {
 
 int MediaManager::Init(ProducerMode mode, const ProducerConfig& config) {
     std::lock_guard<std::mutex> lock(mutex_);
+    ReconfigureScope reconfigure(*this);
     
     if (initialized_) {
         LOG_WARN("Media manager already initialized");
@@ -48,17 +90,63 @@ int MediaManager::Init(ProducerMode mode, const ProducerConfig& config) {
     
     LOG_INFO("Initializing media manager with mode: {}", ProducerModeToString(mode));
     
+    // 模型缓存策略（常驻模型 + 内存上限），按需预加载
+    rknn::ModelCacheConfig cache_cfg;
+    cache_cfg.warm_models = config_.warm_models;
+    cache_cfg.memory_limit_bytes = static_cast<size_t>(std::max(0, config_.model_cache_mb)) << 20;
+    rknn::ModelCache::Instance().Configure(cache_cfg);
+    if (config_.preload_models && !config_.warm_models.empty()) {
+        // 后台预加载：rknn_init 与 ISP/VI 初始化并行，不推迟首帧
+        preload_ = std::async(std::launch::async, [this, names = config_.warm_models]() {
+            StartupTimeline::Scope scope("model_preload");
+            PreloadModels(names);
+        });
+    }
+    
+    detection_events_.Configure(config_.detection_events);
+    
+    // 持有采集核心引用，使 ISP/VI 在模式切换期间保持运行（回放模式不需要 sensor）
+    auto res = config_.GetResolutionConfig();
+    int ret = 0;
+    if (mode != ProducerMode::Replay) {
+        StartupTimeline::Scope scope("capture_core");
+        ret = CaptureCore::Instance().Acquire(res.width, res.height);
+        if (ret != 0) {
+            LOG_ERROR("Failed to start capture core");
+            WaitPreload();
+            return -1;
+        }
+        capture_pinned_ = true;
+    }
+    
+    // AI 模式直接启动时等待预加载完成，避免同一模型被并发加载两次
+    if (mode != ProducerMode::SimpleIPC) {
+        WaitPreload();
+    }
+    
     // 创建生产者实例
     producer_ = CreateProducerInstance(mode);
     if (!producer_) {
         LOG_ERROR("Failed to create producer for mode: {}", ProducerModeToString(mode));
+        if (capture_pinned_) {
+            CaptureCore::Instance().Release();
+            capture_pinned_ = false;
+        }
         return -1;
     }
     
     // 初始化生产者
-    if (producer_->Init() != 0) {
+    {
+        StartupTimeline::Scope scope("producer_init");
+        ret = producer_->Init();
+    }
+    if (ret != 0) {
         LOG_ERROR("Failed to initialize producer");
         producer_.reset();
+        if (capture_pinned_) {
+            CaptureCore::Instance().Release();
+            capture_pinned_ = false;
+        }
         return -1;
     }
     
@@ -69,6 +157,7 @@ int MediaManager::Init(ProducerMode mode, const ProducerConfig& config) {
 
 int MediaManager::Deinit() {
     std::lock_guard<std::mutex> lock(mutex_);
+    ReconfigureScope reconfigure(*this);
     
     if (!initialized_) {
         return 0;
@@ -80,6 +169,14 @@ int MediaManager::Deinit() {
         producer_.reset();
     }
     
+    if (capture_pinned_) {
+        CaptureCore::Instance().Release();
+        capture_pinned_ = false;
+    }
+    
+    WaitPreload();
+    rknn::ModelCache::Instance().Clear();
+    
     initialized_ = false;
     LOG_INFO("Media manager deinitialized");
     return 0;
@@ -87,6 +184,7 @@ int MediaManager::Deinit() {
 
 bool MediaManager::Start() {
     std::lock_guard<std::mutex> lock(mutex_);
+    ReconfigureScope reconfigure(*this);
     
     if (!initialized_ || !producer_) {
         LOG_ERROR("Media manager not initialized");
@@ -101,6 +199,7 @@ bool MediaManager::Start() {
         LOG_ERROR("Failed to start producer");
         return false;
     }
+    ApplyFrameRateLimit();
     
     LOG_INFO("Media manager started with mode: {}", ProducerModeToString(current_mode_));
     return true;
@@ -108,6 +207,7 @@ bool MediaManager::Start() {
 
 void MediaManager::Stop() {
     std::lock_guard<std::mutex> lock(mutex_);
+    ReconfigureScope reconfigure(*this);
     
     if (producer_) {
         producer_->Stop();
@@ -127,6 +227,7 @@ bool MediaManager::IsRunning() const {
 
 int MediaManager::SwitchMode(ProducerMode mode) {
     std::lock_guard<std::mutex> lock(mutex_);
+    ReconfigureScope reconfigure(*this);
     
     if (!initialized_) {
         LOG_ERROR("Media manager not initialized");
@@ -138,11 +239,20 @@ int MediaManager::SwitchMode(ProducerMode mode) {
         return 0;
     }
     
+    // 回放模式没有采集核心，也不占用 sensor，只能在 Init() 时选定
+    if (mode == ProducerMode::Replay || current_mode_ == ProducerMode::Replay) {
+        LOG_WARN("Cannot switch between Replay and {} at runtime",
+                 ProducerModeToString(mode == ProducerMode::Replay ? current_mode_ : mode));
+        return -1;
+    }
+    
     ProducerMode old_mode = current_mode_;
     
-    LOG_INFO(">>> Mode switch: {} -> {} (cold start)",
+    bool warm = capture_pinned_ && CaptureCore::Instance().IsRunning();
+    LOG_INFO(">>> Mode switch: {} -> {} ({})",
              ProducerModeToString(old_mode),
-             ProducerModeToString(mode));
+             ProducerModeToString(mode),
+             warm ? "warm, capture core kept alive" : "cold start");
     
     auto start_time = std::chrono::steady_clock::now();
     
@@ -152,14 +262,17 @@ int MediaManager::SwitchMode(ProducerMode mode) {
         producer_->Stop();
     }
     
-    // 2. 销毁当前生产者（触发析构函数，释放硬件资源）
+    // 2. 销毁当前生产者（释放 VPSS/VENC/推理引擎，采集核心由管理器保持）
     if (producer_) {
         producer_->Deinit();
         producer_.reset();
-        LOG_DEBUG("Old producer destroyed, hardware resources released");
+        LOG_DEBUG("Old producer destroyed, VPSS/VENC released");
     }
     
-    // 3. 创建新生产者
+    auto teardown_time = std::chrono::steady_clock::now();
+    
+    // 3. 创建新生产者（启动期的后台预加载未完成时先等待，新生产者直接命中缓存）
+    WaitPreload();
     producer_ = CreateProducerInstance(mode);
     if (!producer_) {
         LOG_ERROR("Failed to create new producer, reverting...");
@@ -185,6 +298,8 @@ int MediaManager::SwitchMode(ProducerMode mode) {
         return -1;
     }
     
+    auto init_time = std::chrono::steady_clock::now();
+    
     current_mode_ = mode;
     mode_switch_count_++;
     
@@ -194,13 +309,28 @@ int MediaManager::SwitchMode(ProducerMode mode) {
     // 6. 如果之前在运行，重新启动
     if (was_running) {
         producer_->Start();
+        ApplyFrameRateLimit();
     }
     
     auto end_time = std::chrono::steady_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-    
-    LOG_INFO("<<< Mode switch completed in {}ms (switch count: {})",
-             duration.count(), mode_switch_count_);
+    auto to_ms = [](std::chrono::steady_clock::duration d) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+    };
+    
+    switch_stats_.count = mode_switch_count_;
+    switch_stats_.last_ms = to_ms(end_time - start_time);
+    switch_stats_.last_teardown_ms = to_ms(teardown_time - start_time);
+    switch_stats_.last_init_ms = to_ms(init_time - teardown_time);
+    switch_stats_.max_ms = std::max(switch_stats_.max_ms, switch_stats_.last_ms);
+    switch_total_ms_ += switch_stats_.last_ms;
+    switch_stats_.avg_ms = static_cast<double>(switch_total_ms_) / mode_switch_count_;
+    switch_stats_.warm = warm;
+    switch_stats_.last_from = old_mode;
+    switch_stats_.last_to = mode;
+    
+    LOG_INFO("<<< Mode switch completed in {}ms (teardown {}ms, init {}ms, switch count: {})",
+             switch_stats_.last_ms, switch_stats_.last_teardown_ms,
+             switch_stats_.last_init_ms, mode_switch_count_);
     
     // 7. 通知回调
     if (mode_switch_callback_) {
@@ -216,6 +346,7 @@ int MediaManager::SwitchMode(ProducerMode mode) {
 
 int MediaManager::SetResolution(Resolution preset) {
     std::lock_guard<std::mutex> lock(mutex_);
+    ReconfigureScope reconfigure(*this);
     
     if (!initialized_ || !producer_) {
         config_.resolution = preset;
@@ -240,6 +371,7 @@ int MediaManager::SetResolution(Resolution preset) {
     
     if (was_running) {
         producer_->Start();
+        ApplyFrameRateLimit();
     }
     
     LOG_INFO("Resolution changed to {}", static_cast<int>(preset));
@@ -259,6 +391,126 @@ int MediaManager::SetFrameRate(int fps) {
     return 0;
 }
 
+// ============================================================================
+// 编码器运行时控制
+// ============================================================================
+
+int MediaManager::SetStreamBitrate(StreamSelector stream, int kbps) {
+    auto& override_kbps = (stream == StreamSelector::kSub) ? sub_bitrate_override_kbps_
+                                                           : main_bitrate_override_kbps_;
+    auto& pending = (stream == StreamSelector::kSub) ? sub_bitrate_pending_
+                                                     : main_bitrate_pending_;
+    override_kbps.store(std::max(kbps, 0));
+
+    // 统计查询等短暂持锁时等待；重配置进行中时不阻塞网络线程，
+    // 标记待下发后返回，由 ReconfigureScope 结束时补发
+    std::unique_lock<std::mutex> lock;
+    while (!LockForRequest(lock)) {
+        pending = true;
+        if (reconfiguring_.load()) {
+            return -1;
+        }
+    }
+    return ApplyStreamBitrate(stream);
+}
+
+int MediaManager::SetFrameRateLimit(int fps) {
+    framerate_limit_.store(std::max(fps, 0));
+
+    // 在调度线程调用，可以等待：统计查询 / 模式切换持锁时排队，解除限制不会丢失
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!producer_ || !producer_->IsRunning()) {
+        // 生产者只在运行中把帧率作用于 VENC 输出，由 ApplyFrameRateLimit() 在启动后下发
+        return 0;
+    }
+    return producer_->SetFrameRate(fps > 0 ? std::min(fps, config_.framerate) : config_.framerate);
+}
+
+int MediaManager::SetInferenceDivisor(int divisor) {
+    divisor = std::max(divisor, 1);
+    inference_divisor_.store(divisor);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!producer_ || current_mode_ == ProducerMode::SimpleIPC ||
+        current_mode_ == ProducerMode::Replay) {
+        // 非 AI 模式只记录，切换到 AI 模式后由 ApplyRuntimeOverrides() 下发
+        return 0;
+    }
+    return producer_->SetInferenceDivisor(divisor);
+}
+
+int MediaManager::RequestKeyFrame(StreamSelector stream, const char* reason) {
+    std::unique_lock<std::mutex> lock;
+    if (!LockForRequest(lock) || !producer_) {
+        return -1;
+    }
+    return producer_->RequestKeyFrame(stream, reason);
+}
+
+std::vector<EncodedStreamPtr> MediaManager::GetGopSnapshot(StreamSelector stream) {
+    std::unique_lock<std::mutex> lock;
+    if (!LockForRequest(lock) || !producer_) {
+        return {};
+    }
+    return producer_->GetGopSnapshot(stream);
+}
+
+int MediaManager::CaptureSnapshot(const SnapshotRequest& request, Snapshot* out) {
+    // HTTP 工作线程可以阻塞：统计查询 / 模式切换持锁时排队，切换完成后从新生产者抓拍
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!producer_) {
+        return -1;
+    }
+    return producer_->CaptureSnapshot(request, out);
+}
+
+int MediaManager::ApplyStreamBitrate(StreamSelector stream) {
+    if (!producer_) {
+        return -1;
+    }
+    int kbps = (stream == StreamSelector::kSub) ? sub_bitrate_override_kbps_.load()
+                                                : main_bitrate_override_kbps_.load();
+    if (kbps <= 0) {
+        kbps = (stream == StreamSelector::kSub) ? config_.sub_bitrate_kbps : config_.bitrate_kbps;
+    }
+    return producer_->SetBitrate(stream, kbps);
+}
+
+bool MediaManager::LockForRequest(std::unique_lock<std::mutex>& lock) {
+    // 统计查询等普通持锁者很快释放，等待即可；重配置期间持锁者可能在等待本线程的
+    // 消费者回调返回，只能放弃（新生产者 / 重新注册的消费者本来就从 IDR 开始）
+    lock = std::unique_lock<std::mutex>(mutex_, std::defer_lock);
+    while (!lock.try_lock()) {
+        if (reconfiguring_.load()) {
+            return false;
+        }
+        std::this_thread::sleep_for(kRequestLockPoll);
+    }
+    return true;
+}
+
+void MediaManager::ApplyRuntimeOverrides() {
+    if (!producer_) return;
+    
+    int main_kbps = main_bitrate_override_kbps_.load();
+    if (main_kbps > 0) {
+        producer_->SetBitrate(StreamSelector::kMain, main_kbps);
+    }
+    int sub_kbps = sub_bitrate_override_kbps_.load();
+    if (sub_kbps > 0) {
+        producer_->SetBitrate(StreamSelector::kSub, sub_kbps);
+    }
+    // 新生产者默认不降速，恢复值 1 也照常下发（非 AI 模式直接忽略）
+    producer_->SetInferenceDivisor(inference_divisor_.load());
+}
+
+void MediaManager::ApplyFrameRateLimit() {
+    int limit = framerate_limit_.load();
+    if (producer_ && limit > 0 && limit < config_.framerate) {
+        producer_->SetFrameRate(limit);
+    }
+}
+
 // ============================================================================
 // 流消费者管理
 // ============================================================================
@@ -267,23 +519,52 @@ void MediaManager::RegisterStreamConsumer(
     const std::string& name,
     StreamCallback callback,
     StreamConsumerType type,
-    int queue_size) {
+    int queue_size,
+    QueueDropPolicy drop_policy,
+    StreamSelector stream,
+    const std::string& strand) {
     
     std::lock_guard<std::mutex> lock(mutex_);
     
     // 保存到列表
-    consumers_.push_back({name, callback, type, queue_size});
+    consumers_.push_back({name, callback, type, queue_size, drop_policy, stream, strand});
     
     // 如果已有生产者，直接注册
     if (producer_) {
-        producer_->RegisterStreamConsumer(name, callback, type, queue_size);
+        producer_->RegisterStreamConsumer(name, callback, type, queue_size, drop_policy, stream,
+                                          strand);
     }
     
-    LOG_DEBUG("Stream consumer registered: {}", name);
+    LOG_DEBUG("Stream consumer registered: {} ({} stream)", name, StreamSelectorToString(stream));
+}
+
+int MediaManager::SetConsumerStream(const std::string& name, StreamSelector stream) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ReconfigureScope reconfigure(*this);
+    
+    auto it = std::find_if(consumers_.begin(), consumers_.end(),
+                           [&name](const StreamConsumerRegistration& c) { return c.name == name; });
+    if (it == consumers_.end()) {
+        return -1;
+    }
+    if (it->stream == stream) {
+        return 0;
+    }
+    it->stream = stream;
+    
+    if (producer_) {
+        producer_->RemoveStreamConsumer(name);
+        producer_->RegisterStreamConsumer(it->name, it->callback, it->type, it->queue_size,
+                                          it->drop_policy, it->stream, it->strand);
+    }
+    
+    LOG_INFO("Stream consumer {} moved to {} stream", name, StreamSelectorToString(stream));
+    return 0;
 }
 
 void MediaManager::ClearStreamConsumers() {
     std::lock_guard<std::mutex> lock(mutex_);
+    ReconfigureScope reconfigure(*this);
     
     consumers_.clear();
     if (producer_) {
@@ -291,13 +572,60 @@ void MediaManager::ClearStreamConsumers() {
     }
 }
 
+std::vector<StreamConsumerStats> MediaManager::GetStreamConsumerStats() const {
+    std::lock_guard<std::mutex> lock(const_cast<std::mutex&>(mutex_));
+    if (producer_) {
+        return producer_->GetStreamConsumerStats();
+    }
+    return {};
+}
+
+ProducerStats MediaManager::GetProducerStats() const {
+    std::lock_guard<std::mutex> lock(const_cast<std::mutex&>(mutex_));
+    if (producer_) {
+        return producer_->GetProducerStats();
+    }
+    return {};
+}
+
+ModeSwitchStats MediaManager::GetModeSwitchStats() const {
+    std::lock_guard<std::mutex> lock(const_cast<std::mutex&>(mutex_));
+    return switch_stats_;
+}
+
+void MediaManager::PreloadModels(const std::vector<std::string>& names) {
+    for (const auto& name : names) {
+        auto type = rknn::StringToModelType(name);
+        int ret = -1;
+        if (type == rknn::ModelType::kYoloV5) {
+            ret = YoloProducer::PreloadModel();
+        } else if (type == rknn::ModelType::kRetinaFace) {
+            ret = RetinaFaceProducer::PreloadModel();
+        } else {
+            LOG_WARN("Unknown warm model: {}", name);
+            continue;
+        }
+        if (ret != 0) {
+            LOG_WARN("Failed to preload model: {} (will load on first use)", name);
+        }
+    }
+}
+
+void MediaManager::WaitPreload() {
+    if (preload_.valid()) {
+        preload_.get();
+    }
+}
+
 void MediaManager::ReregisterConsumers() {
     if (!producer_) return;
     
     producer_->ClearStreamConsumers();
     for (const auto& c : consumers_) {
-        producer_->RegisterStreamConsumer(c.name, c.callback, c.type, c.queue_size);
+        producer_->RegisterStreamConsumer(c.name, c.callback, c.type, c.queue_size,
+                                          c.drop_policy, c.stream, c.strand);
     }
+    ApplyRuntimeOverrides();
     
     LOG_DEBUG("Reregistered {} stream consumers", consumers_.size());
 }
@@ -311,6 +639,16 @@ void MediaManager::SetModeSwitchCallback(ModeSwitchCallback callback) {
     mode_switch_callback_ = std::move(callback);
 }
 
+void MediaManager::AddDetectionListener(DetectionCallback listener) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto current = std::atomic_load(&detection_listeners_);
+    auto next = current ? std::make_shared<std::vector<DetectionCallback>>(*current)
+                        : std::make_shared<std::vector<DetectionCallback>>();
+    next->push_back(std::move(listener));
+    std::atomic_store(&detection_listeners_,
+                      std::shared_ptr<const std::vector<DetectionCallback>>(std::move(next)));
+}
+
 // ============================================================================
 // 状态查询
 // ============================================================================
@@ -330,27 +668,60 @@ const char* MediaManager::GetCurrentTypeName() const {
 std::unique_ptr<IMediaProducer> MediaManager::CreateProducerInstance(ProducerMode mode) {
     // AI 模式（YoloV5/RetinaFace）推荐使用 480p 以降低 DDR 带宽压力
     ProducerConfig mode_config = config_;
+    std::unique_ptr<IMediaProducer> producer;
     
     switch (mode) {
         case ProducerMode::SimpleIPC:
             // SimpleIPC 使用用户配置的分辨率（默认 1080p）
-            return CreateSimpleIPCProducer(mode_config);
+            producer = CreateSimpleIPCProducer(mode_config);
+            break;
             
         case ProducerMode::YoloV5:
         case ProducerMode::RetinaFace:
+        case ProducerMode::YoloFace:
             // AI 模式强制使用 480p，避免 DDR 带宽瓶颈
             mode_config.resolution = Resolution::R_480P;
             LOG_INFO("AI mode: using 480p resolution for DDR bandwidth optimization");
             if (mode == ProducerMode::YoloV5) {
-                return CreateYoloProducer(mode_config);
+                producer = CreateYoloProducer(mode_config);
+            } else if (mode == ProducerMode::RetinaFace) {
+                producer = CreateRetinaFaceProducer(mode_config);
             } else {
-                return CreateRetinaFaceProducer(mode_config);
+                producer = CreateYoloFaceProducer(mode_config);
             }
+            break;
+            
+        case ProducerMode::Replay:
+            producer = CreateReplayProducer(mode_config);
+            break;
             
         default:
             LOG_ERROR("Unknown producer mode: {}", static_cast<int>(mode));
             return nullptr;
     }
+    
+    // 检测结果接入事件引擎（新模式的事件从头判定）与监听者
+    if (producer) {
+        detection_events_.Reset();
+        std::atomic_store(&latest_detections_, std::shared_ptr<const LatestDetections>());
+        producer->SetDetectionCallback(
+            [this](const rknn::DetectionResultList& results, int width, int height) {
+                detection_events_.OnDetections(results, width, height);
+                auto latest = std::make_shared<LatestDetections>();
+                latest->results = results;
+                latest->frame_width = width;
+                latest->frame_height = height;
+                std::atomic_store(&latest_detections_,
+                                  std::shared_ptr<const LatestDetections>(std::move(latest)));
+                auto listeners = std::atomic_load(&detection_listeners_);
+                if (listeners) {
+                    for (const auto& listener : *listeners) {
+                        listener(results, width, height);
+                    }
+                }
+            });
+    }
+    return producer;
 }
 
 // ============================================================================
@@ -365,6 +736,10 @@ std::unique_ptr<IMediaProducer> CreateProducer(ProducerMode mode, const Producer
             return CreateYoloProducer(config);
         case ProducerMode::RetinaFace:
             return CreateRetinaFaceProducer(config);
+        case ProducerMode::YoloFace:
+            return CreateYoloFaceProducer(config);
+        case ProducerMode::Replay:
+            return CreateReplayProducer(config);
         default:
             return nullptr;
     }
@@ -7,17 +7,20 @@
  * 核心职责：
  * 1. 持有基类指针 (unique_ptr<IMediaProducer>)
  * 2. 管理生产者的生命周期
- * 3. 实现"冷切换"逻辑：销毁旧实例 -> 创建新实例 -> 重新连线
+ * 3. 实现"暖切换"逻辑：销毁旧实例 -> 创建新实例 -> 重新连线
  * 4. 保存流消费者注册信息，模式切换时自动重新注册
  *
- * 冷切换流程：
+ * 暖切换流程：
  * 1. 停止当前生产者 (Stop)
- * 2. 销毁当前生产者 (触发析构函数，释放硬件资源)
+ * 2. 销毁当前生产者 (释放 VPSS/VENC/推理引擎)
  * 3. 创建新生产者 (根据目标模式)
- * 4. 初始化新生产者 (分配硬件资源)
+ * 4. 初始化新生产者 (重建 VPSS/VENC 绑定、加载推理引擎)
  * 5. 重新注册流消费者
  * 6. 启动新生产者 (Start)
  *
+ * 管理器在 Init ~ Deinit 期间持有共享采集核心 (CaptureCore) 的一份引用，
+ * ISP/VI/MPI 系统在切换过程中保持运行，不会出现 ISP 重启带来的长时间黑屏。
+ *
  * @author 好软，好温暖
  * @date 2026-02-12
  */
@@ -26,10 +29,12 @@
 
 #include "i_media_producer.h"
 
+#include <atomic>
 #include <memory>
 #include <vector>
 #include <mutex>
 #include <functional>
+#include <future>
 #include <string>
 
 namespace media {
@@ -42,6 +47,33 @@ struct StreamConsumerRegistration {
     StreamCallback callback;
     StreamConsumerType type = StreamConsumerType::AsyncIO;
     int queue_size = 3;
+    QueueDropPolicy drop_policy = QueueDropPolicy::DropToKeyframe;
+    StreamSelector stream = StreamSelector::kMain;
+    std::string strand;             ///< AsyncIO 回调所在的 IO strand（为空时使用 name）
+};
+
+/**
+ * @brief 模式切换耗时统计
+ */
+struct ModeSwitchStats {
+    uint64_t count = 0;             ///< 成功切换次数
+    int64_t last_ms = 0;            ///< 最近一次切换总耗时（毫秒）
+    int64_t last_teardown_ms = 0;   ///< 最近一次：停止并销毁旧生产者耗时
+    int64_t last_init_ms = 0;       ///< 最近一次：创建并初始化新生产者耗时
+    int64_t max_ms = 0;             ///< 历史最大切换耗时
+    double avg_ms = 0.0;            ///< 平均切换耗时
+    bool warm = false;              ///< 最近一次切换期间采集核心是否保持运行
+    ProducerMode last_from = ProducerMode::SimpleIPC;
+    ProducerMode last_to = ProducerMode::SimpleIPC;
+};
+
+/**
+ * @brief 最近一次检测结果（坐标已映射到主码流画面）
+ */
+struct LatestDetections {
+    rknn::DetectionResultList results;
+    int frame_width = 0;
+    int frame_height = 0;
 };
 
 /**
@@ -72,7 +104,7 @@ using ModeSwitchCallback = std::function<void(ProducerMode old_mode, ProducerMod
  * // 启动
  * mgr.Start();
  * 
- * // 切换到 YOLOv5 模式（冷切换）
+ * // 切换到 YOLOv5 模式（暖切换，ISP/VI 保持运行）
  * mgr.SwitchMode(ProducerMode::YoloV5);
  * 
  * // 切回纯 IPC 模式
@@ -99,7 +131,7 @@ public:
     /**
      * @brief 初始化媒体管理器
      * 
-     * @param mode 初始模式
+     * @param mode 初始模式（Replay 模式不启动采集核心）
      * @param config 配置参数
      * @return 0 成功，-1 失败
      */
@@ -125,14 +157,16 @@ public:
     // ========== 模式切换 ==========
 
     /**
-     * @brief 切换生产者模式（冷切换）
+     * @brief 切换生产者模式（暖切换）
      * 
-     * 执行完整的"销毁-创建-连线"流程。
+     * 执行"销毁-创建-连线"流程，ISP/VI/MPI 系统由采集核心保持运行，
+     * 只重建 VPSS/VENC 与推理引擎。耗时记录在 GetModeSwitchStats()。
      * 
      * @param mode 目标模式
      * @return 0 成功，-1 失败
      * 
      * @note 切换过程中会有短暂的停流时间
+     * @note Replay 模式与其他模式之间不可切换（返回 -1）
      */
     int SwitchMode(ProducerMode mode);
 
@@ -172,6 +206,77 @@ public:
      */
     const ProducerConfig& GetConfig() const { return config_; }
 
+    // ========== 编码器运行时控制 ==========
+
+    /**
+     * @brief 调整指定码流的编码码率（WebRTC 自适应码率）
+     * 
+     * 目标码率会被记住，模式切换 / 重新初始化后自动重新下发；kbps <= 0 表示恢复配置码率。
+     * 可在网络线程中调用：统计查询等短暂持锁时等待；模式切换等重配置进行中时只记录目标，
+     * 不等待切换完成，重配置结束时补发。
+     * 
+     * @param stream 目标码流（子码流未启用时不回退到主码流）
+     * @param kbps 目标码率
+     * @return 0 已下发，-1 未下发（重配置中，稍后补发 / 不支持 / 失败）
+     */
+    int SetStreamBitrate(StreamSelector stream, int kbps);
+
+    /**
+     * @brief 运行中限制主码流输出帧率（负载调度降级）
+     * 
+     * 与 SetFrameRate() 不同，不修改配置帧率：限制值被记住，模式切换后自动重新下发；
+     * fps <= 0 表示解除限制、恢复配置帧率。持锁下发，模式切换进行中时等待切换完成
+     * 
+     * @param fps 帧率上限
+     * @return 0 已下发（生产者未运行时已记录，启动后下发），-1 不支持或失败
+     */
+    int SetFrameRateLimit(int fps);
+
+    /**
+     * @brief 推理降速：每 divisor 次推理机会只运行一次（负载调度降级）
+     * 
+     * 降速倍数被记住，切换到 AI 模式后自动重新下发；非 AI 模式下只记录。
+     * 持锁下发，模式切换进行中时等待切换完成
+     * 
+     * @param divisor 降速倍数（1 = 恢复）
+     * @return 0 已下发（非 AI 模式下已记录），-1 失败
+     */
+    int SetInferenceDivisor(int divisor);
+
+    /**
+     * @brief 请求指定码流尽快输出 IDR 帧（限频并跨消费者合并）
+     * 
+     * 可在网络线程 / 消费者回调中调用：统计查询等短暂持锁时等待；模式切换、
+     * 移除消费者等重配置进行中时直接忽略（新生产者 / 重新注册的消费者以 IDR 开始）
+     * 
+     * @param stream 目标码流
+     * @param reason 请求来源（用于日志）
+     * @return 0 已下发或已合并，-1 失败或正在重配置
+     */
+    int RequestKeyFrame(StreamSelector stream, const char* reason = nullptr);
+
+    /**
+     * @brief 获取指定码流 GOP 缓存的快照（新客户端先补发缓存帧再接实时帧）
+     * 
+     * 可在网络线程 / 消费者回调中调用：统计查询等短暂持锁时等待；重配置进行中时
+     * 返回空（调用方退回到请求 IDR）
+     * 
+     * @param stream 目标码流
+     * @return 缓存帧，首帧为关键帧；缓存未开启 / 为空 / 正在重配置时为空
+     */
+    std::vector<EncodedStreamPtr> GetGopSnapshot(StreamSelector stream);
+
+    /**
+     * @brief 抓拍一张 JPEG（/api/snapshot）
+     * 
+     * 在 HTTP 工作线程调用，阻塞至编码完成（通常一帧时间）；模式切换进行中时等待切换完成
+     * 
+     * @param request 目标尺寸
+     * @param out 抓拍结果
+     * @return 0 成功，-1 失败或未启用
+     */
+    int CaptureSnapshot(const SnapshotRequest& request, Snapshot* out);
+
     // ========== 流消费者管理 ==========
 
     /**
@@ -183,18 +288,73 @@ public:
      * @param callback 回调函数
      * @param type 消费者类型
      * @param queue_size 队列大小
+     * @param drop_policy 队列满时的丢帧策略（Queued / AsyncIO）
+     * @param stream 订阅主码流或子码流（子码流未启用时回退到主码流）
+     * @param strand AsyncIO 回调所在的 IO strand（同名共享，如 RTSP 主 / 子码流共用 "rtsp"）
      */
     void RegisterStreamConsumer(
         const std::string& name,
         StreamCallback callback,
         StreamConsumerType type = StreamConsumerType::AsyncIO,
-        int queue_size = 3);
+        int queue_size = 3,
+        QueueDropPolicy drop_policy = QueueDropPolicy::DropToKeyframe,
+        StreamSelector stream = StreamSelector::kMain,
+        const std::string& strand = {});
+
+    /**
+     * @brief 运行中改变已注册消费者订阅的码流（负载调度把预览切到子码流等）
+     * 
+     * 只移除并重新注册该消费者，其余消费者不受影响；新码流从下一个关键帧开始投递，
+     * 调用方负责请求 IDR
+     * 
+     * @param name 消费者名称
+     * @param stream 新的码流（子码流未启用时回退到主码流）
+     * @return 0 成功或未变化，-1 未找到该消费者
+     */
+    int SetConsumerStream(const std::string& name, StreamSelector stream);
 
     /**
      * @brief 清除所有流消费者
      */
     void ClearStreamConsumers();
 
+    /**
+     * @brief 获取当前生产者中各消费者的统计信息
+     */
+    std::vector<StreamConsumerStats> GetStreamConsumerStats() const;
+
+    /**
+     * @brief 获取当前生产者的视频/推理帧率统计
+     */
+    ProducerStats GetProducerStats() const;
+
+    // ========== 检测事件 ==========
+
+    /**
+     * @brief 检测事件引擎（AI 模式的检测结果按规则触发事件录制）
+     * 
+     * 规则来自 ProducerConfig::detection_events，可在运行时重新 Configure()；
+     * 触发回调由调用方连接到录制服务。引擎自身线程安全，无需持有管理器锁。
+     */
+    DetectionEventEngine& DetectionEvents() { return detection_events_; }
+
+    /**
+     * @brief 添加检测结果监听者（如检测元数据推送），跨模式切换保持
+     *
+     * 回调在推理线程调用，坐标已映射到主码流画面，结果带来源帧 PTS；
+     * 回调不得阻塞，耗时工作应投递到自己的 strand。
+     */
+    void AddDetectionListener(DetectionCallback listener);
+
+    /**
+     * @brief 获取最近一次检测结果（抓拍附带检测信息等）
+     *
+     * @return 当前 AI 模式下的最新结果；非 AI 模式或尚未推理时为空
+     */
+    std::shared_ptr<const LatestDetections> GetLatestDetections() const {
+        return std::atomic_load(&latest_detections_);
+    }
+
     // ========== 回调设置 ==========
 
     /**
@@ -214,6 +374,11 @@ public:
      */
     uint64_t GetModeSwitchCount() const { return mode_switch_count_; }
 
+    /**
+     * @brief 获取模式切换耗时统计
+     */
+    ModeSwitchStats GetModeSwitchStats() const;
+
 private:
     MediaManager() = default;
     ~MediaManager();
@@ -224,13 +389,51 @@ private:
     std::unique_ptr<IMediaProducer> CreateProducerInstance(ProducerMode mode);
 
     /**
-     * @brief 重新注册所有流消费者
+     * @brief 预加载常驻模型到模型缓存（Init 时在后台线程执行）
+     */
+    void PreloadModels(const std::vector<std::string>& names);
+
+    /**
+     * @brief 等待后台预加载完成（创建 AI 生产者、清空模型缓存之前调用）
+     */
+    void WaitPreload();
+
+    /**
+     * @brief 重新注册所有流消费者（并重新下发运行时调整）
      */
     void ReregisterConsumers();
 
+    /**
+     * @brief 对当前生产者下发 SetStreamBitrate() / SetInferenceDivisor() 记录的运行时调整
+     */
+    void ApplyRuntimeOverrides();
+
+    /**
+     * @brief 对已启动的生产者下发 SetFrameRateLimit() 记录的帧率上限
+     *
+     * 生产者只在运行中把帧率作用于 VENC 输出，须在 Start() 之后调用
+     */
+    void ApplyFrameRateLimit();
+
 private:
+    class ReconfigureScope;
+
+    /**
+     * @brief 按需请求（IDR / GOP 快照）获取 mutex_
+     *
+     * 持锁者只是短暂查询时等待；持锁者正在停止生产者或移除消费者时返回 false，
+     * 避免在消费者回调中等锁而与等待该回调返回的持锁者互相等待
+     */
+    bool LockForRequest(std::unique_lock<std::mutex>& lock);
+
+    /// 按 SetStreamBitrate() 记录的目标（0 = 配置码率）下发指定码流码率（持有 mutex_）
+    int ApplyStreamBitrate(StreamSelector stream);
+
     std::mutex mutex_;
     
+    // 停止生产者 / 移除消费者期间置位（见 ReconfigureScope）
+    std::atomic<bool> reconfiguring_{false};
+    
     bool initialized_ = false;
     ProducerMode current_mode_ = ProducerMode::SimpleIPC;
     ProducerConfig config_;
@@ -238,14 +441,42 @@ private:
     // 当前生产者实例
     std::unique_ptr<IMediaProducer> producer_;
     
+    // 是否持有共享采集核心引用（暖切换）
+    bool capture_pinned_ = false;
+    
+    // 启动期后台模型预加载（与 ISP/VI 初始化并行）
+    std::future<void> preload_;
+    
     // 保存的流消费者列表（用于模式切换后重新注册）
     std::vector<StreamConsumerRegistration> consumers_;
     
+    // SetStreamBitrate() 记录的目标码率（0 = 使用配置码率）
+    std::atomic<int> main_bitrate_override_kbps_{0};
+    std::atomic<int> sub_bitrate_override_kbps_{0};
+    // 重配置期间未能下发的码率调整（ReconfigureScope 结束时补发）
+    std::atomic<bool> main_bitrate_pending_{false};
+    std::atomic<bool> sub_bitrate_pending_{false};
+    
+    // SetFrameRateLimit() 记录的帧率上限（0 = 不限制）与 SetInferenceDivisor() 记录的降速倍数
+    std::atomic<int> framerate_limit_{0};
+    std::atomic<int> inference_divisor_{1};
+    
     // 回调
     ModeSwitchCallback mode_switch_callback_;
     
+    // 检测事件引擎（生产者的检测结果回调指向这里）
+    DetectionEventEngine detection_events_;
+    
+    // 检测结果监听者（写时复制：推理线程无锁读取快照）
+    std::shared_ptr<const std::vector<DetectionCallback>> detection_listeners_;
+    
+    // 最近一次检测结果（推理线程整体替换，模式切换时清空）
+    std::shared_ptr<const LatestDetections> latest_detections_;
+    
     // 统计
     uint64_t mode_switch_count_ = 0;
+    ModeSwitchStats switch_stats_;
+    int64_t switch_total_ms_ = 0;
 };
 
 }  // namespace media
@@ -0,0 +1,635 @@
+/**
+ * @file replay_producer.cpp
+ * @brief 文件回放模式生产者实现
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-18
+ */
+
+#define LOG_TAG "Replay"
+
+#include "replay_producer.h"
+#include "yolov5/yolo_producer.h"
+#include "yolov5/yolov5_model.h"
+#include "retainface/retinaface_producer.h"
+#include "retainface/retinaface_model.h"
+#include "../common/image_utils.h"
+#include "../common/model_cache.h"
+#include "common/logger.h"
+#include "common/media_buffer.h"
+#include "common/stream_dispatcher.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+namespace media {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief 只读文件映射（码流帧通过 owner 引用持有，最后一帧释放后才解除映射）
+ */
+struct MappedFile {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+    ~MappedFile() {
+        if (data) {
+            munmap(const_cast<uint8_t*>(data), size);
+        }
+    }
+};
+
+std::shared_ptr<const MappedFile> MapFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR("Failed to open replay file {}: {}", path, strerror(errno));
+        return nullptr;
+    }
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        LOG_ERROR("Replay file {} is empty or unreadable", path);
+        close(fd);
+        return nullptr;
+    }
+    void* addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);   // 映射建立后 fd 不再需要
+    if (addr == MAP_FAILED) {
+        LOG_ERROR("Failed to mmap replay file {}: {}", path, strerror(errno));
+        return nullptr;
+    }
+    madvise(addr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+
+    auto file = std::make_shared<MappedFile>();
+    file->data = static_cast<const uint8_t*>(addr);
+    file->size = static_cast<size_t>(st.st_size);
+    return file;
+}
+
+/**
+ * @brief 码流文件中的一个访问单元（一帧，含参数集 / SEI 等前置 NAL）
+ */
+struct AccessUnit {
+    size_t offset = 0;          ///< 首个 NAL 起始码的偏移
+    uint32_t size = 0;
+    bool keyframe = false;      ///< 含 IDR（H.265 为 IRAP）
+};
+
+/**
+ * @brief 把 Annex-B 码流切分为访问单元
+ *
+ * 新的访问单元从以下 NAL 开始（当前单元已含 VCL 时）：
+ * - 首个 slice（H.264 first_mb_in_slice == 0 / H.265 first_slice_segment_in_pic_flag）
+ * - AUD / SPS / PPS / SEI（H.265 另含 VPS、prefix SEI）
+ */
+size_t IndexAccessUnits(const uint8_t* data, size_t size, VideoCodec codec,
+                        std::vector<AccessUnit>* units) {
+    units->clear();
+    const bool hevc = (codec == VideoCodec::kH265);
+    // 起始码之后需要读取的字节数：NAL 头 + slice 头首字节（H.265 的 NAL 头为 2 字节）
+    const size_t peek = hevc ? 3 : 2;
+    AccessUnit au;
+    bool au_open = false;
+    bool au_has_vcl = false;
+
+    size_t pos = 2;
+    while (pos < size) {
+        const void* hit = memchr(data + pos, 0x01, size - pos);
+        if (!hit) break;
+        size_t one = static_cast<size_t>(static_cast<const uint8_t*>(hit) - data);
+        pos = one + 1;
+        if (data[one - 1] != 0 || data[one - 2] != 0 || one + peek >= size) continue;
+
+        const size_t sc_offset = (one >= 3 && data[one - 3] == 0) ? one - 3 : one - 2;
+        const uint8_t* nal = data + one + 1;
+        bool vcl = false;
+        bool first_slice = false;
+        bool leading = false;
+        bool idr = false;
+        if (hevc) {
+            uint8_t type = (nal[0] >> 1) & 0x3F;
+            vcl = type < 32;
+            first_slice = vcl && (nal[2] & 0x80);
+            leading = (type >= 32 && type <= 35) || type == 39;
+            idr = type >= 16 && type <= 21;
+        } else {
+            uint8_t type = nal[0] & 0x1F;
+            vcl = type >= 1 && type <= 5;
+            first_slice = vcl && (nal[1] & 0x80);
+            leading = type >= 6 && type <= 9;
+            idr = type == 5;
+        }
+
+        if (au_open && au_has_vcl && (first_slice || leading)) {
+            au.size = static_cast<uint32_t>(sc_offset - au.offset);
+            units->push_back(au);
+            au_open = false;
+        }
+        if (!au_open) {
+            au = AccessUnit();
+            au.offset = sc_offset;
+            au_open = true;
+            au_has_vcl = false;
+        }
+        au_has_vcl = au_has_vcl || vcl;
+        au.keyframe = au.keyframe || idr;
+        pos = one + 2;
+    }
+    if (au_open && au_has_vcl) {
+        au.size = static_cast<uint32_t>(size - au.offset);
+        units->push_back(au);
+    }
+    return units->size();
+}
+
+/**
+ * @brief 读取时间戳旁路文件（每行一帧，单位秒），转换为相对首帧的微秒
+ * @return 时间戳数量与帧数一致且单调递增时返回 true
+ */
+bool LoadPtsSidecar(const std::string& path, size_t frames, std::vector<int64_t>* pts_us) {
+    pts_us->clear();
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f) {
+        return false;
+    }
+    double seconds = 0.0;
+    while (pts_us->size() < frames && fscanf(f, "%lf", &seconds) == 1) {
+        pts_us->push_back(static_cast<int64_t>(seconds * 1e6));
+    }
+    fclose(f);
+
+    bool valid = pts_us->size() == frames && frames > 0;
+    for (size_t i = 1; valid && i < pts_us->size(); ++i) {
+        valid = (*pts_us)[i] > (*pts_us)[i - 1];
+    }
+    if (!valid) {
+        LOG_WARN("Ignoring {}: {} timestamps for {} frames or not increasing", path,
+                 pts_us->size(), frames);
+        pts_us->clear();
+        return false;
+    }
+    const int64_t first = pts_us->front();
+    for (auto& pts : *pts_us) {
+        pts -= first;
+    }
+    return true;
+}
+
+/**
+ * @brief 单个模型推理：NV12 -> letterbox -> NPU -> 后处理，结果映射回原图坐标
+ */
+template <typename Model>
+bool RunModel(Model& model, rknn::ImageProcessor& processor, const rknn::ImageBuffer& src,
+              rknn::DetectionResultList* results) {
+    rknn::ImageBuffer dst;
+    model.GetInputSize(dst.width, dst.height);
+    dst.data = model.GetInputVirtAddr();
+    dst.fd = model.GetInputFd();
+
+    rknn::LetterboxInfo letterbox;
+    if (processor.ConvertNV12ToModelInput(src, dst, letterbox) != 0 || model.Run() != 0) {
+        return false;
+    }
+    model.GetResults(*results);
+    rknn::ImageProcessor::MapDetections(*results, letterbox, src.width, src.height);
+    return true;
+}
+
+}  // namespace
+
+// ============================================================================
+// ReplayProducer 内部实现
+// ============================================================================
+
+struct ReplayProducer::Impl {
+    std::shared_ptr<const MappedFile> file;
+
+    // Annex-B：访问单元索引
+    std::vector<AccessUnit> units;
+    // NV12：帧尺寸与帧数
+    int width = 0;
+    int height = 0;
+    size_t frame_bytes = 0;
+    size_t frame_count = 0;
+
+    // 帧时间（相对首帧，微秒）：旁路文件或按帧率均匀
+    std::vector<int64_t> pts_us;
+    int64_t frame_interval_us = 33333;
+    int64_t loop_span_us = 0;          // 一轮回放的时长（循环时时间戳的增量）
+
+    StreamDispatcher dispatcher;
+
+    // NV12 推理
+    std::shared_ptr<rknn::YoloV5Model> yolo;
+    std::shared_ptr<rknn::RetinaFaceModel> face;
+    std::unique_ptr<rknn::ImageProcessor> processor;
+    FILE* results = nullptr;
+
+    // 统计
+    RateMeter video_rate;
+    RateMeter inference_rate;
+    std::atomic<uint64_t> inference_time_us{0};
+    std::atomic<uint64_t> total_detections{0};
+    std::atomic<uint64_t> skipped_frames{0};
+
+    // Stop() 唤醒按节奏等待中的回放线程
+    std::mutex wait_mutex;
+    std::condition_variable wait_cv;
+
+    size_t FrameCount() const { return units.empty() ? frame_count : units.size(); }
+
+    int64_t FrameTime(size_t index) const {
+        return pts_us.empty() ? static_cast<int64_t>(index) * frame_interval_us : pts_us[index];
+    }
+};
+
+// ============================================================================
+// ReplayProducer 实现
+// ============================================================================
+
+ReplayProducer::ReplayProducer(const ProducerConfig& config)
+    : config_(config)
+    , impl_(std::make_unique<Impl>()) {
+    LOG_DEBUG("ReplayProducer created");
+}
+
+ReplayProducer::~ReplayProducer() {
+    Deinit();
+    LOG_DEBUG("ReplayProducer destroyed");
+}
+
+int ReplayProducer::Init() {
+    if (initialized_.load()) {
+        LOG_WARN("Already initialized");
+        return 0;
+    }
+
+    const auto& replay = config_.replay;
+    if (replay.path.empty()) {
+        LOG_ERROR("Replay mode requires a file path");
+        return -1;
+    }
+    impl_->file = MapFile(replay.path);
+    if (!impl_->file) {
+        return -1;
+    }
+
+    if (replay.format == ReplayFormat::kAnnexB) {
+        if (IndexAccessUnits(impl_->file->data, impl_->file->size, config_.codec,
+                             &impl_->units) == 0) {
+            LOG_ERROR("No {} access units found in {}", VideoCodecToString(config_.codec),
+                      replay.path);
+            impl_->file.reset();
+            return -1;
+        }
+        size_t keyframes = std::count_if(impl_->units.begin(), impl_->units.end(),
+                                         [](const AccessUnit& au) { return au.keyframe; });
+        if (keyframes == 0) {
+            LOG_WARN("Replay stream has no IDR frame, DropToKeyframe consumers will see nothing");
+        }
+        impl_->dispatcher.SetCodec(config_.codec);   // 关键帧请求器不绑定 VENC 通道
+        impl_->dispatcher.Gop().Configure(config_.gop_cache_kb > 0 ? config_.gop_cache_kb * 1024
+                                                                   : 0);
+        LOG_INFO("Replay {}: {} frames ({} keyframes), {} bytes, codec {}", replay.path,
+                 impl_->units.size(), keyframes, impl_->file->size,
+                 VideoCodecToString(config_.codec));
+    } else {
+        auto res = config_.GetResolutionConfig();
+        impl_->width = replay.width > 0 ? replay.width : res.width;
+        impl_->height = replay.height > 0 ? replay.height : res.height;
+        impl_->frame_bytes = static_cast<size_t>(impl_->width) * impl_->height * 3 / 2;
+        impl_->frame_count = impl_->file->size / impl_->frame_bytes;
+        if (impl_->frame_count == 0) {
+            LOG_ERROR("Replay file {} holds no complete {}x{} NV12 frame", replay.path,
+                      impl_->width, impl_->height);
+            impl_->file.reset();
+            return -1;
+        }
+        if (InitAiEngine() != 0) {
+            DeinitAiEngine();
+            impl_->file.reset();
+            return -1;
+        }
+        LOG_INFO("Replay {}: {} NV12 frames {}x{}, model {}", replay.path, impl_->frame_count,
+                 impl_->width, impl_->height, replay.model);
+    }
+
+    // 帧时间：优先使用旁路时间戳文件
+    impl_->frame_interval_us = 1000000 / std::max(1, config_.framerate);
+    if (LoadPtsSidecar(replay.path + ".pts", impl_->FrameCount(), &impl_->pts_us)) {
+        const size_t n = impl_->pts_us.size();
+        if (n > 1) {
+            impl_->frame_interval_us = impl_->pts_us.back() / static_cast<int64_t>(n - 1);
+        }
+        LOG_INFO("Replay timestamps from {}.pts ({:.2f}s)", replay.path,
+                 impl_->pts_us.back() / 1e6);
+    }
+    impl_->loop_span_us =
+        impl_->FrameTime(impl_->FrameCount() - 1) + impl_->frame_interval_us;
+
+    initialized_.store(true);
+    LOG_INFO("Replay producer initialized ({}, {})",
+             replay.realtime ? "original cadence" : "as fast as possible",
+             replay.loop ? "loop" : "once");
+    return 0;
+}
+
+int ReplayProducer::Deinit() {
+    if (!initialized_.load()) {
+        return 0;
+    }
+
+    Stop();
+    DeinitAiEngine();
+    impl_->units.clear();
+    impl_->pts_us.clear();
+    impl_->file.reset();   // 消费者仍持有的帧各自保有映射引用
+
+    initialized_.store(false);
+    LOG_INFO("Replay producer deinitialized");
+    return 0;
+}
+
+bool ReplayProducer::Start() {
+    if (!initialized_.load()) {
+        LOG_ERROR("Not initialized");
+        return false;
+    }
+
+    if (running_.load()) {
+        LOG_WARN("Already running");
+        return true;
+    }
+
+    impl_->video_rate.Reset();
+    impl_->inference_rate.Reset();
+    running_.store(true);
+    replay_thread_ = std::thread(&ReplayProducer::ReplayLoop, this);
+    LOG_INFO("Replay producer started");
+    return true;
+}
+
+void ReplayProducer::Stop() {
+    if (!running_.load()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(impl_->wait_mutex);
+        running_.store(false);
+    }
+    impl_->wait_cv.notify_all();
+    if (replay_thread_.joinable()) {
+        replay_thread_.join();
+    }
+    impl_->dispatcher.Stop();   // 丢弃积压帧、清空 GOP 缓存
+    LOG_INFO("Replay producer stopped");
+}
+
+// ============================================================================
+// 流消费者
+// ============================================================================
+
+void ReplayProducer::RegisterStreamConsumer(
+    const std::string& name,
+    StreamCallback callback,
+    StreamConsumerType type,
+    int queue_size,
+    QueueDropPolicy drop_policy,
+    StreamSelector stream,
+    const std::string& strand) {
+    if (stream == StreamSelector::kSub) {
+        LOG_WARN("Replay has no sub stream, consumer '{}' falls back to main stream", name);
+    }
+    impl_->dispatcher.RegisterConsumer(name, std::move(callback), type, queue_size, drop_policy,
+                                       strand);
+}
+
+bool ReplayProducer::RemoveStreamConsumer(const std::string& name) {
+    return impl_->dispatcher.RemoveConsumer(name);
+}
+
+void ReplayProducer::ClearStreamConsumers() {
+    impl_->dispatcher.ClearConsumers();
+}
+
+std::vector<StreamConsumerStats> ReplayProducer::GetStreamConsumerStats() const {
+    return impl_->dispatcher.GetConsumerStats();
+}
+
+ProducerStats ReplayProducer::GetProducerStats() const {
+    ProducerStats stats;
+    stats.video_frames = impl_->video_rate.Total();
+    stats.video_fps = impl_->video_rate.Fps();
+    stats.inference_frames = impl_->inference_rate.Total();
+    stats.inference_fps = impl_->inference_rate.Fps();
+    stats.total_detections = impl_->total_detections.load(std::memory_order_relaxed);
+    if (stats.inference_frames > 0) {
+        stats.avg_inference_ms =
+            impl_->inference_time_us.load(std::memory_order_relaxed) / 1000.0 /
+            static_cast<double>(stats.inference_frames);
+    }
+    stats.main_gop_cache = impl_->dispatcher.Gop().GetStats();
+    return stats;
+}
+
+int ReplayProducer::SetResolution(Resolution preset) {
+    if (running_.load()) {
+        LOG_WARN("Cannot change resolution while running");
+        return -1;
+    }
+    config_.resolution = preset;   // 仅影响未指定尺寸的 NV12 回放
+    return 0;
+}
+
+std::vector<EncodedStreamPtr> ReplayProducer::GetGopSnapshot(StreamSelector stream) {
+    (void)stream;
+    if (!initialized_.load()) {
+        return {};
+    }
+    return impl_->dispatcher.Gop().Snapshot();
+}
+
+// ============================================================================
+// NV12 推理引擎
+// ============================================================================
+
+int ReplayProducer::InitAiEngine() {
+    const auto& replay = config_.replay;
+    int model_width = 0;
+    int model_height = 0;
+    if (replay.model == "retinaface") {
+        impl_->face = RetinaFaceProducer::AcquireModel();
+        if (impl_->face) impl_->face->GetInputSize(model_width, model_height);
+    } else if (replay.model == "yolov5") {
+        impl_->yolo = YoloProducer::AcquireModel();
+        if (impl_->yolo) impl_->yolo->GetInputSize(model_width, model_height);
+    } else {
+        LOG_ERROR("Unknown replay model: {} (expected yolov5 or retinaface)", replay.model);
+        return -1;
+    }
+    if (!impl_->yolo && !impl_->face) {
+        LOG_ERROR("Failed to init {} model", replay.model);
+        return -1;
+    }
+
+    // 文件映射没有 DMA fd，RGA 路径不可用，直接使用 CPU 预处理
+    impl_->processor = std::make_unique<rknn::ImageProcessor>();
+    if (!impl_->processor->Init(model_width, model_height, rknn::PreprocessBackend::kOpenCV)) {
+        LOG_ERROR("Failed to init image processor");
+        return -1;
+    }
+
+    if (!replay.results_path.empty()) {
+        impl_->results = fopen(replay.results_path.c_str(), "w");
+        if (!impl_->results) {
+            LOG_ERROR("Failed to open results file {}: {}", replay.results_path, strerror(errno));
+            return -1;
+        }
+        LOG_INFO("Writing per-frame detections to {}", replay.results_path);
+    }
+    return 0;
+}
+
+void ReplayProducer::DeinitAiEngine() {
+    if (impl_->yolo) {
+        rknn::ModelCache::Instance().Release(impl_->yolo);
+    }
+    if (impl_->face) {
+        rknn::ModelCache::Instance().Release(impl_->face);
+    }
+    if (impl_->processor) {
+        impl_->processor->Deinit();
+        impl_->processor.reset();
+    }
+    if (impl_->results) {
+        fclose(impl_->results);
+        impl_->results = nullptr;
+    }
+}
+
+void ReplayProducer::RunInference(const uint8_t* nv12, uint64_t frame_index, uint64_t pts) {
+    rknn::ImageBuffer src;
+    src.data = const_cast<uint8_t*>(nv12);
+    src.width = impl_->width;
+    src.height = impl_->height;
+    src.stride = impl_->width;
+
+    const auto start = Clock::now();
+    rknn::DetectionResultList results;
+    bool ok = impl_->yolo ? RunModel(*impl_->yolo, *impl_->processor, src, &results)
+                          : RunModel(*impl_->face, *impl_->processor, src, &results);
+    if (!ok) {
+        LOG_WARN_THROTTLED(5000, "Replay inference failed at frame {}", frame_index);
+        return;
+    }
+    impl_->inference_time_us.fetch_add(
+        std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count(),
+        std::memory_order_relaxed);
+    impl_->inference_rate.Tick();
+    impl_->total_detections.fetch_add(results.Count(), std::memory_order_relaxed);
+
+    results.frame_id = static_cast<int>(frame_index);
+    results.pts = pts;
+    if (detection_callback_) {
+        detection_callback_(results, impl_->width, impl_->height);
+    }
+
+    if (impl_->results) {
+        fprintf(impl_->results, "{\"frame\":%llu,\"detections\":[",
+                static_cast<unsigned long long>(frame_index));
+        for (size_t i = 0; i < results.results.size(); ++i) {
+            const auto& det = results.results[i];
+            fprintf(impl_->results,
+                    "%s{\"class\":%d,\"label\":\"%s\",\"conf\":%.4f,\"box\":[%d,%d,%d,%d]}",
+                    i ? "," : "", det.class_id, det.label.c_str(), det.confidence, det.box.x,
+                    det.box.y, det.box.width, det.box.height);
+        }
+        fprintf(impl_->results, "]}\n");
+    }
+}
+
+// ============================================================================
+// 回放线程
+// ============================================================================
+
+void ReplayProducer::ReplayLoop() {
+    const bool annexb = !impl_->units.empty();
+    const bool realtime = config_.replay.realtime;
+    const size_t frames = impl_->FrameCount();
+    const uint8_t* base = impl_->file->data;
+
+    // 时间戳以回放开始时刻为零点，循环时继续递增
+    const auto start = Clock::now();
+    const uint64_t base_pts = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(start.time_since_epoch()).count());
+
+    auto wait_until = [this](Clock::time_point deadline) {
+        std::unique_lock<std::mutex> lock(impl_->wait_mutex);
+        impl_->wait_cv.wait_until(lock, deadline, [this] { return !running_.load(); });
+        return running_.load();
+    };
+
+    uint64_t emitted = 0;
+    for (uint64_t loop = 0; running_.load(); ++loop) {
+        const int64_t loop_offset = static_cast<int64_t>(loop) * impl_->loop_span_us;
+        for (size_t i = 0; i < frames && running_.load(); ++i) {
+            const int64_t media_us = loop_offset + impl_->FrameTime(i);
+            const auto due = start + std::chrono::microseconds(media_us);
+            if (realtime) {
+                if (!wait_until(due)) break;
+                // NV12 推理跟不上原始节奏时跳到当前应输出的帧，与实时采集一致
+                if (!annexb && i + 1 < frames &&
+                    Clock::now() >= start + std::chrono::microseconds(
+                                                loop_offset + impl_->FrameTime(i + 1))) {
+                    impl_->skipped_frames.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+            }
+
+            const uint64_t pts = base_pts + static_cast<uint64_t>(media_us);
+            if (annexb) {
+                const AccessUnit& au = impl_->units[i];
+                impl_->dispatcher.DispatchFrame(wrap_external_stream(
+                    base + au.offset, au.size, pts, au.keyframe, config_.codec, impl_->file));
+                impl_->video_rate.Tick();
+            } else {
+                RunInference(base + i * impl_->frame_bytes, i, pts);
+            }
+            emitted++;
+        }
+
+        if (!running_.load()) break;
+        if (!config_.replay.loop) {
+            LOG_INFO("Replay finished: {} frames emitted, {} skipped", emitted,
+                     impl_->skipped_frames.load());
+            if (impl_->results) {
+                fflush(impl_->results);
+            }
+            break;
+        }
+        LOG_DEBUG("Replay loop {} done ({} frames emitted)", loop + 1, emitted);
+    }
+}
+
+// ============================================================================
+// 工厂函数
+// ============================================================================
+
+std::unique_ptr<IMediaProducer> CreateReplayProducer(const ProducerConfig& config) {
+    return std::make_unique<ReplayProducer>(config);
+}
+
+}  // namespace media
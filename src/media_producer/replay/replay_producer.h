@@ -0,0 +1,108 @@
+/**
+ * @file replay_producer.h
+ * @brief 文件回放模式生产者 - 用录制文件代替 sensor，离线复现现场画面
+ *
+ * 数据流架构：
+ *   Annex-B 码流文件 --(mmap)--> 访问单元索引 --(按 PTS 节奏 / 尽快)--> StreamDispatcher --> 流消费者
+ *   NV12 原始帧文件  --(mmap)--> letterbox --> NPU 推理 --> 检测回调（+ 结果文件）
+ *
+ * 特点：
+ * - 不初始化 ISP/VI/VPSS/VENC，MediaManager 也不启动采集核心，无 sensor 的板子或同一份数据
+ *   可重复运行
+ * - 码流帧直接指向文件映射（wrap_external_stream），分发路径与实时码流完全一致
+ *   （NAL 索引、GOP 缓存、丢帧策略、RTSP/WebRTC/WS/HLS/录制），用于分发扇出压测
+ * - 循环回放时时间戳继续递增，下游封装与播放器看到的是一条连续的流
+ * - NV12 回放每帧都送推理（尽快模式）或按节奏取当前帧（实时模式，推理跟不上时跳帧），
+ *   逐帧检测结果可写成 JSON Lines，用于后处理回归比对
+ * - 码流不可重编码：按需关键帧请求、码率 / 帧率调整、抓拍均不支持，新消费者等待文件中的下一个 IDR
+ *
+ * @note 码流文件的编码格式与分辨率须与 ProducerConfig（codec / resolution）一致，
+ *       分发侧（WebRTC SDP、HLS）按配置声明
+ *
+ * @author 好软，好温暖
+ * @date 2026-02-18
+ */
+
+#pragma once
+
+#include "../i_media_producer.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+namespace media {
+
+/**
+ * @class ReplayProducer
+ * @brief 文件回放模式生产者
+ */
+class ReplayProducer : public IMediaProducer {
+public:
+    /**
+     * @brief 构造函数
+     * @param config 配置参数（replay）
+     */
+    explicit ReplayProducer(const ProducerConfig& config);
+
+    ~ReplayProducer() override;
+
+    // ========== IMediaProducer 接口实现 ==========
+
+    int Init() override;
+    int Deinit() override;
+    bool Start() override;
+    void Stop() override;
+
+    void RegisterStreamConsumer(
+        const std::string& name,
+        StreamCallback callback,
+        StreamConsumerType type = StreamConsumerType::AsyncIO,
+        int queue_size = 3,
+        QueueDropPolicy drop_policy = QueueDropPolicy::DropToKeyframe,
+        StreamSelector stream = StreamSelector::kMain,
+        const std::string& strand = {}) override;
+
+    bool RemoveStreamConsumer(const std::string& name) override;
+    void ClearStreamConsumers() override;
+    std::vector<StreamConsumerStats> GetStreamConsumerStats() const override;
+    ProducerStats GetProducerStats() const override;
+
+    bool IsInitialized() const override { return initialized_.load(); }
+    bool IsRunning() const override { return running_.load(); }
+    const char* GetTypeName() const override { return "Replay"; }
+    const ProducerConfig& GetConfig() const override { return config_; }
+
+    int SetResolution(Resolution preset) override;
+    std::vector<EncodedStreamPtr> GetGopSnapshot(StreamSelector stream) override;
+    void SetDetectionCallback(DetectionCallback callback) override {
+        detection_callback_ = std::move(callback);
+    }
+
+private:
+    ReplayProducer(const ReplayProducer&) = delete;
+    ReplayProducer& operator=(const ReplayProducer&) = delete;
+
+    int InitAiEngine();
+    void DeinitAiEngine();
+
+    /// 回放线程：码流逐帧分发 / NV12 逐帧推理
+    void ReplayLoop();
+    void RunInference(const uint8_t* nv12, uint64_t frame_index, uint64_t pts);
+
+private:
+    ProducerConfig config_;
+
+    std::atomic<bool> initialized_{false};
+    std::atomic<bool> running_{false};
+
+    std::thread replay_thread_;
+
+    struct Impl;
+    std::unique_ptr<Impl> impl_;
+
+    // 检测结果回调（Start() 之前设置，回放线程只读）
+    DetectionCallback detection_callback_;
+};
+
+}  // namespace media
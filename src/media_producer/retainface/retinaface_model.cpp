@@ -14,9 +14,15 @@
 #include "../common/osd_overlay.h"
 #include "common/logger.h"
 
+#include <algorithm>
 #include <cstring>
 #include <cmath>
 
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RETINAFACE_USE_NEON 1
+#endif
+
 // 引入 Luckfox 提供的 box priors
 #include "rknn_box_priors.h"
 
@@ -49,60 +55,11 @@ float CalculateIoU(float x1_min, float y1_min, float x1_max, float y1_max,
     return union_area <= 0.f ? 0.f : (intersection / union_area);
 }
 
-/// NMS 排序辅助
-void QuickSortIndicesDescending(float* scores, int left, int right, int* indices) {
-    if (left >= right) return;
-    
-    float pivot = scores[left];
-    int pivot_idx = indices[left];
-    int low = left, high = right;
-    
-    while (low < high) {
-        while (low < high && scores[high] <= pivot) high--;
-        scores[low] = scores[high];
-        indices[low] = indices[high];
-        
-        while (low < high && scores[low] >= pivot) low++;
-        scores[high] = scores[low];
-        indices[high] = indices[low];
-    }
-    scores[low] = pivot;
-    indices[low] = pivot_idx;
-    
-    QuickSortIndicesDescending(scores, left, low - 1, indices);
-    QuickSortIndicesDescending(scores, low + 1, right, indices);
-}
+/// 方差参数（RetinaFace 固定值）
+constexpr float kVariances[2] = {0.1f, 0.2f};
 
-/// NMS 实现（RetinaFace 版本，基于归一化坐标）
-int NMSRetinaFace(int valid_count, float* locations, int* order, float threshold,
-                   int width, int height) {
-    for (int i = 0; i < valid_count; ++i) {
-        if (order[i] == -1) continue;
-        
-        int n = order[i];
-        for (int j = i + 1; j < valid_count; ++j) {
-            int m = order[j];
-            if (m == -1) continue;
-            
-            float x1_min = locations[n * 4 + 0] * width;
-            float y1_min = locations[n * 4 + 1] * height;
-            float x1_max = locations[n * 4 + 2] * width;
-            float y1_max = locations[n * 4 + 3] * height;
-            
-            float x2_min = locations[m * 4 + 0] * width;
-            float y2_min = locations[m * 4 + 1] * height;
-            float x2_max = locations[m * 4 + 2] * width;
-            float y2_max = locations[m * 4 + 3] * height;
-            
-            float iou = CalculateIoU(x1_min, y1_min, x1_max, y1_max,
-                                     x2_min, y2_min, x2_max, y2_max);
-            if (iou > threshold) {
-                order[j] = -1;
-            }
-        }
-    }
-    return 0;
-}
+/// 每个 prior 的关键点数
+constexpr int kLandmarkCount = 5;
 
 }  // anonymous namespace
 
@@ -239,6 +196,15 @@ int RetinaFaceModel::Init(const ModelConfig& config) {
     is_quant_ = (output_attrs_[0].qnt_type == RKNN_TENSOR_QNT_AFFINE_ASYMMETRIC);
     LOG_INFO("Model is {}", is_quant_ ? "quantized (INT8)" : "float");
     
+    // 10. 预计算 prior 表与反量化查找表，预留后处理缓冲区
+    if (io_num_.n_output < 3) {
+        LOG_ERROR("RetinaFace expects 3 outputs, got {}", io_num_.n_output);
+        return -1;
+    }
+    if (!BuildDecodeTables()) {
+        return -1;
+    }
+    
     initialized_ = true;
     LOG_INFO("RetinaFace model initialized successfully");
     return 0;
@@ -263,6 +229,13 @@ void RetinaFaceModel::Deinit() {
         }
     }
     
+    // 释放解码表（模型缓存淘汰时归还内存）
+    for (auto* table : {&prior_cx_, &prior_cy_, &prior_w_, &prior_h_}) {
+        table->clear();
+        table->shrink_to_fit();
+    }
+    num_priors_ = 0;
+    
     // 释放属性数组
     delete[] input_attrs_;
     input_attrs_ = nullptr;
@@ -362,133 +335,185 @@ int RetinaFaceModel::GetResults(DetectionResultList& results) {
 }
 
 int RetinaFaceModel::PostProcess(DetectionResultList& results) {
-    // 获取输出指针
-    uint8_t* location = static_cast<uint8_t*>(output_mems_[0]->virt_addr);
-    uint8_t* scores = static_cast<uint8_t*>(output_mems_[1]->virt_addr);
-    uint8_t* landmarks = static_cast<uint8_t*>(output_mems_[2]->virt_addr);
+    const auto* location = static_cast<const uint8_t*>(output_mems_[0]->virt_addr);
+    const auto* scores = static_cast<const uint8_t*>(output_mems_[1]->virt_addr);
+    const auto* landmarks = static_cast<const uint8_t*>(output_mems_[2]->virt_addr);
+    
+    candidates_.clear();
+    FilterCandidates(scores, location);
+    if (candidates_.empty()) {
+        return 0;
+    }
     
+    NMS(landmarks, results);
+    return 0;
+}
+
+bool RetinaFaceModel::BuildDecodeTables() {
     // 选择对应尺寸的 prior boxes
     const float (*prior_ptr)[4];
-    int num_priors;
     if (model_width_ == 640) {
         prior_ptr = BOX_PRIORS_640;
-        num_priors = 16800;
+        num_priors_ = 16800;
     } else if (model_width_ == 320) {
         prior_ptr = BOX_PRIORS_320;
-        num_priors = 4200;
+        num_priors_ = 4200;
     } else {
         LOG_ERROR("Unsupported model size: {}", model_width_);
-        return -1;
+        return false;
     }
     
-    // 分配临时数组
-    std::vector<int> filter_indices(num_priors);
-    std::vector<float> props(num_priors, 0.0f);
-    std::vector<float> loc_fp32(num_priors * 4, 0.0f);
-    std::vector<float> landms_fp32(num_priors * 10, 0.0f);
+    // prior 展开为 SoA 并换算到模型输入像素坐标，解码时不再乘模型尺寸
+    prior_cx_.resize(num_priors_);
+    prior_cy_.resize(num_priors_);
+    prior_w_.resize(num_priors_);
+    prior_h_.resize(num_priors_);
+    for (int i = 0; i < num_priors_; ++i) {
+        prior_cx_[i] = prior_ptr[i][0] * model_width_;
+        prior_cy_[i] = prior_ptr[i][1] * model_height_;
+        prior_w_[i] = prior_ptr[i][2] * model_width_;
+        prior_h_[i] = prior_ptr[i][3] * model_height_;
+    }
     
-    // 量化参数
-    int32_t loc_zp = output_attrs_[0].zp;
-    float loc_scale = output_attrs_[0].scale;
-    int32_t scores_zp = output_attrs_[1].zp;
-    float scores_scale = output_attrs_[1].scale;
-    int32_t landms_zp = output_attrs_[2].zp;
-    float landms_scale = output_attrs_[2].scale;
+    // uint8 输出只有 256 种取值：反量化、方差缩放与 exp 全部查表
+    const int32_t loc_zp = output_attrs_[0].zp;
+    const float loc_scale = output_attrs_[0].scale;
+    const int32_t landms_zp = output_attrs_[2].zp;
+    const float landms_scale = output_attrs_[2].scale;
+    for (int q = 0; q < 256; ++q) {
+        const float loc = DeqntAffineToF32_U8(static_cast<uint8_t>(q), loc_zp, loc_scale);
+        loc_lut_[q] = loc * kVariances[0];
+        size_lut_[q] = std::exp(loc * kVariances[1]);
+        landm_lut_[q] = DeqntAffineToF32_U8(static_cast<uint8_t>(q), landms_zp, landms_scale) *
+                        kVariances[0];
+    }
     
-    // 方差参数（RetinaFace 固定值）
-    const float VARIANCES[2] = {0.1f, 0.2f};
+    // 分数阈值预先量化：找到反量化后超过阈值的最小原始值（反量化单调递增，与浮点比较结果一致）
+    const float conf_threshold = config_.conf_threshold > 0 ? config_.conf_threshold : 0.5f;
+    const int32_t scores_zp = output_attrs_[1].zp;
+    const float scores_scale = output_attrs_[1].scale;
+    score_threshold_q_ = 256;
+    for (int q = 0; q < 256; ++q) {
+        if (DeqntAffineToF32_U8(static_cast<uint8_t>(q), scores_zp, scores_scale) > conf_threshold) {
+            score_threshold_q_ = q;
+            break;
+        }
+    }
     
-    int valid_count = 0;
-    float conf_threshold = config_.conf_threshold > 0 ? config_.conf_threshold : 0.5f;
+    candidates_.reserve(kMaxDetections);
+    order_.reserve(kMaxDetections);
+    suppressed_.reserve(kMaxDetections);
     
-    // 解码 boxes
-    for (int i = 0; i < num_priors && valid_count < kMaxDetections; ++i) {
-        // scores 输出格式：[num_priors, 2]，第二个值为人脸置信度
-        float face_score = DeqntAffineToF32_U8(scores[i * 2 + 1], scores_zp, scores_scale);
+    LOG_INFO("Decode tables ready: {} priors, score threshold {} -> q{}",
+             num_priors_, conf_threshold, score_threshold_q_);
+    return true;
+}
+
+void RetinaFaceModel::FilterCandidates(const uint8_t* scores, const uint8_t* location) {
+    if (score_threshold_q_ > 255) {
+        return;
+    }
+    const uint8_t threshold = static_cast<uint8_t>(score_threshold_q_);
+    const float score_scale = output_attrs_[1].scale;
+    const int32_t score_zp = output_attrs_[1].zp;
+    
+    // 单个 prior 解码：只对超过阈值的 prior 查表计算框
+    auto add = [&](int i) {
+        const uint8_t* bbox = location + i * 4;
+        const float cx = loc_lut_[bbox[0]] * prior_w_[i] + prior_cx_[i];
+        const float cy = loc_lut_[bbox[1]] * prior_h_[i] + prior_cy_[i];
+        const float w = size_lut_[bbox[2]] * prior_w_[i];
+        const float h = size_lut_[bbox[3]] * prior_h_[i];
         
-        if (face_score > conf_threshold) {
-            filter_indices[valid_count] = i;
-            props[valid_count] = face_score;
-            
-            int offset = i * 4;
-            uint8_t* bbox = location + offset;
-            
-            // 解码边界框
-            float box_x = DeqntAffineToF32_U8(bbox[0], loc_zp, loc_scale) * VARIANCES[0] * prior_ptr[i][2] + prior_ptr[i][0];
-            float box_y = DeqntAffineToF32_U8(bbox[1], loc_zp, loc_scale) * VARIANCES[0] * prior_ptr[i][3] + prior_ptr[i][1];
-            float box_w = std::exp(DeqntAffineToF32_U8(bbox[2], loc_zp, loc_scale) * VARIANCES[1]) * prior_ptr[i][2];
-            float box_h = std::exp(DeqntAffineToF32_U8(bbox[3], loc_zp, loc_scale) * VARIANCES[1]) * prior_ptr[i][3];
-            
-            float xmin = box_x - box_w * 0.5f;
-            float ymin = box_y - box_h * 0.5f;
-            float xmax = xmin + box_w;
-            float ymax = ymin + box_h;
-            
-            loc_fp32[offset + 0] = xmin;
-            loc_fp32[offset + 1] = ymin;
-            loc_fp32[offset + 2] = xmax;
-            loc_fp32[offset + 3] = ymax;
-            
-            // 解码关键点
-            for (int j = 0; j < 5; ++j) {
-                landms_fp32[i * 10 + 2 * j] = DeqntAffineToF32_U8(landmarks[i * 10 + 2 * j], landms_zp, landms_scale)
-                                              * VARIANCES[0] * prior_ptr[i][2] + prior_ptr[i][0];
-                landms_fp32[i * 10 + 2 * j + 1] = DeqntAffineToF32_U8(landmarks[i * 10 + 2 * j + 1], landms_zp, landms_scale)
-                                                  * VARIANCES[0] * prior_ptr[i][3] + prior_ptr[i][1];
+        Candidate c;
+        c.x1 = cx - w * 0.5f;
+        c.y1 = cy - h * 0.5f;
+        c.x2 = c.x1 + w;
+        c.y2 = c.y1 + h;
+        c.score = DeqntAffineToF32_U8(scores[i * 2 + 1], score_zp, score_scale);
+        c.prior = i;
+        candidates_.push_back(c);
+    };
+    
+    // scores 输出格式：[num_priors, 2]，第二个值为人脸置信度
+    int i = 0;
+#ifdef RETINAFACE_USE_NEON
+    // 每次 16 个 prior：vld2q 拆出人脸分数通道，与量化阈值比较，整组未通过时直接跳过
+    const uint8x16_t vthreshold = vdupq_n_u8(threshold);
+    for (; i + 16 <= num_priors_; i += 16) {
+        const uint8x16x2_t pair = vld2q_u8(scores + i * 2);
+        const uint8x16_t pass = vcgeq_u8(pair.val[1], vthreshold);
+        const uint8x8_t any = vorr_u8(vget_low_u8(pass), vget_high_u8(pass));
+        if (vget_lane_u64(vreinterpret_u64_u8(any), 0) == 0) {
+            continue;
+        }
+        for (int k = i; k < i + 16; ++k) {
+            if (scores[k * 2 + 1] >= threshold) {
+                add(k);
+                if (static_cast<int>(candidates_.size()) >= kMaxDetections) return;
             }
-            
-            ++valid_count;
         }
     }
-    
-    if (valid_count == 0) {
-        return 0;
-    }
-    
-    // 排序
-    QuickSortIndicesDescending(props.data(), 0, valid_count - 1, filter_indices.data());
-    
-    // NMS
-    float nms_threshold = config_.nms_threshold > 0 ? config_.nms_threshold : 0.2f;
-    NMSRetinaFace(valid_count, loc_fp32.data(), filter_indices.data(), nms_threshold, model_width_, model_height_);
-    
-    // 收集结果
-    for (int i = 0; i < valid_count && results.Count() < static_cast<size_t>(config_.max_detections); ++i) {
-        if (filter_indices[i] == -1 || props[i] < conf_threshold) {
-            continue;
+#endif
+    for (; i < num_priors_; ++i) {
+        if (scores[i * 2 + 1] >= threshold) {
+            add(i);
+            if (static_cast<int>(candidates_.size()) >= kMaxDetections) return;
         }
+    }
+}
+
+void RetinaFaceModel::NMS(const uint8_t* landmarks, DetectionResultList& results) {
+    const int count = static_cast<int>(candidates_.size());
+    const size_t max_detections = static_cast<size_t>(config_.max_detections);
+    const float nms_threshold = config_.nms_threshold > 0 ? config_.nms_threshold : 0.2f;
+    
+    // 按分数降序排序下标（缓冲区容量跨帧保留）
+    order_.resize(count);
+    for (int i = 0; i < count; ++i) order_[i] = i;
+    std::sort(order_.begin(), order_.end(), [this](int a, int b) {
+        return candidates_[a].score > candidates_[b].score;
+    });
+    suppressed_.assign(count, 0);
+    
+    // 单遍贪心 NMS：保留框按分数顺序输出，达到 max_detections 后提前结束
+    for (int i = 0; i < count && results.Count() < max_detections; ++i) {
+        if (suppressed_[i]) continue;
+        const Candidate& keep = candidates_[order_[i]];
         
-        int n = filter_indices[i];
+        for (int j = i + 1; j < count; ++j) {
+            if (suppressed_[j]) continue;
+            const Candidate& other = candidates_[order_[j]];
+            float iou = CalculateIoU(keep.x1, keep.y1, keep.x2, keep.y2,
+                                     other.x1, other.y1, other.x2, other.y2);
+            if (iou > nms_threshold) {
+                suppressed_[j] = 1;
+            }
+        }
         
         DetectionResult det;
         det.class_id = 0;  // 人脸类别固定为 0
-        det.confidence = props[i];
+        det.confidence = keep.score;
         det.label = "face";
         
-        // 转换为像素坐标
-        float x1 = loc_fp32[n * 4 + 0] * model_width_;
-        float y1 = loc_fp32[n * 4 + 1] * model_height_;
-        float x2 = loc_fp32[n * 4 + 2] * model_width_;
-        float y2 = loc_fp32[n * 4 + 3] * model_height_;
-        
-        det.box.x = Clamp(x1, 0, model_width_);
-        det.box.y = Clamp(y1, 0, model_height_);
-        det.box.width = Clamp(x2 - x1, 0, model_width_ - det.box.x);
-        det.box.height = Clamp(y2 - y1, 0, model_height_ - det.box.y);
+        det.box.x = Clamp(keep.x1, 0, model_width_);
+        det.box.y = Clamp(keep.y1, 0, model_height_);
+        det.box.width = Clamp(keep.x2 - keep.x1, 0, model_width_ - det.box.x);
+        det.box.height = Clamp(keep.y2 - keep.y1, 0, model_height_ - det.box.y);
         
-        // 添加关键点
-        det.landmarks.resize(5);
-        for (int j = 0; j < 5; ++j) {
-            float point_x = landms_fp32[n * 10 + 2 * j] * model_width_;
-            float point_y = landms_fp32[n * 10 + 2 * j + 1] * model_height_;
+        // 关键点只为保留下来的人脸解码
+        const int n = keep.prior;
+        const uint8_t* lm = landmarks + n * kLandmarkCount * 2;
+        det.landmarks.resize(kLandmarkCount);
+        for (int j = 0; j < kLandmarkCount; ++j) {
+            float point_x = landm_lut_[lm[2 * j]] * prior_w_[n] + prior_cx_[n];
+            float point_y = landm_lut_[lm[2 * j + 1]] * prior_h_[n] + prior_cy_[n];
             det.landmarks[j].x = Clamp(point_x, 0, model_width_);
             det.landmarks[j].y = Clamp(point_y, 0, model_height_);
         }
         
         results.Add(det);
     }
-    
-    return 0;
 }
 
 ModelInfo RetinaFaceModel::GetModelInfo() const {
@@ -510,10 +535,45 @@ void* RetinaFaceModel::GetInputVirtAddr() const {
     return input_mem_ ? input_mem_->virt_addr : nullptr;
 }
 
+int RetinaFaceModel::GetInputFd() const {
+    return input_mem_ ? input_mem_->fd : -1;
+}
+
 int RetinaFaceModel::GetInputMemSize() const {
     return input_mem_ ? input_mem_->size : 0;
 }
 
+int RetinaFaceModel::GetOutputNum() const {
+    return static_cast<int>(std::min<uint32_t>(io_num_.n_output, 3));
+}
+
+void* RetinaFaceModel::GetOutputVirtAddr(int index) const {
+    if (index < 0 || index >= GetOutputNum() || !output_mems_[index]) return nullptr;
+    return output_mems_[index]->virt_addr;
+}
+
+int RetinaFaceModel::GetOutputMemSize(int index) const {
+    if (index < 0 || index >= GetOutputNum() || !output_mems_[index]) return 0;
+    return output_mems_[index]->size;
+}
+
+size_t RetinaFaceModel::GetMemoryUsage() const {
+    if (!initialized_) return 0;
+    
+    size_t total = 0;
+    rknn_mem_size mem_size;
+    std::memset(&mem_size, 0, sizeof(mem_size));
+    if (rknn_query(ctx_, RKNN_QUERY_MEM_SIZE, &mem_size, sizeof(mem_size)) == RKNN_SUCC) {
+        total += mem_size.total_weight_size + mem_size.total_internal_size;
+    }
+    
+    if (input_mem_) total += input_mem_->size;
+    for (int i = 0; i < 3; ++i) {
+        if (output_mems_[i]) total += output_mems_[i]->size;
+    }
+    return total;
+}
+
 std::string RetinaFaceModel::FormatResultLog(const DetectionResult& result, size_t index,
                                               float letterbox_scale,
                                               int letterbox_pad_x,
@@ -66,7 +66,14 @@ public:
     ModelType GetType() const { return ModelType::kRetinaFace; }
     void GetInputSize(int& width, int& height) const;
     void* GetInputVirtAddr() const;
+    int GetInputFd() const;
     int GetInputMemSize() const;
+    int GetOutputNum() const;
+    void* GetOutputVirtAddr(int index) const;
+    int GetOutputMemSize(int index) const;
+    
+    /// NPU 内存占用（权重 + 中间层 + IO 张量），用于模型缓存的内存上限统计
+    size_t GetMemoryUsage() const;
     
     /// 格式化检测结果日志（包含关键点信息）
     std::string FormatResultLog(const DetectionResult& result, size_t index,
@@ -82,6 +89,25 @@ private:
     /// 后处理：解码输出并执行 NMS
     int PostProcess(DetectionResultList& results);
 
+    /// 按模型尺寸与输出量化参数生成 prior 表和反量化查找表（Init 时调用一次）
+    bool BuildDecodeTables();
+
+    /// 在量化域筛选人脸分数，通过的 prior 解码框后追加到 candidates_
+    void FilterCandidates(const uint8_t* scores, const uint8_t* location);
+
+    /// 按分数排序后贪心 NMS，保留框解码关键点后写入 results
+    void NMS(const uint8_t* landmarks, DetectionResultList& results);
+
+    /// 后处理候选框（模型输入像素坐标，左上角 + 右下角，未裁剪）
+    struct Candidate {
+        float x1;
+        float y1;
+        float x2;
+        float y2;
+        float score;
+        int prior;
+    };
+
 private:
     // RKNN 上下文
     rknn_context ctx_ = 0;
@@ -104,6 +130,28 @@ private:
     // 配置参数
     ModelConfig config_;
     
+    // prior 表（SoA，模型输入像素坐标）：中心 cx/cy 与宽高 w/h，Init 时由 rknn_box_priors.h 展开
+    int num_priors_ = 0;
+    std::vector<float> prior_cx_;
+    std::vector<float> prior_cy_;
+    std::vector<float> prior_w_;
+    std::vector<float> prior_h_;
+    
+    // 反量化查找表（下标为 uint8 原始输出）：
+    // 中心偏移 = loc_lut_[q] * prior 宽高，宽高 = size_lut_[q] * prior 宽高（exp 预先计算），
+    // 关键点偏移 = landm_lut_[q] * prior 宽高
+    float loc_lut_[256] = {};
+    float size_lut_[256] = {};
+    float landm_lut_[256] = {};
+    
+    // 人脸分数阈值（量化域）：原始输出 >= score_threshold_q_ 即超过 conf_threshold，256 表示无法通过
+    int score_threshold_q_ = 256;
+    
+    // 后处理缓冲区（Init 时预留容量，跨帧复用，稳态下不再分配）
+    std::vector<Candidate> candidates_;
+    std::vector<int> order_;
+    std::vector<uint8_t> suppressed_;
+    
     // 初始化状态
     bool initialized_ = false;
 };
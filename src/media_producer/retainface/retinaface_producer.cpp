@@ -12,9 +12,17 @@
 #include "mpi_config.h"
 #include "retinaface_model.h"
 #include "../common/image_utils.h"
+#include "../common/osd_overlay.h"
+#include "../common/smart_encoder.h"
+#include "../common/snapshot.h"
+#include "../common/capture_core.h"
+#include "../common/sub_stream.h"
+#include "../common/model_cache.h"
 #include "common/logger.h"
+#include "common/latency_trace.h"
 #include "common/media_buffer.h"
-#include "common/asio_context.h"
+#include "common/metrics.h"
+#include "common/stream_dispatcher.h"
 
 #include "sample_comm.h"
 #include "rk_mpi_sys.h"
@@ -28,45 +36,6 @@
 
 namespace media {
 
-// ============================================================================
-// 流分发器
-// ============================================================================
-
-class RetinaStreamDispatcher {
-public:
-    struct ConsumerInfo {
-        std::string name;
-        StreamCallback callback;
-        StreamConsumerType type;
-    };
-
-    void RegisterConsumer(const std::string& name, StreamCallback callback,
-                          StreamConsumerType type) {
-        consumers_.push_back({name, std::move(callback), type});
-        LOG_INFO("Registered stream consumer: {}", name);
-    }
-
-    void ClearConsumers() {
-        consumers_.clear();
-    }
-
-    void DispatchFrame(EncodedStreamPtr stream) {
-        for (auto& c : consumers_) {
-            if (!c.callback) continue;
-            if (c.type == StreamConsumerType::AsyncIO) {
-                PostToIo([callback = c.callback, stream]() {
-                    callback(stream);
-                });
-            } else {
-                c.callback(stream);
-            }
-        }
-    }
-
-private:
-    std::vector<ConsumerInfo> consumers_;
-};
-
 // ============================================================================
 // MB Pool RAII 封装
 // ============================================================================
@@ -124,9 +93,7 @@ private:
 
 struct RetinaFaceProducer::Impl {
     // MPI 状态
-    bool isp_initialized = false;
-    bool mpi_initialized = false;
-    bool vi_enabled = false;
+    bool capture_acquired = false;   // 持有共享采集核心（ISP + SYS + VI）引用
     bool vpss_enabled = false;
     bool venc_enabled = false;
 
@@ -134,18 +101,63 @@ struct RetinaFaceProducer::Impl {
     MPP_CHN_S vi_chn;
     MPP_CHN_S vpss_grp;
 
+    // 双通道布局：VPSS Chn0 -> VENC 硬件绑定，Chn1（模型尺寸）-> NPU
+    bool dual_channel = false;
+    bool vpss_venc_bound = false;
+    MPP_CHN_S vpss_out;
+    MPP_CHN_S venc_chn;
+    int ai_chn_width = 0;
+    int ai_chn_height = 0;
+
+    // NV12 编码：VENC 直接吃 VPSS 帧（RGN 叠框 / 客户端渲染；双通道布局下 VENC 由 VPSS 绑定送帧）
+    // RGN 叠框：检测框由硬件叠加；客户端渲染时画面不叠框，检测结果经元数据通道下发
+    bool nv12_venc = false;
+    bool rgn_overlay = false;
+    OSDOverlay osd;
+    std::vector<OSDBox> osd_boxes;
+
+    // 检测驱动编码：检测框 -> 主码流 VENC ROI，静止场景降码率 / 帧率
+    SmartEncoder smart_encoder;
+
     // RGB 缓冲池
     RetinaMbPool rgb_pool;
 
     // AI 引擎
-    std::unique_ptr<rknn::RetinaFaceModel> ai_model;
+    std::shared_ptr<rknn::RetinaFaceModel> ai_model;   // 由 ModelCache 共享持有，切换模式时常驻
     std::unique_ptr<rknn::ImageProcessor> image_processor;
     
     // 中间缓冲区
     std::vector<uint8_t> temp_rgb_buffer;
     
-    // 流分发器
-    RetinaStreamDispatcher dispatcher;
+    // 流分发器（由 FrameLoop 驱动）
+    StreamDispatcher dispatcher;
+
+    // 子码流（VPSS Chn2 -> VENC Chn1，自带分发器，不叠加检测框）
+    SubStream sub_stream;
+
+    // JPEG 抓拍（VPSS Chn3 -> VENC Chn2，按需，不叠加检测框）
+    SnapshotEncoder snapshot;
+
+    // 异步推理：FrameLoop 覆盖式发布最新帧，InferenceLoop 消费
+    LatestVideoFrame inference_frame;
+
+    // 最新检测结果（推理线程整体替换，编码线程只读快照）
+    struct Overlay {
+        rknn::DetectionResultList results;
+        rknn::LetterboxInfo letterbox;
+    };
+    std::mutex overlay_mutex;
+    std::shared_ptr<const Overlay> overlay;
+
+    void PublishOverlay(std::shared_ptr<const Overlay> next) {
+        std::lock_guard<std::mutex> lock(overlay_mutex);
+        overlay = std::move(next);
+    }
+
+    std::shared_ptr<const Overlay> CurrentOverlay() {
+        std::lock_guard<std::mutex> lock(overlay_mutex);
+        return overlay;
+    }
 };
 
 // ============================================================================
@@ -176,10 +188,11 @@ int RetinaFaceProducer::Init() {
 
     if (InitMpi() != 0) {
         LOG_ERROR("Failed to initialize MPI");
+        DeinitMpi();  // 归还已获取的采集核心引用
         return -1;
     }
 
-    if (!InitRgbPool()) {
+    if (!impl_->nv12_venc && !InitRgbPool()) {
         LOG_ERROR("Failed to initialize RGB pool");
         DeinitMpi();
         return -1;
@@ -191,9 +204,21 @@ int RetinaFaceProducer::Init() {
         return -1;
     }
 
+    if (impl_->rgn_overlay && !impl_->osd.Init(kVencChn)) {
+        LOG_ERROR("Failed to initialize OSD");
+        DeinitAiEngine();
+        DeinitMpi();
+        return -1;
+    }
+
     initialized_.store(true);
     LOG_INFO("RetinaFace producer initialized successfully");
-    LOG_INFO("Pipeline: VI -> VPSS --(manual)--> NPU --(manual)--> VENC");
+    if (impl_->dual_channel) {
+        LOG_INFO("Pipeline: VI -> VPSS chn0 --(bind)--> VENC, chn1 {}x{} --(manual)--> NPU --> RGN",
+                 impl_->ai_chn_width, impl_->ai_chn_height);
+    } else {
+        LOG_INFO("Pipeline: VI -> VPSS --(manual)--> NPU --(manual)--> VENC");
+    }
     return 0;
 }
 
@@ -205,6 +230,7 @@ int RetinaFaceProducer::Deinit() {
     Stop();
     DeinitAiEngine();
     impl_->rgb_pool.Destroy();
+    impl_->osd.Deinit();
     DeinitMpi();
 
     initialized_.store(false);
@@ -223,9 +249,22 @@ bool RetinaFaceProducer::Start() {
         return true;
     }
 
+    frame_count_.store(0);
+    inference_count_.store(0);
+    inference_time_us_.store(0);
+    detection_count_.store(0);
+    video_rate_.Reset();
+    inference_rate_.Reset();
+
     running_.store(true);
+    if (impl_->dual_channel || config_.async_inference) {
+        inference_thread_ = std::thread(&RetinaFaceProducer::InferenceLoop, this);
+    }
     frame_thread_ = std::thread(&RetinaFaceProducer::FrameLoop, this);
-    LOG_INFO("RetinaFace producer started");
+    impl_->sub_stream.Start();
+    LOG_INFO("RetinaFace producer started ({} inference)",
+             impl_->dual_channel ? "dual-channel"
+                                 : (config_.async_inference ? "async" : "serial"));
     return true;
 }
 
@@ -238,6 +277,17 @@ void RetinaFaceProducer::Stop() {
     if (frame_thread_.joinable()) {
         frame_thread_.join();
     }
+    // 空帧唤醒推理线程，同时释放 holder 持有的最后一个 VPSS 帧
+    impl_->inference_frame.update(nullptr);
+    if (inference_thread_.joinable()) {
+        inference_thread_.join();
+    }
+    impl_->PublishOverlay(nullptr);
+    impl_->osd.Clear();
+    impl_->smart_encoder.Reset();
+    // 归还 Queued 消费者积压的 VENC buffer
+    impl_->dispatcher.FlushQueues();
+    impl_->sub_stream.Stop();
     LOG_INFO("RetinaFace producer stopped");
 }
 
@@ -245,13 +295,68 @@ void RetinaFaceProducer::RegisterStreamConsumer(
     const std::string& name,
     StreamCallback callback,
     StreamConsumerType type,
-    int queue_size) {
-    (void)queue_size;
-    impl_->dispatcher.RegisterConsumer(name, std::move(callback), type);
+    int queue_size,
+    QueueDropPolicy drop_policy,
+    StreamSelector stream,
+    const std::string& strand) {
+    if (stream == StreamSelector::kSub) {
+        if (impl_->sub_stream.IsEnabled()) {
+            impl_->sub_stream.Dispatcher().RegisterConsumer(
+                name, std::move(callback), type, queue_size, drop_policy, strand);
+            return;
+        }
+        LOG_WARN("Sub stream not enabled, consumer '{}' falls back to main stream", name);
+    }
+    impl_->dispatcher.RegisterConsumer(name, std::move(callback), type, queue_size, drop_policy,
+                                       strand);
+}
+
+bool RetinaFaceProducer::RemoveStreamConsumer(const std::string& name) {
+    return impl_->dispatcher.RemoveConsumer(name) ||
+           impl_->sub_stream.Dispatcher().RemoveConsumer(name);
 }
 
 void RetinaFaceProducer::ClearStreamConsumers() {
     impl_->dispatcher.ClearConsumers();
+    impl_->sub_stream.Dispatcher().ClearConsumers();
+}
+
+std::vector<StreamConsumerStats> RetinaFaceProducer::GetStreamConsumerStats() const {
+    auto stats = impl_->dispatcher.GetConsumerStats();
+    impl_->sub_stream.AppendConsumerStats(stats);
+    return stats;
+}
+
+ProducerStats RetinaFaceProducer::GetProducerStats() const {
+    ProducerStats stats;
+    stats.video_frames = video_rate_.Total();
+    stats.inference_frames = inference_count_.load();
+    stats.total_detections = detection_count_.load();
+    stats.video_fps = video_rate_.Fps();
+    stats.inference_fps = inference_rate_.Fps();
+    if (stats.inference_frames > 0) {
+        stats.avg_inference_ms =
+            inference_time_us_.load() / 1000.0 / static_cast<double>(stats.inference_frames);
+    }
+    stats.async_inference = impl_->dual_channel || config_.async_inference;
+    stats.inference_divisor = inference_divisor_.load();
+    fill_keyframe_stats(impl_->dispatcher, impl_->sub_stream, &stats);
+    fill_gop_cache_stats(impl_->dispatcher, impl_->sub_stream, &stats);
+    stats.snapshot = impl_->snapshot.GetStats();
+
+    stats.smart_encode = impl_->smart_encoder.GetStats();
+    stats.osd_enabled = impl_->rgn_overlay;
+    if (impl_->rgn_overlay) {
+        OSDStats osd = impl_->osd.GetStats();
+        stats.osd_updates = osd.updates;
+        stats.osd_mpi_calls = osd.total_mpi_calls;
+        stats.osd_last_mpi_calls = osd.last.Total();
+        stats.osd_last_moves = osd.last.move;
+        stats.osd_last_bitmaps = osd.last.set_bitmap;
+        stats.osd_handles_created = osd.handles_created;
+        stats.osd_handles_visible = osd.handles_visible;
+    }
+    return stats;
 }
 
 int RetinaFaceProducer::SetResolution(Resolution preset) {
@@ -264,15 +369,77 @@ int RetinaFaceProducer::SetResolution(Resolution preset) {
 }
 
 int RetinaFaceProducer::SetFrameRate(int fps) {
+    fps = std::max(1, std::min(fps, 30));
     if (running_.load()) {
-        LOG_WARN("Cannot change framerate while running");
-        return -1;
+        // 运行中只调整主码流 VENC 输出帧率（经检测驱动编码，静止状态仍取较小值）
+        return impl_->smart_encoder.SetFrameRate(std::min(fps, config_.framerate));
     }
-    fps = std::max(1, std::min(fps, 30));
     config_.framerate = fps;
     return 0;
 }
 
+int RetinaFaceProducer::SetInferenceDivisor(int divisor) {
+    divisor = std::max(1, divisor);
+    if (inference_divisor_.exchange(divisor) != divisor) {
+        LOG_INFO("Inference divisor set to {}", divisor);
+    }
+    return 0;
+}
+
+// ============================================================================
+// 编码器运行时控制
+// ============================================================================
+
+int RetinaFaceProducer::SetBitrate(StreamSelector stream, int kbps) {
+    if (!initialized_.load() || kbps <= 0) {
+        return -1;
+    }
+    int chn = kVencChn;
+    if (stream == StreamSelector::kSub) {
+        if (!impl_->sub_stream.IsEnabled()) {
+            return -1;
+        }
+        chn = kVencSubChn;
+    }
+
+    // 主码流经检测驱动编码下发：静止状态下按比例折算，恢复时回到该码率
+    RK_S32 ret = (chn == kVencChn) ? impl_->smart_encoder.SetBitrate(kbps)
+                                   : venc_set_bitrate(chn, static_cast<RK_U32>(kbps));
+    if (ret != RK_SUCCESS) {
+        LOG_WARN("VENC chn{} set bitrate {}kbps failed: {:#x}", chn, kbps, ret);
+        return -1;
+    }
+    LOG_DEBUG("VENC chn{} bitrate -> {}kbps", chn, kbps);
+    return 0;
+}
+
+int RetinaFaceProducer::RequestKeyFrame(StreamSelector stream, const char* reason) {
+    if (!initialized_.load()) {
+        return -1;
+    }
+    auto& keyframes = (stream == StreamSelector::kSub && impl_->sub_stream.IsEnabled())
+                          ? impl_->sub_stream.Dispatcher().Keyframes()
+                          : impl_->dispatcher.Keyframes();
+    return keyframes.Request(reason) ? 0 : -1;
+}
+
+std::vector<EncodedStreamPtr> RetinaFaceProducer::GetGopSnapshot(StreamSelector stream) {
+    if (!initialized_.load()) {
+        return {};
+    }
+    auto& gop = (stream == StreamSelector::kSub && impl_->sub_stream.IsEnabled())
+                    ? impl_->sub_stream.Dispatcher().Gop()
+                    : impl_->dispatcher.Gop();
+    return gop.Snapshot();
+}
+
+int RetinaFaceProducer::CaptureSnapshot(const SnapshotRequest& request, Snapshot* out) {
+    if (!initialized_.load()) {
+        return -1;
+    }
+    return impl_->snapshot.Capture(request, out);
+}
+
 // ============================================================================
 // MPI 初始化
 // ============================================================================
@@ -281,45 +448,56 @@ int RetinaFaceProducer::InitMpi() {
     auto res = config_.GetResolutionConfig();
     RK_S32 ret;
 
-    // 1. ISP 初始化
-    const char* iq_dir = "/etc/iqfiles";
-    SAMPLE_COMM_ISP_Init(kViDev, RK_AIQ_WORKING_MODE_NORMAL, RK_FALSE, iq_dir);
-    SAMPLE_COMM_ISP_Run(kViDev);
-    impl_->isp_initialized = true;
-    LOG_DEBUG("ISP initialized");
-
-    // 2. MPI 系统初始化
-    ret = RK_MPI_SYS_Init();
-    if (ret != RK_SUCCESS) {
-        LOG_ERROR("RK_MPI_SYS_Init failed: {:#x}", ret);
+    // 1-3. 共享采集核心（ISP + MPI 系统 + VI，模式切换时保持运行）
+    if (CaptureCore::Instance().Acquire(res.width, res.height) != 0) {
+        LOG_ERROR("Failed to acquire capture core");
         return -1;
     }
-    impl_->mpi_initialized = true;
-    LOG_DEBUG("MPI system initialized");
-
-    // 3. VI 初始化
-    vi_dev_init();
-    vi_chn_init(kViChn, res.width, res.height);
-    impl_->vi_enabled = true;
-    LOG_DEBUG("VI initialized: {}x{}", res.width, res.height);
-
-    // 4. VPSS 初始化（串行模式）
-    ret = vpss_init_serial_mode(kVpssGrp, res.width, res.height);
+    impl_->capture_acquired = true;
+    LOG_DEBUG("Capture core acquired: {}x{}", res.width, res.height);
+
+    // 4. VPSS 初始化（串行模式；双通道布局下额外启用模型尺寸的 Chn1）
+    impl_->dual_channel = (config_.ai_input_layout == AiInputLayout::kDualChannel);
+    impl_->nv12_venc = impl_->dual_channel || config_.ai_overlay != OverlayBackend::kCpu;
+    impl_->rgn_overlay = impl_->nv12_venc && config_.ai_overlay != OverlayBackend::kClient;
+    if (impl_->dual_channel && config_.ai_overlay == OverlayBackend::kCpu) {
+        LOG_WARN("CPU overlay is not available with dual-channel layout, using RGN");
+    }
+    if (impl_->dual_channel) {
+        vpss_ai_chn_size(res.width, res.height, config_.ai_width, config_.ai_height,
+                         impl_->ai_chn_width, impl_->ai_chn_height);
+        PIXEL_FORMAT_E ai_format = (config_.ai_input_format == AiInputFormat::kRGB888)
+                                       ? RK_FMT_RGB888 : RK_FMT_YUV420SP;
+        ret = vpss_init_serial_mode(kVpssGrp, res.width, res.height,
+                                    impl_->ai_chn_width, impl_->ai_chn_height, ai_format);
+    } else {
+        ret = vpss_init_serial_mode(kVpssGrp, res.width, res.height);
+    }
     if (ret != 0) {
         LOG_ERROR("VPSS init failed");
         return -1;
     }
     impl_->vpss_enabled = true;
-    LOG_DEBUG("VPSS initialized (serial mode)");
+    LOG_DEBUG("VPSS initialized ({})", impl_->dual_channel ? "dual channel" : "serial mode");
 
-    // 5. VENC 初始化（RGB 输入）
-    ret = venc_init_rgb_input(kVencChn, res.width, res.height, RK_VIDEO_ID_AVC);
+    // 5. VENC 初始化（RGN 叠框 / 客户端渲染：NV12 输入；CPU 叠框：RGB 输入接收叠框后的帧）
+    const RK_CODEC_ID_E codec_id = to_rk_codec_id(config_.codec);
+    if (impl_->nv12_venc) {
+        ret = venc_init_nv12_input(kVencChn, res.width, res.height, codec_id);
+    } else {
+        ret = venc_init_rgb_input(kVencChn, res.width, res.height, codec_id);
+    }
     if (ret != 0) {
         LOG_ERROR("VENC init failed");
         return -1;
     }
     impl_->venc_enabled = true;
-    LOG_DEBUG("VENC initialized (RGB input mode)");
+    impl_->smart_encoder.Configure(config_.smart_encode, kVencChn, res.width, res.height);
+    impl_->dispatcher.SetCodec(config_.codec);
+    impl_->dispatcher.Keyframes().SetChannel(kVencChn);
+    impl_->dispatcher.Gop().Configure(config_.gop_cache_kb > 0 ? config_.gop_cache_kb * 1024 : 0);
+    LOG_DEBUG("VENC initialized ({}, {} input mode)",
+              VideoCodecToString(config_.codec), impl_->nv12_venc ? "NV12" : "RGB");
 
     // 6. 绑定 VI -> VPSS
     impl_->vi_chn.enModId = RK_ID_VI;
@@ -337,13 +515,62 @@ int RetinaFaceProducer::InitMpi() {
     }
     LOG_DEBUG("VI -> VPSS bound");
 
+    // 7. 双通道布局：绑定 VPSS Chn0 -> VENC
+    if (impl_->dual_channel) {
+        impl_->vpss_out.enModId = RK_ID_VPSS;
+        impl_->vpss_out.s32DevId = kVpssGrp;
+        impl_->vpss_out.s32ChnId = kVpssChn0;
+
+        impl_->venc_chn.enModId = RK_ID_VENC;
+        impl_->venc_chn.s32DevId = 0;
+        impl_->venc_chn.s32ChnId = kVencChn;
+
+        ret = RK_MPI_SYS_Bind(&impl_->vpss_out, &impl_->venc_chn);
+        if (ret != RK_SUCCESS) {
+            LOG_ERROR("Failed to bind VPSS -> VENC: {:#x}", ret);
+            return -1;
+        }
+        impl_->vpss_venc_bound = true;
+        LOG_DEBUG("VPSS chn0 -> VENC bound, chn1 {}x{} for NPU",
+                  impl_->ai_chn_width, impl_->ai_chn_height);
+    }
+
+    // 8. 子码流：VPSS Chn2 -> VENC Chn1（失败时仅保留主码流）
+    if (config_.sub_stream &&
+        impl_->sub_stream.Init(make_sub_stream_config(config_, kVpssGrp, kVpssChnSub,
+                                                      kVencSubChn)) != 0) {
+        LOG_WARN("Sub stream unavailable, continuing with main stream only");
+    }
+
+    // 9. JPEG 抓拍：VPSS Chn3 -> VENC Chn2（请求时才使能）
+    if (config_.snapshot) {
+        SnapshotConfig snap;
+        snap.vpss_grp = kVpssGrp;
+        snap.vpss_chn = kVpssChnSnap;
+        snap.venc_chn = kVencSnapChn;
+        snap.max_width = res.width;
+        snap.max_height = res.height;
+        snap.quality = config_.snapshot_quality;
+        snap.cache_ms = config_.snapshot_cache_ms;
+        impl_->snapshot.Init(snap);
+    }
+
     return 0;
 }
 
 int RetinaFaceProducer::DeinitMpi() {
+    // 子码流与抓拍（需在 VPSS Group 销毁前拆除）
+    impl_->sub_stream.Deinit();
+    impl_->snapshot.Deinit();
+
+    if (impl_->vpss_venc_bound) {
+        RK_MPI_SYS_UnBind(&impl_->vpss_out, &impl_->venc_chn);
+        impl_->vpss_venc_bound = false;
+    }
     RK_MPI_SYS_UnBind(&impl_->vi_chn, &impl_->vpss_grp);
 
     if (impl_->venc_enabled) {
+        impl_->dispatcher.Keyframes().SetChannel(-1);
         RK_MPI_VENC_StopRecvFrame(kVencChn);
 
         VENC_STREAM_S stFrame;
@@ -365,46 +592,59 @@ int RetinaFaceProducer::DeinitMpi() {
     }
 
     if (impl_->vpss_enabled) {
-        vpss_deinit(kVpssGrp, false);
+        vpss_deinit(kVpssGrp, impl_->dual_channel);
         impl_->vpss_enabled = false;
     }
 
-    if (impl_->vi_enabled) {
-        RK_MPI_VI_DisableChn(kViDev, kViChn);
-        RK_MPI_VI_DisableDev(kViDev);
-        impl_->vi_enabled = false;
+    if (impl_->capture_acquired) {
+        CaptureCore::Instance().Release();
+        impl_->capture_acquired = false;
     }
 
-    if (impl_->mpi_initialized) {
-        RK_MPI_SYS_Exit();
-        impl_->mpi_initialized = false;
-    }
+    return 0;
+}
 
-    if (impl_->isp_initialized) {
-        SAMPLE_COMM_ISP_Stop(kViDev);
-        impl_->isp_initialized = false;
-    }
+namespace {
 
+rknn::ModelConfig MakeModelConfig() {
+    rknn::ModelConfig model_cfg;
+    model_cfg.model_path = kDefaultModelPath;  // 使用 mpi_config.h 中的相对路径
+    model_cfg.conf_threshold = 0.5f;
+    model_cfg.nms_threshold = 0.4f;
+    return model_cfg;
+}
+
+}  // namespace
+
+std::shared_ptr<rknn::RetinaFaceModel> RetinaFaceProducer::AcquireModel() {
+    return rknn::ModelCache::Instance().Acquire<rknn::RetinaFaceModel>(
+        rknn::ModelTypeToString(rknn::ModelType::kRetinaFace), MakeModelConfig());
+}
+
+int RetinaFaceProducer::PreloadModel() {
+    auto model = AcquireModel();
+    if (!model) {
+        LOG_ERROR("Failed to preload RetinaFace model");
+        return -1;
+    }
+    LOG_INFO("RetinaFace model preloaded");
+    rknn::ModelCache::Instance().Release(model);  // 常驻与否由缓存策略决定
     return 0;
 }
 
 int RetinaFaceProducer::InitAiEngine() {
     // 初始化图像处理器
     impl_->image_processor = std::make_unique<rknn::ImageProcessor>();
-    if (!impl_->image_processor->Init(config_.ai_width, config_.ai_height)) {
+    auto backend = config_.rga_preprocess ? rknn::PreprocessBackend::kRga
+                                          : rknn::PreprocessBackend::kOpenCV;
+    if (!impl_->image_processor->Init(config_.ai_width, config_.ai_height, backend)) {
         LOG_ERROR("Failed to init image processor");
         return -1;
     }
 
-    // 初始化 AI 模型
-    impl_->ai_model = std::make_unique<rknn::RetinaFaceModel>();
-    
-    rknn::ModelConfig model_cfg;
-    model_cfg.model_path = kDefaultModelPath;  // 使用 mpi_config.h 中的相对路径
-    model_cfg.conf_threshold = 0.5f;
-    model_cfg.nms_threshold = 0.4f;
-
-    if (impl_->ai_model->Init(model_cfg) != 0) {
+    // 初始化 AI 模型（缓存命中时直接复用已加载的 rknn 上下文与 IO 内存）
+    impl_->ai_model = AcquireModel();
+    if (!impl_->ai_model) {
         LOG_ERROR("Failed to init RetinaFace model");
         return -1;
     }
@@ -420,8 +660,7 @@ int RetinaFaceProducer::InitAiEngine() {
 
 void RetinaFaceProducer::DeinitAiEngine() {
     if (impl_->ai_model) {
-        impl_->ai_model->Deinit();
-        impl_->ai_model.reset();
+        rknn::ModelCache::Instance().Release(impl_->ai_model);
     }
     if (impl_->image_processor) {
         impl_->image_processor->Deinit();
@@ -450,119 +689,231 @@ bool RetinaFaceProducer::InitRgbPool() {
 void RetinaFaceProducer::FrameLoop() {
     LOG_INFO("RetinaFace frame loop started");
 
-    auto res = config_.GetResolutionConfig();
-    uint32_t time_ref = 0;
-    VIDEO_FRAME_INFO_S vpss_frame;
+    if (impl_->dual_channel) {
+        // VENC 由 VPSS 硬件绑定送帧，这里只负责取流分发
+        SeiStamper sei;
+        while (running_.load()) {
+            RK_S32 last_error = 0;
+            auto stream = acquire_encoded_stream(kVencChn, 100, &last_error);
+            if (!stream) {
+                continue;
+            }
+            frame_count_++;
+            sei.OnFetched(kVencChn, stream->pstPack->u64PTS);
+            impl_->dispatcher.DispatchFrame(stream);
+            video_rate_.Tick();
+        }
 
-    VIDEO_FRAME_INFO_S rgb_frame;
-    memset(&rgb_frame, 0, sizeof(rgb_frame));
-    rgb_frame.stVFrame.u32Width = res.width;
-    rgb_frame.stVFrame.u32Height = res.height;
-    rgb_frame.stVFrame.u32VirWidth = res.width;
-    rgb_frame.stVFrame.u32VirHeight = res.height;
-    rgb_frame.stVFrame.enPixelFormat = RK_FMT_RGB888;
-    rgb_frame.stVFrame.u32FrameFlag = 160;
+        LOG_INFO("Frame loop exited, total frames: {}, inferences: {}",
+                 frame_count_.load(), inference_count_.load());
+        return;
+    }
+
+    uint32_t time_ref = 0;
+    const bool async = config_.async_inference;
 
     while (running_.load()) {
-        RK_S32 ret = RK_MPI_VPSS_GetChnFrame(kVpssGrp, kVpssChn0, &vpss_frame, 100);
-        if (ret != RK_SUCCESS) {
-            if (ret != RK_ERR_VPSS_BUF_EMPTY) {
-                LOG_WARN("VPSS GetChnFrame failed: {:#x}", ret);
-            }
+        VideoFramePtr frame = acquire_vpss_frame(kVpssGrp, kVpssChn0, 100);
+        if (!frame) {
             continue;
         }
 
         frame_count_++;
 
-        void* vpss_data = RK_MPI_MB_Handle2VirAddr(vpss_frame.stVFrame.pMbBlk);
-        if (!vpss_data) {
-            RK_MPI_VPSS_ReleaseChnFrame(kVpssGrp, kVpssChn0, &vpss_frame);
-            continue;
-        }
-
-        MB_BLK rgb_blk = impl_->rgb_pool.GetBlock(true);
-        if (rgb_blk == MB_INVALID_HANDLE) {
-            RK_MPI_VPSS_ReleaseChnFrame(kVpssGrp, kVpssChn0, &vpss_frame);
-            continue;
+        if (async) {
+            impl_->inference_frame.update(frame);
+        } else {
+            RunInference(frame);
         }
 
-        void* rgb_data = RK_MPI_MB_Handle2VirAddr(rgb_blk);
-        uint64_t pts = vpss_frame.stVFrame.u64PTS;
+        EncodeFrame(frame, time_ref++);
+    }
 
-        bool processed = ProcessFrame(
-            vpss_data,
-            vpss_frame.stVFrame.u32Width,
-            vpss_frame.stVFrame.u32Height,
-            vpss_frame.stVFrame.u32VirWidth,
-            rgb_data,
-            pts
-        );
+    LOG_INFO("RetinaFace frame loop exited, total frames: {}, inferences: {}",
+             frame_count_.load(), inference_count_.load());
+}
 
-        RK_MPI_VPSS_ReleaseChnFrame(kVpssGrp, kVpssChn0, &vpss_frame);
+void RetinaFaceProducer::InferenceLoop() {
+    LOG_INFO("RetinaFace inference loop started");
 
-        if (!processed) {
-            RetinaMbPool::ReleaseBlock(rgb_blk);
+    while (running_.load()) {
+        // 双通道布局直接从 Chn1 取硬件缩放后的帧（depth=1，天然只保留最新帧）
+        VideoFramePtr frame = impl_->dual_channel
+                                  ? acquire_vpss_frame(kVpssGrp, kVpssChn1, 100)
+                                  : impl_->inference_frame.wait(100);
+        if (!frame) {
             continue;
         }
+        RunInference(std::move(frame));
+    }
 
-        rgb_frame.stVFrame.pMbBlk = rgb_blk;
-        rgb_frame.stVFrame.u64PTS = pts;
-        rgb_frame.stVFrame.u32TimeRef = time_ref++;
-
-        ret = RK_MPI_VENC_SendFrame(kVencChn, &rgb_frame, 100);
-        RetinaMbPool::ReleaseBlock(rgb_blk);
+    LOG_INFO("RetinaFace inference loop exited, inferences: {}", inference_count_.load());
+}
 
-        if (ret != RK_SUCCESS) {
-            continue;
-        }
+bool RetinaFaceProducer::RunInference(VideoFramePtr frame) {
+    // 推理降速：未轮到的帧不推理，画面保持上次结果
+    const int divisor = inference_divisor_.load(std::memory_order_relaxed);
+    if (divisor > 1 && ++frames_since_throttle_ < divisor) {
+        return true;
+    }
+    frames_since_throttle_ = 0;
 
-        RK_S32 last_error = 0;
-        auto stream = acquire_encoded_stream(kVencChn, 100, &last_error);
-        if (stream) {
-            impl_->dispatcher.DispatchFrame(stream);
-        }
+    void* nv12_data = get_frame_vir_addr(frame);
+    if (!nv12_data) {
+        return false;
     }
 
-    LOG_INFO("RetinaFace frame loop exited, total frames: {}, inferences: {}",
-             frame_count_.load(), inference_count_.load());
-}
+    static const auto stages = InferenceStageMetrics::ForModel("retinaface");
+    const uint64_t capture_pts = frame->stVFrame.u64PTS;
+    auto start = std::chrono::steady_clock::now();
+    auto overlay = std::make_shared<Impl::Overlay>();
 
-bool RetinaFaceProducer::ProcessFrame(void* nv12_data, int width, int height, int stride,
-                                      void* rgb_output, uint64_t pts) {
-    (void)pts;
-    
-    rknn::LetterboxInfo letterbox_info;
-    int ret = impl_->image_processor->ConvertNV12ToModelInput(
-        nv12_data, width, height, stride,
-        impl_->ai_model->GetInputVirtAddr(),
-        letterbox_info
-    );
+    rknn::ImageBuffer src;
+    src.data = nv12_data;
+    src.width = frame->stVFrame.u32Width;
+    src.height = frame->stVFrame.u32Height;
+    src.stride = frame->stVFrame.u32VirWidth;
+    src.vir_height = frame->stVFrame.u32VirHeight;
+    src.fd = get_frame_fd(frame);
+
+    rknn::ImageBuffer dst;
+    dst.data = impl_->ai_model->GetInputVirtAddr();
+    dst.width = config_.ai_width;
+    dst.height = config_.ai_height;
+    dst.fd = impl_->ai_model->GetInputFd();
+
+    int ret = 0;
+    if (frame->stVFrame.enPixelFormat == RK_FMT_RGB888) {
+        src.stride = frame->stVFrame.u32VirWidth * 3;
+        ret = impl_->image_processor->LetterboxRGBToModelInput(src, dst, overlay->letterbox);
+    } else {
+        ret = impl_->image_processor->ConvertNV12ToModelInput(src, dst, overlay->letterbox);
+    }
+
+    // 模型输入已拷贝完成，尽早归还 VPSS buffer
+    frame.reset();
 
     if (ret != 0) {
         return false;
     }
+    stages.preprocess.ObserveSince(start);
 
+    auto stage_start = std::chrono::steady_clock::now();
     ret = impl_->ai_model->Run();
     if (ret != 0) {
         return false;
     }
+    stages.inference.ObserveSince(stage_start);
+    stage_start = std::chrono::steady_clock::now();
+
+    impl_->ai_model->GetResults(overlay->results);
+    size_t count = overlay->results.Count();
+    auto res = config_.GetResolutionConfig();
+    if (impl_->dual_channel) {
+        // Chn1 坐标 -> Chn0（VENC）坐标：在 letterbox 缩放上叠加两通道的尺寸比
+        overlay->letterbox.scale *= static_cast<float>(impl_->ai_chn_width) / res.width;
+        overlay->letterbox.src_width = res.width;
+        overlay->letterbox.src_height = res.height;
+    }
+
+    // RGN 叠框与检测事件都需要主码流坐标，映射一次共用
+    rknn::DetectionResultList mapped;
+    if (impl_->rgn_overlay || detection_callback_ || impl_->smart_encoder.Enabled()) {
+        mapped = overlay->results;
+        rknn::ImageProcessor::MapDetections(mapped, overlay->letterbox, res.width, res.height);
+        mapped.frame_id = static_cast<int>(inference_count_.load());
+        mapped.pts = capture_pts;
+    }
+    if (impl_->rgn_overlay) {
+        impl_->ai_model->GenerateOSDBoxes(mapped, impl_->osd_boxes);
+        impl_->osd.UpdateBoxes(impl_->osd_boxes);
+    }
+    impl_->smart_encoder.OnDetections(mapped);
+    impl_->PublishOverlay(std::move(overlay));
+
+    if (detection_callback_) {
+        detection_callback_(mapped, res.width, res.height);
+    }
+    stages.postprocess.ObserveSince(stage_start);
+    LatencyTracer::Instance().Record(LatencyTracer::Stage::kInference, capture_pts);
+
+    auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    inference_time_us_ += static_cast<uint64_t>(elapsed_us);
+    detection_count_ += count;
     inference_count_++;
+    inference_rate_.Tick();
+
+    if (inference_count_ % 30 == 0 && count > 0) {
+        LOG_DEBUG("Inference {}: {} faces, {:.1f} ms",
+                  inference_count_.load(), count, elapsed_us / 1000.0);
+    }
+
+    return true;
+}
 
-    rknn::DetectionResultList results;
-    impl_->ai_model->GetResults(results);
+bool RetinaFaceProducer::EncodeFrame(const VideoFramePtr& frame, uint32_t time_ref) {
+    void* nv12_data = get_frame_vir_addr(frame);
+    if (!nv12_data) {
+        return false;
+    }
+
+    const int width = frame->stVFrame.u32Width;
+    const int height = frame->stVFrame.u32Height;
+
+    // 调试：采集时刻写入本帧 SEI（送帧模式下时刻精确）
+    LatencyTracer::Instance().StampSei(kVencChn, frame->stVFrame.u64PTS);
+
+    RK_S32 ret = RK_SUCCESS;
+    if (impl_->nv12_venc) {
+        // RGN 叠框 / 客户端渲染：VPSS NV12 帧原样送 VENC，零拷贝
+        VIDEO_FRAME_INFO_S nv12_frame = *frame;
+        nv12_frame.stVFrame.u32TimeRef = time_ref;
+        ret = RK_MPI_VENC_SendFrame(kVencChn, &nv12_frame, 100);
+    } else {
+        MB_BLK rgb_blk = impl_->rgb_pool.GetBlock(true);
+        if (rgb_blk == MB_INVALID_HANDLE) {
+            return false;
+        }
+        void* rgb_data = RK_MPI_MB_Handle2VirAddr(rgb_blk);
+
+        if (impl_->image_processor->ConvertNV12ToRGB(
+                nv12_data, width, height, frame->stVFrame.u32VirWidth, rgb_data) != 0) {
+            RetinaMbPool::ReleaseBlock(rgb_blk);
+            return false;
+        }
+
+        auto overlay = impl_->CurrentOverlay();
+        if (overlay && overlay->results.Count() > 0) {
+            impl_->image_processor->DrawDetections(
+                rgb_data, width, height, overlay->results, overlay->letterbox);
+        }
+
+        VIDEO_FRAME_INFO_S rgb_frame;
+        memset(&rgb_frame, 0, sizeof(rgb_frame));
+        rgb_frame.stVFrame.u32Width = width;
+        rgb_frame.stVFrame.u32Height = height;
+        rgb_frame.stVFrame.u32VirWidth = width;
+        rgb_frame.stVFrame.u32VirHeight = height;
+        rgb_frame.stVFrame.enPixelFormat = RK_FMT_RGB888;
+        rgb_frame.stVFrame.u32FrameFlag = 160;
+        rgb_frame.stVFrame.pMbBlk = rgb_blk;
+        rgb_frame.stVFrame.u64PTS = frame->stVFrame.u64PTS;
+        rgb_frame.stVFrame.u32TimeRef = time_ref;
 
-    impl_->image_processor->ConvertNV12ToModelInput(
-        nv12_data, width, height, stride,
-        rgb_output,
-        letterbox_info
-    );
+        ret = RK_MPI_VENC_SendFrame(kVencChn, &rgb_frame, 100);
+        RetinaMbPool::ReleaseBlock(rgb_blk);
+    }
 
-    impl_->image_processor->DrawDetections(
-        rgb_output, width, height, results, letterbox_info
-    );
+    if (ret != RK_SUCCESS) {
+        return false;
+    }
 
-    if (frame_count_ % 30 == 0 && results.Count() > 0) {
-        LOG_DEBUG("Frame {}: {} faces", frame_count_.load(), results.Count());
+    RK_S32 last_error = 0;
+    auto stream = acquire_encoded_stream(kVencChn, 100, &last_error);
+    if (stream) {
+        impl_->dispatcher.DispatchFrame(stream);
+        video_rate_.Tick();
     }
 
     return true;
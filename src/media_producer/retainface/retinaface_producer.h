@@ -3,11 +3,15 @@
  * @brief RetinaFace 人脸检测模式生产者
  *
  * 数据流架构与 YoloProducer 类似，但使用 RetinaFace 模型进行人脸检测。
+ * 默认双通道布局：VPSS Chn0 硬件绑定 NV12 VENC，Chn1 输出模型尺寸帧给 NPU，人脸框经 RGN 叠加。
+ * 单通道布局下异步推理通过 LatestFrameHolder 消费最新帧，async_inference = false 时退回串行流水线；
+ * CPU 叠框（ai_overlay = kCpu，可绘制关键点）仅用于单通道布局。
+ * 客户端渲染（ai_overlay = kClient）不叠框，人脸框与关键点经元数据通道交给浏览器绘制。
  *
  * 特点：
- * - VPSS 和 VENC 解绑，由软件控制时序
+ * - 单通道布局下 VPSS 和 VENC 解绑，由软件控制时序
  * - 支持 RetinaFace 人脸检测 + 5 点关键点
- * - 检测框和关键点通过 OSD 叠加到编码流
+ * - 检测框默认通过 RGN 叠加到编码流（关键点仅 CPU 叠框模式绘制）
  *
  * @author 好软，好温暖
  * @date 2026-02-12
@@ -22,6 +26,10 @@
 #include <mutex>
 #include <thread>
 
+namespace rknn {
+class RetinaFaceModel;
+}
+
 namespace media {
 
 /**
@@ -51,17 +59,43 @@ public:
         const std::string& name,
         StreamCallback callback,
         StreamConsumerType type = StreamConsumerType::AsyncIO,
-        int queue_size = 3) override;
+        int queue_size = 3,
+        QueueDropPolicy drop_policy = QueueDropPolicy::DropToKeyframe,
+        StreamSelector stream = StreamSelector::kMain,
+        const std::string& strand = {}) override;
 
+    bool RemoveStreamConsumer(const std::string& name) override;
     void ClearStreamConsumers() override;
+    std::vector<StreamConsumerStats> GetStreamConsumerStats() const override;
 
     bool IsInitialized() const override { return initialized_.load(); }
     bool IsRunning() const override { return running_.load(); }
     const char* GetTypeName() const override { return "RetinaFace"; }
     const ProducerConfig& GetConfig() const override { return config_; }
+    ProducerStats GetProducerStats() const override;
 
     int SetResolution(Resolution preset) override;
     int SetFrameRate(int fps) override;
+    int SetInferenceDivisor(int divisor) override;
+    int SetBitrate(StreamSelector stream, int kbps) override;
+    int RequestKeyFrame(StreamSelector stream, const char* reason = nullptr) override;
+    std::vector<EncodedStreamPtr> GetGopSnapshot(StreamSelector stream) override;
+    int CaptureSnapshot(const SnapshotRequest& request, Snapshot* out) override;
+    void SetDetectionCallback(DetectionCallback callback) override {
+        detection_callback_ = std::move(callback);
+    }
+
+    /**
+     * @brief 预加载 RetinaFace 模型到模型缓存（不创建 MPI 资源）
+     * @return 0 成功，-1 失败
+     */
+    static int PreloadModel();
+
+    /**
+     * @brief 从模型缓存获取 RetinaFace 模型（组合模式下由 YoloProducer 共用同一份配置）
+     * @return 模型实例，用完后交还 ModelCache::Release()；失败返回 nullptr
+     */
+    static std::shared_ptr<rknn::RetinaFaceModel> AcquireModel();
 
 private:
     RetinaFaceProducer(const RetinaFaceProducer&) = delete;
@@ -73,8 +107,9 @@ private:
     void DeinitAiEngine();
     bool InitRgbPool();
     void FrameLoop();
-    bool ProcessFrame(void* nv12_data, int width, int height, int stride,
-                      void* rgb_output, uint64_t pts);
+    void InferenceLoop();
+    bool RunInference(VideoFramePtr frame);
+    bool EncodeFrame(const VideoFramePtr& frame, uint32_t time_ref);
 
 private:
     ProducerConfig config_;
@@ -83,12 +118,22 @@ private:
     std::atomic<bool> running_{false};
     
     std::thread frame_thread_;
+    std::thread inference_thread_;
     
     struct Impl;
     std::unique_ptr<Impl> impl_;
 
+    // 检测结果回调（Start() 之前设置，推理线程只读）
+    DetectionCallback detection_callback_;
+
     std::atomic<uint64_t> frame_count_{0};
     std::atomic<uint64_t> inference_count_{0};
+    std::atomic<uint64_t> inference_time_us_{0};
+    std::atomic<uint64_t> detection_count_{0};
+    std::atomic<int> inference_divisor_{1};
+    int frames_since_throttle_ = 0;     // 仅推理线程访问
+    RateMeter video_rate_;
+    RateMeter inference_rate_;
 };
 
 }  // namespace media
@@ -15,85 +15,25 @@
 #include "rk_mpi_venc.h"
 #include "rk_mpi_vi.h"
 
+#include "../common/capture_core.h"
+#include "../common/venc_codec.h"
+
 namespace media {
 
 // ============================================================================
 // MPI 通道/Group 常量
 // ============================================================================
 
-constexpr int kViDev = 0;       ///< VI 设备 ID
-constexpr int kViChn = 0;       ///< VI 通道 ID
+constexpr int kViDev = kCaptureViDev;   ///< VI 设备 ID（由共享采集核心管理）
+constexpr int kViChn = kCaptureViChn;   ///< VI 通道 ID（由共享采集核心管理）
 constexpr int kVpssGrp = 0;     ///< VPSS Group ID
 constexpr int kVpssChn0 = 0;    ///< VPSS 通道 0（编码流）
 constexpr int kVpssChn1 = 1;    ///< VPSS 通道 1（AI 推理）
 constexpr int kVencChn = 0;     ///< VENC 通道 ID
-
-// ============================================================================
-// VI 初始化函数
-// ============================================================================
-
-/**
- * @brief 初始化 VI 设备
- * 
- * RV1106 SDK 简化版：仅 memset 后调用 API
- */
-inline int vi_dev_init() {
-    int ret = 0;
-    int devId = kViDev;
-    int pipeId = devId;
-
-    VI_DEV_ATTR_S stDevAttr;
-    VI_DEV_BIND_PIPE_S stBindPipe;
-    memset(&stDevAttr, 0, sizeof(stDevAttr));
-    memset(&stBindPipe, 0, sizeof(stBindPipe));
-
-    // 检查设备配置状态
-    ret = RK_MPI_VI_GetDevAttr(devId, &stDevAttr);
-    if (ret == RK_ERR_VI_NOT_CONFIG) {
-        ret = RK_MPI_VI_SetDevAttr(devId, &stDevAttr);
-        if (ret != RK_SUCCESS) {
-            return -1;
-        }
-    }
-
-    // 检查设备启用状态
-    ret = RK_MPI_VI_GetDevIsEnable(devId);
-    if (ret != RK_SUCCESS) {
-        ret = RK_MPI_VI_EnableDev(devId);
-        if (ret != RK_SUCCESS) {
-            return -1;
-        }
-        stBindPipe.u32Num = 1;
-        stBindPipe.PipeId[0] = pipeId;
-        ret = RK_MPI_VI_SetDevBindPipe(devId, &stBindPipe);
-        if (ret != RK_SUCCESS) {
-            return -1;
-        }
-    }
-
-    return 0;
-}
-
-/**
- * @brief 初始化 VI 通道
- */
-inline int vi_chn_init(int channelId, int width, int height) {
-    VI_CHN_ATTR_S stChnAttr;
-    memset(&stChnAttr, 0, sizeof(stChnAttr));
-    stChnAttr.stIspOpt.stMaxSize.u32Width = width;
-    stChnAttr.stIspOpt.stMaxSize.u32Height = height;
-    stChnAttr.stIspOpt.u32BufCount = 2;
-    stChnAttr.stIspOpt.enMemoryType = VI_V4L2_MEMORY_TYPE_DMABUF;
-    stChnAttr.stSize.u32Width = width;
-    stChnAttr.stSize.u32Height = height;
-    stChnAttr.enPixelFormat = RK_FMT_YUV420SP;
-    stChnAttr.enCompressMode = COMPRESS_MODE_NONE;
-    stChnAttr.u32Depth = 0;
-
-    RK_MPI_VI_SetChnAttr(kViDev, channelId, &stChnAttr);
-    RK_MPI_VI_EnableChn(kViDev, channelId);
-    return 0;
-}
+constexpr int kVpssChnSub = 1;  ///< VPSS 通道 1（子码流缩放输出）
+constexpr int kVencSubChn = 1;  ///< VENC 子码流通道 ID
+constexpr int kVpssChnSnap = 2; ///< VPSS 通道 2（JPEG 抓拍，请求时临时使能）
+constexpr int kVencSnapChn = 2; ///< VENC JPEG 抓拍通道 ID
 
 // ============================================================================
 // VPSS 初始化函数
@@ -224,9 +164,7 @@ inline int venc_init(int chnId, int width, int height, RK_CODEC_ID_E enType) {
     VENC_CHN_ATTR_S stAttr;
     memset(&stAttr, 0, sizeof(stAttr));
 
-    stAttr.stVencAttr.enType = enType;
     stAttr.stVencAttr.enPixelFormat = RK_FMT_YUV420SP;
-    stAttr.stVencAttr.u32Profile = H264E_PROFILE_HIGH;
     stAttr.stVencAttr.u32PicWidth = width;
     stAttr.stVencAttr.u32PicHeight = height;
     stAttr.stVencAttr.u32VirWidth = width;
@@ -234,13 +172,7 @@ inline int venc_init(int chnId, int width, int height, RK_CODEC_ID_E enType) {
     stAttr.stVencAttr.u32StreamBufCnt = 2;
     stAttr.stVencAttr.u32BufSize = width * height / 2;
 
-    stAttr.stRcAttr.enRcMode = VENC_RC_MODE_H264CBR;
-    stAttr.stRcAttr.stH264Cbr.u32Gop = 30;
-    stAttr.stRcAttr.stH264Cbr.u32BitRate = 10 * 1024;  // 10 Mbps
-    stAttr.stRcAttr.stH264Cbr.fr32DstFrameRateDen = 1;
-    stAttr.stRcAttr.stH264Cbr.fr32DstFrameRateNum = 30;
-    stAttr.stRcAttr.stH264Cbr.u32SrcFrameRateDen = 1;
-    stAttr.stRcAttr.stH264Cbr.u32SrcFrameRateNum = 30;
+    venc_fill_cbr_attr(&stAttr, enType, 10 * 1024, 30, 30);  // 10 Mbps
 
     RK_MPI_VENC_CreateChn(chnId, &stAttr);
 
@@ -259,9 +191,7 @@ inline int venc_init_rgb_input(int chnId, int width, int height, RK_CODEC_ID_E e
     VENC_CHN_ATTR_S stAttr;
     memset(&stAttr, 0, sizeof(stAttr));
 
-    stAttr.stVencAttr.enType = enType;
     stAttr.stVencAttr.enPixelFormat = RK_FMT_RGB888;  // RGB 输入
-    stAttr.stVencAttr.u32Profile = H264E_PROFILE_HIGH;
     stAttr.stVencAttr.u32PicWidth = width;
     stAttr.stVencAttr.u32PicHeight = height;
     stAttr.stVencAttr.u32VirWidth = width;
@@ -269,13 +199,7 @@ inline int venc_init_rgb_input(int chnId, int width, int height, RK_CODEC_ID_E e
     stAttr.stVencAttr.u32StreamBufCnt = 2;
     stAttr.stVencAttr.u32BufSize = width * height;
 
-    stAttr.stRcAttr.enRcMode = VENC_RC_MODE_H264CBR;
-    stAttr.stRcAttr.stH264Cbr.u32Gop = 30;
-    stAttr.stRcAttr.stH264Cbr.u32BitRate = 8 * 1024;  // 8 Mbps
-    stAttr.stRcAttr.stH264Cbr.fr32DstFrameRateDen = 1;
-    stAttr.stRcAttr.stH264Cbr.fr32DstFrameRateNum = 30;
-    stAttr.stRcAttr.stH264Cbr.u32SrcFrameRateDen = 1;
-    stAttr.stRcAttr.stH264Cbr.u32SrcFrameRateNum = 30;
+    venc_fill_cbr_attr(&stAttr, enType, 8 * 1024, 30, 30);  // 8 Mbps
 
     RK_MPI_VENC_CreateChn(chnId, &stAttr);
 
@@ -10,9 +10,11 @@
 
 #include "simple_ipc_producer.h"
 #include "mpi_config.h"
+#include "../common/capture_core.h"
+#include "../common/sub_stream.h"
 #include "common/logger.h"
 #include "common/media_buffer.h"
-#include "common/asio_context.h"
+#include "common/stream_dispatcher.h"
 
 #include "sample_comm.h"
 #include "rk_mpi_sys.h"
@@ -25,111 +27,13 @@
 
 namespace media {
 
-// ============================================================================
-// 流分发器（嵌入实现）
-// ============================================================================
-
-/**
- * @brief 简化的流分发器
- * 
- * 直接在 Fetch 线程中分发，不使用额外队列
- */
-class SimpleStreamDispatcher {
-public:
-    struct ConsumerInfo {
-        std::string name;
-        StreamCallback callback;
-        StreamConsumerType type;
-    };
-
-    void RegisterConsumer(const std::string& name, StreamCallback callback, 
-                          StreamConsumerType type) {
-        consumers_.push_back({name, std::move(callback), type});
-        LOG_INFO("Registered stream consumer: {} (type={})", name, 
-                 type == StreamConsumerType::AsyncIO ? "AsyncIO" : "Direct");
-    }
-
-    void ClearConsumers() {
-        consumers_.clear();
-    }
-
-    void Start(int venc_chn) {
-        if (running_) return;
-        venc_chn_ = venc_chn;
-        running_ = true;
-        fetch_thread_ = std::thread(&SimpleStreamDispatcher::FetchLoop, this);
-        LOG_INFO("Stream dispatcher started for VENC channel {}", venc_chn);
-    }
-
-    void Stop() {
-        if (!running_) return;
-        running_ = false;
-        if (fetch_thread_.joinable()) {
-            fetch_thread_.join();
-        }
-        LOG_INFO("Stream dispatcher stopped");
-    }
-
-    bool IsRunning() const { return running_; }
-
-private:
-    void FetchLoop() {
-        uint64_t frame_count = 0;
-        uint64_t consecutive_errors = 0;
-
-        while (running_) {
-            RK_S32 last_error = 0;
-            auto stream = acquire_encoded_stream(venc_chn_, 1000, &last_error);
-
-            if (!stream) {
-                consecutive_errors++;
-                if (consecutive_errors > 3 && consecutive_errors % 10 == 0) {
-                    LOG_WARN("VENC consecutive errors: {}, last: {:#x}", 
-                             consecutive_errors, last_error);
-                }
-                continue;
-            }
-
-            frame_count++;
-            consecutive_errors = 0;
-
-            if (frame_count <= 5 || frame_count % 300 == 0) {
-                LOG_DEBUG("Frame #{}, size={} bytes", frame_count, 
-                         stream->pstPack ? stream->pstPack->u32Len : 0);
-            }
-
-            // 分发给所有消费者
-            for (auto& c : consumers_) {
-                if (!c.callback) continue;
-
-                if (c.type == StreamConsumerType::AsyncIO) {
-                    PostToIo([callback = c.callback, stream]() {
-                        callback(stream);
-                    });
-                } else {
-                    c.callback(stream);
-                }
-            }
-        }
-
-        LOG_DEBUG("Fetch loop exited, total frames: {}", frame_count);
-    }
-
-    std::vector<ConsumerInfo> consumers_;
-    std::atomic<bool> running_{false};
-    std::thread fetch_thread_;
-    int venc_chn_ = 0;
-};
-
 // ============================================================================
 // SimpleIPCProducer 内部实现
 // ============================================================================
 
 struct SimpleIPCProducer::Impl {
     // MPI 状态
-    bool isp_initialized = false;
-    bool mpi_initialized = false;
-    bool vi_enabled = false;
+    bool capture_acquired = false;   // 持有共享采集核心（ISP + SYS + VI）引用
     bool vpss_enabled = false;
     bool venc_enabled = false;
     
@@ -139,8 +43,14 @@ struct SimpleIPCProducer::Impl {
     MPP_CHN_S vpss_chn0;
     MPP_CHN_S venc_chn;
     
-    // 流分发器
-    SimpleStreamDispatcher dispatcher;
+    // 流分发器（内部 Fetch 线程拉流）
+    StreamDispatcher dispatcher;
+    
+    // 子码流（VPSS Chn1 -> VENC Chn1，自带分发器）
+    SubStream sub_stream;
+
+    // JPEG 抓拍（VPSS Chn2 -> VENC Chn2，按需）
+    SnapshotEncoder snapshot;
 };
 
 // ============================================================================
@@ -170,6 +80,7 @@ int SimpleIPCProducer::Init() {
 
     if (InitMpi() != 0) {
         LOG_ERROR("Failed to initialize MPI");
+        DeinitMpi();  // 归还已获取的采集核心引用
         return -1;
     }
 
@@ -211,6 +122,7 @@ bool SimpleIPCProducer::Start() {
     }
 
     impl_->dispatcher.Start(kVencChn);
+    impl_->sub_stream.Start();
     running_.store(true);
     LOG_INFO("SimpleIPC producer started");
     return true;
@@ -222,6 +134,7 @@ void SimpleIPCProducer::Stop() {
     }
 
     impl_->dispatcher.Stop();
+    impl_->sub_stream.Stop();
     running_.store(false);
     LOG_INFO("SimpleIPC producer stopped");
 }
@@ -230,13 +143,44 @@ void SimpleIPCProducer::RegisterStreamConsumer(
     const std::string& name,
     StreamCallback callback,
     StreamConsumerType type,
-    int queue_size) {
-    (void)queue_size;  // 不使用队列
-    impl_->dispatcher.RegisterConsumer(name, std::move(callback), type);
+    int queue_size,
+    QueueDropPolicy drop_policy,
+    StreamSelector stream,
+    const std::string& strand) {
+    if (stream == StreamSelector::kSub) {
+        if (impl_->sub_stream.IsEnabled()) {
+            impl_->sub_stream.Dispatcher().RegisterConsumer(
+                name, std::move(callback), type, queue_size, drop_policy, strand);
+            return;
+        }
+        LOG_WARN("Sub stream not enabled, consumer '{}' falls back to main stream", name);
+    }
+    impl_->dispatcher.RegisterConsumer(name, std::move(callback), type, queue_size, drop_policy,
+                                       strand);
+}
+
+bool SimpleIPCProducer::RemoveStreamConsumer(const std::string& name) {
+    return impl_->dispatcher.RemoveConsumer(name) ||
+           impl_->sub_stream.Dispatcher().RemoveConsumer(name);
 }
 
 void SimpleIPCProducer::ClearStreamConsumers() {
     impl_->dispatcher.ClearConsumers();
+    impl_->sub_stream.Dispatcher().ClearConsumers();
+}
+
+std::vector<StreamConsumerStats> SimpleIPCProducer::GetStreamConsumerStats() const {
+    auto stats = impl_->dispatcher.GetConsumerStats();
+    impl_->sub_stream.AppendConsumerStats(stats);
+    return stats;
+}
+
+ProducerStats SimpleIPCProducer::GetProducerStats() const {
+    ProducerStats stats;
+    fill_keyframe_stats(impl_->dispatcher, impl_->sub_stream, &stats);
+    fill_gop_cache_stats(impl_->dispatcher, impl_->sub_stream, &stats);
+    stats.snapshot = impl_->snapshot.GetStats();
+    return stats;
 }
 
 int SimpleIPCProducer::SetResolution(Resolution preset) {
@@ -250,16 +194,75 @@ int SimpleIPCProducer::SetResolution(Resolution preset) {
 }
 
 int SimpleIPCProducer::SetFrameRate(int fps) {
+    fps = std::max(1, std::min(fps, 30));
     if (running_.load()) {
-        LOG_WARN("Cannot change framerate while running");
-        return -1;
+        // 运行中只调整主码流 VENC 输出帧率（VENC 均匀丢帧），不超过配置帧率
+        fps = std::min(fps, config_.framerate);
+        RK_S32 ret = venc_set_framerate(kVencChn, static_cast<RK_U32>(fps));
+        if (ret != RK_SUCCESS) {
+            LOG_WARN("VENC chn{} set framerate {} failed: {:#x}", kVencChn, fps, ret);
+            return -1;
+        }
+        LOG_INFO("VENC output frame rate set to {}", fps);
+        return 0;
     }
-    fps = std::max(1, std::min(fps, 30));
     config_.framerate = fps;
     LOG_INFO("Frame rate set to {}", fps);
     return 0;
 }
 
+// ============================================================================
+// 编码器运行时控制
+// ============================================================================
+
+int SimpleIPCProducer::SetBitrate(StreamSelector stream, int kbps) {
+    if (!initialized_.load() || kbps <= 0) {
+        return -1;
+    }
+    int chn = kVencChn;
+    if (stream == StreamSelector::kSub) {
+        if (!impl_->sub_stream.IsEnabled()) {
+            return -1;
+        }
+        chn = kVencSubChn;
+    }
+
+    RK_S32 ret = venc_set_bitrate(chn, static_cast<RK_U32>(kbps));
+    if (ret != RK_SUCCESS) {
+        LOG_WARN("VENC chn{} set bitrate {}kbps failed: {:#x}", chn, kbps, ret);
+        return -1;
+    }
+    LOG_DEBUG("VENC chn{} bitrate -> {}kbps", chn, kbps);
+    return 0;
+}
+
+int SimpleIPCProducer::RequestKeyFrame(StreamSelector stream, const char* reason) {
+    if (!initialized_.load()) {
+        return -1;
+    }
+    auto& keyframes = (stream == StreamSelector::kSub && impl_->sub_stream.IsEnabled())
+                          ? impl_->sub_stream.Dispatcher().Keyframes()
+                          : impl_->dispatcher.Keyframes();
+    return keyframes.Request(reason) ? 0 : -1;
+}
+
+std::vector<EncodedStreamPtr> SimpleIPCProducer::GetGopSnapshot(StreamSelector stream) {
+    if (!initialized_.load()) {
+        return {};
+    }
+    auto& gop = (stream == StreamSelector::kSub && impl_->sub_stream.IsEnabled())
+                    ? impl_->sub_stream.Dispatcher().Gop()
+                    : impl_->dispatcher.Gop();
+    return gop.Snapshot();
+}
+
+int SimpleIPCProducer::CaptureSnapshot(const SnapshotRequest& request, Snapshot* out) {
+    if (!initialized_.load()) {
+        return -1;
+    }
+    return impl_->snapshot.Capture(request, out);
+}
+
 // ============================================================================
 // MPI 初始化
 // ============================================================================
@@ -268,27 +271,13 @@ int SimpleIPCProducer::InitMpi() {
     auto res = config_.GetResolutionConfig();
     RK_S32 ret;
 
-    // 1. ISP 初始化
-    const char* iq_dir = "/etc/iqfiles";
-    SAMPLE_COMM_ISP_Init(kViDev, RK_AIQ_WORKING_MODE_NORMAL, RK_FALSE, iq_dir);
-    SAMPLE_COMM_ISP_Run(kViDev);
-    impl_->isp_initialized = true;
-    LOG_DEBUG("ISP initialized");
-
-    // 2. MPI 系统初始化
-    ret = RK_MPI_SYS_Init();
-    if (ret != RK_SUCCESS) {
-        LOG_ERROR("RK_MPI_SYS_Init failed: {:#x}", ret);
+    // 1-3. 共享采集核心（ISP + MPI 系统 + VI，模式切换时保持运行）
+    if (CaptureCore::Instance().Acquire(res.width, res.height) != 0) {
+        LOG_ERROR("Failed to acquire capture core");
         return -1;
     }
-    impl_->mpi_initialized = true;
-    LOG_DEBUG("MPI system initialized");
-
-    // 3. VI 初始化
-    vi_dev_init();
-    vi_chn_init(kViChn, res.width, res.height);
-    impl_->vi_enabled = true;
-    LOG_DEBUG("VI initialized: {}x{}", res.width, res.height);
+    impl_->capture_acquired = true;
+    LOG_DEBUG("Capture core acquired: {}x{}", res.width, res.height);
 
     // 4. VPSS 初始化（单通道，给 VENC）
     ret = vpss_init(kVpssGrp, res.width, res.height, res.width, res.height, 0, 0);
@@ -300,20 +289,28 @@ int SimpleIPCProducer::InitMpi() {
     LOG_DEBUG("VPSS initialized");
 
     // 5. VENC 初始化
-    ret = venc_init(kVencChn, res.width, res.height, RK_VIDEO_ID_AVC);
+    ret = venc_init(kVencChn, res.width, res.height, to_rk_codec_id(config_.codec));
     if (ret != 0) {
         LOG_ERROR("VENC init failed");
         return -1;
     }
     impl_->venc_enabled = true;
-    LOG_DEBUG("VENC initialized");
+    impl_->dispatcher.SetCodec(config_.codec);
+    impl_->dispatcher.Keyframes().SetChannel(kVencChn);
+    impl_->dispatcher.Gop().Configure(config_.gop_cache_kb > 0 ? config_.gop_cache_kb * 1024 : 0);
+    LOG_DEBUG("VENC initialized ({})", VideoCodecToString(config_.codec));
 
     return 0;
 }
 
 int SimpleIPCProducer::DeinitMpi() {
+    // 子码流与抓拍（需在 VPSS Group 销毁前拆除）
+    impl_->sub_stream.Deinit();
+    impl_->snapshot.Deinit();
+
     // VENC
     if (impl_->venc_enabled) {
+        impl_->dispatcher.Keyframes().SetChannel(-1);
         RK_MPI_VENC_StopRecvFrame(kVencChn);
         
         // 排空 VENC
@@ -343,26 +340,10 @@ int SimpleIPCProducer::DeinitMpi() {
         LOG_DEBUG("VPSS deinitialized");
     }
 
-    // VI
-    if (impl_->vi_enabled) {
-        RK_MPI_VI_DisableChn(kViDev, kViChn);
-        RK_MPI_VI_DisableDev(kViDev);
-        impl_->vi_enabled = false;
-        LOG_DEBUG("VI deinitialized");
-    }
-
-    // MPI 系统
-    if (impl_->mpi_initialized) {
-        RK_MPI_SYS_Exit();
-        impl_->mpi_initialized = false;
-        LOG_DEBUG("MPI system deinitialized");
-    }
-
-    // ISP
-    if (impl_->isp_initialized) {
-        SAMPLE_COMM_ISP_Stop(kViDev);
-        impl_->isp_initialized = false;
-        LOG_DEBUG("ISP stopped");
+    // 共享采集核心（最后一个引用释放时才停止 ISP/VI）
+    if (impl_->capture_acquired) {
+        CaptureCore::Instance().Release();
+        impl_->capture_acquired = false;
     }
 
     return 0;
@@ -403,6 +384,27 @@ int SimpleIPCProducer::SetupBindings() {
     }
     LOG_DEBUG("VPSS -> VENC bound");
 
+    // VPSS Chn1 -> VENC Chn1（子码流，失败时仅保留主码流）
+    if (config_.sub_stream &&
+        impl_->sub_stream.Init(make_sub_stream_config(config_, kVpssGrp, kVpssChnSub,
+                                                      kVencSubChn)) != 0) {
+        LOG_WARN("Sub stream unavailable, continuing with main stream only");
+    }
+
+    // JPEG 抓拍：VPSS Chn2 -> VENC Chn2（请求时才使能）
+    if (config_.snapshot) {
+        auto res = config_.GetResolutionConfig();
+        SnapshotConfig snap;
+        snap.vpss_grp = kVpssGrp;
+        snap.vpss_chn = kVpssChnSnap;
+        snap.venc_chn = kVencSnapChn;
+        snap.max_width = res.width;
+        snap.max_height = res.height;
+        snap.quality = config_.snapshot_quality;
+        snap.cache_ms = config_.snapshot_cache_ms;
+        impl_->snapshot.Init(snap);
+    }
+
     return 0;
 }
 
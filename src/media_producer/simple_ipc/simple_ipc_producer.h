@@ -58,9 +58,15 @@ public:
         const std::string& name,
         StreamCallback callback,
         StreamConsumerType type = StreamConsumerType::AsyncIO,
-        int queue_size = 3) override;
+        int queue_size = 3,
+        QueueDropPolicy drop_policy = QueueDropPolicy::DropToKeyframe,
+        StreamSelector stream = StreamSelector::kMain,
+        const std::string& strand = {}) override;
 
+    bool RemoveStreamConsumer(const std::string& name) override;
     void ClearStreamConsumers() override;
+    std::vector<StreamConsumerStats> GetStreamConsumerStats() const override;
+    ProducerStats GetProducerStats() const override;
 
     bool IsInitialized() const override { return initialized_.load(); }
     bool IsRunning() const override { return running_.load(); }
@@ -69,6 +75,10 @@ public:
 
     int SetResolution(Resolution preset) override;
     int SetFrameRate(int fps) override;
+    int SetBitrate(StreamSelector stream, int kbps) override;
+    int RequestKeyFrame(StreamSelector stream, const char* reason = nullptr) override;
+    std::vector<EncodedStreamPtr> GetGopSnapshot(StreamSelector stream) override;
+    int CaptureSnapshot(const SnapshotRequest& request, Snapshot* out) override;
 
 private:
     // 禁止拷贝
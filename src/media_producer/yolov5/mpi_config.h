@@ -6,6 +6,10 @@
  * - VI -> VPSS (绑定)
  * - VPSS -> 手动获取 -> NPU -> 手动发送 -> VENC
  *
+ * 双通道布局：
+ * - VPSS Chn0（全分辨率 NV12）-> VENC（硬件绑定）
+ * - VPSS Chn1（模型尺寸，NV12/RGB888）-> 手动获取 -> NPU
+ *
  * @author 好软，好温暖
  * @date 2026-02-12
  */
@@ -17,6 +21,10 @@
 #include "rk_mpi_venc.h"
 #include "rk_mpi_vi.h"
 
+#include "../common/capture_core.h"
+#include "../common/venc_codec.h"
+
+#include <algorithm>
 #include <cstring>
 
 namespace media {
@@ -25,11 +33,17 @@ namespace media {
 // MPI 通道/Group 常量
 // ============================================================================
 
-constexpr int kViDev = 0;       ///< VI 设备 ID
-constexpr int kViChn = 0;       ///< VI 通道 ID
+constexpr int kViDev = kCaptureViDev;   ///< VI 设备 ID（由共享采集核心管理）
+constexpr int kViChn = kCaptureViChn;   ///< VI 通道 ID（由共享采集核心管理）
 constexpr int kVpssGrp = 0;     ///< VPSS Group ID
-constexpr int kVpssChn0 = 0;    ///< VPSS 通道 0（手动获取，给 AI 推理）
+constexpr int kVpssChn0 = 0;    ///< VPSS 通道 0（手动获取，给 AI 推理；双通道布局下绑定 VENC）
+constexpr int kVpssChn1 = 1;    ///< VPSS 通道 1（双通道布局：模型尺寸，给 NPU）
 constexpr int kVencChn = 0;     ///< VENC 通道 ID
+constexpr int kVpssChnSub = 2;  ///< VPSS 通道 2（子码流缩放输出）
+constexpr int kVencSubChn = 1;  ///< VENC 子码流通道 ID
+constexpr int kVpssChnMotion = 3;  ///< VPSS 通道 3（运动门控：小尺寸亮度图，手动获取）
+constexpr int kVpssChnSnap = 3;    ///< VPSS 通道 3（JPEG 抓拍，请求时临时使能；与运动门控互斥）
+constexpr int kVencSnapChn = 2;    ///< VENC JPEG 抓拍通道 ID
 
 // ============================================================================
 // YOLOv5 模式默认参数
@@ -44,84 +58,43 @@ constexpr const char* kDefaultModelPath = "../model/yolov5.rknn";
 constexpr const char* kDefaultLabelsPath = "../model/coco_80_labels_list.txt";
 
 // ============================================================================
-// VI 初始化函数
+// VPSS 初始化函数 - 串行模式
 // ============================================================================
 
 /**
- * @brief 初始化 VI 设备
+ * @brief 计算双通道布局下 Chn1 的输出尺寸
  * 
- * RV1106 SDK 简化版：仅 memset 后调用 API
- */
-inline int vi_dev_init() {
-    int ret = 0;
-    int devId = kViDev;
-    int pipeId = devId;
-
-    VI_DEV_ATTR_S stDevAttr;
-    VI_DEV_BIND_PIPE_S stBindPipe;
-    memset(&stDevAttr, 0, sizeof(stDevAttr));
-    memset(&stBindPipe, 0, sizeof(stBindPipe));
-
-    // 检查设备配置状态
-    ret = RK_MPI_VI_GetDevAttr(devId, &stDevAttr);
-    if (ret == RK_ERR_VI_NOT_CONFIG) {
-        ret = RK_MPI_VI_SetDevAttr(devId, &stDevAttr);
-        if (ret != RK_SUCCESS) {
-            return -1;
-        }
-    }
-
-    // 检查设备启用状态
-    ret = RK_MPI_VI_GetDevIsEnable(devId);
-    if (ret != RK_SUCCESS) {
-        ret = RK_MPI_VI_EnableDev(devId);
-        if (ret != RK_SUCCESS) {
-            return -1;
-        }
-        stBindPipe.u32Num = 1;
-        stBindPipe.PipeId[0] = pipeId;
-        ret = RK_MPI_VI_SetDevBindPipe(devId, &stBindPipe);
-        if (ret != RK_SUCCESS) {
-            return -1;
-        }
-    }
-
-    return 0;
-}
-
-/**
- * @brief 初始化 VI 通道
+ * 按源宽高比等比缩放到模型输入内（宽高对齐到偶数），
+ * 预处理只需补 letterbox 黑边，无需再做缩放。
  */
-inline int vi_chn_init(int channelId, int width, int height) {
-    VI_CHN_ATTR_S stChnAttr;
-    memset(&stChnAttr, 0, sizeof(stChnAttr));
-    stChnAttr.stIspOpt.stMaxSize.u32Width = width;
-    stChnAttr.stIspOpt.stMaxSize.u32Height = height;
-    stChnAttr.stIspOpt.u32BufCount = 2;
-    stChnAttr.stIspOpt.enMemoryType = VI_V4L2_MEMORY_TYPE_DMABUF;
-    stChnAttr.stSize.u32Width = width;
-    stChnAttr.stSize.u32Height = height;
-    stChnAttr.enPixelFormat = RK_FMT_YUV420SP;
-    stChnAttr.enCompressMode = COMPRESS_MODE_NONE;
-    stChnAttr.u32Depth = 0;
-
-    RK_MPI_VI_SetChnAttr(kViDev, channelId, &stChnAttr);
-    RK_MPI_VI_EnableChn(kViDev, channelId);
-    return 0;
+inline void vpss_ai_chn_size(int width, int height, int ai_width, int ai_height,
+                             int& out_width, int& out_height) {
+    float scale = std::min(static_cast<float>(ai_width) / width,
+                           static_cast<float>(ai_height) / height);
+    out_width = static_cast<int>(width * scale) & ~1;
+    out_height = static_cast<int>(height * scale) & ~1;
 }
 
-// ============================================================================
-// VPSS 初始化函数 - 串行模式
-// ============================================================================
-
 /**
  * @brief 初始化 VPSS（串行模式）
  * 
  * 串行模式特点：
  * - Chn0 的 u32Depth > 0，允许手动 GetChnFrame
  * - 不绑定到 VENC，由用户手动 SendFrame
+ * 
+ * 双通道布局（ai_width > 0）：
+ * - Chn0 u32Depth = 0，供 VPSS -> VENC 硬件绑定
+ * - Chn1 输出 ai_width x ai_height（ai_format），u32Depth > 0 供 NPU 手动获取
+ * 
+ * @param ai_width Chn1 宽度，0 表示不启用 Chn1
+ * @param ai_height Chn1 高度
+ * @param ai_format Chn1 像素格式（RK_FMT_YUV420SP 或 RK_FMT_RGB888）
  */
-inline int vpss_init_serial_mode(int grpId, int width, int height) {
+inline int vpss_init_serial_mode(int grpId, int width, int height,
+                                 int ai_width = 0, int ai_height = 0,
+                                 PIXEL_FORMAT_E ai_format = RK_FMT_YUV420SP) {
+    const bool dual_channel = ai_width > 0 && ai_height > 0;
+
     VPSS_GRP_ATTR_S stGrpAttr;
     memset(&stGrpAttr, 0, sizeof(stGrpAttr));
     stGrpAttr.u32MaxW = width;
@@ -146,16 +119,72 @@ inline int vpss_init_serial_mode(int grpId, int width, int height) {
     stChnAttr.stFrameRate.s32DstFrameRate = -1;
     stChnAttr.u32Width = width;
     stChnAttr.u32Height = height;
-    stChnAttr.u32Depth = 2;  // 允许手动获取
+    stChnAttr.u32Depth = dual_channel ? 0 : 2;  // 双通道布局下由 VENC 绑定消费
     stChnAttr.enCompressMode = COMPRESS_MODE_NONE;
 
     RK_MPI_VPSS_SetChnAttr(grpId, kVpssChn0, &stChnAttr);
     RK_MPI_VPSS_EnableChn(grpId, kVpssChn0);
 
+    // Chn1: 模型尺寸，硬件缩放后手动获取给 NPU
+    if (dual_channel) {
+        memset(&stChnAttr, 0, sizeof(stChnAttr));
+        stChnAttr.enChnMode = VPSS_CHN_MODE_USER;
+        stChnAttr.enDynamicRange = DYNAMIC_RANGE_SDR8;
+        stChnAttr.enPixelFormat = ai_format;
+        stChnAttr.stFrameRate.s32SrcFrameRate = -1;
+        stChnAttr.stFrameRate.s32DstFrameRate = -1;
+        stChnAttr.u32Width = ai_width;
+        stChnAttr.u32Height = ai_height;
+        stChnAttr.u32Depth = 1;  // 只保留最新一帧，NPU 慢于采集时自动丢旧帧
+        stChnAttr.enCompressMode = COMPRESS_MODE_NONE;
+
+        ret = RK_MPI_VPSS_SetChnAttr(grpId, kVpssChn1, &stChnAttr);
+        if (ret != RK_SUCCESS) {
+            RK_MPI_VPSS_DisableChn(grpId, kVpssChn0);
+            RK_MPI_VPSS_DestroyGrp(grpId);
+            return -1;
+        }
+        RK_MPI_VPSS_EnableChn(grpId, kVpssChn1);
+    }
+
     RK_MPI_VPSS_StartGrp(grpId);
     return 0;
 }
 
+/**
+ * @brief 使能运动检测通道（VPSS Group 启动之后调用）
+ *
+ * 优先输出 Y-only（YUV400SP），不支持时退回 NV12（只读 Y 平面）。
+ * u32Depth = 1：只保留最新一帧，推理线程按需非阻塞获取。
+ */
+inline int vpss_enable_motion_chn(int grpId, int width, int height) {
+    VPSS_CHN_ATTR_S stChnAttr;
+    memset(&stChnAttr, 0, sizeof(stChnAttr));
+    stChnAttr.enChnMode = VPSS_CHN_MODE_USER;
+    stChnAttr.enDynamicRange = DYNAMIC_RANGE_SDR8;
+    stChnAttr.enPixelFormat = RK_FMT_YUV400SP;
+    stChnAttr.stFrameRate.s32SrcFrameRate = -1;
+    stChnAttr.stFrameRate.s32DstFrameRate = -1;
+    stChnAttr.u32Width = width;
+    stChnAttr.u32Height = height;
+    stChnAttr.u32Depth = 1;
+    stChnAttr.enCompressMode = COMPRESS_MODE_NONE;
+
+    RK_S32 ret = RK_MPI_VPSS_SetChnAttr(grpId, kVpssChnMotion, &stChnAttr);
+    if (ret != RK_SUCCESS) {
+        stChnAttr.enPixelFormat = RK_FMT_YUV420SP;
+        ret = RK_MPI_VPSS_SetChnAttr(grpId, kVpssChnMotion, &stChnAttr);
+    }
+    if (ret != RK_SUCCESS) {
+        return -1;
+    }
+    return RK_MPI_VPSS_EnableChn(grpId, kVpssChnMotion) == RK_SUCCESS ? 0 : -1;
+}
+
+inline void vpss_disable_motion_chn(int grpId) {
+    RK_MPI_VPSS_DisableChn(grpId, kVpssChnMotion);
+}
+
 /**
  * @brief 销毁 VPSS Group
  */
@@ -163,7 +192,7 @@ inline int vpss_deinit(int grpId, bool enableChn1 = false) {
     RK_MPI_VPSS_StopGrp(grpId);
     RK_MPI_VPSS_DisableChn(grpId, kVpssChn0);
     if (enableChn1) {
-        RK_MPI_VPSS_DisableChn(grpId, 1);
+        RK_MPI_VPSS_DisableChn(grpId, kVpssChn1);
     }
     RK_MPI_VPSS_DestroyGrp(grpId);
     return 0;
@@ -184,9 +213,7 @@ inline int venc_init_rgb_input(int chnId, int width, int height, RK_CODEC_ID_E e
     VENC_CHN_ATTR_S stAttr;
     memset(&stAttr, 0, sizeof(stAttr));
 
-    stAttr.stVencAttr.enType = enType;
     stAttr.stVencAttr.enPixelFormat = RK_FMT_RGB888;  // RGB 输入
-    stAttr.stVencAttr.u32Profile = H264E_PROFILE_HIGH;
     stAttr.stVencAttr.u32PicWidth = width;
     stAttr.stVencAttr.u32PicHeight = height;
     stAttr.stVencAttr.u32VirWidth = width;
@@ -194,13 +221,42 @@ inline int venc_init_rgb_input(int chnId, int width, int height, RK_CODEC_ID_E e
     stAttr.stVencAttr.u32StreamBufCnt = 2;
     stAttr.stVencAttr.u32BufSize = width * height;
 
-    stAttr.stRcAttr.enRcMode = VENC_RC_MODE_H264CBR;
-    stAttr.stRcAttr.stH264Cbr.u32Gop = 30;
-    stAttr.stRcAttr.stH264Cbr.u32BitRate = 8 * 1024;  // 8 Mbps（AI模式降低码率）
-    stAttr.stRcAttr.stH264Cbr.fr32DstFrameRateDen = 1;
-    stAttr.stRcAttr.stH264Cbr.fr32DstFrameRateNum = 30;
-    stAttr.stRcAttr.stH264Cbr.u32SrcFrameRateDen = 1;
-    stAttr.stRcAttr.stH264Cbr.u32SrcFrameRateNum = 30;
+    venc_fill_cbr_attr(&stAttr, enType, 8 * 1024, 30, 30);  // 8 Mbps（AI模式降低码率）
+
+    RK_MPI_VENC_CreateChn(chnId, &stAttr);
+
+    VENC_RECV_PIC_PARAM_S stRecvParam;
+    memset(&stRecvParam, 0, sizeof(stRecvParam));
+    stRecvParam.s32RecvPicNum = -1;
+    RK_MPI_VENC_StartRecvFrame(chnId, &stRecvParam);
+
+    return 0;
+}
+
+// ============================================================================
+// VENC 初始化函数 - NV12 输入模式（双通道布局）
+// ============================================================================
+
+/**
+ * @brief 初始化 VENC（NV12 输入）
+ * 
+ * 双通道布局特点：
+ * - 由 VPSS Chn0 硬件绑定送帧，零拷贝
+ * - 检测框通过 RGN 叠加，不经过 CPU
+ */
+inline int venc_init_nv12_input(int chnId, int width, int height, RK_CODEC_ID_E enType = RK_VIDEO_ID_AVC) {
+    VENC_CHN_ATTR_S stAttr;
+    memset(&stAttr, 0, sizeof(stAttr));
+
+    stAttr.stVencAttr.enPixelFormat = RK_FMT_YUV420SP;
+    stAttr.stVencAttr.u32PicWidth = width;
+    stAttr.stVencAttr.u32PicHeight = height;
+    stAttr.stVencAttr.u32VirWidth = width;
+    stAttr.stVencAttr.u32VirHeight = height;
+    stAttr.stVencAttr.u32StreamBufCnt = 2;
+    stAttr.stVencAttr.u32BufSize = width * height * 3 / 2;
+
+    venc_fill_cbr_attr(&stAttr, enType, 8 * 1024, 30, 30);
 
     RK_MPI_VENC_CreateChn(chnId, &stAttr);
 
@@ -11,10 +11,23 @@
 #include "yolo_producer.h"
 #include "mpi_config.h"
 #include "yolov5_model.h"
+#include "retainface/retinaface_model.h"
+#include "retainface/retinaface_producer.h"
 #include "../common/image_utils.h"
+#include "../common/osd_overlay.h"
+#include "../common/smart_encoder.h"
+#include "../common/snapshot.h"
+#include "../common/capture_core.h"
+#include "../common/sub_stream.h"
+#include "../common/model_cache.h"
+#include "../common/motion_detector.h"
+#include "../common/npu_scheduler.h"
+#include "../common/object_tracker.h"
 #include "common/logger.h"
+#include "common/latency_trace.h"
 #include "common/media_buffer.h"
-#include "common/asio_context.h"
+#include "common/metrics.h"
+#include "common/stream_dispatcher.h"
 
 #include "sample_comm.h"
 #include "rk_mpi_sys.h"
@@ -23,50 +36,13 @@
 #include "rk_mpi_venc.h"
 #include "rk_mpi_mb.h"
 
+#include <algorithm>
+#include <climits>
 #include <cstring>
 #include <chrono>
 
 namespace media {
 
-// ============================================================================
-// 流分发器（与 SimpleIPCProducer 共用逻辑）
-// ============================================================================
-
-class SerialStreamDispatcher {
-public:
-    struct ConsumerInfo {
-        std::string name;
-        StreamCallback callback;
-        StreamConsumerType type;
-    };
-
-    void RegisterConsumer(const std::string& name, StreamCallback callback,
-                          StreamConsumerType type) {
-        consumers_.push_back({name, std::move(callback), type});
-        LOG_INFO("Registered stream consumer: {}", name);
-    }
-
-    void ClearConsumers() {
-        consumers_.clear();
-    }
-
-    void DispatchFrame(EncodedStreamPtr stream) {
-        for (auto& c : consumers_) {
-            if (!c.callback) continue;
-            if (c.type == StreamConsumerType::AsyncIO) {
-                PostToIo([callback = c.callback, stream]() {
-                    callback(stream);
-                });
-            } else {
-                c.callback(stream);
-            }
-        }
-    }
-
-private:
-    std::vector<ConsumerInfo> consumers_;
-};
-
 // ============================================================================
 // MB Pool RAII 封装
 // ============================================================================
@@ -122,11 +98,16 @@ private:
 // YoloProducer 内部实现
 // ============================================================================
 
+// 一次发布的检测结果（模型输入坐标 + 对应的 letterbox）
+struct YoloProducer::Overlay {
+    rknn::DetectionResultList results;
+    rknn::LetterboxInfo letterbox;
+    rknn::DetectionResultList faces;    // 组合模式：人脸结果（已是主码流坐标）
+};
+
 struct YoloProducer::Impl {
     // MPI 状态
-    bool isp_initialized = false;
-    bool mpi_initialized = false;
-    bool vi_enabled = false;
+    bool capture_acquired = false;   // 持有共享采集核心（ISP + SYS + VI）引用
     bool vpss_enabled = false;
     bool venc_enabled = false;
 
@@ -134,26 +115,136 @@ struct YoloProducer::Impl {
     MPP_CHN_S vi_chn;
     MPP_CHN_S vpss_grp;
 
+    // 双通道布局：VPSS Chn0 -> VENC 硬件绑定，Chn1（模型尺寸）-> NPU
+    bool dual_channel = false;
+    bool vpss_venc_bound = false;
+    MPP_CHN_S vpss_out;
+    MPP_CHN_S venc_chn;
+    int ai_chn_width = 0;
+    int ai_chn_height = 0;
+
+    // NV12 编码：VENC 直接吃 VPSS 帧（RGN 叠框 / 客户端渲染；双通道布局下 VENC 由 VPSS 绑定送帧）
+    // RGN 叠框：检测框由硬件叠加；客户端渲染时画面不叠框，检测结果经元数据通道下发
+    bool nv12_venc = false;
+    bool rgn_overlay = false;
+    OSDOverlay osd;
+    std::vector<OSDBox> osd_boxes;
+
+    // 检测驱动编码：检测框 -> 主码流 VENC ROI，静止场景降码率 / 帧率
+    SmartEncoder smart_encoder;
+
     // RGB 缓冲池
     MbPool rgb_pool;
 
     // AI 引擎
-    std::unique_ptr<rknn::YoloV5Model> ai_model;
+    std::shared_ptr<rknn::YoloV5Model> ai_model;   // 由 ModelCache 共享持有，切换模式时常驻
     std::unique_ptr<rknn::ImageProcessor> image_processor;
     
     // 中间缓冲区
     std::vector<uint8_t> temp_rgb_buffer;
     
-    // 流分发器
-    SerialStreamDispatcher dispatcher;
+    // 流分发器（由 FrameLoop 驱动）
+    StreamDispatcher dispatcher;
+
+    // 子码流（VPSS Chn2 -> VENC Chn1，自带分发器，不叠加检测框）
+    SubStream sub_stream;
+
+    // JPEG 抓拍（VPSS Chn3 或 Chn1 -> VENC Chn2，按需，不叠加检测框）
+    SnapshotEncoder snapshot;
+
+    // 异步推理：FrameLoop 覆盖式发布最新帧，InferenceLoop 消费
+    LatestVideoFrame inference_frame;
+
+    // 隔帧推理：每 inference_interval 帧推理一次，其余帧由跟踪器外推检测框
+    bool tracking = false;
+    ObjectTracker tracker;
+    rknn::LetterboxInfo tracker_letterbox;   // 最近一次推理的 letterbox（预测框沿用）
+    int frames_since_inference = 0;
+    int frames_since_throttle = 0;          // 推理降速计数（负载调度）
+    uint32_t results_seq = 0;               // 发布序号（推理帧与预测帧统一递增）
+
+    // 运动门控：VPSS 小尺寸亮度图做背景差分，画面静止时不推理
+    bool motion_gate = false;
+    bool motion_open = true;
+    MotionDetector motion;
+    std::chrono::steady_clock::time_point last_motion;
+
+    // 组合模式：RetinaFace 与 YOLOv5 经调度器分时共用 NPU（以下仅推理线程访问）
+    std::shared_ptr<rknn::RetinaFaceModel> face_model;   // 由 ModelCache 共享持有
+    std::unique_ptr<rknn::ImageProcessor> face_processor;
+    NpuScheduler scheduler;
+    int yolo_task = -1;
+    int face_task = -1;
+    std::vector<rknn::BoundingBox> person_boxes;   // 最近一次发布的人形框（主码流坐标）
+    rknn::DetectionResultList faces;                // 最近一次人脸结果（主码流坐标）
+    std::chrono::steady_clock::time_point faces_time;
+    std::chrono::milliseconds face_hold{0};         // 人脸任务停跑后结果的保留时长
+    std::vector<OSDBox> face_osd_boxes;
+
+    /// 本帧各调度任务是否就绪：人脸只在人形框内检测时，画面中没有人则不占用 NPU
+    uint32_t ReadyMask(bool face_in_person) const {
+        uint32_t mask = ~0u;
+        if (face_in_person && person_boxes.empty()) {
+            mask &= ~(1u << face_task);
+        }
+        return mask;
+    }
+
+    /// 按最新 YOLOv5 结果更新人形框，人已离开或人脸结果过期时清空人脸
+    void UpdateFaces(const rknn::DetectionResultList& mapped, bool face_in_person) {
+        person_boxes.clear();
+        for (const auto& det : mapped.results) {
+            if (det.class_id == 0) {   // COCO person
+                person_boxes.push_back(det.box);
+            }
+        }
+        if ((face_in_person && person_boxes.empty()) ||
+            std::chrono::steady_clock::now() - faces_time > face_hold) {
+            faces.Clear();
+        }
+    }
+
+    /// 推理降速：每 divisor 次推理机会放行一次（推理线程调用）
+    bool ThrottleDue(int divisor) {
+        if (divisor <= 1 || ++frames_since_throttle >= divisor) {
+            frames_since_throttle = 0;
+            return true;
+        }
+        return false;
+    }
+
+    /// 本帧是否需要推理（推理线程调用）
+    bool InferenceDue(int interval, bool adaptive) {
+        if (!tracking || ++frames_since_inference >= interval ||
+            (adaptive && tracker.Unstable())) {
+            frames_since_inference = 0;
+            return true;
+        }
+        return false;
+    }
+
+    // 最新检测结果（推理线程整体替换，编码线程只读快照）
+    std::mutex overlay_mutex;
+    std::shared_ptr<const Overlay> overlay;
+
+    void PublishOverlay(std::shared_ptr<const Overlay> next) {
+        std::lock_guard<std::mutex> lock(overlay_mutex);
+        overlay = std::move(next);
+    }
+
+    std::shared_ptr<const Overlay> CurrentOverlay() {
+        std::lock_guard<std::mutex> lock(overlay_mutex);
+        return overlay;
+    }
 };
 
 // ============================================================================
 // YoloProducer 实现
 // ============================================================================
 
-YoloProducer::YoloProducer(const ProducerConfig& config)
+YoloProducer::YoloProducer(const ProducerConfig& config, bool face_stage)
     : config_(config)
+    , face_stage_(face_stage)
     , impl_(std::make_unique<Impl>()) {
     LOG_DEBUG("YoloProducer created");
 }
@@ -176,10 +267,11 @@ int YoloProducer::Init() {
 
     if (InitMpi() != 0) {
         LOG_ERROR("Failed to initialize MPI");
+        DeinitMpi();  // 归还已获取的采集核心引用
         return -1;
     }
 
-    if (!InitRgbPool()) {
+    if (!impl_->nv12_venc && !InitRgbPool()) {
         LOG_ERROR("Failed to initialize RGB pool");
         DeinitMpi();
         return -1;
@@ -191,9 +283,21 @@ int YoloProducer::Init() {
         return -1;
     }
 
+    if (impl_->rgn_overlay && !impl_->osd.Init(kVencChn)) {
+        LOG_ERROR("Failed to initialize OSD");
+        DeinitAiEngine();
+        DeinitMpi();
+        return -1;
+    }
+
     initialized_.store(true);
     LOG_INFO("Yolo producer initialized successfully");
-    LOG_INFO("Pipeline: VI -> VPSS --(manual)--> NPU --(manual)--> VENC");
+    if (impl_->dual_channel) {
+        LOG_INFO("Pipeline: VI -> VPSS chn0 --(bind)--> VENC, chn1 {}x{} --(manual)--> NPU --> RGN",
+                 impl_->ai_chn_width, impl_->ai_chn_height);
+    } else {
+        LOG_INFO("Pipeline: VI -> VPSS --(manual)--> NPU --(manual)--> VENC");
+    }
     return 0;
 }
 
@@ -205,6 +309,7 @@ int YoloProducer::Deinit() {
     Stop();
     DeinitAiEngine();
     impl_->rgb_pool.Destroy();
+    impl_->osd.Deinit();
     DeinitMpi();
 
     initialized_.store(false);
@@ -223,9 +328,35 @@ bool YoloProducer::Start() {
         return true;
     }
 
+    frame_count_.store(0);
+    inference_count_.store(0);
+    inference_time_us_.store(0);
+    detection_count_.store(0);
+    predicted_count_.store(0);
+    video_rate_.Reset();
+    inference_rate_.Reset();
+    impl_->tracker.Reset();
+    impl_->frames_since_inference = 0;
+    impl_->frames_since_throttle = 0;
+    motion_frames_.store(0);
+    motion_gated_.store(0);
+    impl_->motion.Reset();
+    impl_->motion_open = true;
+    motion_active_.store(true);
+    impl_->last_motion = std::chrono::steady_clock::now();
+    impl_->scheduler.Reset();
+    impl_->person_boxes.clear();
+    impl_->faces.Clear();
+
     running_.store(true);
+    if (impl_->dual_channel || config_.async_inference) {
+        inference_thread_ = std::thread(&YoloProducer::InferenceLoop, this);
+    }
     frame_thread_ = std::thread(&YoloProducer::FrameLoop, this);
-    LOG_INFO("Yolo producer started");
+    impl_->sub_stream.Start();
+    LOG_INFO("Yolo producer started ({} inference)",
+             impl_->dual_channel ? "dual-channel"
+                                 : (config_.async_inference ? "async" : "serial"));
     return true;
 }
 
@@ -238,6 +369,17 @@ void YoloProducer::Stop() {
     if (frame_thread_.joinable()) {
         frame_thread_.join();
     }
+    // 空帧唤醒推理线程，同时释放 holder 持有的最后一个 VPSS 帧
+    impl_->inference_frame.update(nullptr);
+    if (inference_thread_.joinable()) {
+        inference_thread_.join();
+    }
+    impl_->PublishOverlay(nullptr);
+    impl_->osd.Clear();
+    impl_->smart_encoder.Reset();
+    // 归还 Queued 消费者积压的 VENC buffer
+    impl_->dispatcher.FlushQueues();
+    impl_->sub_stream.Stop();
     LOG_INFO("Yolo producer stopped");
 }
 
@@ -245,13 +387,77 @@ void YoloProducer::RegisterStreamConsumer(
     const std::string& name,
     StreamCallback callback,
     StreamConsumerType type,
-    int queue_size) {
-    (void)queue_size;
-    impl_->dispatcher.RegisterConsumer(name, std::move(callback), type);
+    int queue_size,
+    QueueDropPolicy drop_policy,
+    StreamSelector stream,
+    const std::string& strand) {
+    if (stream == StreamSelector::kSub) {
+        if (impl_->sub_stream.IsEnabled()) {
+            impl_->sub_stream.Dispatcher().RegisterConsumer(
+                name, std::move(callback), type, queue_size, drop_policy, strand);
+            return;
+        }
+        LOG_WARN("Sub stream not enabled, consumer '{}' falls back to main stream", name);
+    }
+    impl_->dispatcher.RegisterConsumer(name, std::move(callback), type, queue_size, drop_policy,
+                                       strand);
+}
+
+bool YoloProducer::RemoveStreamConsumer(const std::string& name) {
+    return impl_->dispatcher.RemoveConsumer(name) ||
+           impl_->sub_stream.Dispatcher().RemoveConsumer(name);
 }
 
 void YoloProducer::ClearStreamConsumers() {
     impl_->dispatcher.ClearConsumers();
+    impl_->sub_stream.Dispatcher().ClearConsumers();
+}
+
+std::vector<StreamConsumerStats> YoloProducer::GetStreamConsumerStats() const {
+    auto stats = impl_->dispatcher.GetConsumerStats();
+    impl_->sub_stream.AppendConsumerStats(stats);
+    return stats;
+}
+
+ProducerStats YoloProducer::GetProducerStats() const {
+    ProducerStats stats;
+    stats.video_frames = video_rate_.Total();
+    stats.inference_frames = inference_count_.load();
+    stats.total_detections = detection_count_.load();
+    stats.video_fps = video_rate_.Fps();
+    stats.inference_fps = inference_rate_.Fps();
+    if (stats.inference_frames > 0) {
+        stats.avg_inference_ms =
+            inference_time_us_.load() / 1000.0 / static_cast<double>(stats.inference_frames);
+    }
+    stats.async_inference = impl_->dual_channel || config_.async_inference;
+    stats.inference_interval = impl_->tracking ? config_.inference_interval : 1;
+    stats.predicted_frames = predicted_count_.load();
+    stats.inference_divisor = inference_divisor_.load();
+    if (face_stage_) {
+        stats.npu_tasks = impl_->scheduler.GetStats();
+    }
+    stats.motion_gate = impl_->motion_gate;
+    stats.motion_active = impl_->motion_gate && motion_active_.load();
+    stats.motion_frames = motion_frames_.load();
+    stats.motion_gated_frames = motion_gated_.load();
+    fill_keyframe_stats(impl_->dispatcher, impl_->sub_stream, &stats);
+    fill_gop_cache_stats(impl_->dispatcher, impl_->sub_stream, &stats);
+    stats.snapshot = impl_->snapshot.GetStats();
+
+    stats.smart_encode = impl_->smart_encoder.GetStats();
+    stats.osd_enabled = impl_->rgn_overlay;
+    if (impl_->rgn_overlay) {
+        OSDStats osd = impl_->osd.GetStats();
+        stats.osd_updates = osd.updates;
+        stats.osd_mpi_calls = osd.total_mpi_calls;
+        stats.osd_last_mpi_calls = osd.last.Total();
+        stats.osd_last_moves = osd.last.move;
+        stats.osd_last_bitmaps = osd.last.set_bitmap;
+        stats.osd_handles_created = osd.handles_created;
+        stats.osd_handles_visible = osd.handles_visible;
+    }
+    return stats;
 }
 
 int YoloProducer::SetResolution(Resolution preset) {
@@ -264,15 +470,77 @@ int YoloProducer::SetResolution(Resolution preset) {
 }
 
 int YoloProducer::SetFrameRate(int fps) {
+    fps = std::max(1, std::min(fps, 30));
     if (running_.load()) {
-        LOG_WARN("Cannot change framerate while running");
-        return -1;
+        // 运行中只调整主码流 VENC 输出帧率（经检测驱动编码，静止状态仍取较小值）
+        return impl_->smart_encoder.SetFrameRate(std::min(fps, config_.framerate));
     }
-    fps = std::max(1, std::min(fps, 30));
     config_.framerate = fps;
     return 0;
 }
 
+int YoloProducer::SetInferenceDivisor(int divisor) {
+    divisor = std::max(1, divisor);
+    if (inference_divisor_.exchange(divisor) != divisor) {
+        LOG_INFO("Inference divisor set to {}", divisor);
+    }
+    return 0;
+}
+
+// ============================================================================
+// 编码器运行时控制
+// ============================================================================
+
+int YoloProducer::SetBitrate(StreamSelector stream, int kbps) {
+    if (!initialized_.load() || kbps <= 0) {
+        return -1;
+    }
+    int chn = kVencChn;
+    if (stream == StreamSelector::kSub) {
+        if (!impl_->sub_stream.IsEnabled()) {
+            return -1;
+        }
+        chn = kVencSubChn;
+    }
+
+    // 主码流经检测驱动编码下发：静止状态下按比例折算，恢复时回到该码率
+    RK_S32 ret = (chn == kVencChn) ? impl_->smart_encoder.SetBitrate(kbps)
+                                   : venc_set_bitrate(chn, static_cast<RK_U32>(kbps));
+    if (ret != RK_SUCCESS) {
+        LOG_WARN("VENC chn{} set bitrate {}kbps failed: {:#x}", chn, kbps, ret);
+        return -1;
+    }
+    LOG_DEBUG("VENC chn{} bitrate -> {}kbps", chn, kbps);
+    return 0;
+}
+
+int YoloProducer::RequestKeyFrame(StreamSelector stream, const char* reason) {
+    if (!initialized_.load()) {
+        return -1;
+    }
+    auto& keyframes = (stream == StreamSelector::kSub && impl_->sub_stream.IsEnabled())
+                          ? impl_->sub_stream.Dispatcher().Keyframes()
+                          : impl_->dispatcher.Keyframes();
+    return keyframes.Request(reason) ? 0 : -1;
+}
+
+std::vector<EncodedStreamPtr> YoloProducer::GetGopSnapshot(StreamSelector stream) {
+    if (!initialized_.load()) {
+        return {};
+    }
+    auto& gop = (stream == StreamSelector::kSub && impl_->sub_stream.IsEnabled())
+                    ? impl_->sub_stream.Dispatcher().Gop()
+                    : impl_->dispatcher.Gop();
+    return gop.Snapshot();
+}
+
+int YoloProducer::CaptureSnapshot(const SnapshotRequest& request, Snapshot* out) {
+    if (!initialized_.load()) {
+        return -1;
+    }
+    return impl_->snapshot.Capture(request, out);
+}
+
 // ============================================================================
 // MPI 初始化
 // ============================================================================
@@ -281,45 +549,72 @@ int YoloProducer::InitMpi() {
     auto res = config_.GetResolutionConfig();
     RK_S32 ret;
 
-    // 1. ISP 初始化
-    const char* iq_dir = "/etc/iqfiles";
-    SAMPLE_COMM_ISP_Init(kViDev, RK_AIQ_WORKING_MODE_NORMAL, RK_FALSE, iq_dir);
-    SAMPLE_COMM_ISP_Run(kViDev);
-    impl_->isp_initialized = true;
-    LOG_DEBUG("ISP initialized");
-
-    // 2. MPI 系统初始化
-    ret = RK_MPI_SYS_Init();
-    if (ret != RK_SUCCESS) {
-        LOG_ERROR("RK_MPI_SYS_Init failed: {:#x}", ret);
+    // 1-3. 共享采集核心（ISP + MPI 系统 + VI，模式切换时保持运行）
+    if (CaptureCore::Instance().Acquire(res.width, res.height) != 0) {
+        LOG_ERROR("Failed to acquire capture core");
         return -1;
     }
-    impl_->mpi_initialized = true;
-    LOG_DEBUG("MPI system initialized");
-
-    // 3. VI 初始化
-    vi_dev_init();
-    vi_chn_init(kViChn, res.width, res.height);
-    impl_->vi_enabled = true;
-    LOG_DEBUG("VI initialized: {}x{}", res.width, res.height);
-
-    // 4. VPSS 初始化（串行模式：允许手动获取帧）
-    ret = vpss_init_serial_mode(kVpssGrp, res.width, res.height);
+    impl_->capture_acquired = true;
+    LOG_DEBUG("Capture core acquired: {}x{}", res.width, res.height);
+
+    // 4. VPSS 初始化（串行模式；双通道布局下额外启用模型尺寸的 Chn1）
+    impl_->dual_channel = (config_.ai_input_layout == AiInputLayout::kDualChannel);
+    impl_->nv12_venc = impl_->dual_channel || config_.ai_overlay != OverlayBackend::kCpu;
+    impl_->rgn_overlay = impl_->nv12_venc && config_.ai_overlay != OverlayBackend::kClient;
+    if (impl_->dual_channel && config_.ai_overlay == OverlayBackend::kCpu) {
+        LOG_WARN("CPU overlay is not available with dual-channel layout, using RGN");
+    }
+    if (impl_->dual_channel) {
+        vpss_ai_chn_size(res.width, res.height, config_.ai_width, config_.ai_height,
+                         impl_->ai_chn_width, impl_->ai_chn_height);
+        PIXEL_FORMAT_E ai_format = (config_.ai_input_format == AiInputFormat::kRGB888)
+                                       ? RK_FMT_RGB888 : RK_FMT_YUV420SP;
+        ret = vpss_init_serial_mode(kVpssGrp, res.width, res.height,
+                                    impl_->ai_chn_width, impl_->ai_chn_height, ai_format);
+    } else {
+        ret = vpss_init_serial_mode(kVpssGrp, res.width, res.height);
+    }
     if (ret != 0) {
         LOG_ERROR("VPSS init failed");
         return -1;
     }
     impl_->vpss_enabled = true;
-    LOG_DEBUG("VPSS initialized (serial mode)");
+    LOG_DEBUG("VPSS initialized ({})", impl_->dual_channel ? "dual channel" : "serial mode");
+
+    // 运动门控通道（失败时不门控，每帧推理）
+    impl_->motion_gate = false;
+    if (config_.motion_gate.enabled) {
+        const auto& gate = config_.motion_gate;
+        if (!impl_->motion.Init(gate)) {
+            LOG_WARN("Invalid motion gate config, motion gating disabled");
+        } else if (vpss_enable_motion_chn(kVpssGrp, gate.width, gate.height) != 0) {
+            LOG_WARN("VPSS motion chn{} ({}x{}) unavailable, motion gating disabled",
+                     kVpssChnMotion, gate.width, gate.height);
+        } else {
+            impl_->motion_gate = true;
+            LOG_INFO("Motion gate enabled: VPSS chn{} {}x{}, hold {}ms", kVpssChnMotion,
+                     gate.width, gate.height, gate.hold_ms);
+        }
+    }
 
-    // 5. VENC 初始化（RGB 输入，用于接收 OSD 叠加后的帧）
-    ret = venc_init_rgb_input(kVencChn, res.width, res.height, RK_VIDEO_ID_AVC);
+    // 5. VENC 初始化（RGN 叠框 / 客户端渲染：NV12 输入；CPU 叠框：RGB 输入接收叠框后的帧）
+    const RK_CODEC_ID_E codec_id = to_rk_codec_id(config_.codec);
+    if (impl_->nv12_venc) {
+        ret = venc_init_nv12_input(kVencChn, res.width, res.height, codec_id);
+    } else {
+        ret = venc_init_rgb_input(kVencChn, res.width, res.height, codec_id);
+    }
     if (ret != 0) {
         LOG_ERROR("VENC init failed");
         return -1;
     }
     impl_->venc_enabled = true;
-    LOG_DEBUG("VENC initialized (RGB input mode)");
+    impl_->smart_encoder.Configure(config_.smart_encode, kVencChn, res.width, res.height);
+    impl_->dispatcher.SetCodec(config_.codec);
+    impl_->dispatcher.Keyframes().SetChannel(kVencChn);
+    impl_->dispatcher.Gop().Configure(config_.gop_cache_kb > 0 ? config_.gop_cache_kb * 1024 : 0);
+    LOG_DEBUG("VENC initialized ({}, {} input mode)",
+              VideoCodecToString(config_.codec), impl_->nv12_venc ? "NV12" : "RGB");
 
     // 6. 绑定 VI -> VPSS（不绑定 VPSS -> VENC）
     impl_->vi_chn.enModId = RK_ID_VI;
@@ -337,15 +632,74 @@ int YoloProducer::InitMpi() {
     }
     LOG_DEBUG("VI -> VPSS bound (VPSS -> VENC NOT bound)");
 
+    // 7. 双通道布局：绑定 VPSS Chn0 -> VENC
+    if (impl_->dual_channel) {
+        impl_->vpss_out.enModId = RK_ID_VPSS;
+        impl_->vpss_out.s32DevId = kVpssGrp;
+        impl_->vpss_out.s32ChnId = kVpssChn0;
+
+        impl_->venc_chn.enModId = RK_ID_VENC;
+        impl_->venc_chn.s32DevId = 0;
+        impl_->venc_chn.s32ChnId = kVencChn;
+
+        ret = RK_MPI_SYS_Bind(&impl_->vpss_out, &impl_->venc_chn);
+        if (ret != RK_SUCCESS) {
+            LOG_ERROR("Failed to bind VPSS -> VENC: {:#x}", ret);
+            return -1;
+        }
+        impl_->vpss_venc_bound = true;
+        LOG_DEBUG("VPSS chn0 -> VENC bound, chn1 {}x{} for NPU",
+                  impl_->ai_chn_width, impl_->ai_chn_height);
+    }
+
+    // 8. 子码流：VPSS Chn2 -> VENC Chn1（失败时仅保留主码流）
+    if (config_.sub_stream &&
+        impl_->sub_stream.Init(make_sub_stream_config(config_, kVpssGrp, kVpssChnSub,
+                                                      kVencSubChn)) != 0) {
+        LOG_WARN("Sub stream unavailable, continuing with main stream only");
+    }
+
+    // 9. JPEG 抓拍：VPSS Chn3 -> VENC Chn2（请求时才使能）；
+    //    运动门控占用 Chn3 时，单通道布局改用空闲的 Chn1，双通道布局无空闲通道
+    if (config_.snapshot) {
+        int snap_chn = kVpssChnSnap;
+        if (impl_->motion_gate) {
+            snap_chn = impl_->dual_channel ? -1 : kVpssChn1;
+        }
+        if (snap_chn < 0) {
+            LOG_WARN("No free VPSS channel for snapshot (motion gate on chn{}), snapshot disabled",
+                     kVpssChnMotion);
+        } else {
+            SnapshotConfig snap;
+            snap.vpss_grp = kVpssGrp;
+            snap.vpss_chn = snap_chn;
+            snap.venc_chn = kVencSnapChn;
+            snap.max_width = res.width;
+            snap.max_height = res.height;
+            snap.quality = config_.snapshot_quality;
+            snap.cache_ms = config_.snapshot_cache_ms;
+            impl_->snapshot.Init(snap);
+        }
+    }
+
     return 0;
 }
 
 int YoloProducer::DeinitMpi() {
+    // 子码流与抓拍（需在 VPSS Group 销毁前拆除）
+    impl_->sub_stream.Deinit();
+    impl_->snapshot.Deinit();
+
     // 解除绑定
+    if (impl_->vpss_venc_bound) {
+        RK_MPI_SYS_UnBind(&impl_->vpss_out, &impl_->venc_chn);
+        impl_->vpss_venc_bound = false;
+    }
     RK_MPI_SYS_UnBind(&impl_->vi_chn, &impl_->vpss_grp);
 
     // VENC
     if (impl_->venc_enabled) {
+        impl_->dispatcher.Keyframes().SetChannel(-1);
         RK_MPI_VENC_StopRecvFrame(kVencChn);
 
         VENC_STREAM_S stFrame;
@@ -368,54 +722,104 @@ int YoloProducer::DeinitMpi() {
 
     // VPSS
     if (impl_->vpss_enabled) {
-        vpss_deinit(kVpssGrp, false);
+        if (impl_->motion_gate) {
+            vpss_disable_motion_chn(kVpssGrp);
+            impl_->motion_gate = false;
+        }
+        vpss_deinit(kVpssGrp, impl_->dual_channel);
         impl_->vpss_enabled = false;
     }
 
-    // VI
-    if (impl_->vi_enabled) {
-        RK_MPI_VI_DisableChn(kViDev, kViChn);
-        RK_MPI_VI_DisableDev(kViDev);
-        impl_->vi_enabled = false;
+    // 共享采集核心（最后一个引用释放时才停止 ISP/VI）
+    if (impl_->capture_acquired) {
+        CaptureCore::Instance().Release();
+        impl_->capture_acquired = false;
     }
 
-    // MPI 系统
-    if (impl_->mpi_initialized) {
-        RK_MPI_SYS_Exit();
-        impl_->mpi_initialized = false;
-    }
+    return 0;
+}
 
-    // ISP
-    if (impl_->isp_initialized) {
-        SAMPLE_COMM_ISP_Stop(kViDev);
-        impl_->isp_initialized = false;
-    }
+namespace {
+
+rknn::ModelConfig MakeModelConfig() {
+    rknn::ModelConfig model_cfg;
+    model_cfg.model_path = kDefaultModelPath;  // 使用 mpi_config.h 中的相对路径
+    model_cfg.labels_path = kDefaultLabelsPath;
+    model_cfg.conf_threshold = 0.25f;
+    model_cfg.nms_threshold = 0.45f;
+    return model_cfg;
+}
 
+}  // namespace
+
+std::shared_ptr<rknn::YoloV5Model> YoloProducer::AcquireModel() {
+    return rknn::ModelCache::Instance().Acquire<rknn::YoloV5Model>(
+        rknn::ModelTypeToString(rknn::ModelType::kYoloV5), MakeModelConfig());
+}
+
+int YoloProducer::PreloadModel() {
+    auto model = AcquireModel();
+    if (!model) {
+        LOG_ERROR("Failed to preload YOLOv5 model");
+        return -1;
+    }
+    LOG_INFO("YOLOv5 model preloaded");
+    rknn::ModelCache::Instance().Release(model);  // 常驻与否由缓存策略决定
     return 0;
 }
 
 int YoloProducer::InitAiEngine() {
     // 初始化图像处理器
     impl_->image_processor = std::make_unique<rknn::ImageProcessor>();
-    if (!impl_->image_processor->Init(config_.ai_width, config_.ai_height)) {
+    auto backend = config_.rga_preprocess ? rknn::PreprocessBackend::kRga
+                                          : rknn::PreprocessBackend::kOpenCV;
+    if (!impl_->image_processor->Init(config_.ai_width, config_.ai_height, backend)) {
         LOG_ERROR("Failed to init image processor");
         return -1;
     }
 
-    // 初始化 AI 模型
-    impl_->ai_model = std::make_unique<rknn::YoloV5Model>();
-    
-    rknn::ModelConfig model_cfg;
-    model_cfg.model_path = kDefaultModelPath;  // 使用 mpi_config.h 中的相对路径
-    model_cfg.labels_path = kDefaultLabelsPath;
-    model_cfg.conf_threshold = 0.25f;
-    model_cfg.nms_threshold = 0.45f;
-
-    if (impl_->ai_model->Init(model_cfg) != 0) {
+    // 初始化 AI 模型（缓存命中时直接复用已加载的 rknn 上下文与 IO 内存）
+    impl_->ai_model = AcquireModel();
+    if (!impl_->ai_model) {
         LOG_ERROR("Failed to init YOLOv5 model");
         return -1;
     }
 
+    // 组合模式：RetinaFace 独立的预处理器（模型输入尺寸不同），两个模型由调度器分时运行
+    if (face_stage_) {
+        impl_->face_model = RetinaFaceProducer::AcquireModel();
+        if (!impl_->face_model) {
+            LOG_ERROR("Failed to init RetinaFace model");
+            return -1;
+        }
+        int face_width = 0;
+        int face_height = 0;
+        impl_->face_model->GetInputSize(face_width, face_height);
+        impl_->face_processor = std::make_unique<rknn::ImageProcessor>();
+        if (!impl_->face_processor->Init(face_width, face_height, backend)) {
+            LOG_ERROR("Failed to init face image processor");
+            return -1;
+        }
+
+        // 人形检测优先：人脸依赖人形框，NPU 过载时先降人脸速率
+        impl_->scheduler.Clear();
+        impl_->yolo_task = impl_->scheduler.AddTask({"yolov5", config_.yolo_rate_hz, 1});
+        impl_->face_task = impl_->scheduler.AddTask({"retinaface", config_.face_rate_hz, 0});
+        impl_->face_hold = std::chrono::milliseconds(
+            config_.face_rate_hz > 0.0 ? std::max(500, static_cast<int>(3000 / config_.face_rate_hz))
+                                       : 500);
+        LOG_INFO("NPU scheduler: yolov5 @ {} Hz, retinaface {}x{} @ {} Hz ({})",
+                 config_.yolo_rate_hz, face_width, face_height, config_.face_rate_hz,
+                 config_.face_in_person ? "inside person boxes" : "full frame");
+    }
+
+    // 隔帧推理时启用跟踪器
+    impl_->tracking = config_.inference_interval > 1;
+    if (impl_->tracking) {
+        LOG_INFO("Tracking enabled: inference every {} frames{}", config_.inference_interval,
+                 config_.adaptive_inference ? " (adaptive)" : "");
+    }
+
     // 分配临时缓冲区
     auto res = config_.GetResolutionConfig();
     impl_->temp_rgb_buffer.resize(res.width * res.height * 3);
@@ -427,13 +831,20 @@ int YoloProducer::InitAiEngine() {
 
 void YoloProducer::DeinitAiEngine() {
     if (impl_->ai_model) {
-        impl_->ai_model->Deinit();
-        impl_->ai_model.reset();
+        rknn::ModelCache::Instance().Release(impl_->ai_model);
+    }
+    if (impl_->face_model) {
+        rknn::ModelCache::Instance().Release(impl_->face_model);
     }
     if (impl_->image_processor) {
         impl_->image_processor->Deinit();
         impl_->image_processor.reset();
     }
+    if (impl_->face_processor) {
+        impl_->face_processor->Deinit();
+        impl_->face_processor.reset();
+    }
+    impl_->scheduler.Clear();
     impl_->temp_rgb_buffer.clear();
 }
 
@@ -457,137 +868,451 @@ bool YoloProducer::InitRgbPool() {
 void YoloProducer::FrameLoop() {
     LOG_INFO("Yolo frame loop started");
 
-    auto res = config_.GetResolutionConfig();
+    if (impl_->dual_channel) {
+        // VENC 由 VPSS 硬件绑定送帧，这里只负责取流分发
+        SeiStamper sei;
+        while (running_.load()) {
+            RK_S32 last_error = 0;
+            auto stream = acquire_encoded_stream(kVencChn, 100, &last_error);
+            if (!stream) {
+                continue;
+            }
+            frame_count_++;
+            sei.OnFetched(kVencChn, stream->pstPack->u64PTS);
+            impl_->dispatcher.DispatchFrame(stream);
+            video_rate_.Tick();
+        }
+
+        LOG_INFO("Frame loop exited, total frames: {}, inferences: {}",
+                 frame_count_.load(), inference_count_.load());
+        return;
+    }
+
     uint32_t time_ref = 0;
-    VIDEO_FRAME_INFO_S vpss_frame;
-
-    // VENC 帧结构
-    VIDEO_FRAME_INFO_S rgb_frame;
-    memset(&rgb_frame, 0, sizeof(rgb_frame));
-    rgb_frame.stVFrame.u32Width = res.width;
-    rgb_frame.stVFrame.u32Height = res.height;
-    rgb_frame.stVFrame.u32VirWidth = res.width;
-    rgb_frame.stVFrame.u32VirHeight = res.height;
-    rgb_frame.stVFrame.enPixelFormat = RK_FMT_RGB888;
-    rgb_frame.stVFrame.u32FrameFlag = 160;
+    const bool async = config_.async_inference;
 
     while (running_.load()) {
         // 1. 从 VPSS 获取帧
-        RK_S32 ret = RK_MPI_VPSS_GetChnFrame(kVpssGrp, kVpssChn0, &vpss_frame, 100);
-        if (ret != RK_SUCCESS) {
-            if (ret != RK_ERR_VPSS_BUF_EMPTY) {
-                LOG_WARN("VPSS GetChnFrame failed: {:#x}", ret);
-            }
+        VideoFramePtr frame = acquire_vpss_frame(kVpssGrp, kVpssChn0, 100);
+        if (!frame) {
             continue;
         }
 
         frame_count_++;
 
-        void* vpss_data = RK_MPI_MB_Handle2VirAddr(vpss_frame.stVFrame.pMbBlk);
-        if (!vpss_data) {
-            RK_MPI_VPSS_ReleaseChnFrame(kVpssGrp, kVpssChn0, &vpss_frame);
-            continue;
+        // 2. 推理：异步模式只发布最新帧，不等待 NPU
+        if (async) {
+            impl_->inference_frame.update(frame);
+        } else {
+            RunInference(frame);
         }
 
-        // 2. 获取 RGB buffer
-        MB_BLK rgb_blk = impl_->rgb_pool.GetBlock(true);
-        if (rgb_blk == MB_INVALID_HANDLE) {
-            RK_MPI_VPSS_ReleaseChnFrame(kVpssGrp, kVpssChn0, &vpss_frame);
-            LOG_WARN("Failed to get RGB buffer");
-            continue;
-        }
+        // 3. 叠加最新检测结果并编码
+        EncodeFrame(frame, time_ref++);
+    }
 
-        void* rgb_data = RK_MPI_MB_Handle2VirAddr(rgb_blk);
+    LOG_INFO("Yolo frame loop exited, total frames: {}, inferences: {}",
+             frame_count_.load(), inference_count_.load());
+}
 
-        // 3. 处理帧（NV12->RGB + AI推理 + OSD）
-        uint64_t pts = vpss_frame.stVFrame.u64PTS;
-        bool processed = ProcessFrame(
-            vpss_data,
-            vpss_frame.stVFrame.u32Width,
-            vpss_frame.stVFrame.u32Height,
-            vpss_frame.stVFrame.u32VirWidth,
-            rgb_data,
-            pts
-        );
-
-        // 释放 VPSS 帧
-        RK_MPI_VPSS_ReleaseChnFrame(kVpssGrp, kVpssChn0, &vpss_frame);
-
-        if (!processed) {
-            MbPool::ReleaseBlock(rgb_blk);
+void YoloProducer::InferenceLoop() {
+    LOG_INFO("Yolo inference loop started");
+
+    while (running_.load()) {
+        // 双通道布局直接从 Chn1 取硬件缩放后的帧（depth=1，天然只保留最新帧）
+        VideoFramePtr frame = impl_->dual_channel
+                                  ? acquire_vpss_frame(kVpssGrp, kVpssChn1, 100)
+                                  : impl_->inference_frame.wait(100);
+        if (!frame) {
             continue;
         }
+        RunInference(std::move(frame));
+    }
 
-        // 4. 送入 VENC
-        rgb_frame.stVFrame.pMbBlk = rgb_blk;
-        rgb_frame.stVFrame.u64PTS = pts;
-        rgb_frame.stVFrame.u32TimeRef = time_ref++;
+    LOG_INFO("Yolo inference loop exited, inferences: {}", inference_count_.load());
+}
 
-        ret = RK_MPI_VENC_SendFrame(kVencChn, &rgb_frame, 100);
-        MbPool::ReleaseBlock(rgb_blk);
+bool YoloProducer::RunInference(VideoFramePtr frame) {
+    void* nv12_data = get_frame_vir_addr(frame);
+    if (!nv12_data) {
+        return false;
+    }
 
-        if (ret != RK_SUCCESS) {
-            LOG_WARN("VENC SendFrame failed: {:#x}", ret);
-            continue;
+    static const auto stages = InferenceStageMetrics::ForModel("yolov5");
+    const uint64_t capture_pts = frame->stVFrame.u64PTS;
+    auto res = config_.GetResolutionConfig();
+    auto overlay = std::make_shared<Overlay>();
+
+    // 0. 运动门控：画面静止时整帧跳过（不预处理、不推理、不预测）
+    if (impl_->motion_gate && !MotionGateOpen(capture_pts)) {
+        return true;
+    }
+
+    // 推理降速时先按倍数放行；组合模式由 NPU 调度器决定本帧运行哪个模型；
+    // 否则按隔帧间隔决定是否推理
+    bool run_yolo = true;
+    if (!impl_->ThrottleDue(inference_divisor_.load(std::memory_order_relaxed))) {
+        run_yolo = false;
+    } else if (face_stage_) {
+        const int task = impl_->scheduler.Next(std::chrono::steady_clock::now(),
+                                               impl_->ReadyMask(config_.face_in_person));
+        if (task == impl_->face_task) {
+            return RunFaceDetection(std::move(frame), capture_pts);
         }
+        run_yolo = (task == impl_->yolo_task);
+    } else {
+        run_yolo = impl_->InferenceDue(config_.inference_interval, config_.adaptive_inference);
+    }
 
-        // 5. 获取编码结果
-        RK_S32 last_error = 0;
-        auto stream = acquire_encoded_stream(kVencChn, 100, &last_error);
-        if (stream) {
-            impl_->dispatcher.DispatchFrame(stream);
+    // 跳过帧：不动 NPU，由跟踪器把上次推理的目标外推到本帧（未启用跟踪时保持上次结果）
+    if (!run_yolo) {
+        if (!impl_->tracking) {
+            return true;
         }
+        frame.reset();
+        impl_->tracker.Predict(capture_pts, &overlay->results);
+        overlay->letterbox = impl_->tracker_letterbox;
+        PublishResults(std::move(overlay), capture_pts);
+        predicted_count_++;
+        return true;
     }
 
-    LOG_INFO("Yolo frame loop exited, total frames: {}, inferences: {}",
-             frame_count_.load(), inference_count_.load());
-}
+    auto start = std::chrono::steady_clock::now();
 
-bool YoloProducer::ProcessFrame(void* nv12_data, int width, int height, int stride,
-                                void* rgb_output, uint64_t pts) {
-    (void)pts;
-    
     // 1. NV12 -> RGB + letterbox 缩放到模型尺寸
-    rknn::LetterboxInfo letterbox_info;
-    int ret = impl_->image_processor->ConvertNV12ToModelInput(
-        nv12_data, width, height, stride,
-        impl_->ai_model->GetInputVirtAddr(),
-        letterbox_info
-    );
+    rknn::ImageBuffer src;
+    src.data = nv12_data;
+    src.width = frame->stVFrame.u32Width;
+    src.height = frame->stVFrame.u32Height;
+    src.stride = frame->stVFrame.u32VirWidth;
+    src.vir_height = frame->stVFrame.u32VirHeight;
+    src.fd = get_frame_fd(frame);
+
+    rknn::ImageBuffer dst;
+    dst.data = impl_->ai_model->GetInputVirtAddr();
+    dst.width = config_.ai_width;
+    dst.height = config_.ai_height;
+    dst.fd = impl_->ai_model->GetInputFd();
+
+    int ret = 0;
+    if (frame->stVFrame.enPixelFormat == RK_FMT_RGB888) {
+        src.stride = frame->stVFrame.u32VirWidth * 3;
+        ret = impl_->image_processor->LetterboxRGBToModelInput(src, dst, overlay->letterbox);
+    } else {
+        ret = impl_->image_processor->ConvertNV12ToModelInput(src, dst, overlay->letterbox);
+    }
+
+    // 模型输入已拷贝完成，尽早归还 VPSS buffer
+    frame.reset();
 
     if (ret != 0) {
-        LOG_WARN("NV12 to model input failed");
+        LOG_WARN_THROTTLED(5000, "NV12 to model input failed");
         return false;
     }
+    stages.preprocess.ObserveSince(start);
 
     // 2. AI 推理
+    auto stage_start = std::chrono::steady_clock::now();
     ret = impl_->ai_model->Run();
     if (ret != 0) {
-        LOG_WARN("AI inference failed");
+        LOG_WARN_THROTTLED(5000, "AI inference failed");
         return false;
     }
+    stages.inference.ObserveSince(stage_start);
+    stage_start = std::chrono::steady_clock::now();
+
+    // 3. 获取检测结果并发布给编码路径
+    impl_->ai_model->GetResults(overlay->results);
+    size_t count = overlay->results.Count();
+    if (impl_->dual_channel) {
+        // Chn1 坐标 -> Chn0（VENC）坐标：在 letterbox 缩放上叠加两通道的尺寸比
+        overlay->letterbox.scale *= static_cast<float>(impl_->ai_chn_width) / res.width;
+        overlay->letterbox.src_width = res.width;
+        overlay->letterbox.src_height = res.height;
+    }
+    if (impl_->tracking) {
+        impl_->tracker.Update(overlay->results, capture_pts);
+        impl_->tracker_letterbox = overlay->letterbox;
+    }
+    PublishResults(std::move(overlay), capture_pts);
+    stages.postprocess.ObserveSince(stage_start);
+    LatencyTracer::Instance().Record(LatencyTracer::Stage::kInference, capture_pts);
+
+    const auto end = std::chrono::steady_clock::now();
+    if (face_stage_) {
+        impl_->scheduler.Finish(impl_->yolo_task, start, end);
+    }
+    auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    inference_time_us_ += static_cast<uint64_t>(elapsed_us);
+    detection_count_ += count;
     inference_count_++;
+    inference_rate_.Tick();
 
-    // 3. 获取检测结果
-    rknn::DetectionResultList results;
-    impl_->ai_model->GetResults(results);
+    if (inference_count_ % 30 == 0 && count > 0) {
+        LOG_DEBUG("Inference {}: {} detections, {:.1f} ms",
+                  inference_count_.load(), count, elapsed_us / 1000.0);
+    }
+
+    return true;
+}
 
-    // 4. NV12 -> RGB 全尺寸（用于 OSD 叠加）
-    // 使用 libyuv 或简单转换
-    // 这里简化处理：将模型输出缩放回全尺寸并叠加检测框
-    impl_->image_processor->ConvertNV12ToModelInput(
-        nv12_data, width, height, stride,
-        rgb_output,
-        letterbox_info
-    );
+bool YoloProducer::RunFaceDetection(VideoFramePtr frame, uint64_t capture_pts) {
+    void* frame_data = get_frame_vir_addr(frame);
+    if (!frame_data) {
+        return false;
+    }
 
-    // 5. 绘制检测结果
-    impl_->image_processor->DrawDetections(
-        rgb_output, width, height, results, letterbox_info
-    );
+    static const auto stages = InferenceStageMetrics::ForModel("retinaface");
+    auto res = config_.GetResolutionConfig();
+    const auto start = std::chrono::steady_clock::now();
+
+    // 主码流坐标 -> 本帧坐标（双通道布局下本帧是 Chn1 缩放图）
+    const int frame_width = static_cast<int>(frame->stVFrame.u32Width);
+    const float to_frame = static_cast<float>(frame_width) / res.width;
+
+    rknn::ImageBuffer src;
+    src.data = frame_data;
+    src.width = frame_width;
+    src.height = frame->stVFrame.u32Height;
+    src.stride = frame->stVFrame.u32VirWidth;
+    src.vir_height = frame->stVFrame.u32VirHeight;
+    src.fd = get_frame_fd(frame);
+
+    // 只在人形框并集内检测（四周外扩 10%，容纳头部超出框的部分），小脸在裁剪后分辨率更高
+    if (config_.face_in_person && !impl_->person_boxes.empty()) {
+        int x1 = INT_MAX;
+        int y1 = INT_MAX;
+        int x2 = 0;
+        int y2 = 0;
+        for (const auto& box : impl_->person_boxes) {
+            x1 = std::min(x1, box.x);
+            y1 = std::min(y1, box.y);
+            x2 = std::max(x2, box.Right());
+            y2 = std::max(y2, box.y + box.height);
+        }
+        const int pad_x = (x2 - x1) / 10;
+        const int pad_y = (y2 - y1) / 10;
+        x1 = std::max(0, x1 - pad_x);
+        y1 = std::max(0, y1 - pad_y);
+        x2 = std::min(res.width, x2 + pad_x);
+        y2 = std::min(res.height, y2 + pad_y);
+        src.crop_x = static_cast<int>(x1 * to_frame);
+        src.crop_y = static_cast<int>(y1 * to_frame);
+        src.crop_width = static_cast<int>((x2 - x1) * to_frame);
+        src.crop_height = static_cast<int>((y2 - y1) * to_frame);
+    }
 
-    if (frame_count_ % 30 == 0 && results.Count() > 0) {
-        LOG_DEBUG("Frame {}: {} detections", frame_count_.load(), results.Count());
+    int face_width = 0;
+    int face_height = 0;
+    impl_->face_model->GetInputSize(face_width, face_height);
+    rknn::ImageBuffer dst;
+    dst.data = impl_->face_model->GetInputVirtAddr();
+    dst.width = face_width;
+    dst.height = face_height;
+    dst.fd = impl_->face_model->GetInputFd();
+
+    rknn::LetterboxInfo letterbox;
+    int ret = 0;
+    if (frame->stVFrame.enPixelFormat == RK_FMT_RGB888) {
+        src.stride = frame->stVFrame.u32VirWidth * 3;
+        ret = impl_->face_processor->LetterboxRGBToModelInput(src, dst, letterbox);
+    } else {
+        ret = impl_->face_processor->ConvertNV12ToModelInput(src, dst, letterbox);
+    }
+
+    // 模型输入已拷贝完成，尽早归还 VPSS buffer
+    frame.reset();
+
+    if (ret != 0) {
+        LOG_WARN_THROTTLED(5000, "Face model input preprocess failed");
+        return false;
+    }
+    stages.preprocess.ObserveSince(start);
+
+    auto stage_start = std::chrono::steady_clock::now();
+    ret = impl_->face_model->Run();
+    if (ret != 0) {
+        LOG_WARN_THROTTLED(5000, "Face inference failed");
+        return false;
+    }
+    stages.inference.ObserveSince(stage_start);
+    stage_start = std::chrono::steady_clock::now();
+
+    // 本帧坐标 -> 主码流坐标：缩放叠加通道尺寸比，裁剪偏移换算到主码流
+    rknn::DetectionResultList faces;
+    impl_->face_model->GetResults(faces);
+    if (frame_width != res.width) {
+        letterbox.scale *= to_frame;
+        letterbox.crop_x = static_cast<int>(letterbox.crop_x / to_frame);
+        letterbox.crop_y = static_cast<int>(letterbox.crop_y / to_frame);
+    }
+    rknn::ImageProcessor::MapDetections(faces, letterbox, res.width, res.height);
+    faces.pts = capture_pts;
+    detection_count_ += faces.Count();
+    impl_->faces = std::move(faces);
+    impl_->faces_time = std::chrono::steady_clock::now();
+
+    // 与最新的人形结果合并后重新发布，人脸不必等下一次 YOLOv5 推理才上屏
+    auto current = impl_->CurrentOverlay();
+    auto overlay = current ? std::make_shared<Overlay>(*current) : std::make_shared<Overlay>();
+    PublishResults(std::move(overlay), capture_pts);
+    stages.postprocess.ObserveSince(stage_start);
+
+    impl_->scheduler.Finish(impl_->face_task, start, std::chrono::steady_clock::now());
+    return true;
+}
+
+void YoloProducer::PublishResults(std::shared_ptr<Overlay> overlay, uint64_t capture_pts) {
+    auto res = config_.GetResolutionConfig();
+
+    // RGN 叠框与检测事件都需要主码流坐标，映射一次共用（组合模式还要从中取人形框）
+    rknn::DetectionResultList mapped;
+    if (impl_->rgn_overlay || detection_callback_ || impl_->smart_encoder.Enabled() ||
+        face_stage_) {
+        mapped = overlay->results;
+        rknn::ImageProcessor::MapDetections(mapped, overlay->letterbox, res.width, res.height);
+        mapped.frame_id = static_cast<int>(impl_->results_seq);
+        mapped.pts = capture_pts;
+    }
+    impl_->results_seq++;
+    if (face_stage_) {
+        impl_->UpdateFaces(mapped, config_.face_in_person);
+        overlay->faces = impl_->faces;
+    }
+    if (impl_->rgn_overlay) {
+        impl_->ai_model->GenerateOSDBoxes(mapped, impl_->osd_boxes);
+        if (overlay->faces.Count() > 0) {
+            impl_->face_model->GenerateOSDBoxes(overlay->faces, impl_->face_osd_boxes);
+            impl_->osd_boxes.insert(impl_->osd_boxes.end(), impl_->face_osd_boxes.begin(),
+                                    impl_->face_osd_boxes.end());
+        }
+        impl_->osd.UpdateBoxes(impl_->osd_boxes);
+    }
+    // 人脸并入同一份检测结果：检测事件、ROI 与元数据只看到一路输出
+    mapped.results.insert(mapped.results.end(), overlay->faces.results.begin(),
+                          overlay->faces.results.end());
+    impl_->smart_encoder.OnDetections(mapped);
+    impl_->PublishOverlay(std::move(overlay));
+
+    if (detection_callback_) {
+        detection_callback_(mapped, res.width, res.height);
+    }
+}
+
+bool YoloProducer::MotionGateOpen(uint64_t capture_pts) {
+    const auto now = std::chrono::steady_clock::now();
+    const auto& gate = config_.motion_gate;
+
+    // Chn3 depth = 1，非阻塞取最新一帧；取不到时沿用上一次的判定
+    VideoFramePtr luma = acquire_vpss_frame(kVpssGrp, kVpssChnMotion, 0);
+    if (luma && static_cast<int>(luma->stVFrame.u32Width) == gate.width &&
+        static_cast<int>(luma->stVFrame.u32Height) == gate.height) {
+        const void* y = get_frame_vir_addr(luma);
+        if (y && impl_->motion.Process(static_cast<const uint8_t*>(y),
+                                       static_cast<int>(luma->stVFrame.u32VirWidth))) {
+            impl_->last_motion = now;
+        }
+    }
+    luma.reset();
+    motion_frames_++;
+
+    const bool open = now - impl_->last_motion < std::chrono::milliseconds(gate.hold_ms);
+    if (open != impl_->motion_open) {
+        impl_->motion_open = open;
+        motion_active_.store(open);
+        LOG_DEBUG("Motion gate {} ({} active cells)", open ? "opened" : "closed",
+                  impl_->motion.ActiveCells());
+        if (open) {
+            // 重新开门后下一帧立即推理，不等隔帧间隔
+            impl_->frames_since_inference = config_.inference_interval;
+        } else {
+            // 关门：发布一次空结果，清掉画面上的框，事件引擎 / 客户端 / 智能码控随之进入空闲
+            impl_->tracker.Reset();
+            auto overlay = std::make_shared<Overlay>();
+            overlay->letterbox = impl_->tracker_letterbox;
+            PublishResults(std::move(overlay), capture_pts);
+        }
+    }
+
+    if (!open) {
+        motion_gated_++;
+    }
+    return open;
+}
+
+bool YoloProducer::EncodeFrame(const VideoFramePtr& frame, uint32_t time_ref) {
+    void* nv12_data = get_frame_vir_addr(frame);
+    if (!nv12_data) {
+        return false;
+    }
+
+    const int width = frame->stVFrame.u32Width;
+    const int height = frame->stVFrame.u32Height;
+
+    // 调试：采集时刻写入本帧 SEI（送帧模式下时刻精确）
+    LatencyTracer::Instance().StampSei(kVencChn, frame->stVFrame.u64PTS);
+
+    RK_S32 ret = RK_SUCCESS;
+    if (impl_->nv12_venc) {
+        // RGN 叠框 / 客户端渲染：VPSS NV12 帧原样送 VENC，零拷贝
+        VIDEO_FRAME_INFO_S nv12_frame = *frame;
+        nv12_frame.stVFrame.u32TimeRef = time_ref;
+        ret = RK_MPI_VENC_SendFrame(kVencChn, &nv12_frame, 100);
+    } else {
+        // 1. 获取 RGB buffer
+        MB_BLK rgb_blk = impl_->rgb_pool.GetBlock(true);
+        if (rgb_blk == MB_INVALID_HANDLE) {
+            LOG_WARN_THROTTLED(5000, "Failed to get RGB buffer");
+            return false;
+        }
+        void* rgb_data = RK_MPI_MB_Handle2VirAddr(rgb_blk);
+
+        // 2. NV12 -> 全尺寸 RGB，并叠加最新检测结果
+        if (impl_->image_processor->ConvertNV12ToRGB(
+                nv12_data, width, height, frame->stVFrame.u32VirWidth, rgb_data) != 0) {
+            MbPool::ReleaseBlock(rgb_blk);
+            return false;
+        }
+
+        auto overlay = impl_->CurrentOverlay();
+        if (overlay && overlay->results.Count() > 0) {
+            impl_->image_processor->DrawDetections(
+                rgb_data, width, height, overlay->results, overlay->letterbox);
+        }
+        if (overlay && overlay->faces.Count() > 0) {
+            // 人脸已是主码流坐标，无需 letterbox 映射
+            impl_->image_processor->DrawDetections(
+                rgb_data, width, height, overlay->faces, rknn::LetterboxInfo());
+        }
+
+        // 3. 送入 VENC
+        VIDEO_FRAME_INFO_S rgb_frame;
+        memset(&rgb_frame, 0, sizeof(rgb_frame));
+        rgb_frame.stVFrame.u32Width = width;
+        rgb_frame.stVFrame.u32Height = height;
+        rgb_frame.stVFrame.u32VirWidth = width;
+        rgb_frame.stVFrame.u32VirHeight = height;
+        rgb_frame.stVFrame.enPixelFormat = RK_FMT_RGB888;
+        rgb_frame.stVFrame.u32FrameFlag = 160;
+        rgb_frame.stVFrame.pMbBlk = rgb_blk;
+        rgb_frame.stVFrame.u64PTS = frame->stVFrame.u64PTS;
+        rgb_frame.stVFrame.u32TimeRef = time_ref;
+
+        ret = RK_MPI_VENC_SendFrame(kVencChn, &rgb_frame, 100);
+        MbPool::ReleaseBlock(rgb_blk);
+    }
+
+    if (ret != RK_SUCCESS) {
+        LOG_WARN_THROTTLED(5000, "VENC SendFrame failed: {:#x}", ret);
+        return false;
+    }
+
+    // 4. 获取编码结果
+    RK_S32 last_error = 0;
+    auto stream = acquire_encoded_stream(kVencChn, 100, &last_error);
+    if (stream) {
+        impl_->dispatcher.DispatchFrame(stream);
+        video_rate_.Tick();
     }
 
     return true;
@@ -601,4 +1326,8 @@ std::unique_ptr<IMediaProducer> CreateYoloProducer(const ProducerConfig& config)
     return std::make_unique<YoloProducer>(config);
 }
 
+std::unique_ptr<IMediaProducer> CreateYoloFaceProducer(const ProducerConfig& config) {
+    return std::make_unique<YoloProducer>(config, true);
+}
+
 }  // namespace media
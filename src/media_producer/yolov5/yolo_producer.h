@@ -2,25 +2,36 @@
  * @file yolo_producer.h
  * @brief YOLOv5 AI 推理模式生产者
  *
- * 数据流架构：
+ * 数据流架构（默认：双通道布局 + RGN 叠框）：
+ *   VI --> VPSS Chn0 (全分辨率 NV12) --(绑定)--> VENC (+RGN 检测框) --> 编码流
+ *            |
+ *            +--> Chn1 (硬件缩放到模型尺寸) --(手动获取)--> NPU --> RGN 更新
+ *   CPU 只补 letterbox 黑边，不触碰全分辨率帧。
+ *
+ * 单通道布局（ai_input_layout = kSingleChannel，异步推理）：
  *   VI --> VPSS (绑定)
  *           |
  *           v (手动获取)
- *        NV12 帧
- *           |
- *           v (转换 + 缩放)
- *        RGB 帧 --> NPU 推理 --> 检测结果
- *           |
- *           v (OSD 叠加)
- *        RGB 帧 (带框)
- *           |
- *           v (手动送入)
+ *        NV12 帧 ----------------------+
+ *           |                          | LatestFrameHolder（只保留最新帧）
+ *           v (RGN: 原样送入             v
+ *           |  CPU: 转 RGB + 画框)   推理线程：letterbox --> NPU 推理
+ *           v (每帧手动送入)
  *        VENC --> 编码流
  *
+ * 单通道串行模式（async_inference = false）下每帧先推理再编码，输出帧率受推理耗时限制。
+ * CPU 叠框（ai_overlay = kCpu）仅用于单通道布局，VENC 改为 RGB888 输入。
+ * 客户端渲染（ai_overlay = kClient）不叠框，检测结果由 MediaManager 的检测监听者编码下发。
+ * 隔帧推理（inference_interval > 1）：NPU 每 N 帧推理一次，其余帧由 ObjectTracker 外推检测框。
+ * 运动门控（motion_gate）：VPSS Chn3 输出小尺寸亮度图，画面静止时推理线程整帧跳过。
+ * 组合模式（YoloFace）：推理线程经 NpuScheduler 按目标速率分时运行 YOLOv5 与 RetinaFace，
+ * 人脸在最近一次人形框的并集（外扩）内裁剪检测，结果合并到同一路 RGN / 检测回调输出。
+ *
  * 特点：
- * - VPSS 和 VENC 解绑，由软件控制时序
+ * - 单通道布局下 VPSS 和 VENC 解绑，由软件控制时序
  * - 支持 YOLOv5 目标检测
- * - 检测框通过 OSD 叠加到编码流
+ * - 视频按采集帧率输出，检测框按 NPU 速率刷新
+ * - 默认通过 RGN 叠框，VENC 保持 NV12
  * - DDR 带宽受限，推荐 480p
  *
  * @author 好软，好温暖
@@ -38,6 +49,10 @@
 #include <functional>
 #include <vector>
 
+namespace rknn {
+class YoloV5Model;
+}
+
 namespace media {
 
 /**
@@ -51,8 +66,9 @@ public:
     /**
      * @brief 构造函数
      * @param config 配置参数
+     * @param face_stage 组合模式：额外运行 RetinaFace，与 YOLOv5 分时共用 NPU
      */
-    explicit YoloProducer(const ProducerConfig& config);
+    explicit YoloProducer(const ProducerConfig& config, bool face_stage = false);
     
     ~YoloProducer() override;
 
@@ -67,17 +83,45 @@ public:
         const std::string& name,
         StreamCallback callback,
         StreamConsumerType type = StreamConsumerType::AsyncIO,
-        int queue_size = 3) override;
+        int queue_size = 3,
+        QueueDropPolicy drop_policy = QueueDropPolicy::DropToKeyframe,
+        StreamSelector stream = StreamSelector::kMain,
+        const std::string& strand = {}) override;
 
+    bool RemoveStreamConsumer(const std::string& name) override;
     void ClearStreamConsumers() override;
+    std::vector<StreamConsumerStats> GetStreamConsumerStats() const override;
 
     bool IsInitialized() const override { return initialized_.load(); }
     bool IsRunning() const override { return running_.load(); }
-    const char* GetTypeName() const override { return "YoloV5"; }
+    const char* GetTypeName() const override {
+        return face_stage_ ? "YoloV5+RetinaFace" : "YoloV5";
+    }
     const ProducerConfig& GetConfig() const override { return config_; }
+    ProducerStats GetProducerStats() const override;
 
     int SetResolution(Resolution preset) override;
     int SetFrameRate(int fps) override;
+    int SetInferenceDivisor(int divisor) override;
+    int SetBitrate(StreamSelector stream, int kbps) override;
+    int RequestKeyFrame(StreamSelector stream, const char* reason = nullptr) override;
+    std::vector<EncodedStreamPtr> GetGopSnapshot(StreamSelector stream) override;
+    int CaptureSnapshot(const SnapshotRequest& request, Snapshot* out) override;
+    void SetDetectionCallback(DetectionCallback callback) override {
+        detection_callback_ = std::move(callback);
+    }
+
+    /**
+     * @brief 预加载 YOLOv5 模型到模型缓存（不创建 MPI 资源）
+     * @return 0 成功，-1 失败
+     */
+    static int PreloadModel();
+
+    /**
+     * @brief 从模型缓存获取 YOLOv5 模型（回放模式共用同一份配置）
+     * @return 模型实例，用完后交还 ModelCache::Release()；失败返回 nullptr
+     */
+    static std::shared_ptr<rknn::YoloV5Model> AcquireModel();
 
 private:
     // 禁止拷贝
@@ -110,31 +154,77 @@ private:
     bool InitRgbPool();
 
     /**
-     * @brief 帧处理主循环
+     * @brief 帧处理主循环（采集 + 编码）
      */
     void FrameLoop();
 
     /**
-     * @brief 处理单帧（AI 推理 + OSD）
+     * @brief 推理线程主循环（仅异步模式）
+     */
+    void InferenceLoop();
+
+    /**
+     * @brief 对单帧执行 AI 推理并发布检测结果
+     *
+     * 预处理完成后立即释放帧引用，使 VPSS buffer 不被 rknn_run 占住。
+     * 隔帧推理时未轮到的帧不经过 NPU，直接发布跟踪器外推的检测框。
      */
-    bool ProcessFrame(void* nv12_data, int width, int height, int stride,
-                      void* rgb_output, uint64_t pts);
+    bool RunInference(VideoFramePtr frame);
+
+    /**
+     * @brief 组合模式：在人形框区域内运行 RetinaFace，与最新 YOLOv5 结果合并后重新发布
+     */
+    bool RunFaceDetection(VideoFramePtr frame, uint64_t capture_pts);
+
+    struct Overlay;
+
+    /**
+     * @brief 运动门控：处理最新一帧运动检测小图，返回本帧是否需要推理
+     *
+     * 最后一次检测到运动之后 hold_ms 内保持打开；关闭时发布一次空结果清屏。
+     */
+    bool MotionGateOpen(uint64_t capture_pts);
+
+    /**
+     * @brief 发布一次检测结果（推理结果或跟踪预测）：RGN 叠框、CPU 叠框快照、检测回调；
+     *        组合模式下附上仍有效的人脸结果
+     */
+    void PublishResults(std::shared_ptr<Overlay> overlay, uint64_t capture_pts);
+
+    /**
+     * @brief 转 RGB、叠加最新检测结果并送入 VENC，随后分发编码流
+     */
+    bool EncodeFrame(const VideoFramePtr& frame, uint32_t time_ref);
 
 private:
     ProducerConfig config_;
+    const bool face_stage_;
     
     std::atomic<bool> initialized_{false};
     std::atomic<bool> running_{false};
     
     std::thread frame_thread_;
+    std::thread inference_thread_;
     
     // 内部实现（PIMPL 模式）
     struct Impl;
     std::unique_ptr<Impl> impl_;
 
+    // 检测结果回调（Start() 之前设置，推理线程只读）
+    DetectionCallback detection_callback_;
+
     // 统计
     std::atomic<uint64_t> frame_count_{0};
     std::atomic<uint64_t> inference_count_{0};
+    std::atomic<uint64_t> inference_time_us_{0};
+    std::atomic<uint64_t> detection_count_{0};
+    std::atomic<uint64_t> predicted_count_{0};
+    std::atomic<int> inference_divisor_{1};
+    std::atomic<uint64_t> motion_frames_{0};
+    std::atomic<uint64_t> motion_gated_{0};
+    std::atomic<bool> motion_active_{true};
+    RateMeter video_rate_;
+    RateMeter inference_rate_;
 };
 
 }  // namespace media
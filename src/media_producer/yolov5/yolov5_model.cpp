@@ -14,10 +14,15 @@
 #include "../common/osd_overlay.h"
 #include "common/logger.h"
 
+#include <algorithm>
 #include <cstring>
 #include <cmath>
 #include <fstream>
-#include <set>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define YOLOV5_USE_NEON 1
+#endif
 
 namespace rknn {
 
@@ -69,62 +74,35 @@ float CalculateIoU(float x1_min, float y1_min, float x1_max, float y1_max,
     return union_area <= 0.f ? 0.f : (intersection / union_area);
 }
 
-/// NMS 排序辅助
-void QuickSortIndicesDescending(std::vector<float>& scores, int left, int right,
-                                std::vector<int>& indices) {
-    if (left >= right) return;
-    
-    float pivot = scores[left];
-    int pivot_idx = indices[left];
-    int low = left, high = right;
-    
-    while (low < high) {
-        while (low < high && scores[high] <= pivot) high--;
-        scores[low] = scores[high];
-        indices[low] = indices[high];
-        
-        while (low < high && scores[low] >= pivot) low++;
-        scores[high] = scores[low];
-        indices[high] = indices[low];
-    }
-    scores[low] = pivot;
-    indices[low] = pivot_idx;
-    
-    QuickSortIndicesDescending(scores, left, low - 1, indices);
-    QuickSortIndicesDescending(scores, low + 1, right, indices);
-}
-
-/// NMS 实现
-int NMS(int valid_count, std::vector<float>& boxes, std::vector<int>& class_ids,
-        std::vector<int>& order, int filter_id, float threshold) {
-    for (int i = 0; i < valid_count; ++i) {
-        if (order[i] == -1 || class_ids[order[i]] != filter_id) continue;
-        
-        int n = order[i];
-        for (int j = i + 1; j < valid_count; ++j) {
-            int m = order[j];
-            if (m == -1 || class_ids[m] != filter_id) continue;
-            
-            float x1_min = boxes[n * 4 + 0];
-            float y1_min = boxes[n * 4 + 1];
-            float x1_max = x1_min + boxes[n * 4 + 2];
-            float y1_max = y1_min + boxes[n * 4 + 3];
-            
-            float x2_min = boxes[m * 4 + 0];
-            float y2_min = boxes[m * 4 + 1];
-            float x2_max = x2_min + boxes[m * 4 + 2];
-            float y2_max = y2_min + boxes[m * 4 + 3];
-            
-            float iou = CalculateIoU(x1_min, y1_min, x1_max, y1_max,
-                                     x2_min, y2_min, x2_max, y2_max);
-            if (iou > threshold) {
-                order[j] = -1;
-            }
+/// int8 数组求最大值及其（首个）下标；NEON 每次比较 16 个类别
+inline int8_t ArgMaxI8(const int8_t* data, int n, int& index) {
+    int8_t max_val = data[0];
+    int k = 1;
+#ifdef YOLOV5_USE_NEON
+    if (n >= 16) {
+        int8x16_t vmax = vld1q_s8(data);
+        for (k = 16; k + 16 <= n; k += 16) {
+            vmax = vmaxq_s8(vmax, vld1q_s8(data + k));
         }
+        // ARMv7 无 vmaxvq，用成对 max 归约 16 -> 1
+        int8x8_t m = vmax_s8(vget_low_s8(vmax), vget_high_s8(vmax));
+        m = vpmax_s8(m, m);
+        m = vpmax_s8(m, m);
+        m = vpmax_s8(m, m);
+        max_val = vget_lane_s8(m, 0);
     }
-    return 0;
+#endif
+    for (; k < n; ++k) {
+        if (data[k] > max_val) max_val = data[k];
+    }
+    index = 0;
+    while (data[index] != max_val) ++index;
+    return max_val;
 }
 
+/// 候选框初始容量（640x640 输入常见场景远小于此，超出时 vector 扩容一次后保留）
+constexpr size_t kCandidateReserve = 1024;
+
 }  // anonymous namespace
 
 // ============================================================================
@@ -276,6 +254,11 @@ int YoloV5Model::Init(const ModelConfig& config) {
         }
     }
     
+    // 11. 预留后处理缓冲区
+    candidates_.reserve(kCandidateReserve);
+    order_.reserve(kCandidateReserve);
+    suppressed_.reserve(kCandidateReserve);
+    
     initialized_ = true;
     LOG_INFO("YOLOv5 model initialized successfully");
     return 0;
@@ -405,114 +388,120 @@ int YoloV5Model::GetResults(DetectionResultList& results) {
 }
 
 int YoloV5Model::PostProcess(DetectionResultList& results) {
-    std::vector<float> boxes;
-    std::vector<float> scores;
-    std::vector<int> class_ids;
+    candidates_.clear();
     
     // 不同尺度的 grid 大小和 stride
     const int strides[3] = {8, 16, 32};
-    int valid_count = 0;
     
     // 遍历三个输出层
     for (uint32_t i = 0; i < io_num_.n_output && i < 3; ++i) {
         int grid_h = model_height_ / strides[i];
         int grid_w = model_width_ / strides[i];
-        
-        int8_t* output = static_cast<int8_t*>(output_mems_[i]->virt_addr);
-        int32_t zp = output_attrs_[i].zp;
-        float scale = output_attrs_[i].scale;
-        
-        int8_t threshold_i8 = QntF32ToAffine(config_.conf_threshold, zp, scale);
-        
-        // RV1106 NHWC 格式处理
-        int anchor_per_branch = 3;
-        int align_c = kPropBoxSize * anchor_per_branch;
-        
-        for (int h = 0; h < grid_h; ++h) {
-            for (int w = 0; w < grid_w; ++w) {
-                for (int a = 0; a < anchor_per_branch; ++a) {
-                    int hw_offset = h * grid_w * align_c + w * align_c + a * kPropBoxSize;
-                    int8_t* ptr = output + hw_offset;
-                    int8_t box_conf = ptr[4];
-                    
-                    if (box_conf >= threshold_i8) {
-                        // 找到最大类别概率
-                        int8_t max_class_prob = ptr[5];
-                        int max_class_id = 0;
-                        for (int k = 1; k < kCocoClassNum; ++k) {
-                            if (ptr[5 + k] > max_class_prob) {
-                                max_class_prob = ptr[5 + k];
-                                max_class_id = k;
-                            }
-                        }
-                        
-                        float box_conf_f32 = DeqntAffineToF32(box_conf, zp, scale);
-                        float class_prob_f32 = DeqntAffineToF32(max_class_prob, zp, scale);
-                        float final_score = box_conf_f32 * class_prob_f32;
-                        
-                        if (final_score > config_.conf_threshold) {
-                            // 解码边界框
-                            float box_x = DeqntAffineToF32(ptr[0], zp, scale) * 2.0f - 0.5f;
-                            float box_y = DeqntAffineToF32(ptr[1], zp, scale) * 2.0f - 0.5f;
-                            float box_w = DeqntAffineToF32(ptr[2], zp, scale) * 2.0f;
-                            float box_h = DeqntAffineToF32(ptr[3], zp, scale) * 2.0f;
-                            
-                            box_w = box_w * box_w;
-                            box_h = box_h * box_h;
-                            
-                            box_x = (box_x + w) * strides[i];
-                            box_y = (box_y + h) * strides[i];
-                            box_w *= kAnchors[i][a * 2];
-                            box_h *= kAnchors[i][a * 2 + 1];
-                            
-                            // 转换为左上角坐标
-                            box_x -= box_w / 2.0f;
-                            box_y -= box_h / 2.0f;
-                            
-                            boxes.push_back(box_x);
-                            boxes.push_back(box_y);
-                            boxes.push_back(box_w);
-                            boxes.push_back(box_h);
-                            scores.push_back(final_score);
-                            class_ids.push_back(max_class_id);
-                            valid_count++;
-                        }
-                    }
-                }
-            }
-        }
+        const int8_t* output = static_cast<const int8_t*>(output_mems_[i]->virt_addr);
+        DecodeOutput(output, static_cast<int>(i), grid_h, grid_w,
+                     output_attrs_[i].zp, output_attrs_[i].scale);
     }
     
-    if (valid_count == 0) {
+    if (candidates_.empty()) {
         return 0;
     }
     
-    // NMS
-    std::vector<int> order(valid_count);
-    for (int i = 0; i < valid_count; ++i) order[i] = i;
-    
-    // 按分数排序
-    std::vector<float> scores_copy = scores;
-    QuickSortIndicesDescending(scores_copy, 0, valid_count - 1, order);
-    
-    // 对每个类别执行 NMS
-    std::set<int> unique_classes(class_ids.begin(), class_ids.end());
-    for (int cls_id : unique_classes) {
-        NMS(valid_count, boxes, class_ids, order, cls_id, config_.nms_threshold);
+    BatchedNMS(results);
+    return 0;
+}
+
+void YoloV5Model::DecodeOutput(const int8_t* output, int branch, int grid_h, int grid_w,
+                               int32_t zp, float scale) {
+    const int stride = 8 << branch;
+    const float conf_threshold = config_.conf_threshold;
+    
+    // 目标置信度在量化域比较：阈值预先量化一次，未通过的 anchor 不做任何反量化
+    const int8_t threshold_i8 = QntF32ToAffine(conf_threshold, zp, scale);
+    
+    // RV1106 NHWC 格式：每个 cell 连续存放 3 个 anchor × 85 个属性
+    const int anchor_per_branch = 3;
+    const int align_c = kPropBoxSize * anchor_per_branch;
+    
+    for (int h = 0; h < grid_h; ++h) {
+        const int8_t* row = output + h * grid_w * align_c;
+        for (int w = 0; w < grid_w; ++w) {
+            const int8_t* cell = row + w * align_c;
+            for (int a = 0; a < anchor_per_branch; ++a) {
+                const int8_t* ptr = cell + a * kPropBoxSize;
+                if (ptr[4] < threshold_i8) continue;
+                
+                // 最大类别概率（NEON）
+                int max_class_id = 0;
+                int8_t max_class_prob = ArgMaxI8(ptr + 5, kCocoClassNum, max_class_id);
+                
+                float final_score = DeqntAffineToF32(ptr[4], zp, scale) *
+                                    DeqntAffineToF32(max_class_prob, zp, scale);
+                if (final_score <= conf_threshold) continue;
+                
+                // 仅对通过阈值的框解码坐标
+                float box_x = DeqntAffineToF32(ptr[0], zp, scale) * 2.0f - 0.5f;
+                float box_y = DeqntAffineToF32(ptr[1], zp, scale) * 2.0f - 0.5f;
+                float box_w = DeqntAffineToF32(ptr[2], zp, scale) * 2.0f;
+                float box_h = DeqntAffineToF32(ptr[3], zp, scale) * 2.0f;
+                
+                box_w = box_w * box_w * kAnchors[branch][a * 2];
+                box_h = box_h * box_h * kAnchors[branch][a * 2 + 1];
+                box_x = (box_x + w) * stride;
+                box_y = (box_y + h) * stride;
+                
+                // 转换为左上角坐标
+                Candidate c;
+                c.x = box_x - box_w / 2.0f;
+                c.y = box_y - box_h / 2.0f;
+                c.w = box_w;
+                c.h = box_h;
+                c.score = final_score;
+                c.class_id = max_class_id;
+                candidates_.push_back(c);
+            }
+        }
     }
-    
-    // 收集最终结果
-    for (int i = 0; i < valid_count && results.Count() < static_cast<size_t>(config_.max_detections); ++i) {
-        int idx = order[i];
-        if (idx == -1) continue;
+}
+
+void YoloV5Model::BatchedNMS(DetectionResultList& results) {
+    const int count = static_cast<int>(candidates_.size());
+    const size_t max_detections = static_cast<size_t>(config_.max_detections);
+    const float nms_threshold = config_.nms_threshold;
+    
+    // 按分数降序排序下标（缓冲区容量跨帧保留）
+    order_.resize(count);
+    for (int i = 0; i < count; ++i) order_[i] = i;
+    std::sort(order_.begin(), order_.end(), [this](int a, int b) {
+        return candidates_[a].score > candidates_[b].score;
+    });
+    suppressed_.assign(count, 0);
+    
+    // 单遍贪心 NMS：所有类别一起处理，只在同类框之间比较 IoU；
+    // 保留框按分数顺序输出，达到 max_detections 后提前结束
+    for (int i = 0; i < count && results.Count() < max_detections; ++i) {
+        if (suppressed_[i]) continue;
+        const Candidate& keep = candidates_[order_[i]];
+        float kx_max = keep.x + keep.w;
+        float ky_max = keep.y + keep.h;
+        
+        for (int j = i + 1; j < count; ++j) {
+            if (suppressed_[j]) continue;
+            const Candidate& other = candidates_[order_[j]];
+            if (other.class_id != keep.class_id) continue;
+            float iou = CalculateIoU(keep.x, keep.y, kx_max, ky_max,
+                                     other.x, other.y, other.x + other.w, other.y + other.h);
+            if (iou > nms_threshold) {
+                suppressed_[j] = 1;
+            }
+        }
         
         DetectionResult det;
-        det.class_id = class_ids[idx];
-        det.confidence = scores[idx];
-        det.box.x = Clamp(boxes[idx * 4 + 0], 0, model_width_);
-        det.box.y = Clamp(boxes[idx * 4 + 1], 0, model_height_);
-        det.box.width = Clamp(boxes[idx * 4 + 2], 0, model_width_ - det.box.x);
-        det.box.height = Clamp(boxes[idx * 4 + 3], 0, model_height_ - det.box.y);
+        det.class_id = keep.class_id;
+        det.confidence = keep.score;
+        det.box.x = Clamp(keep.x, 0, model_width_);
+        det.box.y = Clamp(keep.y, 0, model_height_);
+        det.box.width = Clamp(keep.w, 0, model_width_ - det.box.x);
+        det.box.height = Clamp(keep.h, 0, model_height_ - det.box.y);
         
         // 设置标签
         if (det.class_id >= 0 && det.class_id < static_cast<int>(labels_.size())) {
@@ -523,8 +512,6 @@ int YoloV5Model::PostProcess(DetectionResultList& results) {
         
         results.Add(det);
     }
-    
-    return 0;
 }
 
 int YoloV5Model::LoadLabels(const std::string& labels_path) {
@@ -569,10 +556,45 @@ void* YoloV5Model::GetInputVirtAddr() const {
     return input_mem_ ? input_mem_->virt_addr : nullptr;
 }
 
+int YoloV5Model::GetInputFd() const {
+    return input_mem_ ? input_mem_->fd : -1;
+}
+
 int YoloV5Model::GetInputMemSize() const {
     return input_mem_ ? input_mem_->size : 0;
 }
 
+int YoloV5Model::GetOutputNum() const {
+    return static_cast<int>(std::min<uint32_t>(io_num_.n_output, 3));
+}
+
+void* YoloV5Model::GetOutputVirtAddr(int index) const {
+    if (index < 0 || index >= GetOutputNum() || !output_mems_[index]) return nullptr;
+    return output_mems_[index]->virt_addr;
+}
+
+int YoloV5Model::GetOutputMemSize(int index) const {
+    if (index < 0 || index >= GetOutputNum() || !output_mems_[index]) return 0;
+    return output_mems_[index]->size;
+}
+
+size_t YoloV5Model::GetMemoryUsage() const {
+    if (!initialized_) return 0;
+    
+    size_t total = 0;
+    rknn_mem_size mem_size;
+    std::memset(&mem_size, 0, sizeof(mem_size));
+    if (rknn_query(ctx_, RKNN_QUERY_MEM_SIZE, &mem_size, sizeof(mem_size)) == RKNN_SUCC) {
+        total += mem_size.total_weight_size + mem_size.total_internal_size;
+    }
+    
+    if (input_mem_) total += input_mem_->size;
+    for (int i = 0; i < 3; ++i) {
+        if (output_mems_[i]) total += output_mems_[i]->size;
+    }
+    return total;
+}
+
 std::string YoloV5Model::FormatResultLog(const DetectionResult& result, size_t index,
                                           float letterbox_scale,
                                           int letterbox_pad_x,
@@ -66,7 +66,14 @@ public:
     ModelType GetType() const { return ModelType::kYoloV5; }
     void GetInputSize(int& width, int& height) const;
     void* GetInputVirtAddr() const;
+    int GetInputFd() const;
     int GetInputMemSize() const;
+    int GetOutputNum() const;
+    void* GetOutputVirtAddr(int index) const;
+    int GetOutputMemSize(int index) const;
+    
+    /// NPU 内存占用（权重 + 中间层 + IO 张量），用于模型缓存的内存上限统计
+    size_t GetMemoryUsage() const;
     
     /// 格式化检测结果日志
     std::string FormatResultLog(const DetectionResult& result, size_t index,
@@ -85,10 +92,22 @@ private:
     /// 后处理：解码输出并执行 NMS
     int PostProcess(DetectionResultList& results);
     
-    /// 处理单个输出层
-    int ProcessOutput(int8_t* output, int* anchor, int grid_h, int grid_w,
-                      int stride, std::vector<float>& boxes,
-                      std::vector<float>& scores, std::vector<int>& class_ids);
+    /// 解码单个输出层，通过置信度阈值的候选框追加到 candidates_
+    void DecodeOutput(const int8_t* output, int branch, int grid_h, int grid_w,
+                      int32_t zp, float scale);
+    
+    /// 按分数排序后单遍批量 NMS（同类框互相抑制），结果写入 results
+    void BatchedNMS(DetectionResultList& results);
+
+    /// 后处理候选框（模型输入坐标，左上角 + 宽高）
+    struct Candidate {
+        float x;
+        float y;
+        float w;
+        float h;
+        float score;
+        int class_id;
+    };
 
 private:
     // RKNN 上下文
@@ -115,6 +134,11 @@ private:
     // 标签名称
     std::vector<std::string> labels_;
     
+    // 后处理缓冲区（Init 时预留容量，跨帧复用，稳态下不再分配）
+    std::vector<Candidate> candidates_;
+    std::vector<int> order_;
+    std::vector<uint8_t> suppressed_;
+    
     // 初始化状态
     bool initialized_ = false;
 };